@@ -1,6 +1,8 @@
 #include "accel_struct_mngr.hpp"
+#include "box_merger.hpp"
 
 #include <map>
+#include <chrono>
 
 using AS_MANAGER_STATUS = cubeland::ACCEL_STRUCT_MNGR::AS_MANAGER_STATUS;
 using ACCEL_STRUCT_MNGR = cubeland::ACCEL_STRUCT_MNGR;
@@ -96,6 +98,7 @@ bool ACCEL_STRUCT_MNGR::create(u32 max_instance_count, u32 max_primitive_count,
         max_remapping_light_buffer_size = sizeof(u32) * max_cube_light_count;
         max_instance_bitmask_size = max_instance_count / sizeof(u32) + 1;
         max_primitive_bitmask_size = max_primitive_count / sizeof(u32) + 1;
+        max_brush_range_owner_size = (max_primitive_count / PRIMITIVE_ALIGNMENT + 1) * sizeof(u32);
 
         temp_instances = std::make_unique<INSTANCE[]>(max_instance_count);
         primitives = std::make_unique<PRIMITIVE[]>(max_primitive_count);
@@ -128,6 +131,7 @@ bool ACCEL_STRUCT_MNGR::create(u32 max_instance_count, u32 max_primitive_count,
 
         // Initialize BLASes
         proc_blas.resize(max_instance_count, daxa::BlasId{});
+        shared_instances.resize(max_instance_count);
 
         instance_free_list = std::make_unique<free_uuid_list<uuid32>>(max_instance_count);
 
@@ -186,6 +190,51 @@ bool ACCEL_STRUCT_MNGR::create(u32 max_instance_count, u32 max_primitive_count,
 
         cube_lights = device.get_host_address_as<LIGHT>(cube_light_buffer).value();
 
+#if BRICK_PRIMITIVES_ON == 1
+        brick_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = sizeof(BRICK) * MAX_BRICKS,
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = ("brick_buffer"),
+        });
+
+        bricks = device.get_host_address_as<BRICK>(brick_buffer).value();
+
+        brick_free_list =
+            std::make_unique<gpu_free_list<VoxelBuffer, gpu_allocator<VoxelBuffer>>>(device,
+                                                                                     MAX_BRICKS,
+                                                                                     brick_buffer);
+#endif // BRICK_PRIMITIVES_ON
+
+#if LIGHT_TREE_ON == 1
+        light_tree_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = sizeof(LIGHT_TREE_NODE) * MAX_LIGHT_TREE_NODES,
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = ("light_tree_buffer"),
+        });
+
+        light_tree_nodes = device.get_host_address_as<LIGHT_TREE_NODE>(light_tree_buffer).value();
+
+        light_tree_leaf_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = sizeof(daxa_u32) * max_cube_light_count,
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = ("light_tree_leaf_buffer"),
+        });
+
+        light_tree_leaves = device.get_host_address_as<daxa_u32>(light_tree_leaf_buffer).value();
+        // An empty tree: the root has no power
+        light_tree_nodes[0] = LIGHT_TREE_NODE{.phi = 0.0f, .parent = MAX_LIGHT_TREE_NODES, .is_leaf = 1};
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+        light_alias_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = sizeof(LIGHT_ALIAS) * max_cube_light_count,
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = ("light_alias_buffer"),
+        });
+
+        light_alias_entries = device.get_host_address_as<LIGHT_ALIAS>(light_alias_buffer).value();
+#endif // LIGHT_ALIAS_TABLE_ON
+
         remapping_light_buffer = device.create_buffer({
             .size = max_remapping_light_buffer_size,
             .name = "remapping light buffer",
@@ -209,6 +258,18 @@ bool ACCEL_STRUCT_MNGR::create(u32 max_instance_count, u32 max_primitive_count,
             .name = "brush primitive bitmask buffer",
         });
 
+        brush_range_owner_buffer = device.create_buffer({
+            .size = max_brush_range_owner_size,
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = "brush range owner buffer",
+        });
+
+        brush_box_hit_buffer = device.create_buffer({
+            .size = sizeof(BRUSH_BOX_HIT) * MAX_BRUSH_BOX_HITS,
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = "brush box hit buffer",
+        });
+
         brush_indirect_buffer = device.create_buffer({
             .size = sizeof(u32) * 3,
             .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
@@ -229,6 +290,11 @@ bool ACCEL_STRUCT_MNGR::create(u32 max_instance_count, u32 max_primitive_count,
 
         brush_counters = device.get_host_address_as<BRUSH_COUNTER>(brush_counter_buffer).value();
 
+        brush_range_owners = device.get_host_address_as<u32>(brush_range_owner_buffer).value();
+        std::fill_n(brush_range_owners, max_brush_range_owner_size / sizeof(u32), BRUSH_RANGE_UNCLAIMED);
+
+        brush_box_hits = device.get_host_address_as<BRUSH_BOX_HIT>(brush_box_hit_buffer).value();
+
         change_info = primitive_change_info;
 
         brush_task_graph = record_primitive_changes_task_graph(
@@ -256,9 +322,10 @@ bool ACCEL_STRUCT_MNGR::destroy()
         for (auto _tlas : tlas)
             if (_tlas != daxa::TlasId{})
                 device.destroy_tlas(_tlas);
-        for (auto blas : proc_blas)
-            if (blas != daxa::BlasId{})
-                device.destroy_blas(blas);
+        for (u32 i = 0; i < proc_blas.size(); i++)
+            // Borrowed BLASes are destroyed with their prototype
+            if (proc_blas.at(i) != daxa::BlasId{} && !shared_instances.at(i).borrowed_blas)
+                device.destroy_blas(proc_blas.at(i));
 
         if (proc_blas_scratch_buffer != daxa::BufferId{})
             device.destroy_buffer(proc_blas_scratch_buffer);
@@ -292,6 +359,24 @@ bool ACCEL_STRUCT_MNGR::destroy()
         if (cube_light_buffer != daxa::BufferId{})
             device.destroy_buffer(cube_light_buffer);
 
+#if BRICK_PRIMITIVES_ON == 1
+        if (brick_buffer != daxa::BufferId{})
+            device.destroy_buffer(brick_buffer);
+#endif // BRICK_PRIMITIVES_ON
+
+#if LIGHT_TREE_ON == 1
+        if (light_tree_buffer != daxa::BufferId{})
+            device.destroy_buffer(light_tree_buffer);
+
+        if (light_tree_leaf_buffer != daxa::BufferId{})
+            device.destroy_buffer(light_tree_leaf_buffer);
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+        if (light_alias_buffer != daxa::BufferId{})
+            device.destroy_buffer(light_alias_buffer);
+#endif // LIGHT_ALIAS_TABLE_ON
+
         if (remapping_light_buffer != daxa::BufferId{})
             device.destroy_buffer(remapping_light_buffer);
 
@@ -304,6 +389,12 @@ bool ACCEL_STRUCT_MNGR::destroy()
         if (brush_primitive_bitmask_buffer != daxa::BufferId{})
             device.destroy_buffer(brush_primitive_bitmask_buffer);
 
+        if (brush_range_owner_buffer != daxa::BufferId{})
+            device.destroy_buffer(brush_range_owner_buffer);
+
+        if (brush_box_hit_buffer != daxa::BufferId{})
+            device.destroy_buffer(brush_box_hit_buffer);
+
         if(brush_indirect_buffer != daxa::BufferId{})
             device.destroy_buffer(brush_indirect_buffer);
 
@@ -604,6 +695,83 @@ bool ACCEL_STRUCT_MNGR::copy_updated_aabb_device_buffer(u32 buffer_index, u32 in
     return true;
 }
 
+bool ACCEL_STRUCT_MNGR::split_aabb_device_buffer(u32 buffer_index, TASK &task)
+{
+    if (!device.is_valid() || !initialized)
+    {
+#if WARN
+        std::cerr << "device.is_valid()" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    TASK::BLAS_SPLIT_PRIM_FROM_GPU split_task = task.blas_split_prim_gpu;
+
+    u32 instance_index = split_task.instance_index;
+    u32 previous_first_primitive_index = instances[instance_index].first_primitive_index;
+    u32 previous_primitive_count = instances[instance_index].primitive_count;
+    // Every box keeps its slot for its first voxel
+    u32 appended_primitive_count = split_task.voxel_count - split_task.split_count;
+    u32 new_primitive_count = previous_primitive_count + appended_primitive_count;
+
+    // NOTE: the range is kept in place if the aligned allocation has room for the new voxels
+    size_t primitive_buffer_offset = 0;
+    size_t previous_primitive_buffer_offset = 0;
+    if (primitive_free_list->reallocate(VoxelBuffer({.index = instance_index}),
+                                        get_aligned(new_primitive_count, PRIMITIVE_ALIGNMENT),
+                                        primitive_buffer_offset, previous_primitive_buffer_offset, instance_index) == VoxelBuffer{})
+    {
+#if WARN
+        std::cerr << " Could not reallocate primitives for instance_index: " << instance_index << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    // Move the instance primitives if the range changed (both ranges are owned at this point, no overlap)
+    if (primitive_buffer_offset != previous_first_primitive_index)
+    {
+        copy_buffer(aabb_buffer[buffer_index], aabb_buffer[buffer_index],
+                    previous_first_primitive_index * sizeof(AABB), primitive_buffer_offset * sizeof(AABB),
+                    previous_primitive_count * sizeof(AABB), false);
+        copy_buffer(primitive_buffer[buffer_index], primitive_buffer[buffer_index],
+                    previous_first_primitive_index * sizeof(PRIMITIVE), primitive_buffer_offset * sizeof(PRIMITIVE),
+                    previous_primitive_count * sizeof(PRIMITIVE));
+    }
+
+    // Replace each merged box by its first voxel
+    for (u32 i = 0; i < split_task.split_count; i++)
+    {
+        upload_aabb_device_buffer(buffer_index, 1,
+                                  split_task.host_buffer_offset + i,
+                                  primitive_buffer_offset + split_task.primitive_indices[i]);
+    }
+
+    // Append the remaining voxels at the end of the instance
+    upload_aabb_device_buffer(buffer_index, appended_primitive_count,
+                              split_task.host_buffer_offset + split_task.split_count,
+                              primitive_buffer_offset + previous_primitive_count);
+
+    instances[instance_index].first_primitive_index = primitive_buffer_offset;
+    instances[instance_index].primitive_count = new_primitive_count;
+    add_global_blas_info(buffer_index, appended_primitive_count);
+
+    // Previous frame hits on split boxes are no longer valid
+    for (u32 i = 0; i < split_task.split_count; i++)
+    {
+        update_remapping_buffer(instance_index, split_task.primitive_indices[i], split_task.primitive_indices[i]);
+    }
+
+    task.blas_split_prim_gpu.previous_primitive_count = previous_primitive_count;
+
+#if INFO == 1
+    std::cout << "SPLIT_PRIMITIVE_BLAS_FROM_GPU:" << std::endl;
+    std::cout << "  >Instance id: " << instance_index << " boxes split: " << split_task.split_count << " into voxels: " << split_task.voxel_count << std::endl;
+    std::cout << "  >Instance primitive count: " << previous_primitive_count << " -> " << new_primitive_count << std::endl;
+#endif // INFO
+
+    return true;
+}
+
 bool ACCEL_STRUCT_MNGR::delete_aabb_device_buffer(u32 buffer_index,
                                                   u32 instance_index, u32 primitive_index,
                                                   u32 primitive_to_exchange,
@@ -1190,6 +1358,17 @@ bool ACCEL_STRUCT_MNGR::delete_light_device_buffer(u32 buffer_index,
 #endif // TRACE
     }
 
+#if LIGHT_TREE_ON == 1
+    // The leaf of the deleted light is refit in place, the exchanged light takes its index
+    light_tree.remove_light(light_to_delete, light_to_exchange);
+    --light_tree_light_count;
+    light_tree.upload(light_tree_nodes, light_tree_leaves);
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+    light_alias_dirty = true;
+#endif // LIGHT_ALIAS_TABLE_ON
+
     return true;
 }
 
@@ -1293,10 +1472,95 @@ bool ACCEL_STRUCT_MNGR::restore_light_device_buffer(u32 buffer_index,
         backup_cube_lights.pop_back();
 
         ++temp_cube_light_count;
+
+#if LIGHT_TREE_ON == 1
+        light_tree.restore_light(light_to_recover_index, light_exchanged_index, get_cube_light_tree_bounds(cube_lights[light_to_recover_index]));
+        ++light_tree_light_count;
+        light_tree.upload(light_tree_nodes, light_tree_leaves);
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+        light_alias_dirty = true;
+#endif // LIGHT_ALIAS_TABLE_ON
+    }
+
+    return true;
+}
+
+#if LIGHT_TREE_ON == 1
+// Same bounds the shaders sample: the light position is in world space & the faces aren't scaled (sample_lights)
+auto ACCEL_STRUCT_MNGR::get_cube_light_tree_bounds(LIGHT const &light) const -> LightBounds
+{
+    return get_cube_light_bounds(glm::vec3(light.position.x, light.position.y, light.position.z), glm::mat3(1.0f), light.size,
+                                 glm::vec3(light.emissive.x, light.emissive.y, light.emissive.z));
+}
+
+bool ACCEL_STRUCT_MNGR::update_light_tree(u32 cube_light_count)
+{
+    if (!device.is_valid() || !initialized)
+    {
+#if WARN
+        std::cerr << "device.is_valid()" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    if (cube_light_count == light_tree_light_count && !light_tree.needs_rebuild())
+        return true;
+
+    light_tree = LightTree{};
+    light_tree.resize(cube_light_count);
+    for (u32 i = 0; i < cube_light_count; ++i)
+        light_tree.set_light(i, get_cube_light_tree_bounds(cube_lights[i]));
+    light_tree.build();
+    light_tree_light_count = cube_light_count;
+
+    if (light_tree.get_node_count() == 0)
+        light_tree_nodes[0] = LIGHT_TREE_NODE{.phi = 0.0f, .parent = MAX_LIGHT_TREE_NODES, .is_leaf = 1};
+    light_tree.upload(light_tree_nodes, light_tree_leaves);
+
+#if INFO == 1
+    std::cout << "light tree: " << cube_light_count << " lights, " << light_tree.get_node_count() << " nodes, depth "
+              << light_tree.get_depth() << std::endl;
+#endif // INFO
+
+    return true;
+}
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+bool ACCEL_STRUCT_MNGR::update_light_alias_table(u32 cube_light_count)
+{
+    if (!device.is_valid() || !initialized)
+    {
+#if WARN
+        std::cerr << "device.is_valid()" << std::endl;
+#endif // WARN
+        return false;
     }
 
+    if (cube_light_count == light_alias_light_count && !light_alias_dirty)
+        return true;
+
+    // Same power the shaders see: the light position is in world space & the faces aren't scaled (sample_lights)
+    light_alias_weights.resize(cube_light_count);
+    for (u32 i = 0; i < cube_light_count; ++i)
+        light_alias_weights[i] = host_get_cube_light_power(glm::mat3(1.0f), cube_lights[i].size,
+                                                           glm::vec3(cube_lights[i].emissive.x, cube_lights[i].emissive.y, cube_lights[i].emissive.z));
+    light_alias_table.build(light_alias_weights);
+    light_alias_light_count = cube_light_count;
+    light_alias_dirty = false;
+
+    // An empty table leaves the buffer as it was, no light is sampled
+    light_alias_table.upload(light_alias_entries);
+
+#if INFO == 1
+    std::cout << "light alias table: " << cube_light_count << " lights, total power " << light_alias_table.get_total_weight() << std::endl;
+#endif // INFO
+
     return true;
 }
+#endif // LIGHT_ALIAS_TABLE_ON
 
 //////////////////////////////// UPDATING - UNDO  ENDS//////////////////////////////////////
 
@@ -1529,7 +1793,8 @@ bool ACCEL_STRUCT_MNGR::rebuild_blases(u32 buffer_index, std::vector<u32> &insta
 
     for (auto instance_index : instance_list)
     {
-        if (proc_blas.at(instance_index) != daxa::BlasId{})
+        // A borrowed BLAS still belongs to its prototype
+        if (proc_blas.at(instance_index) != daxa::BlasId{} && !shared_instances.at(instance_index).borrowed_blas)
         {
             temp_proc_blas.push_back(proc_blas.at(instance_index));
         }
@@ -1615,6 +1880,7 @@ bool ACCEL_STRUCT_MNGR::rebuild_blases(u32 buffer_index, std::vector<u32> &insta
 #endif
 
         proc_blas.at(instance_index) = blas;
+        shared_instances.at(instance_index).borrowed_blas = false;
 
         // Here BLAS buffer is updated
         blas_build_infos.at(blas_build_infos.size() - 1).dst_blas = proc_blas.at(instance_index);
@@ -1879,7 +2145,8 @@ bool ACCEL_STRUCT_MNGR::build_tlas(u32 buffer_index, bool sync)
     // build procedural blas
     for (u32 i = 0; i < max_wide_instance_count[buffer_index]; i++)
     {
-        if (proc_blas.at(i) == daxa::BlasId{})
+        // Prototypes are only referenced by their placements
+        if (get_instance_blas(i) == daxa::BlasId{} || shared_instances.at(i).is_prototype)
         {
             continue;
         }
@@ -1891,13 +2158,16 @@ bool ACCEL_STRUCT_MNGR::build_tlas(u32 buffer_index, bool sync)
             .mask = 0xFF,
             .instance_shader_binding_table_record_offset = {}, // Is also default
             .flags = {},                                       // Is also default
-            .blas_device_address = device.get_device_address(this->proc_blas.at(i)).value(),
+            .blas_device_address = device.get_device_address(get_instance_blas(i)).value(),
         });
     }
 
+    // NOTE: hidden prototypes are counted in current_instance_count
+    u32 tlas_instance_count = static_cast<u32>(blas_instance_array.size());
+
     /// create blas instances for tlas:
     auto blas_instances_buffer = device.create_buffer({
-        .size = sizeof(daxa_BlasInstanceData) * current_instance_count[buffer_index],
+        .size = sizeof(daxa_BlasInstanceData) * std::max(tlas_instance_count, 1U),
         .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
         .name = "blas instances array buffer",
     });
@@ -1909,7 +2179,7 @@ bool ACCEL_STRUCT_MNGR::build_tlas(u32 buffer_index, bool sync)
     auto blas_instances = std::array{
         daxa::TlasInstanceInfo{
             .data = {}, // Ignored in get_acceleration_structure_build_sizes.   // Is also default
-            .count = current_instance_count[buffer_index],
+            .count = tlas_instance_count,
             .is_data_array_of_pointers = false, // Buffer contains flat array of instances, not an array of pointers to instances.
             // .flags = daxa::GeometryFlagBits::OPAQUE,
             .flags = static_cast<daxa::GeometryFlags>(0x1),
@@ -2068,6 +2338,40 @@ using TASK = cubeland::ACCEL_STRUCT_MNGR::TASK;
 
 bool ACCEL_STRUCT_MNGR::delete_blas_process(TASK& task, u32 next_index, std::vector<u32>& delete_blas_index_list) {
     TASK::BLAS_DELETE_FROM_CPU delete_task = task.blas_delete_from_cpu;
+    SHARED_INSTANCE &shared_instance = shared_instances.at(delete_task.instance_index);
+
+    if (shared_instance.is_prototype && shared_instance.reference_count > 0)
+    {
+#if WARN
+        std::cerr << " Could not delete prototype instance_index: " << delete_task.instance_index << " still referenced by " << shared_instance.reference_count << " placements" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    if (shared_instance.prototype_index != static_cast<u32>(-1))
+    {
+        // Placements don't own primitives nor BLAS, only the instance slot is released
+        if (!instance_free_list->deallocate(delete_task.instance_index))
+        {
+#if WARN
+            std::cerr << " Could not deallocate instance from free list instance_index: " << delete_task.instance_index << std::endl;
+#endif // WARN
+            return false;
+        }
+        --shared_instances.at(shared_instance.prototype_index).reference_count;
+        shared_instance = {};
+
+        task.blas_delete_from_cpu.first_primitive_index = instances[delete_task.instance_index].first_primitive_index;
+        task.blas_delete_from_cpu.deleted_primitive_count = 0;
+
+        delete_global_blas(next_index, 0);
+        tlas_dirty = true;
+
+        instances[delete_task.instance_index].primitive_count = 0;
+        instances[delete_task.instance_index].first_primitive_index = -1;
+        return true;
+    }
+
     // free instance
     if (!instance_free_list->deallocate(delete_task.instance_index))
     {
@@ -2077,6 +2381,11 @@ bool ACCEL_STRUCT_MNGR::delete_blas_process(TASK& task, u32 next_index, std::vec
         return false;
     }
     primitive_free_list->deallocate(VoxelBuffer({.index = delete_task.instance_index}));
+#if BRICK_PRIMITIVES_ON == 1
+    // Released with the BLAS, the TLAS in use still reaches the bricks
+    if (shared_instance.brick_count > 0)
+        temp_brick_ranges.push_back({shared_instance.brick_range, shared_instance.brick_count});
+#endif // BRICK_PRIMITIVES_ON
 
     task.blas_delete_from_cpu.first_primitive_index = instances[delete_task.instance_index].first_primitive_index;
     task.blas_delete_from_cpu.deleted_primitive_count = instances[delete_task.instance_index].primitive_count;
@@ -2088,9 +2397,16 @@ bool ACCEL_STRUCT_MNGR::delete_blas_process(TASK& task, u32 next_index, std::vec
         static_cast<u32>(-1));
     // TODO: remap light buffer ?
     // keep blas id for deleting blas
-    temp_proc_blas.push_back(proc_blas.at(delete_task.instance_index));
+    if (!shared_instance.borrowed_blas)
+        temp_proc_blas.push_back(proc_blas.at(delete_task.instance_index));
     // set proc blas to zero
     proc_blas.at(delete_task.instance_index) = daxa::BlasId{};
+    if (shared_instance.is_prototype)
+    {
+        auto &prototypes = model_prototypes[shared_instance.model_index];
+        prototypes.erase(std::remove(prototypes.begin(), prototypes.end(), delete_task.instance_index), prototypes.end());
+    }
+    shared_instance = {};
     // TODO: this will need a mutex if manager is parallelized
     {
         // Update instance info
@@ -2112,6 +2428,68 @@ bool ACCEL_STRUCT_MNGR::delete_blas_process(TASK& task, u32 next_index, std::vec
     return true;
 }
 
+bool ACCEL_STRUCT_MNGR::instance_blas_process(TASK& task, u32 next_index) {
+    TASK::BLAS_INSTANCE_FROM_CPU instance_task = task.blas_instance_from_cpu;
+
+    auto prototypes = model_prototypes.find(instance_task.model_index);
+    if (prototypes == model_prototypes.end() || prototypes->second.empty())
+    {
+#if WARN
+        std::cerr << " No prototypes for model_index: " << instance_task.model_index << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    // One placement per prototype (gvox region) of the model
+    u32 instance_count = static_cast<u32>(prototypes->second.size());
+    task.blas_instance_from_cpu.instance_count = instance_count;
+    task.blas_instance_from_cpu.instance_indices = new u32[instance_count];
+
+    for (u32 i = 0; i < instance_count; i++)
+    {
+        u32 prototype_index = prototypes->second.at(i);
+
+        // Allocate new instance
+        uuid32 new_instance_id = instance_free_list->allocate();
+        if (new_instance_id == static_cast<uuid32>(-1))
+        {
+#if FATAL
+            std::cerr << " Could not allocate instance from free list" << std::endl;
+#endif // FATAL
+            std::abort();
+        }
+
+        task.blas_instance_from_cpu.instance_indices[i] = new_instance_id;
+
+        // Update instance, primitives are read from the prototype range
+        instances[new_instance_id].transform = instance_task.transform;
+        instances[new_instance_id].first_primitive_index = instances[prototype_index].first_primitive_index;
+        instances[new_instance_id].primitive_count = instances[prototype_index].primitive_count;
+        proc_blas.at(new_instance_id) = daxa::BlasId{};
+
+        shared_instances.at(new_instance_id) = {.prototype_index = prototype_index};
+        ++shared_instances.at(prototype_index).reference_count;
+
+        // Update instance info
+        add_global_blas(next_index, 0);
+
+#if INFO == 1
+        std::cout << "  Placed Instance id: " << new_instance_id << std::endl;
+        std::cout << "      Prototype instance id: " << prototype_index << std::endl;
+        std::cout << "      Instance primitive count: " << instances[new_instance_id].primitive_count << std::endl;
+#endif // INFO
+    }
+#if INFO == 1
+    std::cout << "INSTANCE_BLAS_FROM_CPU:" << std::endl;
+    std::cout << "  >Instance count: " << current_instance_count[next_index] << std::endl;
+#endif // INFO
+
+    // No BLAS to build, only the TLAS
+    tlas_dirty = true;
+
+    return true;
+}
+
 void ACCEL_STRUCT_MNGR::process_task_queue()
 {
 
@@ -2188,8 +2566,36 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
                 task.blas_build_from_cpu.instance_indices[i] = new_instance_id;
 
                 // NOTE: allocate aligned to 32 elements
-                primitive_free_list->allocate(get_aligned(temp_instances[queue_instance_count].primitive_count, PRIMITIVE_ALIGNMENT), // size
-                                              primitive_buffer_offset, new_instance_id);
+                if (primitive_free_list->allocate(get_aligned(temp_instances[queue_instance_count].primitive_count, PRIMITIVE_ALIGNMENT), // size
+                                                  primitive_buffer_offset, new_instance_id)
+                        .is_invalid())
+                {
+#if FATAL
+                    std::cerr << " Could not allocate primitives from free list" << std::endl;
+#endif // FATAL
+                    std::abort();
+                }
+#if BRICK_PRIMITIVES_ON == 1
+                // Staged bricks to the slots of the instance, its primitives point to them before they're uploaded
+                u32 instance_brick_count = temp_instances[queue_instance_count].primitive_count;
+                VoxelBuffer brick_range = {};
+                if (instance_brick_count > 0)
+                {
+                    size_t brick_offset = 0;
+                    brick_range = brick_free_list->allocate(instance_brick_count, brick_offset, next_brick_range++);
+                    if (brick_range.is_invalid())
+                    {
+#if FATAL
+                        std::cerr << " Could not allocate bricks from free list" << std::endl;
+#endif // FATAL
+                        std::abort();
+                    }
+                    PRIMITIVE *instance_primitives = primitives.get() + temp_instances[queue_instance_count].first_primitive_index;
+                    std::memcpy(bricks + brick_offset, temp_bricks.data() + instance_primitives[0].material_index, instance_brick_count * sizeof(BRICK));
+                    for (u32 j = 0; j < instance_brick_count; ++j)
+                        instance_primitives[j].material_index = static_cast<u32>(brick_offset) + j;
+                }
+#endif // BRICK_PRIMITIVES_ON
                 // Update primitive buffers
                 upload_aabb_device_buffer(next_index,
                                           temp_instances[queue_instance_count].primitive_count,
@@ -2199,6 +2605,18 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
                 instances[new_instance_id].transform = build_task.transform;
                 instances[new_instance_id].first_primitive_index = primitive_buffer_offset;
                 instances[new_instance_id].primitive_count = temp_instances[queue_instance_count].primitive_count;
+                // Registered models are hidden prototypes, their placements are added with INSTANCE_BLAS_FROM_CPU
+                shared_instances.at(new_instance_id) = {};
+#if BRICK_PRIMITIVES_ON == 1
+                shared_instances.at(new_instance_id).brick_range = brick_range;
+                shared_instances.at(new_instance_id).brick_count = instance_brick_count;
+#endif // BRICK_PRIMITIVES_ON
+                if (build_task.model_index != 0)
+                {
+                    shared_instances.at(new_instance_id).is_prototype = true;
+                    shared_instances.at(new_instance_id).model_index = build_task.model_index;
+                    model_prototypes[build_task.model_index].push_back(new_instance_id);
+                }
                 // Keep blas id for building blas
                 blas_index_list.push_back(new_instance_id);
                 // Update instance info
@@ -2292,7 +2710,7 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
         {
             TASK::BLAS_UPDATE update_task = task.blas_update;
 
-            if (proc_blas.at(update_task.instance_index) == daxa::BlasId{})
+            if (get_instance_blas(update_task.instance_index) == daxa::BlasId{})
             {
 #if WARN
                 std::cerr << " Could not find instance_index: " << update_task.instance_index << " in proc_blas" << std::endl;
@@ -2312,6 +2730,18 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
             std::cout << "  [" << instances[update_task.instance_index].transform.w.x << ", " << instances[update_task.instance_index].transform.w.y << ", " << instances[update_task.instance_index].transform.w.z << ", " << instances[update_task.instance_index].transform.w.w << "]" << std::endl;
 #endif // TRACE
 
+            if (shared_instances.at(update_task.instance_index).prototype_index != static_cast<u32>(-1))
+            {
+                // Placements only move, their primitives belong to the prototype
+#if WARN
+                if (update_task.primitive_count > 0)
+                    std::cerr << " Primitive update ignored for placement instance_index: " << update_task.instance_index << std::endl;
+#endif // WARN
+                task.blas_update.primitive_count = 0;
+                tlas_dirty = true;
+                break;
+            }
+
             if (update_task.primitive_count > 0)
             {
                 // update aabb buffer
@@ -2344,6 +2774,32 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
             }
         }
         break;
+        case TASK::TYPE::SPLIT_PRIMITIVE_BLAS_FROM_GPU:
+        {
+            if (!split_aabb_device_buffer(next_index, task))
+            {
+#if WARN
+                std::cerr << " Could not split merged boxes" << std::endl;
+#endif // WARN
+                delete[] task.blas_split_prim_gpu.primitive_indices;
+                --split_task_count;
+                continue;
+            }
+            // keep blas id for rebuilding blas
+            rebuild_blas_index_list.push_back(task.blas_split_prim_gpu.instance_index);
+        }
+        break;
+        case TASK::TYPE::INSTANCE_BLAS_FROM_CPU:
+        {
+            if (!instance_blas_process(task, next_index))
+            {
+#if WARN
+                std::cerr << " Could not instance model_index: " << task.blas_instance_from_cpu.model_index << std::endl;
+#endif // WARN
+                continue;
+            }
+        }
+        break;
         default:
         {
         }
@@ -2360,12 +2816,13 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
     // update max wide instance count
     max_wide_instance_count[next_index] = std::max(max_wide_instance_count[next_index], current_instance_count[next_index]);
 
-    if (delete_blas_index_list.empty() && blas_index_list.empty() && rebuild_blas_index_list.empty() && update_blas_index_list.empty())
+    if (delete_blas_index_list.empty() && blas_index_list.empty() && rebuild_blas_index_list.empty() && update_blas_index_list.empty() && !tlas_dirty)
     {
         // Set switching to false
         status = AS_MANAGER_STATUS::IDLE;
         return;
     }
+    tlas_dirty = false;
 
     // update instances
     upload_all_instances(next_index);
@@ -2434,6 +2891,10 @@ void ACCEL_STRUCT_MNGR::process_task_queue()
     temp_primitive_count = 0;
     // Reset temp primitive index count
     temp_primitive_index_count = 0;
+#if BRICK_PRIMITIVES_ON == 1
+    // Every staged brick is in its slot
+    temp_bricks.clear();
+#endif // BRICK_PRIMITIVES_ON
 
     {
         // TODO: mutex here
@@ -2563,6 +3024,28 @@ void ACCEL_STRUCT_MNGR::process_switching_task_queue()
             }
         }
         break;
+        case TASK::TYPE::SPLIT_PRIMITIVE_BLAS_FROM_GPU:
+        {
+            TASK::BLAS_SPLIT_PRIM_FROM_GPU split_task = task.blas_split_prim_gpu;
+            // Update primitive info
+            add_global_blas_info(next_index, split_task.voxel_count - split_task.split_count);
+            // Copy BLAS primitives from previous frame buffer
+            copy_instance_aabb_device_buffer(next_index, split_task.instance_index);
+        }
+        break;
+        case TASK::TYPE::INSTANCE_BLAS_FROM_CPU:
+        {
+            TASK::BLAS_INSTANCE_FROM_CPU instance_task = task.blas_instance_from_cpu;
+            // Placements share the prototype primitives, only the instance count changes
+            for (u32 i = 0; i < instance_task.instance_count; i++)
+            {
+                add_global_blas(next_index, 0);
+            }
+
+            delete[] instance_task.instance_indices;
+            task.blas_instance_from_cpu.instance_indices = nullptr;
+        }
+        break;
         default:
         {
         }
@@ -2653,6 +3136,19 @@ void ACCEL_STRUCT_MNGR::process_settling_task_queue()
             }
         }
         break;
+        case TASK::TYPE::SPLIT_PRIMITIVE_BLAS_FROM_GPU:
+        {
+            TASK::BLAS_SPLIT_PRIM_FROM_GPU split_task = task.blas_split_prim_gpu;
+            // Restore remapping buffer
+            for (u32 i = 0; i < split_task.split_count; i++)
+            {
+                clear_remapping_buffer(split_task.instance_index, split_task.primitive_indices[i], split_task.primitive_indices[i]);
+            }
+            delete[] split_task.primitive_indices;
+            task.blas_split_prim_gpu.primitive_indices = nullptr;
+            --split_task_count;
+        }
+        break;
         default:
         {
         }
@@ -2701,6 +3197,17 @@ void ACCEL_STRUCT_MNGR::process_settling_task_queue()
 
     temp_proc_blas.clear();
 
+#if BRICK_PRIMITIVES_ON == 1
+    // delete temp brick ranges
+    for (auto [brick_range, range_brick_count] : temp_brick_ranges)
+    {
+        brick_free_list->deallocate(brick_range);
+        brick_count -= range_brick_count;
+    }
+
+    temp_brick_ranges.clear();
+#endif // BRICK_PRIMITIVES_ON
+
     // delete temp proc tlas
     for(auto tlas : temp_proc_tlas)
         if (tlas != daxa::TlasId{})
@@ -2833,6 +3340,442 @@ restore_buffers:
     restore_bitmask_buffers(instance_bitmask_staging_buffer, primitive_bitmask_staging_buffer);
 }
 
+void ACCEL_STRUCT_MNGR::split_merged_primitives()
+{
+    if (!device.is_valid() || !initialized)
+    {
+#if WARN
+        std::cerr << "device.is_valid()" << std::endl;
+#endif // WARN
+        return;
+    }
+
+    // Bring bitmask to host
+    auto instance_bitmask_staging_buffer = device.create_buffer({
+        .size = max_instance_bitmask_size,
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = ("split_instance_bitmask_staging_buffer"),
+    });
+    defer { device.destroy_buffer(instance_bitmask_staging_buffer); };
+
+    copy_buffer(brush_instance_bitmask_buffer, instance_bitmask_staging_buffer, 0, 0, max_instance_bitmask_size, false);
+
+    auto primitive_bitmask_staging_buffer = device.create_buffer({
+        .size = max_primitive_bitmask_size,
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = ("split_primitive_bitmask_staging_buffer"),
+    });
+    defer { device.destroy_buffer(primitive_bitmask_staging_buffer); };
+
+    copy_buffer(brush_primitive_bitmask_buffer, primitive_bitmask_staging_buffer, 0, 0, max_primitive_bitmask_size);
+
+    auto *instance_bitmask_buffer_ptr = device.get_host_address_as<u32>(instance_bitmask_staging_buffer).value();
+
+    auto *primitive_bitmask_buffer_ptr = device.get_host_address_as<u32>(primitive_bitmask_staging_buffer).value();
+
+    bool bitmask_changed = false;
+
+    for (u32 instance_index = 0; instance_index < max_wide_instance_count[current_index]; instance_index++)
+    {
+        if ((instance_bitmask_buffer_ptr[instance_index >> 5] & (1U << (instance_index & 31))) == 0U)
+            continue;
+
+        INSTANCE instance = instances[instance_index];
+        if (instance.primitive_count == 0)
+            continue;
+
+        // Bring instance AABBs & primitives to host
+        auto aabb_staging_buffer = device.create_buffer({
+            .size = instance.primitive_count * sizeof(AABB),
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = ("split_aabb_staging_buffer"),
+        });
+        defer { device.destroy_buffer(aabb_staging_buffer); };
+
+        auto primitive_staging_buffer = device.create_buffer({
+            .size = instance.primitive_count * sizeof(PRIMITIVE),
+            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .name = ("split_primitive_staging_buffer"),
+        });
+        defer { device.destroy_buffer(primitive_staging_buffer); };
+
+        copy_buffer(aabb_buffer[current_index], aabb_staging_buffer, instance.first_primitive_index * sizeof(AABB), 0, instance.primitive_count * sizeof(AABB), false);
+        copy_buffer(primitive_buffer[current_index], primitive_staging_buffer, instance.first_primitive_index * sizeof(PRIMITIVE), 0, instance.primitive_count * sizeof(PRIMITIVE));
+
+        auto *instance_aabbs = device.get_host_address_as<AABB>(aabb_staging_buffer).value();
+        auto *instance_primitives = device.get_host_address_as<PRIMITIVE>(primitive_staging_buffer).value();
+
+        std::vector<u32> split_indices = {};
+        u32 voxel_count = 0;
+
+        for (u32 i = 0; i < instance.primitive_count; i++)
+        {
+            u32 primitive_index = instance.first_primitive_index + i;
+            if ((primitive_bitmask_buffer_ptr[primitive_index >> 5] & (1U << (primitive_index & 31))) == 0U)
+                continue;
+            if (!BoxMerger::is_merged_aabb(instance_aabbs[i]))
+                continue;
+            split_indices.push_back(i);
+            voxel_count += BoxMerger::aabb_voxel_count(instance_aabbs[i]);
+        }
+
+        if (split_indices.empty())
+            continue;
+
+        if ((temp_primitive_count + voxel_count) * sizeof(AABB) > max_aabb_host_buffer_size)
+        {
+#if WARN
+            std::cerr << " Not enough host memory to split merged boxes of instance_index: " << instance_index << std::endl;
+#endif // WARN
+            continue;
+        }
+
+        // Hits on the instance once its boxes are split: the plain voxels keep their ids & the hit boxes give the
+        // voxel under the hit position, boxes past MAX_BRUSH_BOX_HITS are only split
+        SplitBoxes split = {.primitive_count = instance.primitive_count};
+        for (auto box_id : split_indices)
+            split.add_box(box_id, BoxMerger::aabb_voxel_count(instance_aabbs[box_id]));
+
+        std::vector<u32> hit_ids = {};
+        for (u32 i = 0; i < instance.primitive_count; i++)
+        {
+            if (is_bit_set(primitive_bitmask_buffer_ptr, instance.first_primitive_index + i) && !BoxMerger::is_merged_aabb(instance_aabbs[i]))
+                hit_ids.push_back(i);
+        }
+
+        glm::mat4 world2obj = glm::inverse(daxa_f32mat4x4_to_glm_mat4(instance.transform));
+        for (u32 i = 0; i < std::min(brush_counters->box_hit_count, MAX_BRUSH_BOX_HITS); i++)
+        {
+            BRUSH_BOX_HIT box_hit = brush_box_hits[i];
+            if (box_hit.primitive_index < instance.first_primitive_index || box_hit.primitive_index >= instance.first_primitive_index + instance.primitive_count)
+                continue;
+            u32 box_id = box_hit.primitive_index - instance.first_primitive_index;
+            glm::vec3 position = glm::vec3(world2obj * glm::vec4(box_hit.position.x, box_hit.position.y, box_hit.position.z, 1.0f));
+            u32 hit_id = get_split_hit_id(split, box_id, instance_aabbs[box_id], {position.x, position.y, position.z});
+            if (hit_id != static_cast<u32>(-1))
+                hit_ids.push_back(hit_id);
+        }
+        std::sort(hit_ids.begin(), hit_ids.end());
+        hit_ids.erase(std::unique(hit_ids.begin(), hit_ids.end()), hit_ids.end());
+
+        // Stage voxels: first voxel of every box, then the rest of them
+        u32 host_buffer_offset = 0;
+        AABB *aabb_host_address = request_aabb_host_buffer_count(voxel_count, host_buffer_offset);
+        u32 split_count = split_indices.size();
+        u32 appended_offset = host_buffer_offset + split_count;
+        std::vector<AABB> voxel_aabbs = {};
+
+        for (u32 k = 0; k < split_count; k++)
+        {
+            AABB box = instance_aabbs[split_indices[k]];
+            PRIMITIVE primitive = instance_primitives[split_indices[k]];
+
+            voxel_aabbs.resize(BoxMerger::aabb_voxel_count(box));
+            u32 box_voxel_count = BoxMerger::split_aabb(box, voxel_aabbs.data());
+
+            aabb_host_address[host_buffer_offset + k] = voxel_aabbs[0];
+            primitives[host_buffer_offset + k] = primitive;
+            for (u32 v = 1; v < box_voxel_count; v++)
+            {
+                aabb_host_address[appended_offset] = voxel_aabbs[v];
+                primitives[appended_offset] = primitive;
+                ++appended_offset;
+            }
+        }
+
+        // The hits of the instance are set again once it is split (apply_split_hits), the ids of its primitives change
+        split_hits.push_back(SPLIT_HITS{
+            .instance_index = instance_index,
+            .primitive_count = split.get_split_primitive_count(),
+            .primitive_ids = std::move(hit_ids),
+        });
+        for (u32 i = 0; i < instance.primitive_count; i++)
+        {
+            u32 primitive_index = instance.first_primitive_index + i;
+            if ((primitive_bitmask_buffer_ptr[primitive_index >> 5] & (1U << (primitive_index & 31))) != 0U)
+            {
+                primitive_bitmask_buffer_ptr[primitive_index >> 5] &= ~(1U << (primitive_index & 31));
+                --brush_counters->primitive_count;
+            }
+        }
+        instance_bitmask_buffer_ptr[instance_index >> 5] &= ~(1U << (instance_index & 31));
+        --brush_counters->instance_count;
+        bitmask_changed = true;
+
+        u32 *primitive_indices = new u32[split_count];
+        std::memcpy(primitive_indices, split_indices.data(), split_count * sizeof(u32));
+
+#if DEBUG == 1
+        std::cout << "Instance: " << instance_index << " merged boxes to split: " << split_count << " voxels: " << voxel_count << std::endl;
+#endif // DEBUG
+
+        ++split_task_count;
+        task_queue_add(TASK{
+            .type = TASK::TYPE::SPLIT_PRIMITIVE_BLAS_FROM_GPU,
+            .blas_split_prim_gpu = {.instance_index = instance_index,
+                                    .split_count = split_count,
+                                    .voxel_count = voxel_count,
+                                    .host_buffer_offset = host_buffer_offset,
+                                    .previous_primitive_count = instance.primitive_count,
+                                    .primitive_indices = primitive_indices},
+        });
+    }
+
+    if (bitmask_changed)
+    {
+        copy_buffer(instance_bitmask_staging_buffer, brush_instance_bitmask_buffer, 0, 0, max_instance_bitmask_size, false);
+
+        copy_buffer(primitive_bitmask_staging_buffer, brush_primitive_bitmask_buffer, 0, 0, max_primitive_bitmask_size);
+    }
+}
+
+void ACCEL_STRUCT_MNGR::apply_split_hits()
+{
+    if (!device.is_valid() || !initialized)
+    {
+#if WARN
+        std::cerr << "device.is_valid()" << std::endl;
+#endif // WARN
+        return;
+    }
+
+    // Bring bitmask to host
+    auto instance_bitmask_staging_buffer = device.create_buffer({
+        .size = max_instance_bitmask_size,
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = ("split_hits_instance_bitmask_staging_buffer"),
+    });
+    defer { device.destroy_buffer(instance_bitmask_staging_buffer); };
+
+    copy_buffer(brush_instance_bitmask_buffer, instance_bitmask_staging_buffer, 0, 0, max_instance_bitmask_size, false);
+
+    auto primitive_bitmask_staging_buffer = device.create_buffer({
+        .size = max_primitive_bitmask_size,
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = ("split_hits_primitive_bitmask_staging_buffer"),
+    });
+    defer { device.destroy_buffer(primitive_bitmask_staging_buffer); };
+
+    copy_buffer(brush_primitive_bitmask_buffer, primitive_bitmask_staging_buffer, 0, 0, max_primitive_bitmask_size);
+
+    auto *instance_bitmask_buffer_ptr = device.get_host_address_as<u32>(instance_bitmask_staging_buffer).value();
+
+    auto *primitive_bitmask_buffer_ptr = device.get_host_address_as<u32>(primitive_bitmask_staging_buffer).value();
+
+    for (auto const &hits : split_hits)
+    {
+        INSTANCE instance = instances[hits.instance_index];
+        // Deleted, or the split failed
+        if (instance.first_primitive_index == static_cast<u32>(-1) || instance.primitive_count != hits.primitive_count)
+        {
+#if WARN
+            std::cerr << " Brush hits of instance: " << hits.instance_index << " dropped, its merged boxes were not split" << std::endl;
+#endif // WARN
+            continue;
+        }
+
+        if (hits.primitive_ids.empty())
+            continue;
+
+        for (auto primitive_id : hits.primitive_ids)
+        {
+            u32 primitive_index = instance.first_primitive_index + primitive_id;
+            if (!is_bit_set(primitive_bitmask_buffer_ptr, primitive_index))
+                ++brush_counters->primitive_count;
+            primitive_bitmask_buffer_ptr[primitive_index >> 5] |= 1U << (primitive_index & 31);
+        }
+        if (!is_bit_set(instance_bitmask_buffer_ptr, hits.instance_index))
+            ++brush_counters->instance_count;
+        instance_bitmask_buffer_ptr[hits.instance_index >> 5] |= 1U << (hits.instance_index & 31);
+
+#if DEBUG == 1
+        std::cout << "Instance: " << hits.instance_index << " split hits: " << hits.primitive_ids.size() << std::endl;
+#endif // DEBUG
+    }
+    split_hits.clear();
+
+    copy_buffer(instance_bitmask_staging_buffer, brush_instance_bitmask_buffer, 0, 0, max_instance_bitmask_size, false);
+
+    copy_buffer(primitive_bitmask_staging_buffer, brush_primitive_bitmask_buffer, 0, 0, max_primitive_bitmask_size);
+}
+
+void ACCEL_STRUCT_MNGR::split_shared_instances()
+{
+    if (!device.is_valid() || !initialized)
+    {
+#if WARN
+        std::cerr << "device.is_valid()" << std::endl;
+#endif // WARN
+        return;
+    }
+
+    // Bring bitmask to host
+    auto instance_bitmask_staging_buffer = device.create_buffer({
+        .size = max_instance_bitmask_size,
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = ("shared_instance_bitmask_staging_buffer"),
+    });
+    defer { device.destroy_buffer(instance_bitmask_staging_buffer); };
+
+    copy_buffer(brush_instance_bitmask_buffer, instance_bitmask_staging_buffer, 0, 0, max_instance_bitmask_size, false);
+
+    auto primitive_bitmask_staging_buffer = device.create_buffer({
+        .size = max_primitive_bitmask_size,
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = ("shared_primitive_bitmask_staging_buffer"),
+    });
+    defer { device.destroy_buffer(primitive_bitmask_staging_buffer); };
+
+    copy_buffer(brush_primitive_bitmask_buffer, primitive_bitmask_staging_buffer, 0, 0, max_primitive_bitmask_size);
+
+    auto *instance_bitmask_buffer_ptr = device.get_host_address_as<u32>(instance_bitmask_staging_buffer).value();
+
+    auto *primitive_bitmask_buffer_ptr = device.get_host_address_as<u32>(primitive_bitmask_staging_buffer).value();
+
+    // Placements hit in the stroke by prototype & the ranges claimed by the brush
+    std::map<u32, SharedRangeHits> shared_ranges = {};
+    std::vector<u32> claimed_ranges = {};
+
+    for (u32 instance_index = 0; instance_index < max_wide_instance_count[current_index]; instance_index++)
+    {
+        if (!is_bit_set(instance_bitmask_buffer_ptr, instance_index))
+            continue;
+
+        // Deleted since the hit
+        if (instances[instance_index].first_primitive_index != static_cast<u32>(-1))
+            claimed_ranges.push_back(instances[instance_index].first_primitive_index / PRIMITIVE_ALIGNMENT);
+
+        u32 prototype_index = shared_instances.at(instance_index).prototype_index;
+        if (prototype_index == static_cast<u32>(-1))
+            continue;
+
+        SharedRangeHits &range = shared_ranges[prototype_index];
+        range.first_primitive_index = instances[prototype_index].first_primitive_index;
+        range.primitive_count = instances[prototype_index].primitive_count;
+        range.placements.push_back(instance_index);
+    }
+
+    // Claims last one stroke
+    defer
+    {
+        for (auto range_index : claimed_ranges)
+            brush_range_owners[range_index] = BRUSH_RANGE_UNCLAIMED;
+    };
+
+    if (shared_ranges.empty())
+        return;
+
+    // Hits in a prototype range none of its hit placements claimed can't be told apart: the stroke is rejected
+    for (auto const &[prototype_index, range] : shared_ranges)
+    {
+        if (map_shared_range_hits(range, brush_range_owners) != BRUSH_RANGE_UNCLAIMED)
+            continue;
+#if WARN
+        std::cerr << " Brush hits of prototype: " << prototype_index << " map to none of its placements, stroke rejected" << std::endl;
+#endif // WARN
+        std::memset(instance_bitmask_buffer_ptr, 0, max_instance_bitmask_size);
+        std::memset(primitive_bitmask_buffer_ptr, 0, max_primitive_bitmask_size);
+        copy_buffer(instance_bitmask_staging_buffer, brush_instance_bitmask_buffer, 0, 0, max_instance_bitmask_size, false);
+        copy_buffer(primitive_bitmask_staging_buffer, brush_primitive_bitmask_buffer, 0, 0, max_primitive_bitmask_size);
+        brush_counters->instance_count = 0;
+        brush_counters->primitive_count = 0;
+        brush_counters->box_hit_count = 0;
+        return;
+    }
+
+    std::vector<u32> primitive_ids = {};
+
+    for (auto const &[prototype_index, range] : shared_ranges)
+    {
+        u32 owner_index = map_shared_range_hits(range, brush_range_owners);
+        get_range_hits(range, primitive_bitmask_buffer_ptr, primitive_ids);
+
+        // Every hit maps to the owner, the other placements keep drawing the prototype
+        for (auto instance_index : range.placements)
+        {
+            if (instance_index == owner_index)
+                continue;
+            instance_bitmask_buffer_ptr[instance_index >> 5] &= ~(1U << (instance_index & 31));
+            --brush_counters->instance_count;
+        }
+
+        // NOTE: allocate aligned to 32 elements
+        size_t primitive_buffer_offset = 0;
+        if (primitive_free_list->allocate(get_aligned(range.primitive_count, PRIMITIVE_ALIGNMENT), // size
+                                          primitive_buffer_offset, owner_index)
+                .is_invalid())
+        {
+#if WARN
+            std::cerr << " Could not allocate primitives to split instance: " << owner_index << " from prototype: " << prototype_index << std::endl;
+#endif // WARN
+            // The placement stays shared & its hits are dropped with the prototype range ones
+            instance_bitmask_buffer_ptr[owner_index >> 5] &= ~(1U << (owner_index & 31));
+            --brush_counters->instance_count;
+            continue;
+        }
+
+        // Copy prototype primitives to both buffers
+        for (u32 i = 0; i < DOUBLE_BUFFERING; i++)
+        {
+            copy_buffer(aabb_buffer[i], aabb_buffer[i], range.first_primitive_index * sizeof(AABB), primitive_buffer_offset * sizeof(AABB), range.primitive_count * sizeof(AABB), false);
+            copy_buffer(primitive_buffer[i], primitive_buffer[i], range.first_primitive_index * sizeof(PRIMITIVE), primitive_buffer_offset * sizeof(PRIMITIVE), range.primitive_count * sizeof(PRIMITIVE), false);
+            add_global_blas_info(i, range.primitive_count);
+        }
+
+        // Brush hits were recorded in the prototype range, move them to the new range
+        for (auto primitive_id : primitive_ids)
+        {
+            u32 new_primitive_index = primitive_buffer_offset + primitive_id;
+            primitive_bitmask_buffer_ptr[new_primitive_index >> 5] |= 1U << (new_primitive_index & 31);
+            ++brush_counters->primitive_count;
+        }
+
+        for (u32 i = 0; i < std::min(brush_counters->box_hit_count, MAX_BRUSH_BOX_HITS); i++)
+        {
+            u32 &primitive_index = brush_box_hits[i].primitive_index;
+            if (primitive_index >= range.first_primitive_index && primitive_index < range.first_primitive_index + range.primitive_count)
+                primitive_index = primitive_buffer_offset + primitive_index - range.first_primitive_index;
+        }
+
+        instances[owner_index].first_primitive_index = primitive_buffer_offset;
+        instances[owner_index].primitive_count = range.primitive_count;
+
+        // Keep drawing with the prototype BLAS until the instance is rebuilt
+        proc_blas.at(owner_index) = proc_blas.at(prototype_index);
+        shared_instances.at(owner_index).prototype_index = static_cast<u32>(-1);
+        shared_instances.at(owner_index).borrowed_blas = true;
+        --shared_instances.at(prototype_index).reference_count;
+
+#if DEBUG == 1
+        std::cout << "Instance: " << owner_index << " split from prototype: " << prototype_index << " primitives: " << range.primitive_count << " hits: " << primitive_ids.size() << std::endl;
+#endif // DEBUG
+    }
+
+    copy_buffer(instance_bitmask_staging_buffer, brush_instance_bitmask_buffer, 0, 0, max_instance_bitmask_size, false);
+
+    // Hits in the prototype ranges were moved (or dropped)
+    for (auto const &[prototype_index, range] : shared_ranges)
+    {
+        for (u32 i = 0; i < range.primitive_count; i++)
+        {
+            u32 primitive_index = range.first_primitive_index + i;
+            if (is_bit_set(primitive_bitmask_buffer_ptr, primitive_index))
+            {
+                primitive_bitmask_buffer_ptr[primitive_index >> 5] &= ~(1U << (primitive_index & 31));
+                --brush_counters->primitive_count;
+            }
+        }
+    }
+
+    copy_buffer(primitive_bitmask_staging_buffer, brush_primitive_bitmask_buffer, 0, 0, max_primitive_bitmask_size, false);
+
+    // The rearrangement compute reads the previous instances
+    for (u32 i = 0; i < DOUBLE_BUFFERING; i++)
+    {
+        upload_all_instances(i, i == DOUBLE_BUFFERING - 1);
+    }
+}
+
 void ACCEL_STRUCT_MNGR::check_voxel_modifications()
 {
     if (!device.is_valid() || !initialized)
@@ -2845,11 +3788,40 @@ void ACCEL_STRUCT_MNGR::check_voxel_modifications()
 
     if (is_idle())
     {
+#if MERGED_BOXES_ON == 1
+        // Hits on split merged boxes are deleted once every queued split is done
+        if (!split_hits.empty() && split_task_count == 0)
+            apply_split_hits();
+#endif // MERGED_BOXES_ON
+
         if (brush_counters->instance_count > 0)
         {
     #if TRACE == 1
             std::cout << "  Modifications instances: " << brush_counters->instance_count << " primitives: " << brush_counters->primitive_count << std::endl;
     #endif // TRACE
+
+            // Placements touched by the brush get their own copy of the prototype primitives
+            split_shared_instances();
+
+            // A rejected stroke has nothing left to delete
+            if (brush_counters->instance_count == 0)
+            {
+                brush_counters->primitive_count = 0;
+                brush_counters->box_hit_count = 0;
+                return;
+            }
+
+#if MERGED_BOXES_ON == 1
+            // Merged boxes touched by the brush are split first, the hits of their instances are set again once split
+            split_merged_primitives();
+            brush_counters->box_hit_count = 0;
+
+            if (brush_counters->primitive_count == 0)
+            {
+                brush_counters->instance_count = 0;
+                return;
+            }
+#endif // MERGED_BOXES_ON
             
             auto *indirect_buffer_ptr = device.get_host_address_as<u32>(brush_indirect_buffer).value();
 
@@ -2866,6 +3838,7 @@ void ACCEL_STRUCT_MNGR::check_voxel_modifications()
             // zero out brush counters
             brush_counters->instance_count = 0;
             brush_counters->primitive_count = 0;
+            brush_counters->box_hit_count = 0;
         }
     }
 }
\ No newline at end of file
@@ -2,9 +2,19 @@
 #pragma once
 #include "defines.h"
 #include "math.inl"
+#include "cpu/brick_primitives.hpp"
+#include "cpu/brush_hits.hpp"
+#if LIGHT_TREE_ON == 1
+#include "cpu/light_tree.hpp"
+#endif // LIGHT_TREE_ON
+#if LIGHT_ALIAS_TABLE_ON == 1
+#include "cpu/host_shading.hpp"
+#include "cpu/light_alias_table.hpp"
+#endif // LIGHT_ALIAS_TABLE_ON
 
 #include <queue>
 #include <stack>
+#include <map>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
@@ -19,7 +29,8 @@ struct ACCEL_STRUCT_MNGR
 {
 public:
 
-    constexpr static u32 PRIMITIVE_ALIGNMENT = 32;
+    // The brush claims primitive ranges by their start
+    constexpr static u32 PRIMITIVE_ALIGNMENT = BRUSH_RANGE_ALIGNMENT;
 
     enum class AS_MANAGER_STATUS
     {
@@ -47,6 +58,8 @@ public:
             UPDATE_BLAS_FROM_CPU,
             DELETE_PRIMITIVE_BLAS_FROM_GPU,
             UNDO_OP_CPU,
+            SPLIT_PRIMITIVE_BLAS_FROM_GPU,
+            INSTANCE_BLAS_FROM_CPU,
         };
 
         struct BLAS_UPDATE
@@ -74,12 +87,35 @@ public:
             u32 del_prim_count;
         };
 
+        // Merged boxes hit by the brush are replaced by their voxels.
+        // The first voxel of each box takes the box slot, the rest are appended to the instance.
+        struct BLAS_SPLIT_PRIM_FROM_GPU
+        {
+            u32 instance_index;
+            u32 split_count;
+            u32 voxel_count;
+            u32 host_buffer_offset;
+            u32 previous_primitive_count;
+            u32* primitive_indices;
+        };
+
         struct BLAS_BUILD_FROM_CPU
         {
             u32 instance_count;
             u32 primitive_count;
             daxa_f32mat4x4 transform;
             u32* instance_indices;
+            // Registered model (0 if not shared): instances become hidden prototypes placed with INSTANCE_BLAS_FROM_CPU
+            u32 model_index;
+        };
+
+        // New placement of a registered model, it references the BLAS & primitives of the model prototypes
+        struct BLAS_INSTANCE_FROM_CPU
+        {
+            u32 model_index;
+            daxa_f32mat4x4 transform;
+            u32 instance_count;
+            u32* instance_indices;
         };
 
         struct BLAS_DELETE_FROM_CPU
@@ -103,6 +139,8 @@ public:
             BLAS_DELETE_FROM_CPU blas_delete_from_cpu;
             BLAS_UPDATE blas_update;
             UNDO_OP_CPU undo_op_cpu;
+            BLAS_SPLIT_PRIM_FROM_GPU blas_split_prim_gpu;
+            BLAS_INSTANCE_FROM_CPU blas_instance_from_cpu;
         };
     };
 
@@ -316,6 +354,36 @@ public:
 
     daxa::BufferId get_brush_primitive_bitmask_buffer() const { return brush_primitive_bitmask_buffer; }
 
+    daxa::BufferId get_brush_range_owner_buffer() const { return brush_range_owner_buffer; }
+
+    daxa::BufferId get_brush_box_hit_buffer() const { return brush_box_hit_buffer; }
+
+#if BRICK_PRIMITIVES_ON == 1
+    daxa::BufferId get_brick_buffer() const { return brick_buffer; }
+
+    BRICK* get_bricks() const { return bricks; }
+#endif // BRICK_PRIMITIVES_ON
+
+#if LIGHT_TREE_ON == 1
+    daxa::BufferId get_light_tree_buffer() const { return light_tree_buffer; }
+
+    daxa::BufferId get_light_tree_leaf_buffer() const { return light_tree_leaf_buffer; }
+
+    LightTree const &get_light_tree() const { return light_tree; }
+
+    // Rebuilds the tree when lights were loaded or too many were deleted since the last build
+    bool update_light_tree(u32 cube_light_count);
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+    daxa::BufferId get_light_alias_buffer() const { return light_alias_buffer; }
+
+    LightAliasTable const &get_light_alias_table() const { return light_alias_table; }
+
+    // Rebuilds the table when lights were loaded, deleted or restored since the last build
+    bool update_light_alias_table(u32 cube_light_count);
+#endif // LIGHT_ALIAS_TABLE_ON
+
 
 
     bool task_queue_add(TASK task) {
@@ -323,12 +391,85 @@ public:
         // Check if the task is valid before pushing it to the queue
         task_queue.push(task);
         if(task.type == TASK::TYPE::BUILD_BLAS_FROM_CPU) {
-            temp_instance_count++;
+            temp_instance_count += task.blas_build_from_cpu.instance_count;
             temp_primitive_count+= task.blas_build_from_cpu.primitive_count;
         }
         return true;
     }
 
+    // Reserve the host staging ranges of an instance parsed elsewhere and queue its build in one step,
+    // so loaders delivering concurrently never write over each other's ranges.
+    // NOTE: must not be called while the worker thread is updating (same as the rest of the host staging)
+    // With BRICK_PRIMITIVES_ON the voxels are packed into bricks and voxel_ids (if given) gets the packed
+    // primitive id of every input primitive.
+    bool task_queue_add_instance(INSTANCE instance, AABB const *instance_aabbs, PRIMITIVE const *instance_primitives,
+                                 daxa_f32mat4x4 transform, u32 &host_instance_index, u32 model_index = 0,
+                                 std::vector<u32> *voxel_ids = nullptr)
+    {
+#if BRICK_PRIMITIVES_ON == 1
+        // Packed before locking, the BLAS primitives are the brick AABBs
+        HostBrickPrimitives instance_bricks = {};
+        instance_bricks.build(instance_aabbs, instance_primitives, instance.primitive_count);
+        instance.primitive_count = static_cast<u32>(instance_bricks.aabbs.size());
+        instance_aabbs = instance_bricks.aabbs.data();
+#else
+        (void)voxel_ids;
+#endif // BRICK_PRIMITIVES_ON
+
+        std::unique_lock lock(task_queue_mutex);
+
+        u32 primitive_count = instance.primitive_count;
+        if ((temp_instance_count + 1) * sizeof(INSTANCE) > max_instance_buffer_size ||
+            (temp_primitive_count + primitive_count) * sizeof(AABB) > max_aabb_host_buffer_size)
+        {
+#if WARN
+            std::cerr << " Not enough host memory to queue instance with " << primitive_count << " primitives" << std::endl;
+#endif // WARN
+            return false;
+        }
+
+#if BRICK_PRIMITIVES_ON == 1
+        if (brick_count + primitive_count > MAX_BRICKS)
+        {
+#if WARN
+            std::cerr << " Not enough brick memory to queue instance with " << primitive_count << " bricks" << std::endl;
+#endif // WARN
+            return false;
+        }
+#endif // BRICK_PRIMITIVES_ON
+
+        host_instance_index = temp_instance_count;
+        instance.first_primitive_index = temp_primitive_count;
+
+        std::memcpy(get_aabb_host_address() + temp_primitive_count, instance_aabbs, primitive_count * sizeof(AABB));
+#if BRICK_PRIMITIVES_ON == 1
+        // The primitive of a brick AABB holds its staged brick until the instance is built & gets its slots
+        u32 first_temp_brick = static_cast<u32>(temp_bricks.size());
+        temp_bricks.insert(temp_bricks.end(), instance_bricks.bricks.begin(), instance_bricks.bricks.end());
+        for (u32 i = 0; i < primitive_count; ++i)
+            primitives[temp_primitive_count + i] = PRIMITIVE{.material_index = first_temp_brick + i,
+                                                             .light_index = static_cast<u32>(-1)};
+        brick_count += primitive_count;
+        if (voxel_ids)
+            *voxel_ids = std::move(instance_bricks.voxel_ids);
+#else
+        std::memcpy(primitives.get() + temp_primitive_count, instance_primitives, primitive_count * sizeof(PRIMITIVE));
+#endif // BRICK_PRIMITIVES_ON
+        temp_instances[host_instance_index] = instance;
+
+        task_queue.push(TASK{
+            .type = TASK::TYPE::BUILD_BLAS_FROM_CPU,
+            .blas_build_from_cpu = {.instance_count = 1,
+                                    .primitive_count = primitive_count,
+                                    .transform = transform,
+                                    .model_index = model_index},
+        });
+        temp_instance_count += 1;
+        temp_primitive_count += primitive_count;
+
+        return true;
+    }
+
     bool update_scene(bool synchronize = false)
     {
         if (!initialized)
@@ -504,8 +645,19 @@ private:
 
     // Checking modification operations
     void process_voxel_modifications();
+    void split_merged_primitives();
+    void split_shared_instances();
+    void apply_split_hits();
 
     bool delete_blas_process(TASK& task, u32 next_index, std::vector<u32>& delete_blas_index_list);
+    bool instance_blas_process(TASK& task, u32 next_index);
+
+    // Placements use the BLAS of their prototype
+    daxa::BlasId get_instance_blas(u32 instance_index) const
+    {
+        u32 prototype_index = shared_instances.at(instance_index).prototype_index;
+        return proc_blas.at(prototype_index != static_cast<u32>(-1) ? prototype_index : instance_index);
+    }
 
     // Deleting operations
     void copy_buffer(daxa::BufferId src_primitive_buffer, daxa::BufferId dst_primitive_buffer, 
@@ -522,6 +674,7 @@ private:
     // Updating operations
     bool update_aabb_device_buffer(u32 buffer_index, u32 instance_index, u32 primitive_count, u32 indices_buffer_offset, u32 aabb_buffer_offset);
     bool copy_updated_aabb_device_buffer(u32 buffer_index, u32 instance_index, u32 primitive_count, u32 indices_buffer_offset, u32 aabb_buffer_offset);
+    bool split_aabb_device_buffer(u32 buffer_index, TASK& task);
 
     // Switching operations
     bool upload_aabb_device_buffer(u32 buffer_index, u32 aabb_host_count, u32 host_buffer_offset_count, u32 buffer_offset_count);
@@ -565,6 +718,31 @@ private:
     daxa::TlasId tlas[DOUBLE_BUFFERING] = {};
     std::vector<daxa::TlasId> temp_proc_tlas = {};
     std::vector<daxa::BlasId> proc_blas = {}, temp_proc_blas = {};
+
+    // Shared BLAS instancing
+    struct SHARED_INSTANCE
+    {
+        // Prototype owning the BLAS & primitives of this placement (-1 if the instance owns them)
+        u32 prototype_index = static_cast<u32>(-1);
+        // Placements referencing this prototype
+        u32 reference_count = 0;
+        // Registered model of a prototype
+        u32 model_index = 0;
+        // Prototypes are not part of the TLAS
+        bool is_prototype = false;
+        // proc_blas holds the prototype BLAS until the instance builds its own (copy-on-write split)
+        bool borrowed_blas = false;
+#if BRICK_PRIMITIVES_ON == 1
+        // Brick slots of the instance in brick_free_list, placements & split copies use the slots of their prototype
+        VoxelBuffer brick_range = {};
+        u32 brick_count = 0;
+#endif // BRICK_PRIMITIVES_ON
+    };
+    std::vector<SHARED_INSTANCE> shared_instances = {};
+    // model index -> prototype instances (one per gvox region)
+    std::map<u32, std::vector<u32>> model_prototypes = {};
+    // Placements changed but no BLAS was (re)built, the TLAS still has to be rebuilt
+    bool tlas_dirty = false;
     daxa::BufferId proc_blas_scratch_buffer = {};
     u64 proc_blas_scratch_buffer_offset = 0;
     u32 acceleration_structure_scratch_offset_alignment = 0;
@@ -634,6 +812,7 @@ private:
 
     size_t max_instance_bitmask_size = 0;
     size_t max_primitive_bitmask_size = 0;
+    size_t max_brush_range_owner_size = 0;
 
     u32 *current_cube_light_count = nullptr;
     u32 temp_cube_light_count = 0;
@@ -641,15 +820,69 @@ private:
     daxa::BufferId cube_light_buffer = {};
     LIGHT *cube_lights = nullptr;
 
+#if BRICK_PRIMITIVES_ON == 1
+    // Bricks of the queued instances, copied to their slots when the instances are built
+    std::vector<BRICK> temp_bricks = {};
+    // Slots of the built & queued instances, an instance that doesn't fit in MAX_BRICKS is not queued
+    u32 brick_count = 0;
+    // A brick primitive keeps its slot when it's copied or rearranged, the slots of a deleted instance are
+    // released once the TLAS without it is in use (like its BLAS)
+    std::unique_ptr<gpu_free_list<VoxelBuffer, gpu_allocator<VoxelBuffer>>> brick_free_list = nullptr;
+    u64 next_brick_range = 0;
+    std::vector<std::pair<VoxelBuffer, u32>> temp_brick_ranges = {};
+    daxa::BufferId brick_buffer = {};
+    BRICK *bricks = nullptr;
+#endif // BRICK_PRIMITIVES_ON
+
+#if LIGHT_TREE_ON == 1
+    // Built from cube_lights, deleted lights are refit & restored with backup_cube_lights
+    LightTree light_tree = {};
+    u32 light_tree_light_count = 0;
+    daxa::BufferId light_tree_buffer = {};
+    daxa::BufferId light_tree_leaf_buffer = {};
+    LIGHT_TREE_NODE *light_tree_nodes = nullptr;
+    daxa_u32 *light_tree_leaves = nullptr;
+
+    auto get_cube_light_tree_bounds(LIGHT const &light) const -> LightBounds;
+#endif // LIGHT_TREE_ON
+
+#if LIGHT_ALIAS_TABLE_ON == 1
+    // Built from cube_lights, an index swap moves power between entries so deletions & restorations rebuild it
+    LightAliasTable light_alias_table = {};
+    std::vector<float> light_alias_weights = {};
+    u32 light_alias_light_count = 0;
+    bool light_alias_dirty = false;
+    daxa::BufferId light_alias_buffer = {};
+    LIGHT_ALIAS *light_alias_entries = nullptr;
+#endif // LIGHT_ALIAS_TABLE_ON
+
     // Modification buffer
     daxa::BufferId brush_counter_buffer = {};
     daxa::BufferId brush_instance_bitmask_buffer = {};
     daxa::BufferId brush_primitive_bitmask_buffer = {};
+    // Instance claiming each primitive range in the stroke (brush_hits.hpp), released once the stroke is processed
+    daxa::BufferId brush_range_owner_buffer = {};
     daxa::BufferId brush_indirect_buffer = {};
     // TODO: TEST
     daxa::BufferId test_brush_primitive_buffer = {};
 
     BRUSH_COUNTER* brush_counters = nullptr;
+    u32* brush_range_owners = nullptr;
+
+    // Hit positions on merged boxes in the stroke (brush_hits.hpp)
+    daxa::BufferId brush_box_hit_buffer = {};
+    BRUSH_BOX_HIT* brush_box_hits = nullptr;
+
+    // Hits of an instance whose merged boxes are being split, set again once the split is done
+    struct SPLIT_HITS
+    {
+        u32 instance_index;
+        u32 primitive_count; // once split
+        std::vector<u32> primitive_ids;
+    };
+    std::vector<SPLIT_HITS> split_hits = {};
+    // Split tasks queued & not done yet (done or failed)
+    std::atomic<u32> split_task_count = 0;
     
     u32 backup_primitive_count = 0;
     std::vector<PRIMITIVE> backup_primitives = {};
@@ -0,0 +1,534 @@
+// Adaptive sampling benchmark & checks.
+// Renders a scene of mixed difficulty (sky, a sunlit yard & a shed lit by one small light through its door) with the
+// progressive renderer of adaptive_sampling.hpp, one sample per active pixel per frame as rgen.glsl does, once with
+// every pixel sampled every frame (uniform) and once skipping the tiles whose predicted relMSE is below the threshold.
+// Both are compared with a converged reference whose samples neither uses; the rays each needs to reach the same
+// relMSE give the rays saved at equal error.
+// --verify N checks the estimator & scheduler on the host: the running mean & second moment against a two pass
+// computation of N random sequences, resets, the bounds & fixed point of the errors, border tiles, the decision rules,
+// the predicted error against the error measured on the reference, skipped pixels left untouched, tile sums matching
+// their pixels, camera moves sampling everything again and frames independent of the thread count. The exit code is
+// not 0 when one fails, or in the default mode when adaptive sampling doesn't save rays at equal error.
+//
+// usage: adaptive_sampling_bench [--verify N] [--frames N] [--width N] [--height N] [--reference-spp N]
+//                                [--threshold F] [--threads N] [--json out.json]
+
+#include "bench_common.hpp"
+#include "bench_scene.hpp"
+#include "host_accel.hpp"
+#include "image_metrics.hpp"
+#include "adaptive_sampling.hpp"
+#include "sampler.hpp"
+
+//////////////////////////////// SCENE //////////////////////////////////////
+
+enum YardMaterial : uint32_t
+{
+    YARD_WHITE,
+    YARD_GREEN,
+    YARD_RED,
+    YARD_LIGHT,
+    YARD_MATERIAL_COUNT,
+};
+
+static constexpr uint32_t YARD_VOXELS = 32;
+static constexpr uint32_t SHED_MIN = 10;
+static constexpr uint32_t SHED_MAX = 22;
+static constexpr uint32_t SHED_HEIGHT = 8;
+
+// A yard under the sky (converges in a few samples), a closed shed with a door facing the camera and a single small
+// light inside (noisy) and red blocks whose shadows are in between
+static void build_yard(HostScene &scene)
+{
+    GvoxRegionChunk chunk = {};
+    chunk.materials.resize(YARD_MATERIAL_COUNT);
+    chunk.materials[YARD_WHITE] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.73f));
+    chunk.materials[YARD_GREEN] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.2f, 0.45f, 0.15f));
+    chunk.materials[YARD_RED] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.65f, 0.1f, 0.08f));
+    chunk.materials[YARD_LIGHT] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.8f), glm::vec3(60.0f, 52.0f, 40.0f));
+
+    for (uint32_t z = 0; z < YARD_VOXELS; ++z)
+        for (uint32_t x = 0; x < YARD_VOXELS; ++x)
+            add_voxel(chunk, x, 0, z, YARD_GREEN);
+
+    // Walls & roof of the shed, the door is the middle of its front wall
+    for (uint32_t y = 1; y <= SHED_HEIGHT; ++y)
+        for (uint32_t a = SHED_MIN; a < SHED_MAX; ++a)
+        {
+            add_voxel(chunk, a, y, SHED_MIN, YARD_WHITE);
+            add_voxel(chunk, SHED_MIN, y, a, YARD_WHITE);
+            add_voxel(chunk, SHED_MAX - 1, y, a, YARD_WHITE);
+            bool door = y <= SHED_HEIGHT - 2 && a > SHED_MIN + 2 && a < SHED_MAX - 3;
+            if (!door)
+                add_voxel(chunk, a, y, SHED_MAX - 1, YARD_WHITE);
+        }
+    for (uint32_t z = SHED_MIN; z < SHED_MAX; ++z)
+        for (uint32_t x = SHED_MIN; x < SHED_MAX; ++x)
+            add_voxel(chunk, x, SHED_HEIGHT + 1, z, YARD_WHITE);
+    add_voxel(chunk, SHED_MIN + 2, SHED_HEIGHT - 1, SHED_MIN + 2, YARD_LIGHT);
+
+    // Blocks in front of the shed
+    for (uint32_t y = 1; y < 4; ++y)
+        for (uint32_t z = 25; z < 27; ++z)
+        {
+            for (uint32_t x = 4; x < 6; ++x)
+                add_voxel(chunk, x, y, z, YARD_RED);
+            for (uint32_t x = 26; x < 28; ++x)
+                add_voxel(chunk, x, y, z, YARD_RED);
+        }
+
+    add_centered_chunk(scene, chunk, YARD_VOXELS, 4.0f);
+    add_sky(scene, 4.0f);
+}
+
+// Camera in front of the shed door, the sky above the yard fills the top of the image
+static HostCamera frame_yard(HostScene const &scene, uint32_t width, uint32_t height, float yaw = 0.0f)
+{
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = (scene.bounds_max.x - scene.bounds_min.x) * 0.5f;
+    glm::vec3 target = glm::vec3(center.x, scene.bounds_min.y + radius * 0.3f, center.z);
+    return get_host_camera(width, height, target + glm::vec3(std::sin(yaw), 0.25f, std::cos(yaw)) * (radius * 1.6f), target);
+}
+
+//////////////////////////////// BENCH //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t width = 96;
+    uint32_t height = 64;
+    uint32_t reference_spp = 2048;
+    uint32_t frame_count = 256;
+    float error_threshold = ADAPTIVE_ERROR_THRESHOLD;
+    uint32_t thread_count = 0;
+};
+
+// Error & cost of a renderer once a frame is done
+struct FramePoint
+{
+    uint32_t frame = 0;
+    uint64_t ray_count = 0; // since the first frame
+    uint32_t active_pixel_count = 0;
+    double rel_mse = 0.0;
+    double predicted_rel_mse = 0.0; // mean predicted relMSE of the pixels
+};
+
+struct RunResult
+{
+    std::vector<FramePoint> points = {};
+    double ms = 0.0;
+};
+
+struct BenchResult
+{
+    uint32_t primitive_count = 0;
+    double reference_ms = 0.0;
+    RunResult uniform = {};
+    RunResult adaptive = {};
+    double target_rel_mse = 0.0;
+    double uniform_rays = 0.0; // rays to reach target_rel_mse
+    double adaptive_rays = 0.0;
+};
+
+static ReferenceSettings get_reference_settings(uint32_t width, uint32_t height)
+{
+    ReferenceSettings reference_settings = {};
+    reference_settings.width = width;
+    reference_settings.height = height;
+    reference_settings.max_depth = 3;
+    // Pixel centers & the sampler of the shaders
+    reference_settings.sampler_type = SAMPLER_TYPE;
+    return reference_settings;
+}
+
+static double get_mean(std::vector<float> const &values)
+{
+    double sum = 0.0;
+    for (float value : values)
+        sum += value;
+    return values.empty() ? 0.0 : sum / static_cast<double>(values.size());
+}
+
+// Error after every frame that is a power of two or a multiple of 32
+static RunResult run_frames(ReferenceTracer const &tracer, HostCamera const &camera, AdaptiveSettings const &adaptive_settings,
+                            std::vector<glm::vec3> const &reference, uint32_t frame_count, TilePool &pool)
+{
+    uint32_t width = tracer.get_settings().width, height = tracer.get_settings().height;
+    AdaptiveRenderer renderer(tracer, adaptive_settings);
+    RunResult result = {};
+    uint64_t ray_count = 0;
+    std::vector<glm::vec3> image = {};
+    std::vector<float> errors = {};
+    double ms = 0.0;
+
+    for (uint32_t frame = 1; frame <= frame_count; ++frame)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        AdaptiveFrameStats stats = renderer.frame(camera, pool);
+        ms += elapsed_ms(start);
+        ray_count += stats.ray_count;
+
+        if ((frame & (frame - 1)) != 0 && frame % 32 != 0 && frame != frame_count)
+            continue;
+        renderer.get_image(image);
+        renderer.get_error_image(errors);
+        result.points.push_back(FramePoint{
+            .frame = frame,
+            .ray_count = ray_count,
+            .active_pixel_count = stats.active_pixel_count,
+            .rel_mse = compare_images(reference, image, width, height, pool).rel_mse,
+            .predicted_rel_mse = get_mean(errors),
+        });
+    }
+    result.ms = ms;
+    return result;
+}
+
+static std::vector<ConvergencePoint> get_ray_curve(RunResult const &run)
+{
+    std::vector<ConvergencePoint> curve = {};
+    for (FramePoint const &point : run.points)
+    {
+        ConvergencePoint convergence = {.cost = static_cast<double>(point.ray_count)};
+        convergence.metrics.rel_mse = point.rel_mse;
+        curve.push_back(convergence);
+    }
+    return curve;
+}
+
+static BenchResult measure(BenchSettings const &settings, TilePool &pool)
+{
+    HostScene scene = {};
+    build_yard(scene);
+    HostAccel accel = {};
+    accel.build(scene, pool);
+    HostCamera camera = frame_yard(scene, settings.width, settings.height);
+
+    BenchResult result = {};
+    result.primitive_count = scene.get_primitive_count();
+
+    // The reference starts far past the frames of the test images
+    ReferenceSettings reference_settings = get_reference_settings(settings.width, settings.height);
+    reference_settings.samples_per_pixel = settings.reference_spp;
+    reference_settings.first_sample = 1U << 20;
+    std::vector<glm::vec3> reference = {};
+    result.reference_ms = ReferenceTracer(accel, reference_settings).render(camera, pool, reference).render_ms;
+
+    ReferenceTracer tracer(accel, get_reference_settings(settings.width, settings.height));
+    result.uniform = run_frames(tracer, camera, AdaptiveSettings{.adaptive = false}, reference, settings.frame_count, pool);
+    result.adaptive = run_frames(tracer, camera, AdaptiveSettings{.error_threshold = settings.error_threshold}, reference, settings.frame_count, pool);
+
+    // Lowest error both reach
+    result.target_rel_mse = std::max(result.uniform.points.back().rel_mse, result.adaptive.points.back().rel_mse);
+    result.uniform_rays = get_time_to_error(get_ray_curve(result.uniform), result.target_rel_mse);
+    result.adaptive_rays = get_time_to_error(get_ray_curve(result.adaptive), result.target_rel_mse);
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static bool verify(uint32_t trial_count, uint32_t thread_count)
+{
+    BenchCheck moment_check = {.name = "running mean & moment match two passes"};
+    BenchCheck reset_check = {.name = "reset starts the statistics over"};
+    BenchCheck error_check = {.name = "pixel errors bounded & in fixed point"};
+    BenchCheck tile_check = {.name = "tile indices & border tile sizes"};
+    BenchCheck decision_check = {.name = "pixels stop on converged tiles only"};
+    BenchCheck calibration_check = {.name = "predicted relMSE within 2x of the measured one"};
+    BenchCheck skip_check = {.name = "skipped pixels untouched, tile sums match their pixels"};
+    BenchCheck move_check = {.name = "camera moves sample every pixel again"};
+    BenchCheck thread_check = {.name = "frames independent of the thread count"};
+
+    BenchRandom random = {};
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        // A sequence of 2 to 300 colors, some with rare bright outliers
+        uint32_t count = 2 + random.next_below(299);
+        float scale = 0.01f + random.next_float() * 10.0f;
+        bool fireflies = random.next_below(2) == 0;
+        std::vector<glm::vec3> colors(count);
+        for (auto &color : colors)
+        {
+            color = glm::vec3(random.next_float(), random.next_float(), random.next_float()) * scale;
+            if (fireflies && random.next_below(64) == 0)
+                color *= 50.0f;
+        }
+
+        ADAPTIVE_PIXEL pixel = {};
+        for (uint32_t i = 0; i < count; ++i)
+            host_adaptive_add_sample(pixel, colors[i], false);
+
+        double mean[3] = {}, moment = 0.0;
+        for (auto const &color : colors)
+        {
+            for (int c = 0; c < 3; ++c)
+                mean[c] += color[c];
+            double luminance = host_adaptive_get_luminance(color);
+            moment += luminance * luminance;
+        }
+        for (int c = 0; c < 3; ++c)
+            mean[c] /= static_cast<double>(count);
+        moment /= static_cast<double>(count);
+        double mean_luminance = 0.2126 * mean[0] + 0.7152 * mean[1] + 0.0722 * mean[2];
+        double variance = 0.0;
+        for (auto const &color : colors)
+        {
+            double d = host_adaptive_get_luminance(color) - mean_luminance;
+            variance += d * d;
+        }
+        variance /= static_cast<double>(count - 1);
+        double error = std::min(variance / count / (mean_luminance * mean_luminance + ADAPTIVE_LUMINANCE_EPSILON), 1.0);
+
+        moment_check.add(pixel.sample_count == count);
+        moment_check.add(is_close(pixel.mean.x, mean[0], 1e-4) && is_close(pixel.mean.y, mean[1], 1e-4) && is_close(pixel.mean.z, mean[2], 1e-4));
+        moment_check.add(is_close(pixel.luminance_moment, moment, 1e-4));
+        // The one pass variance loses digits when it's small against the mean
+        moment_check.add(std::abs(host_adaptive_get_pixel_error(pixel) - error) <= 1e-4 * error + 1e-6);
+        error_check.add(host_adaptive_get_pixel_error(pixel) <= 1.0f);
+
+        glm::vec3 color = colors[random.next_below(count)];
+        host_adaptive_add_sample(pixel, color, true);
+        float luminance = host_adaptive_get_luminance(color);
+        reset_check.add(pixel.sample_count == 1 && to_glm(pixel.mean) == color && pixel.luminance_moment == luminance * luminance);
+        reset_check.add(host_adaptive_get_pixel_error(pixel) == 1.0f);
+
+        // Constant sequences have no error, a lone firefly over black samples nearly the most a mean of non negative
+        // samples can have (1)
+        ADAPTIVE_PIXEL constant = {};
+        uint32_t constant_count = 1 + random.next_below(64);
+        for (uint32_t i = 0; i < constant_count; ++i)
+            host_adaptive_add_sample(constant, glm::vec3(scale), false);
+        error_check.add(constant.sample_count < 2 ? host_adaptive_get_pixel_error(constant) == 1.0f : host_adaptive_get_pixel_error(constant) < 1e-6f);
+        ADAPTIVE_PIXEL spike = {};
+        host_adaptive_add_sample(spike, glm::vec3(0.0f), false);
+        host_adaptive_add_sample(spike, glm::vec3(0.0f), false);
+        host_adaptive_add_sample(spike, glm::vec3(100.0f * scale), false);
+        error_check.add(host_adaptive_get_pixel_error(spike) > 0.9f && host_adaptive_get_pixel_error(spike) <= 1.0f);
+        float value = random.next_float();
+        error_check.add(host_adaptive_get_error_bits(value) == static_cast<uint32_t>(value * ADAPTIVE_ERROR_SCALE));
+        error_check.add(host_adaptive_get_error_bits(2.0f) == static_cast<uint32_t>(ADAPTIVE_ERROR_SCALE) && host_adaptive_get_error_bits(-1.0f) == 0);
+
+        // Border tiles hold what's left of the image, sums of full tiles of clamped errors stay below 2^32
+        uint32_t width = 1 + random.next_below(300), height = 1 + random.next_below(300);
+        uint32_t x = random.next_below(width), y = random.next_below(height);
+        uint32_t tiles_x = (width + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE;
+        uint32_t tile_width = std::min<uint32_t>(ADAPTIVE_TILE_SIZE, width - (x / ADAPTIVE_TILE_SIZE) * ADAPTIVE_TILE_SIZE);
+        uint32_t tile_height = std::min<uint32_t>(ADAPTIVE_TILE_SIZE, height - (y / ADAPTIVE_TILE_SIZE) * ADAPTIVE_TILE_SIZE);
+        tile_check.add(host_adaptive_get_tile_index(x, y, width) == (y / ADAPTIVE_TILE_SIZE) * tiles_x + x / ADAPTIVE_TILE_SIZE);
+        tile_check.add(host_adaptive_get_tile_pixel_count(x, y, width, height) == tile_width * tile_height);
+        uint32_t pixel_count = tile_width * tile_height;
+        tile_check.add(host_adaptive_get_tile_error(host_adaptive_get_error_bits(1.0f) * pixel_count, pixel_count) == 1.0f);
+        tile_check.add(static_cast<double>(ADAPTIVE_ERROR_SCALE) * ADAPTIVE_TILE_SIZE * ADAPTIVE_TILE_SIZE < 4294967296.0);
+
+        // Decision rules
+        uint32_t sample_count = random.next_below(2 * ADAPTIVE_MIN_SAMPLES);
+        float tile_error = random.next_float() * 2.0f * ADAPTIVE_ERROR_THRESHOLD;
+        uint64_t frames = random.next_below(3);
+        bool expected = frames == 0 || sample_count < ADAPTIVE_MIN_SAMPLES || tile_error > ADAPTIVE_ERROR_THRESHOLD;
+        decision_check.add(host_adaptive_is_pixel_active(sample_count, tile_error, frames) == expected);
+    }
+
+    // Renders on the scene of the bench
+    TilePool one_thread(1);
+    TilePool pool(thread_count);
+    HostScene scene = {};
+    build_yard(scene);
+    HostAccel accel = {};
+    accel.build(scene, pool);
+    uint32_t width = 44, height = 30; // border tiles on both axes
+    HostCamera camera = frame_yard(scene, width, height);
+    ReferenceTracer tracer(accel, get_reference_settings(width, height));
+
+    // Mean predicted error of uniform frames against the relMSE of their mean: the prediction is in luminance, the
+    // measure is per channel, both hold the same variance of the mean
+    {
+        ReferenceSettings reference_settings = get_reference_settings(width, height);
+        reference_settings.samples_per_pixel = 2048;
+        reference_settings.first_sample = 1U << 20;
+        std::vector<glm::vec3> reference = {};
+        ReferenceTracer(accel, reference_settings).render(camera, pool, reference);
+        RunResult run = run_frames(tracer, camera, AdaptiveSettings{.adaptive = false}, reference, 128, pool);
+        for (FramePoint const &point : run.points)
+        {
+            if (point.frame < 16)
+                continue;
+            double ratio = point.predicted_rel_mse / point.rel_mse;
+            calibration_check.add(ratio > 0.5 && ratio < 2.0);
+        }
+    }
+
+    // Frames step by step: pixels whose tile converged keep their statistics & every written sum is its pixels' sum
+    {
+        AdaptiveRenderer renderer(tracer, AdaptiveSettings{.min_samples = 4, .error_threshold = 4e-3f});
+        uint32_t skipped_total = 0;
+        for (uint32_t frame = 0; frame < 48; ++frame)
+        {
+            std::vector<ADAPTIVE_PIXEL> before = renderer.get_pixels();
+            std::vector<ADAPTIVE_TILE> tiles_before = renderer.get_tiles();
+            uint32_t read_slot = (frame + ADAPTIVE_ERROR_SLOTS - 1) % ADAPTIVE_ERROR_SLOTS;
+            uint32_t write_slot = frame % ADAPTIVE_ERROR_SLOTS;
+
+            AdaptiveFrameStats stats = renderer.frame(camera, pool);
+            std::vector<ADAPTIVE_PIXEL> const &after = renderer.get_pixels();
+            uint32_t active_count = 0;
+            std::vector<uint32_t> sums(renderer.get_tile_count(), 0);
+            for (uint32_t y = 0; y < height; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    size_t i = static_cast<size_t>(y) * width + x;
+                    uint32_t tile = host_adaptive_get_tile_index(x, y, width);
+                    float tile_error = host_adaptive_get_tile_error(tiles_before[tile].error_sums[read_slot], host_adaptive_get_tile_pixel_count(x, y, width, height));
+                    bool active = host_adaptive_is_pixel_active(before[i].sample_count, tile_error, frame, 4, 4e-3f);
+                    bool untouched = std::memcmp(&before[i], &after[i], sizeof(ADAPTIVE_PIXEL)) == 0;
+                    skip_check.add(active ? after[i].sample_count == (frame == 0 ? 1 : before[i].sample_count + 1) : untouched);
+                    active_count += active ? 1 : 0;
+                    sums[tile] += host_adaptive_get_error_bits(host_adaptive_get_pixel_error(after[i]));
+                }
+            skip_check.add(stats.active_pixel_count == active_count);
+            for (uint32_t tile = 0; tile < renderer.get_tile_count(); ++tile)
+                skip_check.add(renderer.get_tiles()[tile].error_sums[write_slot] == sums[tile] &&
+                               renderer.get_tiles()[tile].error_sums[(frame + 1) % ADAPTIVE_ERROR_SLOTS] == 0);
+            skipped_total += width * height - active_count;
+        }
+        // The sky converges, without skipped pixels the checks above prove nothing
+        skip_check.add(skipped_total > 0);
+
+        // A camera move resets every pixel even on converged tiles
+        renderer.reset();
+        HostCamera moved = frame_yard(scene, width, height, 0.3f);
+        AdaptiveFrameStats stats = renderer.frame(moved, pool);
+        move_check.add(stats.active_pixel_count == width * height);
+        for (ADAPTIVE_PIXEL const &pixel : renderer.get_pixels())
+            move_check.add(pixel.sample_count == 1);
+        stats = renderer.frame(moved, pool);
+        move_check.add(stats.active_pixel_count == width * height);
+    }
+
+    // Same bits with one thread as with the pool
+    {
+        AdaptiveRenderer a(tracer), b(tracer);
+        for (uint32_t frame = 0; frame < 40; ++frame)
+        {
+            AdaptiveFrameStats stats_a = a.frame(camera, one_thread);
+            AdaptiveFrameStats stats_b = b.frame(camera, pool);
+            thread_check.add(stats_a.active_pixel_count == stats_b.active_pixel_count && stats_a.ray_count == stats_b.ray_count);
+        }
+        thread_check.add(std::memcmp(a.get_pixels().data(), b.get_pixels().data(), a.get_pixels().size() * sizeof(ADAPTIVE_PIXEL)) == 0);
+        thread_check.add(std::memcmp(a.get_tiles().data(), b.get_tiles().data(), a.get_tiles().size() * sizeof(ADAPTIVE_TILE)) == 0);
+    }
+
+    return report_checks<BenchCheck>({&moment_check, &reset_check, &error_check, &tile_check, &decision_check, &calibration_check, &skip_check, &move_check, &thread_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static bool is_passing(BenchResult const &result)
+{
+    return result.uniform_rays > 0.0 && result.adaptive_rays > 0.0 && result.adaptive_rays < result.uniform_rays;
+}
+
+static double get_rays_saved(BenchResult const &result)
+{
+    return result.uniform_rays > 0.0 ? 1.0 - result.adaptive_rays / result.uniform_rays : 0.0;
+}
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    auto write_run = [&](char const *name, RunResult const &run)
+    {
+        out << "  \"" << name << "\": {\"ms\": " << run.ms << ", \"points\": [";
+        for (size_t p = 0; p < run.points.size(); ++p)
+        {
+            FramePoint const &point = run.points[p];
+            out << (p == 0 ? "" : ", ") << "{\"frame\": " << point.frame << ", \"rays\": " << point.ray_count << ", \"active_pixels\": " << point.active_pixel_count
+                << ", \"rel_mse\": " << point.rel_mse << ", \"predicted_rel_mse\": " << point.predicted_rel_mse << "}";
+        }
+        out << "]},\n";
+    };
+
+    out << "{\n";
+    out << "  \"width\": " << settings.width << ",\n";
+    out << "  \"height\": " << settings.height << ",\n";
+    out << "  \"tile_size\": " << ADAPTIVE_TILE_SIZE << ",\n";
+    out << "  \"min_samples\": " << ADAPTIVE_MIN_SAMPLES << ",\n";
+    out << "  \"error_threshold\": " << settings.error_threshold << ",\n";
+    out << "  \"reference_spp\": " << settings.reference_spp << ",\n";
+    out << "  \"reference_ms\": " << result.reference_ms << ",\n";
+    write_run("uniform", result.uniform);
+    write_run("adaptive", result.adaptive);
+    out << "  \"target_rel_mse\": " << result.target_rel_mse << ",\n";
+    out << "  \"uniform_rays\": " << result.uniform_rays << ",\n";
+    out << "  \"adaptive_rays\": " << result.adaptive_rays << ",\n";
+    out << "  \"rays_saved\": " << get_rays_saved(result) << ",\n";
+    out << "  \"passed\": " << (is_passing(result) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    uint32_t pixel_count = settings.width * settings.height;
+    out << "yard: " << result.primitive_count << " voxels, " << settings.width << "x" << settings.height << ", reference " << settings.reference_spp
+        << " spp in " << result.reference_ms << " ms, threshold " << settings.error_threshold << ", " << ADAPTIVE_MIN_SAMPLES << " samples minimum" << std::endl;
+    out << "frame     uniform rays    relMSE        adaptive rays   relMSE        predicted     active" << std::endl;
+    for (size_t p = 0; p < result.uniform.points.size() && p < result.adaptive.points.size(); ++p)
+    {
+        FramePoint const &uniform = result.uniform.points[p];
+        FramePoint const &adaptive = result.adaptive.points[p];
+        write_cell(out, uniform.frame, 10);
+        write_cell(out, uniform.ray_count, 16);
+        write_cell(out, uniform.rel_mse, 14);
+        write_cell(out, adaptive.ray_count, 16);
+        write_cell(out, adaptive.rel_mse, 14);
+        write_cell(out, adaptive.predicted_rel_mse, 14);
+        write_cell(out, std::to_string(adaptive.active_pixel_count * 100 / pixel_count) + "%", 8);
+        out << std::endl;
+    }
+    out << "uniform " << result.uniform.ms << " ms, adaptive " << result.adaptive.ms << " ms" << std::endl;
+    out << "relMSE " << result.target_rel_mse << ": uniform " << result.uniform_rays << " rays, adaptive " << result.adaptive_rays << " rays, "
+        << get_rays_saved(result) * 100.0 << "% saved" << std::endl;
+    out << (is_passing(result) ? "passed" : "FAILED") << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--frames N] [--width N] [--height N] [--reference-spp N] [--threshold F] [--threads N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--frames"))
+            settings.frame_count = args.get_uint(2);
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--reference-spp"))
+            settings.reference_spp = args.get_uint(1);
+        else if (args.is("--threshold"))
+            settings.error_threshold = static_cast<float>(args.get_double());
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.thread_count) ? 0 : 1;
+
+    TilePool pool(settings.thread_count);
+    BenchResult result = measure(settings, pool);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return is_passing(result) ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+// Helpers shared by the benchmarks & their --verify modes: best of N timings, named checks, random choices, the
+// command line, the JSON file & table cells of the reports.
+
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+//////////////////////////////// TIMING //////////////////////////////////////
+
+// Best time of repeat runs, the others are the noise of the machine
+template <typename Run>
+inline double best_ms(uint32_t repeat, Run &&run)
+{
+    double best = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < repeat; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    return best;
+}
+
+inline double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//////////////////////////////// CHECKS //////////////////////////////////////
+
+// One property of a --verify mode, it passes when it was checked at least once and never failed
+struct BenchCheck
+{
+    char const *name = "";
+    uint32_t check_count = 0;
+    uint32_t failure_count = 0;
+
+    void add(bool passed)
+    {
+        ++check_count;
+        if (!passed)
+            ++failure_count;
+    }
+
+    bool report() const
+    {
+        bool passed = check_count > 0 && failure_count == 0;
+        std::cout << name << ": " << check_count << " checks, " << failure_count << " off" << (passed ? " (passed)" : " (FAILED)") << std::endl;
+        return passed;
+    }
+};
+
+// A check measuring an error, it fails when the error is above the tolerance (or NaN)
+struct BenchErrorCheck
+{
+    char const *name = "";
+    uint32_t check_count = 0;
+    uint32_t failure_count = 0;
+    double max_error = 0.0;
+
+    void add(double error, double tolerance)
+    {
+        ++check_count;
+        if (!(error <= tolerance))
+            ++failure_count;
+        if (std::isnan(error) || error > max_error)
+            max_error = std::isnan(error) ? std::numeric_limits<double>::infinity() : error;
+    }
+
+    // max_failure_rate lets a few checks fail, when the setup can't rule out a handful of outliers
+    bool report(double max_failure_rate = 0.0) const
+    {
+        bool passed = check_count > 0 && failure_count <= static_cast<uint32_t>(max_failure_rate * check_count);
+        std::cout << name << ": " << check_count << " checks, " << failure_count << " off, max error " << max_error
+                  << (passed ? " (passed)" : " (FAILED)") << std::endl;
+        return passed;
+    }
+};
+
+// Reports every check (Check has report()) and the verdict of the --verify mode
+template <typename Check>
+inline bool report_checks(std::initializer_list<Check const *> checks)
+{
+    bool passed = true;
+    for (Check const *check : checks)
+        passed = check->report() && passed;
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed;
+}
+
+// Relative to the larger magnitude, absolute below 1
+inline bool is_close(double a, double b, double tolerance)
+{
+    return std::abs(a - b) <= tolerance * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+}
+
+//////////////////////////////// RANDOM //////////////////////////////////////
+
+// Random choices from the sampler hash (sampler.hpp), the low bits of an LCG repeat too soon
+struct BenchRandom
+{
+    uint32_t state = 0;
+
+    uint32_t next_bits()
+    {
+        return host_sampler_pcg(state++);
+    }
+
+    uint32_t next_below(uint32_t n)
+    {
+        return next_bits() % n;
+    }
+
+    // In [0, 1)
+    float next_float()
+    {
+        return host_sampler_to_float(next_bits());
+    }
+};
+
+//////////////////////////////// COMMAND LINE //////////////////////////////////////
+
+// Options of a benchmark in the order given, every option is tried on the current argument:
+//
+//     BenchArgs args(argc, argv, "[--verify N] [--json out.json]");
+//     while (args.next())
+//     {
+//         if (args.is("--verify"))
+//             verify_count = args.get_uint(1);
+//         else if (args.is("--json"))
+//             json_path = args.get_string();
+//         else
+//             return args.usage();
+//     }
+class BenchArgs
+{
+public:
+    BenchArgs(int argc, char const *argv[], char const *usage) : argc(argc), argv(argv), usage_text(usage) {}
+
+    bool next()
+    {
+        return ++index < argc;
+    }
+
+    // The current argument is name & the value_count arguments after it are there
+    bool is(char const *name, int value_count = 1) const
+    {
+        return get_current() == name && index + value_count < argc;
+    }
+
+    // A positional argument, anything but an option
+    bool is_positional() const
+    {
+        return get_current().rfind("--", 0) != 0;
+    }
+
+    std::string get_current() const
+    {
+        return argv[index];
+    }
+
+    // Values of the option, in order
+    uint32_t get_uint(uint32_t min = 0)
+    {
+        long long value = std::strtoll(argv[++index], nullptr, 10);
+        return static_cast<uint32_t>(std::clamp(value, static_cast<long long>(min), static_cast<long long>(UINT32_MAX)));
+    }
+
+    double get_double()
+    {
+        return std::strtod(argv[++index], nullptr);
+    }
+
+    std::string get_string()
+    {
+        return argv[++index];
+    }
+
+    // Exit code of an argument no option took
+    int usage() const
+    {
+        std::cerr << "usage: " << argv[0] << " " << usage_text << std::endl;
+        return 1;
+    }
+
+private:
+    int argc = 0;
+    char const **argv = nullptr;
+    char const *usage_text = "";
+    int index = 0;
+};
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+// Writes the JSON of write(std::ostream &) to path, false (reported) when it can't be opened
+template <typename Write>
+inline bool write_json_file(std::filesystem::path const &path, Write &&write)
+{
+    std::ofstream json(path);
+    if (!json.is_open())
+    {
+        std::cerr << "Could not open " << path.string() << std::endl;
+        return false;
+    }
+    write(json);
+    return true;
+}
+
+// A value left aligned in a column of a table row, at least one space after it
+template <typename Value>
+inline void write_cell(std::ostream &out, Value const &value, size_t width)
+{
+    std::ostringstream text;
+    text << value;
+    out << text.str() << std::string(text.str().size() < width ? width - text.str().size() : 1, ' ');
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// Test scenes of the benchmarks: materials & voxels of the region chunks they build, their lights, the room several
+// of them render and the cameras framing them with the projection of the renderer.
+
+#include "defines.h"
+#include "camera.h"
+#include "host_scene.hpp"
+#include "reference_tracer.hpp"
+
+//////////////////////////////// VOXELS //////////////////////////////////////
+
+inline MATERIAL make_material(uint32_t type, glm::vec3 diffuse, glm::vec3 emission = glm::vec3(0.0f), float roughness = 0.0f)
+{
+    MATERIAL mat = {};
+    mat.type = type;
+    mat.diffuse = to_daxa(diffuse);
+    mat.specular = to_daxa(diffuse);
+    mat.emission = to_daxa(emission);
+    mat.roughness = roughness;
+    mat.ior = 1.0f;
+    mat.dissolve = 1.0f;
+    return mat;
+}
+
+// Voxel (x, y, z) of the chunk, a voxel of an emissive material is a cube light too
+inline void add_voxel(GvoxRegionChunk &chunk, uint32_t x, uint32_t y, uint32_t z, uint32_t material)
+{
+    uint32_t light_index = static_cast<uint32_t>(-1);
+    glm::vec3 emission = to_glm(chunk.materials[material].emission);
+    if (emission != glm::vec3(0.0f))
+    {
+        light_index = static_cast<uint32_t>(chunk.lights.size());
+        chunk.lights.push_back(LIGHT{
+            .position = {(x + 0.5f) * VOXEL_EXTENT, (y + 0.5f) * VOXEL_EXTENT, (z + 0.5f) * VOXEL_EXTENT},
+            .emissive = chunk.materials[material].emission,
+            .instance_info = OBJECT_INFO(0, static_cast<uint32_t>(chunk.aabbs.size())),
+            .size = VOXEL_EXTENT,
+            .type = GEOMETRY_LIGHT_CUBE,
+        });
+    }
+    chunk.aabbs.push_back(AABB{
+        .minimum = {x * VOXEL_EXTENT, y * VOXEL_EXTENT, z * VOXEL_EXTENT},
+        .maximum = {(x + 1) * VOXEL_EXTENT, (y + 1) * VOXEL_EXTENT, (z + 1) * VOXEL_EXTENT},
+    });
+    chunk.primitives.push_back(PRIMITIVE{material, light_index});
+}
+
+// Adds the chunk of a grid voxel_size wide, scaled & centered on the origin in x & z (in y too with center_y,
+// otherwise it stands on y = 0)
+inline void add_centered_chunk(HostScene &scene, GvoxRegionChunk &chunk, uint32_t voxel_size, float scale, bool center_y = false)
+{
+    chunk.voxel_count = static_cast<uint32_t>(chunk.aabbs.size());
+
+    float half_extent = voxel_size * VOXEL_EXTENT * 0.5f;
+    glm::mat4 transform = glm::scale(glm::mat4(1.0f), glm::vec3(scale)) *
+                          glm::translate(glm::mat4(1.0f), glm::vec3(-half_extent, center_y ? -half_extent : 0.0f, -half_extent));
+    scene.add_region_chunk(chunk, transform);
+    scene.voxel_count = chunk.voxel_count;
+}
+
+inline void add_sky(HostScene &scene, float radiance)
+{
+    LIGHT sky = {};
+    sky.type = GEOMETRY_LIGHT_ENV_MAP;
+    sky.instance_info = OBJECT_INFO(MAX_INSTANCES, MAX_PRIMITIVES);
+    sky.emissive = daxa_f32vec3(radiance, radiance, radiance);
+    scene.env_lights.push_back(sky);
+}
+
+//////////////////////////////// ROOM //////////////////////////////////////
+
+enum ROOM_MATERIAL : uint32_t
+{
+    ROOM_WHITE,
+    ROOM_RED,
+    ROOM_GREEN,
+    ROOM_METAL,
+    ROOM_LIGHT,
+    ROOM_MATERIAL_COUNT,
+};
+
+// An open room: floor, back & side walls of different colors, blocks with hard edges and a row of small lights. The
+// sky lights it through the open top & front.
+inline void build_room(HostScene &scene)
+{
+    constexpr uint32_t ROOM_SIZE = 24;
+    GvoxRegionChunk chunk = {};
+    chunk.materials.resize(ROOM_MATERIAL_COUNT);
+    chunk.materials[ROOM_WHITE] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.73f));
+    chunk.materials[ROOM_RED] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.65f, 0.05f, 0.05f));
+    chunk.materials[ROOM_GREEN] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.12f, 0.45f, 0.15f));
+    chunk.materials[ROOM_METAL] = make_material(MATERIAL_TYPE_METAL, glm::vec3(0.8f, 0.85f, 0.9f), glm::vec3(0.0f), 0.4f);
+    chunk.materials[ROOM_LIGHT] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.8f), glm::vec3(40.0f, 36.0f, 30.0f));
+
+    for (uint32_t a = 0; a < ROOM_SIZE; ++a)
+        for (uint32_t b = 0; b < ROOM_SIZE; ++b)
+        {
+            add_voxel(chunk, a, 0, b, ROOM_WHITE);
+            add_voxel(chunk, a, b + 1, 0, ROOM_WHITE);
+            if (b + 1 < ROOM_SIZE / 2)
+            {
+                add_voxel(chunk, 0, b + 1, a, ROOM_RED);
+                add_voxel(chunk, ROOM_SIZE - 1, b + 1, a, ROOM_GREEN);
+            }
+        }
+
+    // A tall white block & a low metal one
+    for (uint32_t y = 1; y < 9; ++y)
+        for (uint32_t z = 6; z < 10; ++z)
+            for (uint32_t x = 5; x < 9; ++x)
+                add_voxel(chunk, x, y, z, ROOM_WHITE);
+    for (uint32_t y = 1; y < 4; ++y)
+        for (uint32_t z = 12; z < 16; ++z)
+            for (uint32_t x = 14; x < 19; ++x)
+                add_voxel(chunk, x, y, z, ROOM_METAL);
+
+    // Small lights in a row above the room
+    for (uint32_t x = 4; x < ROOM_SIZE - 4; x += 3)
+        add_voxel(chunk, x, 14, 8 + (x % 2) * 4, ROOM_LIGHT);
+
+    add_centered_chunk(scene, chunk, ROOM_SIZE, 8.0f);
+    add_sky(scene, 10.0f);
+}
+
+//////////////////////////////// CAMERAS //////////////////////////////////////
+
+// Distance from a sphere of radius at which it fills the height of the renderer's view
+inline float get_framing_distance(uint32_t width, uint32_t height, float radius)
+{
+    camera cam = {};
+    reset_camera(cam);
+    cam.width = width;
+    cam.height = height;
+
+    // proj[1][1] = 1 / tan(fov / 2), whatever unit the fov ends up in
+    float focal = std::abs(get_projection_matrix(cam)[1][1]);
+    return radius * std::max(focal, 1.0f) * 1.05f;
+}
+
+// Renderer camera at position looking at target
+inline HostCamera get_host_camera(uint32_t width, uint32_t height, glm::vec3 position, glm::vec3 target)
+{
+    camera cam = {};
+    reset_camera(cam);
+    cam.width = width;
+    cam.height = height;
+    cam.position = position;
+    cam.forward = glm::normalize(target - position);
+
+    HostCamera host_camera = {
+        .inv_view = get_inverse_view_matrix(cam),
+        .inv_proj = get_inverse_projection_matrix(cam),
+    };
+    // Same flip as the camera_view upload
+    host_camera.inv_proj[1][1] *= -1.0f;
+    return host_camera;
+}
+
+// Camera in front of the room looking at its back wall, yaw turns it around the room
+inline HostCamera frame_room(HostScene const &scene, uint32_t width, uint32_t height, float yaw = 0.0f)
+{
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = (scene.bounds_max.x - scene.bounds_min.x) * 0.5f;
+    float distance = get_framing_distance(width, height, radius);
+    glm::vec3 position = center + glm::normalize(glm::vec3(std::sin(yaw), 0.3f, std::cos(yaw))) * (distance + radius);
+    return get_host_camera(width, height, position, center);
+}
@@ -0,0 +1,487 @@
+// Ray-box intersection benchmark & equivalence check.
+// Times the scalar port of the shader intersection (box_intersect.hpp) against the 8 wide kernels
+// (box_intersect_x8.hpp) for every shader variant, 8 rays x 1 box and 1 ray x 8 boxes.
+// --verify compares every output of the wide kernels bit for bit against the scalar port on random
+// rays & boxes (origins inside, on faces, axis aligned & signed zero directions, rotated boxes),
+// the exit code is not 0 on any mismatch.
+//
+// usage: box_intersect_bench [--verify N] [--rays N] [--boxes N] [--repeat N] [--seed N] [--json out.json]
+
+#include "defines.h"
+#include "box_intersect.hpp"
+#include "box_intersect_x8.hpp"
+#include "bench_common.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+//////////////////////////////// VARIANTS //////////////////////////////////////
+
+// The ourIntersectBox* entry points of intersect.glsl
+struct BoxVariant
+{
+    char const *name;
+    bool ray_can_start_in_box;
+    bool ray_can_second_hit;
+    bool get_uv;
+};
+
+static constexpr BoxVariant BOX_VARIANTS[] = {
+    {"intersect", true, false, false},
+    {"outside", false, true, false},
+    {"two_hits", true, true, false},
+    {"two_hits_uv", true, true, true},
+};
+
+struct ScalarHit
+{
+    bool hit = false;
+    float distance = 0.0f;
+    float exit_distance = 0.0f;
+    glm::vec3 normal = {};
+    glm::vec2 uv = {};
+};
+
+static ScalarHit intersect_scalar(BoxVariant const &variant, bool oriented, HostBox const &box, HostRay const &ray, glm::vec3 const &inv_direction)
+{
+    ScalarHit result = {};
+    result.hit = intersect_box_common(box, ray, result.distance, result.exit_distance, result.normal, variant.ray_can_start_in_box,
+                                      variant.ray_can_second_hit, variant.get_uv, oriented, inv_direction, result.uv);
+    return result;
+}
+
+// Runtime flags to the compile time kernels
+template <bool ORIENTED, typename Packet>
+static uint32_t dispatch_x8(BoxVariant const &variant, Packet &&call)
+{
+    if (!variant.ray_can_start_in_box)
+        return call.template operator()<false, true, false, ORIENTED>();
+    if (!variant.ray_can_second_hit)
+        return call.template operator()<true, false, false, ORIENTED>();
+    if (!variant.get_uv)
+        return call.template operator()<true, true, false, ORIENTED>();
+    return call.template operator()<true, true, true, ORIENTED>();
+}
+
+static uint32_t intersect_rays_x8(BoxVariant const &variant, bool oriented, HostBox const &box, RayPacket8 const &rays, BoxHit8 &hits)
+{
+    auto call = [&]<bool A, bool B, bool C, bool D>()
+    { return intersect_box_x8<A, B, C, D>(box, rays, hits); };
+    return oriented ? dispatch_x8<true>(variant, call) : dispatch_x8<false>(variant, call);
+}
+
+static uint32_t intersect_boxes_x8(BoxVariant const &variant, bool oriented, BoxPacket8 const &boxes, HostRay const &ray,
+                                   glm::vec3 const &inv_direction, BoxHit8 &hits)
+{
+    auto call = [&]<bool A, bool B, bool C, bool D>()
+    { return intersect_box_x8<A, B, C, D>(boxes, ray, inv_direction, hits); };
+    return oriented ? dispatch_x8<true>(variant, call) : dispatch_x8<false>(variant, call);
+}
+
+//////////////////////////////// RANDOM CASES //////////////////////////////////////
+
+struct CaseGenerator
+{
+    std::mt19937 rng;
+
+    float uniform(float a, float b) { return std::uniform_real_distribution<float>(a, b)(rng); }
+    uint32_t pick(uint32_t count) { return std::uniform_int_distribution<uint32_t>(0, count - 1)(rng); }
+
+    HostBox box(bool rotated)
+    {
+        // Voxel sized, merged runs & odd sizes
+        glm::vec3 radius = {};
+        switch (pick(3))
+        {
+        case 0:
+            radius = glm::vec3(HALF_VOXEL_EXTENT);
+            break;
+        case 1:
+            radius = glm::vec3(HALF_VOXEL_EXTENT) * glm::vec3(1 + pick(8), 1 + pick(8), 1 + pick(8));
+            break;
+        default:
+            radius = glm::vec3(uniform(0.01f, 2.0f), uniform(0.01f, 2.0f), uniform(0.01f, 2.0f));
+            break;
+        }
+
+        glm::mat3 rotation = glm::mat3(1.0f);
+        if (rotated)
+        {
+            glm::vec3 axis = glm::normalize(glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f)) + glm::vec3(1e-3f));
+            rotation = glm::mat3(glm::rotate(glm::mat4(1.0f), uniform(0.0f, DAXA_2PI), axis));
+        }
+
+        return HostBox{
+            .center = glm::vec3(uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f)),
+            .radius = radius,
+            .inv_radius = safe_inverse(radius),
+            .rotation = rotation,
+        };
+    }
+
+    // Rays around the box, with the cases the kernels must agree on: origins inside & on faces,
+    // axis aligned and signed zero directions, rays through edges & corners
+    HostRay ray(HostBox const &box)
+    {
+        glm::vec3 local = {};
+        switch (pick(4))
+        {
+        case 0: // inside
+            local = box.radius * glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+            break;
+        case 1: // on a face
+            local = box.radius * glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+            local[pick(3)] = box.radius[pick(3)] * (pick(2) ? 1.0f : -1.0f);
+            break;
+        default: // outside
+            local = glm::vec3(uniform(-4.0f, 4.0f), uniform(-4.0f, 4.0f), uniform(-4.0f, 4.0f));
+            break;
+        }
+        glm::vec3 origin = box.center + glm::transpose(box.rotation) * local;
+
+        glm::vec3 direction = {};
+        switch (pick(5))
+        {
+        case 0: // axis aligned, zeros of both signs
+            direction[pick(3)] = pick(2) ? 1.0f : -1.0f;
+            for (int i = 0; i < 3; ++i)
+                if (direction[i] == 0.0f && pick(2))
+                    direction[i] = -0.0f;
+            break;
+        case 1: // towards a corner
+            direction = box.center + box.radius * glm::vec3(pick(2) ? 1.0f : -1.0f, pick(2) ? 1.0f : -1.0f, pick(2) ? 1.0f : -1.0f) - origin;
+            break;
+        case 2: // towards the center
+            direction = box.center - origin;
+            break;
+        default:
+            direction = glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+            break;
+        }
+        if (glm::length(direction) > 0.0f)
+            direction = glm::normalize(direction);
+        else
+            direction = glm::vec3(0.0f, 0.0f, -1.0f);
+
+        return HostRay{.origin = origin, .direction = direction};
+    }
+};
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static bool same_bits(float a, float b) { return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b); }
+
+static bool same_lane(ScalarHit const &expected, BoxHit8 const &hits, uint32_t mask, uint32_t lane)
+{
+    bool same = (((mask >> lane) & 1u) != 0) == expected.hit &&
+                same_bits(expected.distance, hits.distance[lane]) &&
+                same_bits(expected.exit_distance, hits.exit_distance[lane]) &&
+                same_bits(expected.uv.x, hits.uv[0][lane]) &&
+                same_bits(expected.uv.y, hits.uv[1][lane]);
+    for (int i = 0; i < 3; ++i)
+        same = same && same_bits(expected.normal[i], hits.normal[i][lane]);
+    return same;
+}
+
+static void report_mismatch(char const *layout, BoxVariant const &variant, bool oriented, HostBox const &box, HostRay const &ray,
+                            ScalarHit const &expected, BoxHit8 const &hits, uint32_t mask, uint32_t lane)
+{
+#if WARN
+    std::cerr << "mismatch [" << layout << " " << variant.name << (oriented ? " oriented" : "") << "]"
+              << " box center " << box.center.x << " " << box.center.y << " " << box.center.z
+              << " radius " << box.radius.x << " " << box.radius.y << " " << box.radius.z
+              << " ray " << ray.origin.x << " " << ray.origin.y << " " << ray.origin.z
+              << " -> " << ray.direction.x << " " << ray.direction.y << " " << ray.direction.z << std::endl;
+    std::cerr << "  scalar: hit " << expected.hit << " distance " << expected.distance << " exit " << expected.exit_distance << std::endl;
+    std::cerr << "  x8:     hit " << ((mask >> lane) & 1u) << " distance " << hits.distance[lane] << " exit " << hits.exit_distance[lane] << std::endl;
+#endif // WARN
+}
+
+// Returns the number of mismatching lanes
+static uint64_t verify(uint32_t case_count, uint32_t seed)
+{
+    CaseGenerator generator = {std::mt19937(seed)};
+    uint64_t mismatch_count = 0;
+    uint64_t lane_count = 0;
+    uint64_t hit_count = 0;
+
+    for (uint32_t c = 0; c < case_count; ++c)
+    {
+        bool oriented = (c & 1) != 0;
+        BoxVariant const &variant = BOX_VARIANTS[(c >> 1) % std::size(BOX_VARIANTS)];
+
+        // 8 rays x 1 box
+        {
+            HostBox box = generator.box(oriented);
+            HostRay rays[BOX_LANE_COUNT];
+            RayPacket8 packet = {};
+            for (uint32_t lane = 0; lane < BOX_LANE_COUNT; ++lane)
+            {
+                rays[lane] = generator.ray(box);
+                packet.set(lane, rays[lane], safe_inverse(rays[lane].direction));
+            }
+
+            BoxHit8 hits = {};
+            uint32_t mask = intersect_rays_x8(variant, oriented, box, packet, hits);
+            uint32_t aa_mask = hit_aa_box_x8(box.center, box.radius, packet);
+            for (uint32_t lane = 0; lane < BOX_LANE_COUNT; ++lane)
+            {
+                glm::vec3 inv_direction = safe_inverse(rays[lane].direction);
+                ScalarHit expected = intersect_scalar(variant, oriented, box, rays[lane], inv_direction);
+                bool aa_expected = hit_aa_box(box.center, box.radius, rays[lane].origin, rays[lane].direction, inv_direction);
+                if (!same_lane(expected, hits, mask, lane) || (((aa_mask >> lane) & 1u) != 0) != aa_expected)
+                {
+                    if (mismatch_count++ < 8)
+                        report_mismatch("8 rays", variant, oriented, box, rays[lane], expected, hits, mask, lane);
+                }
+                hit_count += expected.hit;
+            }
+            lane_count += BOX_LANE_COUNT;
+        }
+
+        // 1 ray x 8 boxes, lanes past a random count are cleared like the tail of a voxel run
+        {
+            HostBox boxes[BOX_LANE_COUNT];
+            uint32_t count = 1 + generator.pick(BOX_LANE_COUNT);
+            BoxPacket8 packet = {};
+            for (uint32_t lane = 0; lane < BOX_LANE_COUNT; ++lane)
+            {
+                boxes[lane] = lane < count ? generator.box(oriented) : HostBox{.inv_radius = glm::vec3(safe_inverse(0.0f))};
+                packet.set(lane, boxes[lane]);
+            }
+            HostRay ray = generator.ray(boxes[generator.pick(count)]);
+            glm::vec3 inv_direction = safe_inverse(ray.direction);
+
+            BoxHit8 hits = {};
+            uint32_t mask = intersect_boxes_x8(variant, oriented, packet, ray, inv_direction, hits);
+            uint32_t aa_mask = hit_aa_box_x8(packet, ray, inv_direction);
+            for (uint32_t lane = 0; lane < BOX_LANE_COUNT; ++lane)
+            {
+                ScalarHit expected = intersect_scalar(variant, oriented, boxes[lane], ray, inv_direction);
+                bool aa_expected = hit_aa_box(boxes[lane].center, boxes[lane].radius, ray.origin, ray.direction, inv_direction);
+                if (!same_lane(expected, hits, mask, lane) || (((aa_mask >> lane) & 1u) != 0) != aa_expected)
+                {
+                    if (mismatch_count++ < 8)
+                        report_mismatch("8 boxes", variant, oriented, boxes[lane], ray, expected, hits, mask, lane);
+                }
+                hit_count += expected.hit;
+            }
+            lane_count += BOX_LANE_COUNT;
+        }
+    }
+
+    std::cout << "verify: " << lane_count << " lanes, " << hit_count << " hits, " << mismatch_count << " mismatches"
+              << (BOX_INTERSECT_AVX2_ON ? " (AVX2)" : " (no AVX2, scalar lanes)") << std::endl;
+    return mismatch_count;
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchResult
+{
+    std::string name = {};
+    double scalar_mtests = 0.0;
+    double rays_x8_mtests = 0.0;
+    double boxes_x8_mtests = 0.0;
+    uint64_t hit_count = 0;
+};
+
+static BenchResult bench_variant(BoxVariant const &variant, bool oriented, std::vector<HostBox> const &boxes, std::vector<HostRay> const &rays,
+                                 std::vector<RayPacket8> const &ray_packets, std::vector<BoxPacket8> const &box_packets, uint32_t repeat)
+{
+    BenchResult result = {.name = std::string(variant.name) + (oriented ? "_oriented" : "")};
+    double test_count = static_cast<double>(boxes.size()) * rays.size();
+
+    std::vector<glm::vec3> inv_directions(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i)
+        inv_directions[i] = safe_inverse(rays[i].direction);
+
+    // Sums of the hits keep the compiler from dropping the work and must agree
+    uint64_t scalar_hits = 0, rays_x8_hits = 0, boxes_x8_hits = 0;
+
+    double scalar_ms = best_ms(repeat, [&]()
+                               {
+        scalar_hits = 0;
+        for (auto const &box : boxes)
+            for (size_t i = 0; i < rays.size(); ++i)
+                scalar_hits += intersect_scalar(variant, oriented, box, rays[i], inv_directions[i]).hit; });
+
+    double rays_x8_ms = best_ms(repeat, [&]()
+                                {
+        rays_x8_hits = 0;
+        BoxHit8 hits = {};
+        for (auto const &box : boxes)
+            for (auto const &packet : ray_packets)
+                rays_x8_hits += std::popcount(intersect_rays_x8(variant, oriented, box, packet, hits)); });
+
+    double boxes_x8_ms = best_ms(repeat, [&]()
+                                 {
+        boxes_x8_hits = 0;
+        BoxHit8 hits = {};
+        for (size_t i = 0; i < rays.size(); ++i)
+            for (auto const &packet : box_packets)
+                boxes_x8_hits += std::popcount(intersect_boxes_x8(variant, oriented, packet, rays[i], inv_directions[i], hits)); });
+
+#if WARN
+    if (scalar_hits != rays_x8_hits || scalar_hits != boxes_x8_hits)
+        std::cerr << result.name << ": hit counts differ " << scalar_hits << " " << rays_x8_hits << " " << boxes_x8_hits << std::endl;
+#endif // WARN
+
+    result.hit_count = scalar_hits;
+    result.scalar_mtests = test_count / (scalar_ms * 1e3);
+    result.rays_x8_mtests = test_count / (rays_x8_ms * 1e3);
+    result.boxes_x8_mtests = test_count / (boxes_x8_ms * 1e3);
+    return result;
+}
+
+static BenchResult bench_aa_box(std::vector<HostBox> const &boxes, std::vector<HostRay> const &rays,
+                                std::vector<RayPacket8> const &ray_packets, std::vector<BoxPacket8> const &box_packets, uint32_t repeat)
+{
+    BenchResult result = {.name = "hit_aa_box"};
+    double test_count = static_cast<double>(boxes.size()) * rays.size();
+
+    std::vector<glm::vec3> inv_directions(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i)
+        inv_directions[i] = safe_inverse(rays[i].direction);
+
+    uint64_t scalar_hits = 0, rays_x8_hits = 0, boxes_x8_hits = 0;
+    double scalar_ms = best_ms(repeat, [&]()
+                               {
+        scalar_hits = 0;
+        for (auto const &box : boxes)
+            for (size_t i = 0; i < rays.size(); ++i)
+                scalar_hits += hit_aa_box(box.center, box.radius, rays[i].origin, rays[i].direction, inv_directions[i]); });
+    double rays_x8_ms = best_ms(repeat, [&]()
+                                {
+        rays_x8_hits = 0;
+        for (auto const &box : boxes)
+            for (auto const &packet : ray_packets)
+                rays_x8_hits += std::popcount(hit_aa_box_x8(box.center, box.radius, packet)); });
+    double boxes_x8_ms = best_ms(repeat, [&]()
+                                 {
+        boxes_x8_hits = 0;
+        for (size_t i = 0; i < rays.size(); ++i)
+            for (auto const &packet : box_packets)
+                boxes_x8_hits += std::popcount(hit_aa_box_x8(packet, rays[i], inv_directions[i])); });
+
+#if WARN
+    if (scalar_hits != rays_x8_hits || scalar_hits != boxes_x8_hits)
+        std::cerr << result.name << ": hit counts differ " << scalar_hits << " " << rays_x8_hits << " " << boxes_x8_hits << std::endl;
+#endif // WARN
+
+    result.hit_count = scalar_hits;
+    result.scalar_mtests = test_count / (scalar_ms * 1e3);
+    result.rays_x8_mtests = test_count / (rays_x8_ms * 1e3);
+    result.boxes_x8_mtests = test_count / (boxes_x8_ms * 1e3);
+    return result;
+}
+
+static void write_json(std::ostream &out, std::vector<BenchResult> const &results, uint32_t ray_count, uint32_t box_count, uint32_t repeat)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"box_intersect\",\n";
+    out << "  \"avx2\": " << BOX_INTERSECT_AVX2_ON << ",\n";
+    out << "  \"rays\": " << ray_count << ",\n";
+    out << "  \"boxes\": " << box_count << ",\n";
+    out << "  \"repeat\": " << repeat << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto const &result = results[i];
+        out << "    {"
+            << "\"variant\": \"" << result.name << "\", "
+            << "\"scalar_mtests_per_second\": " << result.scalar_mtests << ", "
+            << "\"rays_x8_mtests_per_second\": " << result.rays_x8_mtests << ", "
+            << "\"boxes_x8_mtests_per_second\": " << result.boxes_x8_mtests << ", "
+            << "\"hits\": " << result.hit_count
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, std::vector<BenchResult> const &results)
+{
+    out << std::endl;
+    out << "Mtests/s (speed up)           scalar     8 rays x 1 box       1 ray x 8 boxes" << std::endl;
+    for (auto const &result : results)
+    {
+        out << "  ";
+        write_cell(out, result.name, 24);
+        out << result.scalar_mtests << "    "
+            << result.rays_x8_mtests << " (" << result.rays_x8_mtests / result.scalar_mtests << "x)    "
+            << result.boxes_x8_mtests << " (" << result.boxes_x8_mtests / result.scalar_mtests << "x)" << std::endl;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    uint32_t ray_count = 1 << 12;
+    uint32_t box_count = 1 << 10;
+    uint32_t repeat = 3;
+    uint32_t seed = 1;
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--rays N] [--boxes N] [--repeat N] [--seed N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--rays"))
+            ray_count = args.get_uint(1);
+        else if (args.is("--boxes"))
+            box_count = args.get_uint(1);
+        else if (args.is("--repeat"))
+            repeat = args.get_uint(1);
+        else if (args.is("--seed"))
+            seed = args.get_uint();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, seed) == 0 ? 0 : 1;
+
+    // Whole packets only
+    ray_count = (ray_count + BOX_LANE_COUNT - 1) / BOX_LANE_COUNT * BOX_LANE_COUNT;
+    box_count = (box_count + BOX_LANE_COUNT - 1) / BOX_LANE_COUNT * BOX_LANE_COUNT;
+
+    std::vector<BenchResult> results = {};
+    for (bool oriented : {false, true})
+    {
+        // Rays aimed at random boxes of the set so a fair share of the tests hit
+        CaseGenerator generator = {std::mt19937(seed)};
+        std::vector<HostBox> boxes(box_count);
+        for (auto &box : boxes)
+            box = generator.box(oriented);
+        std::vector<HostRay> rays(ray_count);
+        for (auto &ray : rays)
+            ray = generator.ray(boxes[generator.pick(box_count)]);
+
+        std::vector<RayPacket8> ray_packets(ray_count / BOX_LANE_COUNT);
+        for (uint32_t i = 0; i < ray_count; ++i)
+            ray_packets[i / BOX_LANE_COUNT].set(i % BOX_LANE_COUNT, rays[i], safe_inverse(rays[i].direction));
+        std::vector<BoxPacket8> box_packets(box_count / BOX_LANE_COUNT);
+        for (uint32_t i = 0; i < box_count; ++i)
+            box_packets[i / BOX_LANE_COUNT].set(i % BOX_LANE_COUNT, boxes[i]);
+
+        for (auto const &variant : BOX_VARIANTS)
+            results.push_back(bench_variant(variant, oriented, boxes, rays, ray_packets, box_packets, repeat));
+        if (!oriented)
+            results.push_back(bench_aa_box(boxes, rays, ray_packets, box_packets, repeat));
+    }
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, results, ray_count, box_count, repeat); }))
+        return 1;
+
+    std::cout << (BOX_INTERSECT_AVX2_ON ? "AVX2" : "no AVX2, scalar lanes") << ", "
+              << ray_count << " rays x " << box_count << " boxes" << std::endl;
+    write_table(std::cout, results);
+
+    return 0;
+}
@@ -0,0 +1,534 @@
+// Brush stroke benchmark & checks.
+// Replays brush strokes on the host through the hit bitmasks & range claims of brush_hits.hpp: placements of one model
+// sharing the primitive range of its prototype and instances with a range of their own. Times the hits of a stroke
+// over random placements and the mapping of the prototype range hits to the placement claiming it.
+// --verify N checks on N random strokes: a stroke over two placements of a model changes the first one hit only, the
+// other one gets its hits in the next stroke, instances with their own range keep every hit, hits no hit placement
+// claimed reject the stroke and the counters match the bitmasks. On random grids of adjacent merged boxes it checks that
+// split_aabb gives back every voxel once with its material & the AABB the loader gives an unmerged voxel, that a hit on
+// a box face picks the voxel behind it through the instance transform, and that the hits of a stroke map to the voxels
+// under them in the layout of a split instance. The exit code is not 0 when one fails.
+//
+// usage: brush_bench [--verify N] [--primitives N] [--placements N] [--hits N] [--repeat N] [--json out.json]
+
+#include "defines.h"
+#include "math.inl"
+#include "bench_common.hpp"
+#include "brush_hits.hpp"
+
+#include <bit>
+#include <cstring>
+#include <numeric>
+
+//////////////////////////////// SCENE //////////////////////////////////////
+
+// Instances & brush buffers of ACCEL_STRUCT_MNGR: instance 0 is the hidden prototype, 1 to placement_count place it
+// (same range) and the ones after them have their own range. Ranges start on BRUSH_RANGE_ALIGNMENT.
+struct StrokeScene
+{
+    struct Instance
+    {
+        uint32_t first_primitive_index = 0;
+        uint32_t primitive_count = 0;
+    };
+
+    std::vector<Instance> instances = {};
+    uint32_t placement_count = 0;
+    std::vector<uint32_t> instance_bitmask = {};
+    std::vector<uint32_t> primitive_bitmask = {};
+    std::vector<uint32_t> range_owners = {};
+    BRUSH_COUNTER counters = {};
+
+    StrokeScene(uint32_t prototype_primitive_count, uint32_t placement_count, std::vector<uint32_t> const &own_primitive_counts)
+        : placement_count(placement_count)
+    {
+        uint32_t primitive_count = 0;
+        auto add_range = [&](uint32_t count) -> uint32_t
+        {
+            uint32_t first = primitive_count;
+            primitive_count += (count + BRUSH_RANGE_ALIGNMENT - 1) / BRUSH_RANGE_ALIGNMENT * BRUSH_RANGE_ALIGNMENT;
+            return first;
+        };
+
+        Instance prototype = {.first_primitive_index = add_range(prototype_primitive_count), .primitive_count = prototype_primitive_count};
+        instances.assign(1 + placement_count, prototype);
+        for (uint32_t count : own_primitive_counts)
+            instances.push_back({.first_primitive_index = add_range(count), .primitive_count = count});
+
+        instance_bitmask.assign(instances.size() / 32 + 1, 0);
+        primitive_bitmask.assign(primitive_count / 32 + 1, 0);
+        range_owners.assign(primitive_count / BRUSH_RANGE_ALIGNMENT + 1, BRUSH_RANGE_UNCLAIMED);
+    }
+
+    bool hit(uint32_t instance_index, uint32_t primitive_id)
+    {
+        return host_brush_hit(instance_bitmask.data(), primitive_bitmask.data(), range_owners.data(), counters, instance_index,
+                              instances[instance_index].first_primitive_index, primitive_id);
+    }
+
+    // The prototype range & its placements with their instance bit set
+    auto get_shared_range() const -> SharedRangeHits
+    {
+        SharedRangeHits range = {.first_primitive_index = instances[0].first_primitive_index, .primitive_count = instances[0].primitive_count};
+        for (uint32_t i = 1; i <= placement_count; ++i)
+            if (is_bit_set(instance_bitmask.data(), i))
+                range.placements.push_back(i);
+        return range;
+    }
+
+    // Processed stroke: bitmasks, counters & claims cleared
+    void end_stroke()
+    {
+        std::fill(instance_bitmask.begin(), instance_bitmask.end(), 0U);
+        std::fill(primitive_bitmask.begin(), primitive_bitmask.end(), 0U);
+        std::fill(range_owners.begin(), range_owners.end(), BRUSH_RANGE_UNCLAIMED);
+        counters = {};
+    }
+
+    bool counters_match() const
+    {
+        auto popcount = [](std::vector<uint32_t> const &bitmask)
+        {
+            return std::accumulate(bitmask.begin(), bitmask.end(), 0U, [](uint32_t sum, uint32_t word)
+                                   { return sum + static_cast<uint32_t>(std::popcount(word)); });
+        };
+        return counters.instance_count == popcount(instance_bitmask) && counters.primitive_count == popcount(primitive_bitmask);
+    }
+};
+
+// Voxels of every placement after the split of split_shared_instances: the owner copies the prototype without its hits,
+// the others keep drawing the prototype. Empty when the stroke is rejected.
+static auto split_placements(StrokeScene const &scene, std::vector<uint8_t> const &prototype_voxels) -> std::vector<std::vector<uint8_t>>
+{
+    SharedRangeHits range = scene.get_shared_range();
+    std::vector<std::vector<uint8_t>> voxels(scene.placement_count + 1, prototype_voxels);
+    if (range.placements.empty())
+        return voxels;
+
+    uint32_t owner_index = map_shared_range_hits(range, scene.range_owners.data());
+    if (owner_index == BRUSH_RANGE_UNCLAIMED)
+        return {};
+
+    std::vector<uint32_t> primitive_ids = {};
+    get_range_hits(range, scene.primitive_bitmask.data(), primitive_ids);
+    for (uint32_t primitive_id : primitive_ids)
+        voxels[owner_index][primitive_id] = 0;
+    return voxels;
+}
+
+// Random grid of voxels merged into boxes as the loader does (merge_boxes): two materials, so boxes of both materials &
+// of the same one lie next to each other
+struct MergedGrid
+{
+    daxa_i32vec3 min = {};
+    daxa_u32vec3 size = {};
+    std::vector<uint32_t> cells = {}; // 0 empty, material index + 1 otherwise
+    uint32_t voxel_count = 0;
+    std::vector<BoxMerger::MergedBox> boxes = {};
+    std::vector<AABB> aabbs = {};
+
+    explicit MergedGrid(BenchRandom &random)
+    {
+        min = {static_cast<int32_t>(random.next_below(4096)) - 2048, static_cast<int32_t>(random.next_below(4096)) - 2048,
+               static_cast<int32_t>(random.next_below(4096)) - 2048};
+        size = {1 + random.next_below(6), 1 + random.next_below(6), 1 + random.next_below(6)};
+        cells.assign(size.x * size.y * size.z, 0);
+
+        BoxMerger merger = {};
+        for (uint32_t z = 0; z < size.z; ++z)
+            for (uint32_t y = 0; y < size.y; ++y)
+                for (uint32_t x = 0; x < size.x; ++x)
+                {
+                    if (random.next_below(5) == 0)
+                        continue;
+                    uint32_t material_index = random.next_below(2);
+                    cells[(z * size.y + y) * size.x + x] = material_index + 1;
+                    merger.add_voxel(min.x + static_cast<int32_t>(x), min.y + static_cast<int32_t>(y), min.z + static_cast<int32_t>(z), material_index);
+                    ++voxel_count;
+                }
+        merger.merge(boxes);
+        for (auto const &box : boxes)
+            aabbs.push_back(BoxMerger::box_to_aabb(box));
+    }
+
+    // Material index + 1 of the voxel at grid coordinates, 0 when empty or outside
+    uint32_t get_cell(daxa_i32vec3 voxel) const
+    {
+        daxa_i32vec3 local = {voxel.x - min.x, voxel.y - min.y, voxel.z - min.z};
+        if (local.x < 0 || local.y < 0 || local.z < 0 || local.x >= static_cast<int32_t>(size.x) ||
+            local.y >= static_cast<int32_t>(size.y) || local.z >= static_cast<int32_t>(size.z))
+            return 0;
+        return cells[(local.z * size.y + local.y) * size.x + local.x];
+    }
+};
+
+// AABB of an unmerged voxel (map_loader.cpp)
+static auto get_voxel_aabb(daxa_i32vec3 voxel) -> AABB
+{
+    return AABB{
+        .minimum = {voxel.x * VOXEL_EXTENT, voxel.y * VOXEL_EXTENT, voxel.z * VOXEL_EXTENT},
+        .maximum = {(voxel.x + 1) * VOXEL_EXTENT, (voxel.y + 1) * VOXEL_EXTENT, (voxel.z + 1) * VOXEL_EXTENT},
+    };
+}
+
+static bool is_same_aabb(AABB const &a, AABB const &b)
+{
+    return std::memcmp(&a, &b, sizeof(AABB)) == 0;
+}
+
+// Random point on a face of a merged AABB, away from the voxel edges, & the voxel behind it in split_aabb order
+static auto get_face_point(BenchRandom &random, AABB const &aabb, uint32_t &voxel_index) -> daxa_f32vec3
+{
+    daxa_u32vec3 extent = BoxMerger::aabb_voxel_extent(aabb);
+    uint32_t cell[3] = {random.next_below(extent.x), random.next_below(extent.y), random.next_below(extent.z)};
+    float point[3] = {};
+    for (uint32_t axis = 0; axis < 3; ++axis)
+        point[axis] = (&aabb.minimum.x)[axis] + (cell[axis] + 0.1f + 0.8f * random.next_float()) * VOXEL_EXTENT;
+
+    uint32_t face_axis = random.next_below(3);
+    uint32_t face_count = (&extent.x)[face_axis];
+    bool maximum = random.next_below(2) == 1;
+    cell[face_axis] = maximum ? face_count - 1 : 0;
+    point[face_axis] = maximum ? (&aabb.maximum.x)[face_axis] : (&aabb.minimum.x)[face_axis];
+
+    voxel_index = (cell[2] * extent.y + cell[1]) * extent.x + cell[0];
+    return {point[0], point[1], point[2]};
+}
+
+// AABBs of an instance once split_aabb_device_buffer split its boxes
+static auto get_split_aabbs(std::vector<AABB> aabbs, SplitBoxes const &split) -> std::vector<AABB>
+{
+    std::vector<AABB> appended = {};
+    std::vector<AABB> voxel_aabbs = {};
+    for (uint32_t box_id : split.box_ids)
+    {
+        voxel_aabbs.resize(BoxMerger::aabb_voxel_count(aabbs[box_id]));
+        BoxMerger::split_aabb(aabbs[box_id], voxel_aabbs.data());
+        aabbs[box_id] = voxel_aabbs[0];
+        appended.insert(appended.end(), voxel_aabbs.begin() + 1, voxel_aabbs.end());
+    }
+    aabbs.insert(aabbs.end(), appended.begin(), appended.end());
+    return aabbs;
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t primitive_count = 1U << 20; // of the prototype
+    uint32_t placement_count = 64;
+    uint32_t hit_count = 1U << 16;       // pixels of a 256 x 256 brush
+    uint32_t repeat = 5;
+};
+
+struct BenchResult
+{
+    double hit_ns = 0.0;        // per hit, claim & bits
+    double map_ms = 0.0;        // owner & hits of the prototype range
+    uint32_t recorded_hits = 0; // distinct primitives in the bits
+    uint32_t skipped_hits = 0;  // hits on placements the range wasn't claimed by
+};
+
+static BenchResult measure(BenchSettings const &settings)
+{
+    BenchResult result = {};
+    StrokeScene scene(settings.primitive_count, settings.placement_count, {settings.primitive_count});
+
+    // Hits of several brush dispatches before the manager is idle, on random placements & the unshared instance
+    BenchRandom random = {};
+    std::vector<std::pair<uint32_t, uint32_t>> hits(settings.hit_count);
+    for (auto &[instance_index, primitive_id] : hits)
+    {
+        instance_index = 1 + random.next_below(settings.placement_count + 1);
+        primitive_id = random.next_below(settings.primitive_count);
+    }
+
+    double stroke_ms = best_ms(settings.repeat, [&]()
+                               {
+        scene.end_stroke();
+        result.skipped_hits = 0;
+        for (auto [instance_index, primitive_id] : hits)
+            result.skipped_hits += scene.hit(instance_index, primitive_id) ? 0 : 1; });
+    result.hit_ns = stroke_ms * 1e6 / static_cast<double>(hits.size());
+
+    std::vector<uint32_t> primitive_ids = {};
+    result.map_ms = best_ms(settings.repeat, [&]()
+                            {
+        SharedRangeHits range = scene.get_shared_range();
+        if (map_shared_range_hits(range, scene.range_owners.data()) != BRUSH_RANGE_UNCLAIMED)
+            get_range_hits(range, scene.primitive_bitmask.data(), primitive_ids); });
+    result.recorded_hits = scene.counters.primitive_count;
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static auto get_unique(std::vector<uint32_t> ids) -> std::vector<uint32_t>
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+static bool verify(uint32_t trial_count)
+{
+    BenchCheck claim_check = {.name = "the first placement hit claims the prototype range"};
+    BenchCheck split_check = {.name = "a stroke on two placements changes the first one hit only"};
+    BenchCheck next_check = {.name = "the other placement is hit by the next stroke"};
+    BenchCheck own_check = {.name = "instances with their own range keep every hit"};
+    BenchCheck reject_check = {.name = "hits no hit placement claimed reject the stroke"};
+    BenchCheck counter_check = {.name = "counters match the bitmasks"};
+    BenchCheck recover_check = {.name = "split_aabb gives back every voxel of adjacent merged boxes once, as the loader does"};
+    BenchCheck pick_check = {.name = "a hit on a box face picks the voxel behind it through the instance transform"};
+    BenchCheck stroke_hit_check = {.name = "the hits of a stroke map to the voxels under them once the boxes are split"};
+
+    BenchRandom random = {};
+    std::vector<uint32_t> primitive_ids = {};
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        uint32_t primitive_count = 1 + random.next_below(300);
+        uint32_t placement_count = 2 + random.next_below(4);
+        uint32_t own_count = 1 + random.next_below(300);
+        StrokeScene scene(primitive_count, placement_count, {own_count});
+        uint32_t own_index = placement_count + 1;
+
+        uint32_t first = 1 + random.next_below(placement_count);
+        uint32_t second = 1 + (first + random.next_below(placement_count - 1)) % placement_count;
+
+        auto random_hits = [&](uint32_t count, uint32_t range) -> std::vector<uint32_t>
+        {
+            std::vector<uint32_t> ids(1 + random.next_below(count));
+            for (auto &id : ids)
+                id = random.next_below(range);
+            return ids;
+        };
+        std::vector<uint32_t> first_hits = random_hits(32, primitive_count);
+        std::vector<uint32_t> second_hits = random_hits(32, primitive_count);
+        std::vector<uint32_t> own_hits = random_hits(32, own_count);
+
+        // Dispatches interleaved after the first hit, overlapping hits in the shared range included
+        std::vector<std::pair<uint32_t, uint32_t>> stroke = {};
+        for (uint32_t id : first_hits)
+            stroke.push_back({first, id});
+        for (uint32_t id : second_hits)
+            stroke.push_back({second, id});
+        for (uint32_t id : own_hits)
+            stroke.push_back({own_index, id});
+        for (size_t i = stroke.size() - 1; i > 1; --i)
+            std::swap(stroke[i], stroke[1 + random.next_below(static_cast<uint32_t>(i))]);
+
+        bool claimed = true;
+        for (auto [instance_index, primitive_id] : stroke)
+            claimed = scene.hit(instance_index, primitive_id) == (instance_index != second) && claimed;
+        claim_check.add(claimed && !is_bit_set(scene.instance_bitmask.data(), second));
+        counter_check.add(scene.counters_match());
+
+        std::vector<uint8_t> prototype_voxels(primitive_count, 1);
+        auto voxels = split_placements(scene, prototype_voxels);
+        bool split = voxels.size() == placement_count + 1;
+        for (uint32_t i = 1; split && i <= placement_count; ++i)
+        {
+            if (i != first)
+            {
+                split = voxels[i] == prototype_voxels;
+                continue;
+            }
+            std::vector<uint32_t> deleted = {};
+            for (uint32_t id = 0; id < primitive_count; ++id)
+                if (voxels[i][id] == 0)
+                    deleted.push_back(id);
+            split = deleted == get_unique(first_hits);
+        }
+        split_check.add(split);
+
+        SharedRangeHits own_range = {.first_primitive_index = scene.instances[own_index].first_primitive_index, .primitive_count = own_count};
+        get_range_hits(own_range, scene.primitive_bitmask.data(), primitive_ids);
+        own_check.add(primitive_ids == get_unique(own_hits) && is_bit_set(scene.instance_bitmask.data(), own_index));
+
+        // Next stroke: the claims were released with the processed one
+        scene.end_stroke();
+        bool next = true;
+        for (uint32_t id : second_hits)
+            next = scene.hit(second, id) && next;
+        voxels = split_placements(scene, prototype_voxels);
+        next = next && voxels.size() == placement_count + 1 && voxels[first] == prototype_voxels;
+        if (next)
+        {
+            uint32_t deleted_count = static_cast<uint32_t>(std::count(voxels[second].begin(), voxels[second].end(), 0));
+            next = deleted_count == get_unique(second_hits).size();
+        }
+        next_check.add(next);
+        counter_check.add(scene.counters_match());
+
+        // Hits recorded without a claim, or under a claim of an instance the range doesn't belong to
+        scene.range_owners[scene.instances[0].first_primitive_index / BRUSH_RANGE_ALIGNMENT] = BRUSH_RANGE_UNCLAIMED;
+        reject_check.add(split_placements(scene, prototype_voxels).empty());
+        scene.range_owners[scene.instances[0].first_primitive_index / BRUSH_RANGE_ALIGNMENT] = own_index;
+        reject_check.add(split_placements(scene, prototype_voxels).empty());
+        scene.range_owners[scene.instances[0].first_primitive_index / BRUSH_RANGE_ALIGNMENT] = first;
+        reject_check.add(split_placements(scene, prototype_voxels).empty());
+
+        // Merged boxes: no voxel to box table, the voxels come back from the box AABBs & the hit positions
+        MergedGrid grid(random);
+        std::vector<uint8_t> recovered(grid.cells.size(), 0);
+        std::vector<AABB> voxel_aabbs = {};
+        bool recover = true;
+        uint32_t recovered_count = 0;
+        for (size_t b = 0; b < grid.boxes.size() && recover; ++b)
+        {
+            auto const &box = grid.boxes[b];
+            voxel_aabbs.resize(BoxMerger::aabb_voxel_count(grid.aabbs[b]));
+            uint32_t count = BoxMerger::split_aabb(grid.aabbs[b], voxel_aabbs.data());
+            recover = count == box.extent.x * box.extent.y * box.extent.z;
+            for (uint32_t v = 0; v < count && recover; ++v)
+            {
+                daxa_i32vec3 voxel = {static_cast<int32_t>(std::floor(voxel_aabbs[v].minimum.x / VOXEL_EXTENT + 0.5f)),
+                                      static_cast<int32_t>(std::floor(voxel_aabbs[v].minimum.y / VOXEL_EXTENT + 0.5f)),
+                                      static_cast<int32_t>(std::floor(voxel_aabbs[v].minimum.z / VOXEL_EXTENT + 0.5f))};
+                recover = grid.get_cell(voxel) == box.material_index + 1 && is_same_aabb(voxel_aabbs[v], get_voxel_aabb(voxel));
+                if (!recover)
+                    break;
+                size_t cell = ((voxel.z - grid.min.z) * grid.size.y + (voxel.y - grid.min.y)) * grid.size.x + (voxel.x - grid.min.x);
+                recover = recovered[cell]++ == 0;
+                ++recovered_count;
+            }
+        }
+        recover_check.add(recover && recovered_count == grid.voxel_count);
+
+        glm::vec3 axis = glm::normalize(glm::vec3(random.next_float(), random.next_float(), random.next_float()) + glm::vec3(1e-3f));
+        glm::mat4 obj2world = glm::translate(glm::mat4(1.0f), glm::vec3(random.next_float(), random.next_float(), random.next_float()) * 200.0f - 100.0f) *
+                              glm::rotate(glm::mat4(1.0f), random.next_float() * DAXA_2PI, axis) *
+                              glm::scale(glm::mat4(1.0f), glm::vec3(0.5f + 3.5f * random.next_float()));
+        // As the manager maps a hit: the instance transform is sent to the GPU & inverted back
+        glm::mat4 world2obj = glm::inverse(daxa_f32mat4x4_to_glm_mat4(glm_mat4_to_daxa_f32mat4x4(obj2world)));
+        auto to_object = [&](daxa_f32vec3 point) -> daxa_f32vec3
+        {
+            glm::vec3 world = glm::vec3(obj2world * glm::vec4(point.x, point.y, point.z, 1.0f));
+            glm::vec3 object = glm::vec3(world2obj * glm::vec4(world, 1.0f));
+            return {object.x, object.y, object.z};
+        };
+
+        // A stroke hitting random boxes, plain voxels by their bits & merged boxes by their hit positions too
+        SplitBoxes split_boxes = {.primitive_count = static_cast<uint32_t>(grid.aabbs.size())};
+        std::vector<uint32_t> hit_ids = {};
+        std::vector<AABB> hit_aabbs = {};
+        bool pick = true;
+        for (uint32_t box_id = 0; box_id < grid.aabbs.size(); ++box_id)
+        {
+            if (random.next_below(3) != 0)
+                continue;
+            AABB const &aabb = grid.aabbs[box_id];
+            if (!BoxMerger::is_merged_aabb(aabb))
+            {
+                hit_ids.push_back(box_id);
+                hit_aabbs.push_back(aabb);
+                continue;
+            }
+
+            split_boxes.add_box(box_id, BoxMerger::aabb_voxel_count(aabb));
+            voxel_aabbs.resize(BoxMerger::aabb_voxel_count(aabb));
+            BoxMerger::split_aabb(aabb, voxel_aabbs.data());
+            for (uint32_t h = 1 + random.next_below(4); h > 0; --h)
+            {
+                uint32_t voxel_index = 0;
+                daxa_f32vec3 point = get_face_point(random, aabb, voxel_index);
+                daxa_f32vec3 position = to_object(point);
+                pick = BoxMerger::get_voxel_index(aabb, point) == voxel_index && BoxMerger::get_voxel_index(aabb, position) == voxel_index && pick;
+                hit_aabbs.push_back(voxel_aabbs[voxel_index]);
+                hit_ids.push_back(get_split_hit_id(split_boxes, box_id, aabb, position));
+            }
+        }
+        pick_check.add(pick);
+
+        // Voxels under the hits in the split instance, each once
+        std::vector<AABB> split_aabbs = get_split_aabbs(grid.aabbs, split_boxes);
+        hit_ids = get_unique(hit_ids);
+        bool stroke_hits = split_aabbs.size() == split_boxes.get_split_primitive_count();
+        std::vector<AABB> deleted_aabbs = {};
+        for (uint32_t hit_id : hit_ids)
+        {
+            stroke_hits = stroke_hits && hit_id < split_aabbs.size();
+            if (!stroke_hits)
+                break;
+            deleted_aabbs.push_back(split_aabbs[hit_id]);
+        }
+        auto aabb_less = [](AABB const &a, AABB const &b)
+        {
+            return std::memcmp(&a, &b, sizeof(AABB)) < 0;
+        };
+        std::sort(hit_aabbs.begin(), hit_aabbs.end(), aabb_less);
+        hit_aabbs.erase(std::unique(hit_aabbs.begin(), hit_aabbs.end(), is_same_aabb), hit_aabbs.end());
+        std::sort(deleted_aabbs.begin(), deleted_aabbs.end(), aabb_less);
+        stroke_hits = stroke_hits && deleted_aabbs.size() == hit_aabbs.size() &&
+                      std::equal(deleted_aabbs.begin(), deleted_aabbs.end(), hit_aabbs.begin(), is_same_aabb);
+        stroke_hit_check.add(stroke_hits);
+    }
+
+    return report_checks<BenchCheck>({&claim_check, &split_check, &next_check, &own_check, &reject_check, &counter_check,
+                                      &recover_check, &pick_check, &stroke_hit_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"brush\",\n";
+    out << "  \"primitives\": " << settings.primitive_count << ",\n";
+    out << "  \"placements\": " << settings.placement_count << ",\n";
+    out << "  \"hits\": " << settings.hit_count << ",\n";
+    out << "  \"hit_ns\": " << result.hit_ns << ",\n";
+    out << "  \"map_ms\": " << result.map_ms << ",\n";
+    out << "  \"recorded_hits\": " << result.recorded_hits << ",\n";
+    out << "  \"skipped_hits\": " << result.skipped_hits << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "stroke: " << settings.hit_count << " hits on " << settings.placement_count << " placements of a " << settings.primitive_count
+        << " primitive model & an instance of the same size" << std::endl;
+    out << "hit: " << result.hit_ns << " ns (claim & bits), " << result.recorded_hits << " primitives recorded, " << result.skipped_hits
+        << " hits left to the next strokes" << std::endl;
+    out << "prototype range to its owner: " << result.map_ms << " ms" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--primitives N] [--placements N] [--hits N] [--repeat N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--primitives"))
+            settings.primitive_count = args.get_uint(1);
+        else if (args.is("--placements"))
+            settings.placement_count = args.get_uint(1);
+        else if (args.is("--hits"))
+            settings.hit_count = args.get_uint(1);
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count) ? 0 : 1;
+
+    BenchResult result = measure(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return 0;
+}
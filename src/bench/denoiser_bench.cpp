@@ -0,0 +1,617 @@
+// Denoiser benchmark & checks.
+// Renders a camera pan into the room of bench_scene.hpp (small cube lights & the sky) at one sample per pixel per frame
+// with the CPU reference, splitting the first hit of every pixel into emission, direct & indirect light the way the
+// shading pass does, with the VELOCITY of every hit from the previous camera. The last frame is compared with a
+// converged reference raw, accumulated by the temporal pass of denoiser.hpp alone (the TAA-like baseline) and through
+// the whole SVGF denoiser; the samples per pixel a raw image needs to reach the relMSE of the denoised one give the
+// budget it saves.
+// --verify N checks the filter on N random synthetic frames & on the room: noise free images going through unchanged,
+// the mean of flat noise kept while its error drops, the history against a hand computed exponential average & its
+// length cap, histories dropped on disocclusions, reprojection of a moving image, the variance estimate against the
+// variance of the noise, the velocities of a still camera and frames independent of the thread count. The exit code is
+// not 0 when one fails, or in the default mode when the denoised image isn't closer to the reference than both others.
+//
+// usage: denoiser_bench [--verify N] [--frames N] [--width N] [--height N] [--reference-spp N] [--max-spp N]
+//                       [--iterations N] [--threads N] [--json out.json]
+
+#include "bench_common.hpp"
+#include "bench_scene.hpp"
+#include "host_accel.hpp"
+#include "image_metrics.hpp"
+#include "denoiser.hpp"
+#include "sampler.hpp"
+
+//////////////////////////////// FRAMES //////////////////////////////////////
+
+// What the shading pass leaves for the denoiser, plus the whole sample
+struct FrameInputs
+{
+    std::vector<glm::vec3> direct = {};
+    std::vector<glm::vec3> indirect = {};
+    std::vector<DIRECT_ILLUMINATION_INFO> gbuffer = {};
+    std::vector<VELOCITY> velocities = {};
+    std::vector<glm::vec3> image = {};
+    uint64_t ray_count = 0;
+};
+
+// Pixel (row major, top row first, pixel centers at integers) where a camera sees a world position
+static glm::vec2 get_pixel_position(HostCamera const &camera, glm::vec3 position, uint32_t width, uint32_t height)
+{
+    glm::vec4 clip = glm::inverse(camera.inv_proj) * (glm::inverse(camera.inv_view) * glm::vec4(position, 1.0f));
+    glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+    return (ndc * 0.5f + 0.5f) * glm::vec2(width, height) - 0.5f;
+}
+
+// Sample frame of every pixel, velocities point to where the hits were seen from the previous camera
+static void render_frame(ReferenceTracer const &tracer, HostCamera const &camera, HostCamera const &previous_camera, uint32_t frame,
+                         FrameInputs &inputs, TilePool &pool)
+{
+    uint32_t width = tracer.get_settings().width, height = tracer.get_settings().height;
+    size_t pixel_count = static_cast<size_t>(width) * height;
+    inputs.direct.assign(pixel_count, glm::vec3(0.0f));
+    inputs.indirect.assign(pixel_count, glm::vec3(0.0f));
+    inputs.gbuffer.assign(pixel_count, DIRECT_ILLUMINATION_INFO{});
+    inputs.velocities.assign(pixel_count, VELOCITY{});
+    inputs.image.assign(pixel_count, glm::vec3(0.0f));
+
+    std::atomic<uint64_t> ray_count = 0;
+    pool.run(height, [&](uint32_t y, uint32_t)
+             {
+        uint64_t row_rays = 0;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            size_t i = static_cast<size_t>(y) * width + x;
+            HostPrimarySample primary = {};
+            inputs.image[i] = tracer.trace_sample(x, y, frame, camera, row_rays, &primary);
+            if (!primary.is_hit)
+                continue;
+            inputs.direct[i] = primary.direct;
+            inputs.indirect[i] = primary.indirect;
+            inputs.gbuffer[i].position = to_daxa(primary.position);
+            inputs.gbuffer[i].distance = primary.distance;
+            inputs.gbuffer[i].normal = to_daxa(primary.normal);
+            inputs.gbuffer[i].mat_index = primary.material_index;
+            glm::vec2 velocity = get_pixel_position(previous_camera, primary.position, width, height) - glm::vec2(x, y);
+            inputs.velocities[i].velocity = {velocity.x, velocity.y};
+        }
+        ray_count += row_rays; });
+    inputs.ray_count = ray_count;
+}
+
+//////////////////////////////// BENCH //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t width = 96;
+    uint32_t height = 64;
+    uint32_t reference_spp = 1024;
+    uint32_t frame_count = 16;
+    uint32_t max_spp = 64; // of the raw images the denoised one is matched with
+    uint32_t atrous_iterations = DENOISER_ATROUS_ITERATIONS;
+    uint32_t thread_count = 0;
+};
+
+struct SppPoint
+{
+    uint32_t spp = 0;
+    double rel_mse = 0.0;
+};
+
+struct BenchResult
+{
+    uint32_t primitive_count = 0;
+    double reference_ms = 0.0;
+    double render_ms = 0.0;   // frame inputs of every frame
+    double temporal_ms = 0.0; // temporal pass alone, every frame
+    double denoise_ms = 0.0;  // whole denoiser, every frame
+    double raw_rel_mse = 0.0;
+    double temporal_rel_mse = 0.0;
+    double denoised_rel_mse = 0.0;
+    std::vector<SppPoint> spp_curve = {};
+    double equal_quality_spp = 0.0; // raw samples per pixel matching the denoised relMSE, -1 past max_spp
+};
+
+static ReferenceSettings get_reference_settings(uint32_t width, uint32_t height)
+{
+    ReferenceSettings reference_settings = {};
+    reference_settings.width = width;
+    reference_settings.height = height;
+    reference_settings.max_depth = 3;
+    // Pixel centers & the sampler of the shaders
+    reference_settings.sampler_type = SAMPLER_TYPE;
+    return reference_settings;
+}
+
+// Camera of frame f of a pan ending at yaw 0
+static HostCamera get_pan_camera(HostScene const &scene, uint32_t width, uint32_t height, uint32_t frame, uint32_t frame_count)
+{
+    float pan = 0.25f;
+    float t = frame_count > 1 ? static_cast<float>(frame) / static_cast<float>(frame_count - 1) : 1.0f;
+    return frame_room(scene, width, height, -pan * (1.0f - t));
+}
+
+static BenchResult measure(BenchSettings const &settings, TilePool &pool)
+{
+    HostScene scene = {};
+    build_room(scene);
+    HostAccel accel = {};
+    accel.build(scene, pool);
+    uint32_t width = settings.width, height = settings.height;
+    HostCamera final_camera = get_pan_camera(scene, width, height, settings.frame_count - 1, settings.frame_count);
+
+    BenchResult result = {};
+    result.primitive_count = scene.get_primitive_count();
+
+    // The reference & the raw images start far past the samples of the frames
+    ReferenceSettings reference_settings = get_reference_settings(width, height);
+    reference_settings.samples_per_pixel = settings.reference_spp;
+    reference_settings.first_sample = 1U << 20;
+    std::vector<glm::vec3> reference = {};
+    result.reference_ms = ReferenceTracer(accel, reference_settings).render(final_camera, pool, reference).render_ms;
+
+    ReferenceTracer tracer(accel, get_reference_settings(width, height));
+    HostDenoiser temporal(width, height, DenoiserSettings{.atrous_iterations = 0});
+    HostDenoiser denoiser(width, height, DenoiserSettings{.atrous_iterations = settings.atrous_iterations});
+    FrameInputs inputs = {};
+    std::vector<glm::vec3> temporal_image = {}, denoised_image = {};
+    HostCamera previous_camera = get_pan_camera(scene, width, height, 0, settings.frame_count);
+    for (uint32_t frame = 0; frame < settings.frame_count; ++frame)
+    {
+        HostCamera camera = get_pan_camera(scene, width, height, frame, settings.frame_count);
+        auto start = std::chrono::high_resolution_clock::now();
+        render_frame(tracer, camera, previous_camera, frame, inputs, pool);
+        result.render_ms += elapsed_ms(start);
+        temporal_image = inputs.image;
+        start = std::chrono::high_resolution_clock::now();
+        temporal.frame(inputs.direct, inputs.indirect, inputs.gbuffer, inputs.velocities, scene.materials, temporal_image, pool);
+        result.temporal_ms += elapsed_ms(start);
+        denoised_image = inputs.image;
+        start = std::chrono::high_resolution_clock::now();
+        denoiser.frame(inputs.direct, inputs.indirect, inputs.gbuffer, inputs.velocities, scene.materials, denoised_image, pool);
+        result.denoise_ms += elapsed_ms(start);
+        previous_camera = camera;
+    }
+    result.raw_rel_mse = compare_images(reference, inputs.image, width, height, pool).rel_mse;
+    result.temporal_rel_mse = compare_images(reference, temporal_image, width, height, pool).rel_mse;
+    result.denoised_rel_mse = compare_images(reference, denoised_image, width, height, pool).rel_mse;
+
+    // Raw images of 1, 2, 4... samples per pixel at the last camera
+    std::vector<ConvergencePoint> curve = {};
+    for (uint32_t spp = 1; spp <= settings.max_spp; spp *= 2)
+    {
+        ReferenceSettings raw_settings = get_reference_settings(width, height);
+        raw_settings.samples_per_pixel = spp;
+        raw_settings.first_sample = 1U << 16;
+        std::vector<glm::vec3> image = {};
+        ReferenceTracer(accel, raw_settings).render(final_camera, pool, image);
+        double rel_mse = compare_images(reference, image, width, height, pool).rel_mse;
+        result.spp_curve.push_back(SppPoint{.spp = spp, .rel_mse = rel_mse});
+        ConvergencePoint point = {.cost = static_cast<double>(spp)};
+        point.metrics.rel_mse = rel_mse;
+        curve.push_back(point);
+    }
+    result.equal_quality_spp = get_time_to_error(curve, result.denoised_rel_mse);
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+// Synthetic frame: every pixel hits a plane facing the camera at distance 1 with material 0
+struct SyntheticFrame
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    FrameInputs inputs = {};
+
+    SyntheticFrame(uint32_t width, uint32_t height) : width(width), height(height)
+    {
+        size_t pixel_count = static_cast<size_t>(width) * height;
+        inputs.direct.assign(pixel_count, glm::vec3(0.0f));
+        inputs.indirect.assign(pixel_count, glm::vec3(0.0f));
+        inputs.gbuffer.assign(pixel_count, DIRECT_ILLUMINATION_INFO{});
+        inputs.velocities.assign(pixel_count, VELOCITY{});
+        inputs.image.assign(pixel_count, glm::vec3(-1.0f));
+        for (auto &di_info : inputs.gbuffer)
+        {
+            di_info.distance = 1.0f;
+            di_info.normal = {0.0f, 0.0f, 1.0f};
+        }
+    }
+
+    auto get_index(uint32_t x, uint32_t y) const -> size_t { return static_cast<size_t>(y) * width + x; }
+
+    void denoise(HostDenoiser &denoiser, std::vector<MATERIAL> const &materials, TilePool &pool)
+    {
+        denoiser.frame(inputs.direct, inputs.indirect, inputs.gbuffer, inputs.velocities, materials, inputs.image, pool);
+    }
+};
+
+static double get_luminance_variance(std::vector<glm::vec3> const &image, double mean)
+{
+    double variance = 0.0;
+    for (glm::vec3 const &color : image)
+    {
+        double d = host_denoiser_get_luminance(color) - mean;
+        variance += d * d;
+    }
+    return variance / static_cast<double>(image.size());
+}
+
+static double get_mean_luminance(std::vector<glm::vec3> const &image)
+{
+    double sum = 0.0;
+    for (glm::vec3 const &color : image)
+        sum += host_denoiser_get_luminance(color);
+    return sum / static_cast<double>(image.size());
+}
+
+static bool verify(uint32_t trial_count, uint32_t thread_count)
+{
+    BenchCheck clean_check = {.name = "noise free images go through unchanged"};
+    BenchCheck noise_check = {.name = "flat noise keeps its mean & loses its error"};
+    BenchCheck history_check = {.name = "history is the capped exponential average"};
+    BenchCheck disocclusion_check = {.name = "histories dropped on disocclusions"};
+    BenchCheck reprojection_check = {.name = "moving images follow their velocities"};
+    BenchCheck variance_check = {.name = "variance estimate within 25% of the noise"};
+    BenchCheck velocity_check = {.name = "still camera has no velocity"};
+    BenchCheck thread_check = {.name = "frames independent of the thread count"};
+
+    BenchRandom random = {};
+    auto random_color = [&]()
+    {
+        return glm::vec3(0.05f + random.next_float(), 0.05f + random.next_float(), 0.05f + random.next_float());
+    };
+
+    TilePool one_thread(1);
+    TilePool pool(thread_count);
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        uint32_t width = 8 + random.next_below(40), height = 8 + random.next_below(40);
+        std::vector<MATERIAL> materials = {
+            make_material(MATERIAL_TYPE_LAMBERTIAN, random_color()),
+            make_material(MATERIAL_TYPE_LAMBERTIAN, random_color(), random.next_float() < 0.5f ? glm::vec3(0.0f) : random_color()),
+        };
+
+        // Noise free: constant light on the left of a random column, other constant light on a wall of another material
+        // facing right beyond it, on a distance ramp
+        {
+            SyntheticFrame frame(width, height);
+            uint32_t split = 1 + random.next_below(width - 1);
+            glm::vec3 left_direct = random_color(), left_indirect = random_color() * 0.5f;
+            glm::vec3 right_direct = random_color() * 2.0f, right_indirect = random_color();
+            float slope = random.next_float() * 0.02f;
+            for (uint32_t y = 0; y < height; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    size_t i = frame.get_index(x, y);
+                    bool left = x < split;
+                    frame.inputs.direct[i] = left ? left_direct : right_direct;
+                    frame.inputs.indirect[i] = left ? left_indirect : right_indirect;
+                    frame.inputs.gbuffer[i].distance = 1.0f + slope * static_cast<float>(x);
+                    frame.inputs.gbuffer[i].normal = left ? daxa_f32vec3(0.0f, 0.0f, 1.0f) : daxa_f32vec3(1.0f, 0.0f, 0.0f);
+                    frame.inputs.gbuffer[i].mat_index = left ? 0 : 1;
+                }
+            HostDenoiser denoiser(width, height);
+            for (uint32_t f = 0; f < 3; ++f)
+            {
+                frame.denoise(denoiser, materials, pool);
+                for (uint32_t y = 0; y < height; ++y)
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        size_t i = frame.get_index(x, y);
+                        MATERIAL const &mat = materials[frame.inputs.gbuffer[i].mat_index];
+                        glm::vec3 expected = frame.inputs.direct[i] + frame.inputs.indirect[i] + to_glm(mat.emission);
+                        glm::vec3 color = frame.inputs.image[i];
+                        clean_check.add(is_close(color.x, expected.x, 1e-4) && is_close(color.y, expected.y, 1e-4) && is_close(color.z, expected.z, 1e-4));
+                    }
+            }
+
+            // Misses keep what the shading pass wrote
+            frame.inputs.gbuffer[0].distance = 0.0f;
+            frame.inputs.image[0] = glm::vec3(7.0f);
+            frame.denoise(denoiser, materials, pool);
+            clean_check.add(frame.inputs.image[0] == glm::vec3(7.0f));
+        }
+
+        // Flat grey noise of a known mean
+        {
+            SyntheticFrame frame(width, height);
+            std::vector<MATERIAL> grey = {make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(1.0f))};
+            float mean = 0.2f + random.next_float(), spread = mean * (0.5f + random.next_float());
+            std::vector<glm::vec3> noisy(frame.inputs.direct.size());
+            for (size_t i = 0; i < noisy.size(); ++i)
+            {
+                noisy[i] = glm::vec3(mean + spread * (random.next_float() - 0.5f));
+                frame.inputs.direct[i] = noisy[i];
+            }
+            HostDenoiser denoiser(width, height);
+            frame.denoise(denoiser, grey, pool);
+            double noisy_mean = get_mean_luminance(noisy), denoised_mean = get_mean_luminance(frame.inputs.image);
+            noise_check.add(is_close(denoised_mean, noisy_mean, 0.05));
+            noise_check.add(get_luminance_variance(frame.inputs.image, mean) < 0.25 * get_luminance_variance(noisy, mean));
+        }
+
+        // A still constant image of a new value every frame, the history by hand
+        {
+            SyntheticFrame frame(width, height);
+            glm::vec3 albedo = host_denoiser_get_albedo(materials[0]);
+            HostDenoiser denoiser(width, height);
+            glm::vec3 expected = glm::vec3(0.0f);
+            uint32_t frame_count = DENOISER_MAX_HISTORY + 8;
+            for (uint32_t f = 0; f < frame_count; ++f)
+            {
+                glm::vec3 value = random_color();
+                std::fill(frame.inputs.direct.begin(), frame.inputs.direct.end(), value);
+                frame.denoise(denoiser, materials, pool);
+                float length = std::min(static_cast<float>(f + 1), static_cast<float>(DENOISER_MAX_HISTORY));
+                float alpha = f == 0 ? 1.0f : std::max(DENOISER_COLOR_ALPHA, 1.0f / length);
+                expected = expected + (value / albedo - expected) * alpha;
+                DENOISER_HISTORY const &history = denoiser.get_history(random.next_below(width), random.next_below(height));
+                glm::vec3 direct = to_glm(history.direct);
+                history_check.add(history.history_length == length);
+                history_check.add(is_close(direct.x, expected.x, 1e-4) && is_close(direct.y, expected.y, 1e-4) && is_close(direct.z, expected.z, 1e-4));
+            }
+        }
+
+        // History of a surface, then another material or a distance jump on a random block
+        {
+            SyntheticFrame frame(width, height);
+            glm::vec3 albedo = host_denoiser_get_albedo(materials[1]);
+            HostDenoiser denoiser(width, height, DenoiserSettings{.atrous_iterations = 0});
+            for (uint32_t f = 0; f < 6; ++f)
+            {
+                std::fill(frame.inputs.direct.begin(), frame.inputs.direct.end(), random_color());
+                frame.denoise(denoiser, materials, pool);
+            }
+            uint32_t x0 = random.next_below(width / 2), y0 = random.next_below(height / 2);
+            bool material_change = random.next_below(2) == 0;
+            glm::vec3 value = random_color();
+            for (uint32_t y = y0; y < y0 + height / 2; ++y)
+                for (uint32_t x = x0; x < x0 + width / 2; ++x)
+                {
+                    size_t i = frame.get_index(x, y);
+                    if (material_change)
+                        frame.inputs.gbuffer[i].mat_index = 1;
+                    else
+                        frame.inputs.gbuffer[i].distance = 1.5f;
+                    frame.inputs.direct[i] = value;
+                }
+            frame.denoise(denoiser, materials, pool);
+            for (uint32_t y = 0; y < height; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    bool inside = x >= x0 && x < x0 + width / 2 && y >= y0 && y < y0 + height / 2;
+                    DENOISER_HISTORY const &history = denoiser.get_history(x, y);
+                    if (!inside)
+                    {
+                        disocclusion_check.add(history.history_length == 7.0f);
+                        continue;
+                    }
+                    glm::vec3 expected = value / (material_change ? albedo : host_denoiser_get_albedo(materials[0]));
+                    glm::vec3 direct = to_glm(history.direct);
+                    disocclusion_check.add(history.history_length == 1.0f);
+                    disocclusion_check.add(is_close(direct.x, expected.x, 1e-5) && is_close(direct.y, expected.y, 1e-5) && is_close(direct.z, expected.z, 1e-5));
+                }
+        }
+
+        // A pattern sliding shift pixels right every frame: pixel x came from x - shift, histories keep the pattern
+        {
+            SyntheticFrame frame(width, height);
+            std::vector<glm::vec3> pattern(64);
+            for (glm::vec3 &color : pattern)
+                color = random_color();
+            int32_t shift = 1 + static_cast<int32_t>(random.next_below(3));
+            glm::vec3 albedo = host_denoiser_get_albedo(materials[0]);
+            HostDenoiser follow(width, height, DenoiserSettings{.atrous_iterations = 0});
+            HostDenoiser still(width, height, DenoiserSettings{.atrous_iterations = 0});
+            SyntheticFrame still_frame = frame;
+            uint32_t frame_count = 5;
+            for (uint32_t f = 0; f < frame_count; ++f)
+            {
+                for (uint32_t y = 0; y < height; ++y)
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        size_t i = frame.get_index(x, y);
+                        int32_t u = static_cast<int32_t>(x) - shift * static_cast<int32_t>(f);
+                        frame.inputs.direct[i] = pattern[((u % 64) + 64 + y) % 64];
+                        frame.inputs.velocities[i].velocity = {-static_cast<float>(shift), 0.0f};
+                    }
+                still_frame.inputs.direct = frame.inputs.direct;
+                frame.denoise(follow, materials, pool);
+                still_frame.denoise(still, materials, pool);
+            }
+            uint32_t differing = 0;
+            for (uint32_t y = 0; y < height; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    DENOISER_HISTORY const &history = follow.get_history(x, y);
+                    glm::vec3 expected = frame.inputs.direct[frame.get_index(x, y)] / albedo;
+                    glm::vec3 direct = to_glm(history.direct);
+                    // The history of a pixel is as old as the frames its surface has been on screen
+                    uint32_t age = std::min<uint32_t>(x / shift + 1, frame_count);
+                    reprojection_check.add(history.history_length == static_cast<float>(age));
+                    reprojection_check.add(is_close(direct.x, expected.x, 1e-4) && is_close(direct.y, expected.y, 1e-4) && is_close(direct.z, expected.z, 1e-4));
+                    glm::vec3 smeared = to_glm(still.get_history(x, y).direct);
+                    differing += is_close(smeared.x, expected.x, 1e-4) && is_close(smeared.y, expected.y, 1e-4) && is_close(smeared.z, expected.z, 1e-4) ? 0 : 1;
+                }
+            // Ignoring the velocity mixes the pattern, so the checks above see the reprojection
+            reprojection_check.add(differing > 0);
+        }
+
+        // Still noise: the moments give the variance of the noise, the exponential average loses alpha / (2 - alpha)
+        {
+            SyntheticFrame frame(width, height);
+            std::vector<MATERIAL> grey = {make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(1.0f))};
+            float mean = 0.2f + random.next_float(), spread = mean * (0.5f + random.next_float());
+            HostDenoiser denoiser(width, height, DenoiserSettings{.atrous_iterations = 0});
+            for (uint32_t f = 0; f < 64; ++f)
+            {
+                for (glm::vec3 &direct : frame.inputs.direct)
+                    direct = glm::vec3(mean + spread * (random.next_float() - 0.5f));
+                frame.denoise(denoiser, grey, pool);
+            }
+            double estimate = 0.0;
+            for (uint32_t y = 0; y < height; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                    estimate += denoiser.get_variance(x, y).x;
+            estimate /= static_cast<double>(width) * height;
+            double expected = spread * spread / 12.0 * (1.0 - DENOISER_MOMENTS_ALPHA / (2.0 - DENOISER_MOMENTS_ALPHA));
+            variance_check.add(is_close(estimate, expected, 0.25));
+        }
+    }
+
+    // Frames of the room
+    HostScene scene = {};
+    build_room(scene);
+    HostAccel accel = {};
+    accel.build(scene, pool);
+    uint32_t width = 40, height = 28;
+    ReferenceTracer tracer(accel, get_reference_settings(width, height));
+
+    // The same camera twice sees every hit where it is
+    {
+        HostCamera camera = frame_room(scene, width, height, 0.1f);
+        FrameInputs inputs = {};
+        render_frame(tracer, camera, camera, 0, inputs, pool);
+        uint32_t hit_count = 0;
+        for (size_t i = 0; i < inputs.gbuffer.size(); ++i)
+        {
+            if (inputs.gbuffer[i].distance <= 0.0f)
+                continue;
+            ++hit_count;
+            velocity_check.add(std::abs(inputs.velocities[i].velocity.x) < 1e-2f && std::abs(inputs.velocities[i].velocity.y) < 1e-2f);
+        }
+        velocity_check.add(hit_count > 0);
+
+        // A camera turned a bit moves the hits
+        HostCamera turned = frame_room(scene, width, height, 0.12f);
+        render_frame(tracer, turned, camera, 0, inputs, pool);
+        double mean_motion = 0.0;
+        for (size_t i = 0; i < inputs.gbuffer.size(); ++i)
+            mean_motion += inputs.gbuffer[i].distance > 0.0f ? std::abs(inputs.velocities[i].velocity.x) : 0.0f;
+        velocity_check.add(mean_motion > 0.1 * hit_count);
+    }
+
+    // Same bits with one thread as with the pool
+    {
+        HostDenoiser a(width, height), b(width, height);
+        FrameInputs inputs_a = {}, inputs_b = {};
+        HostCamera previous_camera = get_pan_camera(scene, width, height, 0, 6);
+        for (uint32_t frame = 0; frame < 6; ++frame)
+        {
+            HostCamera camera = get_pan_camera(scene, width, height, frame, 6);
+            render_frame(tracer, camera, previous_camera, frame, inputs_a, one_thread);
+            render_frame(tracer, camera, previous_camera, frame, inputs_b, pool);
+            a.frame(inputs_a.direct, inputs_a.indirect, inputs_a.gbuffer, inputs_a.velocities, scene.materials, inputs_a.image, one_thread);
+            b.frame(inputs_b.direct, inputs_b.indirect, inputs_b.gbuffer, inputs_b.velocities, scene.materials, inputs_b.image, pool);
+            thread_check.add(inputs_a.ray_count == inputs_b.ray_count);
+            thread_check.add(std::memcmp(inputs_a.image.data(), inputs_b.image.data(), inputs_a.image.size() * sizeof(glm::vec3)) == 0);
+            previous_camera = camera;
+        }
+    }
+
+    return report_checks<BenchCheck>({&clean_check, &noise_check, &history_check, &disocclusion_check, &reprojection_check, &variance_check, &velocity_check, &thread_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static bool is_passing(BenchResult const &result)
+{
+    return result.denoised_rel_mse < result.temporal_rel_mse && result.denoised_rel_mse < result.raw_rel_mse;
+}
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"width\": " << settings.width << ",\n";
+    out << "  \"height\": " << settings.height << ",\n";
+    out << "  \"frames\": " << settings.frame_count << ",\n";
+    out << "  \"atrous_iterations\": " << settings.atrous_iterations << ",\n";
+    out << "  \"reference_spp\": " << settings.reference_spp << ",\n";
+    out << "  \"reference_ms\": " << result.reference_ms << ",\n";
+    out << "  \"render_ms\": " << result.render_ms << ",\n";
+    out << "  \"temporal_ms\": " << result.temporal_ms << ",\n";
+    out << "  \"denoise_ms\": " << result.denoise_ms << ",\n";
+    out << "  \"raw_rel_mse\": " << result.raw_rel_mse << ",\n";
+    out << "  \"temporal_rel_mse\": " << result.temporal_rel_mse << ",\n";
+    out << "  \"denoised_rel_mse\": " << result.denoised_rel_mse << ",\n";
+    out << "  \"spp_curve\": [";
+    for (size_t p = 0; p < result.spp_curve.size(); ++p)
+        out << (p == 0 ? "" : ", ") << "{\"spp\": " << result.spp_curve[p].spp << ", \"rel_mse\": " << result.spp_curve[p].rel_mse << "}";
+    out << "],\n";
+    out << "  \"equal_quality_spp\": " << result.equal_quality_spp << ",\n";
+    out << "  \"passed\": " << (is_passing(result) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "room: " << result.primitive_count << " voxels, " << settings.width << "x" << settings.height << ", " << settings.frame_count
+        << " frames of 1 spp, reference " << settings.reference_spp << " spp in " << result.reference_ms << " ms" << std::endl;
+    out << "image         relMSE        ms (all frames)" << std::endl;
+    auto row = [&](char const *name, double rel_mse, double ms)
+    {
+        write_cell(out, name, 14);
+        write_cell(out, rel_mse, 14);
+        out << ms << std::endl;
+    };
+    row("raw", result.raw_rel_mse, result.render_ms);
+    row("temporal", result.temporal_rel_mse, result.temporal_ms);
+    row("denoised", result.denoised_rel_mse, result.denoise_ms);
+    out << "raw spp:";
+    for (SppPoint const &point : result.spp_curve)
+        out << " " << point.spp << " -> " << point.rel_mse << ",";
+    out << std::endl;
+    if (result.equal_quality_spp > 0.0)
+        out << "denoised 1 spp matches raw " << result.equal_quality_spp << " spp" << std::endl;
+    else
+        out << "denoised 1 spp beats raw " << settings.max_spp << " spp" << std::endl;
+    out << (is_passing(result) ? "passed" : "FAILED") << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--frames N] [--width N] [--height N] [--reference-spp N] [--max-spp N] [--iterations N] [--threads N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--frames"))
+            settings.frame_count = args.get_uint(1);
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--reference-spp"))
+            settings.reference_spp = args.get_uint(1);
+        else if (args.is("--max-spp"))
+            settings.max_spp = args.get_uint(1);
+        else if (args.is("--iterations"))
+            settings.atrous_iterations = args.get_uint(1);
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.thread_count) ? 0 : 1;
+
+    TilePool pool(settings.thread_count);
+    BenchResult result = measure(settings, pool);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return is_passing(result) ? 0 : 1;
+}
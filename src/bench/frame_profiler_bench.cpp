@@ -0,0 +1,796 @@
+// Frame profiler benchmark & checks.
+// Replays synthetic frames through FrameProfiler (frame_profiler.hpp): CPU scopes nested like update() & draw() of
+// main.cpp and GPU passes resolved from a fake timestamp query pool, then times a CPU scope pair (with & without
+// reading the clock), the GPU scopes & resolve of a frame, the statistics of every scope and the Chrome trace export,
+// and prints the statistics of the replay. --trace writes its Chrome trace.
+// --verify N checks on N random sequences: percentiles & means against a sorted reference, the rolling window, per
+// frame sums of repeated scopes, nesting of the trace events, query indices & resolved durations, frames dropped on
+// missing & reversed timestamps, the query budget, the trace cap and the trace JSON parsed back (escaped names). The
+// exit code is not 0 when one fails.
+//
+// usage: frame_profiler_bench [--verify N] [--frames N] [--repeat N] [--seed N] [--trace out.json] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "frame_profiler.hpp"
+#include "sampler.hpp"
+
+#include <cctype>
+#include <map>
+#include <variant>
+
+//////////////////////////////// REPLAY //////////////////////////////////////
+
+// Random CPU & GPU durations of the replayed frames
+struct SampleSource : BenchRandom
+{
+    // Microseconds in [min_us, max_us)
+    auto next_us(double min_us, double max_us) -> double { return min_us + (max_us - min_us) * next_float(); }
+};
+
+// Timestamp query pool on the host: values & availability, read back like VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+struct FakeQueryPool
+{
+    std::vector<uint64_t> values = {};
+    std::vector<uint64_t> available = {};
+
+    explicit FakeQueryPool(uint32_t query_count) : values(query_count, 0), available(query_count, 0) {}
+
+    void reset(ProfileQueryRange range)
+    {
+        for (uint32_t i = range.first; i < range.first + range.count; ++i)
+            available[i] = 0;
+    }
+
+    void write(uint32_t query, uint64_t ticks)
+    {
+        if (query == PROFILER_INVALID_QUERY)
+            return;
+        values[query] = ticks;
+        available[query] = 1;
+    }
+
+    auto read(uint32_t first, uint32_t count) const -> std::vector<uint64_t>
+    {
+        std::vector<uint64_t> results(2 * static_cast<size_t>(count));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            results[2 * i] = values[first + i];
+            results[2 * i + 1] = available[first + i];
+        }
+        return results;
+    }
+};
+
+static char const *const GPU_PASSES[] = {"uploads", "primary_rays", "shading_rays", "denoiser_temporal", "denoiser_atrous",
+                                         "denoiser_atrous", "denoiser_atrous", "taa", "camera_history_copy"};
+
+struct Replay
+{
+    double time_us = 0.0;
+    uint64_t ticks = 1000;
+    double timestamp_period_ns = 1.0;
+};
+
+// One frame of update(): its CPU scopes with explicit times, then its GPU passes written in the fake pool
+static void replay_frame(FrameProfiler &profiler, FakeQueryPool &pool, Replay &replay, SampleSource &source, uint64_t frame)
+{
+    auto cpu_scope = [&](char const *name, double min_us, double max_us)
+    {
+        profiler.begin_cpu_scope(name, replay.time_us);
+        replay.time_us += source.next_us(min_us, max_us);
+        profiler.end_cpu_scope(replay.time_us);
+    };
+
+    profiler.begin_frame(replay.time_us);
+    cpu_scope("stream_scene", 5.0, 50.0);
+    cpu_scope("update_scene", 20.0, 400.0);
+    cpu_scope("upload_world", 5.0, 30.0);
+
+    profiler.begin_cpu_scope("draw", replay.time_us);
+    cpu_scope("acquire", 10.0, 3000.0);
+    ProfileQueryRange range = profiler.begin_gpu_frame(frame, replay.timestamp_period_ns, [&](uint32_t first, uint32_t count)
+                                                       { return pool.read(first, count); });
+    pool.reset(range);
+    for (char const *pass : GPU_PASSES)
+    {
+        pool.write(profiler.begin_gpu_scope(pass), replay.ticks);
+        replay.ticks += static_cast<uint64_t>(source.next_us(50.0, 4000.0) * 1000.0 / replay.timestamp_period_ns);
+        pool.write(profiler.end_gpu_scope(), replay.ticks);
+    }
+    replay.time_us += source.next_us(50.0, 200.0); // recording
+    profiler.begin_cpu_scope("submit_present", replay.time_us);
+    replay.time_us += source.next_us(20.0, 100.0);
+    profiler.submit_gpu_frame(replay.time_us);
+    replay.time_us += source.next_us(10.0, 500.0);
+    profiler.end_cpu_scope(replay.time_us);
+    profiler.end_cpu_scope(replay.time_us);
+
+    cpu_scope("download_gpu_info", 2.0, 20.0);
+    profiler.end_frame(replay.time_us);
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t frame_count = 4096;
+    uint32_t repeat = 5;
+    uint32_t seed = 0;
+    std::filesystem::path trace_path = {};
+};
+
+// Statistics of a scope, outliving the profiler
+struct ScopeRow
+{
+    std::string name = {};
+    ProfileTrack track = ProfileTrack::CPU;
+    ProfileStats stats = {};
+};
+
+struct BenchResult
+{
+    double scope_ns = 0.0;          // CPU scope pair reading the clock
+    double scope_bookkeeping_ns = 0.0; // CPU scope pair with explicit times
+    double gpu_frame_us = 0.0;      // GPU scopes of a replayed frame & the resolve of its set
+    double replay_frame_us = 0.0;   // whole replayed frame, CPU & GPU
+    double report_us = 0.0;         // statistics of every scope
+    double export_ms = 0.0;         // Chrome trace of the kept events
+    size_t trace_events = 0;
+    size_t trace_bytes = 0;
+    std::vector<ScopeRow> scopes = {};
+    std::string report_text = {};
+};
+
+static BenchResult measure(BenchSettings const &settings)
+{
+    BenchResult result = {};
+    uint32_t const scope_count = 1U << 20;
+
+    {
+        FrameProfiler profiler(PROFILER_HISTORY_FRAMES, PROFILER_GPU_FRAMES, PROFILER_MAX_GPU_SCOPES, 0);
+        result.scope_ns = best_ms(settings.repeat, [&]()
+                                  {
+                                      for (uint32_t i = 0; i < scope_count; ++i)
+                                      {
+                                          ProfileScope scope(profiler, "scope");
+                                      }
+                                      profiler.end_frame(); })
+                          * 1e6 / scope_count;
+        double time_us = 0.0;
+        result.scope_bookkeeping_ns = best_ms(settings.repeat, [&]()
+                                              {
+                                                  for (uint32_t i = 0; i < scope_count; ++i)
+                                                  {
+                                                      profiler.begin_cpu_scope("scope", time_us);
+                                                      time_us += 1.0;
+                                                      profiler.end_cpu_scope(time_us);
+                                                  }
+                                                  profiler.end_frame(time_us); })
+                                      * 1e6 / scope_count;
+    }
+
+    {
+        // GPU side alone, the sets resolve as they are reused
+        FrameProfiler profiler(PROFILER_HISTORY_FRAMES, PROFILER_GPU_FRAMES, PROFILER_MAX_GPU_SCOPES, 0);
+        FakeQueryPool pool(profiler.get_gpu_query_count());
+        uint64_t frame = 0, ticks = 0;
+        result.gpu_frame_us = best_ms(settings.repeat, [&]()
+                                      {
+                                          for (uint32_t i = 0; i < settings.frame_count; ++i, ++frame)
+                                          {
+                                              ProfileQueryRange range = profiler.begin_gpu_frame(frame, 1.0, [&](uint32_t first, uint32_t count)
+                                                                                                 { return pool.read(first, count); });
+                                              pool.reset(range);
+                                              for (char const *pass : GPU_PASSES)
+                                              {
+                                                  pool.write(profiler.begin_gpu_scope(pass), ticks);
+                                                  ticks += 1000;
+                                                  pool.write(profiler.end_gpu_scope(), ticks);
+                                              }
+                                              profiler.submit_gpu_frame(0.0);
+                                          } })
+                              * 1e3 / settings.frame_count;
+    }
+
+    FrameProfiler profiler = FrameProfiler();
+    FakeQueryPool pool(profiler.get_gpu_query_count());
+    Replay replay = {};
+    SampleSource source = {{.state = settings.seed * 0x9e3779b9U}};
+    uint64_t frame = 0;
+    result.replay_frame_us = best_ms(settings.repeat, [&]()
+                                     {
+                                         for (uint32_t i = 0; i < settings.frame_count; ++i)
+                                             replay_frame(profiler, pool, replay, source, frame++); })
+                             * 1e3 / settings.frame_count;
+
+    std::vector<ProfileReportRow> report = {};
+    result.report_us = best_ms(settings.repeat, [&]()
+                               { report = profiler.get_report(); })
+                       * 1e3;
+    for (auto const &row : report)
+        result.scopes.push_back({.name = std::string(row.name), .track = row.track, .stats = row.stats});
+
+    std::string trace = {};
+    result.export_ms = best_ms(settings.repeat, [&]()
+                               {
+                                   std::ostringstream out;
+                                   profiler.write_chrome_trace(out);
+                                   trace = out.str(); });
+    result.trace_events = profiler.get_event_count();
+    result.trace_bytes = trace.size();
+
+    std::ostringstream report_text;
+    profiler.write_report(report_text);
+    result.report_text = report_text.str();
+
+    if (!settings.trace_path.empty() && profiler.write_chrome_trace(settings.trace_path))
+        std::cout << "Chrome trace written to " << settings.trace_path.string() << std::endl;
+
+    return result;
+}
+
+//////////////////////////////// JSON //////////////////////////////////////
+
+// Just enough of a JSON reader to parse the trace back
+struct JsonValue
+{
+    using Array = std::vector<JsonValue>;
+    using Object = std::map<std::string, JsonValue, std::less<>>;
+    std::variant<std::nullptr_t, bool, double, std::string, Array, Object> value = nullptr;
+
+    JsonValue const *get(std::string_view key) const
+    {
+        auto const *object = std::get_if<Object>(&value);
+        if (object == nullptr)
+            return nullptr;
+        auto it = object->find(key);
+        return it != object->end() ? &it->second : nullptr;
+    }
+};
+
+struct JsonReader
+{
+    std::string_view text = {};
+    size_t at = 0;
+
+    void skip_spaces()
+    {
+        while (at < text.size() && (text[at] == ' ' || text[at] == '\n' || text[at] == '\r' || text[at] == '\t'))
+            ++at;
+    }
+
+    bool consume(char c)
+    {
+        skip_spaces();
+        if (at < text.size() && text[at] == c)
+        {
+            ++at;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_string(std::string &out)
+    {
+        if (!consume('"'))
+            return false;
+        while (at < text.size() && text[at] != '"')
+        {
+            char c = text[at++];
+            if (static_cast<unsigned char>(c) < 0x20)
+                return false;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (at >= text.size())
+                return false;
+            char escape = text[at++];
+            if (escape == 'u')
+            {
+                if (at + 4 > text.size())
+                    return false;
+                uint32_t code = static_cast<uint32_t>(std::stoul(std::string(text.substr(at, 4)), nullptr, 16));
+                at += 4;
+                if (code >= 0x80)
+                    return false; // the profiler only escapes control characters
+                out += static_cast<char>(code);
+            }
+            else if (escape == '"' || escape == '\\' || escape == '/')
+                out += escape;
+            else if (escape == 'n')
+                out += '\n';
+            else if (escape == 't')
+                out += '\t';
+            else
+                return false;
+        }
+        return consume('"');
+    }
+
+    bool read(JsonValue &out)
+    {
+        skip_spaces();
+        if (at >= text.size())
+            return false;
+        char c = text[at];
+        if (c == '{')
+        {
+            ++at;
+            JsonValue::Object object = {};
+            if (!consume('}'))
+            {
+                do
+                {
+                    std::string key = {};
+                    JsonValue value = {};
+                    if (!read_string(key) || !consume(':') || !read(value))
+                        return false;
+                    object.emplace(std::move(key), std::move(value));
+                } while (consume(','));
+                if (!consume('}'))
+                    return false;
+            }
+            out.value = std::move(object);
+            return true;
+        }
+        if (c == '[')
+        {
+            ++at;
+            JsonValue::Array array = {};
+            if (!consume(']'))
+            {
+                do
+                {
+                    JsonValue value = {};
+                    if (!read(value))
+                        return false;
+                    array.push_back(std::move(value));
+                } while (consume(','));
+                if (!consume(']'))
+                    return false;
+            }
+            out.value = std::move(array);
+            return true;
+        }
+        if (c == '"')
+        {
+            std::string value = {};
+            if (!read_string(value))
+                return false;
+            out.value = std::move(value);
+            return true;
+        }
+        for (std::string_view literal : {"true", "false", "null"})
+        {
+            if (text.substr(at, literal.size()) == literal)
+            {
+                at += literal.size();
+                if (literal == "null")
+                    out.value = nullptr;
+                else
+                    out.value = literal == "true";
+                return true;
+            }
+        }
+        size_t end = at;
+        while (end < text.size() && (std::isdigit(static_cast<unsigned char>(text[end])) || text[end] == '-' || text[end] == '+' ||
+                                     text[end] == '.' || text[end] == 'e' || text[end] == 'E'))
+            ++end;
+        if (end == at)
+            return false;
+        out.value = std::stod(std::string(text.substr(at, end - at)));
+        at = end;
+        return true;
+    }
+
+    // The whole text is one value
+    bool parse(JsonValue &out)
+    {
+        if (!read(out))
+            return false;
+        skip_spaces();
+        return at == text.size();
+    }
+};
+
+//////////////////////////////// CHECKS //////////////////////////////////////
+
+// Statistics of the last capacity samples, sorted sums like ProfileHistory
+static ProfileStats get_reference_stats(std::vector<double> const &samples, uint32_t capacity)
+{
+    ProfileStats stats = {};
+    size_t count = std::min<size_t>(samples.size(), capacity);
+    if (count == 0)
+        return stats;
+    std::vector<double> sorted(samples.end() - static_cast<ptrdiff_t>(count), samples.end());
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double sample : sorted)
+        sum += sample;
+    stats.samples = static_cast<uint32_t>(count);
+    stats.last_ms = samples.back();
+    stats.mean_ms = sum / static_cast<double>(count);
+    stats.p50_ms = sorted[(50 * count + 99) / 100 - 1];
+    stats.p99_ms = sorted[(99 * count + 99) / 100 - 1];
+    stats.max_ms = sorted.back();
+    return stats;
+}
+
+static bool same_stats(ProfileStats const &a, ProfileStats const &b)
+{
+    return a.samples == b.samples && a.last_ms == b.last_ms && a.mean_ms == b.mean_ms && a.p50_ms == b.p50_ms && a.p99_ms == b.p99_ms && a.max_ms == b.max_ms;
+}
+
+static bool verify(uint32_t trial_count, uint32_t seed)
+{
+    BenchCheck percentile_check = {.name = "mean, p50 & p99 match a sorted reference"};
+    BenchCheck window_check = {.name = "statistics cover the last frames only"};
+    BenchCheck frame_check = {.name = "repeated scopes summed per frame, unused ones add no sample"};
+    BenchCheck nesting_check = {.name = "trace events nest inside their parents"};
+    BenchCheck gpu_check = {.name = "query indices & resolved GPU durations"};
+    BenchCheck drop_check = {.name = "frames with missing or reversed timestamps dropped"};
+    BenchCheck budget_check = {.name = "scopes past the query budget ignored"};
+    BenchCheck cap_check = {.name = "trace keeps the newest events"};
+    BenchCheck json_check = {.name = "trace JSON parses back, names escaped"};
+
+    SampleSource source = {{.state = seed * 0x9e3779b9U}};
+
+    // Nearest rank on 1..100
+    {
+        ProfileHistory history(PROFILER_HISTORY_FRAMES);
+        for (uint32_t i = 1; i <= 100; ++i)
+            history.add(static_cast<double>(i));
+        ProfileStats stats = history.get_stats();
+        percentile_check.add(stats.samples == 100 && stats.mean_ms == 50.5 && stats.p50_ms == 50.0 && stats.p99_ms == 99.0 && stats.max_ms == 100.0);
+        ProfileHistory window(8);
+        for (uint32_t i = 1; i <= 20; ++i)
+            window.add(static_cast<double>(i));
+        stats = window.get_stats();
+        window_check.add(stats.samples == 8 && stats.mean_ms == 16.5 && stats.p50_ms == 16.0 && stats.p99_ms == 20.0 && stats.last_ms == 20.0);
+        percentile_check.add(same_stats(ProfileHistory(4).get_stats(), ProfileStats{}));
+    }
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        // Random histories through the CPU & GPU paths
+        uint32_t capacity = 1 + source.next_below(64);
+        uint32_t frame_count = 1 + source.next_below(3 * capacity);
+        FrameProfiler profiler(capacity, PROFILER_GPU_FRAMES, PROFILER_MAX_GPU_SCOPES, 1U << 16);
+        FakeQueryPool pool(profiler.get_gpu_query_count());
+        std::vector<double> cpu_samples = {}, gpu_samples = {}, twice_samples = {};
+        std::vector<uint64_t> gpu_frames_dropped = {};
+        uint32_t dropped = 0;
+        double time_us = 0.0;
+        uint64_t ticks = 1U << 20;
+        double period_ns = source.next_below(2) == 0 ? 1.0 : 0.25 * (1 + source.next_below(160));
+        std::vector<std::vector<double>> pending_gpu(PROFILER_GPU_FRAMES);
+        std::vector<bool> pending_valid(PROFILER_GPU_FRAMES, false);
+
+        for (uint32_t frame = 0; frame < frame_count + PROFILER_GPU_FRAMES; ++frame)
+        {
+            bool gpu_only = frame >= frame_count; // flushes the last sets
+            profiler.begin_frame(time_us);
+            if (!gpu_only)
+            {
+                // Integer microseconds, sums are exact
+                double duration_us = static_cast<double>(1 + source.next_below(5000));
+                profiler.begin_cpu_scope("work", time_us);
+                time_us += duration_us;
+                profiler.end_cpu_scope(time_us);
+                cpu_samples.push_back(duration_us * 1e-3);
+
+                // Twice a frame when odd
+                double first_us = static_cast<double>(source.next_below(100));
+                double second_us = static_cast<double>(source.next_below(100));
+                bool twice = (frame & 1) != 0;
+                profiler.begin_cpu_scope("twice", time_us);
+                time_us += first_us;
+                profiler.end_cpu_scope(time_us);
+                if (twice)
+                {
+                    profiler.begin_cpu_scope("twice", time_us);
+                    time_us += second_us;
+                    profiler.end_cpu_scope(time_us);
+                }
+                // Summed in ms like the profiler
+                twice_samples.push_back(0.0 + first_us * 1e-3 + (twice ? second_us * 1e-3 : 0.0));
+            }
+
+            uint32_t set = frame % PROFILER_GPU_FRAMES;
+            if (pending_valid[set])
+            {
+                for (double sample : pending_gpu[set])
+                    gpu_samples.push_back(sample);
+                pending_valid[set] = false;
+            }
+            ProfileQueryRange range = profiler.begin_gpu_frame(frame, period_ns, [&](uint32_t first, uint32_t count)
+                                                               { return pool.read(first, count); });
+            gpu_check.add(range.first == set * PROFILER_MAX_GPU_SCOPES * 2 && range.count == PROFILER_MAX_GPU_SCOPES * 2);
+            pool.reset(range);
+            pending_gpu[set].clear();
+            if (!gpu_only)
+            {
+                uint32_t begin_query = profiler.begin_gpu_scope("pass");
+                uint32_t end_query = profiler.end_gpu_scope();
+                gpu_check.add(begin_query >= range.first && end_query == begin_query + 1 && end_query < range.first + range.count);
+                uint64_t duration_ticks = 1 + source.next_below(1U << 20);
+                uint32_t fault = source.next_below(16);
+                // 0: end never written, 1: reversed, otherwise fine
+                pool.write(begin_query, ticks);
+                if (fault == 1)
+                    pool.write(end_query, ticks - duration_ticks);
+                else if (fault != 0)
+                    pool.write(end_query, ticks + duration_ticks);
+                ticks += 2 * duration_ticks;
+                if (fault > 1)
+                {
+                    pending_gpu[set].push_back(static_cast<double>(duration_ticks) * period_ns * 1e-3 * 1e-3);
+                    pending_valid[set] = true;
+                }
+                else
+                    ++dropped;
+                profiler.submit_gpu_frame(time_us);
+            }
+            profiler.end_frame(time_us);
+        }
+
+        ProfileStats cpu_stats = profiler.get_stats("work", ProfileTrack::CPU);
+        ProfileStats cpu_reference = get_reference_stats(cpu_samples, capacity);
+        percentile_check.add(same_stats(cpu_stats, cpu_reference));
+        window_check.add(cpu_stats.samples == std::min<uint32_t>(frame_count, capacity));
+        frame_check.add(same_stats(profiler.get_stats("twice", ProfileTrack::CPU), get_reference_stats(twice_samples, capacity)));
+        // The GPU only frames add no CPU sample but the frame scope
+        frame_check.add(profiler.get_stats("frame", ProfileTrack::CPU).samples == std::min<uint32_t>(frame_count + PROFILER_GPU_FRAMES, capacity));
+        frame_check.add(profiler.get_stats("missing", ProfileTrack::CPU).samples == 0 && profiler.get_stats("work", ProfileTrack::GPU).samples == 0);
+
+        ProfileStats gpu_stats = profiler.get_stats("pass", ProfileTrack::GPU);
+        // Durations from ticks times the period, the same products in the reference
+        ProfileStats gpu_reference = get_reference_stats(gpu_samples, capacity);
+        bool gpu_close = gpu_stats.samples == gpu_reference.samples;
+        for (auto [a, b] : {std::pair{gpu_stats.mean_ms, gpu_reference.mean_ms}, std::pair{gpu_stats.p50_ms, gpu_reference.p50_ms},
+                            std::pair{gpu_stats.p99_ms, gpu_reference.p99_ms}, std::pair{gpu_stats.max_ms, gpu_reference.max_ms}})
+            gpu_close = gpu_close && std::abs(a - b) <= 1e-12 * std::max(1.0, std::abs(b));
+        gpu_check.add(gpu_close);
+        drop_check.add(profiler.get_dropped_gpu_frames() == dropped);
+
+        // Every event of depth d > 0 lies within an event of depth d - 1 of its frame & track
+        auto const &events = profiler.get_events();
+        std::map<std::pair<uint64_t, uint32_t>, std::vector<ProfileEvent>> parents = {};
+        for (auto const &event : events)
+            parents[{event.frame, event.depth}].push_back(event);
+        for (auto const &event : events)
+        {
+            if (event.depth == 0)
+            {
+                nesting_check.add(profiler.get_scope_track(event.scope) == ProfileTrack::GPU || profiler.get_scope_name(event.scope) == "frame");
+                continue;
+            }
+            bool inside = false;
+            for (auto const &parent : parents[{event.frame, event.depth - 1}])
+                inside = inside || (profiler.get_scope_track(parent.scope) == profiler.get_scope_track(event.scope) &&
+                                    parent.start_us <= event.start_us && event.start_us + event.duration_us <= parent.start_us + parent.duration_us);
+            nesting_check.add(inside);
+        }
+    }
+
+    // Replayed frames: nesting of every CPU scope, GPU events of a frame start at its submit
+    {
+        FrameProfiler profiler = FrameProfiler();
+        FakeQueryPool pool(profiler.get_gpu_query_count());
+        Replay replay = {.timestamp_period_ns = 0.5};
+        for (uint64_t frame = 0; frame < 64; ++frame)
+            replay_frame(profiler, pool, replay, source, frame);
+        std::map<uint64_t, double> first_gpu_start = {};
+        for (auto const &event : profiler.get_events())
+        {
+            if (profiler.get_scope_track(event.scope) != ProfileTrack::GPU)
+                continue;
+            auto it = first_gpu_start.find(event.frame);
+            if (it == first_gpu_start.end())
+                first_gpu_start[event.frame] = event.start_us;
+            else
+                gpu_check.add(event.start_us >= it->second);
+        }
+        // 64 frames, the last PROFILER_GPU_FRAMES sets are still pending
+        gpu_check.add(first_gpu_start.size() == 64 - PROFILER_GPU_FRAMES);
+        gpu_check.add(profiler.get_stats("denoiser_atrous", ProfileTrack::GPU).samples == 64 - PROFILER_GPU_FRAMES &&
+                      profiler.get_stats("acquire", ProfileTrack::CPU).samples == 64);
+        uint32_t draw_depth = 0, acquire_depth = 0;
+        for (auto const &row : profiler.get_report())
+        {
+            if (row.name == "draw")
+                draw_depth = row.depth;
+            if (row.name == "acquire")
+                acquire_depth = row.depth;
+        }
+        nesting_check.add(draw_depth == 1 && acquire_depth == 2);
+    }
+
+    // Budget: past PROFILER_MAX_GPU_SCOPES pairs the indices are invalid, nested scopes keep matching ends
+    {
+        FrameProfiler profiler = FrameProfiler();
+        profiler.begin_gpu_frame(0, 1.0, [](uint32_t, uint32_t)
+                                 { return std::vector<uint64_t>(); });
+        std::vector<uint32_t> queries = {};
+        for (uint32_t i = 0; i < PROFILER_MAX_GPU_SCOPES + 4; ++i)
+        {
+            queries.push_back(profiler.begin_gpu_scope("scope"));
+            queries.push_back(profiler.end_gpu_scope());
+        }
+        bool valid = true;
+        for (uint32_t i = 0; i < queries.size(); ++i)
+            valid = valid && (i < 2 * PROFILER_MAX_GPU_SCOPES ? queries[i] == i : queries[i] == PROFILER_INVALID_QUERY);
+        budget_check.add(valid);
+        budget_check.add(profiler.end_gpu_scope() == PROFILER_INVALID_QUERY);
+
+        FrameProfiler nested = FrameProfiler();
+        nested.begin_gpu_frame(1, 1.0, [](uint32_t, uint32_t)
+                               { return std::vector<uint64_t>(); });
+        uint32_t outer = nested.begin_gpu_scope("outer");
+        uint32_t inner = nested.begin_gpu_scope("inner");
+        budget_check.add(nested.end_gpu_scope() == inner + 1 && nested.end_gpu_scope() == outer + 1);
+        // Outside a frame
+        FrameProfiler idle = FrameProfiler();
+        budget_check.add(idle.begin_gpu_scope("scope") == PROFILER_INVALID_QUERY && idle.end_gpu_scope() == PROFILER_INVALID_QUERY);
+    }
+
+    // Cap: the newest events stay
+    {
+        FrameProfiler profiler(PROFILER_HISTORY_FRAMES, PROFILER_GPU_FRAMES, PROFILER_MAX_GPU_SCOPES, 100);
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            profiler.begin_cpu_scope("scope", static_cast<double>(i));
+            profiler.end_cpu_scope(static_cast<double>(i) + 0.5);
+        }
+        cap_check.add(profiler.get_event_count() == 100 && profiler.get_events().front().start_us == 900.0 &&
+                      profiler.get_events().back().start_us == 999.0);
+        FrameProfiler none(PROFILER_HISTORY_FRAMES, PROFILER_GPU_FRAMES, PROFILER_MAX_GPU_SCOPES, 0);
+        none.begin_cpu_scope("scope", 0.0);
+        none.end_cpu_scope(1.0);
+        none.end_frame(1.0);
+        cap_check.add(none.get_event_count() == 0 && none.get_stats("scope", ProfileTrack::CPU).samples == 1);
+    }
+
+    // JSON: parsed back with every event, names with quotes, backslashes & control characters
+    for (uint32_t trial = 0; trial < std::max(1U, trial_count / 8); ++trial)
+    {
+        FrameProfiler profiler = FrameProfiler();
+        FakeQueryPool pool(profiler.get_gpu_query_count());
+        Replay replay = {};
+        for (uint64_t frame = 0; frame < 8; ++frame)
+            replay_frame(profiler, pool, replay, source, frame);
+        std::string odd_names[] = {"quote \" name", "back\\slash", "tab\tnew\nline", std::string("bell\x07", 5), "{\"json\": [1]}"};
+        for (auto const &name : odd_names)
+        {
+            profiler.begin_cpu_scope(name, replay.time_us);
+            profiler.end_cpu_scope(replay.time_us + 1.0);
+        }
+
+        std::ostringstream out;
+        profiler.write_chrome_trace(out);
+        std::string text = out.str();
+        JsonValue root = {};
+        JsonReader reader = {.text = text};
+        bool parsed = reader.parse(root);
+        json_check.add(parsed);
+        if (!parsed)
+            continue;
+
+        auto const *trace_events = root.get("traceEvents");
+        auto const *array = trace_events != nullptr ? std::get_if<JsonValue::Array>(&trace_events->value) : nullptr;
+        json_check.add(array != nullptr);
+        if (array == nullptr)
+            continue;
+
+        size_t complete_count = 0;
+        std::vector<std::string> names = {};
+        bool fields = true;
+        for (auto const &event : *array)
+        {
+            auto const *ph = event.get("ph");
+            auto const *name = event.get("name");
+            if (ph == nullptr || name == nullptr || std::get_if<std::string>(&ph->value) == nullptr)
+            {
+                fields = false;
+                continue;
+            }
+            if (std::get<std::string>(ph->value) != "X")
+                continue;
+            ++complete_count;
+            auto const *ts = event.get("ts");
+            auto const *dur = event.get("dur");
+            auto const *tid = event.get("tid");
+            fields = fields && ts != nullptr && dur != nullptr && tid != nullptr && std::get_if<double>(&ts->value) != nullptr &&
+                     std::get_if<double>(&dur->value) != nullptr && std::get<double>(dur->value) >= 0.0 &&
+                     (std::get<double>(tid->value) == 1.0 || std::get<double>(tid->value) == 2.0);
+            names.push_back(std::get<std::string>(name->value));
+        }
+        json_check.add(fields && complete_count == profiler.get_event_count());
+        for (auto const &name : odd_names)
+            json_check.add(std::find(names.begin(), names.end(), name) != names.end());
+    }
+
+    return report_checks<BenchCheck>({&percentile_check, &window_check, &frame_check, &nesting_check, &gpu_check, &drop_check,
+                                      &budget_check, &cap_check, &json_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"frame_profiler\",\n";
+    out << "  \"frames\": " << settings.frame_count << ",\n";
+    out << "  \"scope_ns\": " << result.scope_ns << ",\n";
+    out << "  \"scope_bookkeeping_ns\": " << result.scope_bookkeeping_ns << ",\n";
+    out << "  \"gpu_frame_us\": " << result.gpu_frame_us << ",\n";
+    out << "  \"replay_frame_us\": " << result.replay_frame_us << ",\n";
+    out << "  \"report_us\": " << result.report_us << ",\n";
+    out << "  \"export_ms\": " << result.export_ms << ",\n";
+    out << "  \"trace_events\": " << result.trace_events << ",\n";
+    out << "  \"trace_bytes\": " << result.trace_bytes << ",\n";
+    out << "  \"scopes\": [";
+    for (size_t i = 0; i < result.scopes.size(); ++i)
+    {
+        auto const &row = result.scopes[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        FrameProfiler::write_json_string(out, row.name);
+        out << ", \"track\": \"" << (row.track == ProfileTrack::CPU ? "cpu" : "gpu") << "\", \"mean_ms\": " << row.stats.mean_ms
+            << ", \"p50_ms\": " << row.stats.p50_ms << ", \"p99_ms\": " << row.stats.p99_ms << "}";
+    }
+    out << "\n  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "frame profiler" << (PROFILER_ON ? " (PROFILER_ON)" : " (PROFILER_ON off, the PROFILER CMake option)") << ", " << settings.frame_count
+        << " replayed frames" << std::endl;
+    out << "CPU scope: " << result.scope_ns << " ns with the clock, " << result.scope_bookkeeping_ns << " ns bookkeeping" << std::endl;
+    out << "GPU: " << result.gpu_frame_us << " us per frame of " << std::size(GPU_PASSES) << " passes & its resolve" << std::endl;
+    out << "replayed frame: " << result.replay_frame_us << " us, statistics of every scope: " << result.report_us << " us" << std::endl;
+    out << "Chrome trace: " << result.trace_events << " events, " << result.trace_bytes / 1024 << " KiB in " << result.export_ms << " ms" << std::endl;
+    out << result.report_text;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--frames N] [--repeat N] [--seed N] [--trace out.json] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--frames"))
+            settings.frame_count = args.get_uint(1);
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--seed"))
+            settings.seed = args.get_uint();
+        else if (args.is("--trace"))
+            settings.trace_path = args.get_string();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.seed) ? 0 : 1;
+
+    BenchResult result = measure(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return 0;
+}
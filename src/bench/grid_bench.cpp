@@ -0,0 +1,399 @@
+// Brick grid DDA vs BVH benchmark.
+// Loads every bundled model into the host scene arrays, builds the CPU acceleration structures
+// (HostAccel: BVH per instance, HostGridAccel: 8^3 brick grid per instance, HostBrickAccel: BVH over
+// the brick primitives of BRICK_PRIMITIVES_ON with the DDA of the intersection shader) and reports build time,
+// memory and the cost per ray of camera, bounce & shadow rays. All must report the same hits,
+// rays that disagree (grazing edges the DDA steps past) are counted.
+// --edits N clears the voxel hit by N camera rays in the brick primitives (bit flips, no rebuild) and checks
+// the rays against the BVH ignoring that primitive.
+//
+// usage: grid_bench [models dir] [--scene name.vox]... [--rays N] [--edits N] [--threads N] [--seed N] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "host_scene.hpp"
+#include "host_accel.hpp"
+#include "host_grid_accel.hpp"
+#include "host_brick_accel.hpp"
+
+#include <random>
+
+//////////////////////////////// RAYS //////////////////////////////////////
+
+enum class RAY_KIND
+{
+    CAMERA,
+    BOUNCE,
+    SHADOW,
+};
+
+static const char *ray_kind_name(RAY_KIND kind)
+{
+    switch (kind)
+    {
+    case RAY_KIND::CAMERA:
+        return "camera";
+    case RAY_KIND::BOUNCE:
+        return "bounce";
+    case RAY_KIND::SHADOW:
+        return "shadow";
+    }
+    return "unknown";
+}
+
+struct BenchRay
+{
+    HostRay ray = {};
+    float t_max = std::numeric_limits<float>::max();
+};
+
+// Camera rays from a sphere around the scene to points inside of it, bounce rays leaving their hits
+// over the hemisphere & shadow rays from the hits to random points of the scene bounds
+static void generate_rays(HostAccel const &accel, uint32_t ray_count, uint32_t seed,
+                          std::vector<BenchRay> &camera_rays, std::vector<BenchRay> &bounce_rays, std::vector<BenchRay> &shadow_rays)
+{
+    HostScene const &scene = accel.get_scene();
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    auto random_in_bounds = [&]()
+    {
+        return scene.bounds_min + (scene.bounds_max - scene.bounds_min) * glm::vec3(uniform(rng), uniform(rng), uniform(rng));
+    };
+    auto random_direction = [&]()
+    {
+        float z = uniform(rng) * 2.0f - 1.0f;
+        float phi = uniform(rng) * DAXA_2PI;
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    };
+
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = glm::length(scene.bounds_max - scene.bounds_min) * 0.5f;
+
+    camera_rays.clear();
+    bounce_rays.clear();
+    shadow_rays.clear();
+    for (uint32_t i = 0; i < ray_count; ++i)
+    {
+        glm::vec3 origin = center + random_direction() * radius * 1.5f;
+        BenchRay camera_ray = {.ray = {.origin = origin, .direction = glm::normalize(random_in_bounds() - origin)}};
+        camera_rays.push_back(camera_ray);
+
+        HostHit hit = {};
+        if (!accel.intersect(camera_ray.ray, 0.0f, camera_ray.t_max, hit))
+            continue;
+
+        glm::vec3 hit_origin = compute_ray_origin(hit.position, hit.normal);
+        glm::vec3 direction = random_direction();
+        if (glm::dot(direction, hit.normal) < 0.0f)
+            direction = -direction;
+        bounce_rays.push_back(BenchRay{.ray = {.origin = hit_origin, .direction = direction}});
+
+        glm::vec3 to_target = random_in_bounds() - hit_origin;
+        float distance = glm::length(to_target);
+        if (distance > 0.0f)
+            shadow_rays.push_back(BenchRay{.ray = {.origin = hit_origin, .direction = to_target / distance}, .t_max = distance});
+    }
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct RayResult
+{
+    RAY_KIND kind = RAY_KIND::CAMERA;
+    uint64_t ray_count = 0;
+    uint64_t hit_count = 0;
+    uint64_t mismatch_count = 0;
+    uint64_t brick_mismatch_count = 0;
+    double bvh_ns_per_ray = 0.0;
+    double grid_ns_per_ray = 0.0;
+    double brick_ns_per_ray = 0.0;
+};
+
+struct SceneResult
+{
+    std::string scene = {};
+    uint32_t primitive_count = 0;
+    double bvh_build_ms = 0.0;
+    double grid_build_ms = 0.0;
+    double brick_build_ms = 0.0;
+    size_t bvh_bytes = 0;
+    size_t grid_bytes = 0;
+    size_t brick_bytes = 0;
+    size_t brick_count = 0;
+    uint64_t edit_count = 0;
+    uint64_t edit_mismatch_count = 0;
+    std::vector<RayResult> rays = {};
+};
+
+// Same closest hit: brick hits carry the packed voxel id, a primitive maps to its (first) voxel
+static bool same_brick_hit(HostBrickAccel const &bricks, HostHit const &bvh_hit, HostHit const &brick_hit)
+{
+    if (std::abs(bvh_hit.distance - brick_hit.distance) > 1e-5f * std::max(1.0f, bvh_hit.distance))
+        return false;
+#if MERGED_BOXES_ON == 0
+    return bvh_hit.object.instance_id == brick_hit.object.instance_id &&
+           bricks.get_voxel_id(bvh_hit.object.instance_id, bvh_hit.object.primitive_id) == brick_hit.object.primitive_id;
+#else
+    return true;
+#endif // MERGED_BOXES_ON
+}
+
+static RayResult bench_rays(HostAccel const &bvh, HostGridAccel const &grid, HostBrickAccel const &bricks,
+                            std::vector<BenchRay> const &rays, RAY_KIND kind)
+{
+    RayResult result = {.kind = kind, .ray_count = rays.size()};
+    if (rays.empty())
+        return result;
+
+    std::vector<HostHit> bvh_hits(rays.size()), grid_hits(rays.size()), brick_hits(rays.size());
+    std::vector<uint8_t> bvh_found(rays.size()), grid_found(rays.size()), brick_found(rays.size());
+
+    // Shadow rays only need any hit
+    auto run = [&](auto const &accel, std::vector<HostHit> &hits, std::vector<uint8_t> &found)
+    {
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            if (kind == RAY_KIND::SHADOW)
+                found[i] = accel.occluded(rays[i].ray, 0.0f, rays[i].t_max);
+            else
+                found[i] = accel.intersect(rays[i].ray, 0.0f, rays[i].t_max, hits[i]);
+        }
+    };
+
+    result.bvh_ns_per_ray = best_ms(1, [&]()
+                                    { run(bvh, bvh_hits, bvh_found); }) *
+                            1e6 / rays.size();
+    result.grid_ns_per_ray = best_ms(1, [&]()
+                                     { run(grid, grid_hits, grid_found); }) *
+                             1e6 / rays.size();
+    result.brick_ns_per_ray = best_ms(1, [&]()
+                                      { run(bricks, brick_hits, brick_found); }) *
+                              1e6 / rays.size();
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        result.hit_count += bvh_found[i];
+        bool same = bvh_found[i] == grid_found[i];
+        if (same && bvh_found[i] && kind != RAY_KIND::SHADOW)
+            same = std::abs(bvh_hits[i].distance - grid_hits[i].distance) <= 1e-5f * std::max(1.0f, bvh_hits[i].distance);
+        result.mismatch_count += !same;
+
+        bool same_brick = bvh_found[i] == brick_found[i];
+        if (same_brick && bvh_found[i] && kind != RAY_KIND::SHADOW)
+            same_brick = same_brick_hit(bricks, bvh_hits[i], brick_hits[i]);
+        result.brick_mismatch_count += !same_brick;
+    }
+    return result;
+}
+
+// Clears the voxel a camera ray hits, the ray must then see what the BVH sees without that primitive.
+// The voxel is set back afterwards. Merged boxes cover several voxels so they can't be compared this way.
+static void check_brick_edits(HostAccel const &bvh, HostBrickAccel &bricks, std::vector<BenchRay> const &rays, uint32_t edit_count,
+                              SceneResult &result)
+{
+#if MERGED_BOXES_ON == 0
+    for (size_t i = 0; i < rays.size() && result.edit_count < edit_count; ++i)
+    {
+        HostHit bvh_hit = {};
+        if (!bvh.intersect(rays[i].ray, 0.0f, rays[i].t_max, bvh_hit))
+            continue;
+
+        OBJECT_INFO voxel = {bvh_hit.object.instance_id, bricks.get_voxel_id(bvh_hit.object.instance_id, bvh_hit.object.primitive_id)};
+        PRIMITIVE previous = bricks.get_voxel(voxel);
+        bricks.clear_voxel(voxel);
+
+        HostHit expected = {}, brick_hit = {};
+        bool expected_found = bvh.intersect(rays[i].ray, 0.0f, rays[i].t_max, expected, bvh_hit.object);
+        bool brick_found = bricks.intersect(rays[i].ray, 0.0f, rays[i].t_max, brick_hit);
+        bool same = expected_found == brick_found;
+        if (same && expected_found)
+            same = same_brick_hit(bricks, expected, brick_hit);
+
+        bricks.set_voxel(voxel, previous);
+        ++result.edit_count;
+        result.edit_mismatch_count += !same;
+    }
+#else
+    (void)bvh;
+    (void)bricks;
+    (void)rays;
+    (void)edit_count;
+    (void)result;
+#endif // MERGED_BOXES_ON
+}
+
+static SceneResult bench_scene(HostScene const &scene, std::string const &name, TilePool &pool, uint32_t ray_count, uint32_t edit_count, uint32_t seed)
+{
+    SceneResult result = {.scene = name, .primitive_count = scene.get_primitive_count()};
+
+    HostAccel bvh = {};
+    result.bvh_build_ms = best_ms(1, [&]()
+                                  { bvh.build(scene, pool); });
+    HostGridAccel grid = {};
+    result.grid_build_ms = best_ms(1, [&]()
+                                   { grid.build(scene, pool); });
+    HostBrickAccel bricks = {};
+    result.brick_build_ms = best_ms(1, [&]()
+                                    { bricks.build(scene, pool); });
+    result.bvh_bytes = bvh.get_memory_size();
+    result.grid_bytes = grid.get_memory_size();
+    result.brick_bytes = bricks.get_memory_size();
+    result.brick_count = bricks.get_brick_count();
+
+    std::vector<BenchRay> camera_rays = {}, bounce_rays = {}, shadow_rays = {};
+    generate_rays(bvh, ray_count, seed, camera_rays, bounce_rays, shadow_rays);
+
+    result.rays.push_back(bench_rays(bvh, grid, bricks, camera_rays, RAY_KIND::CAMERA));
+    result.rays.push_back(bench_rays(bvh, grid, bricks, bounce_rays, RAY_KIND::BOUNCE));
+    result.rays.push_back(bench_rays(bvh, grid, bricks, shadow_rays, RAY_KIND::SHADOW));
+
+    check_brick_edits(bvh, bricks, camera_rays, edit_count, result);
+    return result;
+}
+
+static void write_json(std::ostream &out, std::vector<SceneResult> const &results, uint32_t ray_count)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"grid\",\n";
+    out << "  \"rays\": " << ray_count << ",\n";
+    out << "  \"merged_boxes_on\": " << MERGED_BOXES_ON << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto const &result = results[i];
+        out << "    {"
+            << "\"scene\": \"" << result.scene << "\", "
+            << "\"primitives\": " << result.primitive_count << ", "
+            << "\"bvh_build_ms\": " << result.bvh_build_ms << ", "
+            << "\"grid_build_ms\": " << result.grid_build_ms << ", "
+            << "\"brick_build_ms\": " << result.brick_build_ms << ", "
+            << "\"bvh_bytes\": " << result.bvh_bytes << ", "
+            << "\"grid_bytes\": " << result.grid_bytes << ", "
+            << "\"brick_bytes\": " << result.brick_bytes << ", "
+            << "\"bricks\": " << result.brick_count << ", "
+            << "\"edits\": " << result.edit_count << ", "
+            << "\"edit_mismatches\": " << result.edit_mismatch_count << ", "
+            << "\"rays\": [";
+        for (size_t j = 0; j < result.rays.size(); ++j)
+        {
+            auto const &rays = result.rays[j];
+            out << "{"
+                << "\"kind\": \"" << ray_kind_name(rays.kind) << "\", "
+                << "\"count\": " << rays.ray_count << ", "
+                << "\"hits\": " << rays.hit_count << ", "
+                << "\"mismatches\": " << rays.mismatch_count << ", "
+                << "\"brick_mismatches\": " << rays.brick_mismatch_count << ", "
+                << "\"bvh_ns_per_ray\": " << rays.bvh_ns_per_ray << ", "
+                << "\"grid_ns_per_ray\": " << rays.grid_ns_per_ray << ", "
+                << "\"brick_ns_per_ray\": " << rays.brick_ns_per_ray
+                << "}" << (j + 1 < result.rays.size() ? ", " : "");
+        }
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, std::vector<SceneResult> const &results)
+{
+    out << std::endl;
+    for (auto const &result : results)
+    {
+        out << result.scene << ": " << result.primitive_count << " primitives" << std::endl;
+        out << "  build: bvh " << result.bvh_build_ms << " ms (" << (result.bvh_bytes >> 10) << " KiB), grid "
+            << result.grid_build_ms << " ms (" << (result.grid_bytes >> 10) << " KiB), bricks "
+            << result.brick_build_ms << " ms (" << result.brick_count << " bricks, " << (result.brick_bytes >> 10) << " KiB)" << std::endl;
+        for (auto const &rays : result.rays)
+        {
+            out << "  " << ray_kind_name(rays.kind) << ": " << rays.ray_count << " rays, " << rays.hit_count << " hits, "
+                << "bvh " << rays.bvh_ns_per_ray << " ns/ray, grid " << rays.grid_ns_per_ray << " ns/ray ("
+                << (rays.grid_ns_per_ray > 0.0 ? rays.bvh_ns_per_ray / rays.grid_ns_per_ray : 0.0) << "x), bricks "
+                << rays.brick_ns_per_ray << " ns/ray, " << rays.mismatch_count << " grid / "
+                << rays.brick_mismatch_count << " brick mismatches" << std::endl;
+        }
+        if (result.edit_count > 0)
+            out << "  edits: " << result.edit_count << " voxels cleared, " << result.edit_mismatch_count << " mismatches" << std::endl;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path models_path = "assets/models";
+    std::filesystem::path json_path = {};
+    std::vector<std::string> scene_names = {};
+    uint32_t ray_count = 1 << 18;
+    uint32_t edit_count = 1024;
+    uint32_t thread_count = 0;
+    uint32_t seed = 1;
+
+    BenchArgs args(argc, argv, "[models dir] [--scene name.vox]... [--rays N] [--edits N] [--threads N] [--seed N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--scene"))
+            scene_names.push_back(args.get_string());
+        else if (args.is("--rays"))
+            ray_count = args.get_uint(1);
+        else if (args.is("--edits"))
+            edit_count = args.get_uint();
+        else if (args.is("--threads"))
+            thread_count = args.get_uint();
+        else if (args.is("--seed"))
+            seed = args.get_uint();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else if (args.is_positional())
+            models_path = args.get_current();
+        else
+            return args.usage();
+    }
+
+    std::vector<std::filesystem::path> files = {};
+    if (scene_names.empty())
+    {
+        std::error_code error = {};
+        for (auto const &entry : std::filesystem::directory_iterator(models_path, error))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".vox")
+                files.push_back(entry.path());
+        }
+        // Stable order so runs can be compared
+        std::sort(files.begin(), files.end());
+    }
+    else
+    {
+        for (auto const &name : scene_names)
+            files.push_back(models_path / name);
+    }
+
+    if (files.empty())
+    {
+        std::cerr << "No models found in " << models_path.string() << std::endl;
+        return 1;
+    }
+
+    // Builds are parallel over the instances, rays are traced on this thread only
+    TilePool pool(thread_count);
+
+    MapLoader loader = {};
+    loader.create_gvox_context();
+
+    std::vector<SceneResult> results = {};
+    for (auto const &file : files)
+    {
+        HostScene scene = {};
+        if (!scene.load_model(loader, file, glm::mat4(1.0f)))
+            continue;
+        results.push_back(bench_scene(scene, file.stem().string(), pool, ray_count, edit_count, seed));
+    }
+
+    loader.destroy_gvox_context();
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, results, ray_count); }))
+        return 1;
+
+    write_table(std::cout, results);
+
+    return 0;
+}
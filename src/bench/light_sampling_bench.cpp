@@ -0,0 +1,776 @@
+// Cube light picking benchmark & pmf checks.
+// Scatters thousands of small emissive voxels of very different power over a voxel floor with pillars, builds the power
+// alias table (light_alias_table.hpp) & the light tree (light_tree.hpp) over them and compares the cube light picking of
+// the CPU reference (ReferenceTracer) uniform vs by power vs with the tree: the variance of one direct light sample at
+// the primary hits (next event estimation & the BSDF bounce weighted by MIS, trace_path with a depth of 1), the mean of
+// each (no picker may bias it) & the build, refit and sampling times. The alias table build is also timed alone for
+// 10k & 1M lights, on one thread & on the pool.
+// --verify runs N random shading points: the pmf of every light sums to 1 (less the subtrees bounded below the receiver
+// plane, whose lights can't light it), the pmf of a sample is the pmf evaluated for its light, sampled frequencies match
+// the pmf, and after deleting lights as the brush does (swap with the last light) the refit tree stays consistent &
+// restoring them in LIFO order gives the original pmfs back. The alias table pmfs are proportional to the power & sum
+// to 1, the entries give every light exactly its pmf, sampled frequencies match it and the pooled build is the
+// sequential one. The exit code is not 0 when one fails, or in the default mode when the tree or the alias table don't
+// lower the variance below --gate times the uniform one.
+//
+// usage: light_sampling_bench [--verify N] [--lights N] [--width N] [--height N] [--candidates N] [--gate X]
+//                             [--threads N] [--seed N] [--json out.json]
+
+#include "bench_common.hpp"
+#include "bench_scene.hpp"
+#include "host_accel.hpp"
+#include "light_alias_table.hpp"
+#include "light_tree.hpp"
+
+//////////////////////////////// SCENE //////////////////////////////////////
+
+static constexpr uint32_t FIELD_VOXELS = 96;
+static constexpr uint32_t FIELD_HEIGHT = 24;
+static constexpr float FIELD_SCALE = 2.0f;
+
+enum FIELD_MATERIAL : uint32_t
+{
+    FIELD_WHITE,
+    FIELD_GREY,
+    FIELD_METAL,
+    FIELD_MATERIAL_COUNT,
+};
+
+// A floor with pillars & a metal strip, light_count emissive voxels floating above it. Most lights are dim, a few are
+// bright so the power bounds matter, and they cluster in blobs so the spatial bounds matter.
+static void build_light_field(HostScene &scene, uint32_t light_count, uint32_t seed)
+{
+    GvoxRegionChunk chunk = {};
+    chunk.materials.resize(FIELD_MATERIAL_COUNT);
+    chunk.materials[FIELD_WHITE] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.73f));
+    chunk.materials[FIELD_GREY] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.4f));
+    chunk.materials[FIELD_METAL] = make_material(MATERIAL_TYPE_METAL, glm::vec3(0.9f), glm::vec3(0.0f), 0.3f);
+
+    std::vector<uint8_t> occupied(FIELD_VOXELS * FIELD_HEIGHT * FIELD_VOXELS, 0);
+    auto get_cell = [](uint32_t x, uint32_t y, uint32_t z) -> uint32_t
+    { return (z * FIELD_HEIGHT + y) * FIELD_VOXELS + x; };
+
+    for (uint32_t z = 0; z < FIELD_VOXELS; ++z)
+        for (uint32_t x = 0; x < FIELD_VOXELS; ++x)
+        {
+            bool is_metal = z >= 40 && z < 44;
+            add_voxel(chunk, x, 0, z, is_metal ? FIELD_METAL : FIELD_WHITE);
+            occupied[get_cell(x, 0, z)] = 1;
+
+            // Pillars every 16 voxels shadow the lights around them
+            if (x % 16 == 8 && z % 16 == 8)
+                for (uint32_t y = 1; y < FIELD_HEIGHT / 2; ++y)
+                {
+                    add_voxel(chunk, x, y, z, FIELD_GREY);
+                    occupied[get_cell(x, y, z)] = 1;
+                }
+        }
+
+    // Blobs of lights, the power follows a heavy tail
+    uint32_t rng = host_tea(seed, 0x11);
+    constexpr uint32_t BLOB_COUNT = 24;
+    glm::vec3 blob_centers[BLOB_COUNT] = {};
+    for (auto &center : blob_centers)
+        center = glm::vec3(host_rnd(rng) * FIELD_VOXELS, 2.0f + host_rnd(rng) * (FIELD_HEIGHT - 4), host_rnd(rng) * FIELD_VOXELS);
+
+    uint32_t attempt_count = 0;
+    while (chunk.lights.size() < light_count && attempt_count++ < light_count * 32)
+    {
+        glm::vec3 center = blob_centers[std::min(static_cast<uint32_t>(host_rnd(rng) * BLOB_COUNT), BLOB_COUNT - 1)];
+        glm::vec3 offset = glm::vec3(host_rnd(rng) - 0.5f, host_rnd(rng) - 0.5f, host_rnd(rng) - 0.5f) * 12.0f;
+        glm::vec3 cell = glm::clamp(center + offset, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(FIELD_VOXELS - 1, FIELD_HEIGHT - 1, FIELD_VOXELS - 1));
+        uint32_t x = static_cast<uint32_t>(cell.x), y = static_cast<uint32_t>(cell.y), z = static_cast<uint32_t>(cell.z);
+        if (occupied[get_cell(x, y, z)])
+            continue;
+        occupied[get_cell(x, y, z)] = 1;
+
+        float power = host_rnd(rng) < 0.02f ? 200.0f : 0.5f + 4.0f * host_rnd(rng) * host_rnd(rng);
+        glm::vec3 tint = glm::vec3(0.5f + 0.5f * host_rnd(rng), 0.5f + 0.5f * host_rnd(rng), 0.5f + 0.5f * host_rnd(rng));
+
+        uint32_t material = static_cast<uint32_t>(chunk.materials.size());
+        chunk.materials.push_back(make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.8f), tint * power));
+
+        add_voxel(chunk, x, y, z, material);
+    }
+    add_centered_chunk(scene, chunk, FIELD_VOXELS, FIELD_SCALE);
+}
+
+static LightBounds get_scene_cube_light_bounds(HostScene const &scene, uint32_t light_index)
+{
+    LIGHT const &light = scene.cube_lights[light_index];
+    glm::mat3 obj2world = glm::mat3(daxa_f32mat4x4_to_glm_mat4(scene.instances[light.instance_info.instance_id].transform));
+    return get_cube_light_bounds(to_glm(light.position), obj2world, light.size, to_glm(light.emissive));
+}
+
+static void build_scene_light_tree(HostScene const &scene, LightTree &tree)
+{
+    tree = LightTree{};
+    tree.resize(static_cast<uint32_t>(scene.cube_lights.size()));
+    for (uint32_t i = 0; i < scene.cube_lights.size(); ++i)
+        tree.set_light(i, get_scene_cube_light_bounds(scene, i));
+    tree.build();
+}
+
+static void build_scene_light_alias_table(HostScene const &scene, LightAliasTable &table, TilePool *pool = nullptr)
+{
+    std::vector<float> weights(scene.cube_lights.size());
+    for (uint32_t i = 0; i < scene.cube_lights.size(); ++i)
+    {
+        LIGHT const &light = scene.cube_lights[i];
+        glm::mat3 obj2world = glm::mat3(daxa_f32mat4x4_to_glm_mat4(scene.instances[light.instance_info.instance_id].transform));
+        weights[i] = host_get_cube_light_power(obj2world, light.size, to_glm(light.emissive));
+    }
+    table.build(weights, pool);
+}
+
+// Camera above the field looking down at it
+static HostCamera frame_field(HostScene const &scene, uint32_t width, uint32_t height)
+{
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = (scene.bounds_max.x - scene.bounds_min.x) * 0.5f;
+    return get_host_camera(width, height, center + glm::vec3(0.0f, radius * 0.9f, radius * 1.1f), center);
+}
+
+struct FieldRenderer
+{
+    HostScene scene = {};
+    HostAccel accel = {};
+    ReferenceSettings settings = {};
+    HostCamera camera = {};
+
+    FieldRenderer(uint32_t light_count, uint32_t width, uint32_t height, uint32_t seed, TilePool &pool)
+    {
+        build_light_field(scene, light_count, seed);
+        accel.build(scene, pool);
+        settings.width = width;
+        settings.height = height;
+        settings.max_depth = 1;
+        camera = frame_field(scene, width, height);
+    }
+
+    HostRay get_ray(ReferenceTracer const &tracer, uint32_t pixel) const
+    {
+        uint32_t seed = 0;
+        return tracer.get_ray_from_current_pixel(pixel % settings.width, pixel / settings.width, camera, seed);
+    }
+
+    // Shading point of the primary hit of a pixel, false for the sky & the lights themselves
+    bool get_shading_point(ReferenceTracer const &tracer, uint32_t pixel, glm::vec3 &P, glm::vec3 &n, glm::vec3 &wo,
+                           MATERIAL &mat, OBJECT_INFO &object) const
+    {
+        HostRay ray = get_ray(tracer, pixel);
+        HostHit hit = {};
+        if (!accel.intersect(ray, 0.0f, HOST_MAX_DISTANCE, hit))
+            return false;
+        PRIMITIVE const &primitive = scene.primitives[hit.primitive_index];
+        if (primitive.light_index != static_cast<uint32_t>(-1))
+            return false;
+
+        mat = scene.materials[primitive.material_index];
+        n = hit.normal;
+        wo = -glm::normalize(ray.direction);
+        P = compute_ray_origin(hit.position, n);
+        object = hit.object;
+        return true;
+    }
+};
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static double get_relative_difference(double a, double b)
+{
+    double scale = std::max(std::abs(a), std::abs(b));
+    return scale > 0.0 ? std::abs(a - b) / scale : 0.0;
+}
+
+// Probability of a sample walking down from node_index to a leaf: children bounds can all be below the receiver
+// plane while their parent's aren't, the sampler gives up there (the lights below can't light P)
+static double get_reachable_mass(LightTree const &tree, uint32_t node_index, glm::vec3 P, glm::vec3 n)
+{
+    LIGHT_TREE_NODE const &node = tree.get_nodes()[node_index];
+    if (node.is_leaf)
+        return node.phi > 0.0f ? 1.0 : 0.0;
+
+    uint32_t child = node.child_or_light;
+    double importance0 = get_light_tree_importance(tree.get_nodes()[child], P, n);
+    double importance1 = get_light_tree_importance(tree.get_nodes()[child + 1], P, n);
+    double total = importance0 + importance1;
+    if (total <= 0.0)
+        return 0.0;
+    return (importance0 > 0.0 ? importance0 / total * get_reachable_mass(tree, child, P, n) : 0.0) +
+           (importance1 > 0.0 ? importance1 / total * get_reachable_mass(tree, child + 1, P, n) : 0.0);
+}
+
+// Sum of the pmf of every light, lights the pmf skips & sample vs evaluated pmf at one shading point
+static void check_pmf(LightTree const &tree, uint32_t light_count, glm::vec3 P, glm::vec3 n, uint32_t &seed,
+                      BenchErrorCheck &sum_check, BenchErrorCheck &skip_check, BenchErrorCheck &sample_check)
+{
+    double sum = 0.0;
+    for (uint32_t light = 0; light < light_count; ++light)
+    {
+        float light_pmf = tree.get_pmf(P, n, light);
+        sum += light_pmf;
+
+        // Only lights bounded to send nothing to P can't be picked, otherwise the estimate is biased
+        if (light_pmf <= 0.0f)
+        {
+            LightBounds const &bounds = tree.get_light(light);
+            LIGHT_TREE_NODE leaf = {};
+            leaf.minimum = {bounds.minimum.x, bounds.minimum.y, bounds.minimum.z};
+            leaf.maximum = {bounds.maximum.x, bounds.maximum.y, bounds.maximum.z};
+            leaf.phi = bounds.phi;
+            leaf.axis = {bounds.axis.x, bounds.axis.y, bounds.axis.z};
+            leaf.cos_theta_o = bounds.cos_theta_o;
+            leaf.cos_theta_e = bounds.cos_theta_e;
+            skip_check.add(get_light_tree_importance(leaf, P, n), 0.0);
+        }
+    }
+    if (tree.get_node_count() == 0)
+        return;
+    sum_check.add(std::abs(sum - get_reachable_mass(tree, 0, P, n)), 1e-4);
+
+    uint32_t light_index = 0;
+    float pmf = 0.0f;
+
+    for (uint32_t s = 0; s < 16; ++s)
+        if (tree.sample(P, n, host_rnd(seed), light_index, pmf))
+            sample_check.add(get_relative_difference(pmf, tree.get_pmf(P, n, light_index)), 1e-4);
+}
+
+// Worst z-score of the sampled counts of the lights against their pmf
+template <typename GetPmf>
+static double get_frequency_z_score(std::vector<uint32_t> const &counts, uint32_t sample_count, GetPmf &&get_pmf)
+{
+    double max_z = 0.0;
+    for (uint32_t light = 0; light < counts.size(); ++light)
+    {
+        double expected = static_cast<double>(get_pmf(light)) * sample_count;
+        if (expected < 1.0)
+        {
+            // Lights the pmf almost never picks: a few hits are fine, many aren't
+            if (counts[light] > 8)
+                max_z = std::max(max_z, static_cast<double>(counts[light]));
+            continue;
+        }
+        double sigma = std::sqrt(expected * (1.0 - expected / sample_count));
+        max_z = std::max(max_z, std::abs(counts[light] - expected) / sigma);
+    }
+    return max_z;
+}
+
+static bool verify(uint32_t trial_count, uint32_t light_count, uint32_t seed, uint32_t thread_count)
+{
+    TilePool pool(thread_count);
+    FieldRenderer renderer(light_count, 96, 64, seed, pool);
+    ReferenceTracer tracer(renderer.accel, renderer.settings);
+    HostScene const &scene = renderer.scene;
+    uint32_t scene_light_count = static_cast<uint32_t>(scene.cube_lights.size());
+
+    LightTree tree = {};
+    build_scene_light_tree(scene, tree);
+    std::cout << scene_light_count << " lights, " << tree.get_node_count() << " nodes, depth " << tree.get_depth() << std::endl;
+
+    BenchErrorCheck sum_check = {.name = "pmf sums to the reachable mass"};
+    BenchErrorCheck skip_check = {.name = "lights with pmf 0 can't light P"};
+    BenchErrorCheck sample_check = {.name = "sample pmf == evaluated pmf"};
+    BenchErrorCheck frequency_check = {.name = "sampled frequencies vs pmf (z-score)"};
+    BenchErrorCheck refit_sum_check = {.name = "refit: pmf sums to the reachable mass"};
+    BenchErrorCheck refit_skip_check = {.name = "refit: lights with pmf 0 can't light P"};
+    BenchErrorCheck refit_sample_check = {.name = "refit: sample pmf == evaluated pmf"};
+    BenchErrorCheck refit_dead_check = {.name = "refit: deleted lights have pmf 0"};
+    BenchErrorCheck restore_check = {.name = "restore: pmf back to the original"};
+
+    // Shading points of random pixels, the receiver normal depends on the material as in the tracer
+    std::vector<glm::vec3> points = {};
+    std::vector<glm::vec3> normals = {};
+    uint32_t rng = host_tea(seed, 0x21);
+    uint32_t pixel_count = renderer.settings.width * renderer.settings.height;
+    for (uint32_t attempt = 0; points.size() < trial_count && attempt < trial_count * 16; ++attempt)
+    {
+        glm::vec3 P = {}, n = {}, wo = {};
+        MATERIAL mat = {};
+        OBJECT_INFO object = {};
+        if (!renderer.get_shading_point(tracer, std::min(static_cast<uint32_t>(host_rnd(rng) * pixel_count), pixel_count - 1), P, n, wo, mat, object))
+            continue;
+        points.push_back(P);
+        normals.push_back(get_light_tree_receiver_normal(mat, n));
+    }
+
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        check_pmf(tree, scene_light_count, points[i], normals[i], rng, sum_check, skip_check, sample_check);
+        if (i < 4)
+        {
+            std::vector<uint32_t> counts(scene_light_count, 0);
+            uint32_t sample_count = 1 << 20;
+            uint32_t light_index = 0;
+            float pmf = 0.0f;
+            for (uint32_t s = 0; s < sample_count; ++s)
+                if (tree.sample(points[i], normals[i], host_rnd(rng), light_index, pmf))
+                    ++counts[light_index];
+            frequency_check.add(get_frequency_z_score(counts, sample_count, [&](uint32_t light)
+                                                      { return tree.get_pmf(points[i], normals[i], light); }),
+                                5.5);
+        }
+    }
+
+    std::vector<std::vector<float>> original_pmfs(std::min<size_t>(points.size(), 8));
+    for (uint32_t i = 0; i < original_pmfs.size(); ++i)
+        for (uint32_t light = 0; light < scene_light_count; ++light)
+            original_pmfs[i].push_back(tree.get_pmf(points[i], normals[i], light));
+
+    // Brush deletes: the deleted light takes the last one, as delete_light_device_buffer does
+    struct Deletion
+    {
+        uint32_t deleted = 0;
+        uint32_t exchanged = 0;
+        LightBounds bounds = {};
+    };
+    std::vector<Deletion> deletions = {};
+    std::vector<uint32_t> original_index(scene_light_count);
+    for (uint32_t i = 0; i < scene_light_count; ++i)
+        original_index[i] = i;
+
+    uint32_t live_count = scene_light_count;
+    uint32_t deletion_count = scene_light_count / 3;
+    for (uint32_t d = 0; d < deletion_count; ++d)
+    {
+        uint32_t deleted = std::min(static_cast<uint32_t>(host_rnd(rng) * live_count), live_count - 1);
+        uint32_t last = live_count - 1;
+        uint32_t exchanged = deleted == last ? LightTree::INVALID_LIGHT : last;
+        deletions.push_back(Deletion{.deleted = deleted, .exchanged = exchanged, .bounds = tree.get_light(deleted)});
+        tree.remove_light(deleted, exchanged);
+        if (exchanged != LightTree::INVALID_LIGHT)
+            std::swap(original_index[deleted], original_index[exchanged]);
+        --live_count;
+    }
+    std::cout << "deleted " << deletion_count << " lights, needs rebuild: " << (tree.needs_rebuild() ? "yes" : "no") << std::endl;
+
+    for (uint32_t i = 0; i < points.size(); ++i)
+    {
+        check_pmf(tree, live_count, points[i], normals[i], rng, refit_sum_check, refit_skip_check, refit_sample_check);
+        for (uint32_t light = live_count; light < std::min(live_count + 32, scene_light_count); ++light)
+            refit_dead_check.add(tree.get_pmf(points[i], normals[i], light), 0.0);
+    }
+
+    // Undo in LIFO order as restore_light_device_buffer
+    for (auto deletion = deletions.rbegin(); deletion != deletions.rend(); ++deletion)
+    {
+        if (deletion->exchanged != LightTree::INVALID_LIGHT)
+            std::swap(original_index[deletion->deleted], original_index[deletion->exchanged]);
+        tree.restore_light(deletion->deleted, deletion->exchanged, deletion->bounds);
+    }
+    for (uint32_t i = 0; i < original_pmfs.size(); ++i)
+        for (uint32_t light = 0; light < scene_light_count; ++light)
+            restore_check.add(std::abs(tree.get_pmf(points[i], normals[i], light) - original_pmfs[i][original_index[light]]), 1e-5);
+
+    // Alias table: pmfs, the mass every light gets from the entries & frequencies
+    BenchErrorCheck alias_power_check = {.name = "alias: pmf proportional to the power"};
+    BenchErrorCheck alias_sum_check = {.name = "alias: pmf sums to 1"};
+    BenchErrorCheck alias_mass_check = {.name = "alias: entries give every light its pmf"};
+    BenchErrorCheck alias_frequency_check = {.name = "alias: sampled frequencies vs pmf (z-score)"};
+    BenchErrorCheck alias_pool_check = {.name = "alias: pooled build == sequential build"};
+
+    LightAliasTable alias_table = {};
+    build_scene_light_alias_table(scene, alias_table);
+    {
+        double total_power = 0.0;
+        std::vector<double> powers(scene_light_count);
+        for (uint32_t light = 0; light < scene_light_count; ++light)
+        {
+            LIGHT const &cube_light = scene.cube_lights[light];
+            glm::mat3 obj2world = glm::mat3(daxa_f32mat4x4_to_glm_mat4(scene.instances[cube_light.instance_info.instance_id].transform));
+            powers[light] = host_get_cube_light_power(obj2world, cube_light.size, to_glm(cube_light.emissive));
+            total_power += powers[light];
+        }
+
+        std::vector<LIGHT_ALIAS> const &entries = alias_table.get_entries();
+        std::vector<double> masses(scene_light_count, 0.0);
+        double pmf_sum = 0.0;
+        for (uint32_t entry = 0; entry < entries.size(); ++entry)
+        {
+            masses[entry] += entries[entry].threshold;
+            masses[entries[entry].alias] += 1.0 - entries[entry].threshold;
+        }
+        for (uint32_t light = 0; light < scene_light_count; ++light)
+        {
+            double pmf = alias_table.get_pmf(light);
+            pmf_sum += pmf;
+            alias_power_check.add(get_relative_difference(pmf, powers[light] / total_power), 1e-4);
+            alias_mass_check.add(std::abs(masses[light] / scene_light_count - pmf), 1e-6);
+        }
+        alias_sum_check.add(std::abs(pmf_sum - 1.0), 1e-4);
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            std::vector<uint32_t> counts(scene_light_count, 0);
+            uint32_t sample_count = 1 << 20;
+            uint32_t light_index = 0;
+            float pmf = 0.0f;
+            for (uint32_t s = 0; s < sample_count; ++s)
+                if (alias_table.sample(host_rnd(rng), host_rnd(rng), light_index, pmf))
+                    ++counts[light_index];
+            alias_frequency_check.add(get_frequency_z_score(counts, sample_count, [&](uint32_t light)
+                                                            { return alias_table.get_pmf(light); }),
+                                      5.5);
+        }
+
+        LightAliasTable pooled_table = {};
+        build_scene_light_alias_table(scene, pooled_table, &pool);
+        std::vector<LIGHT_ALIAS> const &pooled_entries = pooled_table.get_entries();
+        for (uint32_t entry = 0; entry < entries.size(); ++entry)
+            alias_pool_check.add(entries[entry].threshold == pooled_entries[entry].threshold && entries[entry].alias == pooled_entries[entry].alias &&
+                                         entries[entry].pmf == pooled_entries[entry].pmf
+                                     ? 0.0
+                                     : 1.0,
+                                 0.0);
+    }
+
+    return report_checks<BenchErrorCheck>({&sum_check, &skip_check, &sample_check, &frequency_check, &refit_sum_check, &refit_skip_check,
+                                           &refit_sample_check, &refit_dead_check, &restore_check, &alias_power_check, &alias_sum_check,
+                                           &alias_mass_check, &alias_frequency_check, &alias_pool_check});
+}
+
+//////////////////////////////// COMPARE //////////////////////////////////////
+
+struct CompareSettings
+{
+    uint32_t light_count = 4096;
+    uint32_t width = 160;
+    uint32_t height = 96;
+    uint32_t candidate_count = 64;
+    double gate = 0.5;
+    uint32_t thread_count = 0;
+    uint32_t seed = 1;
+};
+
+struct PickerResult
+{
+    char const *name = "";
+    double mean = 0.0;              // mean direct light of the pixels
+    double variance = 0.0;          // mean variance of one candidate over the pixels
+    double relative_variance = 0.0; // variance / mean^2
+    double ms = 0.0;
+};
+
+struct AliasBuildResult
+{
+    uint32_t light_count = 0;
+    double sequential_ms = 0.0;
+    double pool_ms = 0.0;
+};
+
+struct CompareResult
+{
+    uint32_t light_count = 0;
+    uint32_t node_count = 0;
+    uint32_t depth = 0;
+    size_t tree_bytes = 0;
+    uint32_t pixel_count = 0;
+    double build_ms = 0.0;
+    double refit_us = 0.0;
+    double sample_ns = 0.0;
+    double pmf_ns = 0.0;
+    double alias_sample_ns = 0.0;
+    double mean_error = 0.0;       // |mean tree - mean uniform| over their standard error
+    double alias_mean_error = 0.0; // |mean power - mean uniform| over their standard error
+    PickerResult uniform = {.name = "uniform"};
+    PickerResult power = {.name = "power"};
+    PickerResult tree = {.name = "light tree"};
+    AliasBuildResult alias_builds[2] = {{.light_count = 10000}, {.light_count = 1000000}};
+};
+
+// One light sample per estimate at every shaded pixel, per pixel variance averaged over the image
+static void measure_picker(ReferenceTracer const &tracer, FieldRenderer const &renderer, CompareSettings const &settings,
+                           TilePool &pool, PickerResult &result, std::vector<double> &pixel_means, std::vector<double> &pixel_variances)
+{
+    uint32_t pixel_count = renderer.settings.width * renderer.settings.height;
+    pixel_means.assign(pixel_count, 0.0);
+    pixel_variances.assign(pixel_count, -1.0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    pool.run(renderer.settings.height, [&](uint32_t y, uint32_t)
+             {
+        uint64_t ray_count = 0;
+        for (uint32_t x = 0; x < renderer.settings.width; ++x)
+        {
+            uint32_t pixel = y * renderer.settings.width + x;
+            glm::vec3 P = {}, n = {}, wo = {};
+            MATERIAL mat = {};
+            OBJECT_INFO object = {};
+            if (!renderer.get_shading_point(tracer, pixel, P, n, wo, mat, object))
+                continue;
+
+            double sum = 0.0, sum2 = 0.0;
+            for (uint32_t c = 0; c < settings.candidate_count; ++c)
+            {
+                uint32_t seed = host_tea(pixel, 0x40000 + c);
+                double value = host_luminance(tracer.trace_path(renderer.get_ray(tracer, pixel), seed, ray_count));
+                sum += value;
+                sum2 += value * value;
+            }
+            double mean = sum / settings.candidate_count;
+            pixel_means[pixel] = mean;
+            pixel_variances[pixel] = std::max(sum2 / settings.candidate_count - mean * mean, 0.0) * settings.candidate_count /
+                                     std::max(settings.candidate_count - 1, 1U);
+        } });
+    result.ms = elapsed_ms(start);
+
+    uint32_t shaded_count = 0;
+    for (uint32_t pixel = 0; pixel < pixel_count; ++pixel)
+    {
+        if (pixel_variances[pixel] < 0.0)
+            continue;
+        ++shaded_count;
+        result.mean += pixel_means[pixel];
+        result.variance += pixel_variances[pixel];
+    }
+    result.mean /= std::max(shaded_count, 1U);
+    result.variance /= std::max(shaded_count, 1U);
+    result.relative_variance = result.mean > 0.0 ? result.variance / (result.mean * result.mean) : 0.0;
+}
+
+static CompareResult compare(CompareSettings const &settings)
+{
+    TilePool pool(settings.thread_count);
+    FieldRenderer renderer(settings.light_count, settings.width, settings.height, settings.seed, pool);
+    HostScene const &scene = renderer.scene;
+
+    CompareResult result = {};
+    result.light_count = static_cast<uint32_t>(scene.cube_lights.size());
+
+    LightTree tree = {};
+    auto start = std::chrono::high_resolution_clock::now();
+    build_scene_light_tree(scene, tree);
+    result.build_ms = elapsed_ms(start);
+    result.node_count = tree.get_node_count();
+    result.depth = tree.get_depth();
+    result.tree_bytes = tree.get_memory_size();
+
+    // Refit cost of a brush delete & its undo
+    {
+        LightTree refit_tree = tree;
+        uint32_t rng = host_tea(settings.seed, 0x31);
+        uint32_t refit_count = std::min(result.light_count / 2, 1024U);
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < refit_count; ++i)
+        {
+            uint32_t live_count = result.light_count - i;
+            uint32_t deleted = std::min(static_cast<uint32_t>(host_rnd(rng) * live_count), live_count - 1);
+            refit_tree.remove_light(deleted, deleted == live_count - 1 ? LightTree::INVALID_LIGHT : live_count - 1);
+        }
+        result.refit_us = elapsed_ms(start) * 1e3 / std::max(refit_count, 1U);
+    }
+
+    // Alias table builds of synthetic heavy tailed powers, the best of a few runs
+    for (AliasBuildResult &alias_build : result.alias_builds)
+    {
+        uint32_t rng = host_tea(settings.seed, alias_build.light_count);
+        std::vector<float> weights(alias_build.light_count);
+        for (float &weight : weights)
+            weight = host_rnd(rng) < 0.02f ? 200.0f : 0.5f + 4.0f * host_rnd(rng) * host_rnd(rng);
+
+        LightAliasTable table = {};
+        alias_build.sequential_ms = best_ms(5, [&]
+                                            { table.build(weights); });
+        alias_build.pool_ms = best_ms(5, [&]
+                                      { table.build(weights, &pool); });
+    }
+
+    LightAliasTable alias_table = {};
+    build_scene_light_alias_table(scene, alias_table, &pool);
+
+    ReferenceTracer uniform_tracer(renderer.accel, renderer.settings);
+    ReferenceTracer power_tracer(renderer.accel, renderer.settings);
+    power_tracer.set_light_alias_table(&alias_table);
+    ReferenceTracer tree_tracer(renderer.accel, renderer.settings);
+    tree_tracer.set_light_tree(&tree);
+
+    // Sampling & pmf cost alone
+    {
+        uint32_t rng = host_tea(settings.seed, 0x41);
+        uint32_t query_count = 1 << 16;
+        glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+        glm::vec3 extent = scene.bounds_max - scene.bounds_min;
+        std::vector<glm::vec3> queries(query_count);
+        for (auto &query : queries)
+            query = scene.bounds_min + glm::vec3(host_rnd(rng), 0.0f, host_rnd(rng)) * extent + glm::vec3(0.0f, center.y * 0.1f, 0.0f);
+
+        uint32_t checksum = 0;
+        std::vector<uint32_t> picked(query_count, 0);
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < query_count; ++i)
+        {
+            float pmf = 0.0f;
+            if (tree.sample(queries[i], glm::vec3(0.0f, 1.0f, 0.0f), host_rnd(rng), picked[i], pmf))
+                checksum += picked[i];
+        }
+        result.sample_ns = elapsed_ms(start) * 1e6 / query_count;
+
+        float pmf_sum = 0.0f;
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < query_count; ++i)
+            pmf_sum += tree.get_pmf(queries[i], glm::vec3(0.0f, 1.0f, 0.0f), picked[i]);
+        result.pmf_ns = elapsed_ms(start) * 1e6 / query_count;
+
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < query_count; ++i)
+        {
+            float pmf = 0.0f;
+            if (alias_table.sample(host_rnd(rng), host_rnd(rng), picked[i], pmf))
+                checksum += picked[i];
+        }
+        result.alias_sample_ns = elapsed_ms(start) * 1e6 / query_count;
+
+#if TRACE == 1
+        std::cout << "checksum " << checksum << " " << pmf_sum << std::endl;
+#else
+        (void)checksum;
+        (void)pmf_sum;
+#endif // TRACE
+    }
+
+    std::vector<double> uniform_means = {}, uniform_variances = {};
+    std::vector<double> power_means = {}, power_variances = {};
+    std::vector<double> tree_means = {}, tree_variances = {};
+    measure_picker(uniform_tracer, renderer, settings, pool, result.uniform, uniform_means, uniform_variances);
+    measure_picker(power_tracer, renderer, settings, pool, result.power, power_means, power_variances);
+    measure_picker(tree_tracer, renderer, settings, pool, result.tree, tree_means, tree_variances);
+
+    // Every picker estimates the same image: the difference of the means over its standard error
+    auto get_mean_error = [&](PickerResult const &picker, std::vector<double> const &variances)
+    {
+        double variance_of_difference = 0.0;
+        uint32_t shaded_count = 0;
+        for (uint32_t pixel = 0; pixel < uniform_means.size(); ++pixel)
+        {
+            if (uniform_variances[pixel] < 0.0)
+                continue;
+            ++shaded_count;
+            variance_of_difference += (uniform_variances[pixel] + variances[pixel]) / settings.candidate_count;
+        }
+        result.pixel_count = shaded_count;
+        double standard_error = std::sqrt(variance_of_difference) / std::max(shaded_count, 1U);
+        return standard_error > 0.0 ? std::abs(picker.mean - result.uniform.mean) / standard_error : 0.0;
+    };
+    result.mean_error = get_mean_error(result.tree, tree_variances);
+    result.alias_mean_error = get_mean_error(result.power, power_variances);
+
+    return result;
+}
+
+static bool is_passing(CompareResult const &result, CompareSettings const &settings)
+{
+    return result.tree.variance <= settings.gate * result.uniform.variance && result.mean_error < 5.0 &&
+           result.power.variance <= settings.gate * result.uniform.variance && result.alias_mean_error < 5.0;
+}
+
+static void write_json(std::ostream &out, CompareResult const &result, CompareSettings const &settings)
+{
+    auto write_picker = [&](PickerResult const &picker)
+    {
+        out << "{\"mean\": " << picker.mean << ", \"variance\": " << picker.variance << ", \"relative_variance\": " << picker.relative_variance
+            << ", \"ms\": " << picker.ms << "}";
+    };
+
+    out << "{\n";
+    out << "  \"lights\": " << result.light_count << ",\n";
+    out << "  \"nodes\": " << result.node_count << ",\n";
+    out << "  \"depth\": " << result.depth << ",\n";
+    out << "  \"tree_bytes\": " << result.tree_bytes << ",\n";
+    out << "  \"pixels\": " << result.pixel_count << ",\n";
+    out << "  \"candidates\": " << settings.candidate_count << ",\n";
+    out << "  \"build_ms\": " << result.build_ms << ",\n";
+    out << "  \"refit_us\": " << result.refit_us << ",\n";
+    out << "  \"sample_ns\": " << result.sample_ns << ",\n";
+    out << "  \"pmf_ns\": " << result.pmf_ns << ",\n";
+    out << "  \"alias_sample_ns\": " << result.alias_sample_ns << ",\n";
+    out << "  \"alias_builds\": [";
+    for (uint32_t i = 0; i < 2; ++i)
+        out << (i == 0 ? "" : ", ") << "{\"lights\": " << result.alias_builds[i].light_count << ", \"sequential_ms\": "
+            << result.alias_builds[i].sequential_ms << ", \"pool_ms\": " << result.alias_builds[i].pool_ms << "}";
+    out << "],\n";
+    out << "  \"uniform\": ";
+    write_picker(result.uniform);
+    out << ",\n  \"power\": ";
+    write_picker(result.power);
+    out << ",\n  \"light_tree\": ";
+    write_picker(result.tree);
+    out << ",\n";
+    out << "  \"variance_ratio\": " << (result.uniform.variance > 0.0 ? result.tree.variance / result.uniform.variance : 0.0) << ",\n";
+    out << "  \"alias_variance_ratio\": " << (result.uniform.variance > 0.0 ? result.power.variance / result.uniform.variance : 0.0) << ",\n";
+    out << "  \"mean_error_sigma\": " << result.mean_error << ",\n";
+    out << "  \"alias_mean_error_sigma\": " << result.alias_mean_error << ",\n";
+    out << "  \"passed\": " << (is_passing(result, settings) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, CompareResult const &result, CompareSettings const &settings)
+{
+    out << "light tree: " << result.light_count << " lights, " << result.node_count << " nodes, depth " << result.depth << ", "
+        << result.tree_bytes / 1024 << " KiB" << std::endl;
+    out << "  build " << result.build_ms << " ms, refit " << result.refit_us << " us per delete, sample " << result.sample_ns
+        << " ns, pmf " << result.pmf_ns << " ns" << std::endl;
+    out << "alias table: sample " << result.alias_sample_ns << " ns";
+    for (AliasBuildResult const &alias_build : result.alias_builds)
+        out << ", build " << alias_build.light_count << " lights " << alias_build.sequential_ms << " ms (pool "
+            << alias_build.pool_ms << " ms)";
+    out << std::endl;
+    out << result.pixel_count << " pixels, " << settings.candidate_count << " candidates each" << std::endl;
+    out << "picker       mean         variance     rel. variance  ms" << std::endl;
+    for (PickerResult const *picker : {&result.uniform, &result.power, &result.tree})
+    {
+        write_cell(out, picker->name, 13);
+        out << picker->mean << "  " << picker->variance << "  " << picker->relative_variance << "  " << picker->ms << std::endl;
+    }
+    out << "variance ratio: power " << (result.uniform.variance > 0.0 ? result.power.variance / result.uniform.variance : 0.0)
+        << ", light tree " << (result.uniform.variance > 0.0 ? result.tree.variance / result.uniform.variance : 0.0)
+        << " (gate " << settings.gate << "), means " << result.alias_mean_error << " & " << result.mean_error
+        << " sigma from uniform" << std::endl;
+    out << (is_passing(result, settings) ? "passed" : "FAILED") << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    CompareSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--lights N] [--width N] [--height N] [--candidates N] [--gate X] [--threads N] [--seed N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--lights"))
+            settings.light_count = std::min(args.get_uint(1), static_cast<uint32_t>(MAX_CUBE_LIGHTS));
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--candidates"))
+            settings.candidate_count = args.get_uint(2);
+        else if (args.is("--gate"))
+            settings.gate = args.get_double();
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--seed"))
+            settings.seed = args.get_uint();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.light_count, settings.seed, settings.thread_count) ? 0 : 1;
+
+    CompareResult result = compare(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return is_passing(result, settings) ? 0 : 1;
+}
@@ -0,0 +1,423 @@
+// Headless loader & scene build benchmark.
+// Parses every model of a directory into plain host arrays (no window, no Vulkan device)
+// and reports parse time, throughput, memory & allocations per loader path.
+// Voxels merged into boxes (box_merger.hpp) are compared with one box per voxel: primitive count, build time of the
+// per instance BVHs (host_accel.hpp, the host stand-in for the BLAS builds) & memory of the primitive buffers and BVHs.
+//
+// usage: loader_bench [models dir] [--repeat N] [--max-primitives N] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "map_loader.hpp"
+#include "map_streamer.hpp"
+#include "model_load_pool.hpp"
+#include "host_accel.hpp"
+
+#include <atomic>
+#include <memory>
+#include <new>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+//////////////////////////////// ALLOCATIONS //////////////////////////////////////
+
+// NOTE: only C++ allocations are counted, gvox allocates with malloc
+static std::atomic<uint64_t> allocation_count = 0;
+static std::atomic<uint64_t> allocated_bytes = 0;
+
+void *operator new(size_t size)
+{
+    ++allocation_count;
+    allocated_bytes += size;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+//////////////////////////////// MEMORY //////////////////////////////////////
+
+// Peak resident set size in KiB. On Linux the high water mark of /proc/self/status, which reset_peak_rss resets,
+// elsewhere the peak of the whole process
+static uint64_t get_peak_rss_kb()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize >> 10;
+    return 0;
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line = {};
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+    }
+    return 0;
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss) >> 10;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+// Reset the peak to the current RSS so every load reports its own (Linux only, the peak is process wide elsewhere)
+static void reset_peak_rss()
+{
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs.is_open())
+        clear_refs << "5";
+#endif
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+enum class LOADER_PATH
+{
+    DIRECT,
+    MERGED,
+    STREAMED,
+};
+
+static const char *loader_path_name(LOADER_PATH path)
+{
+    switch (path)
+    {
+    case LOADER_PATH::DIRECT:
+        return "direct";
+    case LOADER_PATH::MERGED:
+        return "merged";
+    case LOADER_PATH::STREAMED:
+        return "streamed";
+    }
+    return "unknown";
+}
+
+struct BenchResult
+{
+    std::string file = {};
+    LOADER_PATH path = LOADER_PATH::DIRECT;
+    GvoxModelData model_data = {};
+    double best_ms = 0.0;
+    double median_ms = 0.0;
+    double voxels_per_second = 0.0;
+    uint64_t peak_rss_kb = 0;
+    uint64_t allocation_count = 0;
+    uint64_t allocated_bytes = 0;
+};
+
+// Plain host arrays the loader writes into, default initialized so only touched pages count towards RSS
+struct LoaderArrays
+{
+    uint32_t max_primitive_count = 0;
+    std::unique_ptr<INSTANCE[]> instances = {};
+    std::unique_ptr<AABB[]> aabbs = {};
+    std::unique_ptr<PRIMITIVE[]> primitives = {};
+    std::unique_ptr<MATERIAL[]> materials = {};
+    std::unique_ptr<LIGHT[]> lights = {};
+
+    void create(uint32_t primitive_count)
+    {
+        max_primitive_count = primitive_count;
+        instances = std::unique_ptr<INSTANCE[]>(new INSTANCE[MAX_INSTANCES]);
+        aabbs = std::unique_ptr<AABB[]>(new AABB[max_primitive_count]);
+        primitives = std::unique_ptr<PRIMITIVE[]>(new PRIMITIVE[max_primitive_count]);
+        materials = std::unique_ptr<MATERIAL[]>(new MATERIAL[MAX_MATERIALS]);
+        lights = std::unique_ptr<LIGHT[]>(new LIGHT[MAX_CUBE_LIGHTS]);
+    }
+};
+
+static GvoxModelData load_once(MapLoader &loader, LoaderArrays &scene, std::filesystem::path const &path, LOADER_PATH loader_path)
+{
+    GvoxRegionQueue region_queue = {};
+
+    GvoxModelDataSerialize params = GvoxModelDataSerialize{
+        .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
+        .max_instance_count = MAX_INSTANCES,
+        .current_instance_index = 0,
+        .instances = scene.instances.get(),
+        .current_primitive_index = 0,
+        .max_primitive_count = scene.max_primitive_count,
+        .primitives = scene.primitives.get(),
+        .aabbs = scene.aabbs.get(),
+        .current_material_index = 0,
+        .max_material_count = MAX_MATERIALS,
+        .materials = scene.materials.get(),
+        .current_light_index = 0,
+        .max_light_count = MAX_CUBE_LIGHTS,
+        .lights = scene.lights.get(),
+        .merge_boxes = loader_path == LOADER_PATH::MERGED,
+        .region_queue = loader_path == LOADER_PATH::STREAMED ? &region_queue : nullptr,
+    };
+
+    return loader.load_gvox_data(path, params);
+}
+
+static BenchResult bench_file(MapLoader &loader, LoaderArrays &scene, std::filesystem::path const &path, LOADER_PATH loader_path, uint32_t repeat)
+{
+    BenchResult result = {
+        .file = path.filename().string(),
+        .path = loader_path,
+    };
+
+    std::vector<double> times = {};
+    times.reserve(repeat);
+
+    reset_peak_rss();
+    uint64_t start_allocation_count = allocation_count;
+    uint64_t start_allocated_bytes = allocated_bytes;
+
+    for (uint32_t i = 0; i < repeat; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        result.model_data = load_once(loader, scene, path, loader_path);
+        times.push_back(elapsed_ms(start));
+    }
+
+    result.peak_rss_kb = get_peak_rss_kb();
+    result.allocation_count = (allocation_count - start_allocation_count) / repeat;
+    result.allocated_bytes = (allocated_bytes - start_allocated_bytes) / repeat;
+
+    std::sort(times.begin(), times.end());
+    result.best_ms = times.front();
+    result.median_ms = times[times.size() / 2];
+    if (result.best_ms > 0.0)
+        result.voxels_per_second = result.model_data.voxel_count / (result.best_ms * 0.001);
+
+    return result;
+}
+
+// Scene build of one model, voxels merged into boxes or not
+struct BuildResult
+{
+    std::string file = {};
+    bool merged = false;
+    uint64_t primitive_count = 0;
+    double build_ms = 0.0;        // best of the repeats
+    uint64_t primitive_bytes = 0; // AABB & PRIMITIVE buffers
+    uint64_t accel_bytes = 0;     // BVH nodes & indices
+};
+
+static BuildResult bench_build(MapLoader &loader, std::filesystem::path const &path, bool merged, uint32_t repeat, TilePool &pool)
+{
+    BuildResult result = {.file = path.filename().string(), .merged = merged};
+    HostScene scene = {};
+    if (!scene.load_model(loader, path, glm::mat4(1.0f), AXIS_DIRECTION::X_BOTTOM_TOP, merged))
+        return result;
+    result.primitive_count = scene.get_primitive_count();
+    result.primitive_bytes = scene.aabbs.size() * sizeof(AABB) + scene.primitives.size() * sizeof(PRIMITIVE);
+
+    result.build_ms = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < repeat; ++i)
+    {
+        HostAccel accel = {};
+        auto start = std::chrono::high_resolution_clock::now();
+        accel.build(scene, pool);
+        result.build_ms = std::min(result.build_ms, elapsed_ms(start));
+        result.accel_bytes = accel.get_memory_size();
+    }
+    return result;
+}
+
+// Merged over unmerged, 0 without the unmerged value
+static double get_ratio(double merged, double unmerged)
+{
+    return unmerged > 0.0 ? merged / unmerged : 0.0;
+}
+
+// Every model loaded at once through the loader pool, wall time of the whole batch
+static double bench_pool(std::vector<std::filesystem::path> const &files, uint32_t &thread_count)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        ModelLoadPool pool = {};
+        thread_count = pool.get_thread_count();
+        std::vector<std::shared_future<GvoxModelData>> loads = {};
+        for (auto const &file : files)
+        {
+            loads.push_back(pool.load_async(GvoxModelLoadInfo{
+                .gvox_model_path = file,
+                .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
+            }));
+        }
+        for (auto &load : loads)
+            load.wait();
+    }
+    return elapsed_ms(start);
+}
+
+static void write_json(std::ostream &out, std::vector<BenchResult> const &results, std::vector<BuildResult> const &builds, uint32_t repeat,
+                       double pool_ms, uint32_t pool_threads)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"loader\",\n";
+    out << "  \"repeat\": " << repeat << ",\n";
+    out << "  \"merged_boxes_on\": " << MERGED_BOXES_ON << ",\n";
+    out << "  \"pool\": {\"threads\": " << pool_threads << ", \"total_ms\": " << pool_ms << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto const &result = results[i];
+        out << "    {"
+            << "\"file\": \"" << result.file << "\", "
+            << "\"path\": \"" << loader_path_name(result.path) << "\", "
+            << "\"best_ms\": " << result.best_ms << ", "
+            << "\"median_ms\": " << result.median_ms << ", "
+            << "\"voxels\": " << result.model_data.voxel_count << ", "
+            << "\"voxels_per_second\": " << static_cast<uint64_t>(result.voxels_per_second) << ", "
+            << "\"instances\": " << result.model_data.instance_count << ", "
+            << "\"primitives\": " << result.model_data.primitive_count << ", "
+            << "\"materials\": " << result.model_data.material_count << ", "
+            << "\"lights\": " << result.model_data.light_count << ", "
+            << "\"allocations\": " << result.allocation_count << ", "
+            << "\"allocated_bytes\": " << result.allocated_bytes << ", "
+            << "\"peak_rss_kb\": " << result.peak_rss_kb
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"builds\": [\n";
+    for (size_t i = 0; i < builds.size(); ++i)
+    {
+        auto const &build = builds[i];
+        out << "    {"
+            << "\"file\": \"" << build.file << "\", "
+            << "\"merged\": " << (build.merged ? "true" : "false") << ", "
+            << "\"primitives\": " << build.primitive_count << ", "
+            << "\"build_ms\": " << build.build_ms << ", "
+            << "\"primitive_bytes\": " << build.primitive_bytes << ", "
+            << "\"accel_bytes\": " << build.accel_bytes
+            << "}" << (i + 1 < builds.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, std::vector<BenchResult> const &results, std::vector<BuildResult> const &builds, double pool_ms,
+                        uint32_t pool_threads)
+{
+    out << std::endl;
+    for (auto const &result : results)
+    {
+        out << result.file << " [" << loader_path_name(result.path) << "]" << std::endl;
+        out << "  parse: " << result.best_ms << " ms (median " << result.median_ms << " ms)" << std::endl;
+        out << "  voxels: " << result.model_data.voxel_count << " (" << (result.voxels_per_second * 1e-6) << " Mvoxels/s)" << std::endl;
+        out << "  instances: " << result.model_data.instance_count
+            << " primitives: " << result.model_data.primitive_count
+            << " materials: " << result.model_data.material_count
+            << " lights: " << result.model_data.light_count << std::endl;
+        out << "  allocations: " << result.allocation_count << " (" << (result.allocated_bytes >> 10) << " KiB)"
+            << " peak RSS: " << (result.peak_rss_kb >> 10) << " MiB" << std::endl;
+    }
+    out << "pool (" << pool_threads << " threads): every model in " << pool_ms << " ms" << std::endl;
+
+    // Unmerged & merged builds of a file follow each other
+    out << std::endl;
+    for (size_t i = 0; i + 1 < builds.size(); i += 2)
+    {
+        BuildResult const &unmerged = builds[i], &merged = builds[i + 1];
+        out << unmerged.file << " [merged / unmerged]" << std::endl;
+        out << "  primitives: " << merged.primitive_count << " / " << unmerged.primitive_count
+            << " (" << get_ratio(static_cast<double>(merged.primitive_count), static_cast<double>(unmerged.primitive_count)) << "x)" << std::endl;
+        out << "  BVH build: " << merged.build_ms << " / " << unmerged.build_ms << " ms (" << get_ratio(merged.build_ms, unmerged.build_ms) << "x)" << std::endl;
+        out << "  memory: " << ((merged.primitive_bytes + merged.accel_bytes) >> 10) << " / " << ((unmerged.primitive_bytes + unmerged.accel_bytes) >> 10)
+            << " KiB (" << get_ratio(static_cast<double>(merged.primitive_bytes + merged.accel_bytes), static_cast<double>(unmerged.primitive_bytes + unmerged.accel_bytes))
+            << "x), primitives " << (merged.primitive_bytes >> 10) << " / " << (unmerged.primitive_bytes >> 10)
+            << " KiB, BVH " << (merged.accel_bytes >> 10) << " / " << (unmerged.accel_bytes >> 10) << " KiB" << std::endl;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path models_path = "assets/models";
+    std::filesystem::path json_path = {};
+    uint32_t repeat = 3;
+    uint32_t max_primitive_count = 1U << 24;
+
+    BenchArgs args(argc, argv, "[models dir] [--repeat N] [--max-primitives N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--repeat"))
+            repeat = args.get_uint(1);
+        else if (args.is("--max-primitives"))
+            max_primitive_count = std::min(args.get_uint(), MAX_PRIMITIVES);
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else if (args.is_positional())
+            models_path = args.get_current();
+        else
+            return args.usage();
+    }
+
+    std::vector<std::filesystem::path> files = {};
+    std::error_code error = {};
+    for (auto const &entry : std::filesystem::directory_iterator(models_path, error))
+    {
+        if (entry.is_regular_file() && entry.path().extension() != ".png")
+            files.push_back(entry.path());
+    }
+    if (error || files.empty())
+    {
+        std::cerr << "No models found in " << models_path.string() << std::endl;
+        return 1;
+    }
+    // Stable order so runs can be compared
+    std::sort(files.begin(), files.end());
+
+    LoaderArrays scene = {};
+    scene.create(max_primitive_count);
+
+    MapLoader loader = {};
+    loader.create_gvox_context();
+
+    std::vector<BenchResult> results = {};
+    for (auto const &file : files)
+    {
+        for (auto loader_path : {LOADER_PATH::DIRECT, LOADER_PATH::MERGED, LOADER_PATH::STREAMED})
+        {
+            results.push_back(bench_file(loader, scene, file, loader_path, repeat));
+        }
+    }
+
+    std::vector<BuildResult> builds = {};
+    {
+        TilePool pool = {};
+        for (auto const &file : files)
+            for (bool merged : {false, true})
+                builds.push_back(bench_build(loader, file, merged, repeat, pool));
+    }
+
+    loader.destroy_gvox_context();
+
+    uint32_t pool_threads = 0;
+    double pool_ms = bench_pool(files, pool_threads);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, results, builds, repeat, pool_ms, pool_threads); }))
+        return 1;
+
+    write_table(std::cout, results, builds, pool_ms, pool_threads);
+
+    return 0;
+}
@@ -0,0 +1,377 @@
+// Noise volume benchmark & checks.
+// Bakes a tileable turbulence volume (noise_volume.hpp) with the scalar octave loop on one thread, the 8 wide kernel
+// on one thread and the 8 wide kernel on every thread, times writing it to the cache & loading it back, then compares
+// the per-sample octave loop with one trilinear fetch of the baked volume on random points (cost & RMS difference).
+// --verify N checks on N random settings: the 8 wide kernel against the scalar loop bit for bit (points & whole
+// volumes), noise at lattice points, value ranges, tiling under shifts by the period, voxels against the loop at their
+// centers, fetches at voxel centers, cache round trips, cache keys of every setting, rejected stale & truncated files,
+// seeds & thread counts and rejected settings. The exit code is not 0 when one fails, or in the default mode when the
+// 8 wide bake differs from the scalar one.
+//
+// usage: noise_volume_bench [--verify N] [--resolution N] [--period N] [--octaves N] [--seed N] [--samples N]
+//                           [--repeat N] [--threads N] [--cache dir] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "noise_volume.hpp"
+#include "sampler.hpp"
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchSettings
+{
+    NoiseVolumeSettings noise = {};
+    uint32_t sample_count = 1U << 20;
+    uint32_t repeat = 3;
+    uint32_t thread_count = 0;
+    std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "cube_tracing_noise_bench";
+};
+
+struct BenchResult
+{
+    uint32_t thread_count = 0;
+    double scalar_ms = 0.0;     // octave loop, one thread
+    double wide_ms = 0.0;       // 8 wide kernel, one thread
+    double wide_pool_ms = 0.0;  // 8 wide kernel, every thread
+    double write_ms = 0.0;
+    double load_ms = 0.0;
+    size_t file_bytes = 0;
+    double loop_ns = 0.0;       // per sample
+    double fetch_ns = 0.0;      // per sample
+    double fetch_rms = 0.0;     // between the loop & the fetch
+    double loop_rms = 0.0;      // of the loop, scale of the difference
+    bool same_bake = false;     // 8 wide bits equal the scalar ones
+};
+
+static bool same_voxels(NoiseVolume const &a, NoiseVolume const &b)
+{
+    return a.voxels.size() == b.voxels.size() && std::memcmp(a.voxels.data(), b.voxels.data(), a.voxels.size() * sizeof(float)) == 0;
+}
+
+static BenchResult measure(BenchSettings const &settings)
+{
+    BenchResult result = {};
+    TilePool one_thread(1);
+    TilePool pool(settings.thread_count);
+    result.thread_count = pool.get_thread_count();
+
+    NoiseVolume scalar = {}, wide = {}, wide_pool = {};
+    result.scalar_ms = best_ms(settings.repeat, [&]()
+                               { bake_noise_volume(settings.noise, scalar, one_thread, false); });
+    result.wide_ms = best_ms(settings.repeat, [&]()
+                             { bake_noise_volume(settings.noise, wide, one_thread); });
+    result.wide_pool_ms = best_ms(settings.repeat, [&]()
+                                  { bake_noise_volume(settings.noise, wide_pool, pool); });
+    result.same_bake = same_voxels(scalar, wide) && same_voxels(scalar, wide_pool);
+
+    std::error_code error = {};
+    std::filesystem::create_directories(settings.cache_dir, error);
+    std::filesystem::path path = get_noise_volume_path(settings.cache_dir, settings.noise);
+    result.write_ms = best_ms(settings.repeat, [&]()
+                              { write_noise_volume(path, wide_pool); });
+    result.file_bytes = static_cast<size_t>(std::filesystem::file_size(path, error));
+    NoiseVolume loaded = {};
+    result.load_ms = best_ms(settings.repeat, [&]()
+                             { read_noise_volume(path, settings.noise, loaded); });
+#if WARN
+    if (!same_voxels(loaded, wide_pool))
+        std::cerr << "measure: cached volume differs from the baked one" << std::endl;
+#endif // WARN
+
+    // Random points over a few tiles, like the hits of a perlin material
+    std::vector<glm::vec3> points(settings.sample_count);
+    float extent = 4.0f * static_cast<float>(settings.noise.period);
+    for (uint32_t i = 0; i < settings.sample_count; ++i)
+        for (uint32_t c = 0; c < 3; ++c)
+            points[i][c] = host_sampler_to_float(host_sampler_pcg(i * 3 + c)) * extent;
+
+    NoisePermutation permutation(settings.noise.seed);
+    std::vector<float> loop_values(points.size()), fetch_values(points.size());
+    double loop_ms = best_ms(settings.repeat, [&]()
+                             {
+        for (size_t i = 0; i < points.size(); ++i)
+            loop_values[i] = host_noise_turbulence(points[i], settings.noise, permutation); });
+    double fetch_ms = best_ms(settings.repeat, [&]()
+                              {
+        for (size_t i = 0; i < points.size(); ++i)
+            fetch_values[i] = wide_pool.sample(points[i]); });
+    result.loop_ns = loop_ms * 1e6 / static_cast<double>(points.size());
+    result.fetch_ns = fetch_ms * 1e6 / static_cast<double>(points.size());
+
+    double difference = 0.0, magnitude = 0.0;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        double d = static_cast<double>(fetch_values[i]) - loop_values[i];
+        difference += d * d;
+        magnitude += static_cast<double>(loop_values[i]) * loop_values[i];
+    }
+    result.fetch_rms = std::sqrt(difference / static_cast<double>(points.size()));
+    result.loop_rms = std::sqrt(magnitude / static_cast<double>(points.size()));
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static bool same_bits(float a, float b) { return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b); }
+
+static bool verify(uint32_t trial_count, uint32_t thread_count, std::filesystem::path const &cache_dir)
+{
+    BenchCheck wide_check = {.name = "8 wide kernel equals the scalar loop bit for bit"};
+    BenchCheck lattice_check = {.name = "noise is 0 at lattice points"};
+    BenchCheck range_check = {.name = "noise & turbulence within their bounds"};
+    BenchCheck tiling_check = {.name = "turbulence & volumes tile with the period"};
+    BenchCheck bake_check = {.name = "voxels equal the loop at their centers"};
+    BenchCheck sample_check = {.name = "fetches at voxel centers equal the voxels"};
+    BenchCheck cache_check = {.name = "cache round trips are exact"};
+    BenchCheck key_check = {.name = "every setting changes the cache key"};
+    BenchCheck reject_check = {.name = "stale & truncated files rejected"};
+    BenchCheck thread_check = {.name = "volumes depend on the seed, not the thread count"};
+    BenchCheck invalid_check = {.name = "untileable settings rejected"};
+
+    BenchRandom random = {};
+
+    TilePool one_thread(1);
+    TilePool pool(thread_count);
+    std::filesystem::path trial_dir = cache_dir / "verify";
+    std::error_code error = {};
+    std::filesystem::remove_all(trial_dir, error);
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        NoiseVolumeSettings settings = {
+            .seed = random.next_below(1U << 16),
+            .resolution = 8 + random.next_below(41), // not only multiples of 8
+            .period = 1U << random.next_below(6),
+            .octaves = 1 + random.next_below(5),
+            .lacunarity = 1U << random.next_below(3),
+            .gain = 0.25f + 0.5f * random.next_float(),
+            .turbulence = random.next_below(2) == 0,
+        };
+        NoisePermutation permutation(settings.seed);
+        float period = static_cast<float>(settings.period);
+
+        // Points: random, negative, far away & on lattice planes
+        for (uint32_t packet = 0; packet < 64; ++packet)
+        {
+            float px[NOISE_LANE_COUNT], py[NOISE_LANE_COUNT], pz[NOISE_LANE_COUNT], out[NOISE_LANE_COUNT];
+            for (uint32_t lane = 0; lane < NOISE_LANE_COUNT; ++lane)
+            {
+                float extent = packet % 4 == 0 ? 4096.0f : 4.0f * period;
+                px[lane] = (random.next_float() * 2.0f - 1.0f) * extent;
+                py[lane] = (random.next_float() * 2.0f - 1.0f) * extent;
+                pz[lane] = random.next_float() * extent;
+                if (packet % 3 == 0)
+                    pz[lane] = std::floor(pz[lane]);
+            }
+            host_noise_turbulence_x8(px, py, pz, settings, permutation, out);
+            for (uint32_t lane = 0; lane < NOISE_LANE_COUNT; ++lane)
+                wide_check.add(same_bits(out[lane], host_noise_turbulence(glm::vec3(px[lane], py[lane], pz[lane]), settings, permutation)));
+        }
+
+        float amplitude_sum = 0.0f, amplitude = 1.0f;
+        for (uint32_t i = 0; i < settings.octaves; ++i, amplitude *= settings.gain)
+            amplitude_sum += amplitude;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            glm::vec3 lattice = glm::vec3(static_cast<float>(random.next_below(512)), static_cast<float>(random.next_below(512)), static_cast<float>(random.next_below(512))) - 256.0f;
+            lattice_check.add(host_noise_gradient(lattice, settings.period, permutation) == 0.0f);
+
+            glm::vec3 p = glm::vec3(random.next_float(), random.next_float(), random.next_float()) * 64.0f - 32.0f;
+            float noise = host_noise_gradient(p, settings.period, permutation);
+            float turbulence = host_noise_turbulence(p, settings, permutation);
+            range_check.add(std::abs(noise) <= 1.05f && std::abs(turbulence) <= 1.05f * amplitude_sum && (!settings.turbulence || turbulence >= 0.0f));
+
+            // Multiples of 1/64 shift exactly
+            glm::vec3 grid = glm::floor(p * 64.0f) / 64.0f;
+            glm::vec3 shift = glm::vec3(static_cast<float>(random.next_below(5)) - 2.0f, static_cast<float>(random.next_below(5)) - 2.0f, static_cast<float>(random.next_below(5)) - 2.0f) * period;
+            tiling_check.add(same_bits(host_noise_turbulence(grid, settings, permutation), host_noise_turbulence(grid + shift, settings, permutation)));
+        }
+
+        NoiseVolume scalar = {}, wide = {}, wide_pool = {};
+        bool baked = bake_noise_volume(settings, scalar, one_thread, false) && bake_noise_volume(settings, wide, one_thread) &&
+                     bake_noise_volume(settings, wide_pool, pool);
+        wide_check.add(baked && same_voxels(scalar, wide));
+        thread_check.add(baked && same_voxels(wide, wide_pool));
+        if (!baked)
+            continue;
+
+        uint32_t resolution = settings.resolution;
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            uint32_t x = random.next_below(resolution), y = random.next_below(resolution), z = random.next_below(resolution);
+            glm::vec3 center = {get_noise_voxel_center(x, settings), get_noise_voxel_center(y, settings), get_noise_voxel_center(z, settings)};
+            float voxel = wide_pool.get_voxel(x, y, z);
+            bake_check.add(same_bits(voxel, host_noise_turbulence(center, settings, permutation)));
+            float tolerance = 1e-4f * std::max(1.0f, std::abs(voxel));
+            sample_check.add(std::abs(wide_pool.sample(center) - voxel) <= tolerance);
+            tiling_check.add(std::abs(wide_pool.sample(center + glm::vec3(period, -period, 2.0f * period)) - voxel) <= tolerance);
+        }
+        // Across the tile edge the fetch blends the last & first voxels
+        {
+            float edge = wide_pool.sample(glm::vec3(0.0f, get_noise_voxel_center(0, settings), get_noise_voxel_center(0, settings)));
+            float expected = 0.5f * (wide_pool.get_voxel(resolution - 1, 0, 0) + wide_pool.get_voxel(0, 0, 0));
+            tiling_check.add(std::abs(edge - expected) <= 1e-4f * std::max(1.0f, std::abs(expected)));
+        }
+
+        // Cache: baked first, then loaded with the same bits
+        NoiseVolume first = {}, second = {};
+        bool first_from_cache = true, second_from_cache = false;
+        bool loaded = load_or_bake_noise_volume(trial_dir, settings, first, pool, &first_from_cache) &&
+                      load_or_bake_noise_volume(trial_dir, settings, second, pool, &second_from_cache);
+        cache_check.add(loaded && !first_from_cache && second_from_cache && same_voxels(first, wide) && same_voxels(second, wide) &&
+                        second.settings == settings);
+
+        NoiseVolumeSettings changed[] = {settings, settings, settings, settings, settings, settings, settings};
+        changed[0].seed ^= 1;
+        changed[1].resolution += 1;
+        changed[2].period *= 2;
+        changed[3].octaves += 1;
+        changed[4].lacunarity *= 2;
+        changed[5].gain += 0.125f;
+        changed[6].turbulence = !settings.turbulence;
+        std::filesystem::path path = get_noise_volume_path(trial_dir, settings);
+        for (NoiseVolumeSettings const &other : changed)
+        {
+            key_check.add(get_noise_volume_key(other) != get_noise_volume_key(settings) && get_noise_volume_path(trial_dir, other) != path);
+            NoiseVolume stale = {};
+            reject_check.add(!read_noise_volume(path, other, stale));
+        }
+
+        // Truncated & foreign files
+        std::filesystem::path truncated = trial_dir / "truncated.bin";
+        std::filesystem::copy_file(path, truncated, std::filesystem::copy_options::overwrite_existing, error);
+        std::filesystem::resize_file(truncated, std::filesystem::file_size(path) - sizeof(float) * (1 + random.next_below(resolution)), error);
+        NoiseVolume broken = {};
+        reject_check.add(!error && !read_noise_volume(truncated, settings, broken) && broken.voxels.empty());
+        {
+            std::ofstream foreign(truncated, std::ios::binary);
+            foreign << "P6\n1 1\n255\n";
+        }
+        reject_check.add(!read_noise_volume(truncated, settings, broken));
+        reject_check.add(!read_noise_volume(trial_dir / "missing.bin", settings, broken));
+
+        // The next seed bakes another volume, unless every voxel center is a lattice point (noise 0 everywhere) or a
+        // tile is a single lattice point (one of the 16 gradients, the next seed picks the same one now & then)
+        bool on_lattice = settings.period % (2 * settings.resolution) == 0;
+        bool one_gradient = settings.period == 1 && (settings.octaves == 1 || settings.lacunarity == 1);
+        if (!on_lattice && !one_gradient)
+        {
+            NoiseVolumeSettings other_seed = settings;
+            other_seed.seed += 1;
+            NoiseVolume reseeded = {};
+            thread_check.add(bake_noise_volume(other_seed, reseeded, pool) && !same_voxels(reseeded, wide));
+        }
+    }
+
+    NoiseVolume volume = {};
+    for (NoiseVolumeSettings settings : {NoiseVolumeSettings{.period = 12}, NoiseVolumeSettings{.lacunarity = 3}, NoiseVolumeSettings{.period = 0},
+                                         NoiseVolumeSettings{.resolution = 0}, NoiseVolumeSettings{.octaves = 0}})
+        invalid_check.add(!bake_noise_volume(settings, volume, pool));
+    invalid_check.add(bake_noise_volume(NoiseVolumeSettings{.resolution = 8}, volume, pool));
+
+    std::filesystem::remove_all(trial_dir, error);
+
+    std::cout << (NOISE_VOLUME_AVX2_ON ? "AVX2" : "no AVX2, scalar lanes") << std::endl;
+    return report_checks<BenchCheck>({&wide_check, &lattice_check, &range_check, &tiling_check, &bake_check, &sample_check, &cache_check,
+                                      &key_check, &reject_check, &thread_check, &invalid_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static double get_mvoxels(NoiseVolumeSettings const &settings, double ms)
+{
+    double voxel_count = static_cast<double>(settings.resolution) * settings.resolution * settings.resolution;
+    return voxel_count / (ms * 1e3);
+}
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    NoiseVolumeSettings const &noise = settings.noise;
+    out << "{\n";
+    out << "  \"benchmark\": \"noise_volume\",\n";
+    out << "  \"avx2\": " << NOISE_VOLUME_AVX2_ON << ",\n";
+    out << "  \"resolution\": " << noise.resolution << ",\n";
+    out << "  \"period\": " << noise.period << ",\n";
+    out << "  \"octaves\": " << noise.octaves << ",\n";
+    out << "  \"threads\": " << result.thread_count << ",\n";
+    out << "  \"scalar_ms\": " << result.scalar_ms << ",\n";
+    out << "  \"wide_ms\": " << result.wide_ms << ",\n";
+    out << "  \"wide_pool_ms\": " << result.wide_pool_ms << ",\n";
+    out << "  \"write_ms\": " << result.write_ms << ",\n";
+    out << "  \"load_ms\": " << result.load_ms << ",\n";
+    out << "  \"file_bytes\": " << result.file_bytes << ",\n";
+    out << "  \"loop_ns\": " << result.loop_ns << ",\n";
+    out << "  \"fetch_ns\": " << result.fetch_ns << ",\n";
+    out << "  \"fetch_rms\": " << result.fetch_rms << ",\n";
+    out << "  \"loop_rms\": " << result.loop_rms << ",\n";
+    out << "  \"same_bake\": " << (result.same_bake ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    NoiseVolumeSettings const &noise = settings.noise;
+    out << "volume: " << noise.resolution << "^3 voxels, period " << noise.period << ", " << noise.octaves << " octaves"
+        << (NOISE_VOLUME_AVX2_ON ? " (AVX2)" : " (no AVX2, scalar lanes)") << std::endl;
+    out << "bake scalar 1 thread:   " << result.scalar_ms << " ms, " << get_mvoxels(noise, result.scalar_ms) << " Mvoxels/s" << std::endl;
+    out << "bake x8 1 thread:       " << result.wide_ms << " ms, " << get_mvoxels(noise, result.wide_ms) << " Mvoxels/s" << std::endl;
+    out << "bake x8 " << result.thread_count << " threads:      " << result.wide_pool_ms << " ms, " << get_mvoxels(noise, result.wide_pool_ms)
+        << " Mvoxels/s" << std::endl;
+    out << "x8 bits equal scalar:   " << (result.same_bake ? "yes" : "NO") << std::endl;
+    out << "cache " << result.file_bytes << " bytes: write " << result.write_ms << " ms, load " << result.load_ms << " ms" << std::endl;
+    out << "per sample: octave loop " << result.loop_ns << " ns, one fetch " << result.fetch_ns << " ns, rms difference "
+        << result.fetch_rms << " (rms of the noise " << result.loop_rms << ")" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--resolution N] [--period N] [--octaves N] [--seed N] [--samples N] [--repeat N] [--threads N] [--cache dir] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--resolution"))
+            settings.noise.resolution = args.get_uint(1);
+        else if (args.is("--period"))
+            settings.noise.period = args.get_uint(1);
+        else if (args.is("--octaves"))
+            settings.noise.octaves = args.get_uint(1);
+        else if (args.is("--seed"))
+            settings.noise.seed = args.get_uint();
+        else if (args.is("--samples"))
+            settings.sample_count = args.get_uint(1);
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--cache"))
+            settings.cache_dir = args.get_string();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.thread_count, settings.cache_dir) ? 0 : 1;
+
+    if (!is_valid_noise_volume_settings(settings.noise))
+    {
+        std::cerr << "The period must be a power of two" << std::endl;
+        return 1;
+    }
+
+    BenchResult result = measure(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return result.same_bake ? 0 : 1;
+}
@@ -0,0 +1,490 @@
+// Packed reservoir benchmark & checks.
+// Packs & unpacks random RESERVOIR, PATH_RESERVOIR & DIRECT_ILLUMINATION_INFO (packed_reservoir.hpp, the host port of
+// packing.glsl), times both ways per struct and reports the largest round trip errors, the bytes per pixel of the per
+// pixel buffers with & without PACKED_RESERVOIRS_ON and the traffic of a frame at the given resolution & frame rate,
+// counting --accesses reads or writes of every buffer per frame.
+// --verify N checks on N random batches: the RGB9E5, octahedral, half & 16-bit unorm/snorm bounds, clamps & NaNs,
+// exhaustive round trips of the 16-bit codes, stable bits when a decoded value is packed again (reservoirs copied
+// between frames don't drift), exact fields of the structs, zeroed storage decoding to empty reservoirs & the packed
+// sizes. The exit code is not 0 when one fails.
+//
+// usage: packed_reservoir_bench [--verify N] [--width N] [--height N] [--fps N] [--accesses N] [--count N]
+//                               [--repeat N] [--seed N] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "packed_reservoir.hpp"
+#include "sampler.hpp"
+
+#include <cstring>
+
+//////////////////////////////// SAMPLES //////////////////////////////////////
+
+// Random reservoirs, path reservoirs & DI infos, their fields over the whole range
+struct SampleSource : BenchRandom
+{
+    // Log uniform over [2^min_exponent, 2^max_exponent)
+    auto next_log(float min_exponent, float max_exponent) -> float
+    {
+        return std::exp2(min_exponent + (max_exponent - min_exponent) * next_float());
+    }
+    auto next_radiance() -> glm::vec3
+    {
+        // Mostly similar channels, one in 8 saturated
+        float scale = next_log(-12.0f, 12.0f);
+        glm::vec3 tint = glm::vec3(next_float(), next_float(), next_float());
+        if (next_below(8) == 0)
+            tint[next_below(3)] = 0.0f;
+        return tint * scale;
+    }
+    auto next_direction() -> glm::vec3
+    {
+        float z = next_float() * 2.0f - 1.0f;
+        float phi = next_float() * DAXA_2PI;
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+    auto next_position() -> daxa_f32vec3
+    {
+        return daxa_f32vec3{(next_float() - 0.5f) * 512.0f, (next_float() - 0.5f) * 512.0f, (next_float() - 0.5f) * 512.0f};
+    }
+
+    auto next_reservoir() -> RESERVOIR
+    {
+        return RESERVOIR{
+            .Y = next_below(MAX_CUBE_LIGHTS),
+            .l_type = next_below(GEOMETRY_LIGHT_MAX_ENUM),
+            .seed = next_bits(),
+            .W_y = next_log(-20.0f, 20.0f),
+            .W_sum = next_log(-20.0f, 20.0f),
+            .M = next_below(2) == 0 ? static_cast<float>(next_below(64)) : next_float() * 40.0f,
+            .F = to_daxa(next_radiance()),
+        };
+    }
+
+    auto next_path_reservoir() -> PATH_RESERVOIR
+    {
+        PATH_RESERVOIR reservoir = {};
+        reservoir.M = next_below(2) == 0 ? static_cast<float>(next_below(64)) : next_float() * 40.0f;
+        reservoir.weight = next_log(-20.0f, 20.0f);
+        reservoir.path_flags = next_bits();
+        reservoir.rc_random_seed = next_bits();
+        reservoir.F = to_daxa(next_radiance());
+        reservoir.light_pdf = next_log(-10.0f, 30.0f);
+        reservoir.cached_jacobian = daxa_f32vec3{next_log(-10.0f, 30.0f), next_log(-10.0f, 30.0f), next_log(-10.0f, 30.0f)};
+        reservoir.init_random_seed = next_bits();
+        reservoir.rc_vertex_hit = OBJECT_HIT{OBJECT_INFO{next_below(MAX_INSTANCES), next_below(MAX_PRIMITIVES)}, next_position()};
+        reservoir.rc_vertex_wi[0] = to_daxa(next_direction());
+        reservoir.rc_vertex_irradiance[0] = to_daxa(next_radiance());
+        return reservoir;
+    }
+
+    auto next_di_info() -> DIRECT_ILLUMINATION_INFO
+    {
+        return DIRECT_ILLUMINATION_INFO{
+            .position = next_position(),
+            .distance = next_log(-8.0f, 10.0f),
+            .normal = to_daxa(next_direction()),
+            .ray_origin = next_position(),
+            .seed = next_bits(),
+            .instance_hit = OBJECT_INFO{next_below(MAX_INSTANCES), next_below(MAX_PRIMITIVES)},
+            .mat_index = next_below(MAX_MATERIALS),
+            .confidence = next_float(),
+        };
+    }
+};
+
+//////////////////////////////// ERRORS //////////////////////////////////////
+
+// Difference of every channel over the largest channel (the shared step of RGB9E5), below 2^-15 the step stops
+// shrinking so the difference is taken relative to 2^-15
+static float get_radiance_error(glm::vec3 a, glm::vec3 b)
+{
+    float max_c = std::max(a.x, std::max(a.y, a.z));
+    glm::vec3 d = glm::abs(a - b);
+    return std::max(d.x, std::max(d.y, d.z)) / std::max(max_c, 1.0f / 32768.0f);
+}
+
+static float get_angle(glm::vec3 a, glm::vec3 b)
+{
+    // atan2 of the cross & dot products, exact for tiny angles
+    return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+}
+
+static float get_relative_error(float a, float b)
+{
+    return std::abs(a - b) / std::max(std::abs(a), std::numeric_limits<float>::min());
+}
+
+// Largest round trip errors of a batch
+struct RoundTripErrors
+{
+    float radiance = 0.0f;   // relative to the largest channel
+    float direction = 0.0f;  // radians
+    float M = 0.0f;          // relative
+    float confidence = 0.0f; // absolute
+
+    void add(RoundTripErrors const &other)
+    {
+        radiance = std::max(radiance, other.radiance);
+        direction = std::max(direction, other.direction);
+        M = std::max(M, other.M);
+        confidence = std::max(confidence, other.confidence);
+    }
+};
+
+static RoundTripErrors get_errors(RESERVOIR const &a, RESERVOIR const &b)
+{
+    return {.radiance = get_radiance_error(to_glm(a.F), to_glm(b.F)), .M = a.M >= 1.0f ? get_relative_error(a.M, b.M) : 0.0f};
+}
+
+static RoundTripErrors get_errors(PATH_RESERVOIR const &a, PATH_RESERVOIR const &b)
+{
+    return {.radiance = std::max(get_radiance_error(to_glm(a.F), to_glm(b.F)),
+                                 get_radiance_error(to_glm(a.rc_vertex_irradiance[0]), to_glm(b.rc_vertex_irradiance[0]))),
+            .direction = get_angle(to_glm(a.rc_vertex_wi[0]), to_glm(b.rc_vertex_wi[0])),
+            .M = a.M >= 1.0f ? get_relative_error(a.M, b.M) : 0.0f};
+}
+
+static RoundTripErrors get_errors(DIRECT_ILLUMINATION_INFO const &a, DIRECT_ILLUMINATION_INFO const &b)
+{
+    return {.direction = get_angle(to_glm(a.normal), to_glm(b.normal)), .confidence = std::abs(a.confidence - b.confidence)};
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    uint32_t fps = 60;
+    uint32_t accesses = 2; // reads & writes of every buffer per frame
+    uint32_t count = 1U << 20;
+    uint32_t repeat = 3;
+    uint32_t seed = 0;
+};
+
+struct StructResult
+{
+    size_t bytes = 0;
+    size_t packed_bytes = 0;
+    double pack_ns = 0.0; // per struct
+    double unpack_ns = 0.0;
+};
+
+struct BenchResult
+{
+    StructResult reservoir = {};
+    StructResult path_reservoir = {};
+    StructResult direct_illum = {};
+    RoundTripErrors errors = {};
+    size_t pixel_bytes = 0;
+    size_t packed_pixel_bytes = 0;
+    double frame_mib = 0.0;        // traffic of a frame
+    double packed_frame_mib = 0.0;
+    double gib_per_second = 0.0;   // at the frame rate
+    double packed_gib_per_second = 0.0;
+};
+
+template <typename Struct, typename Next, typename Pack, typename Unpack>
+static StructResult measure_struct(BenchSettings const &settings, Next &&next, Pack &&pack, Unpack &&unpack, RoundTripErrors &errors)
+{
+    using Packed = decltype(pack(std::declval<Struct>()));
+    std::vector<Struct> values(settings.count), unpacked(settings.count);
+    std::vector<Packed> packed(settings.count);
+    for (Struct &value : values)
+        value = next();
+
+    StructResult result = {.bytes = sizeof(Struct), .packed_bytes = sizeof(Packed)};
+    double pack_ms = best_ms(settings.repeat, [&]()
+                             {
+        for (size_t i = 0; i < values.size(); ++i)
+            packed[i] = pack(values[i]); });
+    double unpack_ms = best_ms(settings.repeat, [&]()
+                               {
+        for (size_t i = 0; i < values.size(); ++i)
+            unpacked[i] = unpack(packed[i]); });
+    result.pack_ns = pack_ms * 1e6 / static_cast<double>(values.size());
+    result.unpack_ns = unpack_ms * 1e6 / static_cast<double>(values.size());
+
+    for (size_t i = 0; i < values.size(); ++i)
+        errors.add(get_errors(values[i], unpacked[i]));
+    return result;
+}
+
+static BenchResult measure(BenchSettings const &settings)
+{
+    BenchResult result = {};
+    SampleSource source = {{.state = settings.seed * 0x9e3779b9U}};
+
+    result.reservoir = measure_struct<RESERVOIR>(
+        settings, [&]()
+        { return source.next_reservoir(); },
+        host_pack_reservoir, host_unpack_reservoir, result.errors);
+    result.path_reservoir = measure_struct<PATH_RESERVOIR>(
+        settings, [&]()
+        { return source.next_path_reservoir(); },
+        host_pack_path_reservoir, host_unpack_path_reservoir, result.errors);
+    result.direct_illum = measure_struct<DIRECT_ILLUMINATION_INFO>(
+        settings, [&]()
+        { return source.next_di_info(); },
+        host_pack_di_info, host_unpack_di_info, result.errors);
+
+    result.pixel_bytes = get_reservoir_pixel_bytes(false).get_total();
+    result.packed_pixel_bytes = get_reservoir_pixel_bytes(true).get_total();
+    double pixel_count = static_cast<double>(settings.width) * settings.height;
+    double mib = 1.0 / (1024.0 * 1024.0);
+    result.frame_mib = static_cast<double>(result.pixel_bytes) * pixel_count * settings.accesses * mib;
+    result.packed_frame_mib = static_cast<double>(result.packed_pixel_bytes) * pixel_count * settings.accesses * mib;
+    result.gib_per_second = result.frame_mib * settings.fps / 1024.0;
+    result.packed_gib_per_second = result.packed_frame_mib * settings.fps / 1024.0;
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static bool same_bits(float a, float b) { return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b); }
+
+static bool same_bits(daxa_f32vec3 a, daxa_f32vec3 b) { return same_bits(a.x, b.x) && same_bits(a.y, b.y) && same_bits(a.z, b.z); }
+
+static bool verify(uint32_t trial_count, uint32_t seed)
+{
+    BenchCheck rgb9e5_check = {.name = "RGB9E5 within half a step, 1/511 of the largest channel"};
+    BenchCheck clamp_check = {.name = "negative, NaN & too large values clamped"};
+    BenchCheck octahedral_check = {.name = "octahedral directions within 1e-4 radians"};
+    BenchCheck half_check = {.name = "halves round to the nearest, ties to even"};
+    BenchCheck code_check = {.name = "every 16-bit code round trips"};
+    BenchCheck stable_check = {.name = "packing a decoded value gives the same bits"};
+    BenchCheck field_check = {.name = "unpacked fields exact or within their bounds"};
+    BenchCheck zero_check = {.name = "zeroed storage decodes to empty reservoirs"};
+    BenchCheck size_check = {.name = "packed sizes"};
+
+    SampleSource source = {{.state = seed * 0x9e3779b9U}};
+
+    // Exhaustive: every half but NaNs, every snorm & unorm code
+    for (uint32_t bits = 0; bits < 0x10000; ++bits)
+    {
+        uint32_t exponent = (bits >> 10) & 0x1F;
+        if (exponent != 31 && (bits & 0x8000) == 0)
+            code_check.add(host_pack_half(host_unpack_half(bits)) == bits);
+        if (exponent == 31 && (bits & 0x3FF) != 0)
+            code_check.add(std::isnan(host_unpack_half(bits)));
+        code_check.add(host_pack_unorm16(host_unpack_unorm16(bits)) == bits);
+        if (bits < 0xFFFF)
+            code_check.add(host_pack_snorm16(host_unpack_snorm16(bits)) == bits);
+    }
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        for (uint32_t i = 0; i < 1024; ++i)
+        {
+            // RGB9E5: each channel within half a step, step = 2^(exponent - 24) with the largest channel in
+            // [256, 512) steps (or the smallest step 2^-24)
+            glm::vec3 color = source.next_radiance();
+            uint32_t bits = host_pack_rgb9e5(color);
+            glm::vec3 decoded = host_unpack_rgb9e5(bits);
+            float step = host_packing_get_power_of_two(static_cast<int32_t>(bits >> 27) - 24);
+            uint32_t max_mantissa = std::max(bits & 0x1FF, std::max((bits >> 9) & 0x1FF, (bits >> 18) & 0x1FF));
+            bool within = (max_mantissa >= 256 || (bits >> 27) == 0) && (max_mantissa < 512);
+            for (int c = 0; c < 3; ++c)
+                within = within && std::abs(decoded[c] - color[c]) <= 0.5f * step;
+            rgb9e5_check.add(within && get_radiance_error(color, decoded) <= 1.0f / 511.0f);
+            stable_check.add(host_pack_rgb9e5(decoded) == bits);
+
+            // Octahedral
+            glm::vec3 direction = source.next_direction();
+            uint32_t oct = host_pack_octahedral(direction);
+            glm::vec3 unpacked = host_unpack_octahedral(oct);
+            octahedral_check.add(get_angle(direction, unpacked) <= 1e-4f && std::abs(glm::length(unpacked) - 1.0f) <= 1e-6f);
+            stable_check.add(host_pack_octahedral(unpacked) == oct);
+
+            // Halves: nearest of the two neighbouring codes, the even one on ties
+            float value = source.next_below(4) == 0 ? source.next_log(-30.0f, 16.0f) : source.next_float() * 2048.0f;
+            if (source.next_below(16) == 0)
+                value = static_cast<float>(source.next_below(2048)) + 0.5f * static_cast<float>(source.next_below(2)); // ties
+            uint32_t half = host_pack_half(value);
+            float rounded = host_unpack_half(half);
+            float below = host_unpack_half(half - (half > 0 ? 1 : 0));
+            float above = half < 0x7BFF ? host_unpack_half(half + 1) : rounded;
+            float error = std::abs(rounded - value);
+            bool nearest = error <= std::abs(below - value) && error <= std::abs(above - value);
+            bool even_tie = (error != std::abs(below - value) || half == 0 || (half & 1) == 0) && (error != std::abs(above - value) || rounded == above || (half & 1) == 0);
+            half_check.add(nearest && even_tie && (value < 6.2e-5f || get_relative_error(value, rounded) <= 1.0f / 2048.0f));
+            // Integer M up to 2048 is exact
+            float count = static_cast<float>(source.next_below(2049));
+            half_check.add(host_unpack_half(host_pack_half(count)) == count);
+        }
+
+        // Axes & poles, the fold of the lower hemisphere
+        for (glm::vec3 axis : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)})
+            octahedral_check.add(host_unpack_octahedral(host_pack_octahedral(axis)) == axis);
+        octahedral_check.add(host_unpack_octahedral(host_pack_octahedral(glm::vec3(0.0f))) == glm::vec3(0, 0, 1));
+
+        // Clamps & NaNs
+        float nan = std::numeric_limits<float>::quiet_NaN();
+        float inf = std::numeric_limits<float>::infinity();
+        clamp_check.add(host_unpack_rgb9e5(host_pack_rgb9e5(glm::vec3(-1.0f, nan, -inf))) == glm::vec3(0.0f));
+        clamp_check.add(host_unpack_rgb9e5(host_pack_rgb9e5(glm::vec3(inf, 1e9f, 0.0f))) == glm::vec3(HOST_RGB9E5_MAX, HOST_RGB9E5_MAX, 0.0f));
+        clamp_check.add(host_unpack_half(host_pack_half(1e9f)) == HLF_MAX && host_unpack_half(host_pack_half(inf)) == HLF_MAX);
+        clamp_check.add(std::isnan(host_unpack_half(host_pack_half(nan))));
+        clamp_check.add(host_unpack_unorm16(host_pack_unorm16(-0.5f)) == 0.0f && host_unpack_unorm16(host_pack_unorm16(1.5f)) == 1.0f);
+        clamp_check.add(host_unpack_snorm16(host_pack_snorm16(-2.0f)) == -1.0f && host_unpack_snorm16(host_pack_snorm16(2.0f)) == 1.0f);
+
+        // Structs: untouched fields keep their bits, packed ones their bounds, a second round trip changes nothing
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            RESERVOIR reservoir = source.next_reservoir();
+            RESERVOIR_PACKED packed_reservoir = host_pack_reservoir(reservoir);
+            RESERVOIR unpacked_reservoir = host_unpack_reservoir(packed_reservoir);
+            RoundTripErrors errors = get_errors(reservoir, unpacked_reservoir);
+            field_check.add(unpacked_reservoir.Y == reservoir.Y && unpacked_reservoir.l_type == reservoir.l_type &&
+                            unpacked_reservoir.seed == reservoir.seed && same_bits(unpacked_reservoir.W_y, reservoir.W_y) &&
+                            same_bits(unpacked_reservoir.W_sum, reservoir.W_sum) && errors.radiance <= 1.0f / 511.0f &&
+                            errors.M <= 1.0f / 2048.0f && std::abs(unpacked_reservoir.M - reservoir.M) <= 1.0f / 64.0f);
+            RESERVOIR_PACKED repacked_reservoir = host_pack_reservoir(unpacked_reservoir);
+            stable_check.add(std::memcmp(&repacked_reservoir, &packed_reservoir, sizeof(RESERVOIR_PACKED)) == 0);
+
+            PATH_RESERVOIR path = source.next_path_reservoir();
+            PATH_RESERVOIR_PACKED packed_path = host_pack_path_reservoir(path);
+            PATH_RESERVOIR unpacked_path = host_unpack_path_reservoir(packed_path);
+            errors = get_errors(path, unpacked_path);
+            field_check.add(same_bits(unpacked_path.weight, path.weight) && unpacked_path.path_flags == path.path_flags &&
+                            unpacked_path.rc_random_seed == path.rc_random_seed && same_bits(unpacked_path.light_pdf, path.light_pdf) &&
+                            same_bits(unpacked_path.cached_jacobian, path.cached_jacobian) && unpacked_path.init_random_seed == path.init_random_seed &&
+                            unpacked_path.rc_vertex_hit.object.instance_id == path.rc_vertex_hit.object.instance_id &&
+                            unpacked_path.rc_vertex_hit.object.primitive_id == path.rc_vertex_hit.object.primitive_id &&
+                            same_bits(unpacked_path.rc_vertex_hit.hit, path.rc_vertex_hit.hit) && errors.radiance <= 1.0f / 511.0f &&
+                            errors.direction <= 1e-4f && errors.M <= 1.0f / 2048.0f && std::abs(unpacked_path.M - path.M) <= 1.0f / 64.0f);
+            PATH_RESERVOIR_PACKED repacked_path = host_pack_path_reservoir(unpacked_path);
+            stable_check.add(std::memcmp(&repacked_path, &packed_path, sizeof(PATH_RESERVOIR_PACKED)) == 0);
+
+            DIRECT_ILLUMINATION_INFO di_info = source.next_di_info();
+            DIRECT_ILLUMINATION_INFO_PACKED packed_di_info = host_pack_di_info(di_info);
+            DIRECT_ILLUMINATION_INFO unpacked_di_info = host_unpack_di_info(packed_di_info);
+            errors = get_errors(di_info, unpacked_di_info);
+            field_check.add(same_bits(unpacked_di_info.position, di_info.position) && same_bits(unpacked_di_info.distance, di_info.distance) &&
+                            same_bits(unpacked_di_info.ray_origin, di_info.ray_origin) && unpacked_di_info.seed == di_info.seed &&
+                            unpacked_di_info.instance_hit.instance_id == di_info.instance_hit.instance_id &&
+                            unpacked_di_info.instance_hit.primitive_id == di_info.instance_hit.primitive_id &&
+                            unpacked_di_info.mat_index == di_info.mat_index && errors.direction <= 1e-4f &&
+                            errors.confidence <= 0.5f / HOST_UNORM16_SCALE + 1e-7f);
+            DIRECT_ILLUMINATION_INFO_PACKED repacked_di_info = host_pack_di_info(unpacked_di_info);
+            stable_check.add(std::memcmp(&repacked_di_info, &packed_di_info, sizeof(DIRECT_ILLUMINATION_INFO_PACKED)) == 0);
+        }
+    }
+
+    // load_reservoirs clears the buffers to 0
+    {
+        RESERVOIR reservoir = host_unpack_reservoir(RESERVOIR_PACKED{});
+        zero_check.add(reservoir.M == 0.0f && reservoir.W_y == 0.0f && reservoir.W_sum == 0.0f && same_bits(reservoir.F, daxa_f32vec3{}));
+        PATH_RESERVOIR path = host_unpack_path_reservoir(PATH_RESERVOIR_PACKED{});
+        zero_check.add(path.M == 0.0f && path.weight == 0.0f && same_bits(path.F, daxa_f32vec3{}) &&
+                       same_bits(path.rc_vertex_irradiance[0], daxa_f32vec3{}));
+        DIRECT_ILLUMINATION_INFO di_info = host_unpack_di_info(DIRECT_ILLUMINATION_INFO_PACKED{});
+        zero_check.add(di_info.distance == 0.0f && di_info.confidence == 0.0f && di_info.mat_index == 0);
+    }
+
+    size_check.add(sizeof(RESERVOIR_PACKED) == 24 && sizeof(PATH_RESERVOIR_PACKED) == 68 && sizeof(DIRECT_ILLUMINATION_INFO_PACKED) == 48);
+    size_check.add(get_reservoir_pixel_bytes(true).get_total() < get_reservoir_pixel_bytes(false).get_total());
+
+    return report_checks<BenchCheck>({&rgb9e5_check, &clamp_check, &octahedral_check, &half_check, &code_check, &stable_check, &field_check,
+                                      &zero_check, &size_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static void write_struct_json(std::ostream &out, char const *name, StructResult const &result)
+{
+    out << "  \"" << name << "\": {\"bytes\": " << result.bytes << ", \"packed_bytes\": " << result.packed_bytes
+        << ", \"pack_ns\": " << result.pack_ns << ", \"unpack_ns\": " << result.unpack_ns << "},\n";
+}
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"packed_reservoir\",\n";
+    out << "  \"width\": " << settings.width << ",\n";
+    out << "  \"height\": " << settings.height << ",\n";
+    out << "  \"fps\": " << settings.fps << ",\n";
+    out << "  \"accesses\": " << settings.accesses << ",\n";
+    write_struct_json(out, "reservoir", result.reservoir);
+    write_struct_json(out, "path_reservoir", result.path_reservoir);
+    write_struct_json(out, "direct_illum", result.direct_illum);
+    out << "  \"radiance_error\": " << result.errors.radiance << ",\n";
+    out << "  \"direction_error\": " << result.errors.direction << ",\n";
+    out << "  \"M_error\": " << result.errors.M << ",\n";
+    out << "  \"confidence_error\": " << result.errors.confidence << ",\n";
+    out << "  \"pixel_bytes\": " << result.pixel_bytes << ",\n";
+    out << "  \"packed_pixel_bytes\": " << result.packed_pixel_bytes << ",\n";
+    out << "  \"frame_mib\": " << result.frame_mib << ",\n";
+    out << "  \"packed_frame_mib\": " << result.packed_frame_mib << ",\n";
+    out << "  \"gib_per_second\": " << result.gib_per_second << ",\n";
+    out << "  \"packed_gib_per_second\": " << result.packed_gib_per_second << "\n";
+    out << "}\n";
+}
+
+static void write_struct_row(std::ostream &out, char const *name, StructResult const &result)
+{
+    out << name << result.bytes << " -> " << result.packed_bytes << " bytes, pack " << result.pack_ns << " ns, unpack "
+        << result.unpack_ns << " ns" << std::endl;
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "packed reservoirs" << (PACKED_RESERVOIRS_ON ? " (PACKED_RESERVOIRS_ON)" : " (PACKED_RESERVOIRS_ON off in shared.inl)") << std::endl;
+    write_struct_row(out, "RESERVOIR:                ", result.reservoir);
+    write_struct_row(out, "PATH_RESERVOIR:           ", result.path_reservoir);
+    write_struct_row(out, "DIRECT_ILLUMINATION_INFO: ", result.direct_illum);
+    out << "largest errors: radiance " << result.errors.radiance << " of the largest channel, direction " << result.errors.direction
+        << " rad, M " << result.errors.M << " relative, confidence " << result.errors.confidence << std::endl;
+    out << "bytes per pixel (3 reservoirs, 2 direct illumination, 2 path reservoirs): " << result.pixel_bytes << " -> "
+        << result.packed_pixel_bytes << std::endl;
+    out << settings.width << "x" << settings.height << ", " << settings.accesses << " accesses per buffer & frame: " << result.frame_mib
+        << " -> " << result.packed_frame_mib << " MiB per frame, " << result.gib_per_second << " -> " << result.packed_gib_per_second
+        << " GiB/s at " << settings.fps << " fps" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--width N] [--height N] [--fps N] [--accesses N] [--count N] [--repeat N] [--seed N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--fps"))
+            settings.fps = args.get_uint(1);
+        else if (args.is("--accesses"))
+            settings.accesses = args.get_uint(1);
+        else if (args.is("--count"))
+            settings.count = args.get_uint(1);
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--seed"))
+            settings.seed = args.get_uint();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.seed) ? 0 : 1;
+
+    BenchResult result = measure(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return 0;
+}
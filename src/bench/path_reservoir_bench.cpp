@@ -0,0 +1,584 @@
+// ReSTIR PT path reservoir benchmark & shift mapping checks.
+// Runs the host port of the path reservoirs & shifts (host_path_reservoir.hpp) on a voxel Cornell box: coloured
+// lambertian walls, a metal block, emissive ceiling voxels (cube lights), a point light & the sky through the open front.
+// The default mode renders the box with the CPU reference tracer (ReferenceTracer) and with ReSTIR PT (initial path
+// reservoirs, then the pairwise spatial reuse of indirect_illumination.glsl) averaged over --iterations frames, and
+// reports the relMSE & mean luminance of both against the reference. Failing --gate (relMSE) or --bias-gate (relative
+// mean luminance difference) makes the exit code not 0, the spatial reuse has to converge to the path traced image.
+// --verify runs N trials of the shift mappings between neighbouring pixels: a path shifted to its own pixel is itself
+// with a jacobian of 1, the analytic jacobian of a reconnection matches a finite difference of the solid angles, shifts
+// back & forth give the path back with J J' = 1, cached & uncached jacobians agree and the hybrid shift of an rc vertex
+// at the first bounce is the reconnection shift. The exit code is not 0 when one fails.
+//
+// usage: path_reservoir_bench [--verify N] [--width N] [--height N] [--iterations N] [--reference-spp N] [--max-depth N]
+//                             [--shift reconnection|hybrid] [--neighbors N] [--radius N] [--gate X] [--bias-gate X]
+//                             [--threads N] [--seed N] [--json out.json]
+
+#include "defines.h"
+#include "host_scene.hpp"
+#include "host_accel.hpp"
+#include "host_path_reservoir.hpp"
+#include "image_metrics.hpp"
+#include "reference_tracer.hpp"
+#include "bench_common.hpp"
+#include "bench_scene.hpp"
+
+#include <string>
+
+//////////////////////////////// SCENE //////////////////////////////////////
+
+static constexpr uint32_t BOX_VOXELS = 16;
+static constexpr float BOX_SCALE = 8.0f;
+
+enum BOX_MATERIAL : uint32_t
+{
+    BOX_WHITE,
+    BOX_RED,
+    BOX_GREEN,
+    BOX_LIGHT,
+    BOX_METAL,
+    BOX_MATERIAL_COUNT,
+};
+
+// Walls, floor & ceiling one voxel thick, the front (+z) open, a white block & a metal block inside.
+// The instance scales the voxels so the rc vertex reload goes through a non identity transform.
+static void build_cornell_box(HostScene &scene)
+{
+    GvoxRegionChunk chunk = {};
+    chunk.materials.resize(BOX_MATERIAL_COUNT);
+    chunk.materials[BOX_WHITE] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.73f));
+    chunk.materials[BOX_RED] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.65f, 0.05f, 0.05f));
+    chunk.materials[BOX_GREEN] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.12f, 0.45f, 0.15f));
+    chunk.materials[BOX_LIGHT] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.78f), glm::vec3(12.0f, 10.0f, 8.0f));
+    chunk.materials[BOX_METAL] = make_material(MATERIAL_TYPE_METAL, glm::vec3(0.9f), glm::vec3(0.0f), 0.2f);
+
+    auto in_range = [](uint32_t v, uint32_t first, uint32_t last)
+    { return v >= first && v <= last; };
+
+    constexpr uint32_t L = BOX_VOXELS - 1;
+    for (uint32_t z = 0; z < BOX_VOXELS; ++z)
+        for (uint32_t y = 0; y < BOX_VOXELS; ++y)
+            for (uint32_t x = 0; x < BOX_VOXELS; ++x)
+            {
+                uint32_t material = BOX_MATERIAL_COUNT;
+                if (x == 0)
+                    material = BOX_RED;
+                else if (x == L)
+                    material = BOX_GREEN;
+                else if (y == L && in_range(x, 6, 9) && in_range(z, 6, 9))
+                    material = BOX_LIGHT;
+                else if (y == 0 || y == L || z == 0)
+                    material = BOX_WHITE;
+                else if (in_range(x, 3, 6) && in_range(y, 1, 9) && in_range(z, 3, 6))
+                    material = BOX_WHITE;
+                else if (in_range(x, 9, 12) && in_range(y, 1, 4) && in_range(z, 8, 11))
+                    material = BOX_METAL;
+                if (material != BOX_MATERIAL_COUNT)
+                    add_voxel(chunk, x, y, z, material);
+            }
+    add_centered_chunk(scene, chunk, BOX_VOXELS, BOX_SCALE, true);
+
+    // A warm point light under the ceiling, the sky lights the box through the front
+    LIGHT point = {};
+    point.position = {-1.0f, 1.2f, 0.5f};
+    point.emissive = {1.5f, 1.2f, 0.9f};
+    point.type = GEOMETRY_LIGHT_POINT;
+    point.instance_info = OBJECT_INFO(MAX_INSTANCES, MAX_PRIMITIVES);
+    scene.point_lights.push_back(point);
+
+    add_sky(scene, 10.0f);
+}
+
+// Camera in front of the open face looking in, with the projection of the renderer
+static HostCamera frame_box(HostScene const &scene, uint32_t width, uint32_t height)
+{
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = (scene.bounds_max.y - scene.bounds_min.y) * 0.5f;
+    float distance = get_framing_distance(width, height, radius);
+    return get_host_camera(width, height, center + glm::normalize(glm::vec3(0.0f, 0.05f, 1.0f)) * (distance + radius), center);
+}
+
+struct BoxRenderer
+{
+    HostScene scene = {};
+    HostAccel accel = {};
+    ReferenceSettings settings = {};
+    HostCamera camera = {};
+    HostSceneParams params = {};
+
+    BoxRenderer(uint32_t width, uint32_t height, uint32_t max_depth, TilePool &pool)
+    {
+        build_cornell_box(scene);
+        accel.build(scene, pool);
+        settings.width = width;
+        settings.height = height;
+        settings.max_depth = max_depth;
+        camera = frame_box(scene, width, height);
+        params.max_depth = max_depth;
+        params.light_count = static_cast<uint32_t>(scene.cube_lights.size() + scene.point_lights.size());
+        params.object_count = static_cast<uint32_t>(scene.instances.size());
+    }
+
+    auto get_pixel_count() const -> uint32_t { return settings.width * settings.height; }
+
+    // Initial path reservoir of a pixel, seeds only depend on the pixel & the frame
+    HostPathSample trace(ReferenceTracer const &tracer, uint32_t pixel, uint32_t frame, uint64_t &ray_count) const
+    {
+        uint32_t seed = host_tea(pixel, 0x10000 + frame);
+        HostRay ray = tracer.get_ray_from_current_pixel(pixel % settings.width, pixel / settings.width, camera, seed);
+        return host_trace_path_reservoir(tracer, accel, params, ray, seed, ray_count);
+    }
+
+    glm::vec3 get_camera_position() const
+    {
+        return glm::vec3(camera.inv_view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    }
+
+    // Spatial reuse of one pixel over the initial reservoirs of the frame, returns the pixel estimate
+    glm::vec3 spatial_reuse(std::vector<HostPathSample> const &samples, uint32_t pixel, uint32_t frame) const
+    {
+        HostPathSample const &central = samples[pixel];
+        if (!central.primary.is_hit)
+            return central.direct;
+
+        int32_t x = static_cast<int32_t>(pixel % settings.width);
+        int32_t y = static_cast<int32_t>(pixel / settings.width);
+        uint32_t neighbor_seed = host_tea(pixel, 0x20000 + frame);
+        uint32_t seed = host_tea(pixel, 0x30000 + frame);
+        glm::vec3 camera_position = get_camera_position();
+
+        RECONNECTION_DATA rc_data = {};
+        host_reconnection_data_initialise(rc_data);
+
+        PATH_RESERVOIR reservoir = host_path_spatial_reuse(
+            accel, params, central.primary, central.reservoir,
+            [&](uint32_t, INTERSECT &neighbor_intersection, PATH_RESERVOIR &neighbor_reservoir) -> bool
+            {
+                int32_t neighbor_x = 0, neighbor_y = 0;
+                host_get_next_neighbor_pixel(x, y, params.neighbor_radius, neighbor_seed, neighbor_x, neighbor_y);
+                if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= static_cast<int32_t>(settings.width) ||
+                    neighbor_y >= static_cast<int32_t>(settings.height))
+                    return false;
+
+                HostPathSample const &neighbor = samples[static_cast<uint32_t>(neighbor_y) * settings.width + static_cast<uint32_t>(neighbor_x)];
+                if (!neighbor.primary.is_hit || !host_is_valid_geometry(central.primary, neighbor.primary, camera_position))
+                    return false;
+
+                neighbor_intersection = neighbor.primary;
+                neighbor_reservoir = neighbor.reservoir;
+                return true;
+            },
+            [&](uint32_t)
+            { return rc_data; },
+            seed);
+
+        return central.direct + to_glm(reservoir.F) * reservoir.weight;
+    }
+};
+
+static glm::vec3 get_estimate(HostPathSample const &sample)
+{
+    return sample.direct + to_glm(sample.reservoir.F) * sample.reservoir.weight;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static double get_relative_error(glm::vec3 a, glm::vec3 b)
+{
+    double scale = std::max(host_path_F_to_scalar(glm::abs(a)), host_path_F_to_scalar(glm::abs(b)));
+    glm::vec3 difference = glm::abs(a - b);
+    return scale > 0.0 ? std::max({difference.x, difference.y, difference.z}) / scale : 0.0;
+}
+
+// Solid angle of the parallelogram (a, b, c, a + c - b) seen from P, two triangles of Van Oosterom & Strackee
+static double get_solid_angle(glm::dvec3 P, glm::dvec3 a, glm::dvec3 b, glm::dvec3 c)
+{
+    auto triangle = [&](glm::dvec3 r1, glm::dvec3 r2, glm::dvec3 r3)
+    {
+        r1 -= P;
+        r2 -= P;
+        r3 -= P;
+        double l1 = glm::length(r1), l2 = glm::length(r2), l3 = glm::length(r3);
+        double numerator = glm::dot(r1, glm::cross(r2, r3));
+        double denominator = l1 * l2 * l3 + glm::dot(r1, r2) * l3 + glm::dot(r1, r3) * l2 + glm::dot(r2, r3) * l1;
+        return std::abs(2.0 * std::atan2(numerator, denominator));
+    };
+    return triangle(a, b, c) + triangle(a, c, a + c - b);
+}
+
+static uint32_t verify(uint32_t trial_count, uint32_t seed, uint32_t max_depth, uint32_t thread_count)
+{
+    TilePool pool(thread_count);
+    BoxRenderer renderer(64, 48, max_depth, pool);
+    ReferenceTracer tracer(renderer.accel, renderer.settings);
+    HostAccel const &accel = renderer.accel;
+    HostSceneParams params = renderer.params;
+    glm::vec3 camera_position = renderer.get_camera_position();
+
+    BenchErrorCheck self = {.name = "shift to itself: F & J = 1"};
+    BenchErrorCheck finite_difference = {.name = "reconnection jacobian vs finite difference"};
+    BenchErrorCheck round_trip = {.name = "round trip: F & J J' = 1"};
+    BenchErrorCheck cached = {.name = "cached vs uncached jacobian"};
+    BenchErrorCheck hybrid = {.name = "hybrid (rc vertex 1) vs reconnection"};
+
+    RECONNECTION_DATA rc_data = {};
+    host_reconnection_data_initialise(rc_data);
+
+    uint64_t ray_count = 0;
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        uint32_t trial_seed = host_tea(seed, trial);
+        uint32_t pixel = host_tea(trial_seed, 1) % renderer.get_pixel_count();
+        HostPathSample src = renderer.trace(tracer, pixel, trial, ray_count);
+        if (!src.primary.is_hit || src.reservoir.weight <= 0.0f)
+            continue;
+
+        // Neighbour in a 16 pixel window with similar geometry
+        int32_t neighbor_x = 0, neighbor_y = 0;
+        host_get_next_neighbor_pixel(static_cast<int32_t>(pixel % renderer.settings.width), static_cast<int32_t>(pixel / renderer.settings.width),
+                                     8, trial_seed, neighbor_x, neighbor_y);
+        if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= static_cast<int32_t>(renderer.settings.width) ||
+            neighbor_y >= static_cast<int32_t>(renderer.settings.height))
+            continue;
+        HostPathSample dst = renderer.trace(tracer, static_cast<uint32_t>(neighbor_y) * renderer.settings.width + static_cast<uint32_t>(neighbor_x),
+                                            trial, ray_count);
+        if (!dst.primary.is_hit || !host_is_valid_geometry(src.primary, dst.primary, camera_position))
+            continue;
+
+        PATH_RESERVOIR src_reservoir = src.reservoir;
+        glm::vec3 src_F = to_glm(src_reservoir.F);
+
+        // Self shift
+        {
+            PATH_RESERVOIR reservoir = src_reservoir;
+            float jacobian = 0.0f;
+            glm::vec3 F = host_compute_shifted_integrand_reconnection(accel, params, jacobian, src.primary, src.primary, reservoir, true,
+                                                                      false, false);
+            bool is_delta = host_path_reservoir_is_delta_event(src_reservoir.path_flags, true) ||
+                            host_path_reservoir_is_delta_event(src_reservoir.path_flags, false);
+            if (!is_delta)
+                self.add(std::max(get_relative_error(F, src_F), static_cast<double>(std::abs(jacobian - 1.0f))), 1e-3);
+        }
+
+        // Shift to the neighbour & back
+        float jacobian = 0.0f;
+        PATH_RESERVOIR reservoir = src_reservoir;
+        glm::vec3 dst_F = host_compute_shifted_integrand_reconnection(accel, params, jacobian, dst.primary, src.primary, reservoir, true, false,
+                                                                      false);
+        if (jacobian > 0.0f && host_path_F_to_scalar(dst_F) > 0.0f)
+        {
+            PATH_RESERVOIR shifted = src_reservoir;
+            shifted.F = to_daxa(dst_F);
+            float inverse_jacobian = 0.0f;
+            glm::vec3 back_F = host_compute_shifted_integrand_reconnection(accel, params, inverse_jacobian, src.primary, dst.primary, shifted, true,
+                                                                           false, false);
+            round_trip.add(std::max(get_relative_error(back_F, src_F), static_cast<double>(std::abs(jacobian * inverse_jacobian - 1.0f))), 1e-2);
+
+            // Cached jacobians of the source path (initial pdfs & geometry term)
+            PATH_RESERVOIR cached_reservoir = src_reservoir;
+            float cached_jacobian = 0.0f;
+            glm::vec3 cached_F = host_compute_shifted_integrand_reconnection(accel, params, cached_jacobian, dst.primary, src.primary,
+                                                                             cached_reservoir, true, false, true);
+            cached.add(std::max(get_relative_error(cached_F, dst_F), static_cast<double>(std::abs(cached_jacobian / jacobian - 1.0f))), 1e-2);
+        }
+
+        // Hybrid shift with the rc vertex at the first bounce
+        {
+            HostSceneParams hybrid_params = params;
+            hybrid_params.shift_mapping = HOST_SHIFT_MAPPING_HYBRID;
+            OBJECT_HIT dst_hit = {.object = dst.primary.instance_hit, .hit = dst.primary.world_hit};
+            float hybrid_jacobian = 0.0f;
+            glm::vec3 hybrid_F = host_compute_shifted_integrand(accel, hybrid_params, hybrid_jacobian, dst_hit, dst.primary, src.primary,
+                                                                src_reservoir, rc_data, true);
+            hybrid.add(std::max(get_relative_error(hybrid_F, dst_F), static_cast<double>(std::abs(hybrid_jacobian - jacobian))), 1e-6);
+        }
+
+        // Geometric term of the reconnection alone: an escaped vertex with a fixed irradiance & no light pdf, both primary
+        // hits lambertian so the pdf ratio is known
+        if (host_instance_hit_exists(src_reservoir.rc_vertex_hit.object) &&
+            (src.primary.mat.type & MATERIAL_TYPE_MASK) == MATERIAL_TYPE_LAMBERTIAN &&
+            (dst.primary.mat.type & MATERIAL_TYPE_MASK) == MATERIAL_TYPE_LAMBERTIAN)
+        {
+            PATH_RESERVOIR escaped = src_reservoir;
+            escaped.path_flags = 0;
+            host_path_reservoir_insert_rc_vertex_length(escaped, 1);
+            host_path_reservoir_insert_light_type(escaped, GEOMETRY_LIGHT_CUBE);
+            escaped.light_pdf = 0.0f;
+            escaped.rc_vertex_irradiance[0] = {1.0f, 1.0f, 1.0f};
+
+            float escaped_jacobian = 0.0f;
+            host_compute_shifted_integrand_reconnection(accel, params, escaped_jacobian, dst.primary, src.primary, escaped, false, false, false);
+
+            INTERSECT rc = host_load_intersection_data_vertex_position(accel, src_reservoir.rc_vertex_hit, to_glm(dst.primary.world_hit));
+            if (escaped_jacobian > 0.0f && rc.is_hit)
+            {
+                glm::dvec3 rc_position = glm::dvec3(to_glm(rc.world_hit));
+                glm::dvec3 rc_normal = glm::dvec3(to_glm(rc.world_nrm));
+                glm::dvec3 tangent = glm::normalize(glm::cross(rc_normal, std::abs(rc_normal.x) > 0.5 ? glm::dvec3(0, 1, 0) : glm::dvec3(1, 0, 0)));
+                glm::dvec3 bitangent = glm::cross(rc_normal, tangent);
+                double h = 1e-3 * VOXEL_EXTENT * BOX_SCALE;
+                glm::dvec3 a = rc_position - (tangent + bitangent) * h, b = a + tangent * 2.0 * h, c = b + bitangent * 2.0 * h;
+
+                glm::vec3 src_position = host_compute_new_ray_origin(to_glm(src.primary.world_hit), to_glm(src.primary.world_nrm), true);
+                glm::vec3 dst_position = host_compute_new_ray_origin(to_glm(dst.primary.world_hit), to_glm(dst.primary.world_nrm), true);
+                double solid_angle_ratio = get_solid_angle(glm::dvec3(dst_position), a, b, c) / get_solid_angle(glm::dvec3(src_position), a, b, c);
+
+                glm::vec3 src_direction = glm::normalize(to_glm(rc.world_hit) - src_position);
+                glm::vec3 dst_direction = glm::normalize(to_glm(rc.world_hit) - dst_position);
+                double pdf_ratio = host_sample_material_pdf(dst.primary.mat, to_glm(dst.primary.world_nrm), to_glm(dst.primary.wo), dst_direction) /
+                                   host_sample_material_pdf(src.primary.mat, to_glm(src.primary.world_nrm), to_glm(src.primary.wo), src_direction);
+
+                finite_difference.add(std::abs(escaped_jacobian / pdf_ratio / solid_angle_ratio - 1.0), 1e-2);
+            }
+        }
+    }
+
+    // Edges & corners of voxels may still turn a handful of shifts into other faces
+    uint32_t failure_count = 0;
+    failure_count += self.report(1e-3) ? 0 : 1;
+    failure_count += finite_difference.report(1e-3) ? 0 : 1;
+    failure_count += round_trip.report(1e-2) ? 0 : 1;
+    failure_count += cached.report(1e-2) ? 0 : 1;
+    failure_count += hybrid.report() ? 0 : 1;
+
+    std::cout << "verify: " << trial_count << " trials, " << failure_count << " properties failed" << std::endl;
+    return failure_count;
+}
+
+//////////////////////////////// COMPARE //////////////////////////////////////
+
+struct CompareSettings
+{
+    uint32_t width = 64;
+    uint32_t height = 48;
+    uint32_t iteration_count = 64;
+    uint32_t reference_spp = 1024;
+    uint32_t max_depth = MAX_DEPTH;
+    uint32_t shift_mapping = HOST_SHIFT_MAPPING_RECONNECTION;
+    uint32_t neighbor_count = 3;
+    // NOTE: NEIGHBOR_RADIUS 1 of the shaders truncates every offset to 0, the neighbour is always the pixel itself
+    int32_t neighbor_radius = 8;
+    double gate = 0.05;
+    double bias_gate = 0.02;
+    uint32_t thread_count = 0;
+    uint32_t seed = 1;
+};
+
+struct CompareResult
+{
+    double reference_ms = 0.0;
+    double initial_ms = 0.0; // every frame
+    double reuse_ms = 0.0;
+    uint64_t initial_ray_count = 0;
+    ImageMetrics initial = {};
+    ImageMetrics spatial = {};
+    double reference_luminance = 0.0;
+    double initial_luminance = 0.0;
+    double spatial_luminance = 0.0;
+};
+
+static double get_mean_luminance(std::vector<glm::vec3> const &image)
+{
+    double sum = 0.0;
+    for (auto const &pixel : image)
+        sum += host_path_F_to_scalar(pixel);
+    return image.empty() ? 0.0 : sum / static_cast<double>(image.size());
+}
+
+static CompareResult compare(CompareSettings const &settings)
+{
+    TilePool pool(settings.thread_count);
+    BoxRenderer renderer(settings.width, settings.height, settings.max_depth, pool);
+    renderer.params.shift_mapping = settings.shift_mapping;
+    renderer.params.neighbor_count = settings.neighbor_count;
+    renderer.params.neighbor_radius = settings.neighbor_radius;
+
+    CompareResult result = {};
+
+    // Converged path traced reference
+    ReferenceSettings reference_settings = renderer.settings;
+    reference_settings.samples_per_pixel = settings.reference_spp;
+    ReferenceTracer reference_tracer(renderer.accel, reference_settings);
+    std::vector<glm::vec3> reference = {};
+    result.reference_ms = reference_tracer.render(renderer.camera, pool, reference).render_ms;
+
+    ReferenceTracer tracer(renderer.accel, renderer.settings);
+    uint32_t pixel_count = renderer.get_pixel_count();
+    std::vector<HostPathSample> samples(pixel_count);
+    std::vector<glm::vec3> initial(pixel_count, glm::vec3(0.0f)), spatial(pixel_count, glm::vec3(0.0f));
+    std::atomic<uint64_t> ray_count = 0;
+
+    for (uint32_t frame = 0; frame < settings.iteration_count; ++frame)
+    {
+        uint32_t frame_seed = host_tea(settings.seed, frame);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        pool.run(settings.height, [&](uint32_t y, uint32_t)
+                 {
+            uint64_t row_rays = 0;
+            for (uint32_t x = 0; x < settings.width; ++x)
+            {
+                uint32_t pixel = y * settings.width + x;
+                samples[pixel] = renderer.trace(tracer, pixel, frame_seed, row_rays);
+                initial[pixel] += get_estimate(samples[pixel]);
+            }
+            ray_count += row_rays; });
+        result.initial_ms += elapsed_ms(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        pool.run(settings.height, [&](uint32_t y, uint32_t)
+                 {
+            for (uint32_t x = 0; x < settings.width; ++x)
+            {
+                uint32_t pixel = y * settings.width + x;
+                spatial[pixel] += renderer.spatial_reuse(samples, pixel, frame_seed);
+            } });
+        result.reuse_ms += elapsed_ms(start);
+    }
+    result.initial_ray_count = ray_count;
+
+    float inv_iteration_count = 1.0f / static_cast<float>(settings.iteration_count);
+    for (uint32_t pixel = 0; pixel < pixel_count; ++pixel)
+    {
+        initial[pixel] *= inv_iteration_count;
+        spatial[pixel] *= inv_iteration_count;
+    }
+
+    result.initial = compare_images(reference, initial, settings.width, settings.height, pool);
+    result.spatial = compare_images(reference, spatial, settings.width, settings.height, pool);
+    result.reference_luminance = get_mean_luminance(reference);
+    result.initial_luminance = get_mean_luminance(initial);
+    result.spatial_luminance = get_mean_luminance(spatial);
+    return result;
+}
+
+static double get_bias(double luminance, double reference_luminance)
+{
+    return reference_luminance > 0.0 ? std::abs(luminance / reference_luminance - 1.0) : 0.0;
+}
+
+static bool is_passing(CompareResult const &result, CompareSettings const &settings)
+{
+    return result.spatial.rel_mse <= settings.gate && result.initial.rel_mse <= settings.gate &&
+           get_bias(result.spatial_luminance, result.reference_luminance) <= settings.bias_gate &&
+           get_bias(result.initial_luminance, result.reference_luminance) <= settings.bias_gate;
+}
+
+static char const *shift_mapping_name(uint32_t shift_mapping)
+{
+    return shift_mapping == HOST_SHIFT_MAPPING_HYBRID ? "hybrid" : "reconnection";
+}
+
+static void write_json(std::ostream &out, CompareResult const &result, CompareSettings const &settings)
+{
+    uint64_t path_count = static_cast<uint64_t>(settings.width) * settings.height * settings.iteration_count;
+    out << "{\n";
+    out << "  \"benchmark\": \"path_reservoir\",\n";
+    out << "  \"width\": " << settings.width << ",\n";
+    out << "  \"height\": " << settings.height << ",\n";
+    out << "  \"iterations\": " << settings.iteration_count << ",\n";
+    out << "  \"reference_spp\": " << settings.reference_spp << ",\n";
+    out << "  \"max_depth\": " << settings.max_depth << ",\n";
+    out << "  \"shift_mapping\": \"" << shift_mapping_name(settings.shift_mapping) << "\",\n";
+    out << "  \"neighbors\": " << settings.neighbor_count << ",\n";
+    out << "  \"radius\": " << settings.neighbor_radius << ",\n";
+    out << "  \"reference_ms\": " << result.reference_ms << ",\n";
+    out << "  \"initial_ms\": " << result.initial_ms << ",\n";
+    out << "  \"reuse_ms\": " << result.reuse_ms << ",\n";
+    out << "  \"mpaths_per_second\": " << path_count / (result.initial_ms * 1e3) << ",\n";
+    out << "  \"mreuses_per_second\": " << path_count / (result.reuse_ms * 1e3) << ",\n";
+    out << "  \"rays_per_path\": " << static_cast<double>(result.initial_ray_count) / path_count << ",\n";
+    out << "  \"initial\": {\"rel_mse\": " << result.initial.rel_mse << ", \"ssim\": " << result.initial.ssim << ", \"flip\": " << result.initial.flip
+        << ", \"bias\": " << get_bias(result.initial_luminance, result.reference_luminance) << "},\n";
+    out << "  \"spatial\": {\"rel_mse\": " << result.spatial.rel_mse << ", \"ssim\": " << result.spatial.ssim << ", \"flip\": " << result.spatial.flip
+        << ", \"bias\": " << get_bias(result.spatial_luminance, result.reference_luminance) << "},\n";
+    out << "  \"gate\": " << settings.gate << ",\n";
+    out << "  \"bias_gate\": " << settings.bias_gate << ",\n";
+    out << "  \"passed\": " << (is_passing(result, settings) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, CompareResult const &result, CompareSettings const &settings)
+{
+    uint64_t path_count = static_cast<uint64_t>(settings.width) * settings.height * settings.iteration_count;
+    out << settings.width << "x" << settings.height << ", " << settings.iteration_count << " frames vs " << settings.reference_spp
+        << " spp reference, max depth " << settings.max_depth << ", " << shift_mapping_name(settings.shift_mapping) << " shift, "
+        << settings.neighbor_count << " neighbours in radius " << settings.neighbor_radius << std::endl;
+    out << "reference " << result.reference_ms << " ms, initial " << result.initial_ms << " ms ("
+        << path_count / (result.initial_ms * 1e3) << " Mpaths/s, " << static_cast<double>(result.initial_ray_count) / path_count
+        << " rays per path), spatial reuse " << result.reuse_ms << " ms (" << path_count / (result.reuse_ms * 1e3) << " Mpixels/s)" << std::endl;
+    out << std::endl;
+    out << "estimator          relMSE      SSIM      FLIP      mean luminance (bias)" << std::endl;
+    out << "reference                                          " << result.reference_luminance << std::endl;
+    out << "initial            " << result.initial.rel_mse << "    " << result.initial.ssim << "    " << result.initial.flip << "    "
+        << result.initial_luminance << " (" << get_bias(result.initial_luminance, result.reference_luminance) << ")" << std::endl;
+    out << "spatial reuse      " << result.spatial.rel_mse << "    " << result.spatial.ssim << "    " << result.spatial.flip << "    "
+        << result.spatial_luminance << " (" << get_bias(result.spatial_luminance, result.reference_luminance) << ")" << std::endl;
+    out << "gate: relMSE <= " << settings.gate << ", bias <= " << settings.bias_gate << (is_passing(result, settings) ? " (passed)" : " (FAILED)")
+        << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    CompareSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--width N] [--height N] [--iterations N] [--reference-spp N] [--max-depth N]"
+                               " [--shift reconnection|hybrid] [--neighbors N] [--radius N] [--gate X] [--bias-gate X] [--threads N]"
+                               " [--seed N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--iterations"))
+            settings.iteration_count = args.get_uint(1);
+        else if (args.is("--reference-spp"))
+            settings.reference_spp = args.get_uint(1);
+        else if (args.is("--max-depth"))
+            settings.max_depth = std::min(args.get_uint(1), 15U);
+        else if (args.is("--shift"))
+        {
+            std::string shift = args.get_string();
+            if (shift != "reconnection" && shift != "hybrid")
+            {
+                std::cerr << "Unknown shift mapping " << shift << std::endl;
+                return 1;
+            }
+            settings.shift_mapping = shift == "hybrid" ? HOST_SHIFT_MAPPING_HYBRID : HOST_SHIFT_MAPPING_RECONNECTION;
+        }
+        else if (args.is("--neighbors"))
+            settings.neighbor_count = args.get_uint();
+        else if (args.is("--radius"))
+            settings.neighbor_radius = static_cast<int32_t>(args.get_uint(1));
+        else if (args.is("--gate"))
+            settings.gate = args.get_double();
+        else if (args.is("--bias-gate"))
+            settings.bias_gate = args.get_double();
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--seed"))
+            settings.seed = args.get_uint();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.seed, settings.max_depth, settings.thread_count) == 0 ? 0 : 1;
+
+    CompareResult result = compare(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return is_passing(result, settings) ? 0 : 1;
+}
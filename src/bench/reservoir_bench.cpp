@@ -0,0 +1,627 @@
+// ReSTIR DI reservoir benchmark & property checks.
+// Runs the host port of the reservoir math (host_reservoir.hpp) on a synthetic scene: point lights above a plane of
+// pixels, drifting between frames, with hashed occluders so neighbouring pixels & frames have different targets.
+// The benchmark times RIS candidate streaming, temporal & spatial reuse for 1 thread up to --max-threads and reports
+// the relMSE of the last frame, so candidate counts & M caps can be tuned offline.
+// --verify runs N trials of every property: unbiasedness of RIS, of the temporal reuse (M capped or not, a light switched
+// off during the history) and of the spatial pairwise MIS, the bound of the M cap, and invariance of reservoir merges &
+// pairwise MIS weights under the merge order. The exit code is not 0 when one fails.
+//
+// usage: reservoir_bench [--verify N] [--width N] [--height N] [--lights N] [--candidates N] [--m-cap X] [--frames N]
+//                        [--max-threads N] [--repeat N] [--seed N] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "host_reservoir.hpp"
+#include "tile_pool.hpp"
+
+#include <random>
+
+//////////////////////////////// SCENE //////////////////////////////////////
+
+// Pixels on the z = 0 plane, point lights above it. Every 16th light is black, one light in 8 is occluded from a pixel.
+struct SyntheticScene
+{
+    static constexpr float PLANE_SIZE = 8.0f;
+    static constexpr float DRIFT = 0.05f; // per frame
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<glm::vec3> positions = {};
+    std::vector<glm::vec3> directions = {};
+    std::vector<glm::vec3> emission = {};
+    std::vector<uint32_t> off_from_frame = {};
+
+    SyntheticScene(uint32_t scene_width, uint32_t scene_height, uint32_t light_count, uint32_t seed)
+        : width(scene_width), height(scene_height)
+    {
+        std::mt19937 rng(seed);
+        auto uniform = [&](float a, float b)
+        { return std::uniform_real_distribution<float>(a, b)(rng); };
+
+        for (uint32_t i = 0; i < light_count; ++i)
+        {
+            positions.push_back({uniform(-1.0f, PLANE_SIZE + 1.0f), uniform(-1.0f, PLANE_SIZE + 1.0f), uniform(1.0f, 3.0f)});
+            directions.push_back(glm::normalize(glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), 0.001f)));
+            float intensity = (i % 16 == 15) ? 0.0f : uniform(1.0f, 4.0f);
+            emission.push_back(glm::vec3(uniform(0.2f, 1.0f), uniform(0.2f, 1.0f), uniform(0.2f, 1.0f)) * intensity);
+            off_from_frame.push_back(std::numeric_limits<uint32_t>::max());
+        }
+    }
+
+    auto get_pixel_count() const -> uint32_t { return width * height; }
+    auto get_light_count() const -> uint32_t { return static_cast<uint32_t>(positions.size()); }
+
+    glm::vec3 get_pixel_position(uint32_t pixel) const
+    {
+        return {(static_cast<float>(pixel % width) + 0.5f) / static_cast<float>(width) * PLANE_SIZE,
+                (static_cast<float>(pixel / width) + 0.5f) / static_cast<float>(height) * PLANE_SIZE, 0.0f};
+    }
+
+    // Unshadowed contribution of a light to a pixel at a frame, the target of the resampling is its luminance
+    glm::vec3 get_radiance(uint32_t frame, uint32_t pixel, uint32_t light) const
+    {
+        if (frame >= off_from_frame[light] || (host_tea(pixel, light) & 7U) == 0U)
+            return glm::vec3(0.0f);
+
+        glm::vec3 to_light = positions[light] + directions[light] * (DRIFT * static_cast<float>(frame)) - get_pixel_position(pixel);
+        float dist2 = glm::dot(to_light, to_light);
+        return emission[light] * (to_light.z / (dist2 * std::sqrt(dist2)));
+    }
+
+    // Sum over the lights, what the estimates converge to
+    glm::vec3 get_exact(uint32_t frame, uint32_t pixel) const
+    {
+        glm::vec3 sum = glm::vec3(0.0f);
+        for (uint32_t light = 0; light < get_light_count(); ++light)
+            sum += get_radiance(frame, pixel, light);
+        return sum;
+    }
+};
+
+// Point light loop of RIS (restir_resampling.glsl) with uniform light picks, then the visibility pass
+static RESERVOIR sample_ris(SyntheticScene const &scene, uint32_t frame, uint32_t pixel, uint32_t candidate_count, uint32_t &seed)
+{
+    uint32_t light_count = scene.get_light_count();
+    float light_pdf = 1.0f / static_cast<float>(light_count);
+
+    RESERVOIR reservoir = {};
+    host_initialise_reservoir(reservoir);
+    for (uint32_t l = 0; l < candidate_count; l++)
+    {
+        uint32_t light_index = std::min(host_urnd_interval(seed, 0, light_count), light_count - 1);
+        uint32_t current_seed = seed;
+
+        glm::vec3 F = scene.get_radiance(frame, pixel, light_index);
+
+        float m_i = 1.0f / std::max(static_cast<float>(candidate_count) * light_pdf, 1e-6f);
+
+        float w_i = host_luminance(F) * m_i;
+        host_update_reservoir(reservoir, light_index, GEOMETRY_LIGHT_POINT, current_seed, F, w_i, 1.0f, seed);
+    }
+
+    host_reservoir_visibility_pass(reservoir, host_is_reservoir_valid(reservoir));
+    return reservoir;
+}
+
+static glm::vec3 get_estimate(RESERVOIR const &reservoir)
+{
+    return to_glm(reservoir.F) * reservoir.W_y;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+// Mean & standard error of estimates per channel
+struct MeanEstimator
+{
+    double sum[3] = {};
+    double sum2[3] = {};
+    uint64_t count = 0;
+
+    void add(glm::vec3 const &value)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            sum[c] += value[c];
+            sum2[c] += static_cast<double>(value[c]) * value[c];
+        }
+        ++count;
+    }
+
+    // Largest distance of the mean to the expected value over the channels, in standard errors
+    double get_z_score(glm::vec3 const &expected) const
+    {
+        double z = 0.0;
+        for (int c = 0; c < 3; ++c)
+        {
+            double mean = sum[c] / static_cast<double>(count);
+            double variance = std::max(sum2[c] / static_cast<double>(count) - mean * mean, 0.0);
+            double error = std::sqrt(variance / static_cast<double>(count));
+            double difference = std::abs(mean - expected[c]);
+            // A constant estimate has to be exact up to float rounding
+            z = std::max(z, error > 0.0 ? difference / error : (difference > 1e-4 * std::abs(expected[c]) + 1e-6 ? 1e9 : 0.0));
+        }
+        return z;
+    }
+};
+
+// 5 standard errors: a false failure once in millions of checks
+static constexpr double MAX_Z_SCORE = 5.0;
+
+static bool report(char const *name, double max_z, std::string const &details = {})
+{
+    bool passed = max_z < MAX_Z_SCORE;
+    std::cout << name << ": max |z| " << max_z << (details.empty() ? "" : ", ") << details << (passed ? " (passed)" : " (FAILED)") << std::endl;
+    return passed;
+}
+
+static uint32_t get_trial_seed(uint32_t seed, uint32_t pixel, uint32_t trial)
+{
+    return host_tea(pixel, host_tea(seed, trial));
+}
+
+static constexpr uint32_t VERIFY_PIXELS[] = {0, 37, 130, 255};
+
+// E[F(Y) W_Y] is the sum over the lights for any candidate count
+static bool verify_ris(SyntheticScene const &scene, uint32_t trial_count, uint32_t seed)
+{
+    double max_z = 0.0;
+    for (uint32_t candidate_count : {1U, 4U, 16U})
+        for (uint32_t pixel : VERIFY_PIXELS)
+        {
+            MeanEstimator estimator = {};
+            for (uint32_t trial = 0; trial < trial_count; ++trial)
+            {
+                uint32_t trial_seed = get_trial_seed(seed, pixel, trial);
+                estimator.add(get_estimate(sample_ris(scene, 0, pixel, candidate_count, trial_seed)));
+            }
+            max_z = std::max(max_z, estimator.get_z_score(scene.get_exact(0, pixel)));
+        }
+    return report("ris unbiased", max_z);
+}
+
+// Temporal chain over drifting lights, one of them switched off half way: the last frame is still unbiased
+static bool verify_temporal(SyntheticScene scene, uint32_t trial_count, uint32_t seed)
+{
+    constexpr uint32_t FRAME_COUNT = 6;
+    constexpr uint32_t CANDIDATE_COUNT = 4;
+    scene.off_from_frame[3] = FRAME_COUNT / 2;
+
+    double max_z = 0.0;
+    for (float m_cap : {1.0f, HOST_MAX_INFLUENCE_FROM_THE_PAST_THRESHOLD, std::numeric_limits<float>::infinity()})
+        for (uint32_t pixel : VERIFY_PIXELS)
+        {
+            MeanEstimator estimator = {};
+            for (uint32_t trial = 0; trial < trial_count; ++trial)
+            {
+                uint32_t trial_seed = get_trial_seed(seed, pixel, trial);
+                RESERVOIR previous = {};
+                host_initialise_reservoir(previous);
+                for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+                {
+                    RESERVOIR reservoir = sample_ris(scene, frame, pixel, CANDIDATE_COUNT, trial_seed);
+                    if (frame > 0)
+                        host_temporal_reuse(
+                            reservoir, previous, [&](RESERVOIR const &sample)
+                            { return scene.get_radiance(frame - 1, pixel, sample.Y); },
+                            [&](RESERVOIR const &sample)
+                            { return scene.get_radiance(frame, pixel, sample.Y); },
+                            trial_seed, m_cap);
+                    previous = reservoir;
+                }
+                estimator.add(get_estimate(previous));
+            }
+            max_z = std::max(max_z, estimator.get_z_score(scene.get_exact(FRAME_COUNT - 1, pixel)));
+        }
+    return report("temporal unbiased (M cap 1, 20, none)", max_z);
+}
+
+// M of a static history saturates at (1 + cap) M, it grows by M every frame without a cap
+static bool verify_m_cap(SyntheticScene const &scene, uint32_t seed)
+{
+    constexpr uint32_t FRAME_COUNT = 64;
+    constexpr uint32_t CANDIDATE_COUNT = 4;
+    constexpr float M = static_cast<float>(CANDIDATE_COUNT);
+
+    uint32_t failure_count = 0;
+    for (float m_cap : {1.0f, 4.0f, HOST_MAX_INFLUENCE_FROM_THE_PAST_THRESHOLD, std::numeric_limits<float>::infinity()})
+        for (uint32_t pixel : VERIFY_PIXELS)
+        {
+            uint32_t trial_seed = get_trial_seed(seed, pixel, 0);
+            RESERVOIR previous = {};
+            host_initialise_reservoir(previous);
+            float expected_M = 0.0f;
+            for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+            {
+                RESERVOIR reservoir = sample_ris(scene, 0, pixel, CANDIDATE_COUNT, trial_seed);
+                if (frame > 0)
+                    host_temporal_reuse(
+                        reservoir, previous, [&](RESERVOIR const &sample)
+                        { return scene.get_radiance(0, pixel, sample.Y); },
+                        [&](RESERVOIR const &sample)
+                        { return scene.get_radiance(0, pixel, sample.Y); },
+                        trial_seed, m_cap);
+                expected_M = M + std::min(expected_M, m_cap * M);
+                if (reservoir.M != expected_M || reservoir.M > (1.0f + m_cap) * M)
+                    ++failure_count;
+                previous = reservoir;
+            }
+            bool saturated = std::isinf(m_cap) ? previous.M == M * FRAME_COUNT : previous.M == (1.0f + m_cap) * M;
+            failure_count += saturated ? 0 : 1;
+        }
+
+    std::cout << "M cap: " << failure_count << " frames off the bound" << (failure_count == 0 ? " (passed)" : " (FAILED)") << std::endl;
+    return failure_count == 0;
+}
+
+// Reservoirs merged with update_reservoir (the per light type reservoirs of RIS) in any order: same M & W_sum, each
+// input selected with probability W_sum_i / W_sum
+static bool verify_merge_order(SyntheticScene const &scene, uint32_t trial_count, uint32_t seed)
+{
+    constexpr uint32_t INPUT_COUNT = 5;
+    constexpr uint32_t ORDER_COUNT = 4;
+    std::mt19937 rng(seed);
+
+    double max_z = 0.0;
+    uint32_t sum_mismatch_count = 0;
+    for (uint32_t pixel : VERIFY_PIXELS)
+    {
+        RESERVOIR inputs[INPUT_COUNT] = {};
+        double W_sum = 0.0;
+        float M = 0.0f;
+        for (uint32_t i = 0; i < INPUT_COUNT; ++i)
+        {
+            uint32_t input_seed = get_trial_seed(seed, pixel, i);
+            inputs[i] = sample_ris(scene, 0, pixel, 1 + i, input_seed);
+            W_sum += inputs[i].W_sum;
+            M += inputs[i].M;
+        }
+
+        for (uint32_t order_index = 0; order_index < ORDER_COUNT; ++order_index)
+        {
+            // In order, reversed, then shuffled
+            uint32_t order[INPUT_COUNT] = {};
+            for (uint32_t i = 0; i < INPUT_COUNT; ++i)
+                order[i] = order_index == 1 ? INPUT_COUNT - 1 - i : i;
+            if (order_index > 1)
+                std::shuffle(std::begin(order), std::end(order), rng);
+
+            uint32_t selected_counts[INPUT_COUNT] = {};
+            for (uint32_t trial = 0; trial < trial_count; ++trial)
+            {
+                uint32_t trial_seed = get_trial_seed(seed + 1, pixel, trial);
+                RESERVOIR merged = {};
+                host_initialise_reservoir(merged);
+                uint32_t selected = INPUT_COUNT;
+                for (uint32_t i : order)
+                {
+                    if (host_update_reservoir(merged, inputs[i].Y, inputs[i].l_type, inputs[i].seed, to_glm(inputs[i].F), inputs[i].W_sum,
+                                              inputs[i].M, trial_seed))
+                        selected = i;
+                }
+                if (selected < INPUT_COUNT)
+                    ++selected_counts[selected];
+                if (trial == 0 && (merged.M != M || std::abs(merged.W_sum - W_sum) > 1e-5 * W_sum))
+                    ++sum_mismatch_count;
+            }
+
+            for (uint32_t i = 0; i < INPUT_COUNT; ++i)
+            {
+                double p = W_sum > 0.0 ? inputs[i].W_sum / W_sum : 0.0;
+                double expected = p * trial_count;
+                double error = std::sqrt(std::max(expected * (1.0 - p), 1e-12));
+                double difference = std::abs(selected_counts[i] - expected);
+                max_z = std::max(max_z, p > 0.0 && p < 1.0 ? difference / error : (difference > 0.0 ? 1e9 : 0.0));
+            }
+        }
+    }
+    if (sum_mismatch_count > 0)
+        max_z = std::numeric_limits<double>::infinity();
+    return report("merge order", max_z, std::to_string(sum_mismatch_count) + " M or W_sum mismatches");
+}
+
+// Pairwise MIS over the neighbours of a pixel in any order: same canonical weight m_c & streamed M, unbiased estimate
+static bool verify_pairwise_order(SyntheticScene const &scene, uint32_t trial_count, uint32_t seed)
+{
+    constexpr uint32_t CANDIDATE_COUNT = 4;
+    constexpr uint32_t NEIGHBOR_COUNT = HOST_MAX_NUM_OF_NEIGHBORS;
+    constexpr uint32_t ORDER_COUNT = 3;
+
+    double max_z = 0.0;
+    uint32_t weight_mismatch_count = 0;
+    for (uint32_t pixel : VERIFY_PIXELS)
+    {
+        // Neighbours in the same row or the next one, wrapped
+        uint32_t neighbors[NEIGHBOR_COUNT] = {};
+        for (uint32_t i = 0; i < NEIGHBOR_COUNT; ++i)
+            neighbors[i] = (pixel + 1 + i * (scene.width - 1)) % scene.get_pixel_count();
+
+        MeanEstimator estimators[ORDER_COUNT] = {};
+        for (uint32_t trial = 0; trial < trial_count; ++trial)
+        {
+            uint32_t trial_seed = get_trial_seed(seed, pixel, trial);
+            RESERVOIR canonical = sample_ris(scene, 0, pixel, CANDIDATE_COUNT, trial_seed);
+            RESERVOIR inputs[NEIGHBOR_COUNT] = {};
+            for (uint32_t i = 0; i < NEIGHBOR_COUNT; ++i)
+                inputs[i] = sample_ris(scene, 0, neighbors[i], CANDIDATE_COUNT, trial_seed);
+
+            float first_m_c = 0.0f, first_M_s = 0.0f;
+            for (uint32_t order_index = 0; order_index < ORDER_COUNT; ++order_index)
+            {
+                // In order, reversed, rotated
+                uint32_t order[NEIGHBOR_COUNT] = {};
+                for (uint32_t i = 0; i < NEIGHBOR_COUNT; ++i)
+                    order[i] = order_index == 0 ? i : (order_index == 1 ? NEIGHBOR_COUNT - 1 - i : (i + trial) % NEIGHBOR_COUNT);
+
+                uint32_t order_seed = trial_seed;
+                HostPairwiseMis mis = {};
+                host_pairwise_init(mis, NEIGHBOR_COUNT, canonical);
+                for (uint32_t i : order)
+                {
+                    host_pairwise_stream(
+                        mis, canonical, inputs[i], [&](RESERVOIR const &sample)
+                        { return scene.get_radiance(0, pixel, sample.Y); },
+                        [&](RESERVOIR const &sample)
+                        { return scene.get_radiance(0, neighbors[i], sample.Y); },
+                        order_seed);
+                }
+
+                if (order_index == 0)
+                {
+                    first_m_c = mis.m_c;
+                    first_M_s = mis.M_s;
+                }
+                else if (std::abs(mis.m_c - first_m_c) > 1e-5f * (1.0f + NEIGHBOR_COUNT) || mis.M_s != first_M_s)
+                    ++weight_mismatch_count;
+
+                host_pairwise_end(mis, canonical, order_seed);
+                estimators[order_index].add(get_estimate(mis.reservoir));
+            }
+        }
+
+        glm::vec3 exact = scene.get_exact(0, pixel);
+        for (auto const &estimator : estimators)
+            max_z = std::max(max_z, estimator.get_z_score(exact));
+    }
+    if (weight_mismatch_count > 0)
+        max_z = std::numeric_limits<double>::infinity();
+    return report("pairwise MIS order & unbiased", max_z, std::to_string(weight_mismatch_count) + " m_c or M mismatches");
+}
+
+static uint32_t verify(uint32_t trial_count, uint32_t seed)
+{
+    SyntheticScene scene(16, 16, 32, seed);
+
+    uint32_t failure_count = 0;
+    failure_count += verify_ris(scene, trial_count, seed) ? 0 : 1;
+    failure_count += verify_temporal(scene, trial_count, seed) ? 0 : 1;
+    failure_count += verify_m_cap(scene, seed) ? 0 : 1;
+    failure_count += verify_merge_order(scene, trial_count, seed) ? 0 : 1;
+    failure_count += verify_pairwise_order(scene, trial_count, seed) ? 0 : 1;
+
+    std::cout << "verify: " << trial_count << " trials, " << failure_count << " properties failed" << std::endl;
+    return failure_count;
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t candidate_count = 32; // MAX_RIS_CUBE_SAMPLE_COUNT
+    float m_cap = HOST_MAX_INFLUENCE_FROM_THE_PAST_THRESHOLD;
+    uint32_t frame_count = 4;
+    uint32_t repeat = 3;
+    uint32_t seed = 1;
+};
+
+struct BenchResult
+{
+    uint32_t thread_count = 0;
+    double ris_ms = 0.0;
+    double temporal_ms = 0.0;
+    double spatial_ms = 0.0;
+    double mcandidates = 0.0;           // per second, all threads
+    double mcandidates_per_thread = 0.0;
+    double mreservoirs_per_thread = 0.0; // temporal & spatial reuse
+    double rel_mse = 0.0;               // last frame
+};
+
+// Frames of RIS, temporal reuse & spatial reuse (the history is the spatial output), one tile per row
+static BenchResult bench_frames(SyntheticScene const &scene, uint32_t thread_count, BenchSettings const &settings)
+{
+    TilePool pool(thread_count);
+    uint32_t pixel_count = scene.get_pixel_count();
+    std::vector<RESERVOIR> current(pixel_count), intermediate(pixel_count), previous(pixel_count);
+
+    BenchResult result = {.thread_count = thread_count};
+    result.ris_ms = result.temporal_ms = result.spatial_ms = std::numeric_limits<double>::max();
+    for (uint32_t repeat = 0; repeat < settings.repeat; ++repeat)
+    {
+        double ris_ms = 0.0, temporal_ms = 0.0, spatial_ms = 0.0;
+        for (uint32_t frame = 0; frame < settings.frame_count; ++frame)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            pool.run(scene.height, [&](uint32_t y, uint32_t)
+                     {
+                for (uint32_t x = 0; x < scene.width; ++x)
+                {
+                    uint32_t pixel = y * scene.width + x;
+                    uint32_t seed = host_tea(pixel, settings.seed + frame);
+                    current[pixel] = sample_ris(scene, frame, pixel, settings.candidate_count, seed);
+                } });
+            ris_ms += elapsed_ms(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            pool.run(scene.height, [&](uint32_t y, uint32_t)
+                     {
+                for (uint32_t x = 0; x < scene.width; ++x)
+                {
+                    uint32_t pixel = y * scene.width + x;
+                    uint32_t seed = host_tea(pixel, settings.seed + frame + 0x100);
+                    intermediate[pixel] = current[pixel];
+                    if (frame > 0)
+                        host_temporal_reuse(
+                            intermediate[pixel], previous[pixel], [&](RESERVOIR const &sample)
+                            { return scene.get_radiance(frame - 1, pixel, sample.Y); },
+                            [&](RESERVOIR const &sample)
+                            { return scene.get_radiance(frame, pixel, sample.Y); },
+                            seed, settings.m_cap);
+                } });
+            temporal_ms += elapsed_ms(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            pool.run(scene.height, [&](uint32_t y, uint32_t)
+                     {
+                for (uint32_t x = 0; x < scene.width; ++x)
+                {
+                    uint32_t pixel = y * scene.width + x;
+                    uint32_t seed = host_tea(pixel, settings.seed + frame + 0x200);
+                    RESERVOIR reservoir = intermediate[pixel];
+                    float confidence = std::min(reservoir.M / static_cast<float>(settings.candidate_count * settings.frame_count), 1.0f);
+                    uint32_t neighbors[HOST_MAX_NUM_OF_NEIGHBORS] = {};
+                    uint32_t neighbor_count = host_get_spatial_neighbors(glm::uvec2(x, y), glm::uvec2(scene.width, scene.height), reservoir.W_y == 0.0f ? 0.0f : confidence,
+                                                                         0.0f, 1.0f, 8.0f, [](uint32_t)
+                                                                         { return true; }, seed, neighbors);
+                    host_spatial_reuse(
+                        reservoir, neighbor_count, [&](uint32_t i)
+                        { return intermediate[neighbors[i]]; },
+                        [&](RESERVOIR const &sample)
+                        { return scene.get_radiance(frame, pixel, sample.Y); },
+                        [&](uint32_t i, RESERVOIR const &sample)
+                        { return scene.get_radiance(frame, neighbors[i], sample.Y); },
+                        seed);
+                    // The history of the next frame, intermediate is still read by the neighbours
+                    current[pixel] = reservoir;
+                } });
+            std::swap(current, previous);
+            spatial_ms += elapsed_ms(start);
+        }
+        result.ris_ms = std::min(result.ris_ms, ris_ms);
+        result.temporal_ms = std::min(result.temporal_ms, temporal_ms);
+        result.spatial_ms = std::min(result.spatial_ms, spatial_ms);
+    }
+
+    double candidate_count = static_cast<double>(pixel_count) * settings.candidate_count * settings.frame_count;
+    result.mcandidates = candidate_count / (result.ris_ms * 1e3);
+    result.mcandidates_per_thread = result.mcandidates / thread_count;
+    result.mreservoirs_per_thread = 2.0 * pixel_count * settings.frame_count / ((result.temporal_ms + result.spatial_ms) * 1e3) / thread_count;
+
+    // Seeds only depend on the pixel & the frame, every thread count gets the same images
+    double error = 0.0;
+    uint32_t last_frame = settings.frame_count - 1;
+    for (uint32_t pixel = 0; pixel < pixel_count; ++pixel)
+    {
+        float exact = host_luminance(scene.get_exact(last_frame, pixel));
+        float difference = host_luminance(get_estimate(previous[pixel])) - exact;
+        error += difference * difference / (exact * exact + 1e-2f);
+    }
+    result.rel_mse = error / pixel_count;
+    return result;
+}
+
+static void write_json(std::ostream &out, std::vector<BenchResult> const &results, SyntheticScene const &scene, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"reservoir\",\n";
+    out << "  \"width\": " << scene.width << ",\n";
+    out << "  \"height\": " << scene.height << ",\n";
+    out << "  \"lights\": " << scene.get_light_count() << ",\n";
+    out << "  \"candidates\": " << settings.candidate_count << ",\n";
+    out << "  \"m_cap\": " << settings.m_cap << ",\n";
+    out << "  \"frames\": " << settings.frame_count << ",\n";
+    out << "  \"repeat\": " << settings.repeat << ",\n";
+    out << "  \"rel_mse\": " << (results.empty() ? 0.0 : results[0].rel_mse) << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto const &result = results[i];
+        out << "    {"
+            << "\"threads\": " << result.thread_count << ", "
+            << "\"ris_ms\": " << result.ris_ms << ", "
+            << "\"temporal_ms\": " << result.temporal_ms << ", "
+            << "\"spatial_ms\": " << result.spatial_ms << ", "
+            << "\"mcandidates_per_second\": " << result.mcandidates << ", "
+            << "\"mcandidates_per_second_per_thread\": " << result.mcandidates_per_thread << ", "
+            << "\"mreservoirs_per_second_per_thread\": " << result.mreservoirs_per_thread
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, std::vector<BenchResult> const &results)
+{
+    out << std::endl;
+    out << "threads    RIS ms    temporal ms    spatial ms    Mcandidates/s (per thread)    Mreservoirs/s per thread" << std::endl;
+    for (auto const &result : results)
+    {
+        out << "  " << result.thread_count << "        " << result.ris_ms << "    " << result.temporal_ms << "    " << result.spatial_ms << "    "
+            << result.mcandidates << " (" << result.mcandidates_per_thread << ")    " << result.mreservoirs_per_thread << std::endl;
+    }
+    if (!results.empty())
+        out << "relMSE of the last frame " << results[0].rel_mse << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    uint32_t width = 256;
+    uint32_t height = 256;
+    uint32_t light_count = 1024;
+    uint32_t max_thread_count = std::max(1U, std::thread::hardware_concurrency());
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--width N] [--height N] [--lights N] [--candidates N] [--m-cap X] [--frames N] [--max-threads N] [--repeat N] [--seed N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--width"))
+            width = args.get_uint(1);
+        else if (args.is("--height"))
+            height = args.get_uint(1);
+        else if (args.is("--lights"))
+            light_count = args.get_uint(1);
+        else if (args.is("--candidates"))
+            settings.candidate_count = args.get_uint(1);
+        else if (args.is("--m-cap"))
+            settings.m_cap = std::max(0.0f, static_cast<float>(args.get_double()));
+        else if (args.is("--frames"))
+            settings.frame_count = args.get_uint(1);
+        else if (args.is("--max-threads"))
+            max_thread_count = args.get_uint(1);
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--seed"))
+            settings.seed = args.get_uint();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.seed) == 0 ? 0 : 1;
+
+    SyntheticScene scene(width, height, light_count, settings.seed);
+
+    // Powers of two up to the thread count, then the thread count
+    std::vector<BenchResult> results = {};
+    for (uint32_t thread_count = 1;; thread_count = std::min(thread_count * 2, max_thread_count))
+    {
+        results.push_back(bench_frames(scene, thread_count, settings));
+        if (thread_count == max_thread_count)
+            break;
+    }
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, results, scene, settings); }))
+        return 1;
+
+    std::cout << width << "x" << height << " pixels, " << light_count << " lights, " << settings.candidate_count << " candidates, M cap "
+              << settings.m_cap << ", " << settings.frame_count << " frames" << std::endl;
+    write_table(std::cout, results);
+
+    return 0;
+}
@@ -0,0 +1,512 @@
+// Sampler convergence benchmark & checks.
+// Compares the samplers of sampler.hpp (LCG streams, PCG, Owen scrambled Sobol, blue noise masked Sobol) at equal
+// sample counts:
+//  - on integrands of known value over a tile of pixels (a smooth gaussian & a disk in 2D, a product in 4D, the same
+//    product across two padded sets): RMSE over the pixels per sample count & its log-log slope, plus the RMSE of the
+//    error image blurred by a 3x3 box (blue noise error is mostly high frequency & fades once filtered),
+//  - on the CPU reference (ReferenceTracer, jittered camera, 2 bounces) of a voxel room lit by small cube lights:
+//    relMSE against a converged Sobol reference whose samples none of the test images use, per sample count.
+// --verify N checks the samplers themselves at N random pixels: the Sobol matrices give the known first points,
+// Owen scrambled Sobol dimensions stay stratified (every 2^-m interval of the first 2^m frames holds one point, the
+// first two dimensions of a set are (0, m, 2)-nets), the blue noise mask rotates every pixel of a tile to its own
+// level, PCG values are uniform (chi-square), HostSampler walks the dimensions it's given & the rendered image doesn't
+// depend on the thread count or the tile size. The exit code is not 0 when one fails, or in the default mode when
+// Sobol isn't below PCG on every integrand and on the reference at the highest sample count.
+//
+// usage: sampler_bench [--verify N] [--max-spp N] [--tile N] [--width N] [--height N] [--reference-spp N]
+//                      [--threads N] [--json out.json]
+
+#include "bench_common.hpp"
+#include "bench_scene.hpp"
+#include "host_accel.hpp"
+#include "image_metrics.hpp"
+#include "sampler.hpp"
+
+static constexpr uint32_t SAMPLER_TYPE_COUNT = 4;
+static constexpr char const *SAMPLER_NAMES[SAMPLER_TYPE_COUNT] = {"lcg", "pcg", "sobol", "blue noise"};
+
+// Dimension d of sample s of a pixel, the LCG stream draws d + 1 numbers from tea(pixel, s)
+static float get_sample(uint32_t type, uint32_t x, uint32_t y, uint32_t width, uint32_t s, uint32_t dimension)
+{
+    if (type != SAMPLER_TYPE_LCG)
+        return host_sampler_get_1d(type, x, y, s, dimension);
+
+    uint32_t seed = host_tea(y * width + x, s);
+    float value = 0.0f;
+    for (uint32_t d = 0; d <= dimension; ++d)
+        value = host_rnd(seed);
+    return value;
+}
+
+//////////////////////////////// INTEGRANDS //////////////////////////////////////
+
+struct Integrand
+{
+    char const *name = "";
+    uint32_t dimensions[4] = {0, 1, 2, 3};
+    uint32_t dimension_count = 2;
+    double value = 0.0;
+    double (*evaluate)(float const *u) = nullptr;
+};
+
+static double evaluate_gaussian(float const *u)
+{
+    double x = u[0] - 0.5, y = u[1] - 0.5;
+    return std::exp(-8.0 * (x * x + y * y));
+}
+
+static double evaluate_disk(float const *u)
+{
+    double x = u[0] - 0.5, y = u[1] - 0.5;
+    return x * x + y * y < 0.16 ? 1.0 : 0.0;
+}
+
+static double evaluate_product(float const *u)
+{
+    return 16.0 * u[0] * u[1] * u[2] * u[3];
+}
+
+static std::vector<Integrand> get_integrands()
+{
+    double gaussian_1d = std::sqrt(std::numbers::pi / 8.0) * std::erf(std::sqrt(2.0));
+    return {
+        Integrand{.name = "gaussian 2D", .dimensions = {0, 1}, .dimension_count = 2, .value = gaussian_1d * gaussian_1d, .evaluate = evaluate_gaussian},
+        Integrand{.name = "disk 2D", .dimensions = {0, 1}, .dimension_count = 2, .value = std::numbers::pi * 0.16, .evaluate = evaluate_disk},
+        Integrand{.name = "product 4D", .dimensions = {4, 5, 6, 7}, .dimension_count = 4, .value = 1.0, .evaluate = evaluate_product},
+        Integrand{.name = "product 4D padded", .dimensions = {2, 3, 4, 5}, .dimension_count = 4, .value = 1.0, .evaluate = evaluate_product},
+    };
+}
+
+struct IntegrandPoint
+{
+    uint32_t spp = 0;
+    double rmse[SAMPLER_TYPE_COUNT] = {};
+    double blurred_rmse[SAMPLER_TYPE_COUNT] = {};
+};
+
+struct IntegrandResult
+{
+    Integrand integrand = {};
+    std::vector<IntegrandPoint> points = {};
+    double slopes[SAMPLER_TYPE_COUNT] = {}; // of log RMSE over log spp, -0.5 for Monte Carlo
+};
+
+static double get_slope(std::vector<double> const &spp, std::vector<double> const &errors)
+{
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (size_t i = 0; i < spp.size(); ++i)
+    {
+        if (errors[i] <= 0.0)
+            continue;
+        double x = std::log(spp[i]), y = std::log(errors[i]);
+        n += 1.0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    return (n < 2.0 || denominator == 0.0) ? 0.0 : (n * sxy - sx * sy) / denominator;
+}
+
+// Every sampler over a tile x tile block of pixels, the estimate of a pixel at spp uses its frames 0 to spp - 1
+static IntegrandResult measure_integrand(Integrand const &integrand, uint32_t tile, uint32_t max_spp, TilePool &pool)
+{
+    IntegrandResult result = {.integrand = integrand};
+    for (uint32_t spp = 1; spp <= max_spp; spp *= 2)
+        result.points.push_back(IntegrandPoint{.spp = spp});
+
+    for (uint32_t type = 0; type < SAMPLER_TYPE_COUNT; ++type)
+    {
+        // Running sums per pixel, the errors are taken at every power of two
+        std::vector<std::vector<double>> errors(result.points.size(), std::vector<double>(tile * tile, 0.0));
+        pool.run(tile, [&](uint32_t y, uint32_t)
+                 {
+            for (uint32_t x = 0; x < tile; ++x)
+            {
+                double sum = 0.0;
+                uint32_t point = 0;
+                for (uint32_t s = 0; s < max_spp; ++s)
+                {
+                    float u[4] = {};
+                    for (uint32_t d = 0; d < integrand.dimension_count; ++d)
+                        u[d] = get_sample(type, x, y, tile, s, integrand.dimensions[d]);
+                    sum += integrand.evaluate(u);
+                    if (s + 1 == result.points[point].spp)
+                        errors[point++][y * tile + x] = sum / (s + 1) - integrand.value;
+                }
+            } });
+
+        std::vector<double> spp = {}, rmse = {};
+        for (uint32_t point = 0; point < result.points.size(); ++point)
+        {
+            std::vector<double> const &error = errors[point];
+            double sum2 = 0.0, blurred_sum2 = 0.0;
+            for (uint32_t y = 0; y < tile; ++y)
+                for (uint32_t x = 0; x < tile; ++x)
+                {
+                    sum2 += error[y * tile + x] * error[y * tile + x];
+
+                    // Box filter on the torus, the blue noise mask tiles
+                    double blurred = 0.0;
+                    for (int32_t dy = -1; dy <= 1; ++dy)
+                        for (int32_t dx = -1; dx <= 1; ++dx)
+                            blurred += error[((y + tile + dy) % tile) * tile + (x + tile + dx) % tile];
+                    blurred /= 9.0;
+                    blurred_sum2 += blurred * blurred;
+                }
+            result.points[point].rmse[type] = std::sqrt(sum2 / (tile * tile)) / integrand.value;
+            result.points[point].blurred_rmse[type] = std::sqrt(blurred_sum2 / (tile * tile)) / integrand.value;
+            spp.push_back(result.points[point].spp);
+            rmse.push_back(result.points[point].rmse[type]);
+        }
+        result.slopes[type] = get_slope(spp, rmse);
+    }
+    return result;
+}
+
+//////////////////////////////// RENDER //////////////////////////////////////
+
+struct RenderSettings
+{
+    uint32_t width = 96;
+    uint32_t height = 64;
+    uint32_t reference_spp = 1024;
+    uint32_t max_spp = 64;
+    uint32_t tile = 64;
+    uint32_t thread_count = 0;
+};
+
+struct RenderPoint
+{
+    uint32_t spp = 0;
+    double rel_mse[SAMPLER_TYPE_COUNT] = {};
+    double ms[SAMPLER_TYPE_COUNT] = {};
+};
+
+struct RenderResult
+{
+    uint32_t primitive_count = 0;
+    uint32_t light_count = 0;
+    double reference_ms = 0.0;
+    std::vector<RenderPoint> points = {};
+    double rates[SAMPLER_TYPE_COUNT] = {}; // log-log slope of relMSE over spp, -1 for Monte Carlo
+};
+
+static ReferenceSettings get_reference_settings(RenderSettings const &settings)
+{
+    ReferenceSettings reference_settings = {};
+    reference_settings.width = settings.width;
+    reference_settings.height = settings.height;
+    reference_settings.max_depth = 2;
+    reference_settings.jitter = true;
+    return reference_settings;
+}
+
+static RenderResult measure_render(RenderSettings const &settings, TilePool &pool)
+{
+    HostScene scene = {};
+    build_room(scene);
+    HostAccel accel = {};
+    accel.build(scene, pool);
+    HostCamera camera = frame_room(scene, settings.width, settings.height);
+
+    RenderResult result = {};
+    result.primitive_count = scene.get_primitive_count();
+    result.light_count = static_cast<uint32_t>(scene.cube_lights.size());
+
+    // The reference starts far past the samples of the test images
+    ReferenceSettings reference_settings = get_reference_settings(settings);
+    reference_settings.samples_per_pixel = settings.reference_spp;
+    reference_settings.sampler_type = SAMPLER_TYPE_SOBOL;
+    reference_settings.first_sample = 1U << 20;
+    std::vector<glm::vec3> reference = {};
+    result.reference_ms = ReferenceTracer(accel, reference_settings).render(camera, pool, reference).render_ms;
+
+    std::vector<ConvergencePoint> curves[SAMPLER_TYPE_COUNT] = {};
+    for (uint32_t spp = 1; spp <= settings.max_spp; spp *= 2)
+    {
+        RenderPoint point = {.spp = spp};
+        for (uint32_t type = 0; type < SAMPLER_TYPE_COUNT; ++type)
+        {
+            ReferenceSettings test_settings = get_reference_settings(settings);
+            test_settings.samples_per_pixel = spp;
+            test_settings.sampler_type = type;
+            std::vector<glm::vec3> image = {};
+            point.ms[type] = ReferenceTracer(accel, test_settings).render(camera, pool, image).render_ms;
+
+            ImageMetrics metrics = compare_images(reference, image, settings.width, settings.height, pool);
+            point.rel_mse[type] = metrics.rel_mse;
+            curves[type].push_back(ConvergencePoint{.cost = static_cast<double>(spp), .metrics = metrics});
+        }
+        result.points.push_back(point);
+    }
+    for (uint32_t type = 0; type < SAMPLER_TYPE_COUNT; ++type)
+        result.rates[type] = get_convergence_rate(curves[type]);
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static bool verify(uint32_t trial_count, uint32_t thread_count)
+{
+    BenchCheck sobol_check = {.name = "sobol matrices give the known points"};
+    BenchCheck stratified_check = {.name = "owen sobol dimensions stratified"};
+    BenchCheck net_check = {.name = "owen sobol set pairs are (0, m, 2)-nets"};
+    BenchCheck blue_noise_check = {.name = "blue noise rotates every pixel of a tile to its own level"};
+    BenchCheck uniform_check = {.name = "pcg values uniform (chi-square)"};
+    BenchCheck stream_check = {.name = "sampler streams follow their dimensions"};
+    BenchCheck render_check = {.name = "renders independent of threads & tiles"};
+
+    // First dimension is van der Corput, second one in index (not Gray code) order: 0, 1/2, 3/4, 1/4, 5/8, 1/8, 3/8, 7/8
+    float const known[8] = {0.0f, 0.5f, 0.75f, 0.25f, 0.625f, 0.125f, 0.375f, 0.875f};
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        sobol_check.add(host_sampler_to_float(host_sampler_sobol(i, 0)) == host_sampler_to_float(host_sampler_reverse_bits(i)));
+        sobol_check.add(host_sampler_to_float(host_sampler_sobol(i, 1)) == known[i]);
+    }
+
+    uint32_t rng = host_tea(trial_count, 0x77);
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        uint32_t x = host_lcg(rng) % 1920, y = host_lcg(rng) % 1080;
+        uint32_t set = host_lcg(rng) % 16;
+        uint32_t m = 1 + host_lcg(rng) % 10;
+        uint32_t count = 1U << m;
+
+        // 1D strata & 2D elementary intervals of the first 2^m frames
+        std::vector<uint32_t> strata(count, 0);
+        for (uint32_t d = 0; d < SAMPLER_SOBOL_DIMENSIONS; ++d)
+        {
+            std::fill(strata.begin(), strata.end(), 0);
+            for (uint32_t s = 0; s < count; ++s)
+                ++strata[host_sampler_get_bits(SAMPLER_TYPE_SOBOL, x, y, s, set * SAMPLER_SOBOL_DIMENSIONS + d) >> (32 - m)];
+            stratified_check.add(std::all_of(strata.begin(), strata.end(), [](uint32_t n)
+                                             { return n == 1; }));
+        }
+        for (uint32_t k = 0; k <= m; ++k)
+        {
+            std::fill(strata.begin(), strata.end(), 0);
+            for (uint32_t s = 0; s < count; ++s)
+            {
+                uint32_t u = host_sampler_get_bits(SAMPLER_TYPE_SOBOL, x, y, s, set * SAMPLER_SOBOL_DIMENSIONS);
+                uint32_t v = host_sampler_get_bits(SAMPLER_TYPE_SOBOL, x, y, s, set * SAMPLER_SOBOL_DIMENSIONS + 1);
+                uint32_t cell = (k == 0 ? 0 : (u >> (32 - k)) << (m - k)) | (k == m ? 0 : v >> (32 - (m - k)));
+                ++strata[cell];
+            }
+            net_check.add(std::all_of(strata.begin(), strata.end(), [](uint32_t n)
+                                      { return n == 1; }));
+        }
+
+        // Blue noise: the rotations of a tile take every level once
+        uint32_t frame = host_lcg(rng) % 4096;
+        uint32_t dimension = host_lcg(rng) % 64;
+        uint32_t shared_bits = host_sampler_owen_sobol(frame, dimension, host_sampler_hash_combine(SAMPLER_BLUE_NOISE_SALT, dimension / SAMPLER_SOBOL_DIMENSIONS));
+        std::vector<uint8_t> levels(SAMPLER_BLUE_NOISE_SIZE * SAMPLER_BLUE_NOISE_SIZE, 0);
+        for (uint32_t ty = 0; ty < SAMPLER_BLUE_NOISE_SIZE; ++ty)
+            for (uint32_t tx = 0; tx < SAMPLER_BLUE_NOISE_SIZE; ++tx)
+            {
+                uint32_t bits = host_sampler_get_bits(SAMPLER_TYPE_BLUE_NOISE, x + tx, y + ty, frame, dimension);
+                levels[(bits - shared_bits) >> (32 - 12)] += 1;
+            }
+        blue_noise_check.add(std::all_of(levels.begin(), levels.end(), [](uint8_t n)
+                                         { return n == 1; }));
+
+        // Stream: the dimensions of a step, then numbers that aren't any of them
+        HostSampler sampler = host_sampler_init(1 + host_lcg(rng) % 3, x, y, frame, 1920);
+        uint32_t first = host_sampler_get_bounce_dimension(host_lcg(rng) % 4, SAMPLER_BOUNCE_LIGHT);
+        host_sampler_start(sampler, first, SAMPLER_BOUNCE_LIGHT_DIMENSIONS);
+        bool follows = true;
+        for (uint32_t d = 0; d < SAMPLER_BOUNCE_LIGHT_DIMENSIONS; ++d)
+            follows = follows && host_sampler_next_1d(sampler) == host_sampler_get_1d(sampler.type, x, y, frame, first + d);
+        float overflow = host_sampler_next_1d(sampler);
+        for (uint32_t d = 0; d < SAMPLER_BOUNCE_DIMENSIONS * 4; ++d)
+            follows = follows && overflow != host_sampler_get_1d(sampler.type, x, y, frame, d);
+        stream_check.add(follows);
+    }
+
+    // Chi-square of 64 bins over pixels, frames & dimensions, 99.9% quantile of 63 degrees of freedom is ~104
+    for (uint32_t dimension = 0; dimension < 8; ++dimension)
+    {
+        constexpr uint32_t BIN_COUNT = 64;
+        constexpr uint32_t SAMPLE_COUNT = 1 << 18;
+        uint32_t bins[BIN_COUNT] = {};
+        for (uint32_t i = 0; i < SAMPLE_COUNT; ++i)
+            ++bins[std::min(static_cast<uint32_t>(host_sampler_get_1d(SAMPLER_TYPE_PCG, i % 512, i / 512 % 64, i / 32768, dimension) * BIN_COUNT), BIN_COUNT - 1)];
+        double chi2 = 0.0, expected = static_cast<double>(SAMPLE_COUNT) / BIN_COUNT;
+        for (uint32_t bin : bins)
+            chi2 += (bin - expected) * (bin - expected) / expected;
+        uniform_check.add(chi2 < 104.0);
+    }
+
+    // Same bits with one thread & 16 pixel tiles as with the pool & 7 pixel tiles
+    {
+        TilePool one_thread(1);
+        TilePool pool(thread_count);
+        HostScene scene = {};
+        build_room(scene);
+        HostAccel accel = {};
+        accel.build(scene, pool);
+        RenderSettings settings = {.width = 40, .height = 24};
+        HostCamera camera = frame_room(scene, settings.width, settings.height);
+        for (uint32_t type = 0; type < SAMPLER_TYPE_COUNT; ++type)
+        {
+            ReferenceSettings reference_settings = get_reference_settings(settings);
+            reference_settings.samples_per_pixel = 4;
+            reference_settings.sampler_type = type;
+            std::vector<glm::vec3> a = {}, b = {};
+            ReferenceTracer(accel, reference_settings).render(camera, one_thread, a);
+            reference_settings.tile_size = 7;
+            ReferenceTracer(accel, reference_settings).render(camera, pool, b);
+            render_check.add(std::memcmp(a.data(), b.data(), a.size() * sizeof(glm::vec3)) == 0);
+        }
+    }
+
+    return report_checks<BenchCheck>({&sobol_check, &stratified_check, &net_check, &blue_noise_check, &uniform_check, &stream_check, &render_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static bool is_passing(std::vector<IntegrandResult> const &integrands, RenderResult const &render)
+{
+    bool passed = true;
+    for (IntegrandResult const &result : integrands)
+        passed = passed && result.points.back().rmse[SAMPLER_TYPE_SOBOL] < result.points.back().rmse[SAMPLER_TYPE_PCG];
+    return passed && render.points.back().rel_mse[SAMPLER_TYPE_SOBOL] < render.points.back().rel_mse[SAMPLER_TYPE_PCG];
+}
+
+static void write_json(std::ostream &out, std::vector<IntegrandResult> const &integrands, RenderResult const &render, RenderSettings const &settings)
+{
+    auto write_array = [&](double const *values)
+    {
+        out << "[";
+        for (uint32_t type = 0; type < SAMPLER_TYPE_COUNT; ++type)
+            out << (type == 0 ? "" : ", ") << values[type];
+        out << "]";
+    };
+
+    out << "{\n";
+    out << "  \"samplers\": [\"lcg\", \"pcg\", \"sobol\", \"blue_noise\"],\n";
+    out << "  \"tile\": " << settings.tile << ",\n";
+    out << "  \"integrands\": [\n";
+    for (size_t i = 0; i < integrands.size(); ++i)
+    {
+        IntegrandResult const &result = integrands[i];
+        out << "    {\"name\": \"" << result.integrand.name << "\", \"slopes\": ";
+        write_array(result.slopes);
+        out << ", \"points\": [";
+        for (size_t p = 0; p < result.points.size(); ++p)
+        {
+            out << (p == 0 ? "" : ", ") << "{\"spp\": " << result.points[p].spp << ", \"rmse\": ";
+            write_array(result.points[p].rmse);
+            out << ", \"blurred_rmse\": ";
+            write_array(result.points[p].blurred_rmse);
+            out << "}";
+        }
+        out << "]}" << (i + 1 < integrands.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"render\": {\"width\": " << settings.width << ", \"height\": " << settings.height << ", \"reference_spp\": " << settings.reference_spp
+        << ", \"reference_ms\": " << render.reference_ms << ", \"rates\": ";
+    write_array(render.rates);
+    out << ", \"points\": [";
+    for (size_t p = 0; p < render.points.size(); ++p)
+    {
+        out << (p == 0 ? "" : ", ") << "{\"spp\": " << render.points[p].spp << ", \"rel_mse\": ";
+        write_array(render.points[p].rel_mse);
+        out << ", \"ms\": ";
+        write_array(render.points[p].ms);
+        out << "}";
+    }
+    out << "]},\n";
+    out << "  \"passed\": " << (is_passing(integrands, render) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_row(std::ostream &out, std::string const &label, double const *values)
+{
+    write_cell(out, label, 10);
+    for (uint32_t type = 0; type < SAMPLER_TYPE_COUNT; ++type)
+        write_cell(out, values[type], 14);
+    out << std::endl;
+}
+
+static void write_header(std::ostream &out, char const *first)
+{
+    write_cell(out, first, 10);
+    for (char const *name : SAMPLER_NAMES)
+        write_cell(out, name, 14);
+    out << std::endl;
+}
+
+static void write_table(std::ostream &out, std::vector<IntegrandResult> const &integrands, RenderResult const &render, RenderSettings const &settings)
+{
+    for (IntegrandResult const &result : integrands)
+    {
+        out << result.integrand.name << ": relative RMSE over " << settings.tile << "x" << settings.tile << " pixels (3x3 blurred)" << std::endl;
+        write_header(out, "spp");
+        for (IntegrandPoint const &point : result.points)
+        {
+            write_row(out, std::to_string(point.spp), point.rmse);
+            write_row(out, "", point.blurred_rmse);
+        }
+        write_row(out, "slope", result.slopes);
+    }
+
+    out << "room: " << render.primitive_count << " voxels, " << render.light_count << " cube lights, " << settings.width << "x" << settings.height
+        << ", reference " << settings.reference_spp << " spp in " << render.reference_ms << " ms" << std::endl;
+    write_header(out, "spp");
+    for (RenderPoint const &point : render.points)
+        write_row(out, std::to_string(point.spp), point.rel_mse);
+    write_row(out, "rate", render.rates);
+    out << (is_passing(integrands, render) ? "passed" : "FAILED") << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    RenderSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--max-spp N] [--tile N] [--width N] [--height N] [--reference-spp N] [--threads N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--max-spp"))
+            settings.max_spp = args.get_uint(1);
+        else if (args.is("--tile"))
+            settings.tile = args.get_uint(4);
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--reference-spp"))
+            settings.reference_spp = args.get_uint(1);
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.thread_count) ? 0 : 1;
+
+    TilePool pool(settings.thread_count);
+
+    std::vector<IntegrandResult> integrands = {};
+    for (Integrand const &integrand : get_integrands())
+        integrands.push_back(measure_integrand(integrand, settings.tile, std::max(settings.max_spp, 256U), pool));
+
+    RenderResult render = measure_render(settings, pool);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, integrands, render, settings); }))
+        return 1;
+
+    write_table(std::cout, integrands, render, settings);
+
+    return is_passing(integrands, render) ? 0 : 1;
+}
@@ -0,0 +1,545 @@
+// Shader cache benchmark & checks.
+// Runs load_or_compile_shaders (shader_cache.hpp) on every permutation of the pipelines load_pipelines() creates, from
+// the sources under --root (the repo, like the app's working directory): cold on one thread & on every thread, then
+// warm. The compiler is a stand in costing --compile-ms per shader by default, --cli runs glslangValidator & slangc.
+// Reports the hashing of the include graph, cold & warm startup times, hits & permutations compiled once for both
+// pipelines, and the load of the same binaries from a shader pack (shader_pack.hpp).
+// --verify N checks on N random source trees: keys stable & following every reached include (quoted, angled, cycles,
+// Slang imports) but not commented or unreached files, keys of every define, stage, entry point & compiler name, one
+// compile per key, warm runs without compiles, rejected truncated, corrupted & stale files, failed compiles reported &
+// not cached, shader pack lookups, round trips, damaged packs & stale entries, and the pipeline table (sources found,
+// groups & stage order). The exit code is not 0 when one fails, or in the default mode when a shader doesn't compile.
+//
+// usage: shader_cache_bench [--verify N] [--root dir] [--include dir]... [--cli] [--glslang path] [--slangc path]
+//                           [--compile-ms N] [--repeat N] [--threads N] [--cache dir] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "shader_cache.hpp"
+#include "shader_pack.hpp"
+#include "sampler.hpp"
+
+#include <atomic>
+#include <chrono>
+
+//////////////////////////////// COMPILER //////////////////////////////////////
+
+// Stand in for the compilers: SPIR-V header words & the key after compile_ms, fails the permutations of failing_source
+struct FakeCompiler
+{
+    double compile_ms = 0.0;
+    std::string failing_source = {};
+    std::atomic<uint32_t> compile_count = 0;
+
+    auto get_function() -> ShaderCompileFunction
+    {
+        return [this](ShaderCompileJob const &job, ShaderCacheSettings const &, std::vector<uint32_t> &spirv, std::string &log)
+        {
+            compile_count.fetch_add(1, std::memory_order_relaxed);
+            if (compile_ms > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(compile_ms));
+            if (job.shader->source == failing_source)
+            {
+                log = job.shader->source + ": error: fake";
+                return false;
+            }
+            spirv = {SPIRV_MAGIC, 0x00010600, 0, static_cast<uint32_t>(job.key), static_cast<uint32_t>(job.key >> 32), 0};
+            return true;
+        };
+    }
+};
+
+// files gets copies of the reached files, the tree is gone on return
+static uint64_t get_key(ShaderPermutation const &shader, ShaderCacheSettings const &settings, std::vector<ShaderSourceFile> *files = nullptr)
+{
+    ShaderSourceTree tree = get_shader_source_tree(settings);
+    std::vector<ShaderSourceFile const *> dependencies = {};
+    std::filesystem::path source = tree.find(shader.source, shader.language);
+    if (source.empty() || !tree.get_dependencies(source, shader.language, dependencies))
+        return 0;
+    if (files)
+        for (ShaderSourceFile const *file : dependencies)
+            files->push_back(*file);
+    return get_shader_key(shader, dependencies, get_shader_compiler(settings, shader.language));
+}
+
+static void clear_cache(std::filesystem::path const &cache_dir)
+{
+    std::error_code error = {};
+    std::filesystem::remove_all(cache_dir, error);
+}
+
+//////////////////////////////// BENCH //////////////////////////////////////
+
+struct BenchSettings
+{
+    std::filesystem::path source_root = ".";
+    std::vector<std::filesystem::path> include_dirs = {};
+    bool use_cli = false;
+    std::string glsl_compiler = "glslangValidator";
+    std::string slang_compiler = "slangc";
+    double compile_ms = 250.0;
+    uint32_t repeat = 3;
+    uint32_t thread_count = 0;
+    std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "cube_tracing_shader_cache_bench";
+};
+
+struct BenchResult
+{
+    uint32_t pipeline_count = 0;
+    uint32_t shader_count = 0;
+    uint32_t unique_count = 0;
+    uint32_t file_count = 0;
+    uint32_t thread_count = 0;
+    double key_ms = 0.0;
+    double cold_one_thread_ms = 0.0;
+    double cold_pool_ms = 0.0;
+    double warm_ms = 0.0;
+    uint32_t warm_hit_count = 0;
+    double pack_ms = 0.0;
+    size_t pack_byte_count = 0;
+    bool compiled = false;
+    bool same_binaries = false; // cold & warm
+    std::string errors = {};
+};
+
+static BenchResult measure(BenchSettings const &settings)
+{
+    BenchResult result = {};
+    ShaderCacheSettings cache_settings = {
+        .cache_dir = settings.cache_dir,
+        .source_root = settings.source_root,
+        .include_dirs = settings.include_dirs,
+        .glsl_compiler = settings.glsl_compiler,
+        .slang_compiler = settings.slang_compiler,
+    };
+    FakeCompiler fake = {.compile_ms = settings.compile_ms};
+    ShaderCompileFunction compile = settings.use_cli ? ShaderCompileFunction(compile_shader_with_cli) : fake.get_function();
+
+    std::vector<PipelineDesc> descs = get_pipeline_descs(false);
+    std::vector<ShaderPermutation const *> shaders = get_pipeline_shaders(descs);
+    result.pipeline_count = static_cast<uint32_t>(descs.size());
+
+    result.key_ms = best_ms(settings.repeat, [&]()
+                            {
+        ShaderSourceTree tree = get_shader_source_tree(cache_settings);
+        std::vector<ShaderSourceFile const *> dependencies = {};
+        for (ShaderPermutation const *shader : shaders)
+        {
+            std::filesystem::path source = tree.find(shader->source, shader->language);
+            if (!source.empty())
+                tree.get_dependencies(source, shader->language, dependencies);
+        }
+        result.file_count = static_cast<uint32_t>(tree.files.size()); });
+
+    TilePool one_thread(1);
+    TilePool pool(settings.thread_count);
+    result.thread_count = pool.get_thread_count();
+
+    ShaderBinarySet cold = {};
+    ShaderCacheReport report = {};
+    clear_cache(settings.cache_dir);
+    auto start = std::chrono::high_resolution_clock::now();
+    result.compiled = load_or_compile_shaders(shaders, cache_settings, one_thread, cold, &report, compile);
+    result.cold_one_thread_ms = elapsed_ms(start);
+    result.shader_count = report.shader_count;
+    result.unique_count = report.unique_count;
+    result.errors = report.errors;
+
+    clear_cache(settings.cache_dir);
+    start = std::chrono::high_resolution_clock::now();
+    result.compiled = load_or_compile_shaders(shaders, cache_settings, pool, cold, &report, compile) && result.compiled;
+    result.cold_pool_ms = elapsed_ms(start);
+
+    ShaderBinarySet warm = {};
+    result.warm_ms = best_ms(settings.repeat, [&]()
+                             { load_or_compile_shaders(shaders, cache_settings, pool, warm, &report, compile); });
+    result.warm_hit_count = report.hit_count;
+    result.same_binaries = cold.binaries.size() == warm.binaries.size();
+    for (size_t i = 0; result.same_binaries && i < cold.binaries.size(); ++i)
+        result.same_binaries = cold.binaries[i].spirv == warm.binaries[i].spirv && warm.binaries[i].from_cache;
+
+    std::filesystem::path pack_path = settings.cache_dir / "shaders.bin";
+    ShaderPack pack = get_shader_pack(shaders, cold);
+    result.pack_byte_count = pack.get_byte_count();
+    bool packed = write_shader_pack(pack_path, pack);
+    result.pack_ms = best_ms(settings.repeat, [&]()
+                             {
+        packed = read_shader_pack(pack_path, pack) && packed;
+        for (ShaderPermutation const *shader : shaders)
+            packed = pack.find_spirv(*shader) && packed; });
+    result.same_binaries = result.same_binaries && packed;
+    clear_cache(settings.cache_dir);
+    return result;
+}
+
+// Random sources in the GLSL root paths under root: file i includes later files (quoted or angled, from either
+// directory), now & then an earlier one (a cycle, #pragma once in the real sources), a commented one & daxa
+struct SourceTree
+{
+    std::filesystem::path root = {};
+    std::vector<std::filesystem::path> paths = {};
+    std::vector<std::vector<uint32_t>> includes = {};
+
+    static auto get_name(uint32_t file) -> std::string { return "file_" + std::to_string(file) + ".glsl"; }
+
+    void write(uint32_t file, std::string const &body) const
+    {
+        std::ofstream out(paths[file]);
+        out << "#pragma once\n#include <daxa/daxa.inl>\n";
+        for (uint32_t include : includes[file])
+            out << (include % 2 ? "  #  include <" : "#include \"") << get_name(include) << (include % 2 ? ">" : "\"") << "\n";
+        out << "// #include \"" << get_name(static_cast<uint32_t>(paths.size()) - 1) << "\"\n";
+        out << body << "\n";
+    }
+
+    // Files reached from file 0
+    auto get_reached() const -> std::vector<bool>
+    {
+        std::vector<bool> reached(paths.size(), false);
+        std::vector<uint32_t> stack = {0};
+        while (!stack.empty())
+        {
+            uint32_t file = stack.back();
+            stack.pop_back();
+            if (reached[file])
+                continue;
+            reached[file] = true;
+            for (uint32_t include : includes[file])
+                stack.push_back(include);
+        }
+        return reached;
+    }
+};
+
+static SourceTree make_source_tree(std::filesystem::path const &root, uint32_t file_count, uint32_t seed)
+{
+    SourceTree tree = {.root = root};
+    std::filesystem::remove_all(root);
+    auto const &roots = get_shader_root_paths(ShaderSourceLanguage::GLSL);
+    for (uint32_t file = 0; file < file_count; ++file)
+    {
+        uint32_t hash = host_sampler_pcg(seed + file * 7919U);
+        std::filesystem::path dir = root / roots[2 + hash % 2]; // src/shaders/glsl or src/shaders/glsl/raytracing
+        std::filesystem::create_directories(dir);
+        tree.paths.push_back(dir / SourceTree::get_name(file));
+        tree.includes.push_back({});
+        // The last file is only ever commented out
+        for (uint32_t include = file + 1; include + 1 < file_count; ++include)
+            if (host_sampler_to_float(host_sampler_pcg(hash ^ include)) < 0.3f)
+                tree.includes[file].push_back(include);
+        if (file > 0 && hash % 5 == 0)
+            tree.includes[file].push_back(hash % file);
+    }
+    for (uint32_t file = 0; file < file_count; ++file)
+        tree.write(file, "float f" + std::to_string(file) + " = " + std::to_string(host_sampler_pcg(seed ^ file)) + ".0;");
+    return tree;
+}
+
+static bool verify(uint32_t trial_count, uint32_t thread_count, std::filesystem::path const &cache_dir, std::filesystem::path const &source_root)
+{
+    BenchCheck stable_check = {.name = "keys stable across source trees"};
+    BenchCheck include_check = {.name = "keys follow every reached include"};
+    BenchCheck unreached_check = {.name = "unreached & commented files ignored"};
+    BenchCheck permutation_check = {.name = "keys of defines, stage, entry point & compiler name"};
+    BenchCheck parse_check = {.name = "include & import lines"};
+    BenchCheck dedup_check = {.name = "one compile per key"};
+    BenchCheck warm_check = {.name = "warm runs load every binary"};
+    BenchCheck file_check = {.name = "truncated, corrupted & stale files rejected"};
+    BenchCheck failure_check = {.name = "failed compiles reported & not cached"};
+    BenchCheck pack_check = {.name = "shader packs"};
+    BenchCheck table_check = {.name = "pipeline table"};
+
+    TilePool pool(thread_count);
+    std::filesystem::path tree_root = cache_dir / "sources";
+    ShaderCacheSettings settings = {.cache_dir = cache_dir / "cache", .source_root = tree_root};
+
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        uint32_t seed = host_sampler_pcg(trial + 1);
+        uint32_t file_count = 4 + seed % 12;
+        SourceTree tree = make_source_tree(tree_root, file_count, seed);
+        std::vector<bool> reached = tree.get_reached();
+        ShaderPermutation shader = {.source = SourceTree::get_name(0), .stage = static_cast<ShaderStage>(seed % 7),
+                                    .defines = {{"A"}, {"B", std::to_string(seed % 3)}}};
+
+        // Stable & complete
+        std::vector<ShaderSourceFile> files = {};
+        uint64_t key = get_key(shader, settings, &files);
+        stable_check.add(key != 0 && key == get_key(shader, settings));
+        size_t reached_count = std::count(reached.begin(), reached.end(), true);
+        include_check.add(files.size() == reached_count);
+        bool daxa_missing = true;
+        for (ShaderSourceFile const &file : files)
+            daxa_missing = daxa_missing && file.missing_includes == std::vector<std::string>{"daxa/daxa.inl"};
+        parse_check.add(daxa_missing);
+
+        // Every reached file counts, the others don't
+        for (uint32_t file = 0; file < file_count; ++file)
+        {
+            tree.write(file, "float changed = " + std::to_string(trial) + ".0;");
+            uint64_t changed = get_key(shader, settings);
+            (reached[file] ? include_check : unreached_check).add(reached[file] ? changed != key : changed == key);
+            tree.write(file, "float f" + std::to_string(file) + " = " + std::to_string(host_sampler_pcg(seed ^ file)) + ".0;");
+        }
+        stable_check.add(get_key(shader, settings) == key);
+
+        // Permutations
+        std::vector<ShaderPermutation> others(6, shader);
+        others[0].defines[1].value += "0";
+        others[1].defines[0].name = "C";
+        others[2].defines.push_back({"SER"});
+        std::swap(others[3].defines[0], others[3].defines[1]);
+        others[4].stage = static_cast<ShaderStage>((seed + 1) % 7);
+        others[5].entry_point = "entry_other";
+        std::vector<uint64_t> keys = {key};
+        for (auto const &other : others)
+            keys.push_back(get_key(other, settings));
+        ShaderCacheSettings other_compiler = settings;
+        other_compiler.glsl_compiler = "/opt/bin/glslangValidator";
+        stable_check.add(get_key(shader, other_compiler) == key);
+        other_compiler.glsl_compiler = "/opt/bin/glslang";
+        keys.push_back(get_key(shader, other_compiler));
+        std::sort(keys.begin(), keys.end());
+        permutation_check.add(std::unique(keys.begin(), keys.end()) == keys.end());
+
+        // Include lines
+        std::vector<std::pair<std::string, bool>> includes = {};
+        get_shader_source_includes("#include \"a.glsl\"\n\t# include <b/c.inl>\n// #include \"d.glsl\"\n#define include\nimport e_f.g;\n",
+                                   ShaderSourceLanguage::SLANG, includes);
+        parse_check.add(includes == std::vector<std::pair<std::string, bool>>{{"a.glsl", true}, {"b/c.inl", false}, {"e_f/g.slang", true}});
+        includes.clear();
+        get_shader_source_includes("import x;\n", ShaderSourceLanguage::GLSL, includes);
+        parse_check.add(includes.empty());
+
+        // Cold with duplicates, then warm
+        clear_cache(settings.cache_dir);
+        std::vector<ShaderPermutation> table = {shader, others[0], shader, others[4], others[0], shader};
+        std::vector<ShaderPermutation const *> shaders = {};
+        for (auto const &entry : table)
+            shaders.push_back(&entry);
+        FakeCompiler fake = {.compile_ms = (seed % 4 == 0) ? 1.0 : 0.0};
+        ShaderBinarySet cold = {};
+        ShaderCacheReport report = {};
+        bool loaded = load_or_compile_shaders(shaders, settings, pool, cold, &report, fake.get_function());
+        dedup_check.add(loaded && report.unique_count == 3 && report.compiled_count == 3 && fake.compile_count == 3 &&
+                        cold.get(0).spirv == cold.get(2).spirv && &cold.get(0) == &cold.get(5) && cold.get(1).key == cold.get(4).key);
+        dedup_check.add(cold.get(0).key == key && cold.get(1).spirv != cold.get(0).spirv);
+
+        ShaderBinarySet warm = {};
+        loaded = load_or_compile_shaders(shaders, settings, pool, warm, &report, fake.get_function());
+        bool same = loaded && report.hit_count == 3 && report.compiled_count == 0 && fake.compile_count == 3;
+        for (size_t i = 0; same && i < shaders.size(); ++i)
+            same = warm.get(i).from_cache && warm.get(i).spirv == cold.get(i).spirv;
+        warm_check.add(same);
+
+        // Pack of the binaries: lookups, round trip, damaged packs & sources changed since
+        ShaderPack pack = get_shader_pack(shaders, cold);
+        bool found = pack.entries.size() == 3 && pack.binaries.size() == 3 && !pack.find(others[5]);
+        for (size_t i = 0; found && i < shaders.size(); ++i)
+            found = pack.find_spirv(*shaders[i]) && *pack.find_spirv(*shaders[i]) == cold.get(i).spirv && pack.find(*shaders[i])->key == cold.get(i).key;
+        pack_check.add(found);
+
+        std::filesystem::path pack_path = cache_dir / "shaders.bin";
+        ShaderPack read = {};
+        pack_check.add(write_shader_pack(pack_path, pack) && read_shader_pack(pack_path, read) && read.binaries == pack.binaries &&
+                       read.entries.size() == pack.entries.size() && std::filesystem::file_size(pack_path) == pack.get_byte_count());
+        pack_check.add(get_stale_shader_count(read, shaders, settings) == 0);
+        tree.write(0, "float stale = 1.0;");
+        pack_check.add(get_stale_shader_count(read, shaders, settings) == shaders.size());
+        tree.write(0, "float f0 = " + std::to_string(host_sampler_pcg(seed)) + ".0;");
+        for (uint32_t damage = 0; damage < 3; ++damage)
+        {
+            write_shader_pack(pack_path, pack);
+            uintmax_t size = std::filesystem::file_size(pack_path);
+            if (damage == 0)
+                std::filesystem::resize_file(pack_path, size - 4 * (1 + seed % 4));
+            else if (damage == 1)
+                std::filesystem::resize_file(pack_path, size + 4);
+            else
+            {
+                // First word of the first binary
+                std::fstream file(pack_path, std::ios::binary | std::ios::in | std::ios::out);
+                file.seekp((4 + pack.entries.size() * 5 + pack.binaries.size()) * sizeof(uint32_t));
+                uint32_t word = 0;
+                file.write(reinterpret_cast<char const *>(&word), sizeof(word));
+            }
+            pack_check.add(!read_shader_pack(pack_path, read) && read.entries.empty());
+        }
+
+        // Damaged files: truncated, not SPIR-V, another key
+        std::filesystem::path path = get_shader_binary_path(settings.cache_dir, shader, key);
+        std::filesystem::path other_path = get_shader_binary_path(settings.cache_dir, others[0], cold.get(1).key);
+        std::vector<uint32_t> spirv = {};
+        file_check.add(read_shader_binary(path, shader, key, spirv) && spirv == cold.get(0).spirv);
+        file_check.add(!read_shader_binary(path, others[4], key, spirv) && !read_shader_binary(path, shader, key + 1, spirv));
+        for (uint32_t damage = 0; damage < 3; ++damage)
+        {
+            if (damage == 0)
+                std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1 - seed % 8);
+            else if (damage == 1)
+            {
+                std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+                file.seekp(7 * sizeof(uint32_t));
+                uint32_t word = 0xDEADBEEF;
+                file.write(reinterpret_cast<char const *>(&word), sizeof(word));
+            }
+            else
+                std::filesystem::copy_file(other_path, path, std::filesystem::copy_options::overwrite_existing);
+            file_check.add(!read_shader_binary(path, shader, key, spirv));
+
+            uint32_t compiles = fake.compile_count;
+            loaded = load_or_compile_shaders(shaders, settings, pool, warm, &report, fake.get_function());
+            file_check.add(loaded && report.compiled_count == 1 && fake.compile_count == compiles + 1 && warm.get(0).spirv == cold.get(0).spirv &&
+                           read_shader_binary(path, shader, key, spirv));
+        }
+
+        // A failing source among good ones
+        clear_cache(settings.cache_dir);
+        ShaderPermutation failing = {.source = SourceTree::get_name(file_count - 1), .stage = ShaderStage::CALLABLE};
+        ShaderPermutation missing = {.source = "missing.glsl"};
+        FakeCompiler failing_compiler = {.failing_source = failing.source};
+        std::vector<ShaderPermutation const *> with_failure = {&shader, &failing};
+        loaded = load_or_compile_shaders(with_failure, settings, pool, cold, &report, failing_compiler.get_function());
+        uint64_t failing_key = get_key(failing, settings);
+        failure_check.add(!loaded && report.failed_count == 1 && report.compiled_count == 1 && report.errors.find("error: fake") != std::string::npos &&
+                          !std::filesystem::exists(get_shader_binary_path(settings.cache_dir, failing, failing_key)) &&
+                          std::filesystem::exists(get_shader_binary_path(settings.cache_dir, shader, key)));
+        with_failure = {&shader, &missing};
+        loaded = load_or_compile_shaders(with_failure, settings, pool, cold, &report, fake.get_function());
+        failure_check.add(!loaded && report.errors.find("missing.glsl") != std::string::npos && report.hit_count == 1);
+    }
+
+    // The pipelines of the app, on the sources of the repo
+    ShaderCacheSettings repo_settings = {.cache_dir = cache_dir / "cache", .source_root = source_root};
+    for (bool invocation_reorder : {false, true})
+    {
+        std::vector<PipelineDesc> descs = get_pipeline_descs(invocation_reorder);
+        for (auto const &desc : descs)
+        {
+            bool ordered = true;
+            for (size_t i = 0; i < desc.shaders.size(); ++i)
+            {
+                table_check.add(get_key(desc.shaders[i], repo_settings) != 0);
+                ordered = ordered && (i == 0 || desc.shaders[i - 1].stage <= desc.shaders[i].stage);
+            }
+            table_check.add(ordered && (desc.is_ray_tracing() || (desc.shaders.size() == 1 && desc.shaders[0].stage == ShaderStage::COMPUTE)));
+
+            auto is_stage = [&](uint32_t index, std::initializer_list<ShaderStage> stages)
+            {
+                return index < desc.shaders.size() && std::find(stages.begin(), stages.end(), desc.shaders[index].stage) != stages.end();
+            };
+            for (auto const &group : desc.groups)
+                table_check.add(group.type == ShaderGroupType::GENERAL
+                                    ? is_stage(group.general_shader_index, {ShaderStage::RAY_GEN, ShaderStage::MISS, ShaderStage::CALLABLE})
+                                    : is_stage(group.closest_hit_shader_index, {ShaderStage::CLOSEST_HIT}) &&
+                                          is_stage(group.any_hit_shader_index, {ShaderStage::ANY_HIT}) &&
+                                          is_stage(group.intersection_shader_index, {ShaderStage::INTERSECTION}));
+        }
+
+        // Both ray tracing pipelines share all but their ray gen shader
+        ShaderBinarySet set = {};
+        ShaderCacheReport report = {};
+        FakeCompiler fake = {};
+        clear_cache(repo_settings.cache_dir);
+        bool loaded = load_or_compile_shaders(get_pipeline_shaders(descs), repo_settings, pool, set, &report, fake.get_function());
+        table_check.add(loaded && report.unique_count == report.shader_count - descs[0].shaders.size() + 1);
+    }
+
+    clear_cache(cache_dir);
+
+    return report_checks<BenchCheck>({&stable_check, &include_check, &unreached_check, &permutation_check, &parse_check, &dedup_check,
+                                      &warm_check, &file_check, &failure_check, &pack_check, &table_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static bool is_passing(BenchResult const &result)
+{
+    return result.compiled && result.same_binaries && result.warm_hit_count == result.unique_count;
+}
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"shader_cache\",\n";
+    out << "  \"compiler\": \"" << (settings.use_cli ? "cli" : "fake") << "\",\n";
+    out << "  \"pipelines\": " << result.pipeline_count << ",\n";
+    out << "  \"shaders\": " << result.shader_count << ",\n";
+    out << "  \"unique_shaders\": " << result.unique_count << ",\n";
+    out << "  \"source_files\": " << result.file_count << ",\n";
+    out << "  \"threads\": " << result.thread_count << ",\n";
+    out << "  \"key_ms\": " << result.key_ms << ",\n";
+    out << "  \"cold_one_thread_ms\": " << result.cold_one_thread_ms << ",\n";
+    out << "  \"cold_pool_ms\": " << result.cold_pool_ms << ",\n";
+    out << "  \"warm_ms\": " << result.warm_ms << ",\n";
+    out << "  \"warm_hits\": " << result.warm_hit_count << ",\n";
+    out << "  \"pack_ms\": " << result.pack_ms << ",\n";
+    out << "  \"pack_bytes\": " << result.pack_byte_count << ",\n";
+    out << "  \"passed\": " << (is_passing(result) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "shaders: " << result.pipeline_count << " pipelines, " << result.shader_count << " permutations, " << result.unique_count
+        << " compiled once, " << result.file_count << " source files, " << (settings.use_cli ? "glslangValidator & slangc" : "fake compiler")
+        << ", " << result.thread_count << " threads" << std::endl;
+    out << "include graph keys: " << result.key_ms << " ms" << std::endl;
+    out << "cold:  1 thread " << result.cold_one_thread_ms << " ms, pool " << result.cold_pool_ms << " ms ("
+        << result.cold_one_thread_ms / std::max(result.cold_pool_ms, 1e-6) << "x)" << (result.compiled ? "" : " FAILED") << std::endl;
+    out << "warm:  " << result.warm_ms << " ms, " << result.warm_hit_count << " of " << result.unique_count << " from the cache"
+        << (result.same_binaries ? "" : " FAILED") << std::endl;
+    out << "pack:  " << result.pack_ms << " ms, " << result.pack_byte_count / 1024 << " KiB" << std::endl;
+    if (!result.errors.empty())
+        out << result.errors;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--root dir] [--include dir]... [--cli] [--glslang path] [--slangc path] [--compile-ms N] [--repeat N] [--threads N] [--cache dir] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--root"))
+            settings.source_root = args.get_string();
+        else if (args.is("--include"))
+            settings.include_dirs.push_back(args.get_string());
+        else if (args.is("--cli", 0))
+            settings.use_cli = true;
+        else if (args.is("--glslang"))
+            settings.glsl_compiler = args.get_string();
+        else if (args.is("--slangc"))
+            settings.slang_compiler = args.get_string();
+        else if (args.is("--compile-ms"))
+            settings.compile_ms = std::max(0.0, args.get_double());
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--cache"))
+            settings.cache_dir = args.get_string();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.thread_count, settings.cache_dir, settings.source_root) ? 0 : 1;
+
+    BenchResult result = measure(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return is_passing(result) ? 0 : 1;
+}
@@ -0,0 +1,590 @@
+// Texture pipeline benchmark & checks.
+// Imports a set of textures (procedural ones: gradients, checkers, noise, stripes & alpha ramps at odd sizes, and any
+// PPM/PFM given with --image) into texture arrays of every format with texture_pipeline.hpp, on one thread & on every
+// thread. Reports import throughput, bytes per texel, the PSNR of the first level against the uncompressed one, the
+// aliasing of point sampled minified textures with & without mips, and cache write & load times.
+// --verify N checks on N random textures: mip sizes & linear space filtering, constant & two color blocks, the BC7
+// mode & BC1 endpoint order, BC1 & BC7 errors, arrays independent of the thread count, MAX_TEXTURES & rejected inputs,
+// cache round trips, keys of every setting & image and rejected stale & truncated files. The exit code is not 0 when
+// one fails, or in the default mode when an import or the cache fails.
+//
+// usage: texture_pipeline_bench [--verify N] [--textures N] [--layer-size N] [--image in.ppm]... [--repeat N]
+//                               [--threads N] [--cache dir] [--json out.json]
+
+#include "defines.h"
+#include "bench_common.hpp"
+#include "texture_pipeline.hpp"
+#include "image_io.hpp"
+#include "sampler.hpp"
+
+//////////////////////////////// TEXTURES //////////////////////////////////////
+
+static constexpr uint32_t PATTERN_COUNT = 5;
+
+// Procedural texture of a pattern, sizes aren't powers of two on purpose
+static TextureImage make_texture(uint32_t pattern, uint32_t width, uint32_t height, uint32_t seed)
+{
+    TextureImage image(width, height);
+    for (uint32_t y = 0; y < height; ++y)
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(width), v = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+            uint32_t hash = host_sampler_pcg(seed ^ host_sampler_pcg(y * width + x));
+            float rgb[3] = {};
+            float alpha = 1.0f;
+            switch (pattern % PATTERN_COUNT)
+            {
+            case 0: // smooth gradient
+                rgb[0] = u, rgb[1] = v, rgb[2] = 0.5f * (1.0f - u);
+                break;
+            case 1: // checker of 8 texels
+                rgb[0] = rgb[1] = rgb[2] = ((x / 8 + y / 8) & 1) ? 0.9f : 0.1f;
+                rgb[1] *= 0.5f;
+                break;
+            case 2: // noisy stone
+                rgb[0] = rgb[1] = rgb[2] = 0.35f + 0.3f * host_sampler_to_float(hash);
+                rgb[2] *= 0.8f;
+                break;
+            case 3: // 1 texel stripes, the worst case for minification
+                rgb[0] = (x & 1) ? 1.0f : 0.0f, rgb[1] = (y & 1) ? 0.8f : 0.2f, rgb[2] = 0.5f;
+                break;
+            default: // foliage like cutout
+                rgb[0] = 0.2f * u, rgb[1] = 0.4f + 0.4f * v, rgb[2] = 0.1f;
+                alpha = std::clamp(std::sin(u * 40.0f) * std::sin(v * 30.0f) * 4.0f + 0.5f, 0.0f, 1.0f);
+                break;
+            }
+            uint8_t *texel = image.texel(x, y);
+            for (uint32_t c = 0; c < 3; ++c)
+                texel[c] = get_unit_byte(rgb[c]);
+            texel[3] = get_unit_byte(alpha);
+        }
+    return image;
+}
+
+static std::vector<TextureImage> make_textures(uint32_t count, uint32_t seed)
+{
+    static constexpr uint32_t SIZES[][2] = {{512, 512}, {300, 200}, {1024, 768}, {64, 64}, {37, 129}, {256, 256}};
+    std::vector<TextureImage> textures;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t const *size = SIZES[i % std::size(SIZES)];
+        textures.push_back(make_texture(i, size[0], size[1], seed + i));
+    }
+    return textures;
+}
+
+// Linear PPM/PFM to sRGB bytes, opaque
+static bool load_texture(std::filesystem::path const &path, TextureImage &image)
+{
+    uint32_t width = 0, height = 0;
+    std::vector<glm::vec3> pixels;
+    if (!read_image(path, width, height, pixels))
+        return false;
+    image = TextureImage(width, height);
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+        image.texels[i * 4 + 0] = get_unit_byte(linear_to_srgb(std::clamp(pixels[i].x, 0.0f, 1.0f)));
+        image.texels[i * 4 + 1] = get_unit_byte(linear_to_srgb(std::clamp(pixels[i].y, 0.0f, 1.0f)));
+        image.texels[i * 4 + 2] = get_unit_byte(linear_to_srgb(std::clamp(pixels[i].z, 0.0f, 1.0f)));
+        image.texels[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+// Mean squared error over the first channel_count channels of sRGB bytes
+static double get_texel_mse(TextureImage const &a, TextureImage const &b, uint32_t channel_count)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < a.texels.size(); i += 4)
+        for (uint32_t c = 0; c < channel_count; ++c)
+        {
+            double d = static_cast<double>(a.texels[i + c]) - static_cast<double>(b.texels[i + c]);
+            sum += d * d;
+        }
+    return sum / (static_cast<double>(a.texels.size() / 4) * channel_count);
+}
+
+static double get_psnr(double mse)
+{
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+}
+
+//////////////////////////////// BENCHMARK //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t texture_count = 12;
+    uint32_t layer_size = 512;
+    uint32_t repeat = 2;
+    uint32_t thread_count = 0;
+    std::vector<std::filesystem::path> image_paths = {};
+    std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "cube_tracing_texture_bench";
+};
+
+struct FormatResult
+{
+    TextureFormat format = TextureFormat::RGBA8;
+    double one_thread_ms = 0.0;
+    double pool_ms = 0.0;
+    size_t byte_count = 0;
+    size_t texel_count = 0;
+    double psnr = 0.0; // first levels against RGBA8, RGB for BC1
+    bool built = false;
+    bool same_bytes = false; // one thread & pool
+};
+
+struct BenchResult
+{
+    uint32_t thread_count = 0;
+    uint32_t layer_count = 0;
+    uint32_t mip_count = 0;
+    std::vector<FormatResult> formats = {};
+    double aliasing_rms = 0.0;    // point sampled level 0 at 1/8 scale against the box filtered image
+    double mip_rms = 0.0;         // level 3 against the same
+    double write_ms = 0.0;
+    double load_ms = 0.0;
+    bool cache_passed = false;
+};
+
+static bool same_levels(TextureArray const &a, TextureArray const &b)
+{
+    return a.settings == b.settings && a.layer_count == b.layer_count && a.levels == b.levels;
+}
+
+static BenchResult measure(std::vector<TextureImage> const &textures, BenchSettings const &settings)
+{
+    BenchResult result = {};
+    TilePool one_thread(1);
+    TilePool pool(settings.thread_count);
+    result.thread_count = pool.get_thread_count();
+
+    TextureArray rgba8 = {};
+    for (TextureFormat format : {TextureFormat::RGBA8, TextureFormat::BC1, TextureFormat::BC7})
+    {
+        FormatResult format_result = {.format = format};
+        TextureArraySettings array_settings = {.format = format, .layer_size = settings.layer_size};
+        TextureArray single = {}, parallel = {};
+        format_result.one_thread_ms = best_ms(settings.repeat, [&]()
+                                              { format_result.built = build_texture_array(textures, array_settings, single, one_thread); });
+        format_result.pool_ms = best_ms(settings.repeat, [&]()
+                                        { format_result.built = build_texture_array(textures, array_settings, parallel, pool) && format_result.built; });
+        format_result.same_bytes = same_levels(single, parallel);
+        format_result.byte_count = parallel.get_byte_count();
+        format_result.texel_count = parallel.get_texel_count();
+        result.layer_count = parallel.layer_count;
+        result.mip_count = parallel.mip_count;
+
+        if (format == TextureFormat::RGBA8)
+            rgba8 = parallel;
+        double mse = 0.0;
+        for (uint32_t layer = 0; format_result.built && layer < parallel.layer_count; ++layer)
+        {
+            TextureImage reference = {}, decoded = {};
+            rgba8.decode(0, layer, reference);
+            parallel.decode(0, layer, decoded);
+            mse += get_texel_mse(reference, decoded, format == TextureFormat::BC1 ? 3 : 4) / parallel.layer_count;
+        }
+        format_result.psnr = get_psnr(mse);
+        result.formats.push_back(format_result);
+    }
+
+    // Minified 8 times: every 8th texel of the first level against the 8x8 box average, which is what level 3 stores
+    if (rgba8.mip_count > 3)
+    {
+        double aliasing = 0.0, mip = 0.0;
+        size_t count = 0;
+        for (uint32_t layer = 0; layer < rgba8.layer_count; ++layer)
+        {
+            TextureImage level_0 = {}, level_3 = {};
+            rgba8.decode(0, layer, level_0);
+            rgba8.decode(3, layer, level_3);
+            LinearImage linear = get_linear_image(level_0);
+            LinearImage box = resample_linear_image(linear, level_3.width, level_3.height, pool);
+            TextureImage filtered = get_texture_image(box);
+            for (uint32_t y = 0; y < level_3.height; ++y)
+                for (uint32_t x = 0; x < level_3.width; ++x)
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        double point = level_0.texel(x * 8 + 3, y * 8 + 3)[c], reference = filtered.texel(x, y)[c];
+                        aliasing += (point - reference) * (point - reference);
+                        mip += (static_cast<double>(level_3.texel(x, y)[c]) - reference) * (static_cast<double>(level_3.texel(x, y)[c]) - reference);
+                        ++count;
+                    }
+        }
+        result.aliasing_rms = std::sqrt(aliasing / static_cast<double>(count));
+        result.mip_rms = std::sqrt(mip / static_cast<double>(count));
+    }
+
+    // Cache of the BC7 array
+    TextureArraySettings bc7_settings = {.format = TextureFormat::BC7, .layer_size = settings.layer_size};
+    TextureArray bc7 = {}, loaded = {};
+    uint64_t key = get_texture_array_key(textures, bc7_settings);
+    std::error_code error = {};
+    std::filesystem::create_directories(settings.cache_dir, error);
+    std::filesystem::path path = get_texture_array_path(settings.cache_dir, key);
+    bool built = build_texture_array(textures, bc7_settings, bc7, pool);
+    bool written = true, read = true;
+    result.write_ms = best_ms(settings.repeat, [&]()
+                              { written = write_texture_array(path, bc7, key) && written; });
+    result.load_ms = best_ms(settings.repeat, [&]()
+                             { read = read_texture_array(path, bc7_settings, key, loaded) && read; });
+    result.cache_passed = built && written && read && same_levels(bc7, loaded);
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+static double get_block_mse(TextureBlock const &a, TextureBlock const &b, uint32_t channel_count)
+{
+    double sum = 0.0;
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t c = 0; c < channel_count; ++c)
+        {
+            double d = static_cast<double>(a.texels[i][c]) - static_cast<double>(b.texels[i][c]);
+            sum += d * d;
+        }
+    return sum / (16.0 * channel_count);
+}
+
+static uint32_t get_max_block_error(TextureBlock const &a, TextureBlock const &b, uint32_t channel_count)
+{
+    uint32_t error = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t c = 0; c < channel_count; ++c)
+            error = std::max(error, static_cast<uint32_t>(std::abs(static_cast<int32_t>(a.texels[i][c]) - static_cast<int32_t>(b.texels[i][c]))));
+    return error;
+}
+
+static bool verify(uint32_t trial_count, uint32_t thread_count, std::filesystem::path const &cache_dir)
+{
+    BenchCheck mip_check = {.name = "mip chains halve down to 1x1"};
+    BenchCheck filter_check = {.name = "levels filtered in linear space"};
+    BenchCheck constant_check = {.name = "constant & two color blocks kept"};
+    BenchCheck layout_check = {.name = "BC7 mode 6 blocks & BC1 endpoint order"};
+    BenchCheck error_check = {.name = "BC1 & BC7 errors bounded, BC7 below BC1"};
+    BenchCheck thread_check = {.name = "arrays independent of the thread count"};
+    BenchCheck array_check = {.name = "layers, MAX_TEXTURES & rejected inputs"};
+    BenchCheck cache_check = {.name = "cache round trips are exact"};
+    BenchCheck key_check = {.name = "every setting & texel changes the cache key"};
+    BenchCheck reject_check = {.name = "stale & truncated files rejected"};
+
+    BenchRandom random = {};
+
+    TilePool one_thread(1);
+    TilePool pool(thread_count);
+    std::filesystem::path trial_dir = cache_dir / "verify";
+    std::error_code error = {};
+    std::filesystem::remove_all(trial_dir, error);
+
+    double bc1_sum = 0.0, bc7_sum = 0.0;
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        // Mip sizes of odd images
+        uint32_t width = 1 + random.next_below(300), height = 1 + random.next_below(300);
+        TextureImage image = make_texture(random.next_below(PATTERN_COUNT), width, height, trial);
+        std::vector<TextureImage> levels = build_mip_chain(get_linear_image(image), 64, pool);
+        mip_check.add(levels.size() == get_mip_count(width, height) && levels.back().width == 1 && levels.back().height == 1 &&
+                      std::memcmp(levels[0].texels.data(), image.texels.data(), image.texels.size()) == 0);
+        for (size_t l = 1; l < levels.size(); ++l)
+            mip_check.add(levels[l].width == std::max(1U, levels[l - 1].width / 2) && levels[l].height == std::max(1U, levels[l - 1].height / 2));
+
+        // Constant images stay constant, black & white average to the sRGB of linear 0.5
+        {
+            TextureImage constant(width, height);
+            uint8_t color[4] = {static_cast<uint8_t>(random.next_below(256)), static_cast<uint8_t>(random.next_below(256)), static_cast<uint8_t>(random.next_below(256)),
+                                static_cast<uint8_t>(random.next_below(256))};
+            for (size_t i = 0; i < constant.texels.size(); ++i)
+                constant.texels[i] = color[i % 4];
+            for (TextureImage const &level : build_mip_chain(get_linear_image(constant), 64, pool))
+                filter_check.add(std::memcmp(level.texel(level.width - 1, level.height - 1), color, 4) == 0);
+
+            TextureImage checker(2, 2);
+            for (uint32_t i = 0; i < 4; ++i)
+                std::memset(checker.texels.data() + i * 4, (i == 0 || i == 3) ? 255 : 0, 4);
+            std::vector<TextureImage> checker_levels = build_mip_chain(get_linear_image(checker), 2, pool);
+            uint8_t const *average = checker_levels[1].texel(0, 0);
+            filter_check.add(average[0] == get_unit_byte(linear_to_srgb(0.5f)) && average[3] == 128);
+        }
+
+        // Blocks: solid colors, two 565 colors, random & smooth ones
+        for (uint32_t b = 0; b < 64; ++b)
+        {
+            TextureBlock block = {};
+            uint32_t kind = b % 4;
+            uint8_t colors[2][4] = {};
+            for (uint32_t e = 0; e < 2; ++e)
+            {
+                int32_t packed[4] = {};
+                unpack_rgb565(static_cast<uint16_t>(random.next_below(65536)), packed);
+                for (uint32_t c = 0; c < 4; ++c)
+                    colors[e][c] = kind == 1 ? static_cast<uint8_t>(packed[c]) : static_cast<uint8_t>(random.next_below(256));
+                if (kind == 1)
+                    colors[e][3] = 255;
+            }
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                uint32_t pick = random.next_below(2);
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    switch (kind)
+                    {
+                    case 0: // solid
+                        block.texels[i][c] = colors[0][c];
+                        break;
+                    case 1: // two 565 colors
+                        block.texels[i][c] = colors[pick][c];
+                        break;
+                    case 2: // random
+                        block.texels[i][c] = static_cast<uint8_t>(random.next_below(256));
+                        break;
+                    default: // smooth ramp with a little noise
+                        block.texels[i][c] = static_cast<uint8_t>(std::clamp(static_cast<int32_t>(colors[0][c]) + ((static_cast<int32_t>(colors[1][c]) - colors[0][c]) * static_cast<int32_t>(i % 4 + i / 4)) / 6 +
+                                                                                 static_cast<int32_t>(random.next_below(5)) - 2,
+                                                                             0, 255));
+                        break;
+                    }
+                }
+            }
+
+            uint8_t bc1[8], bc7[16];
+            encode_bc1_block(block, bc1);
+            encode_bc7_block(block, bc7);
+            TextureBlock bc1_block = {}, bc7_block = {};
+            decode_bc1_block(bc1, bc1_block);
+            bool decoded = decode_bc7_block(bc7, bc7_block);
+
+            layout_check.add(decoded && (bc7[0] & 0x7F) == (1u << 6));
+            uint16_t c0 = static_cast<uint16_t>(bc1[0] | (bc1[1] << 8)), c1 = static_cast<uint16_t>(bc1[2] | (bc1[3] << 8));
+            layout_check.add(c0 >= c1);
+
+            if (kind == 0)
+            {
+                // 565 rounding for BC1, one step of the shared p-bit for BC7
+                constant_check.add(get_max_block_error(block, bc1_block, 3) <= 4 && get_max_block_error(block, bc7_block, 4) <= 1);
+            }
+            else if (kind == 1)
+                constant_check.add(get_max_block_error(block, bc1_block, 3) == 0 && get_max_block_error(block, bc7_block, 4) <= 4);
+            else if (kind == 3)
+            {
+                // 4 colors on the ramp are up to a sixth of its range away, 16 colors a thirtieth
+                double range = 0.0;
+                for (uint32_t c = 0; c < 3; ++c)
+                    range = std::max(range, std::abs(static_cast<double>(colors[1][c]) - static_cast<double>(colors[0][c])));
+                double bc1_mse = get_block_mse(block, bc1_block, 3), bc7_mse = get_block_mse(block, bc7_block, 3);
+                error_check.add(bc1_mse < (range / 6.0) * (range / 6.0) + 16.0 && bc7_mse < (range / 30.0) * (range / 30.0) + 16.0 &&
+                                get_block_mse(block, bc7_block, 4) < 16.0 + (range / 30.0) * (range / 30.0));
+                bc1_sum += bc1_mse;
+                bc7_sum += bc7_mse;
+            }
+            else
+            {
+                // Noise: no better than the bounds of a line fit, still no worse than its mean
+                double mean_mse = 0.0;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    double mean = 0.0;
+                    for (uint32_t i = 0; i < 16; ++i)
+                        mean += block.texels[i][c] / 16.0;
+                    for (uint32_t i = 0; i < 16; ++i)
+                        mean_mse += (block.texels[i][c] - mean) * (block.texels[i][c] - mean) / 48.0;
+                }
+                error_check.add(get_block_mse(block, bc1_block, 3) <= mean_mse * 1.05 + 16.0 && get_block_mse(block, bc7_block, 3) <= mean_mse * 1.05 + 4.0);
+            }
+        }
+
+        // Arrays of a few textures
+        std::vector<TextureImage> textures;
+        uint32_t texture_count = 1 + random.next_below(4);
+        for (uint32_t t = 0; t < texture_count; ++t)
+            textures.push_back(make_texture(random.next_below(PATTERN_COUNT), 1 + random.next_below(100), 1 + random.next_below(100), trial * 16 + t));
+        TextureArraySettings settings = {.format = static_cast<TextureFormat>(random.next_below(3)), .layer_size = 1U << (2 + random.next_below(5)),
+                                         .max_mip_count = random.next_below(3)};
+        TextureArray single = {}, parallel = {};
+        bool built = build_texture_array(textures, settings, single, one_thread) && build_texture_array(textures, settings, parallel, pool);
+        thread_check.add(built && same_levels(single, parallel));
+        array_check.add(built && parallel.layer_count == texture_count && parallel.mip_count == get_texture_array_mip_count(settings) &&
+                        parallel.levels.size() == parallel.mip_count);
+        for (uint32_t level = 0; built && level < parallel.mip_count; ++level)
+        {
+            TextureImage decoded = {};
+            array_check.add(parallel.levels[level].size() == parallel.get_layer_bytes(level) * texture_count &&
+                            parallel.decode(level, random.next_below(texture_count), decoded) && decoded.width == parallel.get_level_size(level));
+        }
+        // A texture already at the layer size goes through the RGBA8 array unchanged
+        {
+            TextureArray exact = {};
+            std::vector<TextureImage> same_size = {make_texture(trial, settings.layer_size, settings.layer_size, trial)};
+            TextureImage decoded = {};
+            array_check.add(build_texture_array(same_size, {.format = TextureFormat::RGBA8, .layer_size = settings.layer_size}, exact, pool) &&
+                            exact.decode(0, 0, decoded) && decoded.texels == same_size[0].texels);
+        }
+
+        // Cache: built first, then loaded with the same bytes
+        TextureArray first = {}, second = {};
+        bool first_from_cache = true, second_from_cache = false;
+        bool loaded = load_or_build_texture_array(trial_dir, textures, settings, first, pool, &first_from_cache) &&
+                      load_or_build_texture_array(trial_dir, textures, settings, second, pool, &second_from_cache);
+        cache_check.add(loaded && !first_from_cache && second_from_cache && same_levels(first, parallel) && same_levels(second, parallel));
+
+        uint64_t key = get_texture_array_key(textures, settings);
+        TextureArraySettings changed[] = {settings, settings, settings};
+        changed[0].format = static_cast<TextureFormat>((static_cast<uint32_t>(settings.format) + 1) % 3);
+        changed[1].layer_size *= 2;
+        changed[2].max_mip_count += 1;
+        std::filesystem::path path = get_texture_array_path(trial_dir, key);
+        for (TextureArraySettings const &other : changed)
+        {
+            key_check.add(get_texture_array_key(textures, other) != key);
+            TextureArray stale = {};
+            reject_check.add(!read_texture_array(path, other, key, stale));
+        }
+        std::vector<TextureImage> edited = textures;
+        TextureImage &edited_texture = edited[random.next_below(texture_count)];
+        edited_texture.texels[random.next_below(static_cast<uint32_t>(edited_texture.texels.size()))] ^= 1;
+        uint64_t edited_key = get_texture_array_key(edited, settings);
+        key_check.add(edited_key != key);
+        TextureArray stale = {};
+        reject_check.add(!read_texture_array(path, settings, edited_key, stale));
+
+        std::filesystem::path truncated = trial_dir / "truncated.bin";
+        std::filesystem::copy_file(path, truncated, std::filesystem::copy_options::overwrite_existing, error);
+        std::filesystem::resize_file(truncated, std::filesystem::file_size(path) - 1 - random.next_below(8), error);
+        TextureArray broken = {};
+        reject_check.add(!error && !read_texture_array(truncated, settings, key, broken) && broken.levels.empty());
+        reject_check.add(!read_texture_array(trial_dir / "missing.bin", settings, key, broken));
+    }
+    error_check.add(bc7_sum < bc1_sum);
+
+    // Inputs the pipeline refuses
+    {
+        TextureArray array = {};
+        std::vector<TextureImage> too_many(MAX_TEXTURES + 1, make_texture(0, 4, 4, 0));
+        std::vector<TextureImage> most(MAX_TEXTURES, make_texture(0, 4, 4, 0));
+        array_check.add(!build_texture_array(too_many, {.layer_size = 4}, array, pool));
+        array_check.add(build_texture_array(most, {.layer_size = 4}, array, pool) && array.layer_count == MAX_TEXTURES);
+        array_check.add(!build_texture_array({}, {}, array, pool));
+        array_check.add(!build_texture_array({make_texture(0, 4, 4, 0)}, {.layer_size = 48}, array, pool));
+        array_check.add(!build_texture_array({TextureImage(0, 4)}, {}, array, pool));
+    }
+
+    std::filesystem::remove_all(trial_dir, error);
+
+    return report_checks<BenchCheck>({&mip_check, &filter_check, &constant_check, &layout_check, &error_check, &thread_check, &array_check,
+                                      &cache_check, &key_check, &reject_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static bool is_passing(BenchResult const &result)
+{
+    bool passed = result.cache_passed;
+    for (FormatResult const &format : result.formats)
+        passed = passed && format.built && format.same_bytes;
+    return passed;
+}
+
+static double get_mtexels(FormatResult const &format, double ms)
+{
+    return static_cast<double>(format.texel_count) / (ms * 1e3);
+}
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"texture_pipeline\",\n";
+    out << "  \"layers\": " << result.layer_count << ",\n";
+    out << "  \"layer_size\": " << settings.layer_size << ",\n";
+    out << "  \"mips\": " << result.mip_count << ",\n";
+    out << "  \"threads\": " << result.thread_count << ",\n";
+    out << "  \"formats\": [\n";
+    for (size_t f = 0; f < result.formats.size(); ++f)
+    {
+        FormatResult const &format = result.formats[f];
+        out << "    {\"format\": \"" << get_texture_format_name(format.format) << "\", \"one_thread_ms\": " << format.one_thread_ms
+            << ", \"pool_ms\": " << format.pool_ms << ", \"bytes\": " << format.byte_count << ", \"texels\": " << format.texel_count
+            << ", \"bytes_per_texel\": " << static_cast<double>(format.byte_count) / static_cast<double>(format.texel_count) << ", \"psnr\": "
+            << (std::isinf(format.psnr) ? 999.0 : format.psnr) << "}" << (f + 1 < result.formats.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"aliasing_rms\": " << result.aliasing_rms << ",\n";
+    out << "  \"mip_rms\": " << result.mip_rms << ",\n";
+    out << "  \"cache_write_ms\": " << result.write_ms << ",\n";
+    out << "  \"cache_load_ms\": " << result.load_ms << ",\n";
+    out << "  \"passed\": " << (is_passing(result) ? "true" : "false") << "\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "textures: " << result.layer_count << " layers of " << settings.layer_size << "x" << settings.layer_size << ", " << result.mip_count
+        << " mips, " << result.thread_count << " threads" << std::endl;
+    out << "format  bytes/texel  PSNR dB    1 thread Mtexels/s  pool Mtexels/s" << std::endl;
+    for (FormatResult const &format : result.formats)
+    {
+        write_cell(out, get_texture_format_name(format.format), 8);
+        write_cell(out, static_cast<double>(format.byte_count) / static_cast<double>(format.texel_count), 13);
+        if (std::isinf(format.psnr))
+            write_cell(out, "exact", 11);
+        else
+            write_cell(out, format.psnr, 11);
+        write_cell(out, get_mtexels(format, format.one_thread_ms), 20);
+        out << get_mtexels(format, format.pool_ms) << (format.built && format.same_bytes ? "" : " FAILED") << std::endl;
+    }
+    out << "1/8 minification rms (sRGB steps): point sampled level 0 " << result.aliasing_rms << ", level 3 " << result.mip_rms << std::endl;
+    out << "BC7 cache: write " << result.write_ms << " ms, load " << result.load_ms << " ms" << (result.cache_passed ? "" : " FAILED") << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--textures N] [--layer-size N] [--image in.ppm]... [--repeat N] [--threads N] [--cache dir] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--textures"))
+            settings.texture_count = args.get_uint();
+        else if (args.is("--layer-size"))
+            settings.layer_size = args.get_uint(1);
+        else if (args.is("--image"))
+            settings.image_paths.push_back(args.get_string());
+        else if (args.is("--repeat"))
+            settings.repeat = args.get_uint(1);
+        else if (args.is("--threads"))
+            settings.thread_count = args.get_uint(1);
+        else if (args.is("--cache"))
+            settings.cache_dir = args.get_string();
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count, settings.thread_count, settings.cache_dir) ? 0 : 1;
+
+    std::vector<TextureImage> textures = make_textures(settings.texture_count, 0);
+    for (std::filesystem::path const &path : settings.image_paths)
+    {
+        TextureImage image = {};
+        if (!load_texture(path, image))
+        {
+            std::cerr << "Could not load " << path.string() << std::endl;
+            return 1;
+        }
+        textures.push_back(std::move(image));
+    }
+
+    BenchResult result = measure(textures, settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return is_passing(result) ? 0 : 1;
+}
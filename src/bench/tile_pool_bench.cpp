@@ -0,0 +1,512 @@
+// Job system scaling benchmark & checks.
+// Runs the host workloads of the TilePool (tile_pool.hpp) at 1, 2, 4... up to --max-threads threads and reports the
+// time, speedup & efficiency against one thread and the ranges stolen:
+//  - the CPU reference (ReferenceTracer) of a voxel floor with blocks & cube lights, Morton ordered tiles,
+//  - the image metrics (compare_images: SSIM & FLIP as concurrent jobs over bands of rows),
+//  - a graph of dependent jobs: a chain of blur passes over bands, each pass waiting on the previous one, fanned out
+//    to independent reductions joined by a last job,
+//  - the scheduling cost: empty tiles, and many small runs against starting threads for every run (the previous pool).
+// Thread counts past the cores of the machine oversubscribe them, the speedup flattens there.
+// --verify N runs N random job graphs: every tile runs once, no tile of a job starts before the last tile of its
+// dependencies ended, runs nested in tasks finish, jobs without tiles pass their dependencies on, Morton orders are
+// permutations whose groups of 4 tiles are 2x2 blocks, and renders don't depend on the thread count. The exit code is
+// not 0 when one fails.
+//
+// usage: tile_pool_bench [--verify N] [--max-threads N] [--width N] [--height N] [--spp N] [--repeat N] [--json out.json]
+
+#include "bench_common.hpp"
+#include "bench_scene.hpp"
+#include "host_accel.hpp"
+#include "image_metrics.hpp"
+#include "tile_pool.hpp"
+
+//////////////////////////////// SCENE //////////////////////////////////////
+
+static constexpr uint32_t YARD_VOXELS = 48;
+
+enum YARD_MATERIAL : uint32_t
+{
+    YARD_WHITE,
+    YARD_RED,
+    YARD_METAL,
+    YARD_LIGHT,
+    YARD_MATERIAL_COUNT,
+};
+
+// A floor with blocks of random heights, so tiles cost more where the blocks are, and cube lights above them
+static void build_yard(HostScene &scene)
+{
+    GvoxRegionChunk chunk = {};
+    chunk.materials.resize(YARD_MATERIAL_COUNT);
+    chunk.materials[YARD_WHITE] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.73f));
+    chunk.materials[YARD_RED] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.65f, 0.1f, 0.08f));
+    chunk.materials[YARD_METAL] = make_material(MATERIAL_TYPE_METAL, glm::vec3(0.85f), glm::vec3(0.0f), 0.3f);
+    chunk.materials[YARD_LIGHT] = make_material(MATERIAL_TYPE_LAMBERTIAN, glm::vec3(0.8f), glm::vec3(30.0f, 26.0f, 20.0f));
+
+    uint32_t seed = host_tea(YARD_VOXELS, 0x51);
+    for (uint32_t z = 0; z < YARD_VOXELS; ++z)
+        for (uint32_t x = 0; x < YARD_VOXELS; ++x)
+            add_voxel(chunk, x, 0, z, YARD_WHITE);
+
+    // Blocks on the back half of the yard only
+    for (uint32_t block = 0; block < 24; ++block)
+    {
+        uint32_t x0 = host_lcg(seed) % (YARD_VOXELS - 4);
+        uint32_t z0 = host_lcg(seed) % (YARD_VOXELS / 2 - 4);
+        uint32_t height = 2 + host_lcg(seed) % 10;
+        uint32_t material = block % 3 == 0 ? YARD_METAL : (block % 3 == 1 ? YARD_RED : YARD_WHITE);
+        for (uint32_t y = 1; y <= height; ++y)
+            for (uint32_t z = z0; z < z0 + 3; ++z)
+                for (uint32_t x = x0; x < x0 + 3; ++x)
+                    add_voxel(chunk, x, y, z, material);
+    }
+    for (uint32_t light = 0; light < 16; ++light)
+        add_voxel(chunk, host_lcg(seed) % YARD_VOXELS, 14 + host_lcg(seed) % 4, host_lcg(seed) % YARD_VOXELS, YARD_LIGHT);
+
+    add_centered_chunk(scene, chunk, YARD_VOXELS, 4.0f);
+    add_sky(scene, 10.0f);
+}
+
+// Camera above the front edge looking over the yard
+static HostCamera frame_yard(HostScene const &scene, uint32_t width, uint32_t height)
+{
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = (scene.bounds_max.x - scene.bounds_min.x) * 0.5f;
+    return get_host_camera(width, height, center + glm::vec3(0.0f, radius * 0.6f, radius * 1.3f), center);
+}
+
+//////////////////////////////// WORKLOADS //////////////////////////////////////
+
+struct BenchSettings
+{
+    uint32_t max_thread_count = 64;
+    uint32_t width = 160;
+    uint32_t height = 96;
+    uint32_t samples_per_pixel = 8;
+    uint32_t repeat_count = 3;
+};
+
+enum WORKLOAD : uint32_t
+{
+    WORKLOAD_RENDER,
+    WORKLOAD_METRICS,
+    WORKLOAD_GRAPH,
+    WORKLOAD_EMPTY_TILES,
+    WORKLOAD_SMALL_RUNS,
+    WORKLOAD_SPAWNED_RUNS,
+    WORKLOAD_COUNT,
+};
+
+static constexpr char const *WORKLOAD_NAMES[WORKLOAD_COUNT] = {"render", "metrics", "job graph", "empty tiles", "small runs", "spawned runs"};
+
+struct WorkloadPoint
+{
+    uint32_t thread_count = 0;
+    double ms = 0.0;
+    uint32_t steal_count = 0;
+};
+
+struct BenchResult
+{
+    uint32_t hardware_thread_count = 0;
+    uint32_t primitive_count = 0;
+    std::vector<WorkloadPoint> points[WORKLOAD_COUNT] = {};
+};
+
+static constexpr uint32_t BLUR_PASS_COUNT = 8;
+static constexpr uint32_t BLUR_BAND_ROWS = 8;
+
+// BLUR_PASS_COUNT vertical blurs over bands of rows, a pass reads the whole previous one so it waits on it, then one
+// reduction per band of the last pass (independent) joined by a sum. Returns the sum.
+static double run_job_graph(TilePool &pool, uint32_t width, uint32_t height, std::vector<float> &a, std::vector<float> &b)
+{
+    uint32_t band_count = (height + BLUR_BAND_ROWS - 1) / BLUR_BAND_ROWS;
+    std::vector<float> *planes[2] = {&a, &b};
+
+    TileJob previous = {};
+    for (uint32_t pass = 0; pass < BLUR_PASS_COUNT; ++pass)
+    {
+        std::vector<float> const &in = *planes[pass % 2];
+        std::vector<float> &out = *planes[(pass + 1) % 2];
+        previous = pool.submit(band_count, [&in, &out, width, height](uint32_t band, uint32_t)
+                               {
+            uint32_t first_row = band * BLUR_BAND_ROWS;
+            for (uint32_t y = first_row; y < std::min(height, first_row + BLUR_BAND_ROWS); ++y)
+            {
+                uint32_t up = y == 0 ? 0 : y - 1, down = std::min(height - 1, y + 1);
+                for (uint32_t x = 0; x < width; ++x)
+                    out[y * width + x] = (in[up * width + x] + 2.0f * in[y * width + x] + in[down * width + x]) * 0.25f;
+            } },
+                               {previous});
+    }
+
+    std::vector<double> band_sums(band_count, 0.0);
+    std::vector<float> const &last = *planes[BLUR_PASS_COUNT % 2];
+    std::vector<TileJob> reductions = {};
+    for (uint32_t band = 0; band < band_count; ++band)
+    {
+        reductions.push_back(pool.submit(1, [&, band](uint32_t, uint32_t)
+                                         {
+            uint32_t first_row = band * BLUR_BAND_ROWS;
+            double sum = 0.0;
+            for (uint32_t y = first_row; y < std::min(height, first_row + BLUR_BAND_ROWS); ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                    sum += last[y * width + x];
+            band_sums[band] = sum; },
+                                         {previous}));
+    }
+
+    double total = 0.0;
+    pool.wait(pool.submit(1, [&](uint32_t, uint32_t)
+                          {
+        for (double sum : band_sums)
+            total += sum; },
+                          reductions));
+    return total;
+}
+
+// The previous pool: threads started & joined for every run
+static void run_spawned(uint32_t thread_count, uint32_t tile_count, std::function<void(uint32_t, uint32_t)> const &task)
+{
+    std::atomic<uint32_t> next_tile = 0;
+    auto worker = [&](uint32_t thread_index)
+    {
+        for (uint32_t tile = next_tile++; tile < tile_count; tile = next_tile++)
+            task(tile, thread_index);
+    };
+    std::vector<std::jthread> workers = {};
+    for (uint32_t thread_index = 1; thread_index < thread_count; ++thread_index)
+        workers.emplace_back(worker, thread_index);
+    worker(0);
+}
+
+static constexpr uint32_t EMPTY_TILE_COUNT = 1 << 20;
+static constexpr uint32_t SMALL_RUN_COUNT = 2000;
+static constexpr uint32_t SMALL_RUN_TILE_COUNT = 64;
+
+static BenchResult measure(BenchSettings const &settings)
+{
+    BenchResult result = {};
+    result.hardware_thread_count = std::max(1U, std::thread::hardware_concurrency());
+
+    HostScene scene = {};
+    build_yard(scene);
+    HostAccel accel = {};
+    {
+        TilePool build_pool(1);
+        accel.build(scene, build_pool);
+    }
+    result.primitive_count = scene.get_primitive_count();
+    HostCamera camera = frame_yard(scene, settings.width, settings.height);
+
+    ReferenceSettings reference_settings = {};
+    reference_settings.width = settings.width;
+    reference_settings.height = settings.height;
+    reference_settings.samples_per_pixel = settings.samples_per_pixel;
+    reference_settings.max_depth = 3;
+    reference_settings.jitter = true;
+    ReferenceTracer tracer(accel, reference_settings);
+
+    // Metrics of a 1 spp image against the render
+    std::vector<glm::vec3> reference = {}, test = {};
+    {
+        TilePool pool(1);
+        tracer.render(camera, pool, reference);
+        ReferenceSettings test_settings = reference_settings;
+        test_settings.samples_per_pixel = 1;
+        ReferenceTracer(accel, test_settings).render(camera, pool, test);
+    }
+
+    uint32_t plane_width = 1024, plane_height = 1024;
+    std::vector<float> plane_a(plane_width * plane_height), plane_b(plane_width * plane_height);
+
+    for (uint32_t thread_count = 1; thread_count <= settings.max_thread_count; thread_count *= 2)
+    {
+        TilePool pool(thread_count);
+        WorkloadPoint points[WORKLOAD_COUNT] = {};
+        for (auto &point : points)
+            point.thread_count = thread_count;
+
+        std::vector<glm::vec3> image = {};
+        points[WORKLOAD_RENDER].ms = best_ms(settings.repeat_count, [&]
+                                               { points[WORKLOAD_RENDER].steal_count = tracer.render(camera, pool, image).steal_count; });
+
+        points[WORKLOAD_METRICS].ms = best_ms(settings.repeat_count, [&]
+                                                { compare_images(reference, test, settings.width, settings.height, pool); });
+
+        points[WORKLOAD_GRAPH].ms = best_ms(settings.repeat_count, [&]
+                                              {
+            for (uint32_t i = 0; i < plane_a.size(); ++i)
+                plane_a[i] = static_cast<float>(i % 97);
+            run_job_graph(pool, plane_width, plane_height, plane_a, plane_b); });
+
+        std::atomic<uint32_t> counter = 0;
+        auto empty_task = [&](uint32_t, uint32_t)
+        { counter.fetch_add(1, std::memory_order_relaxed); };
+        points[WORKLOAD_EMPTY_TILES].ms = best_ms(settings.repeat_count, [&]
+                                                    { pool.run(EMPTY_TILE_COUNT, empty_task); });
+        points[WORKLOAD_EMPTY_TILES].steal_count = pool.get_steal_count();
+
+        points[WORKLOAD_SMALL_RUNS].ms = best_ms(settings.repeat_count, [&]
+                                                   {
+            for (uint32_t run = 0; run < SMALL_RUN_COUNT; ++run)
+                pool.run(SMALL_RUN_TILE_COUNT, empty_task); });
+
+        points[WORKLOAD_SPAWNED_RUNS].ms = best_ms(settings.repeat_count, [&]
+                                                     {
+            for (uint32_t run = 0; run < SMALL_RUN_COUNT; ++run)
+                run_spawned(thread_count, SMALL_RUN_TILE_COUNT, empty_task); });
+
+        for (uint32_t workload = 0; workload < WORKLOAD_COUNT; ++workload)
+            result.points[workload].push_back(points[workload]);
+    }
+    return result;
+}
+
+//////////////////////////////// VERIFY //////////////////////////////////////
+
+// Start & end ticks of every tile of a job on a shared clock
+struct TracedJob
+{
+    TileJob job = {};
+    std::vector<uint32_t> dependencies = {};
+    std::vector<std::atomic<uint32_t>> run_counts = {};
+    std::vector<std::atomic<uint64_t>> starts = {};
+    std::vector<std::atomic<uint64_t>> ends = {};
+};
+
+static bool verify(uint32_t trial_count)
+{
+    BenchCheck once_check = {.name = "every tile runs once"};
+    BenchCheck order_check = {.name = "jobs start after their dependencies"};
+    BenchCheck nested_check = {.name = "runs nested in tasks finish"};
+    BenchCheck empty_check = {.name = "jobs without tiles pass dependencies on"};
+    BenchCheck morton_check = {.name = "morton orders are permutations of 2x2 blocks"};
+    BenchCheck render_check = {.name = "renders independent of the thread count"};
+
+    BenchRandom random = {.state = host_tea(trial_count, 0x41)};
+    for (uint32_t trial = 0; trial < trial_count; ++trial)
+    {
+        TilePool pool(1 + random.next_below(12));
+
+        // Random DAG, job j depends on up to 3 earlier ones
+        std::atomic<uint64_t> clock = 0;
+        uint32_t job_count = 1 + random.next_below(24);
+        std::vector<std::unique_ptr<TracedJob>> jobs = {};
+        for (uint32_t j = 0; j < job_count; ++j)
+        {
+            auto traced = std::make_unique<TracedJob>();
+            uint32_t tile_count = random.next_below(4) == 0 ? 0 : 1 + random.next_below(300);
+            traced->run_counts = std::vector<std::atomic<uint32_t>>(tile_count);
+            traced->starts = std::vector<std::atomic<uint64_t>>(tile_count);
+            traced->ends = std::vector<std::atomic<uint64_t>>(tile_count);
+
+            std::vector<TileJob> dependencies = {};
+            for (uint32_t d = 0; j > 0 && d < random.next_below(4); ++d)
+            {
+                uint32_t dependency = random.next_below(j);
+                traced->dependencies.push_back(dependency);
+                dependencies.push_back(jobs[dependency]->job);
+            }
+
+            // Some tiles wait on a nested run
+            bool nested = random.next_below(3) == 0;
+            TracedJob *state = traced.get();
+            traced->job = pool.submit(tile_count, [state, nested, &clock, &pool, &nested_check](uint32_t tile, uint32_t)
+                                      {
+                state->starts[tile] = ++clock;
+                state->run_counts[tile]++;
+                if (nested && tile % 7 == 0)
+                {
+                    std::atomic<uint32_t> inner = 0;
+                    pool.run(1 + tile % 13, [&](uint32_t, uint32_t)
+                             { inner++; });
+                    static std::mutex check_mutex;
+                    auto lock = std::lock_guard{check_mutex};
+                    nested_check.add(inner == 1 + tile % 13);
+                }
+                state->ends[tile] = ++clock; },
+                                      dependencies);
+            jobs.push_back(std::move(traced));
+        }
+
+        // Waiting on the last job only must not lose the others
+        pool.wait(jobs.back()->job);
+        for (auto const &traced : jobs)
+            pool.wait(traced->job);
+
+        for (auto const &traced : jobs)
+        {
+            once_check.add(traced->job.is_done() && std::all_of(traced->run_counts.begin(), traced->run_counts.end(), [](auto const &count)
+                                                                { return count == 1; }));
+
+            // First start of the job after every end of its dependencies, jobs without tiles forward theirs
+            uint64_t first_start = std::numeric_limits<uint64_t>::max();
+            for (auto const &start : traced->starts)
+                first_start = std::min<uint64_t>(first_start, start);
+            std::vector<uint32_t> stack = traced->dependencies;
+            uint64_t last_end = 0;
+            bool forwarded = false;
+            while (!stack.empty())
+            {
+                TracedJob const &dependency = *jobs[stack.back()];
+                stack.pop_back();
+                for (auto const &end : dependency.ends)
+                    last_end = std::max<uint64_t>(last_end, end);
+                if (dependency.ends.empty())
+                {
+                    forwarded = true;
+                    stack.insert(stack.end(), dependency.dependencies.begin(), dependency.dependencies.end());
+                }
+            }
+            if (!traced->starts.empty())
+                order_check.add(first_start > last_end);
+            if (forwarded && !traced->starts.empty())
+                empty_check.add(first_start > last_end);
+        }
+    }
+
+    // Morton orders of random grids, 2x2 blocks where the grid has them whole
+    for (uint32_t trial = 0; trial < std::min(trial_count, 64U); ++trial)
+    {
+        uint32_t tiles_x = 1 + random.next_below(40), tiles_y = 1 + random.next_below(40);
+        std::vector<uint32_t> order = get_morton_tile_order(tiles_x, tiles_y);
+        std::vector<uint32_t> sorted = order;
+        std::sort(sorted.begin(), sorted.end());
+        bool permutation = true;
+        for (uint32_t i = 0; i < sorted.size(); ++i)
+            permutation = permutation && sorted[i] == i;
+        morton_check.add(permutation);
+
+        uint32_t size = 1;
+        while (size * 2 <= std::min(tiles_x, tiles_y))
+            size *= 2;
+        std::vector<uint32_t> square = get_morton_tile_order(size, size);
+        bool blocks = true;
+        for (uint32_t i = 0; i + 3 < square.size(); i += 4)
+        {
+            uint32_t x = square[i] % size, y = square[i] / size;
+            blocks = blocks && x % 2 == 0 && y % 2 == 0 && square[i + 1] == square[i] + 1 && square[i + 2] == square[i] + size &&
+                     square[i + 3] == square[i] + size + 1;
+        }
+        morton_check.add(blocks);
+    }
+
+    {
+        HostScene scene = {};
+        build_yard(scene);
+        HostAccel accel = {};
+        TilePool one_thread(1);
+        accel.build(scene, one_thread);
+        ReferenceSettings settings = {};
+        settings.width = 48;
+        settings.height = 40;
+        settings.samples_per_pixel = 2;
+        settings.max_depth = 3;
+        settings.jitter = true;
+        settings.tile_size = 5;
+        HostCamera camera = frame_yard(scene, settings.width, settings.height);
+        std::vector<glm::vec3> expected = {};
+        ReferenceTracer(accel, settings).render(camera, one_thread, expected);
+        for (uint32_t thread_count : {2U, 7U, 16U})
+        {
+            TilePool pool(thread_count);
+            std::vector<glm::vec3> image = {};
+            ReferenceTracer(accel, settings).render(camera, pool, image);
+            render_check.add(std::memcmp(image.data(), expected.data(), image.size() * sizeof(glm::vec3)) == 0);
+        }
+    }
+
+    return report_checks<BenchCheck>({&once_check, &order_check, &nested_check, &empty_check, &morton_check, &render_check});
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static void write_json(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << "{\n";
+    out << "  \"hardware_threads\": " << result.hardware_thread_count << ",\n";
+    out << "  \"render\": {\"width\": " << settings.width << ", \"height\": " << settings.height << ", \"spp\": " << settings.samples_per_pixel
+        << ", \"primitives\": " << result.primitive_count << "},\n";
+    out << "  \"workloads\": [\n";
+    for (uint32_t workload = 0; workload < WORKLOAD_COUNT; ++workload)
+    {
+        auto const &points = result.points[workload];
+        out << "    {\"name\": \"" << WORKLOAD_NAMES[workload] << "\", \"points\": [";
+        for (size_t p = 0; p < points.size(); ++p)
+        {
+            out << (p == 0 ? "" : ", ") << "{\"threads\": " << points[p].thread_count << ", \"ms\": " << points[p].ms
+                << ", \"speedup\": " << points.front().ms / points[p].ms << ", \"steals\": " << points[p].steal_count << "}";
+        }
+        out << "]}" << (workload + 1 < WORKLOAD_COUNT ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, BenchResult const &result, BenchSettings const &settings)
+{
+    out << result.hardware_thread_count << " hardware threads, render " << settings.width << "x" << settings.height << " "
+        << settings.samples_per_pixel << " spp of " << result.primitive_count << " voxels" << std::endl;
+    for (uint32_t workload = 0; workload < WORKLOAD_COUNT; ++workload)
+    {
+        auto const &points = result.points[workload];
+        out << WORKLOAD_NAMES[workload];
+        if (workload == WORKLOAD_EMPTY_TILES)
+            out << " (" << EMPTY_TILE_COUNT << " tiles)";
+        else if (workload == WORKLOAD_SMALL_RUNS || workload == WORKLOAD_SPAWNED_RUNS)
+            out << " (" << SMALL_RUN_COUNT << " runs of " << SMALL_RUN_TILE_COUNT << " tiles)";
+        out << std::endl;
+        out << "  threads   ms          speedup     efficiency  steals" << std::endl;
+        for (auto const &point : points)
+        {
+            double speedup = points.front().ms / point.ms;
+            out << "  ";
+            write_cell(out, point.thread_count, 10);
+            for (double cell : {point.ms, speedup, speedup / point.thread_count})
+                write_cell(out, std::to_string(cell), 12);
+            out << point.steal_count << std::endl;
+        }
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t verify_count = 0;
+    BenchSettings settings = {};
+    std::filesystem::path json_path = {};
+
+    BenchArgs args(argc, argv, "[--verify N] [--max-threads N] [--width N] [--height N] [--spp N] [--repeat N] [--json out.json]");
+    while (args.next())
+    {
+        if (args.is("--verify"))
+            verify_count = args.get_uint(1);
+        else if (args.is("--max-threads"))
+            settings.max_thread_count = std::min(args.get_uint(1), 1024U);
+        else if (args.is("--width"))
+            settings.width = args.get_uint(1);
+        else if (args.is("--height"))
+            settings.height = args.get_uint(1);
+        else if (args.is("--spp"))
+            settings.samples_per_pixel = args.get_uint(1);
+        else if (args.is("--repeat"))
+            settings.repeat_count = args.get_uint(1);
+        else if (args.is("--json"))
+            json_path = args.get_string();
+        else
+            return args.usage();
+    }
+
+    if (verify_count > 0)
+        return verify(verify_count) ? 0 : 1;
+
+    BenchResult result = measure(settings);
+
+    if (!json_path.empty() && !write_json_file(json_path, [&](std::ostream &json)
+                                               { write_json(json, result, settings); }))
+        return 1;
+
+    write_table(std::cout, result, settings);
+
+    return 0;
+}
@@ -102,13 +102,11 @@ public:
         return task_graph;
     }
 
-    BRUSH_MNGR(daxa::Device& device, daxa::PipelineManager& pipeline_manager, daxa::ShaderCompileOptions slang_shader_compile_options,
+    // The pipeline of squared_brush.slang comes from load_pipelines() (pipeline manager, shader cache or shader pack)
+    BRUSH_MNGR(daxa::Device& device, std::shared_ptr<daxa::ComputePipeline> squared_brush_pipeline,
     BrushBufferInfo brush_buffer_info)
-        : device(device), pipeline_manager(pipeline_manager), _brush_buffer_info(brush_buffer_info)
+        : squared_brush_comp(squared_brush_pipeline), _brush_buffer_info(brush_buffer_info), device(device)
     {
-        auto brush_comp_pipeline_info = slang_shader_compile_options;
-        brush_comp_pipeline_info.entry_point = "entry_brush";
-
         _brush_config_buffer = device.create_buffer({
             .size = sizeof(BRUSH_CONFIG),
             .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
@@ -124,18 +122,6 @@ public:
 
         _brush_config_ptr->brush_pixel_size = daxa_u32vec3{50, 0, 0};
 
-        squared_brush_comp =
-            pipeline_manager.add_compute_pipeline(
-                                daxa::ComputePipelineCompileInfo{
-                                    .shader_info = daxa::ShaderCompileInfo{
-                                        .source = daxa::ShaderFile{"squared_brush.slang"},
-                                        .compile_options = brush_comp_pipeline_info,
-                                    },
-                                    .push_constant_size = sizeof(changes_push_constant),
-                                    .name = "brush shader",
-                                })
-                .value();
-
         squared_brush_task_graph = record_squared_brush_task_graph(
             _squared_brush_indirect_buffer,
             brush_buffer_info.status_buffer,
@@ -192,7 +178,6 @@ private:
     BrushBufferInfo _brush_buffer_info = {};
 
     daxa::Device& device;
-    daxa::PipelineManager& pipeline_manager;
 
     daxa::TaskGraph squared_brush_task_graph = {};
 };
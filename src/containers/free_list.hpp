@@ -188,59 +188,49 @@ public:
   template <typename... Args>
   bool deallocate(T data, Args... args)
   {
-    auto node = m_head;
-    while (node)
+    auto node = find(data);
+    if (node)
     {
-      if (node->data == data)
-      {
-#if TRACE
-        std::cout << "  *Deallocating node at offset " << node->offset << " with size " << node->size << std::endl;
+      release(node, args...);
+      return true;
+    }
+#if WARN
+    std::cout << "  *Failed to deallocate " << std::endl;
 #endif
-        m_allocator.deallocate(m_device, data, args...);
-        node->data = T();
+    return false;
+  }
 
-        // merge with the next node if possible
-        if (node->next && node->next->data == T())
-        {
-          node->size += node->next->size;
-          node->next = node->next->next;
-          if (node->next)
-          {
-            node->next->prev = node;
-          }
-#if TRACE
-          std::cout << "  *Merging node at offset " << node->offset << " with next node" << std::endl;
+  // Resize the range owned by data. The range stays in place if it is already big enough,
+  // otherwise the new range is allocated before releasing the old one so they never overlap.
+  template <typename... Args>
+  T reallocate(T data, size_t size, size_t &offset, size_t &previous_offset, Args... args)
+  {
+    auto node = find(data);
+    if (!node)
+    {
+#if WARN
+      std::cout << "  *Failed to reallocate " << size << " bytes" << std::endl;
 #endif
-        }
+      return T();
+    }
 
-        // merge with the previous node if possible
-        if (node->prev && node->prev->data == T())
-        {
-          node->prev->size += node->size;
-          node->prev->next = node->next;
-          if (node->next)
-          {
-            node->next->prev = node->prev;
-          }
-#if TRACE
-          std::cout << "  *Merging node at offset " << node->offset << " with previous node" << std::endl;
-#endif
-        }
+    previous_offset = node->offset;
 
+    if (node->size >= size)
+    {
+      offset = node->offset;
+      return node->data;
+    }
 
-#if TRACE
-        std::cout << "  *Deallocated " << std::endl;
-        m_allocator.print_id(data);
-        print();
-#endif
-        return true;
-      }
-      node = node->next;
+    T new_data = allocate(size, offset, args...);
+    if (new_data == T())
+    {
+      return T();
     }
-#if WARN
-    std::cout << "  *Failed to deallocate " << std::endl;
-#endif
-    return false;
+
+    release(node, args...);
+
+    return new_data;
   }
 
   void print()
@@ -270,6 +260,65 @@ private:
     std::shared_ptr<free_list_node> prev = nullptr; // previous node
   };
 
+  auto find(T data) -> std::shared_ptr<free_list_node>
+  {
+    auto node = m_head;
+    while (node)
+    {
+      if (node->data == data)
+      {
+        return node;
+      }
+      node = node->next;
+    }
+    return nullptr;
+  }
+
+  template <typename... Args>
+  void release(std::shared_ptr<free_list_node> node, Args... args)
+  {
+    T data = node->data;
+#if TRACE
+    std::cout << "  *Deallocating node at offset " << node->offset << " with size " << node->size << std::endl;
+#endif
+    m_allocator.deallocate(m_device, data, args...);
+    node->data = T();
+
+    // merge with the next node if possible
+    if (node->next && node->next->data == T())
+    {
+      node->size += node->next->size;
+      node->next = node->next->next;
+      if (node->next)
+      {
+        node->next->prev = node;
+      }
+#if TRACE
+      std::cout << "  *Merging node at offset " << node->offset << " with next node" << std::endl;
+#endif
+    }
+
+    // merge with the previous node if possible
+    if (node->prev && node->prev->data == T())
+    {
+      node->prev->size += node->size;
+      node->prev->next = node->next;
+      if (node->next)
+      {
+        node->next->prev = node->prev;
+      }
+#if TRACE
+      std::cout << "  *Merging node at offset " << node->offset << " with previous node" << std::endl;
+#endif
+    }
+
+#if TRACE
+    std::cout << "  *Deallocated " << std::endl;
+    m_allocator.print_id(data);
+    print();
+#endif
+  }
+
   std::shared_ptr<free_list_node> m_head;
   BufferId m_buffer;
   U m_allocator;
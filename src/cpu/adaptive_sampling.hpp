@@ -0,0 +1,204 @@
+#pragma once
+#include "defines.h"
+#include "reference_tracer.hpp"
+#include "tile_pool.hpp"
+
+// Host port of adaptive_sampling.glsl (same names with host_, same math) and a progressive renderer on the CPU reference
+// that runs the frames the way rgen.glsl does.
+// Every pixel keeps the running mean of its samples & of their squared luminance, its predicted relMSE is the variance
+// of the mean over (luminance^2 + ADAPTIVE_LUMINANCE_EPSILON), the relMSE of image_metrics.hpp. A tile sums the
+// predicted relMSE of its pixels in fixed point (atomicAdd on the GPU), and the next frame skips the pixels of the
+// tiles whose mean is below the threshold once they have ADAPTIVE_MIN_SAMPLES samples. A camera move (no accumulated
+// frames) samples every pixel again.
+// The sums go to slot frame % 3: frame f reads the slot of f - 1, writes its own and clears the one of f + 1.
+
+//////////////////////////////// ESTIMATOR //////////////////////////////////////
+
+inline float host_adaptive_get_luminance(glm::vec3 color)
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// Adds a sample to the running statistics, reset starts them over
+inline void host_adaptive_add_sample(ADAPTIVE_PIXEL &pixel, glm::vec3 color, bool reset)
+{
+    float luminance = host_adaptive_get_luminance(color);
+    if (reset || pixel.sample_count == 0)
+    {
+        pixel.mean = to_daxa(color);
+        pixel.luminance_moment = luminance * luminance;
+        pixel.sample_count = 1;
+        return;
+    }
+
+    pixel.sample_count++;
+    float weight = 1.0f / static_cast<float>(pixel.sample_count);
+    glm::vec3 mean = to_glm(pixel.mean);
+    pixel.mean = to_daxa(mean + (color - mean) * weight);
+    pixel.luminance_moment += (luminance * luminance - pixel.luminance_moment) * weight;
+}
+
+// Predicted relMSE of the mean, 1 (the clamp) while there are fewer than 2 samples
+inline float host_adaptive_get_pixel_error(ADAPTIVE_PIXEL const &pixel)
+{
+    if (pixel.sample_count < 2)
+        return 1.0f;
+
+    float n = static_cast<float>(pixel.sample_count);
+    float mean_luminance = host_adaptive_get_luminance(to_glm(pixel.mean));
+    float variance = std::max(pixel.luminance_moment - mean_luminance * mean_luminance, 0.0f) * n / (n - 1.0f);
+    return std::min(variance / n / (mean_luminance * mean_luminance + ADAPTIVE_LUMINANCE_EPSILON), 1.0f);
+}
+
+inline uint32_t host_adaptive_get_error_bits(float error)
+{
+    return static_cast<uint32_t>(std::clamp(error, 0.0f, 1.0f) * ADAPTIVE_ERROR_SCALE);
+}
+
+//////////////////////////////// TILES //////////////////////////////////////
+
+inline uint32_t host_adaptive_get_tile_index(uint32_t x, uint32_t y, uint32_t width)
+{
+    uint32_t tiles_x = (width + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE;
+    return (y / ADAPTIVE_TILE_SIZE) * tiles_x + x / ADAPTIVE_TILE_SIZE;
+}
+
+// Pixels of the tile of (x, y), border tiles are cut by the image
+inline uint32_t host_adaptive_get_tile_pixel_count(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    uint32_t x0 = x - x % ADAPTIVE_TILE_SIZE, y0 = y - y % ADAPTIVE_TILE_SIZE;
+    return std::min<uint32_t>(ADAPTIVE_TILE_SIZE, width - x0) * std::min<uint32_t>(ADAPTIVE_TILE_SIZE, height - y0);
+}
+
+inline float host_adaptive_get_tile_error(uint32_t error_sum, uint32_t pixel_count)
+{
+    return static_cast<float>(error_sum) / (ADAPTIVE_ERROR_SCALE * static_cast<float>(pixel_count));
+}
+
+// Whether a pixel takes a sample this frame, from its sample count & the error of its tile at the previous frame
+inline bool host_adaptive_is_pixel_active(uint32_t sample_count, float tile_error, uint64_t num_accumulated_frames,
+                                          uint32_t min_samples = ADAPTIVE_MIN_SAMPLES, float error_threshold = ADAPTIVE_ERROR_THRESHOLD)
+{
+    return num_accumulated_frames == 0 || sample_count < min_samples || tile_error > error_threshold;
+}
+
+//////////////////////////////// RENDERER //////////////////////////////////////
+
+struct AdaptiveSettings
+{
+    uint32_t min_samples = ADAPTIVE_MIN_SAMPLES;
+    float error_threshold = ADAPTIVE_ERROR_THRESHOLD;
+    // false samples every pixel every frame with the same accumulation, the baseline
+    bool adaptive = true;
+};
+
+struct AdaptiveFrameStats
+{
+    uint32_t active_pixel_count = 0;
+    uint64_t ray_count = 0;
+    uint32_t converged_tile_count = 0; // tiles whose pixels all skip the next frame
+};
+
+// Frames of one sample per active pixel, the seeds of frame f are the ones of sample f of the tracer
+struct AdaptiveRenderer
+{
+public:
+    AdaptiveRenderer(ReferenceTracer const &tracer, AdaptiveSettings const &settings = {})
+        : tracer(tracer), settings(settings), width(tracer.get_settings().width), height(tracer.get_settings().height)
+    {
+        tiles_x = (width + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE;
+        tiles_y = (height + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE;
+        pixels.assign(static_cast<size_t>(width) * height, ADAPTIVE_PIXEL{});
+        tiles.assign(static_cast<size_t>(tiles_x) * tiles_y, ADAPTIVE_TILE{});
+    }
+
+    // Camera moved, the next frame samples every pixel & starts their statistics over
+    void reset() { num_accumulated_frames = 0; }
+
+    auto frame(HostCamera const &camera, TilePool &pool) -> AdaptiveFrameStats
+    {
+        uint32_t read_slot = (frame_number + ADAPTIVE_ERROR_SLOTS - 1) % ADAPTIVE_ERROR_SLOTS;
+        uint32_t write_slot = frame_number % ADAPTIVE_ERROR_SLOTS;
+        uint32_t clear_slot = (frame_number + 1) % ADAPTIVE_ERROR_SLOTS;
+
+        std::atomic<uint32_t> active_pixel_count = 0, converged_tile_count = 0;
+        std::atomic<uint64_t> ray_count = 0;
+
+        // A tile is a job, its pixels are summed in order so the sums don't depend on the thread count
+        pool.run(static_cast<uint32_t>(tiles.size()), [&](uint32_t tile_index, uint32_t)
+                 {
+            ADAPTIVE_TILE &tile = tiles[tile_index];
+            uint32_t x0 = (tile_index % tiles_x) * ADAPTIVE_TILE_SIZE;
+            uint32_t y0 = (tile_index / tiles_x) * ADAPTIVE_TILE_SIZE;
+            uint32_t x1 = std::min<uint32_t>(x0 + ADAPTIVE_TILE_SIZE, width), y1 = std::min<uint32_t>(y0 + ADAPTIVE_TILE_SIZE, height);
+            float tile_error = host_adaptive_get_tile_error(tile.error_sums[read_slot], host_adaptive_get_tile_pixel_count(x0, y0, width, height));
+
+            tile.error_sums[clear_slot] = 0;
+            uint32_t error_sum = 0, tile_active_pixels = 0;
+            uint64_t tile_rays = 0;
+            for (uint32_t y = y0; y < y1; ++y)
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    ADAPTIVE_PIXEL &pixel = pixels[static_cast<size_t>(y) * width + x];
+                    if (!settings.adaptive || host_adaptive_is_pixel_active(pixel.sample_count, tile_error, num_accumulated_frames,
+                                                                             settings.min_samples, settings.error_threshold))
+                    {
+                        glm::vec3 color = tracer.trace_sample(x, y, frame_number, camera, tile_rays);
+                        host_adaptive_add_sample(pixel, color, num_accumulated_frames == 0);
+                        ++tile_active_pixels;
+                    }
+                    error_sum += host_adaptive_get_error_bits(host_adaptive_get_pixel_error(pixel));
+                }
+            tile.error_sums[write_slot] = error_sum;
+
+            // Converged for the next frame once every pixel has its minimum
+            float next_error = host_adaptive_get_tile_error(error_sum, (x1 - x0) * (y1 - y0));
+            ADAPTIVE_PIXEL const &first = pixels[static_cast<size_t>(y0) * width + x0];
+            if (!host_adaptive_is_pixel_active(first.sample_count, next_error, 1, settings.min_samples, settings.error_threshold))
+                ++converged_tile_count;
+
+            active_pixel_count += tile_active_pixels;
+            ray_count += tile_rays; });
+
+        ++frame_number;
+        ++num_accumulated_frames;
+        return AdaptiveFrameStats{
+            .active_pixel_count = active_pixel_count,
+            .ray_count = ray_count,
+            .converged_tile_count = converged_tile_count,
+        };
+    }
+
+    // Linear RGB, row major, top row first
+    void get_image(std::vector<glm::vec3> &image) const
+    {
+        image.resize(pixels.size());
+        for (size_t i = 0; i < pixels.size(); ++i)
+            image[i] = to_glm(pixels[i].mean);
+    }
+
+    // Predicted relMSE of every pixel
+    void get_error_image(std::vector<float> &errors) const
+    {
+        errors.resize(pixels.size());
+        for (size_t i = 0; i < pixels.size(); ++i)
+            errors[i] = host_adaptive_get_pixel_error(pixels[i]);
+    }
+
+    auto get_pixels() const -> std::vector<ADAPTIVE_PIXEL> const & { return pixels; }
+    auto get_tiles() const -> std::vector<ADAPTIVE_TILE> const & { return tiles; }
+    auto get_tile_count() const -> uint32_t { return static_cast<uint32_t>(tiles.size()); }
+    auto get_frame_number() const -> uint32_t { return frame_number; }
+
+private:
+    ReferenceTracer const &tracer;
+    AdaptiveSettings settings = {};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t tiles_x = 0;
+    uint32_t tiles_y = 0;
+    std::vector<ADAPTIVE_PIXEL> pixels = {};
+    std::vector<ADAPTIVE_TILE> tiles = {};
+    uint32_t frame_number = 0;
+    uint64_t num_accumulated_frames = 0;
+};
@@ -0,0 +1,210 @@
+#pragma once
+#include "defines.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+// Host port of the ray-box intersection of the shaders (intersect.glsl ourIntersectBoxCommon & primitives.glsl intersect_box).
+// Kept operation by operation so a hit on the CPU is the same hit the GPU reports.
+// box_intersect_x8.hpp is the 8 wide version, both must stay in sync.
+// Credits: https://jcgt.org/published/0007/03/04/
+
+struct HostRay
+{
+    glm::vec3 origin = {0.0f, 0.0f, 0.0f};
+    glm::vec3 direction = {0.0f, 0.0f, -1.0f};
+};
+
+struct HostBox
+{
+    glm::vec3 center = {0.0f, 0.0f, 0.0f};
+    glm::vec3 radius = {0.0f, 0.0f, 0.0f};
+    glm::vec3 inv_radius = {0.0f, 0.0f, 0.0f};
+    glm::mat3 rotation = glm::mat3(1.0f);
+};
+
+inline float safe_inverse(float x) { return (x == 0.0f) ? 1e12f : (1.0f / x); }
+inline glm::vec3 safe_inverse(glm::vec3 v) { return glm::vec3(safe_inverse(v.x), safe_inverse(v.y), safe_inverse(v.z)); }
+
+// Host port of ourIntersectBoxCommon (intersect.glsl).
+// ray_can_start_in_box: if false, assume the origin is never in a box
+// ray_can_second_hit: also compute the distance to the exit plane (the entry distance if the origin is inside)
+// get_uv: face coordinates of the hit, same (radius.xy based) mapping as the shader
+// oriented: if false, ignore box.rotation for the direction and use inv_ray_direction
+// Outputs the shader leaves undefined are zero on entry so every implementation agrees on them.
+inline bool intersect_box_common(HostBox const &box, HostRay ray, float &distance, float &exit_distance, glm::vec3 &normal,
+                                 bool const ray_can_start_in_box, bool const ray_can_second_hit, bool const get_uv,
+                                 bool const oriented, glm::vec3 const &inv_ray_direction, glm::vec2 &uv)
+{
+    exit_distance = 0.0f;
+    uv = glm::vec2(0.0f);
+
+    // Move to the box's reference frame
+    ray.origin = box.rotation * (ray.origin - box.center);
+    if (oriented)
+        ray.direction = ray.direction * box.rotation;
+
+    // Winding direction: -1 if the ray starts inside of the box (i.e., and is leaving), +1 if it is starting outside of the box
+    float winding = 1.0f;
+    if (ray_can_start_in_box)
+    {
+        glm::vec3 ray_box = glm::abs(ray.origin) * box.inv_radius;
+        winding = (std::max(ray_box.x, std::max(ray_box.y, ray_box.z)) < 1.0f) ? -1.0f : 1.0f;
+    }
+
+    glm::vec3 sgn = -glm::sign(ray.direction);
+
+    // Ray-plane intersection. For each pair of planes, choose the one that is front-facing to the ray
+    glm::vec3 distance_to_plane = box.radius * winding * sgn - ray.origin;
+    if (oriented)
+        distance_to_plane /= ray.direction;
+    else
+        distance_to_plane *= inv_ray_direction;
+
+    // TEST: is there a hit on this axis in front of the origin and is that hit within the face of the box?
+    auto test = [&](int u, int v, int w) -> bool
+    {
+        return (distance_to_plane[u] >= 0.0f) &&
+               (std::abs(ray.origin[v] + ray.direction[v] * distance_to_plane[u]) < box.radius[v]) &&
+               (std::abs(ray.origin[w] + ray.direction[w] * distance_to_plane[u]) < box.radius[w]);
+    };
+
+    bool test_x = test(0, 1, 2);
+    bool test_y = test(1, 2, 0);
+    bool test_z = test(2, 0, 1);
+
+    // CMOV chain that guarantees exactly one element of sgn is preserved and that the value has the right sign
+    sgn = test_x ? glm::vec3(sgn.x, 0.0f, 0.0f) : (test_y ? glm::vec3(0.0f, sgn.y, 0.0f) : glm::vec3(0.0f, 0.0f, test_z ? sgn.z : 0.0f));
+
+    // Mask the distance by the non-zero axis
+    distance = (sgn.x != 0.0f) ? distance_to_plane.x : ((sgn.y != 0.0f) ? distance_to_plane.y : distance_to_plane.z);
+
+    if (get_uv)
+    {
+        glm::vec3 hit_point = ray.origin + distance * ray.direction;
+        glm::vec2 radius_xy = glm::vec2(box.radius.x, box.radius.y);
+        if (sgn.x != 0.0f)
+            uv = glm::vec2(hit_point.z, hit_point.y) + radius_xy;
+        else if (sgn.y != 0.0f)
+            uv = glm::vec2(hit_point.x, hit_point.z) + radius_xy;
+        else if (sgn.z != 0.0f)
+            uv = glm::vec2(hit_point.x, hit_point.y) + radius_xy;
+        uv = uv / (radius_xy * 2.0f);
+    }
+
+    if (ray_can_second_hit)
+    {
+        // Starting outside of the box: distance to the exit plane from the entry point
+        if (winding == 1.0f)
+        {
+            ray.origin += distance * ray.direction;
+
+            glm::vec3 exit_sgn = glm::sign(ray.direction);
+
+            distance_to_plane = box.radius * exit_sgn - ray.origin;
+            if (oriented)
+                distance_to_plane /= ray.direction;
+            else
+                distance_to_plane *= inv_ray_direction;
+
+            test_x = test(0, 1, 2);
+            test_y = test(1, 2, 0);
+            test_z = test(2, 0, 1);
+
+            exit_sgn = test_x ? glm::vec3(exit_sgn.x, 0.0f, 0.0f) : (test_y ? glm::vec3(0.0f, exit_sgn.y, 0.0f) : glm::vec3(0.0f, 0.0f, test_z ? exit_sgn.z : 0.0f));
+
+            exit_distance = (exit_sgn.x != 0.0f) ? distance_to_plane.x : ((exit_sgn.y != 0.0f) ? distance_to_plane.y : distance_to_plane.z);
+            exit_distance += distance;
+        }
+        else
+        {
+            // Starting inside of the box, the hit already is the exit
+            exit_distance = distance;
+        }
+    }
+
+    // Normal faces back along the ray
+    normal = oriented ? box.rotation * sgn : sgn;
+
+    return (sgn.x != 0.0f) || (sgn.y != 0.0f) || (sgn.z != 0.0f);
+}
+
+// primitives.glsl intersect_box: ourIntersectBoxCommon without exit distance & UV
+inline bool intersect_box(HostBox const &box, HostRay const &ray, float &distance, glm::vec3 &normal,
+                          bool const ray_can_start_in_box, bool const oriented, glm::vec3 const &inv_ray_direction)
+{
+    float exit_distance = 0.0f;
+    glm::vec2 uv = {};
+    return intersect_box_common(box, ray, distance, exit_distance, normal, ray_can_start_in_box, false, false, oriented, inv_ray_direction, uv);
+}
+
+// ourIntersectBoxTwoHits
+inline bool intersect_box_two_hits(HostBox const &box, HostRay const &ray, float &distance, float &exit_distance, glm::vec3 &normal,
+                                   bool const oriented, glm::vec3 const &inv_ray_direction)
+{
+    glm::vec2 uv = {};
+    return intersect_box_common(box, ray, distance, exit_distance, normal, true, true, false, oriented, inv_ray_direction, uv);
+}
+
+// ourIntersectBoxTwoHitsAndUV
+inline bool intersect_box_two_hits_and_uv(HostBox const &box, HostRay const &ray, float &distance, float &exit_distance, glm::vec3 &normal,
+                                          bool const oriented, glm::vec3 const &inv_ray_direction, glm::vec2 &uv)
+{
+    return intersect_box_common(box, ray, distance, exit_distance, normal, true, true, true, oriented, inv_ray_direction, uv);
+}
+
+// ourHitAABox: does the ray hit the axis aligned box or start inside of it (BVH node test)
+// inv_ray_direction must be finite for all elements (safe_inverse)
+inline bool hit_aa_box(glm::vec3 const &box_center, glm::vec3 const &box_radius, glm::vec3 ray_origin,
+                       glm::vec3 const &ray_direction, glm::vec3 const &inv_ray_direction)
+{
+    ray_origin -= box_center;
+    glm::vec3 distance_to_plane = (-box_radius * glm::sign(ray_direction) - ray_origin) * inv_ray_direction;
+
+    auto test = [&](int u, int v, int w) -> bool
+    {
+        return (distance_to_plane[u] >= 0.0f) &&
+               (std::abs(ray_origin[v] + ray_direction[v] * distance_to_plane[u]) < box_radius[v]) &&
+               (std::abs(ray_origin[w] + ray_direction[w] * distance_to_plane[u]) < box_radius[w]);
+    };
+
+    bool inside = (std::abs(ray_origin.x) < box_radius.x) && (std::abs(ray_origin.y) < box_radius.y) && (std::abs(ray_origin.z) < box_radius.z);
+    return inside || test(0, 1, 2) || test(1, 2, 0) || test(2, 0, 1);
+}
+
+// Same box the intersection shader builds for a primitive (rint.glsl): voxel sized unless boxes are merged
+inline HostBox get_primitive_box(AABB const &aabb)
+{
+    glm::vec3 minimum = {aabb.minimum.x, aabb.minimum.y, aabb.minimum.z};
+    glm::vec3 maximum = {aabb.maximum.x, aabb.maximum.y, aabb.maximum.z};
+#if MERGED_BOXES_ON == 1
+    // Merged boxes span several voxels
+    glm::vec3 half_extent = (maximum - minimum) * 0.5f;
+#else
+    glm::vec3 half_extent = glm::vec3(HALF_VOXEL_EXTENT);
+#endif // MERGED_BOXES_ON
+    return HostBox{
+        .center = (minimum + maximum) * 0.5f,
+        .radius = half_extent,
+        .inv_radius = safe_inverse(half_extent),
+        .rotation = glm::mat3(1.0f),
+    };
+}
+
+// Wächter & Binder offset along the normal to avoid self intersections (primitives.glsl compute_ray_origin)
+inline glm::vec3 compute_ray_origin(glm::vec3 pos, glm::vec3 normal)
+{
+    constexpr float origin = 1.0f / 32.0f;
+    constexpr float f_scale = 1.0f / 65536.0f;
+    constexpr float i_scale = 256.0f;
+
+    glm::vec3 f_pos = {};
+    for (int i = 0; i < 3; ++i)
+    {
+        int32_t i_off = static_cast<int32_t>(normal[i] * i_scale);
+        float i_pos = std::bit_cast<float>(std::bit_cast<int32_t>(pos[i]) + (pos[i] < 0.0f ? -i_off : i_off));
+        f_pos[i] = std::abs(pos[i]) < origin ? pos[i] + normal[i] * f_scale : i_pos;
+    }
+    return f_pos;
+}
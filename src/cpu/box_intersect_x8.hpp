@@ -0,0 +1,420 @@
+#pragma once
+#include "defines.h"
+#include "box_intersect.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BOX_INTERSECT_AVX2_ON 1
+#else
+#define BOX_INTERSECT_AVX2_ON 0
+#endif // __AVX2__
+
+// 8 wide version of the shader ray-box intersections (box_intersect.hpp):
+// 8 rays against 1 box (packets: picking, brush previews) and 1 ray against 8 boxes (voxel runs, wide BVH nodes).
+// Every lane runs the operations of intersect_box_common in the same order with the same comparisons,
+// so a lane gives the same bits as the scalar port. Build with contraction off (-ffp-contract=off),
+// a fused multiply-add would round differently than the scalar code.
+// Without AVX2 the lanes are plain loops, same results, no speed up.
+
+//////////////////////////////// LANES //////////////////////////////////////
+
+#define BOX_LANE_COUNT 8
+
+struct f32x8
+{
+#if BOX_INTERSECT_AVX2_ON == 1
+    __m256 v;
+#else
+    std::array<float, BOX_LANE_COUNT> v;
+#endif // BOX_INTERSECT_AVX2_ON
+};
+
+// Comparison results are lanes with all bits set or cleared
+using mask_x8 = f32x8;
+
+#if BOX_INTERSECT_AVX2_ON == 1
+
+inline f32x8 f32x8_set(float a) { return {_mm256_set1_ps(a)}; }
+inline f32x8 f32x8_load(float const *a) { return {_mm256_load_ps(a)}; }
+inline void f32x8_store(float *a, f32x8 x) { _mm256_store_ps(a, x.v); }
+// Any alignment (image rows)
+inline f32x8 f32x8_loadu(float const *a) { return {_mm256_loadu_ps(a)}; }
+inline void f32x8_storeu(float *a, f32x8 x) { _mm256_storeu_ps(a, x.v); }
+
+inline f32x8 operator+(f32x8 a, f32x8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline f32x8 operator-(f32x8 a, f32x8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline f32x8 operator*(f32x8 a, f32x8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline f32x8 operator/(f32x8 a, f32x8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline f32x8 operator-(f32x8 a) { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))}; }
+inline f32x8 f32x8_abs(f32x8 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+
+// Ordered comparisons like the C++ operators, != is unordered (true for NaN)
+inline mask_x8 operator<(f32x8 a, f32x8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline mask_x8 operator>(f32x8 a, f32x8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline mask_x8 operator>=(f32x8 a, f32x8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+inline mask_x8 operator==(f32x8 a, f32x8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+inline mask_x8 operator!=(f32x8 a, f32x8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ)}; }
+
+inline mask_x8 operator&(mask_x8 a, mask_x8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline mask_x8 operator|(mask_x8 a, mask_x8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline mask_x8 operator~(mask_x8 a) { return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))}; }
+
+// mask ? a : b
+inline f32x8 f32x8_select(mask_x8 mask, f32x8 a, f32x8 b) { return {_mm256_blendv_ps(b.v, a.v, mask.v)}; }
+inline uint32_t mask_x8_bits(mask_x8 mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask.v)); }
+
+#else
+
+inline f32x8 f32x8_set(float a)
+{
+    f32x8 r;
+    r.v.fill(a);
+    return r;
+}
+inline f32x8 f32x8_load(float const *a)
+{
+    f32x8 r;
+    std::memcpy(r.v.data(), a, sizeof(r.v));
+    return r;
+}
+inline void f32x8_store(float *a, f32x8 x) { std::memcpy(a, x.v.data(), sizeof(x.v)); }
+inline f32x8 f32x8_loadu(float const *a) { return f32x8_load(a); }
+inline void f32x8_storeu(float *a, f32x8 x) { f32x8_store(a, x); }
+
+template <typename Op>
+inline f32x8 f32x8_map(f32x8 a, f32x8 b, Op &&op)
+{
+    f32x8 r;
+    for (uint32_t i = 0; i < BOX_LANE_COUNT; ++i)
+        r.v[i] = op(a.v[i], b.v[i]);
+    return r;
+}
+
+inline float mask_lane(bool b) { return std::bit_cast<float>(b ? 0xFFFFFFFFu : 0u); }
+inline bool lane_set(float a) { return std::bit_cast<uint32_t>(a) != 0u; }
+
+inline f32x8 operator+(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return x + y; }); }
+inline f32x8 operator-(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return x - y; }); }
+inline f32x8 operator*(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return x * y; }); }
+inline f32x8 operator/(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return x / y; }); }
+inline f32x8 operator-(f32x8 a) { return f32x8_map(a, a, [](float x, float) { return -x; }); }
+inline f32x8 f32x8_abs(f32x8 a) { return f32x8_map(a, a, [](float x, float) { return std::abs(x); }); }
+
+inline mask_x8 operator<(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(x < y); }); }
+inline mask_x8 operator>(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(x > y); }); }
+inline mask_x8 operator>=(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(x >= y); }); }
+inline mask_x8 operator==(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(x == y); }); }
+inline mask_x8 operator!=(f32x8 a, f32x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(x != y); }); }
+
+inline mask_x8 operator&(mask_x8 a, mask_x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(lane_set(x) && lane_set(y)); }); }
+inline mask_x8 operator|(mask_x8 a, mask_x8 b) { return f32x8_map(a, b, [](float x, float y) { return mask_lane(lane_set(x) || lane_set(y)); }); }
+inline mask_x8 operator~(mask_x8 a) { return f32x8_map(a, a, [](float x, float) { return mask_lane(!lane_set(x)); }); }
+
+inline f32x8 f32x8_select(mask_x8 mask, f32x8 a, f32x8 b)
+{
+    f32x8 r;
+    for (uint32_t i = 0; i < BOX_LANE_COUNT; ++i)
+        r.v[i] = lane_set(mask.v[i]) ? a.v[i] : b.v[i];
+    return r;
+}
+inline uint32_t mask_x8_bits(mask_x8 mask)
+{
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < BOX_LANE_COUNT; ++i)
+        bits |= lane_set(mask.v[i]) ? (1u << i) : 0u;
+    return bits;
+}
+
+#endif // BOX_INTERSECT_AVX2_ON
+
+// std::max(a, b) keeps a unless a < b
+inline f32x8 f32x8_max(f32x8 a, f32x8 b) { return f32x8_select(a < b, b, a); }
+
+// glm::sign: (0 < x) - (x < 0), +0 for zeros
+inline f32x8 f32x8_sign(f32x8 a)
+{
+    f32x8 zero = f32x8_set(0.0f);
+    f32x8 one = f32x8_set(1.0f);
+    return f32x8_select(zero < a, one, zero) - f32x8_select(a < zero, one, zero);
+}
+
+struct vec3x8
+{
+    f32x8 x, y, z;
+
+    f32x8 &operator[](int i) { return i == 0 ? x : (i == 1 ? y : z); }
+    f32x8 const &operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+};
+
+inline vec3x8 vec3x8_set(glm::vec3 const &a) { return {f32x8_set(a.x), f32x8_set(a.y), f32x8_set(a.z)}; }
+inline vec3x8 vec3x8_load(float const (&a)[3][BOX_LANE_COUNT]) { return {f32x8_load(a[0]), f32x8_load(a[1]), f32x8_load(a[2])}; }
+
+inline vec3x8 operator+(vec3x8 const &a, vec3x8 const &b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline vec3x8 operator-(vec3x8 const &a, vec3x8 const &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline vec3x8 operator*(vec3x8 const &a, vec3x8 const &b) { return {a.x * b.x, a.y * b.y, a.z * b.z}; }
+inline vec3x8 operator/(vec3x8 const &a, vec3x8 const &b) { return {a.x / b.x, a.y / b.y, a.z / b.z}; }
+inline vec3x8 operator*(vec3x8 const &a, f32x8 b) { return {a.x * b, a.y * b, a.z * b}; }
+inline vec3x8 operator*(f32x8 a, vec3x8 const &b) { return {a * b.x, a * b.y, a * b.z}; }
+inline vec3x8 operator-(vec3x8 const &a) { return {-a.x, -a.y, -a.z}; }
+inline vec3x8 vec3x8_abs(vec3x8 const &a) { return {f32x8_abs(a.x), f32x8_abs(a.y), f32x8_abs(a.z)}; }
+inline vec3x8 vec3x8_sign(vec3x8 const &a) { return {f32x8_sign(a.x), f32x8_sign(a.y), f32x8_sign(a.z)}; }
+
+// Column major like glm::mat3
+struct mat3x8
+{
+    vec3x8 columns[3];
+};
+
+inline mat3x8 mat3x8_set(glm::mat3 const &m) { return {{vec3x8_set(m[0]), vec3x8_set(m[1]), vec3x8_set(m[2])}}; }
+
+// glm: m * v = m[0] * v.x + m[1] * v.y + m[2] * v.z
+inline vec3x8 operator*(mat3x8 const &m, vec3x8 const &v)
+{
+    return m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z;
+}
+
+// glm: v * m = (dot(v, m[0]), dot(v, m[1]), dot(v, m[2])), dot summing x, y then z
+inline vec3x8 operator*(vec3x8 const &v, mat3x8 const &m)
+{
+    vec3x8 r;
+    for (int i = 0; i < 3; ++i)
+    {
+        vec3x8 t = v * m.columns[i];
+        r[i] = t.x + t.y + t.z;
+    }
+    return r;
+}
+
+//////////////////////////////// PACKETS //////////////////////////////////////
+
+// Structure of arrays, lane i of every array belongs to the same ray / box
+struct RayPacket8
+{
+    alignas(32) float origin[3][BOX_LANE_COUNT] = {};
+    alignas(32) float direction[3][BOX_LANE_COUNT] = {};
+    alignas(32) float inv_direction[3][BOX_LANE_COUNT] = {};
+
+    void set(uint32_t lane, HostRay const &ray, glm::vec3 const &inv_ray_direction)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            origin[i][lane] = ray.origin[i];
+            direction[i][lane] = ray.direction[i];
+            inv_direction[i][lane] = inv_ray_direction[i];
+        }
+    }
+};
+
+struct BoxPacket8
+{
+    alignas(32) float center[3][BOX_LANE_COUNT] = {};
+    alignas(32) float radius[3][BOX_LANE_COUNT] = {};
+    alignas(32) float inv_radius[3][BOX_LANE_COUNT] = {};
+    alignas(32) float rotation[3][3][BOX_LANE_COUNT] = {}; // [column][row][lane]
+
+    void set(uint32_t lane, HostBox const &box)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            center[i][lane] = box.center[i];
+            radius[i][lane] = box.radius[i];
+            inv_radius[i][lane] = box.inv_radius[i];
+            for (int j = 0; j < 3; ++j)
+                rotation[i][j][lane] = box.rotation[i][j];
+        }
+    }
+
+    // Empty lane: zero radius boxes are never hit
+    void clear(uint32_t lane)
+    {
+        set(lane, HostBox{.inv_radius = glm::vec3(safe_inverse(0.0f))});
+    }
+
+    // Primitive boxes of a run of AABBs, lanes past count are cleared
+    void load_aabbs(AABB const *aabbs, uint32_t count)
+    {
+        for (uint32_t lane = 0; lane < BOX_LANE_COUNT; ++lane)
+        {
+            if (lane < count)
+                set(lane, get_primitive_box(aabbs[lane]));
+            else
+                clear(lane);
+        }
+    }
+};
+
+// Results of the lanes, only meaningful where the bit of mask is set
+struct BoxHit8
+{
+    alignas(32) float distance[BOX_LANE_COUNT] = {};
+    alignas(32) float exit_distance[BOX_LANE_COUNT] = {};
+    alignas(32) float normal[3][BOX_LANE_COUNT] = {};
+    alignas(32) float uv[2][BOX_LANE_COUNT] = {};
+    uint32_t mask = 0;
+};
+
+//////////////////////////////// KERNELS //////////////////////////////////////
+
+// intersect_box_common on 8 lanes, see box_intersect.hpp for the meaning of the flags
+template <bool RAY_CAN_START_IN_BOX, bool RAY_CAN_SECOND_HIT, bool GET_UV, bool ORIENTED>
+inline uint32_t intersect_box_lanes(vec3x8 const &center, vec3x8 const &radius, vec3x8 const &inv_radius, mat3x8 const &rotation,
+                                    vec3x8 origin, vec3x8 direction, vec3x8 const &inv_direction, BoxHit8 &hits)
+{
+    f32x8 const zero = f32x8_set(0.0f);
+    f32x8 const one = f32x8_set(1.0f);
+
+    // Move to the box's reference frame
+    origin = rotation * (origin - center);
+    if constexpr (ORIENTED)
+        direction = direction * rotation;
+
+    f32x8 winding = one;
+    if constexpr (RAY_CAN_START_IN_BOX)
+    {
+        vec3x8 ray_box = vec3x8_abs(origin) * inv_radius;
+        winding = f32x8_select(f32x8_max(ray_box.x, f32x8_max(ray_box.y, ray_box.z)) < one, f32x8_set(-1.0f), one);
+    }
+
+    vec3x8 sgn = -vec3x8_sign(direction);
+
+    vec3x8 distance_to_plane = radius * winding * sgn - origin;
+    if constexpr (ORIENTED)
+        distance_to_plane = distance_to_plane / direction;
+    else
+        distance_to_plane = distance_to_plane * inv_direction;
+
+    auto test = [&](int u, int v, int w) -> mask_x8
+    {
+        return (distance_to_plane[u] >= zero) &
+               (f32x8_abs(origin[v] + direction[v] * distance_to_plane[u]) < radius[v]) &
+               (f32x8_abs(origin[w] + direction[w] * distance_to_plane[u]) < radius[w]);
+    };
+
+    // CMOV chain, exactly one element of sgn survives
+    auto keep_one = [&](vec3x8 const &s, mask_x8 test_x, mask_x8 test_y, mask_x8 test_z) -> vec3x8
+    {
+        mask_x8 keep_y = ~test_x & test_y;
+        mask_x8 keep_z = ~test_x & ~test_y & test_z;
+        return {f32x8_select(test_x, s.x, zero), f32x8_select(keep_y, s.y, zero), f32x8_select(keep_z, s.z, zero)};
+    };
+
+    auto mask_distance = [&](vec3x8 const &s) -> f32x8
+    {
+        return f32x8_select(s.x != zero, distance_to_plane.x, f32x8_select(s.y != zero, distance_to_plane.y, distance_to_plane.z));
+    };
+
+    sgn = keep_one(sgn, test(0, 1, 2), test(1, 2, 0), test(2, 0, 1));
+    f32x8 distance = mask_distance(sgn);
+    f32x8_store(hits.distance, distance);
+
+    mask_x8 hit_x = sgn.x != zero;
+    mask_x8 hit_y = sgn.y != zero;
+    mask_x8 hit_z = sgn.z != zero;
+
+    if constexpr (GET_UV)
+    {
+        vec3x8 hit_point = origin + distance * direction;
+        f32x8 u = f32x8_select(hit_x, hit_point.z, f32x8_select(hit_y, hit_point.x, f32x8_select(hit_z, hit_point.x, zero)));
+        f32x8 v = f32x8_select(hit_x, hit_point.y, f32x8_select(hit_y, hit_point.z, f32x8_select(hit_z, hit_point.y, zero)));
+        mask_x8 any = hit_x | hit_y | hit_z;
+        u = f32x8_select(any, u + radius.x, zero);
+        v = f32x8_select(any, v + radius.y, zero);
+        f32x8 const two = f32x8_set(2.0f);
+        f32x8_store(hits.uv[0], u / (radius.x * two));
+        f32x8_store(hits.uv[1], v / (radius.y * two));
+    }
+    else
+    {
+        f32x8_store(hits.uv[0], zero);
+        f32x8_store(hits.uv[1], zero);
+    }
+
+    if constexpr (RAY_CAN_SECOND_HIT)
+    {
+        // Lanes starting outside of the box continue from the entry point to the exit plane
+        origin = origin + distance * direction;
+
+        vec3x8 exit_sgn = vec3x8_sign(direction);
+
+        distance_to_plane = radius * exit_sgn - origin;
+        if constexpr (ORIENTED)
+            distance_to_plane = distance_to_plane / direction;
+        else
+            distance_to_plane = distance_to_plane * inv_direction;
+
+        exit_sgn = keep_one(exit_sgn, test(0, 1, 2), test(1, 2, 0), test(2, 0, 1));
+        f32x8 exit_distance = mask_distance(exit_sgn) + distance;
+
+        f32x8_store(hits.exit_distance, f32x8_select(winding == one, exit_distance, distance));
+    }
+    else
+    {
+        f32x8_store(hits.exit_distance, zero);
+    }
+
+    // Normal faces back along the ray
+    vec3x8 normal = sgn;
+    if constexpr (ORIENTED)
+        normal = rotation * sgn;
+    f32x8_store(hits.normal[0], normal.x);
+    f32x8_store(hits.normal[1], normal.y);
+    f32x8_store(hits.normal[2], normal.z);
+
+    hits.mask = mask_x8_bits(hit_x | hit_y | hit_z);
+    return hits.mask;
+}
+
+// 8 rays against 1 box
+template <bool RAY_CAN_START_IN_BOX, bool RAY_CAN_SECOND_HIT, bool GET_UV, bool ORIENTED>
+inline uint32_t intersect_box_x8(HostBox const &box, RayPacket8 const &rays, BoxHit8 &hits)
+{
+    return intersect_box_lanes<RAY_CAN_START_IN_BOX, RAY_CAN_SECOND_HIT, GET_UV, ORIENTED>(
+        vec3x8_set(box.center), vec3x8_set(box.radius), vec3x8_set(box.inv_radius), mat3x8_set(box.rotation),
+        vec3x8_load(rays.origin), vec3x8_load(rays.direction), vec3x8_load(rays.inv_direction), hits);
+}
+
+// 1 ray against 8 boxes
+template <bool RAY_CAN_START_IN_BOX, bool RAY_CAN_SECOND_HIT, bool GET_UV, bool ORIENTED>
+inline uint32_t intersect_box_x8(BoxPacket8 const &boxes, HostRay const &ray, glm::vec3 const &inv_ray_direction, BoxHit8 &hits)
+{
+    mat3x8 rotation = {{vec3x8_load(boxes.rotation[0]), vec3x8_load(boxes.rotation[1]), vec3x8_load(boxes.rotation[2])}};
+    return intersect_box_lanes<RAY_CAN_START_IN_BOX, RAY_CAN_SECOND_HIT, GET_UV, ORIENTED>(
+        vec3x8_load(boxes.center), vec3x8_load(boxes.radius), vec3x8_load(boxes.inv_radius), rotation,
+        vec3x8_set(ray.origin), vec3x8_set(ray.direction), vec3x8_set(inv_ray_direction), hits);
+}
+
+// hit_aa_box on 8 lanes, returns the lanes that hit or start inside
+inline uint32_t hit_aa_box_lanes(vec3x8 const &center, vec3x8 const &radius, vec3x8 origin, vec3x8 const &direction, vec3x8 const &inv_direction)
+{
+    f32x8 const zero = f32x8_set(0.0f);
+
+    origin = origin - center;
+    vec3x8 distance_to_plane = (-radius * vec3x8_sign(direction) - origin) * inv_direction;
+
+    auto test = [&](int u, int v, int w) -> mask_x8
+    {
+        return (distance_to_plane[u] >= zero) &
+               (f32x8_abs(origin[v] + direction[v] * distance_to_plane[u]) < radius[v]) &
+               (f32x8_abs(origin[w] + direction[w] * distance_to_plane[u]) < radius[w]);
+    };
+
+    mask_x8 inside = (f32x8_abs(origin.x) < radius.x) & (f32x8_abs(origin.y) < radius.y) & (f32x8_abs(origin.z) < radius.z);
+    return mask_x8_bits(inside | test(0, 1, 2) | test(1, 2, 0) | test(2, 0, 1));
+}
+
+// 1 ray against the 8 boxes, rotation is ignored (BVH nodes)
+inline uint32_t hit_aa_box_x8(BoxPacket8 const &boxes, HostRay const &ray, glm::vec3 const &inv_ray_direction)
+{
+    return hit_aa_box_lanes(vec3x8_load(boxes.center), vec3x8_load(boxes.radius),
+                            vec3x8_set(ray.origin), vec3x8_set(ray.direction), vec3x8_set(inv_ray_direction));
+}
+
+// 8 rays against 1 axis aligned box
+inline uint32_t hit_aa_box_x8(glm::vec3 const &box_center, glm::vec3 const &box_radius, RayPacket8 const &rays)
+{
+    return hit_aa_box_lanes(vec3x8_set(box_center), vec3x8_set(box_radius),
+                            vec3x8_load(rays.origin), vec3x8_load(rays.direction), vec3x8_load(rays.inv_direction));
+}
@@ -0,0 +1,253 @@
+#pragma once
+#include "defines.h"
+#include "box_intersect.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+// Occupancy grid of one instance at VOXEL_EXTENT spacing, in object space.
+// Dense top level of 8^3 bricks (VOXEL_COUNT_BY_AXIS), only occupied bricks are stored: a 512 bit
+// occupancy mask (one 64 bit word per z slice) and the primitives of the set bits in bit order.
+// Rays walk the bricks with Amanatides & Woo's DDA, skipping empty ones, and then the voxels inside.
+struct HostBrick
+{
+    uint64_t occupancy[VOXEL_COUNT_BY_AXIS] = {};
+    uint32_t first_voxel = 0; // first entry in HostBrickGrid::voxel_primitives
+};
+
+struct HostBrickGrid
+{
+    static constexpr uint32_t EMPTY_BRICK = std::numeric_limits<uint32_t>::max();
+    static constexpr int32_t BRICK_SIZE = VOXEL_COUNT_BY_AXIS;
+
+    glm::ivec3 origin_voxel = {0, 0, 0};  // voxel coordinate of the first brick corner
+    glm::ivec3 brick_count = {0, 0, 0};   // top level size
+    std::vector<uint32_t> brick_indices = {}; // dense top level, EMPTY_BRICK or an index into bricks
+    std::vector<HostBrick> bricks = {};
+    std::vector<uint32_t> voxel_primitives = {};
+
+    bool empty() const { return bricks.empty(); }
+
+    auto get_memory_size() const -> size_t
+    {
+        return brick_indices.size() * sizeof(uint32_t) + bricks.size() * sizeof(HostBrick) + voxel_primitives.size() * sizeof(uint32_t);
+    }
+
+    // Every voxel covered by the intersection box of a primitive (merged boxes cover several).
+    // A voxel claimed twice keeps the last primitive.
+    void build(AABB const *aabbs, uint32_t count)
+    {
+        brick_indices.clear();
+        bricks.clear();
+        voxel_primitives.clear();
+        if (count == 0)
+            return;
+
+        struct VoxelEntry
+        {
+            uint32_t brick;
+            uint32_t bit;
+            uint32_t primitive;
+        };
+
+        std::vector<glm::ivec3> voxel_min(count), voxel_max(count);
+        glm::ivec3 grid_min = {std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()};
+        glm::ivec3 grid_max = {std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min()};
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            HostBox box = get_primitive_box(aabbs[i]);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                voxel_min[i][axis] = static_cast<int32_t>(std::lround((box.center[axis] - box.radius[axis]) / VOXEL_EXTENT));
+                voxel_max[i][axis] = std::max(voxel_min[i][axis] + 1, static_cast<int32_t>(std::lround((box.center[axis] + box.radius[axis]) / VOXEL_EXTENT)));
+                grid_min[axis] = std::min(grid_min[axis], voxel_min[i][axis]);
+                grid_max[axis] = std::max(grid_max[axis], voxel_max[i][axis]);
+            }
+        }
+
+        // Bricks aligned to multiples of the brick size in voxel coordinates
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            origin_voxel[axis] = floor_div(grid_min[axis], BRICK_SIZE) * BRICK_SIZE;
+            brick_count[axis] = floor_div(grid_max[axis] - origin_voxel[axis] + BRICK_SIZE - 1, BRICK_SIZE);
+        }
+        brick_indices.assign(static_cast<size_t>(brick_count.x) * brick_count.y * brick_count.z, EMPTY_BRICK);
+
+        std::vector<VoxelEntry> entries = {};
+        entries.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            for (int32_t z = voxel_min[i].z; z < voxel_max[i].z; ++z)
+                for (int32_t y = voxel_min[i].y; y < voxel_max[i].y; ++y)
+                    for (int32_t x = voxel_min[i].x; x < voxel_max[i].x; ++x)
+                    {
+                        glm::ivec3 local = {x - origin_voxel.x, y - origin_voxel.y, z - origin_voxel.z};
+                        glm::ivec3 brick = {local.x / BRICK_SIZE, local.y / BRICK_SIZE, local.z / BRICK_SIZE};
+                        entries.push_back(VoxelEntry{
+                            .brick = get_brick_slot(brick),
+                            .bit = get_voxel_bit(local.x % BRICK_SIZE, local.y % BRICK_SIZE, local.z % BRICK_SIZE),
+                            .primitive = i,
+                        });
+                    }
+        }
+
+        // Stable so the last primitive of a voxel wins
+        std::stable_sort(entries.begin(), entries.end(), [](VoxelEntry const &a, VoxelEntry const &b)
+                         { return a.brick != b.brick ? a.brick < b.brick : a.bit < b.bit; });
+
+        voxel_primitives.reserve(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            VoxelEntry const &entry = entries[i];
+            if (i + 1 < entries.size() && entries[i + 1].brick == entry.brick && entries[i + 1].bit == entry.bit)
+                continue;
+
+            if (brick_indices[entry.brick] == EMPTY_BRICK)
+            {
+                brick_indices[entry.brick] = static_cast<uint32_t>(bricks.size());
+                bricks.push_back(HostBrick{.first_voxel = static_cast<uint32_t>(voxel_primitives.size())});
+            }
+            bricks.back().occupancy[entry.bit >> 6] |= 1ULL << (entry.bit & 63);
+            voxel_primitives.push_back(entry.primitive);
+        }
+    }
+
+    // Bit of a voxel inside its brick, x + 8y in the word of slice z
+    static uint32_t get_voxel_bit(int32_t x, int32_t y, int32_t z)
+    {
+        return static_cast<uint32_t>(x + BRICK_SIZE * (y + BRICK_SIZE * z));
+    }
+
+    static bool is_voxel_set(HostBrick const &brick, uint32_t bit)
+    {
+        return (brick.occupancy[bit >> 6] >> (bit & 63)) & 1ULL;
+    }
+
+    // Primitive of a set voxel: rank of the bit among the set bits of the brick
+    auto get_voxel_primitive(HostBrick const &brick, uint32_t bit) const -> uint32_t
+    {
+        uint32_t word = bit >> 6;
+        uint32_t rank = static_cast<uint32_t>(std::popcount(brick.occupancy[word] & ((1ULL << (bit & 63)) - 1ULL)));
+        for (uint32_t i = 0; i < word; ++i)
+            rank += static_cast<uint32_t>(std::popcount(brick.occupancy[i]));
+        return voxel_primitives[brick.first_voxel + rank];
+    }
+
+    // Walks the occupied voxels along an object space ray in front to back order.
+    // visit(primitive_id, t_max) may shrink t_max on a closer hit and returns true to stop.
+    // The walk ends once the next voxel starts past t_max.
+    template <typename Visit>
+    void traverse(glm::vec3 const &origin, glm::vec3 const &direction, float t_min, float t_max, Visit &&visit) const
+    {
+        if (bricks.empty())
+            return;
+
+        // Voxel units relative to the grid corner, t is unchanged
+        glm::vec3 grid_origin = (origin - glm::vec3(origin_voxel) * VOXEL_EXTENT) / VOXEL_EXTENT;
+        glm::vec3 grid_direction = direction / VOXEL_EXTENT;
+
+        // Clip to the grid bounds
+        glm::vec3 inv_direction = safe_inverse(grid_direction);
+        glm::vec3 t0 = -grid_origin * inv_direction;
+        glm::vec3 t1 = (glm::vec3(brick_count * BRICK_SIZE) - grid_origin) * inv_direction;
+        glm::vec3 t_near = glm::min(t0, t1);
+        glm::vec3 t_far = glm::max(t0, t1);
+        float t_start = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, t_min));
+        float t_end = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, t_max));
+        if (t_start > t_end)
+            return;
+
+        // Closest hit so far, the walks stop once the next cell starts past it
+        float closest = t_max;
+        bool stop = false;
+        walk(grid_origin, grid_direction, t_start, t_end, BRICK_SIZE, glm::ivec3(0, 0, 0), brick_count * BRICK_SIZE,
+             [&](glm::ivec3 const &brick_cell, float t_enter, float t_exit, float &t_limit) -> bool
+             {
+                 uint32_t brick_index = brick_indices[get_brick_slot(brick_cell)];
+                 if (brick_index == EMPTY_BRICK)
+                     return false;
+
+                 HostBrick const &brick = bricks[brick_index];
+                 glm::ivec3 first_voxel = brick_cell * BRICK_SIZE;
+                 walk(grid_origin, grid_direction, t_enter, t_exit, 1, first_voxel, first_voxel + glm::ivec3(BRICK_SIZE, BRICK_SIZE, BRICK_SIZE),
+                      [&](glm::ivec3 const &voxel, float, float, float &voxel_limit) -> bool
+                      {
+                          uint32_t bit = get_voxel_bit(voxel.x - first_voxel.x, voxel.y - first_voxel.y, voxel.z - first_voxel.z);
+                          if (!is_voxel_set(brick, bit))
+                              return false;
+                          stop = visit(get_voxel_primitive(brick, bit), closest);
+                          voxel_limit = std::min(voxel_limit, closest);
+                          t_limit = std::min(t_limit, closest);
+                          return stop;
+                      });
+                 return stop;
+             });
+    }
+
+private:
+    static int32_t floor_div(int32_t a, int32_t b)
+    {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)) ? 1 : 0);
+    }
+
+    auto get_brick_slot(glm::ivec3 const &brick) const -> uint32_t
+    {
+        return static_cast<uint32_t>(brick.x + brick_count.x * (brick.y + brick_count.y * brick.z));
+    }
+
+    // DDA over the cells of size cell_size in [lo, hi) (voxel units) between t_start and t_end.
+    // visit(cell, t_enter, t_exit, t_end) gets the cell in cell units, may shrink t_end and returns true to stop.
+    template <typename Visit>
+    static void walk(glm::vec3 const &origin, glm::vec3 const &direction, float t_start, float t_end, int32_t cell_size,
+                     glm::ivec3 const &lo, glm::ivec3 const &hi, Visit &&visit)
+    {
+        glm::ivec3 cell = {};
+        glm::ivec3 step = {};
+        glm::vec3 t_next = {};
+        glm::vec3 t_delta = {};
+
+        glm::vec3 start = origin + direction * t_start;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            // Clamped so the rounding of the entry point can't leave the range
+            cell[axis] = std::clamp(static_cast<int32_t>(std::floor(start[axis] / cell_size)) * cell_size, lo[axis], hi[axis] - cell_size);
+            if (direction[axis] > 0.0f)
+            {
+                step[axis] = cell_size;
+                t_next[axis] = (cell[axis] + cell_size - origin[axis]) / direction[axis];
+                t_delta[axis] = cell_size / direction[axis];
+            }
+            else if (direction[axis] < 0.0f)
+            {
+                step[axis] = -cell_size;
+                t_next[axis] = (cell[axis] - origin[axis]) / direction[axis];
+                t_delta[axis] = -cell_size / direction[axis];
+            }
+            else
+            {
+                step[axis] = 0;
+                t_next[axis] = std::numeric_limits<float>::infinity();
+                t_delta[axis] = std::numeric_limits<float>::infinity();
+            }
+        }
+
+        float t = t_start;
+        while (true)
+        {
+            int axis = (t_next.x < t_next.y) ? (t_next.x < t_next.z ? 0 : 2) : (t_next.y < t_next.z ? 1 : 2);
+            glm::ivec3 visited = cell / cell_size;
+            if (visit(visited, t, std::min(t_next[axis], t_end), t_end))
+                return;
+            if (t_next[axis] >= t_end)
+                return;
+
+            t = t_next[axis];
+            cell[axis] += step[axis];
+            if (cell[axis] < lo[axis] || cell[axis] >= hi[axis])
+                return;
+            t_next[axis] += t_delta[axis];
+        }
+    }
+};
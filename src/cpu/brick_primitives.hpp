@@ -0,0 +1,224 @@
+#pragma once
+#include "defines.h"
+#include "box_intersect.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Brick primitives (BRICK_PRIMITIVES_ON): the voxels of an instance packed into 8^3 bricks (VOXEL_COUNT_BY_AXIS),
+// one AABB per brick for the BLAS and a BRICK with the occupancy mask & the PRIMITIVE of every voxel.
+// intersect_brick is the host port of the brick walk of rint.glsl, both must stay in sync.
+struct HostBrickPrimitives
+{
+    static constexpr int32_t BRICK_SIZE = VOXEL_COUNT_BY_AXIS;
+    static constexpr uint32_t VOXEL_MASK = (1U << BRICK_VOXEL_BITS) - 1U;
+
+    std::vector<AABB> aabbs = {};      // one per brick, BRICK_SIZE voxels wide
+    std::vector<BRICK> bricks = {};
+    std::vector<uint32_t> voxel_ids = {}; // packed primitive id of every input primitive (first voxel of merged boxes)
+
+    // Every voxel covered by the intersection box of a primitive (merged boxes cover several).
+    // A voxel claimed twice keeps the last primitive.
+    void build(AABB const *primitive_aabbs, PRIMITIVE const *primitives, uint32_t count)
+    {
+        aabbs.clear();
+        bricks.clear();
+        voxel_ids.assign(count, std::numeric_limits<uint32_t>::max());
+        if (count == 0)
+            return;
+
+        struct VoxelEntry
+        {
+            glm::ivec3 brick;
+            uint32_t bit;
+            uint32_t primitive;
+        };
+
+        std::vector<VoxelEntry> entries = {};
+        entries.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            HostBox box = get_primitive_box(primitive_aabbs[i]);
+            glm::ivec3 voxel_min = {}, voxel_max = {};
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                voxel_min[axis] = static_cast<int32_t>(std::lround((box.center[axis] - box.radius[axis]) / VOXEL_EXTENT));
+                voxel_max[axis] = std::max(voxel_min[axis] + 1, static_cast<int32_t>(std::lround((box.center[axis] + box.radius[axis]) / VOXEL_EXTENT)));
+            }
+
+            for (int32_t z = voxel_min.z; z < voxel_max.z; ++z)
+                for (int32_t y = voxel_min.y; y < voxel_max.y; ++y)
+                    for (int32_t x = voxel_min.x; x < voxel_max.x; ++x)
+                    {
+                        glm::ivec3 brick = {floor_div(x, BRICK_SIZE), floor_div(y, BRICK_SIZE), floor_div(z, BRICK_SIZE)};
+                        entries.push_back(VoxelEntry{
+                            .brick = brick,
+                            .bit = get_voxel_bit(x - brick.x * BRICK_SIZE, y - brick.y * BRICK_SIZE, z - brick.z * BRICK_SIZE),
+                            .primitive = i,
+                        });
+                    }
+        }
+
+        // Bricks in z, y, x order, stable so the last primitive of a voxel wins
+        std::stable_sort(entries.begin(), entries.end(), [](VoxelEntry const &a, VoxelEntry const &b)
+                         {
+            if (a.brick.z != b.brick.z)
+                return a.brick.z < b.brick.z;
+            if (a.brick.y != b.brick.y)
+                return a.brick.y < b.brick.y;
+            if (a.brick.x != b.brick.x)
+                return a.brick.x < b.brick.x;
+            return a.bit < b.bit; });
+
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            VoxelEntry const &entry = entries[i];
+            if (i + 1 < entries.size() && entries[i + 1].brick == entry.brick && entries[i + 1].bit == entry.bit)
+                continue;
+
+            if (i == 0 || entries[i - 1].brick != entry.brick)
+            {
+                glm::vec3 minimum = glm::vec3(entry.brick * BRICK_SIZE) * VOXEL_EXTENT;
+                glm::vec3 maximum = glm::vec3((entry.brick + glm::ivec3(1, 1, 1)) * BRICK_SIZE) * VOXEL_EXTENT;
+                aabbs.push_back(AABB{
+                    .minimum = {minimum.x, minimum.y, minimum.z},
+                    .maximum = {maximum.x, maximum.y, maximum.z},
+                });
+                bricks.push_back(BRICK{});
+            }
+
+            uint32_t brick_id = static_cast<uint32_t>(bricks.size() - 1);
+            set_voxel(bricks.back(), entry.bit, primitives[entry.primitive]);
+            if (voxel_ids[entry.primitive] == std::numeric_limits<uint32_t>::max())
+                voxel_ids[entry.primitive] = pack_voxel_id(brick_id, entry.bit);
+        }
+    }
+
+    // Bit of a voxel inside its brick, same order as HostBrickGrid
+    static uint32_t get_voxel_bit(int32_t x, int32_t y, int32_t z)
+    {
+        return static_cast<uint32_t>(x + BRICK_SIZE * (y + BRICK_SIZE * z));
+    }
+
+    static uint32_t pack_voxel_id(uint32_t brick_id, uint32_t bit) { return (brick_id << BRICK_VOXEL_BITS) | bit; }
+    static uint32_t get_brick_id(uint32_t voxel_id) { return voxel_id >> BRICK_VOXEL_BITS; }
+    static uint32_t get_voxel_bit(uint32_t voxel_id) { return voxel_id & VOXEL_MASK; }
+
+    static bool is_voxel_set(BRICK const &brick, uint32_t bit)
+    {
+        return (brick.occupancy[bit >> 5] >> (bit & 31)) & 1U;
+    }
+
+    // Edits only flip the occupancy bit (and store the voxel), the brick AABB & the BLAS are left as they are
+    static void set_voxel(BRICK &brick, uint32_t bit, PRIMITIVE const &voxel)
+    {
+        brick.occupancy[bit >> 5] |= 1U << (bit & 31);
+        brick.voxels[bit] = voxel;
+    }
+
+    static void clear_voxel(BRICK &brick, uint32_t bit)
+    {
+        brick.occupancy[bit >> 5] &= ~(1U << (bit & 31));
+    }
+
+    static bool is_brick_empty(BRICK const &brick)
+    {
+        return std::all_of(std::begin(brick.occupancy), std::end(brick.occupancy), [](uint32_t word)
+                           { return word == 0U; });
+    }
+
+    // Voxel AABB of a bit of a brick (primitives.glsl get_aabb_from_primitive_index)
+    static AABB get_voxel_aabb(AABB const &brick_aabb, uint32_t bit)
+    {
+        glm::vec3 cell = {static_cast<float>(bit % BRICK_SIZE), static_cast<float>(bit / BRICK_SIZE % BRICK_SIZE), static_cast<float>(bit / (BRICK_SIZE * BRICK_SIZE))};
+        glm::vec3 minimum = glm::vec3(brick_aabb.minimum.x, brick_aabb.minimum.y, brick_aabb.minimum.z) + cell * VOXEL_EXTENT;
+        glm::vec3 maximum = minimum + glm::vec3(VOXEL_EXTENT);
+        return AABB{
+            .minimum = {minimum.x, minimum.y, minimum.z},
+            .maximum = {maximum.x, maximum.y, maximum.z},
+        };
+    }
+
+    // Host port of the brick walk of rint.glsl: DDA over the voxels of the brick inside (t_min, t_max), the first
+    // set voxel whose box is hit in range is the closest one (voxels don't overlap and are visited front to back).
+    static bool intersect_brick(AABB const &brick_aabb, BRICK const &brick, HostRay const &obj_ray, glm::vec3 const &obj_inv_direction,
+                                float t_min, float t_max, float &distance, glm::vec3 &normal, uint32_t &bit)
+    {
+        // Voxel units relative to the brick corner, t is unchanged
+        glm::vec3 brick_min = {brick_aabb.minimum.x, brick_aabb.minimum.y, brick_aabb.minimum.z};
+        glm::vec3 origin = (obj_ray.origin - brick_min) / VOXEL_EXTENT;
+        glm::vec3 direction = obj_ray.direction / VOXEL_EXTENT;
+        glm::vec3 inv_direction = safe_inverse(direction);
+
+        glm::vec3 t0 = -origin * inv_direction;
+        glm::vec3 t1 = (glm::vec3(static_cast<float>(BRICK_SIZE)) - origin) * inv_direction;
+        glm::vec3 t_near = glm::min(t0, t1);
+        glm::vec3 t_far = glm::max(t0, t1);
+        float t_start = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, t_min));
+        float t_end = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, t_max));
+        if (t_start > t_end)
+            return false;
+
+        glm::ivec3 cell = {};
+        glm::ivec3 step = {};
+        glm::vec3 t_next = {};
+        glm::vec3 t_delta = {};
+        glm::vec3 start = origin + direction * t_start;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            // Clamped so the rounding of the entry point can't leave the brick
+            cell[axis] = std::clamp(static_cast<int32_t>(std::floor(start[axis])), 0, BRICK_SIZE - 1);
+            if (direction[axis] > 0.0f)
+            {
+                step[axis] = 1;
+                t_next[axis] = (static_cast<float>(cell[axis] + 1) - origin[axis]) / direction[axis];
+                t_delta[axis] = 1.0f / direction[axis];
+            }
+            else if (direction[axis] < 0.0f)
+            {
+                step[axis] = -1;
+                t_next[axis] = (static_cast<float>(cell[axis]) - origin[axis]) / direction[axis];
+                t_delta[axis] = -1.0f / direction[axis];
+            }
+            else
+            {
+                step[axis] = 0;
+                t_next[axis] = std::numeric_limits<float>::infinity();
+                t_delta[axis] = std::numeric_limits<float>::infinity();
+            }
+        }
+
+        while (true)
+        {
+            uint32_t cell_bit = get_voxel_bit(cell.x, cell.y, cell.z);
+            if (is_voxel_set(brick, cell_bit))
+            {
+                float voxel_distance = 0.0f;
+                glm::vec3 voxel_normal = {};
+                if (intersect_box(get_primitive_box(get_voxel_aabb(brick_aabb, cell_bit)), obj_ray, voxel_distance, voxel_normal, true, true, obj_inv_direction) &&
+                    voxel_distance > t_min && voxel_distance < t_max)
+                {
+                    distance = voxel_distance;
+                    normal = voxel_normal;
+                    bit = cell_bit;
+                    return true;
+                }
+            }
+
+            int axis = (t_next.x < t_next.y) ? (t_next.x < t_next.z ? 0 : 2) : (t_next.y < t_next.z ? 1 : 2);
+            if (t_next[axis] > t_end)
+                return false;
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= BRICK_SIZE)
+                return false;
+            t_next[axis] += t_delta[axis];
+        }
+    }
+
+private:
+    static int32_t floor_div(int32_t a, int32_t b)
+    {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)) ? 1 : 0);
+    }
+};
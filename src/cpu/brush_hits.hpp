@@ -0,0 +1,96 @@
+#pragma once
+#include "defines.h"
+#include "box_merger.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// Brush hits of a stroke on the host: the bitmasks & range claims of delete_primitive_from_instance (squared_brush.slang,
+// primitives.glsl) and the mapping of the hits in a shared primitive range to the placement they belong to.
+// Placements of a model draw the range of its prototype, so their hits land in the same primitive bits: the first
+// instance hit in a range claims it for the stroke (BRUSH_RANGE_UNCLAIMED until then) and the hits of the others are
+// skipped, the next stroke gets them.
+// Merged boxes (MERGED_BOXES_ON) are split before their voxels can be deleted: the hits on them keep the hit position,
+// which gives the voxel to delete once the box is split (get_split_hit_id).
+
+inline bool is_bit_set(uint32_t const *bitmask, uint32_t index)
+{
+    return (bitmask[index >> 5] & (1U << (index & 31))) != 0U;
+}
+
+// Host port of the brush hit on primitive_id of an instance, false when another instance claimed the range
+inline bool host_brush_hit(uint32_t *instance_bitmask, uint32_t *primitive_bitmask, uint32_t *range_owners, BRUSH_COUNTER &counters,
+                           uint32_t instance_index, uint32_t first_primitive_index, uint32_t primitive_id)
+{
+    uint32_t &range_owner = range_owners[first_primitive_index / BRUSH_RANGE_ALIGNMENT];
+    if (range_owner == BRUSH_RANGE_UNCLAIMED)
+        range_owner = instance_index;
+    else if (range_owner != instance_index)
+        return false;
+
+    uint32_t primitive_index = first_primitive_index + primitive_id;
+    if (!is_bit_set(primitive_bitmask, primitive_index))
+        ++counters.primitive_count;
+    primitive_bitmask[primitive_index >> 5] |= 1U << (primitive_index & 31);
+    if (!is_bit_set(instance_bitmask, instance_index))
+        ++counters.instance_count;
+    instance_bitmask[instance_index >> 5] |= 1U << (instance_index & 31);
+    return true;
+}
+
+// A prototype range & its placements hit in the stroke (instance bit set)
+struct SharedRangeHits
+{
+    uint32_t first_primitive_index = 0;
+    uint32_t primitive_count = 0;
+    std::vector<uint32_t> placements = {};
+};
+
+// The placement the hits of the range map to, the one claiming it. BRUSH_RANGE_UNCLAIMED when they can't be mapped to
+// one of the hit placements (the range isn't claimed or another instance claims it): the stroke is rejected then.
+inline uint32_t map_shared_range_hits(SharedRangeHits const &range, uint32_t const *range_owners)
+{
+    uint32_t owner = range_owners[range.first_primitive_index / BRUSH_RANGE_ALIGNMENT];
+    if (std::find(range.placements.begin(), range.placements.end(), owner) == range.placements.end())
+        return BRUSH_RANGE_UNCLAIMED;
+    return owner;
+}
+
+// Hit primitives of the range, relative to its first primitive
+inline void get_range_hits(SharedRangeHits const &range, uint32_t const *primitive_bitmask, std::vector<uint32_t> &primitive_ids)
+{
+    primitive_ids.clear();
+    for (uint32_t i = 0; i < range.primitive_count; ++i)
+        if (is_bit_set(primitive_bitmask, range.first_primitive_index + i))
+            primitive_ids.push_back(i);
+}
+
+// Merged boxes of an instance split in a stroke, as split_aabb_device_buffer lays them out: the first voxel of a box keeps
+// its slot & the others are appended after the primitives of the instance, in split order
+struct SplitBoxes
+{
+    uint32_t primitive_count = 0; // of the instance before the split
+    uint32_t appended_count = 0;
+    std::vector<uint32_t> box_ids = {}; // ascending
+    std::vector<uint32_t> first_appended_ids = {};
+
+    void add_box(uint32_t box_id, uint32_t voxel_count)
+    {
+        box_ids.push_back(box_id);
+        first_appended_ids.push_back(primitive_count + appended_count);
+        appended_count += voxel_count - 1;
+    }
+
+    uint32_t get_split_primitive_count() const { return primitive_count + appended_count; }
+};
+
+// Primitive of the voxel under a brush hit on a box once it is split, relative to the instance. The hit position is in
+// object space & box_aabb the merged AABB of box_id. -1 when the box isn't split.
+inline uint32_t get_split_hit_id(SplitBoxes const &split, uint32_t box_id, AABB const &box_aabb, daxa_f32vec3 position)
+{
+    auto box = std::lower_bound(split.box_ids.begin(), split.box_ids.end(), box_id);
+    if (box == split.box_ids.end() || *box != box_id)
+        return static_cast<uint32_t>(-1);
+    uint32_t first_appended_id = split.first_appended_ids[box - split.box_ids.begin()];
+    return BoxMerger::get_split_voxel_id(box_id, first_appended_id, BoxMerger::get_voxel_index(box_aabb, position));
+}
@@ -0,0 +1,345 @@
+#pragma once
+#include "defines.h"
+#include "host_shading.hpp"
+#include "tile_pool.hpp"
+
+// Host port of denoiser.glsl & compute/svgf.glsl (same names with host_, same math): spatiotemporal variance guided
+// filtering (Schied et al. 2017) of the direct & indirect light of the hit pixels, before TAA.
+//  - Temporal pass: light is divided by the albedo and follows the VELOCITY of the pixel to its history, kept when
+//    normal, distance & material agree. Colors & luminance moments are exponential averages weighing the new frame at
+//    least 1 / history length, histories shorter than DENOISER_MIN_HISTORY take their variance from the 5x5 pixels of
+//    the same surface around them.
+//  - A-trous passes: 5x5 B3 spline kernel with steps 1, 2, 4..., weights stopped by normals, distances (against the
+//    local distance gradient) & luminance (against the blurred standard deviation), variances filtered with the squared
+//    weights. The first pass is the color history of the next frame, the last one multiplies the albedo back and adds
+//    the emission.
+// Histories & signals keep two halves of width * height pixels, like the GPU buffers.
+
+//////////////////////////////// WEIGHTS //////////////////////////////////////
+
+inline float host_denoiser_get_luminance(glm::vec3 color)
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// Light is filtered divided by this, dark albedos are clamped so it can be multiplied back
+inline glm::vec3 host_denoiser_get_albedo(MATERIAL const &mat)
+{
+    return glm::max(to_glm(mat.diffuse), glm::vec3(DENOISER_ALBEDO_EPSILON));
+}
+
+// NaN & infinite samples of the shading pass don't enter the history
+inline glm::vec3 host_denoiser_sanitize(glm::vec3 color)
+{
+    for (int c = 0; c < 3; ++c)
+        if (!std::isfinite(color[c]))
+            color[c] = 0.0f;
+    return color;
+}
+
+// Whether two pixels see the same surface, for reprojection & the spatial variance estimate
+inline bool host_denoiser_is_same_surface(glm::vec3 normal_a, float distance_a, uint32_t mat_index_a,
+                                          glm::vec3 normal_b, float distance_b, uint32_t mat_index_b)
+{
+    return distance_a > 0.0f && distance_b > 0.0f && glm::dot(normal_a, normal_b) >= DENOISER_NORMAL_THRESHOLD &&
+           std::abs(distance_a - distance_b) <= DENOISER_DEPTH_THRESHOLD * distance_a && mat_index_a == mat_index_b;
+}
+
+// B3 spline of the a-trous kernel, offset in [-2, 2]
+inline float host_denoiser_get_kernel_weight(int32_t offset)
+{
+    return offset == 0 ? 3.0f / 8.0f : (std::abs(offset) == 1 ? 1.0f / 4.0f : 1.0f / 16.0f);
+}
+
+// Smaller one sided difference of the distance along each axis, 0 without a neighbour
+inline float host_denoiser_get_distance_slope(float center, float before, float after)
+{
+    float slope = std::numeric_limits<float>::max();
+    if (before > 0.0f)
+        slope = std::min(slope, std::abs(center - before));
+    if (after > 0.0f)
+        slope = std::min(slope, std::abs(after - center));
+    return slope == std::numeric_limits<float>::max() ? 0.0f : slope;
+}
+
+// Normal & distance edge stop of a tap delta pixels away
+inline float host_denoiser_get_geometry_weight(glm::vec3 normal_p, glm::vec3 normal_q, float distance_p, float distance_q,
+                                               glm::vec2 distance_gradient, glm::vec2 delta)
+{
+    float normal_weight = std::pow(std::max(glm::dot(normal_p, normal_q), 0.0f), DENOISER_PHI_NORMAL);
+    float expected = DENOISER_PHI_DEPTH * std::abs(glm::dot(distance_gradient, delta)) + distance_p * 1e-3f;
+    return normal_weight * std::exp(-std::abs(distance_p - distance_q) / expected);
+}
+
+inline float host_denoiser_get_luminance_weight(float luminance_p, float luminance_q, float sigma)
+{
+    return std::exp(-std::abs(luminance_p - luminance_q) / (DENOISER_PHI_COLOR * sigma + 1e-10f));
+}
+
+//////////////////////////////// DENOISER //////////////////////////////////////
+
+struct DenoiserSettings
+{
+    uint32_t atrous_iterations = DENOISER_ATROUS_ITERATIONS;
+    // false filters every frame on its own (no history), for comparisons
+    bool temporal = true;
+};
+
+struct HostDenoiser
+{
+public:
+    HostDenoiser(uint32_t width, uint32_t height, DenoiserSettings const &settings = {})
+        : width(width), height(height), settings(settings)
+    {
+        histories.assign(static_cast<size_t>(width) * height * 2, DENOISER_HISTORY{});
+        signals.assign(static_cast<size_t>(width) * height * 2, DENOISER_SIGNAL{});
+    }
+
+    // direct & indirect are the light of the shading pass, gbuffer the first hits (distance <= 0 for misses) & a pixel
+    // came from pixel + velocity at the previous frame. Hit pixels of image are replaced by the denoised color, the
+    // others are left as they are.
+    void frame(std::vector<glm::vec3> const &direct, std::vector<glm::vec3> const &indirect,
+               std::vector<DIRECT_ILLUMINATION_INFO> const &gbuffer, std::vector<VELOCITY> const &velocities,
+               std::vector<MATERIAL> const &materials, std::vector<glm::vec3> &image, TilePool &pool)
+    {
+        size_t pixel_count = static_cast<size_t>(width) * height;
+        size_t current = (frame_number % 2) * pixel_count;
+        size_t previous = ((frame_number + 1) % 2) * pixel_count;
+
+        pool.run(height, [&](uint32_t y, uint32_t)
+                 {
+            for (uint32_t x = 0; x < width; ++x)
+                temporal_pass(x, y, current, previous, direct, indirect, gbuffer, velocities, materials); });
+
+        for (uint32_t iteration = 0; iteration < settings.atrous_iterations; ++iteration)
+        {
+            pool.run(height, [&](uint32_t y, uint32_t)
+                     {
+                for (uint32_t x = 0; x < width; ++x)
+                    atrous_pass(x, y, iteration, current, materials, image); });
+        }
+
+        // Without a-trous passes the temporal output is the image
+        if (settings.atrous_iterations == 0)
+        {
+            for (size_t i = 0; i < pixel_count; ++i)
+            {
+                if (gbuffer[i].distance <= 0.0f)
+                    continue;
+                MATERIAL const &mat = materials[gbuffer[i].mat_index];
+                glm::vec3 light = to_glm(signals[i].direct) + to_glm(signals[i].indirect);
+                image[i] = light * host_denoiser_get_albedo(mat) + to_glm(mat.emission);
+            }
+        }
+
+        ++frame_number;
+    }
+
+    // History of the last frame
+    auto get_history(uint32_t x, uint32_t y) const -> DENOISER_HISTORY const &
+    {
+        size_t pixel_count = static_cast<size_t>(width) * height;
+        return histories[((frame_number + 1) % 2) * pixel_count + static_cast<size_t>(y) * width + x];
+    }
+
+    // Variance of the temporal pass of the last frame, a-trous passes past the first write over it
+    auto get_variance(uint32_t x, uint32_t y) const -> glm::vec2
+    {
+        daxa_f32vec2 const &variance = signals[static_cast<size_t>(y) * width + x].variance;
+        return glm::vec2(variance.x, variance.y);
+    }
+
+private:
+    void temporal_pass(uint32_t x, uint32_t y, size_t current, size_t previous,
+                       std::vector<glm::vec3> const &direct, std::vector<glm::vec3> const &indirect,
+                       std::vector<DIRECT_ILLUMINATION_INFO> const &gbuffer, std::vector<VELOCITY> const &velocities,
+                       std::vector<MATERIAL> const &materials)
+    {
+        size_t i = static_cast<size_t>(y) * width + x;
+        DIRECT_ILLUMINATION_INFO const &di_info = gbuffer[i];
+        DENOISER_HISTORY &history = histories[current + i];
+        if (di_info.distance <= 0.0f)
+        {
+            history = DENOISER_HISTORY{};
+            return;
+        }
+
+        glm::vec3 normal = to_glm(di_info.normal);
+        glm::vec3 albedo = host_denoiser_get_albedo(materials[di_info.mat_index]);
+        glm::vec3 direct_light = host_denoiser_sanitize(direct[i]) / albedo;
+        glm::vec3 indirect_light = host_denoiser_sanitize(indirect[i]) / albedo;
+
+        // Nearest pixel of the previous frame
+        glm::vec2 previous_position = glm::vec2(x, y) + glm::vec2(velocities[i].velocity.x, velocities[i].velocity.y);
+        int32_t px = static_cast<int32_t>(std::floor(previous_position.x + 0.5f));
+        int32_t py = static_cast<int32_t>(std::floor(previous_position.y + 0.5f));
+        bool valid = false;
+        DENOISER_HISTORY previous_history = {};
+        if (settings.temporal && px >= 0 && py >= 0 && px < static_cast<int32_t>(width) && py < static_cast<int32_t>(height))
+        {
+            previous_history = histories[previous + static_cast<size_t>(py) * width + px];
+            valid = host_denoiser_is_same_surface(normal, di_info.distance, di_info.mat_index,
+                                                  to_glm(previous_history.normal), previous_history.distance, previous_history.mat_index);
+        }
+
+        float history_length = valid ? std::min(previous_history.history_length + 1.0f, static_cast<float>(DENOISER_MAX_HISTORY)) : 1.0f;
+        float color_alpha = valid ? std::max(DENOISER_COLOR_ALPHA, 1.0f / history_length) : 1.0f;
+        float moments_alpha = valid ? std::max(DENOISER_MOMENTS_ALPHA, 1.0f / history_length) : 1.0f;
+
+        float direct_luminance = host_denoiser_get_luminance(direct_light);
+        float indirect_luminance = host_denoiser_get_luminance(indirect_light);
+        glm::vec4 moments = glm::vec4(direct_luminance, direct_luminance * direct_luminance, indirect_luminance, indirect_luminance * indirect_luminance);
+        if (valid)
+        {
+            glm::vec4 previous_moments = glm::vec4(previous_history.moments.x, previous_history.moments.y, previous_history.moments.z, previous_history.moments.w);
+            moments = previous_moments + (moments - previous_moments) * moments_alpha;
+            direct_light = to_glm(previous_history.direct) + (direct_light - to_glm(previous_history.direct)) * color_alpha;
+            indirect_light = to_glm(previous_history.indirect) + (indirect_light - to_glm(previous_history.indirect)) * color_alpha;
+        }
+
+        glm::vec2 variance = glm::vec2(std::max(moments.y - moments.x * moments.x, 0.0f), std::max(moments.w - moments.z * moments.z, 0.0f));
+        if (history_length < static_cast<float>(DENOISER_MIN_HISTORY))
+            variance = get_spatial_variance(x, y, direct, indirect, gbuffer, materials) * (static_cast<float>(DENOISER_MIN_HISTORY) / history_length);
+
+        history = DENOISER_HISTORY{
+            .direct = to_daxa(direct_light),
+            .indirect = to_daxa(indirect_light),
+            .moments = {moments.x, moments.y, moments.z, moments.w},
+            .normal = di_info.normal,
+            .distance = di_info.distance,
+            .mat_index = di_info.mat_index,
+            .history_length = history_length,
+        };
+        signals[i] = DENOISER_SIGNAL{
+            .direct = to_daxa(direct_light),
+            .indirect = to_daxa(indirect_light),
+            .variance = {variance.x, variance.y},
+        };
+    }
+
+    // Luminance variance of the 5x5 pixels of the same surface around a pixel, this frame only
+    auto get_spatial_variance(uint32_t x, uint32_t y, std::vector<glm::vec3> const &direct, std::vector<glm::vec3> const &indirect,
+                              std::vector<DIRECT_ILLUMINATION_INFO> const &gbuffer, std::vector<MATERIAL> const &materials) const -> glm::vec2
+    {
+        DIRECT_ILLUMINATION_INFO const &center = gbuffer[static_cast<size_t>(y) * width + x];
+        glm::vec4 sum = glm::vec4(0.0f);
+        float count = 0.0f;
+        for (int32_t dy = -2; dy <= 2; ++dy)
+            for (int32_t dx = -2; dx <= 2; ++dx)
+            {
+                int32_t qx = static_cast<int32_t>(x) + dx, qy = static_cast<int32_t>(y) + dy;
+                if (qx < 0 || qy < 0 || qx >= static_cast<int32_t>(width) || qy >= static_cast<int32_t>(height))
+                    continue;
+                size_t q = static_cast<size_t>(qy) * width + qx;
+                DIRECT_ILLUMINATION_INFO const &neighbour = gbuffer[q];
+                if (!host_denoiser_is_same_surface(to_glm(center.normal), center.distance, center.mat_index,
+                                                   to_glm(neighbour.normal), neighbour.distance, neighbour.mat_index))
+                    continue;
+                glm::vec3 albedo = host_denoiser_get_albedo(materials[neighbour.mat_index]);
+                float direct_luminance = host_denoiser_get_luminance(host_denoiser_sanitize(direct[q]) / albedo);
+                float indirect_luminance = host_denoiser_get_luminance(host_denoiser_sanitize(indirect[q]) / albedo);
+                sum += glm::vec4(direct_luminance, direct_luminance * direct_luminance, indirect_luminance, indirect_luminance * indirect_luminance);
+                count += 1.0f;
+            }
+        sum /= count;
+        return glm::vec2(std::max(sum.y - sum.x * sum.x, 0.0f), std::max(sum.w - sum.z * sum.z, 0.0f));
+    }
+
+    void atrous_pass(uint32_t x, uint32_t y, uint32_t iteration, size_t current, std::vector<MATERIAL> const &materials,
+                     std::vector<glm::vec3> &image)
+    {
+        size_t pixel_count = static_cast<size_t>(width) * height;
+        size_t input = (iteration % 2) * pixel_count;
+        size_t output = ((iteration + 1) % 2) * pixel_count;
+        size_t i = static_cast<size_t>(y) * width + x;
+        DENOISER_HISTORY &center = histories[current + i];
+        if (center.distance <= 0.0f)
+            return;
+
+        auto get_distance = [&](int32_t qx, int32_t qy)
+        {
+            if (qx < 0 || qy < 0 || qx >= static_cast<int32_t>(width) || qy >= static_cast<int32_t>(height))
+                return 0.0f;
+            return histories[current + static_cast<size_t>(qy) * width + qx].distance;
+        };
+        int32_t ix = static_cast<int32_t>(x), iy = static_cast<int32_t>(y);
+        glm::vec2 distance_gradient = glm::vec2(
+            host_denoiser_get_distance_slope(center.distance, get_distance(ix - 1, iy), get_distance(ix + 1, iy)),
+            host_denoiser_get_distance_slope(center.distance, get_distance(ix, iy - 1), get_distance(ix, iy + 1)));
+
+        // 3x3 gaussian of the variance for the luminance edge stop
+        glm::vec2 blurred_variance = glm::vec2(0.0f);
+        float blur_weight = 0.0f;
+        for (int32_t dy = -1; dy <= 1; ++dy)
+            for (int32_t dx = -1; dx <= 1; ++dx)
+            {
+                int32_t qx = ix + dx, qy = iy + dy;
+                if (get_distance(qx, qy) <= 0.0f)
+                    continue;
+                float weight = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f);
+                daxa_f32vec2 const &variance = signals[input + static_cast<size_t>(qy) * width + qx].variance;
+                blurred_variance += glm::vec2(variance.x, variance.y) * weight;
+                blur_weight += weight;
+            }
+        glm::vec2 sigma = glm::vec2(std::sqrt(blurred_variance.x / blur_weight), std::sqrt(blurred_variance.y / blur_weight));
+
+        DENOISER_SIGNAL const &signal = signals[input + i];
+        float direct_luminance = host_denoiser_get_luminance(to_glm(signal.direct));
+        float indirect_luminance = host_denoiser_get_luminance(to_glm(signal.indirect));
+        glm::vec3 direct_sum = glm::vec3(0.0f), indirect_sum = glm::vec3(0.0f);
+        glm::vec2 variance_sum = glm::vec2(0.0f), weight_sum = glm::vec2(0.0f);
+        int32_t step = 1 << iteration;
+        for (int32_t dy = -2; dy <= 2; ++dy)
+            for (int32_t dx = -2; dx <= 2; ++dx)
+            {
+                int32_t qx = ix + dx * step, qy = iy + dy * step;
+                if (get_distance(qx, qy) <= 0.0f)
+                    continue;
+                size_t q = static_cast<size_t>(qy) * width + qx;
+                DENOISER_HISTORY const &neighbour = histories[current + q];
+                DENOISER_SIGNAL const &tap = signals[input + q];
+
+                float weight = host_denoiser_get_kernel_weight(dx) * host_denoiser_get_kernel_weight(dy) *
+                               host_denoiser_get_geometry_weight(to_glm(center.normal), to_glm(neighbour.normal), center.distance, neighbour.distance,
+                                                                 distance_gradient, glm::vec2(dx * step, dy * step));
+                float direct_weight = weight * host_denoiser_get_luminance_weight(direct_luminance, host_denoiser_get_luminance(to_glm(tap.direct)), sigma.x);
+                float indirect_weight = weight * host_denoiser_get_luminance_weight(indirect_luminance, host_denoiser_get_luminance(to_glm(tap.indirect)), sigma.y);
+
+                direct_sum += to_glm(tap.direct) * direct_weight;
+                indirect_sum += to_glm(tap.indirect) * indirect_weight;
+                variance_sum += glm::vec2(tap.variance.x * direct_weight * direct_weight, tap.variance.y * indirect_weight * indirect_weight);
+                weight_sum += glm::vec2(direct_weight, indirect_weight);
+            }
+
+        // The center tap always has a weight
+        glm::vec3 direct_light = direct_sum / weight_sum.x;
+        glm::vec3 indirect_light = indirect_sum / weight_sum.y;
+        glm::vec2 variance = variance_sum / (weight_sum * weight_sum);
+
+        if (iteration == 0)
+        {
+            center.direct = to_daxa(direct_light);
+            center.indirect = to_daxa(indirect_light);
+        }
+
+        if (iteration + 1 == settings.atrous_iterations)
+        {
+            MATERIAL const &mat = materials[center.mat_index];
+            image[i] = (direct_light + indirect_light) * host_denoiser_get_albedo(mat) + to_glm(mat.emission);
+            return;
+        }
+
+        signals[output + i] = DENOISER_SIGNAL{
+            .direct = to_daxa(direct_light),
+            .indirect = to_daxa(indirect_light),
+            .variance = {variance.x, variance.y},
+        };
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    DenoiserSettings settings = {};
+    std::vector<DENOISER_HISTORY> histories = {};
+    std::vector<DENOISER_SIGNAL> signals = {};
+    uint32_t frame_number = 0;
+};
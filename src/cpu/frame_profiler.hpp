@@ -0,0 +1,504 @@
+#pragma once
+#include "defines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Frame profiler: named CPU scopes timed on the host clock & GPU scopes resolved from timestamp query pairs, each
+// summed per frame into a rolling window of PROFILER_HISTORY_FRAMES frames (last, mean, p50, p99 & max), and the
+// newest PROFILER_MAX_TRACE_EVENTS scopes exported as Chrome trace JSON (chrome://tracing, Perfetto).
+// The GPU side owns no Vulkan object: the app writes the timestamps at the query indices it is handed and gives back
+// the results of a query set (value & availability pairs, VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) before reusing it,
+// PROFILER_GPU_FRAMES sets so a set is reused once its frame has retired. The device clock isn't calibrated to the
+// host one, GPU scopes of a frame are laid out in the trace from the CPU time of its submit.
+// Main thread only.
+
+#define PROFILER_INVALID_QUERY 0xFFFFFFFFU
+
+using ProfileClock = std::chrono::steady_clock;
+
+//////////////////////////////// STATISTICS //////////////////////////////////////
+
+// Nearest rank: the smallest sample with at least percentile % of the samples at or below it
+inline double get_profile_percentile(std::span<double const> sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(percentile * static_cast<double>(sorted.size()) / 100.0));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+struct ProfileStats
+{
+    uint32_t samples = 0;
+    double last_ms = 0.0;
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+// Time of a scope in the last frames, a ring of samples
+struct ProfileHistory
+{
+    std::vector<double> samples_ms = {};
+    uint32_t next = 0;
+    uint32_t count = 0;
+    double last_ms = 0.0;
+
+    explicit ProfileHistory(uint32_t capacity) : samples_ms(std::max(capacity, 1U), 0.0) {}
+
+    void add(double ms)
+    {
+        samples_ms[next] = ms;
+        next = (next + 1) % static_cast<uint32_t>(samples_ms.size());
+        count = std::min(count + 1, static_cast<uint32_t>(samples_ms.size()));
+        last_ms = ms;
+    }
+
+    ProfileStats get_stats() const
+    {
+        ProfileStats stats = {.samples = count, .last_ms = last_ms};
+        if (count == 0)
+            return stats;
+
+        std::vector<double> sorted(samples_ms.begin(), samples_ms.begin() + count);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double sample : sorted)
+            sum += sample;
+        stats.mean_ms = sum / static_cast<double>(count);
+        stats.p50_ms = get_profile_percentile(sorted, 50.0);
+        stats.p99_ms = get_profile_percentile(sorted, 99.0);
+        stats.max_ms = sorted.back();
+        return stats;
+    }
+};
+
+//////////////////////////////// PROFILER //////////////////////////////////////
+
+enum class ProfileTrack : uint32_t
+{
+    CPU = 0,
+    GPU = 1,
+};
+
+struct ProfileScopeInfo
+{
+    std::string name = {};
+    ProfileTrack track = ProfileTrack::CPU;
+    uint32_t depth = 0; // nesting of its last use
+    ProfileHistory history;
+    double frame_ms = 0.0; // summed over the uses of the current frame
+    bool used = false;
+};
+
+// A closed scope of the trace, in microseconds since the profiler was created
+struct ProfileEvent
+{
+    uint32_t scope = 0;
+    uint32_t depth = 0;
+    uint64_t frame = 0;
+    double start_us = 0.0;
+    double duration_us = 0.0;
+};
+
+struct ProfileReportRow
+{
+    std::string_view name = {};
+    ProfileTrack track = ProfileTrack::CPU;
+    uint32_t depth = 0;
+    ProfileStats stats = {};
+};
+
+struct ProfileQueryRange
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+class FrameProfiler
+{
+    // Timestamp pair of a GPU scope, queries first & first + 1 of its set
+    struct GpuScope
+    {
+        uint32_t scope = 0;
+        uint32_t depth = 0;
+        uint32_t first_query = 0;
+    };
+
+    struct GpuFrame
+    {
+        uint64_t frame = 0;
+        double submit_us = 0.0;
+        std::vector<GpuScope> scopes = {};
+        bool pending = false; // submitted, results not read back yet
+    };
+
+    struct OpenScope
+    {
+        uint32_t scope = 0;
+        double start_us = 0.0;
+    };
+
+    ProfileClock::time_point epoch = ProfileClock::now();
+    uint32_t history_frames = 0;
+    uint32_t max_gpu_scopes = 0;
+    size_t max_trace_events = 0;
+
+    std::vector<ProfileScopeInfo> scopes = {};
+    std::map<std::string, uint32_t, std::less<>> scope_indices[2] = {};
+    std::vector<OpenScope> open_cpu_scopes = {};
+    std::deque<ProfileEvent> events = {};
+    uint64_t frame = 0;
+
+    std::vector<GpuFrame> gpu_frames = {};
+    uint32_t current_gpu_frame = PROFILER_INVALID_QUERY;
+    std::vector<uint32_t> open_gpu_scopes = {}; // indices in the scopes of the current GPU frame
+    uint32_t dropped_gpu_frames = 0;
+
+    uint32_t get_scope(std::string_view name, ProfileTrack track)
+    {
+        auto &indices = scope_indices[static_cast<uint32_t>(track)];
+        auto it = indices.find(name);
+        if (it != indices.end())
+            return it->second;
+
+        uint32_t index = static_cast<uint32_t>(scopes.size());
+        scopes.push_back(ProfileScopeInfo{.name = std::string(name), .track = track, .history = ProfileHistory(history_frames)});
+        indices.emplace(std::string(name), index);
+        return index;
+    }
+
+    void add_event(ProfileEvent const &event)
+    {
+        if (max_trace_events == 0)
+            return;
+        if (events.size() == max_trace_events)
+            events.pop_front();
+        events.push_back(event);
+    }
+
+    void add_frame_time(uint32_t scope, double ms)
+    {
+        scopes[scope].frame_ms += ms;
+        scopes[scope].used = true;
+    }
+
+    // Sums of the scopes of a track used since the last flush go into their histories
+    void flush_frame_times(ProfileTrack track)
+    {
+        for (auto &scope : scopes)
+        {
+            if (scope.track != track || !scope.used)
+                continue;
+            scope.history.add(scope.frame_ms);
+            scope.frame_ms = 0.0;
+            scope.used = false;
+        }
+    }
+
+public:
+    explicit FrameProfiler(uint32_t history_frames = PROFILER_HISTORY_FRAMES, uint32_t gpu_frame_count = PROFILER_GPU_FRAMES,
+                           uint32_t max_gpu_scopes = PROFILER_MAX_GPU_SCOPES, size_t max_trace_events = PROFILER_MAX_TRACE_EVENTS)
+        : history_frames(history_frames), max_gpu_scopes(max_gpu_scopes), max_trace_events(max_trace_events),
+          gpu_frames(std::max(gpu_frame_count, 1U))
+    {
+    }
+
+    double get_time_us() const
+    {
+        return std::chrono::duration<double, std::micro>(ProfileClock::now() - epoch).count();
+    }
+
+    uint64_t get_frame() const { return frame; }
+    uint32_t get_dropped_gpu_frames() const { return dropped_gpu_frames; }
+    size_t get_event_count() const { return events.size(); }
+    std::deque<ProfileEvent> const &get_events() const { return events; }
+    std::string_view get_scope_name(uint32_t scope) const { return scopes[scope].name; }
+    ProfileTrack get_scope_track(uint32_t scope) const { return scopes[scope].track; }
+
+    ProfileStats get_stats(std::string_view name, ProfileTrack track) const
+    {
+        auto const &indices = scope_indices[static_cast<uint32_t>(track)];
+        auto it = indices.find(name);
+        return it != indices.end() ? scopes[it->second].history.get_stats() : ProfileStats{};
+    }
+
+    //////////////////////////////// CPU //////////////////////////////////////
+
+    // Times are explicit for replays & checks, the overloads without one read the clock
+    void begin_cpu_scope(std::string_view name, double time_us)
+    {
+        uint32_t scope = get_scope(name, ProfileTrack::CPU);
+        scopes[scope].depth = static_cast<uint32_t>(open_cpu_scopes.size());
+        open_cpu_scopes.push_back({.scope = scope, .start_us = time_us});
+    }
+
+    void end_cpu_scope(double time_us)
+    {
+        if (open_cpu_scopes.empty())
+        {
+#if WARN == 1
+            std::cerr << "FrameProfiler: end_cpu_scope without a scope" << std::endl;
+#endif // WARN
+            return;
+        }
+        OpenScope open = open_cpu_scopes.back();
+        open_cpu_scopes.pop_back();
+        double duration_us = std::max(time_us - open.start_us, 0.0);
+        add_frame_time(open.scope, duration_us * 1e-3);
+        add_event({.scope = open.scope,
+                   .depth = static_cast<uint32_t>(open_cpu_scopes.size()),
+                   .frame = frame,
+                   .start_us = open.start_us,
+                   .duration_us = duration_us});
+    }
+
+    void begin_cpu_scope(std::string_view name) { begin_cpu_scope(name, get_time_us()); }
+    void end_cpu_scope() { end_cpu_scope(get_time_us()); }
+
+    // The whole frame is the outermost CPU scope
+    void begin_frame(double time_us) { begin_cpu_scope("frame", time_us); }
+
+    void end_frame(double time_us)
+    {
+        // Scopes left open (early returns) end with the frame
+        while (!open_cpu_scopes.empty())
+            end_cpu_scope(time_us);
+        flush_frame_times(ProfileTrack::CPU);
+        ++frame;
+    }
+
+    void begin_frame() { begin_frame(get_time_us()); }
+    void end_frame() { end_frame(get_time_us()); }
+
+    //////////////////////////////// GPU //////////////////////////////////////
+
+    // Size of the timestamp query pool
+    uint32_t get_gpu_query_count() const { return static_cast<uint32_t>(gpu_frames.size()) * max_gpu_scopes * 2; }
+
+    // Results are value & availability pairs of the count queries of the set (2 * count u64), frames with a missing
+    // or reversed timestamp are dropped
+    bool resolve_gpu_frame(uint32_t set, std::span<uint64_t const> results, double timestamp_period_ns)
+    {
+        GpuFrame &gpu_frame = gpu_frames[set];
+        if (!gpu_frame.pending)
+            return false;
+        gpu_frame.pending = false;
+        if (gpu_frame.scopes.empty())
+            return true;
+
+        uint64_t first_tick = ~0ULL;
+        for (auto const &gpu_scope : gpu_frame.scopes)
+        {
+            size_t begin = 2 * static_cast<size_t>(gpu_scope.first_query);
+            if (begin + 3 >= results.size() || results[begin + 1] == 0 || results[begin + 3] == 0 || results[begin + 2] < results[begin])
+            {
+                ++dropped_gpu_frames;
+                return false;
+            }
+            first_tick = std::min(first_tick, results[begin]);
+        }
+
+        for (auto const &gpu_scope : gpu_frame.scopes)
+        {
+            size_t begin = 2 * static_cast<size_t>(gpu_scope.first_query);
+            double duration_us = static_cast<double>(results[begin + 2] - results[begin]) * timestamp_period_ns * 1e-3;
+            add_frame_time(gpu_scope.scope, duration_us * 1e-3);
+            add_event({.scope = gpu_scope.scope,
+                       .depth = gpu_scope.depth,
+                       .frame = gpu_frame.frame,
+                       .start_us = gpu_frame.submit_us + static_cast<double>(results[begin] - first_tick) * timestamp_period_ns * 1e-3,
+                       .duration_us = duration_us});
+        }
+        flush_frame_times(ProfileTrack::GPU);
+        return true;
+    }
+
+    // Starts recording the scopes of a frame in its query set. A set still pending is resolved first with
+    // read_queries(first, count), which returns the results of those queries. The returned range has to be reset
+    // before its timestamps are written.
+    template <typename ReadQueries>
+    ProfileQueryRange begin_gpu_frame(uint64_t gpu_frame_number, double timestamp_period_ns, ReadQueries &&read_queries)
+    {
+        uint32_t set = static_cast<uint32_t>(gpu_frame_number % gpu_frames.size());
+        ProfileQueryRange range = {.first = set * max_gpu_scopes * 2, .count = max_gpu_scopes * 2};
+        if (gpu_frames[set].pending)
+        {
+            auto results = read_queries(range.first, range.count);
+            resolve_gpu_frame(set, std::span<uint64_t const>(results.data(), results.size()), timestamp_period_ns);
+        }
+
+        gpu_frames[set].frame = gpu_frame_number;
+        gpu_frames[set].scopes.clear();
+        current_gpu_frame = set;
+        open_gpu_scopes.clear();
+        return range;
+    }
+
+    // Query index of the first timestamp, PROFILER_INVALID_QUERY outside a frame or past PROFILER_MAX_GPU_SCOPES
+    uint32_t begin_gpu_scope(std::string_view name)
+    {
+        if (current_gpu_frame == PROFILER_INVALID_QUERY)
+            return PROFILER_INVALID_QUERY;
+        GpuFrame &gpu_frame = gpu_frames[current_gpu_frame];
+        if (gpu_frame.scopes.size() == max_gpu_scopes)
+        {
+            open_gpu_scopes.push_back(PROFILER_INVALID_QUERY);
+            return PROFILER_INVALID_QUERY;
+        }
+
+        uint32_t scope = get_scope(name, ProfileTrack::GPU);
+        uint32_t depth = static_cast<uint32_t>(open_gpu_scopes.size());
+        scopes[scope].depth = depth;
+        open_gpu_scopes.push_back(static_cast<uint32_t>(gpu_frame.scopes.size()));
+        gpu_frame.scopes.push_back({.scope = scope, .depth = depth, .first_query = static_cast<uint32_t>(gpu_frame.scopes.size()) * 2});
+        return current_gpu_frame * max_gpu_scopes * 2 + gpu_frame.scopes.back().first_query;
+    }
+
+    // Query index of the second timestamp of the innermost open scope
+    uint32_t end_gpu_scope()
+    {
+        if (current_gpu_frame == PROFILER_INVALID_QUERY || open_gpu_scopes.empty())
+            return PROFILER_INVALID_QUERY;
+        uint32_t index = open_gpu_scopes.back();
+        open_gpu_scopes.pop_back();
+        if (index == PROFILER_INVALID_QUERY)
+            return PROFILER_INVALID_QUERY;
+        return current_gpu_frame * max_gpu_scopes * 2 + gpu_frames[current_gpu_frame].scopes[index].first_query + 1;
+    }
+
+    // The commands of the frame were submitted, its set is read back before reuse
+    void submit_gpu_frame(double time_us)
+    {
+        if (current_gpu_frame == PROFILER_INVALID_QUERY)
+            return;
+        if (!open_gpu_scopes.empty())
+        {
+#if WARN == 1
+            std::cerr << "FrameProfiler: GPU frame submitted with open scopes, dropped" << std::endl;
+#endif // WARN
+            gpu_frames[current_gpu_frame].scopes.clear();
+        }
+        gpu_frames[current_gpu_frame].submit_us = time_us;
+        gpu_frames[current_gpu_frame].pending = true;
+        current_gpu_frame = PROFILER_INVALID_QUERY;
+        open_gpu_scopes.clear();
+    }
+
+    void submit_gpu_frame() { submit_gpu_frame(get_time_us()); }
+
+    //////////////////////////////// OUTPUT //////////////////////////////////////
+
+    // CPU scopes then GPU ones, each in order of first use
+    std::vector<ProfileReportRow> get_report() const
+    {
+        std::vector<ProfileReportRow> rows = {};
+        for (ProfileTrack track : {ProfileTrack::CPU, ProfileTrack::GPU})
+            for (auto const &scope : scopes)
+                if (scope.track == track)
+                    rows.push_back({.name = scope.name, .track = track, .depth = scope.depth, .stats = scope.history.get_stats()});
+        return rows;
+    }
+
+    void write_report(std::ostream &out) const
+    {
+        auto flags = out.flags();
+        auto precision = out.precision();
+        out << "frame " << frame << ", statistics over the last " << history_frames << " frames, dropped GPU frames: " << dropped_gpu_frames << std::endl;
+        out << std::left << std::setw(28) << "scope (ms)" << std::right << std::setw(10) << "last" << std::setw(10) << "mean"
+            << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+        out << std::fixed << std::setprecision(3);
+        for (auto const &row : get_report())
+        {
+            std::string name = std::string(row.track == ProfileTrack::CPU ? "cpu " : "gpu ") + std::string(2 * row.depth, ' ') + std::string(row.name);
+            out << std::left << std::setw(28) << name << std::right << std::setw(10) << row.stats.last_ms << std::setw(10) << row.stats.mean_ms
+                << std::setw(10) << row.stats.p50_ms << std::setw(10) << row.stats.p99_ms << std::setw(10) << row.stats.max_ms << std::endl;
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    static void write_json_string(std::ostream &out, std::string_view value)
+    {
+        static char const hex[] = "0123456789abcdef";
+        out << '"';
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << "\\u00" << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    // Complete events ("ph": "X") in microseconds, CPU scopes on thread 1 & GPU ones on thread 2 of process 1
+    void write_chrome_trace(std::ostream &out) const
+    {
+        auto flags = out.flags();
+        auto precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"cube-tracing\"}},\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU main thread\"}},\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU (from the submits)\"}}";
+        for (auto const &event : events)
+        {
+            bool gpu = scopes[event.scope].track == ProfileTrack::GPU;
+            out << ",\n{\"name\":";
+            write_json_string(out, scopes[event.scope].name);
+            out << ",\"cat\":\"" << (gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us
+                << ",\"pid\":1,\"tid\":" << (gpu ? 2 : 1) << ",\"args\":{\"frame\":" << event.frame << ",\"depth\":" << event.depth << "}}";
+        }
+        out << "\n]}\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    bool write_chrome_trace(std::filesystem::path const &path) const
+    {
+        std::ofstream out(path);
+        if (!out.is_open())
+        {
+#if WARN == 1
+            std::cerr << "FrameProfiler: could not open " << path.string() << std::endl;
+#endif // WARN
+            return false;
+        }
+        write_chrome_trace(out);
+        return out.good();
+    }
+};
+
+// Times the enclosing block on the CPU track
+struct ProfileScope
+{
+    FrameProfiler &profiler;
+
+    ProfileScope(FrameProfiler &profiler, std::string_view name) : profiler(profiler) { profiler.begin_cpu_scope(name); }
+    ~ProfileScope() { profiler.end_cpu_scope(); }
+
+    ProfileScope(ProfileScope const &) = delete;
+    ProfileScope &operator=(ProfileScope const &) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#if PROFILER_ON == 1
+#define PROFILE_CPU_SCOPE(profiler, name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(profiler, name)
+#else
+#define PROFILE_CPU_SCOPE(profiler, name)
+#endif // PROFILER_ON
@@ -0,0 +1,227 @@
+#pragma once
+#include "defines.h"
+#include "host_scene.hpp"
+#include "host_bvh.hpp"
+#include "tile_pool.hpp"
+
+// Two level acceleration structure mirroring the GPU layout: one BVH per INSTANCE over its
+// object space AABBs (BLAS) and one over the world bounds of the instances (TLAS).
+// Primitives are tested with the same box the intersection shader builds.
+struct HostAccel
+{
+public:
+    void build(HostScene const &host_scene, TilePool &pool)
+    {
+        scene = &host_scene;
+        uint32_t instance_count = static_cast<uint32_t>(scene->instances.size());
+        instances = std::vector<InstanceAccel>(instance_count);
+
+        pool.run(instance_count, [&](uint32_t instance_index, uint32_t)
+                 {
+            INSTANCE const &instance = scene->instances[instance_index];
+            InstanceAccel &accel = instances[instance_index];
+            accel.obj2world = daxa_f32mat4x4_to_glm_mat4(instance.transform);
+            accel.world2obj = glm::inverse(accel.obj2world);
+            accel.normal_matrix = glm::transpose(glm::mat3(accel.world2obj));
+
+            AABB const *aabbs = scene->aabbs.data() + instance.first_primitive_index;
+            accel.blas.build(instance.primitive_count, [&](uint32_t i, glm::vec3 &minimum, glm::vec3 &maximum)
+                             {
+                HostBox box = get_primitive_box(aabbs[i]);
+                minimum = box.center - box.radius;
+                maximum = box.center + box.radius; });
+
+            // World bounds of the root for the TLAS
+            accel.world_min = glm::vec3(std::numeric_limits<float>::max());
+            accel.world_max = glm::vec3(-std::numeric_limits<float>::max());
+            if (accel.blas.empty())
+                return;
+            HostBvhNode const &root = accel.blas.nodes[0];
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                glm::vec3 position = glm::vec3(accel.obj2world * glm::vec4(corner & 1 ? root.maximum.x : root.minimum.x,
+                                                                           corner & 2 ? root.maximum.y : root.minimum.y,
+                                                                           corner & 4 ? root.maximum.z : root.minimum.z, 1.0f));
+                accel.world_min = glm::min(accel.world_min, position);
+                accel.world_max = glm::max(accel.world_max, position);
+            } });
+
+        tlas.build(instance_count, [&](uint32_t i, glm::vec3 &minimum, glm::vec3 &maximum)
+                   {
+            minimum = instances[i].world_min;
+            maximum = instances[i].world_max; });
+
+#if INFO == 1
+        uint64_t node_count = tlas.nodes.size();
+        for (auto const &accel : instances)
+            node_count += accel.blas.nodes.size();
+        std::cout << "HostAccel: " << instance_count << " instances, " << scene->get_primitive_count()
+                  << " primitives, " << node_count << " nodes" << std::endl;
+#endif // INFO
+    }
+
+    auto get_memory_size() const -> size_t
+    {
+        size_t size = tlas.nodes.size() * sizeof(HostBvhNode);
+        for (auto const &accel : instances)
+            size += accel.blas.nodes.size() * sizeof(HostBvhNode) + accel.blas.indices.size() * sizeof(uint32_t);
+        return size;
+    }
+
+    // Closest hit in (t_min, t_max), the primitive in ignore is skipped (shadow rays towards a light)
+    bool intersect(HostRay const &ray, float t_min, float t_max, HostHit &hit,
+                   OBJECT_INFO ignore = {MAX_INSTANCES, MAX_PRIMITIVES}) const
+    {
+        bool found = false;
+        trace(ray, t_min, t_max, ignore, false, [&](uint32_t instance_index, uint32_t primitive_id, float distance, glm::vec3 const &normal)
+              {
+            found = true;
+            hit.distance = distance;
+            hit.object = OBJECT_INFO(instance_index, primitive_id);
+            hit.primitive_index = scene->instances[instance_index].first_primitive_index + primitive_id;
+            hit.normal = normal; });
+
+        if (found)
+        {
+            hit.position = ray.origin + ray.direction * hit.distance;
+            hit.normal = glm::normalize(instances[hit.object.instance_id].normal_matrix * hit.normal);
+        }
+        return found;
+    }
+
+    // Any hit in (t_min, t_max)
+    bool occluded(HostRay const &ray, float t_min, float t_max,
+                  OBJECT_INFO ignore = {MAX_INSTANCES, MAX_PRIMITIVES}) const
+    {
+        bool found = false;
+        trace(ray, t_min, t_max, ignore, true, [&](uint32_t, uint32_t, float, glm::vec3 const &)
+              { found = true; });
+        return found;
+    }
+
+    // Hit of the ray with one primitive, without traversal (primitives.glsl is_hit_from_ray), the ray may start inside
+    bool intersect_primitive(HostRay const &ray, OBJECT_INFO object, HostHit &hit) const
+    {
+        if (object.instance_id >= instances.size() || object.primitive_id >= scene->instances[object.instance_id].primitive_count)
+            return false;
+
+        InstanceAccel const &accel = instances[object.instance_id];
+        uint32_t primitive_index = scene->instances[object.instance_id].first_primitive_index + object.primitive_id;
+        HostRay obj_ray = {
+            .origin = glm::vec3(accel.world2obj * glm::vec4(ray.origin, 1.0f)),
+            .direction = glm::vec3(accel.world2obj * glm::vec4(ray.direction, 0.0f)),
+        };
+
+        float distance = 0.0f;
+        glm::vec3 normal = {};
+        if (!intersect_box(get_primitive_box(scene->aabbs[primitive_index]), obj_ray, distance, normal, true, true, safe_inverse(obj_ray.direction)))
+            return false;
+
+        hit.distance = distance;
+        hit.object = object;
+        hit.primitive_index = primitive_index;
+        hit.position = ray.origin + ray.direction * distance;
+        hit.normal = glm::normalize(accel.normal_matrix * normal);
+        return true;
+    }
+
+    auto get_scene() const -> HostScene const & { return *scene; }
+
+private:
+    struct InstanceAccel
+    {
+        glm::mat4 obj2world = glm::mat4(1.0f);
+        glm::mat4 world2obj = glm::mat4(1.0f);
+        glm::mat3 normal_matrix = glm::mat3(1.0f);
+        glm::vec3 world_min = {0.0f, 0.0f, 0.0f};
+        glm::vec3 world_max = {0.0f, 0.0f, 0.0f};
+        HostBvh blas = {};
+    };
+
+    template <typename OnHit>
+    void trace(HostRay const &ray, float t_min, float t_max, OBJECT_INFO ignore, bool any_hit, OnHit &&on_hit) const
+    {
+        glm::vec3 inv_direction = safe_inverse(ray.direction);
+
+        tlas.traverse(ray.origin, inv_direction, t_min, t_max, [&](uint32_t instance_index, float &closest) -> bool
+                      {
+            InstanceAccel const &accel = instances[instance_index];
+            INSTANCE const &instance = scene->instances[instance_index];
+            AABB const *aabbs = scene->aabbs.data() + instance.first_primitive_index;
+
+            // Same object space ray the intersection shader builds, t is shared with world space
+            HostRay obj_ray = {
+                .origin = glm::vec3(accel.world2obj * glm::vec4(ray.origin, 1.0f)),
+                .direction = glm::vec3(accel.world2obj * glm::vec4(ray.direction, 0.0f)),
+            };
+            glm::vec3 obj_inv_direction = safe_inverse(obj_ray.direction);
+
+            bool stop = false;
+            accel.blas.traverse(obj_ray.origin, obj_inv_direction, t_min, closest, [&](uint32_t primitive_id, float &blas_closest) -> bool
+                                {
+                if (instance_index == ignore.instance_id && primitive_id == ignore.primitive_id)
+                    return false;
+
+                float distance = 0.0f;
+                glm::vec3 normal = {};
+                if (!intersect_box(get_primitive_box(aabbs[primitive_id]), obj_ray, distance, normal, true, true, obj_inv_direction))
+                    return false;
+                if (distance <= t_min || distance >= blas_closest)
+                    return false;
+
+                blas_closest = distance;
+                closest = distance;
+                on_hit(instance_index, primitive_id, distance, normal);
+                stop = any_hit;
+                return stop; });
+            return stop; });
+    }
+
+    HostScene const *scene = nullptr;
+    std::vector<InstanceAccel> instances = {};
+    HostBvh tlas = {};
+};
+
+// HIT_INFO of a closest hit as the shaders fill it: exit distance & face UV of the primitive box, object space hit
+inline HIT_INFO get_hit_info(HostScene const &scene, HostRay const &ray, HostHit const &hit)
+{
+    // Same defaults as the shaders
+    HIT_INFO info = {
+        .is_hit = false,
+        .hit_distance = -1.0f,
+        .exit_distance = -1.0f,
+        .world_hit = {0.0f, 0.0f, 0.0f},
+        .world_nrm = {0.0f, 0.0f, 0.0f},
+        .obj_hit = {0.0f, 0.0f, 0.0f},
+        .instance_hit = {MAX_INSTANCES, MAX_PRIMITIVES},
+        .primitive_center = {0.0f, 0.0f, 0.0f},
+        .material_index = 0,
+        .uv = {0.0f, 0.0f},
+    };
+
+    glm::mat4 world2obj = glm::inverse(daxa_f32mat4x4_to_glm_mat4(scene.instances[hit.object.instance_id].transform));
+    HostRay obj_ray = {
+        .origin = glm::vec3(world2obj * glm::vec4(ray.origin, 1.0f)),
+        .direction = glm::vec3(world2obj * glm::vec4(ray.direction, 0.0f)),
+    };
+
+    HostBox box = get_primitive_box(scene.aabbs[hit.primitive_index]);
+    float distance = 0.0f, exit_distance = 0.0f;
+    glm::vec3 normal = {};
+    glm::vec2 uv = {};
+    if (!intersect_box_two_hits_and_uv(box, obj_ray, distance, exit_distance, normal, true, safe_inverse(obj_ray.direction), uv))
+        return info;
+
+    glm::vec3 obj_hit = obj_ray.origin + obj_ray.direction * distance;
+    info.is_hit = true;
+    info.hit_distance = hit.distance;
+    info.exit_distance = exit_distance;
+    info.world_hit = {hit.position.x, hit.position.y, hit.position.z};
+    info.world_nrm = {hit.normal.x, hit.normal.y, hit.normal.z};
+    info.obj_hit = {obj_hit.x, obj_hit.y, obj_hit.z};
+    info.instance_hit = hit.object;
+    info.primitive_center = {box.center.x, box.center.y, box.center.z};
+    info.material_index = scene.primitives[hit.primitive_index].material_index;
+    info.uv = {uv.x, uv.y};
+    return info;
+}
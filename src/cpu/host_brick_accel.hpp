@@ -0,0 +1,186 @@
+#pragma once
+#include "defines.h"
+#include "host_accel.hpp"
+#include "brick_primitives.hpp"
+
+// Same queries as HostAccel with the layout of BRICK_PRIMITIVES_ON: the BLAS of an instance is built over
+// its brick AABBs and every brick hit is walked with the brick DDA of the intersection shader (rint.glsl).
+// Hits report the packed primitive id of the shaders: (brick << BRICK_VOXEL_BITS) | voxel bit,
+// HostHit::primitive_index is left unset, the voxel is read with get_voxel.
+// Voxels are edited by flipping their occupancy bit, nothing is rebuilt.
+struct HostBrickAccel
+{
+public:
+    void build(HostScene const &host_scene, TilePool &pool)
+    {
+        scene = &host_scene;
+        uint32_t instance_count = static_cast<uint32_t>(scene->instances.size());
+        instances = std::vector<InstanceBricks>(instance_count);
+
+        pool.run(instance_count, [&](uint32_t instance_index, uint32_t)
+                 {
+            INSTANCE const &instance = scene->instances[instance_index];
+            InstanceBricks &accel = instances[instance_index];
+            accel.obj2world = daxa_f32mat4x4_to_glm_mat4(instance.transform);
+            accel.world2obj = glm::inverse(accel.obj2world);
+            accel.normal_matrix = glm::transpose(glm::mat3(accel.world2obj));
+            accel.bricks.build(scene->aabbs.data() + instance.first_primitive_index,
+                               scene->primitives.data() + instance.first_primitive_index, instance.primitive_count);
+
+            accel.blas.build(static_cast<uint32_t>(accel.bricks.aabbs.size()), [&](uint32_t i, glm::vec3 &minimum, glm::vec3 &maximum)
+                             {
+                AABB const &aabb = accel.bricks.aabbs[i];
+                minimum = {aabb.minimum.x, aabb.minimum.y, aabb.minimum.z};
+                maximum = {aabb.maximum.x, aabb.maximum.y, aabb.maximum.z}; });
+
+            // World bounds of the root for the TLAS
+            accel.world_min = glm::vec3(std::numeric_limits<float>::max());
+            accel.world_max = glm::vec3(-std::numeric_limits<float>::max());
+            if (accel.blas.empty())
+                return;
+            HostBvhNode const &root = accel.blas.nodes[0];
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                glm::vec3 position = glm::vec3(accel.obj2world * glm::vec4(corner & 1 ? root.maximum.x : root.minimum.x,
+                                                                           corner & 2 ? root.maximum.y : root.minimum.y,
+                                                                           corner & 4 ? root.maximum.z : root.minimum.z, 1.0f));
+                accel.world_min = glm::min(accel.world_min, position);
+                accel.world_max = glm::max(accel.world_max, position);
+            } });
+
+        tlas.build(instance_count, [&](uint32_t i, glm::vec3 &minimum, glm::vec3 &maximum)
+                   {
+            minimum = instances[i].world_min;
+            maximum = instances[i].world_max; });
+
+#if INFO == 1
+        size_t brick_count = 0;
+        for (auto const &accel : instances)
+            brick_count += accel.bricks.bricks.size();
+        std::cout << "HostBrickAccel: " << instance_count << " instances, " << brick_count << " bricks, "
+                  << (get_memory_size() >> 10) << " KiB" << std::endl;
+#endif // INFO
+    }
+
+    auto get_memory_size() const -> size_t
+    {
+        size_t size = tlas.nodes.size() * sizeof(HostBvhNode);
+        for (auto const &accel : instances)
+            size += accel.blas.nodes.size() * sizeof(HostBvhNode) + accel.blas.indices.size() * sizeof(uint32_t) +
+                    accel.bricks.aabbs.size() * (sizeof(AABB) + sizeof(BRICK));
+        return size;
+    }
+
+    auto get_brick_count() const -> size_t
+    {
+        size_t count = 0;
+        for (auto const &accel : instances)
+            count += accel.bricks.bricks.size();
+        return count;
+    }
+
+    // Packed primitive id of a primitive of the host scene (first voxel of merged boxes)
+    auto get_voxel_id(uint32_t instance_index, uint32_t primitive_id) const -> uint32_t
+    {
+        return instances[instance_index].bricks.voxel_ids[primitive_id];
+    }
+
+    auto get_voxel(OBJECT_INFO object) const -> PRIMITIVE const &
+    {
+        BRICK const &brick = instances[object.instance_id].bricks.bricks[HostBrickPrimitives::get_brick_id(object.primitive_id)];
+        return brick.voxels[HostBrickPrimitives::get_voxel_bit(object.primitive_id)];
+    }
+
+    // Brush edits: the brick AABB & BLAS stay, only the occupancy bit changes
+    void set_voxel(OBJECT_INFO object, PRIMITIVE const &voxel)
+    {
+        BRICK &brick = instances[object.instance_id].bricks.bricks[HostBrickPrimitives::get_brick_id(object.primitive_id)];
+        HostBrickPrimitives::set_voxel(brick, HostBrickPrimitives::get_voxel_bit(object.primitive_id), voxel);
+    }
+
+    void clear_voxel(OBJECT_INFO object)
+    {
+        BRICK &brick = instances[object.instance_id].bricks.bricks[HostBrickPrimitives::get_brick_id(object.primitive_id)];
+        HostBrickPrimitives::clear_voxel(brick, HostBrickPrimitives::get_voxel_bit(object.primitive_id));
+    }
+
+    // Closest hit in (t_min, t_max)
+    bool intersect(HostRay const &ray, float t_min, float t_max, HostHit &hit) const
+    {
+        bool found = false;
+        trace(ray, t_min, t_max, false, [&](uint32_t instance_index, uint32_t primitive_id, float distance, glm::vec3 const &normal)
+              {
+            found = true;
+            hit.distance = distance;
+            hit.object = OBJECT_INFO(instance_index, primitive_id);
+            hit.normal = normal; });
+
+        if (found)
+        {
+            hit.position = ray.origin + ray.direction * hit.distance;
+            hit.normal = glm::normalize(instances[hit.object.instance_id].normal_matrix * hit.normal);
+        }
+        return found;
+    }
+
+    // Any hit in (t_min, t_max)
+    bool occluded(HostRay const &ray, float t_min, float t_max) const
+    {
+        bool found = false;
+        trace(ray, t_min, t_max, true, [&](uint32_t, uint32_t, float, glm::vec3 const &)
+              { found = true; });
+        return found;
+    }
+
+    auto get_scene() const -> HostScene const & { return *scene; }
+
+private:
+    struct InstanceBricks
+    {
+        glm::mat4 obj2world = glm::mat4(1.0f);
+        glm::mat4 world2obj = glm::mat4(1.0f);
+        glm::mat3 normal_matrix = glm::mat3(1.0f);
+        glm::vec3 world_min = {0.0f, 0.0f, 0.0f};
+        glm::vec3 world_max = {0.0f, 0.0f, 0.0f};
+        HostBrickPrimitives bricks = {};
+        HostBvh blas = {};
+    };
+
+    template <typename OnHit>
+    void trace(HostRay const &ray, float t_min, float t_max, bool any_hit, OnHit &&on_hit) const
+    {
+        glm::vec3 inv_direction = safe_inverse(ray.direction);
+
+        tlas.traverse(ray.origin, inv_direction, t_min, t_max, [&](uint32_t instance_index, float &closest) -> bool
+                      {
+            InstanceBricks const &accel = instances[instance_index];
+
+            // Same object space ray the intersection shader builds, t is shared with world space
+            HostRay obj_ray = {
+                .origin = glm::vec3(accel.world2obj * glm::vec4(ray.origin, 1.0f)),
+                .direction = glm::vec3(accel.world2obj * glm::vec4(ray.direction, 0.0f)),
+            };
+            glm::vec3 obj_inv_direction = safe_inverse(obj_ray.direction);
+
+            bool stop = false;
+            accel.blas.traverse(obj_ray.origin, obj_inv_direction, t_min, closest, [&](uint32_t brick_id, float &blas_closest) -> bool
+                                {
+                float distance = 0.0f;
+                glm::vec3 normal = {};
+                uint32_t bit = 0;
+                if (!HostBrickPrimitives::intersect_brick(accel.bricks.aabbs[brick_id], accel.bricks.bricks[brick_id], obj_ray, obj_inv_direction,
+                                                          t_min, blas_closest, distance, normal, bit))
+                    return false;
+
+                blas_closest = distance;
+                closest = distance;
+                on_hit(instance_index, HostBrickPrimitives::pack_voxel_id(brick_id, bit), distance, normal);
+                stop = any_hit;
+                return stop; });
+            return stop; });
+    }
+
+    HostScene const *scene = nullptr;
+    std::vector<InstanceBricks> instances = {};
+    HostBvh tlas = {};
+};
@@ -0,0 +1,244 @@
+#pragma once
+#include "defines.h"
+#include "box_intersect.hpp"
+
+#include <array>
+#include <limits>
+#include <numeric>
+
+// Binned SAH bounding volume hierarchy over a list of boxes.
+// Leaves reference a range of indices, inner nodes keep both children next to each other.
+struct HostBvhNode
+{
+    glm::vec3 minimum = {0.0f, 0.0f, 0.0f};
+    uint32_t first = 0; // first child (inner node) or first index (leaf)
+    glm::vec3 maximum = {0.0f, 0.0f, 0.0f};
+    uint32_t count = 0; // 0 for inner nodes
+};
+
+struct HostBvh
+{
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+    static constexpr uint32_t BIN_COUNT = 12;
+    static constexpr uint32_t MAX_STACK_DEPTH = 64;
+
+    std::vector<HostBvhNode> nodes = {};
+    std::vector<uint32_t> indices = {};
+
+    // get_bounds(i, minimum, maximum) fills the bounds of the i-th box
+    template <typename GetBounds>
+    void build(uint32_t count, GetBounds &&get_bounds)
+    {
+        nodes.clear();
+        indices.resize(count);
+        std::iota(indices.begin(), indices.end(), 0);
+        if (count == 0)
+            return;
+
+        boxes_min.resize(count);
+        boxes_max.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+            get_bounds(i, boxes_min[i], boxes_max[i]);
+
+        nodes.reserve(2 * count / MAX_LEAF_SIZE + 1);
+        nodes.push_back(HostBvhNode{.first = 0, .count = count});
+        subdivide(0, 0);
+
+        boxes_min = {};
+        boxes_max = {};
+    }
+
+    bool empty() const { return nodes.empty(); }
+
+    // Slab test against a node, returns the entry distance
+    static bool intersect_node(HostBvhNode const &node, glm::vec3 const &origin, glm::vec3 const &inv_direction,
+                               float t_min, float t_max, float &t_entry)
+    {
+        glm::vec3 t0 = (node.minimum - origin) * inv_direction;
+        glm::vec3 t1 = (node.maximum - origin) * inv_direction;
+        glm::vec3 t_near = glm::min(t0, t1);
+        glm::vec3 t_far = glm::max(t0, t1);
+        t_entry = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, t_min));
+        float t_exit = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, t_max));
+        return t_entry <= t_exit;
+    }
+
+    // Front to back traversal. visit(index, t_max) may shrink t_max on a closer hit
+    // and returns true to end the traversal early (any hit queries)
+    template <typename Visit>
+    void traverse(glm::vec3 const &origin, glm::vec3 const &inv_direction, float t_min, float t_max, Visit &&visit) const
+    {
+        if (nodes.empty())
+            return;
+
+        std::array<uint32_t, MAX_STACK_DEPTH> stack = {};
+        uint32_t stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0)
+        {
+            HostBvhNode const &node = nodes[stack[--stack_size]];
+            float t_entry = 0.0f;
+            if (!intersect_node(node, origin, inv_direction, t_min, t_max, t_entry))
+                continue;
+
+            if (node.count > 0)
+            {
+                for (uint32_t i = 0; i < node.count; ++i)
+                {
+                    if (visit(indices[node.first + i], t_max))
+                        return;
+                }
+                continue;
+            }
+
+            // Push the far child first so the near one is visited next
+            uint32_t near_child = node.first;
+            uint32_t far_child = node.first + 1;
+            float t_near_child = 0.0f, t_far_child = 0.0f;
+            bool hit_near = intersect_node(nodes[near_child], origin, inv_direction, t_min, t_max, t_near_child);
+            bool hit_far = intersect_node(nodes[far_child], origin, inv_direction, t_min, t_max, t_far_child);
+            if (hit_near && hit_far && t_far_child < t_near_child)
+            {
+                std::swap(near_child, far_child);
+                std::swap(hit_near, hit_far);
+            }
+            if (hit_far)
+                stack[stack_size++] = far_child;
+            if (hit_near)
+                stack[stack_size++] = near_child;
+        }
+    }
+
+private:
+    std::vector<glm::vec3> boxes_min = {};
+    std::vector<glm::vec3> boxes_max = {};
+
+    static float get_area(glm::vec3 const &minimum, glm::vec3 const &maximum)
+    {
+        glm::vec3 extent = glm::max(maximum - minimum, glm::vec3(0.0f));
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    void subdivide(uint32_t node_index, uint32_t depth)
+    {
+        HostBvhNode &node = nodes[node_index];
+
+        glm::vec3 centroid_min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 centroid_max = glm::vec3(-std::numeric_limits<float>::max());
+        node.minimum = centroid_min;
+        node.maximum = centroid_max;
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            uint32_t box = indices[i];
+            node.minimum = glm::min(node.minimum, boxes_min[box]);
+            node.maximum = glm::max(node.maximum, boxes_max[box]);
+            glm::vec3 centroid = (boxes_min[box] + boxes_max[box]) * 0.5f;
+            centroid_min = glm::min(centroid_min, centroid);
+            centroid_max = glm::max(centroid_max, centroid);
+        }
+
+        // The traversal stack grows by at most one entry per level
+        if (node.count <= MAX_LEAF_SIZE || depth + 1 >= MAX_STACK_DEPTH)
+            return;
+
+        // Binned SAH along the widest centroid axis
+        glm::vec3 centroid_extent = centroid_max - centroid_min;
+        int axis = centroid_extent.x > centroid_extent.y ? (centroid_extent.x > centroid_extent.z ? 0 : 2) : (centroid_extent.y > centroid_extent.z ? 1 : 2);
+        if (centroid_extent[axis] <= 0.0f)
+            return;
+
+        struct Bin
+        {
+            glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 maximum = glm::vec3(-std::numeric_limits<float>::max());
+            uint32_t count = 0;
+        };
+        std::array<Bin, BIN_COUNT> bins = {};
+        float bin_scale = BIN_COUNT / centroid_extent[axis];
+        auto get_bin = [&](uint32_t box) -> uint32_t
+        {
+            float centroid = (boxes_min[box][axis] + boxes_max[box][axis]) * 0.5f;
+            return std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroid - centroid_min[axis]) * bin_scale));
+        };
+
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            uint32_t box = indices[i];
+            Bin &bin = bins[get_bin(box)];
+            bin.minimum = glm::min(bin.minimum, boxes_min[box]);
+            bin.maximum = glm::max(bin.maximum, boxes_max[box]);
+            ++bin.count;
+        }
+
+        // Sweep from the right, then from the left picking the cheapest split plane
+        std::array<float, BIN_COUNT> right_cost = {};
+        Bin right = {};
+        for (uint32_t i = BIN_COUNT - 1; i > 0; --i)
+        {
+            right.minimum = glm::min(right.minimum, bins[i].minimum);
+            right.maximum = glm::max(right.maximum, bins[i].maximum);
+            right.count += bins[i].count;
+            right_cost[i] = right.count == 0 ? 0.0f : get_area(right.minimum, right.maximum) * right.count;
+        }
+
+        float best_cost = std::numeric_limits<float>::max();
+        uint32_t best_split = 0;
+        Bin left = {};
+        for (uint32_t i = 0; i < BIN_COUNT - 1; ++i)
+        {
+            left.minimum = glm::min(left.minimum, bins[i].minimum);
+            left.maximum = glm::max(left.maximum, bins[i].maximum);
+            left.count += bins[i].count;
+            if (left.count == 0 || left.count == node.count)
+                continue;
+            float cost = get_area(left.minimum, left.maximum) * left.count + right_cost[i + 1];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_split = i + 1;
+            }
+        }
+
+        if (best_split == 0 || best_cost >= get_area(node.minimum, node.maximum) * node.count)
+        {
+            if (node.count <= MAX_LEAF_SIZE * 4)
+                return;
+            // Too many boxes for a leaf, fall back to a median split
+            uint32_t middle = node.first + node.count / 2;
+            std::nth_element(indices.begin() + node.first, indices.begin() + middle, indices.begin() + node.first + node.count,
+                             [&](uint32_t lhs, uint32_t rhs)
+                             { return boxes_min[lhs][axis] + boxes_max[lhs][axis] < boxes_min[rhs][axis] + boxes_max[rhs][axis]; });
+            best_split = middle - node.first;
+        }
+        else
+        {
+            auto middle = std::partition(indices.begin() + node.first, indices.begin() + node.first + node.count,
+                                         [&](uint32_t box)
+                                         { return get_bin(box) < best_split; });
+            best_split = static_cast<uint32_t>(middle - (indices.begin() + node.first));
+        }
+
+        uint32_t first = node.first;
+        uint32_t count = node.count;
+        uint32_t left_child = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(HostBvhNode{.first = first, .count = best_split});
+        nodes.push_back(HostBvhNode{.first = first + best_split, .count = count - best_split});
+
+        // nodes may have been reallocated
+        nodes[node_index].first = left_child;
+        nodes[node_index].count = 0;
+
+        subdivide(left_child, depth + 1);
+        subdivide(left_child + 1, depth + 1);
+    }
+};
+
+struct HostHit
+{
+    float distance = 0.0f;
+    glm::vec3 position = {0.0f, 0.0f, 0.0f};
+    glm::vec3 normal = {0.0f, 0.0f, 0.0f}; // world space, facing back along the ray
+    OBJECT_INFO object = {MAX_INSTANCES, MAX_PRIMITIVES};
+    uint32_t primitive_index = 0; // INSTANCE::first_primitive_index + object.primitive_id
+};
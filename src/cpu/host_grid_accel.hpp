@@ -0,0 +1,151 @@
+#pragma once
+#include "defines.h"
+#include "host_accel.hpp"
+#include "brick_grid.hpp"
+
+// Same queries as HostAccel with a brick grid per INSTANCE instead of a BLAS:
+// the TLAS finds the instances, the ray is walked through the voxels of each one with a DDA
+// and the occupied voxels are tested with the primitive box, so hits are the ones HostAccel reports.
+struct HostGridAccel
+{
+public:
+    void build(HostScene const &host_scene, TilePool &pool)
+    {
+        scene = &host_scene;
+        uint32_t instance_count = static_cast<uint32_t>(scene->instances.size());
+        instances = std::vector<InstanceGrid>(instance_count);
+
+        pool.run(instance_count, [&](uint32_t instance_index, uint32_t)
+                 {
+            INSTANCE const &instance = scene->instances[instance_index];
+            InstanceGrid &grid = instances[instance_index];
+            grid.obj2world = daxa_f32mat4x4_to_glm_mat4(instance.transform);
+            grid.world2obj = glm::inverse(grid.obj2world);
+            grid.normal_matrix = glm::transpose(glm::mat3(grid.world2obj));
+            grid.bricks.build(scene->aabbs.data() + instance.first_primitive_index, instance.primitive_count);
+
+            // World bounds of the grid for the TLAS
+            grid.world_min = glm::vec3(std::numeric_limits<float>::max());
+            grid.world_max = glm::vec3(-std::numeric_limits<float>::max());
+            if (grid.bricks.empty())
+                return;
+            glm::vec3 minimum = glm::vec3(grid.bricks.origin_voxel) * VOXEL_EXTENT;
+            glm::vec3 maximum = minimum + glm::vec3(grid.bricks.brick_count * HostBrickGrid::BRICK_SIZE) * VOXEL_EXTENT;
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                glm::vec3 position = glm::vec3(grid.obj2world * glm::vec4(corner & 1 ? maximum.x : minimum.x,
+                                                                          corner & 2 ? maximum.y : minimum.y,
+                                                                          corner & 4 ? maximum.z : minimum.z, 1.0f));
+                grid.world_min = glm::min(grid.world_min, position);
+                grid.world_max = glm::max(grid.world_max, position);
+            } });
+
+        tlas.build(instance_count, [&](uint32_t i, glm::vec3 &minimum, glm::vec3 &maximum)
+                   {
+            minimum = instances[i].world_min;
+            maximum = instances[i].world_max; });
+
+#if INFO == 1
+        size_t brick_count = 0;
+        for (auto const &grid : instances)
+            brick_count += grid.bricks.bricks.size();
+        std::cout << "HostGridAccel: " << instance_count << " instances, " << brick_count << " bricks, "
+                  << (get_memory_size() >> 10) << " KiB" << std::endl;
+#endif // INFO
+    }
+
+    auto get_memory_size() const -> size_t
+    {
+        size_t size = tlas.nodes.size() * sizeof(HostBvhNode);
+        for (auto const &grid : instances)
+            size += grid.bricks.get_memory_size();
+        return size;
+    }
+
+    // Closest hit in (t_min, t_max), the primitive in ignore is skipped (shadow rays towards a light)
+    bool intersect(HostRay const &ray, float t_min, float t_max, HostHit &hit,
+                   OBJECT_INFO ignore = {MAX_INSTANCES, MAX_PRIMITIVES}) const
+    {
+        bool found = false;
+        trace(ray, t_min, t_max, ignore, false, [&](uint32_t instance_index, uint32_t primitive_id, float distance, glm::vec3 const &normal)
+              {
+            found = true;
+            hit.distance = distance;
+            hit.object = OBJECT_INFO(instance_index, primitive_id);
+            hit.primitive_index = scene->instances[instance_index].first_primitive_index + primitive_id;
+            hit.normal = normal; });
+
+        if (found)
+        {
+            hit.position = ray.origin + ray.direction * hit.distance;
+            hit.normal = glm::normalize(instances[hit.object.instance_id].normal_matrix * hit.normal);
+        }
+        return found;
+    }
+
+    // Any hit in (t_min, t_max)
+    bool occluded(HostRay const &ray, float t_min, float t_max,
+                  OBJECT_INFO ignore = {MAX_INSTANCES, MAX_PRIMITIVES}) const
+    {
+        bool found = false;
+        trace(ray, t_min, t_max, ignore, true, [&](uint32_t, uint32_t, float, glm::vec3 const &)
+              { found = true; });
+        return found;
+    }
+
+    auto get_scene() const -> HostScene const & { return *scene; }
+
+private:
+    struct InstanceGrid
+    {
+        glm::mat4 obj2world = glm::mat4(1.0f);
+        glm::mat4 world2obj = glm::mat4(1.0f);
+        glm::mat3 normal_matrix = glm::mat3(1.0f);
+        glm::vec3 world_min = {0.0f, 0.0f, 0.0f};
+        glm::vec3 world_max = {0.0f, 0.0f, 0.0f};
+        HostBrickGrid bricks = {};
+    };
+
+    template <typename OnHit>
+    void trace(HostRay const &ray, float t_min, float t_max, OBJECT_INFO ignore, bool any_hit, OnHit &&on_hit) const
+    {
+        glm::vec3 inv_direction = safe_inverse(ray.direction);
+
+        tlas.traverse(ray.origin, inv_direction, t_min, t_max, [&](uint32_t instance_index, float &closest) -> bool
+                      {
+            InstanceGrid const &grid = instances[instance_index];
+            INSTANCE const &instance = scene->instances[instance_index];
+            AABB const *aabbs = scene->aabbs.data() + instance.first_primitive_index;
+
+            // Same object space ray the intersection shader builds, t is shared with world space
+            HostRay obj_ray = {
+                .origin = glm::vec3(grid.world2obj * glm::vec4(ray.origin, 1.0f)),
+                .direction = glm::vec3(grid.world2obj * glm::vec4(ray.direction, 0.0f)),
+            };
+            glm::vec3 obj_inv_direction = safe_inverse(obj_ray.direction);
+
+            bool stop = false;
+            grid.bricks.traverse(obj_ray.origin, obj_ray.direction, t_min, closest, [&](uint32_t primitive_id, float &grid_closest) -> bool
+                                 {
+                if (instance_index == ignore.instance_id && primitive_id == ignore.primitive_id)
+                    return false;
+
+                float distance = 0.0f;
+                glm::vec3 normal = {};
+                if (!intersect_box(get_primitive_box(aabbs[primitive_id]), obj_ray, distance, normal, true, true, obj_inv_direction))
+                    return false;
+                if (distance <= t_min || distance >= grid_closest)
+                    return false;
+
+                grid_closest = distance;
+                closest = distance;
+                on_hit(instance_index, primitive_id, distance, normal);
+                stop = any_hit;
+                return stop; });
+            return stop; });
+    }
+
+    HostScene const *scene = nullptr;
+    std::vector<InstanceGrid> instances = {};
+    HostBvh tlas = {};
+};
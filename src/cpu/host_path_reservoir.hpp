@@ -0,0 +1,1077 @@
+#pragma once
+#include "defines.h"
+#include "host_accel.hpp"
+#include "host_shading.hpp"
+#include "reference_tracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Host port of the ReSTIR PT path reservoirs (restir_pt/path_reservoir.glsl), the reconnection & hybrid shift mappings
+// (restir_pt/shift.glsl) and the pairwise spatial reuse of restir_pt/indirect_illumination.glsl, on the PATH_RESERVOIR &
+// RECONNECTION_DATA of shared.inl. Names & formulas follow the GLSL so both sides can be compared line by line, scene
+// lookups (rc vertex reload, visibility) go through HostAccel.
+// Where the shaders are still in progress the port keeps a working version and says so in a NOTE: the light type bits,
+// the rc vertex reload & the rc vertex of the hybrid shift at the first bounce. The temporal update of dynamic scenes
+// (path_tracer_trace_temporal_update) & random replay are not ported, host scenes are static.
+
+// Mirror of include/defines.glsl
+#define HOST_MAX_INFLUENCE_FROM_THE_PAST_THRESHOLD_PT 20.0f
+#define HOST_SHIFT_MAPPING_RECONNECTION 0
+#define HOST_SHIFT_MAPPING_RANDOM_REPLAY 1
+#define HOST_SHIFT_MAPPING_HYBRID 2
+
+// NOTE: the shaders keep the light type in bits 18-19, which truncates GEOMETRY_LIGHT_ANALITIC (4) & GEOMETRY_LIGHT_ENV_MAP (5)
+// so neither test of shift.glsl can pass. The host keeps 3 bits in the unused bits 28-30.
+#define HOST_PATH_LIGHT_TYPE_SHIFT 28
+// A reloaded rc vertex further than this (relative to the length of the connection) from the stored hit entered its
+// primitive through another face: the shift is not invertible there
+#define HOST_RC_VERTEX_EPSILON 1e-3f
+
+// SCENE_PARAMS (include/defines.glsl), defaults of rgen.glsl
+struct HostSceneParams
+{
+    uint32_t light_count = 0;
+    uint32_t object_count = 0;
+    uint32_t max_depth = MAX_DEPTH;
+    bool temporal_update_for_dynamic_scene = true; // not ported
+    uint32_t shift_mapping = HOST_SHIFT_MAPPING_RECONNECTION;
+    uint32_t stategy_flags = 0;
+    bool distance_based_rejection = true;
+    float near_field_distance = HALF_VOXEL_EXTENT * 0.5f;
+    bool roughness_based_rejection = false;
+    float roughness_threshold = 0.2f;
+    bool reject_based_on_jacobian = false;
+    float jacobian_rejection_threshold = 0.1f;
+    bool use_russian_roulette = false;
+    bool compute_environment_light = true;
+    uint32_t neighbor_count = 3;
+    int32_t neighbor_radius = 1;
+};
+
+//////////////////////////////// PATH FLAGS //////////////////////////////////////
+
+// maximum length: 15
+inline void host_path_reservoir_insert_path_length(PATH_RESERVOIR &reservoir, uint32_t path_length)
+{
+    reservoir.path_flags &= ~0xFU;
+    reservoir.path_flags |= (path_length & 0xF);
+}
+
+inline uint32_t host_path_reservoir_get_path_length(uint32_t path_flags)
+{
+    return path_flags & 0xF;
+}
+
+// maximum length: 15
+inline void host_path_reservoir_insert_rc_vertex_length(PATH_RESERVOIR &reservoir, uint32_t rc_vertex_length)
+{
+    reservoir.path_flags &= ~0xF0U;
+    reservoir.path_flags |= (rc_vertex_length & 0xF) << 4;
+}
+
+inline uint32_t host_path_reservoir_get_reconnection_length(uint32_t path_flags)
+{
+    return (path_flags >> 4) & 0xF;
+}
+
+// NOTE: the shaders clear 0x100/0x200, 0x400/0x800 & 0x4000000/0x8000000 but set bits 20/21, 22/23 & 26/27, so these flags
+// can't be reset once set. Same here, the host path builder only sets them once per reservoir.
+inline void host_path_reservoir_insert_is_delta_event(PATH_RESERVOIR &reservoir, bool is_delta, bool before_rc_vertex)
+{
+    reservoir.path_flags &= (before_rc_vertex ? ~(0x100U) : ~(0x200U));
+    if (is_delta)
+        reservoir.path_flags |= 1U << (before_rc_vertex ? 20 : 21);
+}
+
+inline bool host_path_reservoir_is_delta_event(uint32_t path_flags, bool before_rc_vertex)
+{
+    return ((path_flags >> (before_rc_vertex ? 20 : 21)) & 1) != 0;
+}
+
+inline void host_path_reservoir_insert_is_transmission_event(PATH_RESERVOIR &reservoir, bool is_transmission, bool before_rc_vertex)
+{
+    reservoir.path_flags &= (before_rc_vertex ? ~(0x400U) : ~(0x800U));
+    if (is_transmission)
+        reservoir.path_flags |= 1U << (before_rc_vertex ? 22 : 23);
+}
+
+inline bool host_path_reservoir_is_transmission_event(uint32_t path_flags, bool before_rc_vertex)
+{
+    return ((path_flags >> (before_rc_vertex ? 22 : 23)) & 1) != 0;
+}
+
+inline void host_path_reservoir_insert_last_vertex_nee(PATH_RESERVOIR &reservoir, bool last_vertex_nee)
+{
+    reservoir.path_flags &= ~0x10000U;
+    reservoir.path_flags |= (static_cast<uint32_t>(last_vertex_nee) & 1) << 16;
+}
+
+inline bool host_path_reservoir_last_vertex_NEE(uint32_t path_flags)
+{
+    return ((path_flags >> 16) & 1) != 0;
+}
+
+inline void host_path_reservoir_insert_is_specular_bounce(PATH_RESERVOIR &reservoir, bool is_specular_bounce, bool before_rc_vertex)
+{
+    reservoir.path_flags &= (before_rc_vertex ? ~(0x4000000U) : ~(0x8000000U));
+    if (is_specular_bounce)
+        reservoir.path_flags |= 1U << (before_rc_vertex ? 26 : 27);
+}
+
+inline bool host_path_reservoir_is_specular_bounce(uint32_t path_flags, bool before_rc_vertex)
+{
+    return ((path_flags >> (before_rc_vertex ? 26 : 27)) & 1) != 0;
+}
+
+inline void host_path_reservoir_insert_light_type(PATH_RESERVOIR &reservoir, uint32_t light_type)
+{
+    reservoir.path_flags &= ~(0x7U << HOST_PATH_LIGHT_TYPE_SHIFT);
+    reservoir.path_flags |= (light_type & 0x7) << HOST_PATH_LIGHT_TYPE_SHIFT;
+}
+
+inline uint32_t host_path_reservoir_get_light_type(uint32_t path_flags)
+{
+    return (path_flags >> HOST_PATH_LIGHT_TYPE_SHIFT) & 0x7;
+}
+
+//////////////////////////////// PATH RESERVOIR //////////////////////////////////////
+
+inline bool host_instance_hit_exists(OBJECT_INFO const &instance_hit)
+{
+    return instance_hit.instance_id < MAX_INSTANCES && instance_hit.primitive_id < MAX_PRIMITIVES;
+}
+
+inline void host_path_reservoir_initialise(HostSceneParams const &params, PATH_RESERVOIR &reservoir)
+{
+    reservoir.M = 0.0f;
+    reservoir.weight = 0.0f;
+    reservoir.path_flags = 0;
+    host_path_reservoir_insert_rc_vertex_length(reservoir, params.max_depth);
+    reservoir.rc_random_seed = 0;
+    reservoir.F = {0.0f, 0.0f, 0.0f};
+    reservoir.light_pdf = 0.0f;
+    reservoir.cached_jacobian = {0.0f, 0.0f, 0.0f};
+    reservoir.init_random_seed = 0;
+    reservoir.rc_vertex_hit = OBJECT_HIT{.object = {MAX_INSTANCES, MAX_PRIMITIVES}, .hit = {0.0f, 0.0f, 0.0f}};
+    reservoir.rc_vertex_wi[0] = {0.0f, 0.0f, 0.0f};
+    reservoir.rc_vertex_irradiance[0] = {0.0f, 0.0f, 0.0f};
+}
+
+inline void host_reconnection_data_initialise(RECONNECTION_DATA &rc_data)
+{
+    rc_data.rc_prev_hit = OBJECT_HIT{.object = {MAX_INSTANCES, MAX_PRIMITIVES}, .hit = {0.0f, 0.0f, 0.0f}};
+    rc_data.rc_prev_wo = {0.0f, 0.0f, 0.0f};
+    rc_data.path_throughput = {0.0f, 0.0f, 0.0f};
+}
+
+inline float host_path_F_to_scalar(glm::vec3 color)
+{
+    return glm::dot(color, glm::vec3(0.299f, 0.587f, 0.114f)); // luminance
+}
+
+inline float host_path_reservoir_compute_weight(glm::vec3 color, bool binarize)
+{
+    float weight = host_path_F_to_scalar(color);
+    if (binarize && weight > 0.0f)
+        weight = 1.0f;
+    return weight;
+}
+
+inline bool host_path_reservoir_update(PATH_RESERVOIR &reservoir, glm::vec3 in_F, float p, uint32_t &seed)
+{
+    reservoir.M += 1.0f;
+
+    float w = host_path_F_to_scalar(in_F) / p;
+
+    if (std::isnan(w) || w == 0.0f)
+        return false;
+
+    reservoir.weight += w;
+
+    if (host_rnd(seed) * reservoir.weight <= w)
+    {
+        reservoir.F = to_daxa(in_F);
+        return true;
+    }
+
+    return false;
+}
+
+// Everything but M & weight follows the selected sample
+inline void host_path_reservoir_copy_sample(PATH_RESERVOIR &reservoir, PATH_RESERVOIR const &in_reservoir, glm::vec3 in_F)
+{
+    reservoir.path_flags = in_reservoir.path_flags;
+    reservoir.rc_random_seed = in_reservoir.rc_random_seed;
+    reservoir.init_random_seed = in_reservoir.init_random_seed;
+    reservoir.cached_jacobian = in_reservoir.cached_jacobian;
+    reservoir.light_pdf = in_reservoir.light_pdf;
+    reservoir.rc_vertex_wi[0] = in_reservoir.rc_vertex_wi[0];
+    reservoir.rc_vertex_hit = in_reservoir.rc_vertex_hit;
+    reservoir.rc_vertex_irradiance[0] = in_reservoir.rc_vertex_irradiance[0];
+    reservoir.F = to_daxa(in_F);
+}
+
+inline bool host_path_reservoir_merge(PATH_RESERVOIR &reservoir, glm::vec3 in_F, float in_jacobian, PATH_RESERVOIR const &in_reservoir,
+                                      uint32_t &seed, float mis_weight, bool force_add)
+{
+    float w = host_path_F_to_scalar(in_F) * in_jacobian * in_reservoir.M * in_reservoir.weight * mis_weight;
+
+    reservoir.M += in_reservoir.M;
+
+    if (std::isnan(w) || w == 0.0f)
+        return false;
+
+    reservoir.weight += w;
+
+    // Accept?
+    if (force_add || host_rnd(seed) * reservoir.weight <= w)
+    {
+        host_path_reservoir_copy_sample(reservoir, in_reservoir, in_F);
+        return true;
+    }
+
+    return false;
+}
+
+inline bool host_path_reservoir_merge_with_resampling_MIS(PATH_RESERVOIR &reservoir, glm::vec3 in_F, float in_jacobian,
+                                                          PATH_RESERVOIR const &in_reservoir, uint32_t &seed, float mis_weight,
+                                                          bool force_add)
+{
+    float w = host_path_F_to_scalar(in_F) * in_jacobian * in_reservoir.weight * mis_weight;
+
+    reservoir.M += in_reservoir.M;
+
+    if (std::isnan(w) || w == 0.0f)
+        return false;
+
+    reservoir.weight += w;
+
+    // Accept?
+    if (force_add || host_rnd(seed) * reservoir.weight <= w)
+    {
+        host_path_reservoir_copy_sample(reservoir, in_reservoir, in_F);
+        return true;
+    }
+
+    return false;
+}
+
+inline void host_path_reservoir_finalize_RIS(PATH_RESERVOIR &reservoir)
+{
+    float p_hat = host_path_F_to_scalar(to_glm(reservoir.F));
+    if (p_hat == 0.0f || reservoir.M == 0.0f)
+        reservoir.weight = 0.0f;
+    else
+        reservoir.weight = reservoir.weight / (p_hat * reservoir.M);
+}
+
+inline void host_path_reservoir_finalize_GRIS(PATH_RESERVOIR &reservoir)
+{
+    float p_hat = host_path_F_to_scalar(to_glm(reservoir.F));
+    if (p_hat == 0.0f)
+        reservoir.weight = 0.0f;
+    else
+        reservoir.weight = reservoir.weight / p_hat;
+}
+
+//////////////////////////////// INTERSECTIONS //////////////////////////////////////
+
+inline void host_intersect_initialise(INTERSECT &i)
+{
+    i.is_hit = false;
+    i.distance = 0.0f;
+    i.world_hit = {0.0f, 0.0f, 0.0f};
+    i.world_nrm = {0.0f, 0.0f, 0.0f};
+    i.wo = {0.0f, 0.0f, 0.0f};
+    i.wi = {0.0f, 0.0f, 0.0f};
+    i.instance_hit = {MAX_INSTANCES, MAX_PRIMITIVES};
+    i.material_idx = MAX_MATERIALS;
+    i.mat = {};
+}
+
+// Primary hit as rgen.glsl builds it for the indirect illumination
+inline INTERSECT host_make_intersection(HostScene const &scene, HostHit const &hit, glm::vec3 wo)
+{
+    uint32_t material_index = scene.primitives[hit.primitive_index].material_index;
+    return INTERSECT{
+        .is_hit = true,
+        .distance = hit.distance,
+        .world_hit = to_daxa(hit.position),
+        .world_nrm = to_daxa(hit.normal),
+        .wo = to_daxa(wo),
+        .wi = {0.0f, 0.0f, 0.0f},
+        .instance_hit = hit.object,
+        .material_idx = material_index,
+        .mat = scene.materials[material_index],
+    };
+}
+
+inline glm::vec3 host_compute_new_ray_origin(glm::vec3 pos, glm::vec3 normal, bool view_side)
+{
+    pos = compute_ray_origin(pos, view_side ? normal : -normal);
+    return compute_ray_origin(pos, view_side ? normal : -normal);
+}
+
+// load_intersection_data_vertex_position: the stored hit of a vertex seen from world_pos, with its material.
+// NOTE: the shader keeps the first entry into the primitive even when the ray comes in through another face than the one
+// of the stored hit, here that is a miss (the vertex is back facing from world_pos).
+inline INTERSECT host_load_intersection_data_vertex_position(HostAccel const &accel, OBJECT_HIT const &instance_hit, glm::vec3 world_pos)
+{
+    INTERSECT i = {};
+    host_intersect_initialise(i);
+
+    glm::vec3 target = to_glm(instance_hit.hit);
+    float target_distance = glm::length(target - world_pos);
+    if (target_distance <= 0.0f)
+        return i;
+
+    HostRay ray = {.origin = world_pos, .direction = (target - world_pos) / target_distance};
+    HostHit hit = {};
+    if (!accel.intersect_primitive(ray, instance_hit.object, hit))
+        return i;
+    if (glm::length(hit.position - target) > HOST_RC_VERTEX_EPSILON * target_distance)
+        return i;
+
+    glm::vec3 pos = compute_ray_origin(hit.position, hit.normal);
+    pos = compute_ray_origin(pos, hit.normal);
+
+    i = host_make_intersection(accel.get_scene(), hit, glm::normalize(world_pos - pos));
+    i.world_hit = to_daxa(pos);
+    i.distance = glm::length(world_pos - pos);
+    return i;
+}
+
+// is_valid_geometry: neighbours of the spatial reuse need a similar normal & depth
+inline bool host_is_valid_geometry(INTERSECT const &central_intersection, INTERSECT const &neighbor_intersection, glm::vec3 camera_pos)
+{
+    float central_dist = glm::length(camera_pos - to_glm(central_intersection.world_hit));
+    float neighbor_dist = glm::length(camera_pos - to_glm(neighbor_intersection.world_hit));
+    return glm::dot(to_glm(central_intersection.world_nrm), to_glm(neighbor_intersection.world_nrm)) >= 0.5f &&
+           std::abs(central_dist - neighbor_dist) < 0.1f * central_dist;
+}
+
+// get_next_neighbor_pixel (prng.glsl): random offset in the window, (-1, -1) for the pixel itself
+inline void host_get_next_neighbor_pixel(int32_t x, int32_t y, int32_t small_window_radius, uint32_t &seed, int32_t &neighbor_x,
+                                         int32_t &neighbor_y)
+{
+    float offset_x = 2.0f * host_rnd(seed) - 1.0f;
+    float offset_y = 2.0f * host_rnd(seed) - 1.0f;
+
+    neighbor_x = x + static_cast<int32_t>(offset_x * static_cast<float>(small_window_radius));
+    neighbor_y = y + static_cast<int32_t>(offset_y * static_cast<float>(small_window_radius));
+
+    if (neighbor_x == x && neighbor_y == y)
+        neighbor_x = neighbor_y = -1;
+}
+
+//////////////////////////////// SHIFT MAPPINGS //////////////////////////////////////
+
+inline bool host_is_jacobian_invalid(float jacobian)
+{
+    return jacobian <= 0.0f || std::isnan(jacobian) || std::isinf(jacobian);
+}
+
+inline bool host_is_integrand_invalid(glm::vec3 integrand)
+{
+    return std::isnan(integrand.x) || std::isnan(integrand.y) || std::isnan(integrand.z) ||
+           std::isinf(integrand.x) || std::isinf(integrand.y) || std::isinf(integrand.z);
+}
+
+// dst_pdf * dst_jacobian transforms pdf in dst space to src space
+// src_pdf / dst_jacobian transforms pdf in src space to dst space
+inline glm::vec3 host_compute_shifted_integrand_reconnection(HostAccel const &accel, HostSceneParams const &params, float &dst_jacobian,
+                                                             INTERSECT const &dst_primary_intersection,
+                                                             INTERSECT const &src_primary_intersection, PATH_RESERVOIR &src_reservoir,
+                                                             bool eval_visibility, bool use_hybrid_shift, bool use_cached_jacobian)
+{
+    glm::vec3 dst_cached_jacobian = glm::vec3(0.0f);
+    dst_jacobian = 0.0f;
+
+    // reconnection vertex number
+    uint32_t rc_vertex_length = !use_hybrid_shift ? 1 : host_path_reservoir_get_reconnection_length(src_reservoir.path_flags);
+
+    OBJECT_HIT rc_vertex_hit = src_reservoir.rc_vertex_hit;
+    glm::vec3 rc_vertex_irradiance = to_glm(src_reservoir.rc_vertex_irradiance[0]);
+    glm::vec3 rc_vertex_wi = to_glm(src_reservoir.rc_vertex_wi[0]);
+    bool rc_vertex_hit_exists = host_instance_hit_exists(rc_vertex_hit.object);
+
+    // number of vertices in the path
+    uint32_t path_length = host_path_reservoir_get_path_length(src_reservoir.path_flags);
+    // whether the last vertex is a NEE vertex
+    bool is_last_vertex_NEE = host_path_reservoir_last_vertex_NEE(src_reservoir.path_flags);
+
+    bool is_transmission = host_path_reservoir_is_transmission_event(src_reservoir.path_flags, true);
+
+    glm::vec3 src_normal = to_glm(src_primary_intersection.world_nrm);
+    glm::vec3 dst_normal = to_glm(dst_primary_intersection.world_nrm);
+    glm::vec3 src_wo = to_glm(src_primary_intersection.wo);
+    glm::vec3 dst_wo = to_glm(dst_primary_intersection.wo);
+
+    // Step to avoid self-intersection
+    glm::vec3 src_primary_hit = host_compute_new_ray_origin(to_glm(src_primary_intersection.world_hit), src_normal, !is_transmission);
+    glm::vec3 dst_primary_hit = host_compute_new_ray_origin(to_glm(dst_primary_intersection.world_hit), dst_normal, !is_transmission);
+
+    // If it was a miss, we need to evaluate the environment map light
+    if (!rc_vertex_hit_exists)
+    {
+        glm::vec3 dst_integrand = glm::vec3(0.0f);
+        if (host_path_reservoir_get_light_type(src_reservoir.path_flags) == GEOMETRY_LIGHT_ENV_MAP &&
+            path_length + 1 == rc_vertex_length && !is_last_vertex_NEE)
+        {
+            glm::vec3 wi = rc_vertex_wi;
+
+            // Check if the environment map light is visible (sky light)
+            bool is_visible = !accel.occluded(HostRay{.origin = dst_primary_hit, .direction = wi}, 0.0f, HOST_MAX_DISTANCE);
+            if (is_visible)
+            {
+                float src_pdf1 = use_cached_jacobian ? src_reservoir.cached_jacobian.x
+                                                     : host_sample_material_pdf(src_primary_intersection.mat, src_normal, src_wo, wi);
+                float dst_pdf1 = host_sample_material_pdf(dst_primary_intersection.mat, dst_normal, dst_wo, wi);
+                float dst_pdf1_all = dst_pdf1;
+                dst_cached_jacobian.x = dst_pdf1;
+                glm::vec3 dst_f1 = host_evaluate_material(dst_primary_intersection.mat, dst_normal, dst_wo, wi);
+                float mis_weight = host_eval_mis(dst_pdf1_all, src_reservoir.light_pdf);
+                dst_integrand = dst_f1 / dst_pdf1 * mis_weight * rc_vertex_irradiance;
+                dst_jacobian = dst_pdf1 / src_pdf1;
+            }
+        }
+
+        if (use_cached_jacobian)
+            src_reservoir.cached_jacobian = to_daxa(dst_cached_jacobian);
+
+        if (host_is_jacobian_invalid(dst_jacobian))
+            dst_jacobian = 0.0f;
+        if (host_is_integrand_invalid(dst_integrand))
+            return glm::vec3(0.0f);
+
+        return dst_integrand;
+    }
+
+    bool is_rc_vertex_final = path_length == rc_vertex_length;
+    bool is_rc_vertex_escaped_vertex = path_length + 1 == rc_vertex_length && !is_last_vertex_NEE;
+    bool is_rc_vertex_NEE = is_rc_vertex_final && is_last_vertex_NEE;
+
+    bool is_delta1 = host_path_reservoir_is_delta_event(src_reservoir.path_flags, true);
+    bool is_delta2 = host_path_reservoir_is_delta_event(src_reservoir.path_flags, false);
+
+    // delta bounce before/after rcVertex (if is_rc_vertex_NEE, deltaAfterRc won't be set)
+    if (is_delta1 || is_delta2)
+        return glm::vec3(0.0f);
+
+    INTERSECT rc_vertex_intersection = host_load_intersection_data_vertex_position(accel, rc_vertex_hit, dst_primary_hit);
+    // NOTE: the shader goes on with an empty intersection
+    if (!rc_vertex_intersection.is_hit)
+        return glm::vec3(0.0f);
+
+    glm::vec3 rc_vertex_position = to_glm(rc_vertex_intersection.world_hit);
+    glm::vec3 rc_vertex_normal = to_glm(rc_vertex_intersection.world_nrm);
+    glm::vec3 rc_vertex_wo = to_glm(rc_vertex_intersection.wo);
+
+    // need to evaluate source PDF of BSDF sampling
+    glm::vec3 dst_connection_v = -rc_vertex_wo;                                      // direction point from dst primary hit point to reconnection vertex
+    glm::vec3 src_connection_v = glm::normalize(rc_vertex_position - src_primary_hit); // direction point from src primary hit point to reconnection vertex
+
+    // Geometry factor between destination primary hit point and reconnection vertex
+    glm::vec3 shifted_disp = rc_vertex_position - dst_primary_hit;
+    float shifted_dist2 = glm::dot(shifted_disp, shifted_disp);
+    float shifted_cosine = std::abs(glm::dot(rc_vertex_normal, -dst_connection_v));
+
+    if (use_hybrid_shift)
+    {
+        bool is_far_field = std::sqrt(shifted_dist2) >= params.near_field_distance;
+        if (!is_far_field)
+            return glm::vec3(0.0f);
+    }
+
+    dst_cached_jacobian.z = shifted_cosine / shifted_dist2;
+    float jacobian = 1.0f;
+    if (use_cached_jacobian)
+        jacobian = dst_cached_jacobian.z / src_reservoir.cached_jacobian.z;
+    else
+    {
+        glm::vec3 original_disp = rc_vertex_position - src_primary_hit;
+        float original_dist2 = glm::dot(original_disp, original_disp);
+        float original_cosine = std::abs(glm::dot(rc_vertex_normal, -src_connection_v));
+        jacobian = dst_cached_jacobian.z * original_dist2 / original_cosine;
+    }
+    if (host_is_jacobian_invalid(jacobian))
+        return glm::vec3(0.0f);
+
+    // assuming bsdf sampling
+    float dst_pdf1 = host_sample_material_pdf(dst_primary_intersection.mat, dst_normal, dst_wo, dst_connection_v);
+    float dst_pdf1_all = dst_pdf1;
+
+    dst_cached_jacobian.x = dst_pdf1;
+    float src_pdf1 = use_cached_jacobian ? src_reservoir.cached_jacobian.x
+                                         : host_sample_material_pdf(src_primary_intersection.mat, src_normal, src_wo, src_connection_v);
+
+    jacobian *= dst_pdf1 / src_pdf1;
+
+    if (host_is_jacobian_invalid(jacobian))
+        return glm::vec3(0.0f);
+
+    glm::vec3 dst_f1 = host_evaluate_material(dst_primary_intersection.mat, dst_normal, dst_wo, dst_connection_v);
+
+    float dst_rc_vertex_scatter_pdf_all = 0.0f;
+    float dst_pdf2 = 1.0f;
+    float dst_rc_vertex_scatter_pdf = 1.0f;
+    float src_rc_vertex_scatter_pdf = 1.0f;
+
+    if (!is_rc_vertex_escaped_vertex)
+    {
+        // assuming bsdf sampling
+        dst_rc_vertex_scatter_pdf = host_sample_material_pdf(rc_vertex_intersection.mat, rc_vertex_normal, rc_vertex_wo, rc_vertex_wi);
+        dst_rc_vertex_scatter_pdf_all = dst_rc_vertex_scatter_pdf;
+
+        dst_cached_jacobian.y = dst_rc_vertex_scatter_pdf;
+        src_rc_vertex_scatter_pdf = use_cached_jacobian ? src_reservoir.cached_jacobian.y
+                                                        : host_sample_material_pdf(rc_vertex_intersection.mat, rc_vertex_normal,
+                                                                                   -src_connection_v, rc_vertex_wi);
+
+        if (!is_rc_vertex_NEE)
+            dst_pdf2 = dst_rc_vertex_scatter_pdf;
+        else
+            dst_pdf2 = src_reservoir.light_pdf;
+    }
+
+    glm::vec3 dst_f2 = glm::vec3(1.0f);
+
+    if (!is_rc_vertex_escaped_vertex)
+        dst_f2 = host_evaluate_material(rc_vertex_intersection.mat, rc_vertex_normal, rc_vertex_wo, rc_vertex_wi);
+
+    // connection point behind surface
+    if (dst_f1 == glm::vec3(0.0f) || dst_f2 == glm::vec3(0.0f))
+        return glm::vec3(0.0f);
+
+    glm::vec3 dst_integrand_no_f1 = dst_f2 / dst_pdf2 * rc_vertex_irradiance;
+    glm::vec3 dst_integrand = dst_f1 / dst_pdf1 * dst_integrand_no_f1;
+
+    if (is_rc_vertex_escaped_vertex)
+    {
+        float mis_weight = host_eval_mis(dst_pdf1_all, src_reservoir.light_pdf);
+        dst_integrand *= mis_weight;
+    }
+
+    // MIS weight
+    if (is_rc_vertex_final)
+    {
+        if (host_path_reservoir_get_light_type(src_reservoir.path_flags) != GEOMETRY_LIGHT_ANALITIC)
+        {
+            float light_pdf = src_reservoir.light_pdf;
+            float mis_weight = host_eval_mis(is_rc_vertex_NEE ? light_pdf : dst_rc_vertex_scatter_pdf_all,
+                                             is_rc_vertex_NEE ? dst_rc_vertex_scatter_pdf_all : light_pdf);
+            dst_integrand = dst_integrand * mis_weight;
+            dst_integrand_no_f1 = dst_integrand_no_f1 * mis_weight;
+            if (!is_rc_vertex_NEE)
+                jacobian *= dst_rc_vertex_scatter_pdf / src_rc_vertex_scatter_pdf;
+        }
+    }
+
+    // need to account for non-identity jacobian due to BSDF sampling
+    if (!is_rc_vertex_final && !is_rc_vertex_escaped_vertex)
+        jacobian *= dst_rc_vertex_scatter_pdf / src_rc_vertex_scatter_pdf;
+
+    if (host_is_jacobian_invalid(jacobian))
+        return glm::vec3(0.0f);
+
+    // Evaluate visibility: vertex 1 <-> vertex 2 (reconnection vertex).
+    if (eval_visibility)
+    {
+        glm::vec3 dir = glm::normalize(rc_vertex_position - dst_primary_hit);
+        float distance = glm::length(rc_vertex_position - dst_primary_hit);
+        if (accel.occluded(HostRay{.origin = dst_primary_hit, .direction = dir}, 0.0f, distance, rc_vertex_intersection.instance_hit))
+            return glm::vec3(0.0f);
+    }
+
+    if (host_is_integrand_invalid(dst_integrand))
+        return glm::vec3(0.0f);
+
+    if (params.reject_based_on_jacobian)
+    {
+        if (jacobian > 0.0f && (std::max(jacobian, 1.0f / jacobian) > 1.0f + params.jacobian_rejection_threshold))
+        {
+            // discard based on jacobian (unbiased)
+            jacobian = 0.0f;
+            dst_integrand = glm::vec3(0.0f);
+        }
+    }
+
+    dst_jacobian = jacobian;
+
+    if (use_cached_jacobian)
+        src_reservoir.cached_jacobian = to_daxa(dst_cached_jacobian);
+
+    return dst_integrand;
+}
+
+// rc_data holds the vertex before the rc vertex in the destination path & the throughput up to it, traced by the caller
+// with the random numbers of the source prefix (random replay isn't ported).
+// NOTE: for an rc vertex at the first bounce the shader reconnects from an empty hit & multiplies a jacobian it zeroed,
+// so the shift always fails. The host reconnects from the destination primary hit with a jacobian of 1 for the
+// (identity) prefix, as the hybrid shift of Lin et al. 2022 does.
+inline glm::vec3 host_compute_shifted_integrand_hybrid(HostAccel const &accel, HostSceneParams const &params, float &dst_jacobian,
+                                                       OBJECT_HIT const &dst_primary_hit, INTERSECT const &dst_primary_intersection,
+                                                       INTERSECT const &src_primary_intersection, PATH_RESERVOIR &temp_path_reservoir,
+                                                       RECONNECTION_DATA const &rc_data, bool eval_visibility)
+{
+    dst_jacobian = 0.0f;
+
+    if (temp_path_reservoir.weight == 0.0f)
+        return glm::vec3(0.0f);
+
+    uint32_t rc_vertex_length = host_path_reservoir_get_reconnection_length(temp_path_reservoir.path_flags);
+    uint32_t path_length = host_path_reservoir_get_path_length(temp_path_reservoir.path_flags);
+    bool is_rc_vertex_escaped_vertex = path_length + 1 == rc_vertex_length;
+
+    PATH_RESERVOIR src_reservoir = temp_path_reservoir;
+
+    OBJECT_HIT dst_rc_prev_vertex_hit = {};
+    glm::vec3 dst_rc_prev_vertex_wo = {};
+    glm::vec3 tp = {};
+
+    if (rc_vertex_length == 1)
+    {
+        tp = glm::vec3(1.0f);
+        dst_rc_prev_vertex_hit = dst_primary_hit;
+        dst_rc_prev_vertex_wo = glm::vec3(1.0f); // this value doesn't matter, as long as it is not all 0
+
+        if (params.roughness_based_rejection)
+        {
+            bool is_last_vertex_classified_as_rough = dst_primary_intersection.mat.roughness > params.roughness_threshold;
+            if (!is_last_vertex_classified_as_rough)
+                tp = glm::vec3(0.0f);
+        }
+    }
+    else
+    {
+        dst_rc_prev_vertex_hit = rc_data.rc_prev_hit;
+        dst_rc_prev_vertex_wo = to_glm(rc_data.rc_prev_wo);
+        tp = to_glm(rc_data.path_throughput);
+    }
+
+    glm::vec3 rc_tp = glm::vec3(1.0f);
+    dst_jacobian = 1.0f;
+
+    // the reconnection vertex exists
+    if ((tp.x > 0.0f || tp.y > 0.0f || tp.z > 0.0f) && host_instance_hit_exists(dst_rc_prev_vertex_hit.object) &&
+        (rc_vertex_length <= path_length || is_rc_vertex_escaped_vertex))
+    {
+        // invalid shift
+        if (dst_rc_prev_vertex_wo == glm::vec3(0.0f))
+            return glm::vec3(0.0f);
+
+        INTERSECT dst_rc_prev_vertex_sd = dst_primary_intersection;
+        INTERSECT src_rc_prev_vertex_sd = src_primary_intersection;
+
+        if (rc_vertex_length > 1)
+        {
+            // rc_prev_wo points back along the destination path, one unit away is enough to reload the hit
+            dst_rc_prev_vertex_sd = host_load_intersection_data_vertex_position(accel, dst_rc_prev_vertex_hit,
+                                                                                to_glm(dst_rc_prev_vertex_hit.hit) + dst_rc_prev_vertex_wo);
+            if (!dst_rc_prev_vertex_sd.is_hit)
+                return glm::vec3(0.0f);
+        }
+
+        float reconnection_jacobian = 1.0f;
+        rc_tp = host_compute_shifted_integrand_reconnection(accel, params, reconnection_jacobian, dst_rc_prev_vertex_sd,
+                                                            src_rc_prev_vertex_sd, src_reservoir, eval_visibility, true,
+                                                            rc_vertex_length > 1);
+
+        dst_jacobian *= reconnection_jacobian;
+
+        temp_path_reservoir.cached_jacobian = src_reservoir.cached_jacobian;
+    }
+
+    return tp * rc_tp;
+}
+
+inline glm::vec3 host_compute_shifted_integrand_(HostAccel const &accel, HostSceneParams const &params, float &dst_jacobian,
+                                                 OBJECT_HIT const &dst_primary_hit, INTERSECT const &dst_primary_intersection,
+                                                 INTERSECT const &src_primary_intersection, PATH_RESERVOIR &src_reservoir,
+                                                 RECONNECTION_DATA const &rc_data, bool eval_visibility)
+{
+    dst_jacobian = 0.0f;
+
+    if (src_reservoir.weight == 0.0f)
+        return glm::vec3(0.0f);
+
+    if (params.shift_mapping == HOST_SHIFT_MAPPING_RECONNECTION)
+        return host_compute_shifted_integrand_reconnection(accel, params, dst_jacobian, dst_primary_intersection, src_primary_intersection,
+                                                           src_reservoir, eval_visibility, false, false);
+    else if (params.shift_mapping == HOST_SHIFT_MAPPING_HYBRID)
+        return host_compute_shifted_integrand_hybrid(accel, params, dst_jacobian, dst_primary_hit, dst_primary_intersection,
+                                                     src_primary_intersection, src_reservoir, rc_data, eval_visibility);
+
+    return glm::vec3(1.0f);
+}
+
+inline glm::vec3 host_compute_shifted_integrand(HostAccel const &accel, HostSceneParams const &params, float &dst_jacobian,
+                                                OBJECT_HIT const &dst_primary_hit, INTERSECT const &dst_primary_intersection,
+                                                INTERSECT const &src_primary_intersection, PATH_RESERVOIR const &src_reservoir,
+                                                RECONNECTION_DATA const &rc_data, bool eval_visibility)
+{
+    PATH_RESERVOIR temp_path_reservoir = src_reservoir;
+    return host_compute_shifted_integrand_(accel, params, dst_jacobian, dst_primary_hit, dst_primary_intersection, src_primary_intersection,
+                                           temp_path_reservoir, rc_data, eval_visibility);
+}
+
+inline bool host_shift_and_merge_reservoir(HostAccel const &accel, HostSceneParams const &params, float &dst_jacobian,
+                                           OBJECT_HIT const &dst_primary_hit, INTERSECT const &dst_primary_intersection,
+                                           PATH_RESERVOIR &dst_reservoir, INTERSECT const &src_primary_intersection,
+                                           PATH_RESERVOIR const &src_reservoir, RECONNECTION_DATA const &rc_data, bool eval_visibility,
+                                           uint32_t &seed, float mis_weight, bool force_merge)
+{
+    PATH_RESERVOIR temp_path_reservoir = src_reservoir;
+    glm::vec3 dst_integrand = host_compute_shifted_integrand_(accel, params, dst_jacobian, dst_primary_hit, dst_primary_intersection,
+                                                              src_primary_intersection, temp_path_reservoir, rc_data, eval_visibility);
+
+    bool selected = host_path_reservoir_merge(dst_reservoir, dst_integrand, dst_jacobian, temp_path_reservoir, seed, mis_weight, force_merge);
+
+    if (force_merge)
+    {
+        if (!selected)
+            dst_reservoir.F = {0.0f, 0.0f, 0.0f};
+        dst_reservoir.M = src_reservoir.M;
+        dst_reservoir.weight = src_reservoir.weight;
+    }
+
+    return selected;
+}
+
+//////////////////////////////// SPATIAL REUSE //////////////////////////////////////
+
+// Pairwise MIS of indirect_illumination_spatial_reuse: get_neighbor(i, intersection, reservoir) fills the primary hit &
+// path reservoir of the i-th neighbour and returns false to skip it (off screen, is_valid_geometry...),
+// get_reconnection_data(slot) the RECONNECTION_DATA of the hybrid shift (slots 2i & 2i + 1 as the shader).
+// Returns the reservoir with its unbiased contribution weight, the indirect color is F * weight.
+template <typename GetNeighbor, typename GetReconnectionData>
+inline PATH_RESERVOIR host_path_spatial_reuse(HostAccel const &accel, HostSceneParams const &params, INTERSECT const &central_primary_intersection,
+                                              PATH_RESERVOIR const &central_reservoir, GetNeighbor &&get_neighbor,
+                                              GetReconnectionData &&get_reconnection_data, uint32_t &seed)
+{
+    PATH_RESERVOIR destination_reservoir = {};
+    host_path_reservoir_initialise(params, destination_reservoir);
+
+    // for hybrid shift
+    RECONNECTION_DATA dummy_rc_data = {};
+    host_reconnection_data_initialise(dummy_rc_data);
+
+    bool use_hybrid_shift = params.shift_mapping == HOST_SHIFT_MAPPING_HYBRID;
+    uint32_t neighbor_count = params.neighbor_count;
+
+    OBJECT_HIT central_hit = {.object = central_primary_intersection.instance_hit, .hit = central_primary_intersection.world_hit};
+
+    uint32_t valid_neighbor_count = 0;
+    float canonical_weight = 1.0f;
+
+    for (uint32_t i = 0; i < neighbor_count; ++i)
+    {
+        INTERSECT neighbor_primary_intersection = {};
+        PATH_RESERVOIR neighbor_reservoir = {};
+        if (!get_neighbor(i, neighbor_primary_intersection, neighbor_reservoir))
+            continue;
+
+        OBJECT_HIT neighbor_hit = {.object = neighbor_primary_intersection.instance_hit, .hit = neighbor_primary_intersection.world_hit};
+        if (!host_instance_hit_exists(neighbor_hit.object))
+            continue;
+
+        float dst_jacobian = 0.0f;
+
+        valid_neighbor_count++;
+
+        float prefix_jacobian = 0.0f;
+
+        RECONNECTION_DATA rc_data = use_hybrid_shift && host_path_reservoir_get_reconnection_length(central_reservoir.path_flags) > 1
+                                        ? get_reconnection_data(2 * i)
+                                        : dummy_rc_data;
+
+        glm::vec3 prefix_integrand = host_compute_shifted_integrand(accel, params, prefix_jacobian, neighbor_hit, neighbor_primary_intersection,
+                                                                    central_primary_intersection, central_reservoir, rc_data, true);
+
+        float prefix_approx_pdf = host_path_reservoir_compute_weight(prefix_integrand, false) * prefix_jacobian;
+
+        canonical_weight += 1.0f;
+        if (prefix_approx_pdf > 0.0f)
+            canonical_weight -= prefix_approx_pdf * neighbor_reservoir.M /
+                                (prefix_approx_pdf * neighbor_reservoir.M +
+                                 central_reservoir.M * host_path_reservoir_compute_weight(to_glm(central_reservoir.F), false) /
+                                     static_cast<float>(neighbor_count));
+
+        PATH_RESERVOIR temporal_destination_reservoir = destination_reservoir;
+
+        rc_data = use_hybrid_shift && host_path_reservoir_get_reconnection_length(neighbor_reservoir.path_flags) > 1
+                      ? get_reconnection_data(2 * i + 1)
+                      : dummy_rc_data;
+
+        // "true" means hypothetically selected as the sample
+        bool possible_to_be_selected = host_shift_and_merge_reservoir(accel, params, dst_jacobian, central_hit, central_primary_intersection,
+                                                                      temporal_destination_reservoir, neighbor_primary_intersection,
+                                                                      neighbor_reservoir, rc_data, true, seed, 1.0f, true);
+
+        float neighbor_weight = 0.0f;
+
+        if (possible_to_be_selected)
+        {
+            float neighbor_target = host_path_reservoir_compute_weight(to_glm(neighbor_reservoir.F), false) / dst_jacobian * neighbor_reservoir.M;
+            neighbor_weight = neighbor_target / (neighbor_target + host_path_reservoir_compute_weight(to_glm(temporal_destination_reservoir.F), false) *
+                                                                       central_reservoir.M / static_cast<float>(neighbor_count));
+            if (std::isnan(neighbor_weight) || std::isinf(neighbor_weight))
+                neighbor_weight = 0.0f;
+        }
+
+        host_path_reservoir_merge_with_resampling_MIS(destination_reservoir, to_glm(temporal_destination_reservoir.F), dst_jacobian,
+                                                      temporal_destination_reservoir, seed, neighbor_weight, false);
+    }
+
+    host_path_reservoir_merge_with_resampling_MIS(destination_reservoir, to_glm(central_reservoir.F), 1.0f, central_reservoir, seed,
+                                                  canonical_weight, false);
+
+    if (destination_reservoir.weight > 0.0f)
+    {
+        host_path_reservoir_finalize_GRIS(destination_reservoir);
+        // compensate for the fact that pairwise resampling MIS was not divided by (k+1)
+        destination_reservoir.weight /= static_cast<float>(valid_neighbor_count + 1);
+    }
+
+    if (destination_reservoir.weight < 0.0f || std::isnan(destination_reservoir.weight) || std::isinf(destination_reservoir.weight))
+        destination_reservoir.weight = 0.0f;
+
+    return destination_reservoir;
+}
+
+//////////////////////////////// PATH BUILDER //////////////////////////////////////
+
+// One pixel of host_trace_path_reservoir
+struct HostPathSample
+{
+    INTERSECT primary = {};                         // is_hit false when the camera ray escapes
+    glm::vec3 direct = {0.0f, 0.0f, 0.0f};          // emission & next event estimation at the primary hit, the sky on a miss
+    PATH_RESERVOIR reservoir = {};                  // every path through the first bounce
+    uint32_t candidate_count = 0;
+};
+
+// Path builder of the host: the shader one (path_tracer.glsl) is still in progress, this one traces like
+// ReferenceTracer::trace_path so direct + F * weight converges to the reference. Every light path through the first bounce
+// is streamed into one path reservoir with the rc vertex at the first bounce (x2, the reconnection shift):
+//  - the sky & emissive voxels reached from the primary hit (path length 0: no rc vertex or the escaped vertex),
+//  - lights sampled or hit after x2 (path length >= 1), the rc vertex irradiance being the radiance of the suffix.
+// Candidates are the path contributions (source pdf 1) & M is 1 after RIS as each one is a different path.
+inline void host_build_path_reservoir(ReferenceTracer const &tracer, HostAccel const &accel, HostSceneParams const &params,
+                                      MATERIAL const &mat, glm::vec3 P, glm::vec3 n, glm::vec3 wo, glm::vec3 ray_direction,
+                                      HostPathSample &sample, uint32_t &seed, uint64_t &ray_count)
+{
+    HostScene const &scene = accel.get_scene();
+    PATH_RESERVOIR &reservoir = sample.reservoir;
+
+    reservoir.init_random_seed = seed;
+
+    // First bounce
+    glm::vec3 wi = {};
+    if (!host_scatter(mat, ray_direction, n, seed, wi))
+        return;
+    wi = glm::normalize(wi);
+
+    float pdf1 = host_sample_material_pdf(mat, n, wo, wi);
+    if (pdf1 <= 0.0f)
+        return;
+
+    glm::vec3 prefix_thp = host_evaluate_material(mat, n, wo, wi) / pdf1;
+    if (prefix_thp.x <= 0.0f && prefix_thp.y <= 0.0f && prefix_thp.z <= 0.0f)
+        return;
+
+    // Only the BSDF sampled lobes can be shifted
+    bool is_delta1 = (mat.type & MATERIAL_TYPE_MASK) != MATERIAL_TYPE_LAMBERTIAN;
+
+    OBJECT_HIT rc_vertex_hit = {.object = {MAX_INSTANCES, MAX_PRIMITIVES}, .hit = {0.0f, 0.0f, 0.0f}};
+    bool is_delta2 = false;
+    glm::vec3 cached_jacobian = glm::vec3(pdf1, 0.0f, 0.0f);
+
+    auto add_candidate = [&](glm::vec3 F, uint32_t path_length, bool last_vertex_nee, uint32_t light_type, glm::vec3 rc_wi,
+                             glm::vec3 rc_irradiance, float light_pdf)
+    {
+        ++sample.candidate_count;
+        if (!host_path_reservoir_update(reservoir, F, 1.0f, seed))
+            return;
+
+        reservoir.path_flags = 0;
+        host_path_reservoir_insert_path_length(reservoir, path_length);
+        host_path_reservoir_insert_rc_vertex_length(reservoir, 1);
+        host_path_reservoir_insert_last_vertex_nee(reservoir, last_vertex_nee);
+        host_path_reservoir_insert_light_type(reservoir, light_type);
+        host_path_reservoir_insert_is_delta_event(reservoir, is_delta1, true);
+        host_path_reservoir_insert_is_delta_event(reservoir, is_delta2 && path_length > 0, false);
+        reservoir.rc_random_seed = seed;
+        reservoir.light_pdf = light_pdf;
+        reservoir.cached_jacobian = to_daxa(cached_jacobian);
+        reservoir.rc_vertex_hit = rc_vertex_hit;
+        reservoir.rc_vertex_wi[0] = to_daxa(rc_wi);
+        reservoir.rc_vertex_irradiance[0] = to_daxa(rc_irradiance);
+    };
+
+    HostHit rc_hit = {};
+    ++ray_count;
+    if (!accel.intersect(HostRay{.origin = P, .direction = wi}, 0.0f, HOST_MAX_DISTANCE, rc_hit))
+    {
+        glm::vec3 sky = host_calculate_sky_color(scene.time, scene.is_afternoon, wi);
+        add_candidate(prefix_thp * sky, 0, false, GEOMETRY_LIGHT_ENV_MAP, wi, sky, 0.0f);
+        return;
+    }
+
+    PRIMITIVE const &rc_primitive = scene.primitives[rc_hit.primitive_index];
+    MATERIAL const &rc_mat = scene.materials[rc_primitive.material_index];
+    glm::vec3 rc_n = rc_hit.normal;
+    glm::vec3 rc_wo = -wi;
+
+    rc_vertex_hit = OBJECT_HIT{.object = rc_hit.object, .hit = to_daxa(rc_hit.position)};
+    is_delta2 = (rc_mat.type & MATERIAL_TYPE_MASK) != MATERIAL_TYPE_LAMBERTIAN;
+    cached_jacobian.z = host_geom_fact_sa(P, rc_hit.position, rc_n);
+
+    // Solid angle density of light sampling for a BSDF hit of an emissive voxel, 0 for voxels that aren't lights
+    auto get_light_pdf = [&](PRIMITIVE const &primitive, glm::vec3 from, glm::vec3 from_normal, glm::vec3 position, glm::vec3 normal) -> float
+    {
+        if (primitive.light_index == static_cast<uint32_t>(-1))
+            return 0.0f;
+        return tracer.get_cube_light_pdf(primitive.light_index, normal, from, from_normal) / host_geom_fact_sa(from, position, normal);
+    };
+
+    // Emission of the rc vertex, the escaped vertex
+    glm::vec3 Le = to_glm(rc_mat.emission);
+    if (Le.x > 0.0f || Le.y > 0.0f || Le.z > 0.0f)
+    {
+        float light_pdf = get_light_pdf(rc_primitive, P, get_light_tree_receiver_normal(mat, n), rc_hit.position, rc_n);
+        add_candidate(prefix_thp * host_eval_mis(pdf1, light_pdf) * Le, 0, false, GEOMETRY_LIGHT_CUBE, glm::vec3(0.0f), Le, light_pdf);
+    }
+
+    if (params.max_depth <= 1)
+        return;
+
+    glm::vec3 rc_P = compute_ray_origin(rc_hit.position, rc_n);
+
+    // Light sampled from the rc vertex, the final vertex
+    tracer.for_each_light_sample(rc_P, rc_n, rc_wo, rc_mat, rc_hit.object, seed, ray_count, [&](HostLightSample const &light_sample)
+                                 {
+        cached_jacobian.y = host_sample_material_pdf(rc_mat, rc_n, rc_wo, light_sample.wi);
+        add_candidate(prefix_thp * light_sample.contribution, 1, true,
+                      light_sample.type == GEOMETRY_LIGHT_POINT ? GEOMETRY_LIGHT_ANALITIC : light_sample.type, light_sample.wi,
+                      light_sample.Le, light_sample.solid_angle_pdf); });
+
+    // Second bounce, its direction is the incident direction of the rc vertex
+    glm::vec3 rc_wi = {};
+    if (!host_scatter(rc_mat, wi, rc_n, seed, rc_wi))
+        return;
+    rc_wi = glm::normalize(rc_wi);
+
+    float pdf2 = host_sample_material_pdf(rc_mat, rc_n, rc_wo, rc_wi);
+    if (pdf2 <= 0.0f)
+        return;
+
+    glm::vec3 rc_thp = host_evaluate_material(rc_mat, rc_n, rc_wo, rc_wi) / pdf2;
+    if (rc_thp.x <= 0.0f && rc_thp.y <= 0.0f && rc_thp.z <= 0.0f)
+        return;
+    cached_jacobian.y = pdf2;
+
+    // Suffix after the rc vertex
+    glm::vec3 suffix_thp = glm::vec3(1.0f);
+    HostRay ray = {.origin = rc_P, .direction = rc_wi};
+    glm::vec3 previous_position = rc_P;
+    glm::vec3 previous_receiver_normal = get_light_tree_receiver_normal(rc_mat, rc_n);
+    float previous_pdf = pdf2;
+
+    for (uint32_t depth = 2; depth <= params.max_depth; ++depth)
+    {
+        // x1 is depth 0, lights hit at this depth end paths of length depth - 1
+        uint32_t path_length = depth - 1;
+        bool is_final = path_length == 1;
+
+        HostHit hit = {};
+        ++ray_count;
+        if (!accel.intersect(ray, 0.0f, HOST_MAX_DISTANCE, hit))
+        {
+            glm::vec3 sky = host_calculate_sky_color(scene.time, scene.is_afternoon, ray.direction);
+            add_candidate(prefix_thp * rc_thp * suffix_thp * sky, path_length, false, GEOMETRY_LIGHT_ENV_MAP, rc_wi, suffix_thp * sky, 0.0f);
+            break;
+        }
+
+        PRIMITIVE const &primitive = scene.primitives[hit.primitive_index];
+        MATERIAL const &hit_mat = scene.materials[primitive.material_index];
+
+        // Emission, a final rc vertex gets its MIS weight from the shift
+        glm::vec3 emission = to_glm(hit_mat.emission);
+        if (emission.x > 0.0f || emission.y > 0.0f || emission.z > 0.0f)
+        {
+            float light_pdf = get_light_pdf(primitive, previous_position, previous_receiver_normal, hit.position, hit.normal);
+            float mis_weight = host_eval_mis(previous_pdf, light_pdf);
+            add_candidate(prefix_thp * rc_thp * suffix_thp * mis_weight * emission, path_length, false, GEOMETRY_LIGHT_CUBE, rc_wi,
+                          is_final ? emission : suffix_thp * mis_weight * emission, light_pdf);
+        }
+
+        if (depth == params.max_depth)
+            break;
+
+        glm::vec3 hit_n = hit.normal;
+        glm::vec3 hit_wo = -glm::normalize(ray.direction);
+        glm::vec3 hit_P = compute_ray_origin(hit.position, hit_n);
+
+        tracer.for_each_light_sample(hit_P, hit_n, hit_wo, hit_mat, hit.object, seed, ray_count, [&](HostLightSample const &light_sample)
+                                     { add_candidate(prefix_thp * rc_thp * suffix_thp * light_sample.contribution, depth, true, light_sample.type,
+                                                     rc_wi, suffix_thp * light_sample.contribution, light_sample.solid_angle_pdf); });
+
+        glm::vec3 next_wi = {};
+        if (!host_scatter(hit_mat, ray.direction, hit_n, seed, next_wi))
+            break;
+        next_wi = glm::normalize(next_wi);
+
+        float pdf = host_sample_material_pdf(hit_mat, hit_n, hit_wo, next_wi);
+        if (pdf <= 0.0f)
+            break;
+
+        suffix_thp *= host_evaluate_material(hit_mat, hit_n, hit_wo, next_wi) / pdf;
+        if (suffix_thp.x <= 0.0f && suffix_thp.y <= 0.0f && suffix_thp.z <= 0.0f)
+            break;
+
+        previous_position = hit_P;
+        previous_receiver_normal = get_light_tree_receiver_normal(hit_mat, hit_n);
+        previous_pdf = pdf;
+        ray = HostRay{.origin = hit_P, .direction = next_wi};
+    }
+}
+
+// Primary hit, direct lighting & path reservoir of one camera ray, the reservoir is finalized (weight is W)
+inline HostPathSample host_trace_path_reservoir(ReferenceTracer const &tracer, HostAccel const &accel, HostSceneParams const &params,
+                                                HostRay ray, uint32_t &seed, uint64_t &ray_count)
+{
+    HostScene const &scene = accel.get_scene();
+
+    HostPathSample sample = {};
+    host_intersect_initialise(sample.primary);
+    host_path_reservoir_initialise(params, sample.reservoir);
+
+    HostHit hit = {};
+    ++ray_count;
+    if (!accel.intersect(ray, 0.0f, HOST_MAX_DISTANCE, hit))
+    {
+        sample.direct = host_calculate_sky_color(scene.time, scene.is_afternoon, ray.direction);
+        return sample;
+    }
+
+    glm::vec3 n = hit.normal;
+    glm::vec3 wo = -glm::normalize(ray.direction);
+    sample.primary = host_make_intersection(scene, hit, wo);
+    MATERIAL const &mat = sample.primary.mat;
+
+    sample.direct = to_glm(mat.emission);
+    if (params.max_depth == 0)
+        return sample;
+
+    glm::vec3 P = compute_ray_origin(hit.position, n);
+    sample.direct += tracer.sample_direct_light(P, n, wo, mat, hit.object, seed, ray_count);
+
+    host_build_path_reservoir(tracer, accel, params, mat, P, n, wo, ray.direction, sample, seed, ray_count);
+
+    // Every candidate is a different path length, RIS over them is a sum of contributions
+    sample.reservoir.M = 1.0f;
+    host_path_reservoir_finalize_RIS(sample.reservoir);
+
+    return sample;
+}
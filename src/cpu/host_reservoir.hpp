@@ -0,0 +1,298 @@
+#pragma once
+#include "defines.h"
+#include "host_shading.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Host port of the ReSTIR DI reservoir math: streaming & finalization (restir_di/reservoir.glsl), pairwise MIS
+// (restir_di/pairwise_mis.glsl) and the temporal & spatial reuse of restir_resampling.glsl, on the RESERVOIR of shared.inl.
+// Names & formulas follow the GLSL so both sides can be compared line by line.
+// Scene lookups stay with the caller: reservoir_get_radiance (the target of a reservoir sample at another pixel) is a
+// callable taking the reservoir, the neighbours of the spatial reuse are given by index.
+
+// Mirror of include/defines.glsl
+#define HOST_MAX_INFLUENCE_FROM_THE_PAST_THRESHOLD 20.0f
+#define HOST_MIN_NUM_OF_NEIGHBORS 3
+#define HOST_MAX_NUM_OF_NEIGHBORS 4
+#define HOST_MAX_DISTANCE_TO_HIT 1e3f
+
+// Y of an empty reservoir (-1 in the shaders)
+static constexpr uint32_t HOST_RESERVOIR_NO_LIGHT = ~0U;
+
+//////////////////////////////// RESERVOIR //////////////////////////////////////
+
+inline void host_initialise_reservoir(RESERVOIR &reservoir)
+{
+    reservoir.W_y = 0.0f;
+    reservoir.seed = 0;
+    reservoir.W_sum = 0.0f;
+    reservoir.M = 0.0f;
+    reservoir.Y = HOST_RESERVOIR_NO_LIGHT;
+    reservoir.l_type = GEOMETRY_LIGHT_NONE;
+    reservoir.F = {0.0f, 0.0f, 0.0f};
+}
+
+inline bool host_is_weight_invalid(float w)
+{
+    return w < 0.0f || std::isnan(w) || std::isinf(w);
+}
+
+inline bool host_update_reservoir(RESERVOIR &reservoir, uint32_t X, uint32_t l_type, uint32_t random_seed, glm::vec3 F, float w,
+                                  float c, uint32_t &seed)
+{
+    if (host_is_weight_invalid(w))
+        return false;
+
+    reservoir.M += c;
+    reservoir.W_sum += w;
+
+    if (host_rnd(seed) < (w / reservoir.W_sum))
+    {
+        reservoir.Y = X;
+        reservoir.l_type = l_type;
+        reservoir.seed = random_seed;
+        reservoir.F = {F.x, F.y, F.z};
+        return true;
+    }
+
+    return false;
+}
+
+// Normalization of the reservoir after streaming, equation (6) of the ReSTIR paper
+inline void host_reservoir_finalize_resampling(RESERVOIR &reservoir, float normalization_numerator, float normalization_denominator)
+{
+    float denominator = host_luminance(to_glm(reservoir.F)) * normalization_denominator;
+
+    reservoir.W_sum = (denominator == 0.0f) ? 0.0f : (reservoir.W_sum * normalization_numerator) / denominator;
+}
+
+inline bool host_is_reservoir_valid(RESERVOIR const &reservoir)
+{
+    return reservoir.M > 0.0f && reservoir.Y != HOST_RESERVOIR_NO_LIGHT && reservoir.l_type != GEOMETRY_LIGHT_NONE;
+}
+
+// reservoir_visibility_pass with the shadow ray already traced
+inline void host_reservoir_visibility_pass(RESERVOIR &reservoir, bool visibility)
+{
+    reservoir.W_y = visibility ? (reservoir.W_sum / host_luminance(to_glm(reservoir.F))) : 0.0f;
+
+    if (!visibility)
+        reservoir.F = {0.0f, 0.0f, 0.0f};
+}
+
+//////////////////////////////// PAIRWISE MIS //////////////////////////////////////
+
+struct HostPairwiseMis
+{
+    RESERVOIR reservoir = {};
+    float m_c = 0.0f; // canonical mis confidence weight
+    float M_s = 0.0f; // streamed sample count
+    uint32_t k = 0;   // number of strategies
+};
+
+inline void host_pairwise_init(HostPairwiseMis &mis, uint32_t num_strategies, RESERVOIR const &reservoir)
+{
+    host_initialise_reservoir(mis.reservoir);
+    mis.m_c = 1.0f;
+    mis.M_s = reservoir.M;
+    mis.k = num_strategies;
+}
+
+inline float host_pairwise_compute_m_i(uint32_t k, RESERVOIR const &canonical_reservoir, RESERVOIR const &input_reservoir, float target_lum)
+{
+    float const p_i_y_i = host_luminance(to_glm(input_reservoir.F));
+    float const p_c_y_i = target_lum;
+
+    float m_i = input_reservoir.M * p_i_y_i;                                                         // Ci * p_i_y_i
+    float denominator = m_i + (canonical_reservoir.M / static_cast<float>(k)) * p_c_y_i;             // Ci * p_i_y_i + (Cc / k) * p_c_y_i
+    m_i = denominator > 0.0f ? m_i / denominator : 0.0f;                                             // Ci * p_i_y_i / (Ci * p_i_y_i + (Cc / k) * p_c_y_i)
+
+    return m_i;
+}
+
+inline void host_pairwise_update_m_c(HostPairwiseMis &mis, RESERVOIR const &canonical_reservoir, RESERVOIR const &input_reservoir,
+                                     glm::vec3 input_target)
+{
+    float const p_i_y_c = host_luminance(input_target);
+    float const p_c_y_c = host_luminance(to_glm(canonical_reservoir.F));
+
+    float const numerator = input_reservoir.M * p_i_y_c; // Ci * p_i_y_c
+    bool const denominator = (p_c_y_c + numerator) > 0.0f;
+
+    mis.m_c += 1.0f;
+
+    // 1 - Ci * p_i_y_c / (Ci * p_i_y_c + (Cc / k) * p_c_y_c)
+    mis.m_c -= denominator ? numerator / (numerator + (canonical_reservoir.M / static_cast<float>(mis.k)) * p_c_y_c) : 0.0f;
+}
+
+// target_at_canonical(reservoir) & target_at_input(reservoir) are reservoir_get_radiance at the canonical & input pixels
+template <typename TargetAtCanonical, typename TargetAtInput>
+inline void host_pairwise_stream(HostPairwiseMis &mis, RESERVOIR const &canonical_reservoir, RESERVOIR const &input_reservoir,
+                                 TargetAtCanonical &&target_at_canonical, TargetAtInput &&target_at_input, uint32_t &seed)
+{
+    glm::vec3 curr_target = glm::vec3(0.0f);
+    float m_i = 0.0f;
+
+    // m_i
+    if (host_is_reservoir_valid(input_reservoir))
+    {
+        curr_target = target_at_canonical(input_reservoir);
+
+        float const target_lum = host_luminance(curr_target);
+        m_i = host_pairwise_compute_m_i(mis.k, canonical_reservoir, input_reservoir, target_lum);
+    }
+
+    glm::vec3 input_target = glm::vec3(0.0f);
+
+    // m_c
+    if (host_is_reservoir_valid(canonical_reservoir))
+        input_target = target_at_input(canonical_reservoir);
+
+    host_pairwise_update_m_c(mis, canonical_reservoir, input_reservoir, input_target);
+
+    if (host_is_reservoir_valid(input_reservoir))
+    {
+        float const w_i = host_luminance(curr_target) * input_reservoir.W_y * m_i;
+
+        host_update_reservoir(mis.reservoir, input_reservoir.Y, input_reservoir.l_type, input_reservoir.seed, curr_target, w_i, 1.0f, seed);
+    }
+
+    mis.M_s += input_reservoir.M;
+}
+
+// The shader takes the seed by value, so does the port
+inline void host_pairwise_end(HostPairwiseMis &mis, RESERVOIR const &canonical_reservoir, uint32_t seed)
+{
+    float const w_c = host_luminance(to_glm(canonical_reservoir.F)) * canonical_reservoir.W_y * mis.m_c;
+
+    host_update_reservoir(mis.reservoir, canonical_reservoir.Y, canonical_reservoir.l_type, canonical_reservoir.seed,
+                          to_glm(canonical_reservoir.F), w_c, 1.0f, seed);
+
+    mis.reservoir.M = mis.M_s;
+    float const target_lum = host_luminance(to_glm(mis.reservoir.F));
+    // defensive pairwise MIS
+    mis.reservoir.W_y = target_lum > 0.0f ? mis.reservoir.W_sum / (target_lum * static_cast<float>(1 + mis.k)) : 0.0f;
+}
+
+//////////////////////////////// REUSE //////////////////////////////////////
+
+// TEMPORAL_REUSE without the remapping of edited voxels: target_at_previous(reservoir) evaluates a sample at the
+// previous pixel of the history, target_at_current(reservoir) at the current pixel.
+// M of the history is capped to max_influence times the current M.
+template <typename TargetAtPrevious, typename TargetAtCurrent>
+inline void host_temporal_reuse(RESERVOIR &reservoir, RESERVOIR reservoir_previous, TargetAtPrevious &&target_at_previous,
+                                TargetAtCurrent &&target_at_current, uint32_t &seed,
+                                float max_influence = HOST_MAX_INFLUENCE_FROM_THE_PAST_THRESHOLD)
+{
+    reservoir_previous.M = std::min(reservoir_previous.M, max_influence * reservoir.M);
+
+    float const prev_M = reservoir_previous.M;
+    float const new_M = reservoir.M + prev_M;
+
+    if (reservoir.W_sum > 0.0f)
+    {
+        float target_lum_at_prev = 0.0f;
+
+        // target at the previous pixel with the current reservoir's sample
+        if (host_luminance(to_glm(reservoir.F)) > 1e-6f)
+            target_lum_at_prev = host_luminance(target_at_previous(reservoir));
+
+        float const p_curr = reservoir.M * host_luminance(to_glm(reservoir.F));
+        float const m_curr = p_curr / std::max(p_curr + prev_M * target_lum_at_prev, 1e-6f);
+        reservoir.W_sum *= m_curr;
+    }
+
+    if (reservoir_previous.Y != HOST_RESERVOIR_NO_LIGHT)
+    {
+        glm::vec3 current_target = target_at_current(reservoir_previous);
+
+        float const target_lum_at_curr = host_luminance(current_target);
+
+        // w_prev becomes zero; then only M needs to be updated, which is done at the end anyway
+        if (target_lum_at_curr > 0.0f)
+        {
+            float const target_lum_at_prev = host_luminance(to_glm(reservoir_previous.F));
+
+            // balance heuristic
+            float const p_prev = reservoir_previous.M * target_lum_at_prev;
+            float const m_prev = p_prev / std::max(p_prev + reservoir.M * target_lum_at_curr, 1e-6f);
+            float const w_prev = m_prev * target_lum_at_curr * reservoir_previous.W_y;
+
+            host_update_reservoir(reservoir, reservoir_previous.Y, reservoir_previous.l_type, reservoir_previous.seed, current_target,
+                                  w_prev, 1.0f, seed);
+        }
+    }
+
+    float target_lum = host_luminance(to_glm(reservoir.F));
+    reservoir.W_y = target_lum > 0.0f ? reservoir.W_sum / target_lum : 0.0f;
+    reservoir.M = new_M;
+}
+
+// Neighbour pick of SPATIAL_REUSE: random offsets in a radius shrinking with the hit distance, fewer neighbours for
+// confident pixels. has_hit(index) is the distance > 0 test of the neighbour DIRECT_ILLUMINATION_INFO.
+// Returns the number of linear pixel indices written to neighbors (HOST_MAX_NUM_OF_NEIGHBORS at most).
+template <typename HasHit>
+inline uint32_t host_get_spatial_neighbors(glm::uvec2 coord, glm::uvec2 rt_size, float confidence, float hit_distance, float min_radius,
+                                           float max_radius, HasHit &&has_hit, uint32_t &seed,
+                                           uint32_t (&neighbors)[HOST_MAX_NUM_OF_NEIGHBORS])
+{
+    uint32_t num_of_neighbors = 0;
+
+    float const spatial_heuristic_radius =
+        max_radius + (min_radius - max_radius) * std::clamp(hit_distance / HOST_MAX_DISTANCE_TO_HIT, 0.0f, 1.0f);
+
+    uint32_t const spatial_heuristic_num_of_neighbors = static_cast<uint32_t>(
+        HOST_MAX_NUM_OF_NEIGHBORS + (HOST_MIN_NUM_OF_NEIGHBORS - HOST_MAX_NUM_OF_NEIGHBORS) * std::clamp(confidence, 0.0f, 1.0f));
+
+    for (uint32_t i = 0; i < spatial_heuristic_num_of_neighbors; i++)
+    {
+        // Random offset, both draws in the order of the shader
+        float offset_x = 2.0f * host_rnd(seed) - 1.0f;
+        float offset_y = 2.0f * host_rnd(seed) - 1.0f;
+
+        // Scale offset
+        offset_x = static_cast<float>(coord.x) + static_cast<float>(static_cast<int32_t>(offset_x * spatial_heuristic_radius));
+        offset_y = static_cast<float>(coord.y) + static_cast<float>(static_cast<int32_t>(offset_y * spatial_heuristic_radius));
+
+        // Clamp offset
+        if (offset_x < 0.0f || offset_x >= static_cast<float>(rt_size.x) || offset_y < 0.0f || offset_y >= static_cast<float>(rt_size.y))
+            continue;
+
+        if (offset_x == static_cast<float>(coord.x) && offset_y == static_cast<float>(coord.y))
+            continue;
+
+        uint32_t const offset_linear = static_cast<uint32_t>(offset_y) * rt_size.x + static_cast<uint32_t>(offset_x);
+
+        if (!has_hit(offset_linear))
+            continue;
+
+        neighbors[num_of_neighbors++] = offset_linear;
+    }
+
+    return num_of_neighbors;
+}
+
+// Pairwise MIS merge of SPATIAL_REUSE over picked neighbours: get_neighbor(i) is the intermediate reservoir of the
+// i-th neighbour, target_at_canonical(reservoir) & target_at_neighbor(i, reservoir) evaluate a sample at the
+// canonical pixel & at the i-th neighbour. Confidence is only used by host_get_spatial_neighbors.
+template <typename GetNeighbor, typename TargetAtCanonical, typename TargetAtNeighbor>
+inline void host_spatial_reuse(RESERVOIR &reservoir, uint32_t num_of_neighbors, GetNeighbor &&get_neighbor,
+                               TargetAtCanonical &&target_at_canonical, TargetAtNeighbor &&target_at_neighbor, uint32_t &seed)
+{
+    if (num_of_neighbors == 0)
+        return;
+
+    HostPairwiseMis reservoir_mis = {};
+    host_pairwise_init(reservoir_mis, num_of_neighbors, reservoir);
+
+    for (uint32_t i = 0; i < num_of_neighbors; i++)
+    {
+        RESERVOIR const neighbor_reservoir = get_neighbor(i);
+        host_pairwise_stream(reservoir_mis, reservoir, neighbor_reservoir, target_at_canonical, [&](RESERVOIR const &sample)
+                             { return target_at_neighbor(i, sample); }, seed);
+    }
+
+    host_pairwise_end(reservoir_mis, reservoir, seed);
+    reservoir = reservoir_mis.reservoir;
+}
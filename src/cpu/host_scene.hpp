@@ -0,0 +1,147 @@
+#pragma once
+#include "defines.h"
+#include "math.inl"
+#include "map_loader.hpp"
+#include "map_streamer.hpp"
+
+#include <limits>
+
+// The scene arrays the GPU consumes (INSTANCE/AABB/PRIMITIVE/MATERIAL/LIGHT), kept on the host.
+// Models are appended region by region the same way the renderer rebases GvoxRegionChunk indices.
+struct HostScene
+{
+    std::vector<INSTANCE> instances = {};
+    std::vector<AABB> aabbs = {};
+    std::vector<PRIMITIVE> primitives = {};
+    std::vector<MATERIAL> materials = {};
+    std::vector<LIGHT> cube_lights = {};
+    std::vector<LIGHT> point_lights = {};
+    std::vector<LIGHT> env_lights = {};
+
+    // World space bounds of every primitive
+    glm::vec3 bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+
+    // Sky state (Status::time & Status::is_afternoon), midday by default like the renderer
+    float time = 1.0f;
+    bool is_afternoon = true;
+
+    uint32_t voxel_count = 0;
+
+    bool load_model(MapLoader &loader, std::filesystem::path const &gvox_model_path, glm::mat4 const &transform,
+                    AXIS_DIRECTION axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP, bool merge_boxes = MERGED_BOXES_ON == 1)
+    {
+        GvoxRegionQueue region_queue = {};
+        GvoxModelDataSerialize params = GvoxModelDataSerialize{
+            .axis_direction = axis_direction,
+            .max_instance_count = 0,
+            .current_instance_index = 0,
+            .instances = nullptr,
+            .current_primitive_index = 0,
+            .max_primitive_count = 0,
+            .primitives = nullptr,
+            .aabbs = nullptr,
+            .current_material_index = 0,
+            .max_material_count = 0,
+            .materials = nullptr,
+            .current_light_index = 0,
+            .max_light_count = 0,
+            .lights = nullptr,
+            .merge_boxes = merge_boxes,
+            .region_queue = &region_queue,
+        };
+
+        GvoxModelData model_data = loader.load_gvox_data(gvox_model_path, params);
+
+        std::vector<GvoxRegionChunk> chunks = {};
+        if (region_queue.pop_all(chunks) == 0)
+        {
+#if WARN
+            std::cerr << "HostScene: no regions loaded from " << gvox_model_path.string() << std::endl;
+#endif // WARN
+            return false;
+        }
+
+        for (auto &chunk : chunks)
+            add_region_chunk(chunk, transform);
+
+        voxel_count += model_data.voxel_count;
+
+        return true;
+    }
+
+    void add_region_chunk(GvoxRegionChunk &chunk, glm::mat4 const &transform)
+    {
+        uint32_t instance_index = static_cast<uint32_t>(instances.size());
+        uint32_t first_primitive_index = static_cast<uint32_t>(aabbs.size());
+        uint32_t first_material_index = static_cast<uint32_t>(materials.size());
+        uint32_t first_light_index = static_cast<uint32_t>(cube_lights.size());
+
+        INSTANCE instance = chunk.instance;
+        instance.transform = glm_mat4_to_daxa_f32mat4x4(transform);
+        instance.first_primitive_index = first_primitive_index;
+        instance.primitive_count = static_cast<uint32_t>(chunk.aabbs.size());
+        instances.push_back(instance);
+
+        aabbs.insert(aabbs.end(), chunk.aabbs.begin(), chunk.aabbs.end());
+        materials.insert(materials.end(), chunk.materials.begin(), chunk.materials.end());
+
+        for (uint32_t i = 0; i < chunk.primitives.size(); ++i)
+        {
+            PRIMITIVE primitive = chunk.primitives[i];
+            primitive.material_index += first_material_index;
+            if (primitive.light_index != static_cast<uint32_t>(-1))
+            {
+                // Lights are moved to world space and point back to the primitive that emits them
+                LIGHT light = chunk.lights[primitive.light_index];
+                glm::vec4 position = transform * glm::vec4(light.position.x, light.position.y, light.position.z, 1.0f);
+                light.position = {position.x, position.y, position.z};
+                light.instance_info = OBJECT_INFO(instance_index, i);
+                primitive.light_index = static_cast<uint32_t>(cube_lights.size());
+                cube_lights.push_back(light);
+            }
+            primitives.push_back(primitive);
+        }
+
+        for (auto const &aabb : chunk.aabbs)
+        {
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                glm::vec4 position = transform * glm::vec4(corner & 1 ? aabb.maximum.x : aabb.minimum.x,
+                                                           corner & 2 ? aabb.maximum.y : aabb.minimum.y,
+                                                           corner & 4 ? aabb.maximum.z : aabb.minimum.z, 1.0f);
+                bounds_min = glm::min(bounds_min, glm::vec3(position));
+                bounds_max = glm::max(bounds_max, glm::vec3(position));
+            }
+        }
+
+#if TRACE == 1
+        std::cout << "HostScene: region " << instance_index << " primitives " << instance.primitive_count
+                  << " lights " << (cube_lights.size() - first_light_index) << std::endl;
+#else
+        (void)first_light_index;
+#endif // TRACE
+    }
+
+    // Same sun & sky the renderer creates (create_point_lights & create_environment_light)
+    void add_default_lights()
+    {
+        LIGHT sun = {};
+        sun.position = daxa_f32vec3(SUN_TOP_POSITION_X, SUN_TOP_POSITION_Y, SUN_TOP_POSITION_Z);
+        sun.emissive = daxa_f32vec3(SUN_MAX_INTENSITY, SUN_MAX_INTENSITY, SUN_MAX_INTENSITY);
+        sun.type = GEOMETRY_LIGHT_POINT;
+        sun.instance_info = OBJECT_INFO(MAX_INSTANCES, MAX_PRIMITIVES);
+        point_lights.push_back(sun);
+
+        LIGHT sky = {};
+        sky.type = GEOMETRY_LIGHT_ENV_MAP;
+        sky.instance_info = OBJECT_INFO(MAX_INSTANCES, MAX_PRIMITIVES);
+        sky.emissive = daxa_f32vec3(10.0, 10.0, 10.0);
+        env_lights.push_back(sky);
+
+        time = 1.0f;
+        is_afternoon = true;
+    }
+
+    auto get_primitive_count() const -> uint32_t { return static_cast<uint32_t>(aabbs.size()); }
+};
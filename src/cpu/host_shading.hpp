@@ -0,0 +1,374 @@
+#pragma once
+#include "defines.h"
+
+#include <cmath>
+
+// Host ports of the shading helpers of the ray tracing shaders: random numbers (random.glsl),
+// sampling & scattering (prng.glsl, rcall_scatter.glsl), BRDFs and sky (mat.glsl) and light helpers (light.glsl).
+// Names & formulas follow the GLSL so both sides can be compared line by line.
+
+// Mirror of include/defines.glsl
+#define HOST_MAX_DISTANCE 1e9f
+#define HOST_MIN_COS_THETA 1e-6f
+#define HOST_COSINE_HEMISPHERE_SAMPLING 1
+#define HOST_USE_POWER_HEURISTIC 1
+
+//////////////////////////////// RANDOM //////////////////////////////////////
+
+// Tiny Encryption Algorithm, 16 rounds (Zafar, Olano & Curtis, "GPU Random Numbers via the Tiny Encryption Algorithm")
+inline uint32_t host_tea(uint32_t val0, uint32_t val1)
+{
+    uint32_t v0 = val0;
+    uint32_t v1 = val1;
+    uint32_t s0 = 0;
+
+    for (uint32_t n = 0; n < 16; n++)
+    {
+        s0 += 0x9e3779b9;
+        v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
+        v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
+    }
+
+    return v0;
+}
+
+// Numerical Recipes linear congruential generator, [0, 2^24)
+inline uint32_t host_lcg(uint32_t &prev)
+{
+    constexpr uint32_t LCG_A = 1664525u;
+    constexpr uint32_t LCG_C = 1013904223u;
+    prev = (LCG_A * prev + LCG_C);
+    return prev & 0x00FFFFFF;
+}
+
+// [0, 1)
+inline float host_rnd(uint32_t &prev)
+{
+    return (static_cast<float>(host_lcg(prev)) / static_cast<float>(0x01000000));
+}
+
+// Seed is the uint32_t of an LCG stream or a HostSampler (sampler.hpp), both have a host_rnd
+template <typename Seed>
+inline float host_rnd_interval(Seed &prev, float min, float max)
+{
+    return min + host_rnd(prev) * (max - min);
+}
+
+template <typename Seed>
+inline uint32_t host_urnd_interval(Seed &prev, uint32_t min, uint32_t max)
+{
+    if (min == max)
+        return min;
+    else if (min > max)
+        return static_cast<uint32_t>(host_rnd_interval(prev, static_cast<float>(max), static_cast<float>(min)));
+    else
+        return static_cast<uint32_t>(host_rnd_interval(prev, static_cast<float>(min), static_cast<float>(max)));
+}
+
+//////////////////////////////// SAMPLING //////////////////////////////////////
+
+inline bool host_normal_near_zero(glm::vec3 v)
+{
+    constexpr float s = 1e-8f;
+    return (std::abs(v.x) < s) && (std::abs(v.y) < s) && (std::abs(v.z) < s);
+}
+
+template <typename Seed>
+inline glm::vec3 host_random_in_unit_sphere(Seed &seed)
+{
+    while (true)
+    {
+        // Sequenced like the GLSL constructor (argument evaluation order is unspecified in C++)
+        float x = host_rnd_interval(seed, -1.0f, 1.0f);
+        float y = host_rnd_interval(seed, -1.0f, 1.0f);
+        float z = host_rnd_interval(seed, -1.0f, 1.0f);
+        glm::vec3 p = glm::vec3(x, y, z);
+        if (glm::dot(p, p) >= 1.0f)
+            continue;
+        return p;
+    }
+}
+
+template <typename Seed>
+inline glm::vec3 host_random_unit_vector(Seed &seed)
+{
+    return glm::normalize(host_random_in_unit_sphere(seed));
+}
+
+template <typename Seed>
+inline glm::vec3 host_random_cosine_direction(Seed &seed, glm::vec3 normal)
+{
+    float r1 = host_rnd(seed);
+    float r2 = host_rnd(seed);
+    float z = std::sqrt(1.0f - r2);
+
+    float phi = 2.0f * DAXA_PI * r1;
+    float x = std::cos(phi) * std::sqrt(r2);
+    float y = std::sin(phi) * std::sqrt(r2);
+
+    glm::vec3 u = std::abs(normal.x) > 0.1f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    u = glm::normalize(glm::cross(normal, u));
+    glm::vec3 v = glm::cross(normal, u);
+
+    return x * u + y * v + z * normal;
+}
+
+inline void host_calculate_orthonormal_basis(glm::vec3 normal, glm::vec3 &tangent1, glm::vec3 &tangent2)
+{
+    if (std::abs(normal.x) > std::abs(normal.y))
+        tangent1 = glm::normalize(glm::vec3(-normal.z, 0.0f, normal.x));
+    else
+        tangent1 = glm::normalize(glm::vec3(0.0f, normal.z, -normal.y));
+    tangent2 = glm::normalize(glm::cross(normal, tangent1));
+}
+
+inline glm::vec3 host_reflection(glm::vec3 v, glm::vec3 n)
+{
+    return v - 2.0f * glm::dot(v, n) * n;
+}
+
+// Schlick's approximation
+inline float host_reflectance(float cosine, float ref_idx)
+{
+    float r0 = (1.0f - ref_idx) / (1.0f + ref_idx);
+    r0 = r0 * r0;
+    return r0 + (1.0f - r0) * std::pow((1.0f - cosine), 5.0f);
+}
+
+inline glm::vec3 host_refraction(glm::vec3 uv, glm::vec3 n, float etai_over_etat)
+{
+    float cos_theta = std::min(glm::dot(-uv, n), 1.0f);
+    glm::vec3 r_out_perp = etai_over_etat * (uv + cos_theta * n);
+    glm::vec3 r_out_parallel = -std::sqrt(std::abs(1.0f - glm::dot(r_out_perp, r_out_perp))) * n;
+    return r_out_parallel + r_out_perp;
+}
+
+// Scatter callables (rcall_scatter.glsl), false when the path ends (metal scattering below the surface)
+template <typename Seed>
+inline bool host_scatter(MATERIAL const &mat, glm::vec3 ray_dir, glm::vec3 nrm, Seed &seed, glm::vec3 &scatter_dir)
+{
+    switch (mat.type & MATERIAL_TYPE_MASK)
+    {
+    case MATERIAL_TYPE_METAL:
+    {
+        glm::vec3 reflected = host_reflection(ray_dir, nrm);
+        scatter_dir = std::min(mat.roughness, 1.0f) * host_random_cosine_direction(seed, reflected) + (1.0f - mat.roughness) * reflected;
+        return glm::dot(scatter_dir, nrm) > 0.0f;
+    }
+    case MATERIAL_TYPE_DIELECTRIC:
+    {
+        float etai_over_etat = mat.ior;
+        if (glm::dot(ray_dir, nrm) > 0.0f)
+        {
+            nrm = -nrm;
+            etai_over_etat = 1.0f / etai_over_etat;
+        }
+
+        float cos_theta = std::min(glm::dot(-ray_dir, nrm), 1.0f);
+        float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+
+        bool cannot_refract = etai_over_etat * sin_theta > 1.0f;
+
+        if (cannot_refract || host_reflectance(cos_theta, etai_over_etat) > host_rnd(seed))
+            scatter_dir = host_reflection(ray_dir, nrm);
+        else
+            scatter_dir = host_refraction(ray_dir, nrm, etai_over_etat);
+        return true;
+    }
+    case MATERIAL_TYPE_CONSTANT_MEDIUM:
+    {
+        scatter_dir = host_random_unit_vector(seed);
+        if (host_normal_near_zero(scatter_dir))
+            scatter_dir = nrm;
+        return true;
+    }
+    case MATERIAL_TYPE_LAMBERTIAN:
+    default:
+    {
+        scatter_dir = host_random_cosine_direction(seed, nrm);
+        if (host_normal_near_zero(scatter_dir))
+            scatter_dir = nrm;
+        return true;
+    }
+    }
+}
+
+//////////////////////////////// MATERIALS //////////////////////////////////////
+
+inline glm::vec3 to_glm(daxa_f32vec3 const &v) { return glm::vec3(v.x, v.y, v.z); }
+inline daxa_f32vec3 to_daxa(glm::vec3 const &v) { return daxa_f32vec3{v.x, v.y, v.z}; }
+
+// Includes the cosine term
+inline glm::vec3 host_get_diffuse_BRDF(MATERIAL const &mat, glm::vec3 wo, glm::vec3 wi)
+{
+    if (std::min(wo.z, wi.z) < HOST_MIN_COS_THETA)
+        return glm::vec3(0.0f);
+    return to_glm(mat.diffuse) * INV_DAXA_PI * wi.z;
+}
+
+inline glm::vec3 host_get_metal_BRDF(MATERIAL const &mat, glm::vec3 light_dir, glm::vec3 view_dir)
+{
+    glm::vec3 half_dir = glm::normalize(light_dir + view_dir);
+    glm::vec3 fresnel = std::min(mat.roughness, 1.0f) + (glm::vec3(1.0f) - std::min(mat.roughness, 1.0f)) * std::pow(1.0f - glm::dot(light_dir, half_dir), 5.0f);
+    glm::vec3 diffuse = (glm::vec3(1.0f) - fresnel) * (glm::vec3(1.0f) - to_glm(mat.specular));
+    glm::vec3 specular = fresnel * to_glm(mat.specular);
+    return (diffuse + specular) * INV_DAXA_PI;
+}
+
+inline glm::vec3 host_get_dialectric_BRDF(MATERIAL const &mat, glm::vec3 light_dir, glm::vec3 view_dir)
+{
+    glm::vec3 fresnel = mat.roughness + (glm::vec3(1.0f) - mat.roughness) * std::pow(1.0f - glm::dot(light_dir, view_dir), 5.0f);
+    glm::vec3 specular = fresnel;
+    glm::vec3 diffuse = (glm::vec3(1.0f) - fresnel) * (to_glm(mat.diffuse) * INV_DAXA_PI);
+    return diffuse + specular;
+}
+
+inline glm::vec3 host_get_constant_medium_BRDF(MATERIAL const &mat)
+{
+    return to_glm(mat.diffuse) * INV_DAXA_4PI;
+}
+
+// NOTE: same (dot(u, w), dot(v2, w), dot(v, w)) frame as the shader, only z (cosine to n) is used
+inline glm::vec3 host_to_local(glm::vec3 n, glm::vec3 v)
+{
+    glm::vec3 u = {}, v2 = {};
+    glm::vec3 w = glm::normalize(n);
+    host_calculate_orthonormal_basis(w, u, v2);
+    return glm::vec3(glm::dot(u, w), glm::dot(v2, w), glm::dot(v, w));
+}
+
+inline glm::vec3 host_evaluate_material(MATERIAL const &mat, glm::vec3 n, glm::vec3 wo, glm::vec3 wi)
+{
+    switch (mat.type & MATERIAL_TYPE_MASK)
+    {
+    case MATERIAL_TYPE_METAL:
+        return host_get_metal_BRDF(mat, wi, wo);
+    case MATERIAL_TYPE_DIELECTRIC:
+        return host_get_dialectric_BRDF(mat, wi, wo);
+    case MATERIAL_TYPE_CONSTANT_MEDIUM:
+        return host_get_constant_medium_BRDF(mat);
+    default:
+        return host_get_diffuse_BRDF(mat, host_to_local(n, wo), host_to_local(n, wi));
+    }
+}
+
+inline float host_sample_material_pdf(MATERIAL const &mat, glm::vec3 n, glm::vec3 wo, glm::vec3 wi)
+{
+    switch (mat.type & MATERIAL_TYPE_MASK)
+    {
+    case MATERIAL_TYPE_METAL:
+    case MATERIAL_TYPE_DIELECTRIC:
+        return DAXA_2PI;
+    case MATERIAL_TYPE_CONSTANT_MEDIUM:
+        return DAXA_4PI;
+    default:
+    {
+#if HOST_COSINE_HEMISPHERE_SAMPLING == 1
+        glm::vec3 wo_l = host_to_local(n, wo);
+        glm::vec3 wi_l = host_to_local(n, wi);
+        if (std::min(wo_l.z, wi_l.z) < HOST_MIN_COS_THETA)
+            return 0.0f;
+        return INV_DAXA_PI * wi_l.z;
+#else
+        return INV_DAXA_2PI;
+#endif // HOST_COSINE_HEMISPHERE_SAMPLING
+    }
+    }
+}
+
+//////////////////////////////// SKY //////////////////////////////////////
+
+inline glm::vec3 host_sky_gradient(glm::vec3 dir, glm::vec3 bottom, glm::vec3 top)
+{
+    glm::vec3 unit_dir = glm::normalize(dir);
+    float t = 0.5f * (unit_dir.y + 1.0f);
+    return glm::mix(bottom, top, t);
+}
+
+inline glm::vec3 host_day_light_background_color(glm::vec3 dir) { return host_sky_gradient(dir, {1.0f, 1.0f, 1.0f}, {0.5f, 0.7f, 1.0f}); }
+inline glm::vec3 host_night_light_background_color(glm::vec3 dir) { return host_sky_gradient(dir, {0.2f, 0.2f, 0.3f}, {0.2f, 0.2f, 0.5f}); }
+inline glm::vec3 host_sunset_background_color(glm::vec3 dir) { return host_sky_gradient(dir, {0.8f, 0.4f, 0.0f}, {1.0f, 0.4f, 0.0f}); }
+inline glm::vec3 host_sunrise_background_color(glm::vec3 dir) { return host_sky_gradient(dir, {0.7f, 0.35f, 0.0f}, {0.8f, 0.4f, 0.0f}); }
+
+// Same transitions as the miss shader (mat.glsl calculate_sky_color), mixed by the raw time
+inline glm::vec3 host_calculate_sky_color(float time, bool is_afternoon, glm::vec3 dir)
+{
+    constexpr float night_duration = 0.5f;
+    constexpr float sunrise_duration = 0.10f;
+    constexpr float full_daylight_transition = 0.10f;
+    constexpr float full_night_transition = 0.10f;
+
+    constexpr float sunrise_end = night_duration + sunrise_duration;
+    constexpr float sunrise_to_daylight = sunrise_end + full_daylight_transition;
+    constexpr float zenith_transition = 1.0f - sunrise_to_daylight;
+
+    constexpr float daylight_end = 1.0f - zenith_transition;
+    constexpr float sunset_start = 1.0f - zenith_transition - sunrise_duration;
+    constexpr float sunset_end = 1.0f - zenith_transition - sunrise_duration - full_night_transition;
+
+    float t = time;
+
+    if (is_afternoon)
+    {
+        if (t < night_duration)
+            return host_night_light_background_color(dir);
+        else if (t < sunrise_end)
+            return glm::mix(host_night_light_background_color(dir), host_sunrise_background_color(dir), t);
+        else if (t < sunrise_to_daylight)
+            return glm::mix(host_sunrise_background_color(dir), host_sunset_background_color(dir), t);
+        else
+            return glm::mix(host_sunset_background_color(dir), host_day_light_background_color(dir), t);
+    }
+    else
+    {
+        if (t > daylight_end)
+            return glm::mix(host_sunrise_background_color(dir), host_day_light_background_color(dir), t);
+        else if (t > sunset_start)
+            return glm::mix(host_sunset_background_color(dir), host_sunrise_background_color(dir), t);
+        else if (t > sunset_end)
+            return glm::mix(host_night_light_background_color(dir), host_sunset_background_color(dir), t);
+        else
+            return host_night_light_background_color(dir);
+    }
+}
+
+//////////////////////////////// LIGHTS //////////////////////////////////////
+
+inline float host_luminance(glm::vec3 linear_rgb)
+{
+    return glm::dot(glm::vec3(0.2126f, 0.7152f, 0.0722f), linear_rgb);
+}
+
+// Power of a cube light: pi * L * area of its 6 faces, scaled by the instance (Nanson's formula)
+inline float host_get_cube_light_power(glm::mat3 const &obj2world, float size, glm::vec3 emissive)
+{
+    float determinant = std::abs(glm::determinant(obj2world));
+    glm::mat3 normal_matrix = glm::inverse(glm::transpose(obj2world));
+    float area = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        glm::vec3 normal = glm::vec3(0.0f);
+        normal[axis] = 1.0f;
+        area += 2.0f * size * size * determinant * glm::length(normal_matrix * normal);
+    }
+    return std::max(DAXA_PI * host_luminance(emissive) * area, 0.0f);
+}
+
+inline float host_geom_fact_sa(glm::vec3 P, glm::vec3 P_surf, glm::vec3 n_surf)
+{
+    glm::vec3 dir = glm::normalize(P_surf - P);
+    float dist2 = glm::dot(P_surf - P, P_surf - P);
+    return std::abs(glm::dot(n_surf, dir)) / dist2;
+}
+
+inline float host_eval_mis(float f_pdf, float g_pdf)
+{
+#if HOST_USE_POWER_HEURISTIC == 1
+    float f = f_pdf * f_pdf;
+    float g = g_pdf * g_pdf;
+#else
+    float f = f_pdf;
+    float g = g_pdf;
+#endif // HOST_USE_POWER_HEURISTIC
+    return f + g > 0.0f ? f / (f + g) : 0.0f;
+}
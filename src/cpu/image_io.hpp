@@ -0,0 +1,197 @@
+#pragma once
+#include "defines.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+// Linear float images (PFM) for references & comparisons, 8 bit sRGB (PPM) previews.
+// Images are row major, top row first. Readers give linear values whatever the file stores.
+
+inline bool write_pfm(std::filesystem::path const &path, uint32_t width, uint32_t height, std::vector<glm::vec3> const &pixels)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+#if WARN
+        std::cerr << "write_pfm: could not open " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    // Negative scale means little endian, rows are stored bottom to top
+    file << "PF\n"
+         << width << " " << height << "\n-1.0\n";
+    for (uint32_t y = height; y-- > 0;)
+        file.write(reinterpret_cast<char const *>(pixels.data() + static_cast<size_t>(y) * width), sizeof(glm::vec3) * width);
+
+    return file.good();
+}
+
+// Color (PF) or grayscale (Pf) PFM of any endianness, grayscale is copied to the 3 channels
+inline bool read_pfm(std::filesystem::path const &path, uint32_t &width, uint32_t &height, std::vector<glm::vec3> &pixels)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string magic = {};
+    float scale = 0.0f;
+    file >> magic >> width >> height >> scale;
+    if (!file.good() || (magic != "PF" && magic != "Pf") || width == 0 || height == 0 || scale == 0.0f)
+    {
+#if WARN
+        std::cerr << "read_pfm: could not read " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+    // Single white space after the scale
+    file.get();
+
+    uint32_t channel_count = magic == "PF" ? 3 : 1;
+    std::vector<float> values(static_cast<size_t>(width) * height * channel_count);
+    file.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(float));
+    if (!file.good())
+    {
+#if WARN
+        std::cerr << "read_pfm: " << path.string() << " is truncated" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    // Negative scale means little endian
+    if ((scale < 0.0f) != (std::endian::native == std::endian::little))
+    {
+        for (auto &value : values)
+        {
+            uint32_t bits = std::bit_cast<uint32_t>(value);
+            bits = (bits >> 24) | ((bits >> 8) & 0xFF00u) | ((bits << 8) & 0xFF0000u) | (bits << 24);
+            value = std::bit_cast<float>(bits);
+        }
+    }
+
+    // Rows are stored bottom to top
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        float const *row = values.data() + static_cast<size_t>(height - 1 - y) * width * channel_count;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            glm::vec3 &pixel = pixels[static_cast<size_t>(y) * width + x];
+            for (uint32_t c = 0; c < 3; ++c)
+                pixel[c] = row[x * channel_count + (channel_count == 3 ? c : 0)];
+        }
+    }
+    return true;
+}
+
+// mat.glsl fromLinear
+inline float linear_to_srgb(float linear)
+{
+    return linear < 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+// Inverse of linear_to_srgb
+inline float srgb_to_linear(float srgb)
+{
+    return srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+}
+
+inline bool write_ppm(std::filesystem::path const &path, uint32_t width, uint32_t height, std::vector<glm::vec3> const &pixels)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+#if WARN
+        std::cerr << "write_ppm: could not open " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    file << "P6\n"
+         << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            glm::vec3 const &pixel = pixels[static_cast<size_t>(y) * width + x];
+            for (uint32_t c = 0; c < 3; ++c)
+                row[x * 3 + c] = static_cast<uint8_t>(std::clamp(linear_to_srgb(std::max(pixel[c], 0.0f)), 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        file.write(reinterpret_cast<char const *>(row.data()), row.size());
+    }
+
+    return file.good();
+}
+
+// Binary PPM (P6) with 8 or 16 bit samples, decoded from sRGB to linear
+inline bool read_ppm(std::filesystem::path const &path, uint32_t &width, uint32_t &height, std::vector<glm::vec3> &pixels)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    // Header fields may be separated by comments
+    auto read_field = [&file](uint32_t &value) -> bool
+    {
+        file >> std::ws;
+        while (file.peek() == '#')
+        {
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            file >> std::ws;
+        }
+        return static_cast<bool>(file >> value);
+    };
+
+    std::string magic = {};
+    uint32_t max_value = 0;
+    file >> magic;
+    if (magic != "P6" || !read_field(width) || !read_field(height) || !read_field(max_value) ||
+        width == 0 || height == 0 || max_value == 0 || max_value > 65535)
+    {
+#if WARN
+        std::cerr << "read_ppm: could not read " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+    file.get();
+
+    uint32_t sample_size = max_value < 256 ? 1 : 2;
+    std::vector<uint8_t> samples(static_cast<size_t>(width) * height * 3 * sample_size);
+    file.read(reinterpret_cast<char *>(samples.data()), samples.size());
+    if (!file.good())
+    {
+#if WARN
+        std::cerr << "read_ppm: " << path.string() << " is truncated" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    // 16 bit samples are big endian
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            size_t sample = (i * 3 + c) * sample_size;
+            uint32_t value = sample_size == 1 ? samples[sample] : (static_cast<uint32_t>(samples[sample]) << 8) | samples[sample + 1];
+            pixels[i][c] = srgb_to_linear(static_cast<float>(value) / static_cast<float>(max_value));
+        }
+    }
+    return true;
+}
+
+// PFM or PPM from the extension
+inline bool read_image(std::filesystem::path const &path, uint32_t &width, uint32_t &height, std::vector<glm::vec3> &pixels)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".pfm")
+        return read_pfm(path, width, height, pixels);
+    if (extension == ".ppm")
+        return read_ppm(path, width, height, pixels);
+#if WARN
+    std::cerr << "read_image: unknown format " << path.string() << std::endl;
+#endif // WARN
+    return false;
+}
@@ -0,0 +1,570 @@
+#pragma once
+#include "defines.h"
+#include "box_intersect_x8.hpp"
+#include "image_io.hpp"
+#include "tile_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+// Metrics of a test image against a reference, the quality gate of sampling & reuse changes:
+// MSE & relMSE on the linear values, PSNR & SSIM on the sRGB preview values (clamped to [0, 1]) and
+// LDR FLIP (Andersson et al. 2020) on the clamped linear values, HDR FLIP's exposure bracketing is not done.
+// Images are split in bands of rows over a TilePool, convolutions & per pixel sums run 8 pixels at a time (f32x8).
+// Borders are clamped to the edge.
+
+struct ImageMetrics
+{
+    double mse = 0.0;
+    double rel_mse = 0.0;
+    double psnr = 0.0; // dB, infinity for identical images
+    double ssim = 1.0;
+    double flip = 0.0;
+};
+
+struct ImageMetricSettings
+{
+    float rel_mse_epsilon = 0.01f;     // keeps dark pixels from dominating relMSE
+    float pixels_per_degree = 67.02f;  // FLIP default: 0.7 m wide 3840 pixels monitor seen from 0.7 m
+};
+
+//////////////////////////////// PLANES //////////////////////////////////////
+
+// One channel of an image, row major, top row first
+struct ImagePlane
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> values = {};
+
+    ImagePlane() = default;
+    ImagePlane(uint32_t plane_width, uint32_t plane_height)
+        : width(plane_width), height(plane_height), values(static_cast<size_t>(plane_width) * plane_height, 0.0f) {}
+
+    float *row(uint32_t y) { return values.data() + static_cast<size_t>(y) * width; }
+    float const *row(uint32_t y) const { return values.data() + static_cast<size_t>(y) * width; }
+};
+
+// Constants of the element wise operations, which run on floats (tails) and on f32x8 lanes
+template <typename T>
+inline T splat(float a);
+template <>
+inline float splat<float>(float a) { return a; }
+template <>
+inline f32x8 splat<f32x8>(float a) { return f32x8_set(a); }
+
+#define IMAGE_BAND_ROW_COUNT 16
+
+inline uint32_t get_band_count(uint32_t height) { return (height + IMAGE_BAND_ROW_COUNT - 1) / IMAGE_BAND_ROW_COUNT; }
+
+// task(first_row, end_row, band) for every band of rows
+template <typename Task>
+inline void for_each_band(uint32_t height, TilePool &pool, Task &&task)
+{
+    pool.run(get_band_count(height), [&](uint32_t band, uint32_t)
+             {
+        uint32_t first_row = band * IMAGE_BAND_ROW_COUNT;
+        task(first_row, std::min(height, first_row + IMAGE_BAND_ROW_COUNT), band); });
+}
+
+// out = op(inputs...) per pixel
+template <typename Op, typename... Planes>
+inline void map_planes(TilePool &pool, ImagePlane &out, Op &&op, Planes const &...inputs)
+{
+    for_each_band(out.height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t)
+                  {
+        for (uint32_t y = first_row; y < end_row; ++y)
+        {
+            float *out_row = out.row(y);
+            uint32_t x = 0;
+            for (; x + BOX_LANE_COUNT <= out.width; x += BOX_LANE_COUNT)
+                f32x8_storeu(out_row + x, op(f32x8_loadu(inputs.row(y) + x)...));
+            for (; x < out.width; ++x)
+                out_row[x] = op(inputs.row(y)[x]...);
+        } });
+}
+
+// Sum of op(inputs...) over the pixels, rows are summed in float lanes & the rest in double, in band order
+template <typename Op, typename... Planes>
+inline double sum_planes(TilePool &pool, uint32_t width, uint32_t height, Op &&op, Planes const &...inputs)
+{
+    std::vector<double> band_sums(get_band_count(height), 0.0);
+    for_each_band(height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t band)
+                  {
+        alignas(32) float lanes[BOX_LANE_COUNT];
+        for (uint32_t y = first_row; y < end_row; ++y)
+        {
+            f32x8 row_sum = f32x8_set(0.0f);
+            uint32_t x = 0;
+            for (; x + BOX_LANE_COUNT <= width; x += BOX_LANE_COUNT)
+                row_sum = row_sum + op(f32x8_loadu(inputs.row(y) + x)...);
+            f32x8_store(lanes, row_sum);
+
+            double sum = 0.0;
+            for (float lane : lanes)
+                sum += lane;
+            for (; x < width; ++x)
+                sum += op(inputs.row(y)[x]...);
+            band_sums[band] += sum;
+        } });
+
+    double sum = 0.0;
+    for (double band_sum : band_sums)
+        sum += band_sum;
+    return sum;
+}
+
+// out = kernel_y * (kernel_x * in), kernels of odd size centered on the pixel. out may be in.
+inline void convolve_separable(ImagePlane const &in, std::vector<float> const &kernel_x, std::vector<float> const &kernel_y,
+                               ImagePlane &out, TilePool &pool)
+{
+    uint32_t width = in.width;
+    uint32_t height = in.height;
+    int32_t radius_x = static_cast<int32_t>(kernel_x.size() / 2);
+    int32_t radius_y = static_cast<int32_t>(kernel_y.size() / 2);
+
+    ImagePlane horizontal(width, height);
+    for_each_band(height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t)
+                  {
+        std::vector<float> padded(width + 2 * radius_x);
+        for (uint32_t y = first_row; y < end_row; ++y)
+        {
+            float const *in_row = in.row(y);
+            for (int32_t x = 0; x < static_cast<int32_t>(padded.size()); ++x)
+                padded[x] = in_row[std::clamp(x - radius_x, 0, static_cast<int32_t>(width) - 1)];
+
+            float *out_row = horizontal.row(y);
+            uint32_t x = 0;
+            for (; x + BOX_LANE_COUNT <= width; x += BOX_LANE_COUNT)
+            {
+                f32x8 sum = f32x8_set(0.0f);
+                for (size_t k = 0; k < kernel_x.size(); ++k)
+                    sum = sum + f32x8_set(kernel_x[k]) * f32x8_loadu(padded.data() + x + k);
+                f32x8_storeu(out_row + x, sum);
+            }
+            for (; x < width; ++x)
+            {
+                float sum = 0.0f;
+                for (size_t k = 0; k < kernel_x.size(); ++k)
+                    sum += kernel_x[k] * padded[x + k];
+                out_row[x] = sum;
+            }
+        } });
+
+    out = ImagePlane(width, height);
+    for_each_band(height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t)
+                  {
+        std::vector<float const *> rows(kernel_y.size());
+        for (uint32_t y = first_row; y < end_row; ++y)
+        {
+            for (size_t k = 0; k < kernel_y.size(); ++k)
+                rows[k] = horizontal.row(static_cast<uint32_t>(std::clamp(static_cast<int32_t>(y + k) - radius_y, 0, static_cast<int32_t>(height) - 1)));
+
+            float *out_row = out.row(y);
+            uint32_t x = 0;
+            for (; x + BOX_LANE_COUNT <= width; x += BOX_LANE_COUNT)
+            {
+                f32x8 sum = f32x8_set(0.0f);
+                for (size_t k = 0; k < kernel_y.size(); ++k)
+                    sum = sum + f32x8_set(kernel_y[k]) * f32x8_loadu(rows[k] + x);
+                f32x8_storeu(out_row + x, sum);
+            }
+            for (; x < width; ++x)
+            {
+                float sum = 0.0f;
+                for (size_t k = 0; k < kernel_y.size(); ++k)
+                    sum += kernel_y[k] * rows[k][x];
+                out_row[x] = sum;
+            }
+        } });
+}
+
+// Normalized 1D gaussian
+inline std::vector<float> get_gaussian_kernel(float sigma, int32_t radius)
+{
+    std::vector<float> kernel(2 * radius + 1);
+    float sum = 0.0f;
+    for (int32_t x = -radius; x <= radius; ++x)
+    {
+        kernel[x + radius] = std::exp(-static_cast<float>(x * x) / (2.0f * sigma * sigma));
+        sum += kernel[x + radius];
+    }
+    for (auto &weight : kernel)
+        weight /= sum;
+    return kernel;
+}
+
+//////////////////////////////// ERRORS //////////////////////////////////////
+
+// Preview value of mat.glsl fromLinear, what PSNR & SSIM look at
+inline float get_display_value(float linear)
+{
+    return linear_to_srgb(std::clamp(linear, 0.0f, 1.0f));
+}
+
+// Structural similarity (Wang et al. 2004) of the preview luminance, 11x11 gaussian window of sigma 1.5
+inline double get_ssim(ImagePlane const &reference, ImagePlane const &test, TilePool &pool)
+{
+    std::vector<float> window = get_gaussian_kernel(1.5f, 5);
+
+    uint32_t width = reference.width;
+    uint32_t height = reference.height;
+    ImagePlane mean_reference = {}, mean_test = {};
+    ImagePlane reference_squared(width, height), test_squared(width, height), product(width, height);
+
+    auto multiply = [](auto a, auto b)
+    { return a * b; };
+    map_planes(pool, reference_squared, multiply, reference, reference);
+    map_planes(pool, test_squared, multiply, test, test);
+    map_planes(pool, product, multiply, reference, test);
+
+    convolve_separable(reference, window, window, mean_reference, pool);
+    convolve_separable(test, window, window, mean_test, pool);
+    convolve_separable(reference_squared, window, window, reference_squared, pool);
+    convolve_separable(test_squared, window, window, test_squared, pool);
+    convolve_separable(product, window, window, product, pool);
+
+    double sum = sum_planes(pool, width, height, [](auto mx, auto my, auto mxx, auto myy, auto mxy)
+                            {
+        using T = decltype(mx);
+        constexpr float C1 = 0.01f * 0.01f;
+        constexpr float C2 = 0.03f * 0.03f;
+        T variance_x = mxx - mx * mx;
+        T variance_y = myy - my * my;
+        T covariance = mxy - mx * my;
+        return ((splat<T>(2.0f) * mx * my + splat<T>(C1)) * (splat<T>(2.0f) * covariance + splat<T>(C2))) /
+               ((mx * mx + my * my + splat<T>(C1)) * (variance_x + variance_y + splat<T>(C2))); },
+                            mean_reference, mean_test, reference_squared, test_squared, product);
+
+    return sum / (static_cast<double>(width) * height);
+}
+
+//////////////////////////////// FLIP //////////////////////////////////////
+
+// Color spaces of FLIP, D65 white of linear sRGB
+inline glm::vec3 linear_rgb_to_xyz(glm::vec3 const &rgb)
+{
+    return {0.41238656f * rgb.x + 0.35759149f * rgb.y + 0.18045049f * rgb.z,
+            0.21263682f * rgb.x + 0.71518298f * rgb.y + 0.07218031f * rgb.z,
+            0.01933062f * rgb.x + 0.11919716f * rgb.y + 0.95037259f * rgb.z};
+}
+
+inline glm::vec3 xyz_to_linear_rgb(glm::vec3 const &xyz)
+{
+    return {3.24100326f * xyz.x - 1.53739899f * xyz.y - 0.49861587f * xyz.z,
+            -0.96922426f * xyz.x + 1.87592999f * xyz.y + 0.04155422f * xyz.z,
+            0.05563942f * xyz.x - 0.20401120f * xyz.y + 1.05714897f * xyz.z};
+}
+
+inline glm::vec3 get_flip_white() { return linear_rgb_to_xyz(glm::vec3(1.0f)); }
+
+inline glm::vec3 xyz_to_ycxcz(glm::vec3 const &xyz)
+{
+    glm::vec3 c = xyz / get_flip_white();
+    return {116.0f * c.y - 16.0f, 500.0f * (c.x - c.y), 200.0f * (c.y - c.z)};
+}
+
+inline glm::vec3 ycxcz_to_xyz(glm::vec3 const &ycxcz)
+{
+    float y = (ycxcz.x + 16.0f) / 116.0f;
+    return glm::vec3(ycxcz.y / 500.0f + y, y, y - ycxcz.z / 200.0f) * get_flip_white();
+}
+
+// CIELAB with the Hunt adjustment of FLIP (chroma scaled by 0.01 L)
+inline glm::vec3 linear_rgb_to_hunt_lab(glm::vec3 const &rgb)
+{
+    constexpr float delta = 6.0f / 29.0f;
+    glm::vec3 c = linear_rgb_to_xyz(rgb) / get_flip_white();
+    for (int i = 0; i < 3; ++i)
+        c[i] = c[i] > delta * delta * delta ? std::cbrt(c[i]) : c[i] / (3.0f * delta * delta) + 4.0f / 29.0f;
+    float l = 116.0f * c.y - 16.0f;
+    return {l, 0.01f * l * 500.0f * (c.x - c.y), 0.01f * l * 200.0f * (c.y - c.z)};
+}
+
+inline float get_hyab(glm::vec3 const &a, glm::vec3 const &b)
+{
+    return std::abs(a.x - b.x) + std::sqrt((a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+}
+
+struct FlipFilters
+{
+    // Contrast sensitivity of the Y, Cx & Cz channels as sums of separable gaussians: (weight, kernel)
+    std::vector<std::pair<float, std::vector<float>>> csf[3] = {};
+    std::vector<float> feature_gaussian = {};
+    std::vector<float> edge = {};
+    std::vector<float> point = {};
+};
+
+inline FlipFilters get_flip_filters(float pixels_per_degree)
+{
+    constexpr float PI = std::numbers::pi_v<float>;
+    FlipFilters filters = {};
+
+    // (a, b) of the two gaussians of every channel, same radius for all of them
+    constexpr float CSF_PARAMETERS[3][2][2] = {
+        {{1.0f, 0.0047f}, {0.0f, 1e-5f}},
+        {{1.0f, 0.0053f}, {0.0f, 1e-5f}},
+        {{34.1f, 0.04f}, {13.5f, 0.025f}},
+    };
+    int32_t radius = static_cast<int32_t>(std::ceil(3.0f * std::sqrt(0.04f / (2.0f * PI * PI)) * pixels_per_degree));
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        // 2D kernel a sqrt(pi / b) exp(-pi^2 r^2 / b) is the product of two 1D ones, normalized over the sum of terms
+        float total = 0.0f;
+        std::vector<float> term_weights = {};
+        for (auto const &[a, b] : CSF_PARAMETERS[channel])
+        {
+            if (a == 0.0f)
+                continue;
+            std::vector<float> kernel(2 * radius + 1);
+            float sum = 0.0f;
+            for (int32_t x = -radius; x <= radius; ++x)
+            {
+                float degrees = static_cast<float>(x) / pixels_per_degree;
+                kernel[x + radius] = std::exp(-PI * PI * degrees * degrees / b);
+                sum += kernel[x + radius];
+            }
+            for (auto &weight : kernel)
+                weight /= sum;
+            float weight = a * std::sqrt(PI / b) * sum * sum;
+            total += weight;
+            filters.csf[channel].push_back({weight, std::move(kernel)});
+        }
+        for (auto &term : filters.csf[channel])
+            term.first /= total;
+    }
+
+    // First & second derivatives of a gaussian, positive & negative weights normalized to 1 & -1
+    float sigma = 0.5f * 0.082f * pixels_per_degree;
+    int32_t feature_radius = static_cast<int32_t>(std::ceil(3.0f * sigma));
+    filters.feature_gaussian = get_gaussian_kernel(sigma, feature_radius);
+    filters.edge.resize(2 * feature_radius + 1);
+    filters.point.resize(2 * feature_radius + 1);
+    for (int32_t x = -feature_radius; x <= feature_radius; ++x)
+    {
+        float g = std::exp(-static_cast<float>(x * x) / (2.0f * sigma * sigma));
+        filters.edge[x + feature_radius] = -static_cast<float>(x) * g;
+        filters.point[x + feature_radius] = (static_cast<float>(x * x) / (sigma * sigma) - 1.0f) * g;
+    }
+    for (auto *kernel : {&filters.edge, &filters.point})
+    {
+        float positive = 0.0f, negative = 0.0f;
+        for (float weight : *kernel)
+            (weight > 0.0f ? positive : negative) += weight;
+        for (auto &weight : *kernel)
+            weight = weight > 0.0f ? weight / positive : (weight < 0.0f ? -weight / negative : 0.0f);
+    }
+    return filters;
+}
+
+// Mean LDR FLIP, flip_map (if given) gets the error of every pixel
+inline double get_flip(std::vector<glm::vec3> const &reference, std::vector<glm::vec3> const &test, uint32_t width, uint32_t height,
+                       TilePool &pool, float pixels_per_degree, std::vector<float> *flip_map = nullptr)
+{
+    constexpr float QC = 0.7f;
+    constexpr float QF = 0.5f;
+    constexpr float PC = 0.4f;
+    constexpr float PT = 0.95f;
+
+    FlipFilters filters = get_flip_filters(pixels_per_degree);
+
+    // YCxCz of the clamped images
+    ImagePlane planes[2][3] = {};
+    std::vector<glm::vec3> const *images[2] = {&reference, &test};
+    for (int image = 0; image < 2; ++image)
+    {
+        for (auto &plane : planes[image])
+            plane = ImagePlane(width, height);
+        for_each_band(height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t)
+                      {
+            for (uint32_t y = first_row; y < end_row; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    glm::vec3 ycxcz = xyz_to_ycxcz(linear_rgb_to_xyz(glm::clamp((*images[image])[static_cast<size_t>(y) * width + x], 0.0f, 1.0f)));
+                    for (int c = 0; c < 3; ++c)
+                        planes[image][c].row(y)[x] = ycxcz[c];
+                } });
+    }
+
+    // Features of the normalized luminance, before the contrast sensitivity filter
+    ImagePlane edges[2][2] = {}, points[2][2] = {};
+    for (int image = 0; image < 2; ++image)
+    {
+        ImagePlane luminance(width, height);
+        map_planes(pool, luminance, [](auto y)
+                   {
+            using T = decltype(y);
+            return (y + splat<T>(16.0f)) / splat<T>(116.0f); }, planes[image][0]);
+        convolve_separable(luminance, filters.edge, filters.feature_gaussian, edges[image][0], pool);
+        convolve_separable(luminance, filters.feature_gaussian, filters.edge, edges[image][1], pool);
+        convolve_separable(luminance, filters.point, filters.feature_gaussian, points[image][0], pool);
+        convolve_separable(luminance, filters.feature_gaussian, filters.point, points[image][1], pool);
+    }
+
+    // Contrast sensitivity filter of every channel
+    ImagePlane filtered[2][3] = {};
+    for (int image = 0; image < 2; ++image)
+        for (int c = 0; c < 3; ++c)
+        {
+            filtered[image][c] = ImagePlane(width, height);
+            for (auto const &[weight, kernel] : filters.csf[c])
+            {
+                ImagePlane term = {};
+                convolve_separable(planes[image][c], kernel, kernel, term, pool);
+                float term_weight = weight;
+                map_planes(pool, filtered[image][c], [term_weight](auto sum, auto value)
+                           {
+                    using T = decltype(sum);
+                    return sum + splat<T>(term_weight) * value; }, filtered[image][c], term);
+            }
+        }
+
+    float max_color_error = std::pow(get_hyab(linear_rgb_to_hunt_lab(glm::vec3(0.0f, 1.0f, 0.0f)), linear_rgb_to_hunt_lab(glm::vec3(0.0f, 0.0f, 1.0f))), QC);
+
+    ImagePlane errors(width, height);
+    for_each_band(height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t)
+                  {
+        for (uint32_t y = first_row; y < end_row; ++y)
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                glm::vec3 lab[2] = {};
+                for (int image = 0; image < 2; ++image)
+                {
+                    glm::vec3 ycxcz = {filtered[image][0].row(y)[x], filtered[image][1].row(y)[x], filtered[image][2].row(y)[x]};
+                    lab[image] = linear_rgb_to_hunt_lab(glm::clamp(xyz_to_linear_rgb(ycxcz_to_xyz(ycxcz)), 0.0f, 1.0f));
+                }
+
+                // Color error, compressed so small differences spread over most of [0, 1]
+                float color_error = std::pow(get_hyab(lab[0], lab[1]), QC);
+                float threshold = PC * max_color_error;
+                color_error = color_error < threshold ? PT / threshold * color_error
+                                                      : PT + (color_error - threshold) / (max_color_error - threshold) * (1.0f - PT);
+
+                float edge_difference = std::abs(std::hypot(edges[0][0].row(y)[x], edges[0][1].row(y)[x]) -
+                                                 std::hypot(edges[1][0].row(y)[x], edges[1][1].row(y)[x]));
+                float point_difference = std::abs(std::hypot(points[0][0].row(y)[x], points[0][1].row(y)[x]) -
+                                                  std::hypot(points[1][0].row(y)[x], points[1][1].row(y)[x]));
+                float feature_error = std::pow(std::max(edge_difference, point_difference) / std::numbers::sqrt2_v<float>, QF);
+
+                errors.row(y)[x] = std::pow(color_error, 1.0f - feature_error);
+            } });
+
+    if (flip_map)
+        *flip_map = errors.values;
+
+    return sum_planes(pool, width, height, [](auto error)
+                      { return error; }, errors) /
+           (static_cast<double>(width) * height);
+}
+
+//////////////////////////////// COMPARISON //////////////////////////////////////
+
+inline ImageMetrics compare_images(std::vector<glm::vec3> const &reference, std::vector<glm::vec3> const &test, uint32_t width, uint32_t height,
+                                   TilePool &pool, ImageMetricSettings const &settings = {}, std::vector<float> *flip_map = nullptr)
+{
+    ImageMetrics metrics = {};
+
+    // Planar channels: linear, preview & preview luminance
+    ImagePlane linear[2][3] = {}, display[2][3] = {}, luminance[2] = {};
+    std::vector<glm::vec3> const *images[2] = {&reference, &test};
+    for (int image = 0; image < 2; ++image)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            linear[image][c] = ImagePlane(width, height);
+            display[image][c] = ImagePlane(width, height);
+        }
+        luminance[image] = ImagePlane(width, height);
+        for_each_band(height, pool, [&](uint32_t first_row, uint32_t end_row, uint32_t)
+                      {
+            for (uint32_t y = first_row; y < end_row; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    glm::vec3 const &pixel = (*images[image])[static_cast<size_t>(y) * width + x];
+                    glm::vec3 preview = {};
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        preview[c] = get_display_value(pixel[c]);
+                        linear[image][c].row(y)[x] = pixel[c];
+                        display[image][c].row(y)[x] = preview[c];
+                    }
+                    luminance[image].row(y)[x] = glm::dot(preview, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+                } });
+    }
+
+    double sample_count = static_cast<double>(width) * height * 3.0;
+    double squared_error = 0.0, relative_error = 0.0, display_error = 0.0;
+    float epsilon = settings.rel_mse_epsilon;
+    for (int c = 0; c < 3; ++c)
+    {
+        squared_error += sum_planes(pool, width, height, [](auto r, auto t)
+                                    { return (t - r) * (t - r); }, linear[0][c], linear[1][c]);
+        relative_error += sum_planes(pool, width, height, [epsilon](auto r, auto t)
+                                     {
+            using T = decltype(r);
+            return (t - r) * (t - r) / (r * r + splat<T>(epsilon)); }, linear[0][c], linear[1][c]);
+        display_error += sum_planes(pool, width, height, [](auto r, auto t)
+                                    { return (t - r) * (t - r); }, display[0][c], display[1][c]);
+    }
+    metrics.mse = squared_error / sample_count;
+    metrics.rel_mse = relative_error / sample_count;
+    double display_mse = display_error / sample_count;
+    metrics.psnr = display_mse > 0.0 ? -10.0 * std::log10(display_mse) : std::numeric_limits<double>::infinity();
+
+    // SSIM & FLIP don't depend on each other: SSIM runs as a job of its own while this thread does FLIP, the passes of
+    // both spread over the pool
+    TileJob ssim_job = pool.submit(1, [&](uint32_t, uint32_t)
+                                   { metrics.ssim = get_ssim(luminance[0], luminance[1], pool); });
+    metrics.flip = get_flip(reference, test, width, height, pool, settings.pixels_per_degree, flip_map);
+    pool.wait(ssim_job);
+    return metrics;
+}
+
+//////////////////////////////// CONVERGENCE //////////////////////////////////////
+
+// Frame of a sequence converging to the reference, cost in ms or samples per pixel
+struct ConvergencePoint
+{
+    double cost = 0.0;
+    ImageMetrics metrics = {};
+};
+
+// Cost at which the relMSE of the curve reaches target, interpolated in log-log space between the frames around it.
+// Negative if it never does.
+inline double get_time_to_error(std::vector<ConvergencePoint> const &curve, double target_rel_mse)
+{
+    for (size_t i = 0; i < curve.size(); ++i)
+    {
+        if (curve[i].metrics.rel_mse > target_rel_mse)
+            continue;
+        if (i == 0 || curve[i - 1].cost <= 0.0 || curve[i].cost <= 0.0 || curve[i - 1].metrics.rel_mse <= 0.0 || curve[i].metrics.rel_mse <= 0.0)
+            return curve[i].cost;
+
+        double t = (std::log(target_rel_mse) - std::log(curve[i - 1].metrics.rel_mse)) /
+                   (std::log(curve[i].metrics.rel_mse) - std::log(curve[i - 1].metrics.rel_mse));
+        return std::exp(std::log(curve[i - 1].cost) + t * (std::log(curve[i].cost) - std::log(curve[i - 1].cost)));
+    }
+    return -1.0;
+}
+
+// Least squares slope of log relMSE over log cost, -1 for an unbiased Monte Carlo estimator
+inline double get_convergence_rate(std::vector<ConvergencePoint> const &curve)
+{
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (auto const &point : curve)
+    {
+        if (point.cost <= 0.0 || point.metrics.rel_mse <= 0.0)
+            continue;
+        double x = std::log(point.cost);
+        double y = std::log(point.metrics.rel_mse);
+        n += 1.0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    return (n < 2.0 || denominator == 0.0) ? 0.0 : (n * sxy - sx * sy) / denominator;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "defines.h"
+#include "tile_pool.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// Alias table of the cube lights (Walker 1977, Vose 1991): O(1) picks proportional to the power of the lights.
+// Entry i keeps light i with probability threshold & gives its alias otherwise; the pmf of light i is stored with it so
+// MIS can look it up. Built with the sweep of Hübschle-Schneider & Sanders (no work lists, one pass over the small and
+// large entries in index order): the sums & scaling run on the pool, the pairing is a single pass.
+// The layout is the GPU one (LIGHT_ALIAS, light_alias_table.glsl).
+
+struct LightAliasTable
+{
+public:
+    static constexpr uint32_t BUILD_CHUNK_SIZE = 16384;
+
+    // weights[i] >= 0, the table is empty when they all are 0
+    void build(std::vector<float> const &weights, TilePool *pool = nullptr)
+    {
+        uint32_t count = static_cast<uint32_t>(weights.size());
+        entries.assign(count, LIGHT_ALIAS{.threshold = 1.0f, .alias = 0, .pmf = 0.0f});
+        total_weight = 0.0;
+        if (count == 0)
+            return;
+
+        uint32_t chunk_count = (count + BUILD_CHUNK_SIZE - 1) / BUILD_CHUNK_SIZE;
+        auto for_each_chunk = [&](auto &&task)
+        {
+            auto run_chunk = [&](uint32_t chunk, uint32_t)
+            {
+                uint32_t first = chunk * BUILD_CHUNK_SIZE;
+                task(first, std::min(first + BUILD_CHUNK_SIZE, count));
+            };
+            if (pool && chunk_count > 1)
+                pool->run(chunk_count, run_chunk);
+            else
+                for (uint32_t chunk = 0; chunk < chunk_count; ++chunk)
+                    run_chunk(chunk, 0);
+        };
+
+        // Sums in double per chunk, added in order so the table doesn't depend on the thread count
+        std::vector<double> chunk_sums(chunk_count, 0.0);
+        for_each_chunk([&](uint32_t first, uint32_t last)
+                       {
+            double sum = 0.0;
+            for (uint32_t i = first; i < last; ++i)
+                sum += std::max(weights[i], 0.0f);
+            chunk_sums[first / BUILD_CHUNK_SIZE] = sum; });
+        total_weight = std::accumulate(chunk_sums.begin(), chunk_sums.end(), 0.0);
+        if (total_weight <= 0.0)
+        {
+            entries.clear();
+            return;
+        }
+
+        // Weights scaled so the average is 1, entries below are small & the others large
+        std::vector<double> scaled(count);
+        double scale = static_cast<double>(count) / total_weight;
+        double inv_total = 1.0 / total_weight;
+        for_each_chunk([&](uint32_t first, uint32_t last)
+                       {
+            for (uint32_t i = first; i < last; ++i)
+            {
+                double weight = std::max(weights[i], 0.0f);
+                scaled[i] = weight * scale;
+                entries[i].pmf = static_cast<float>(weight * inv_total);
+                entries[i].alias = i;
+            } });
+
+        // Sweep: i walks the small entries, j the large one giving its surplus, a large entry that drops below 1 is
+        // small itself and takes the next large one as its alias
+        auto next_small = [&](uint32_t from)
+        {
+            while (from < count && scaled[from] >= 1.0)
+                ++from;
+            return from;
+        };
+        auto next_large = [&](uint32_t from)
+        {
+            while (from < count && scaled[from] < 1.0)
+                ++from;
+            return from;
+        };
+
+        uint32_t i = next_small(0);
+        uint32_t j = next_large(0);
+        double w = j < count ? scaled[j] : 0.0;
+        while (j < count)
+        {
+            if (w >= 1.0)
+            {
+                if (i >= count)
+                    break;
+                entries[i].threshold = static_cast<float>(scaled[i]);
+                entries[i].alias = j;
+                w -= 1.0 - scaled[i];
+                i = next_small(i + 1);
+            }
+            else
+            {
+                uint32_t next = next_large(j + 1);
+                if (next >= count)
+                    break;
+                entries[j].threshold = static_cast<float>(w);
+                entries[j].alias = next;
+                w = scaled[next] - (1.0 - w);
+                j = next;
+            }
+        }
+        // Rounding leftovers keep themselves
+        for (uint32_t k = 0; k < count; ++k)
+            if (entries[k].alias == k)
+                entries[k].threshold = 1.0f;
+    }
+
+    // u_entry picks the entry & u_coin between it & its alias (a single float would leave few bits to the coin)
+    bool sample(float u_entry, float u_coin, uint32_t &light_index, float &pmf) const
+    {
+        if (entries.empty())
+            return false;
+
+        uint32_t count = static_cast<uint32_t>(entries.size());
+        uint32_t entry = std::min(static_cast<uint32_t>(u_entry * static_cast<float>(count)), count - 1);
+
+        light_index = u_coin < entries[entry].threshold ? entry : entries[entry].alias;
+        pmf = entries[light_index].pmf;
+        return pmf > 0.0f;
+    }
+
+    float get_pmf(uint32_t light_index) const { return light_index < entries.size() ? entries[light_index].pmf : 0.0f; }
+
+    // Copies the table to a host mapped buffer
+    void upload(LIGHT_ALIAS *gpu_entries) const { std::copy(entries.begin(), entries.end(), gpu_entries); }
+
+    bool empty() const { return entries.empty(); }
+    auto get_light_count() const -> uint32_t { return static_cast<uint32_t>(entries.size()); }
+    auto get_total_weight() const -> double { return total_weight; }
+    auto get_entries() const -> std::vector<LIGHT_ALIAS> const & { return entries; }
+    auto get_memory_size() const -> size_t { return entries.size() * sizeof(LIGHT_ALIAS); }
+
+private:
+    std::vector<LIGHT_ALIAS> entries = {};
+    double total_weight = 0.0;
+};
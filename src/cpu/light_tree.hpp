@@ -0,0 +1,586 @@
+#pragma once
+#include "defines.h"
+#include "host_shading.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Light tree over the cube lights (Conty Estevez & Kulla 2018, pbrt-v4 BVHLightSampler).
+// Nodes bound the world box, the power & the cone of emission of the lights below them; a light is picked by
+// walking down with the importance of both children for the shading point, its pmf is the product of the choices.
+// Every cube light is one leaf. Lights deleted by the brush are refit in place (phi 0) & restored in LIFO order as
+// ACCEL_STRUCT_MNGR backup_cube_lights, the layout is flat as the GPU reads it (LIGHT_TREE_NODE, light_tree.glsl).
+
+#define LIGHT_TREE_INFO 0
+
+//////////////////////////////// BOUNDS //////////////////////////////////////
+
+struct LightBounds
+{
+    glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 maximum = glm::vec3(-std::numeric_limits<float>::max());
+    float phi = 0.0f;
+    glm::vec3 axis = {0.0f, 0.0f, 1.0f};
+    float cos_theta_o = 1.0f; // normals within theta_o of axis
+    float cos_theta_e = 1.0f; // emission within theta_e of the normals
+
+    bool is_empty() const { return phi <= 0.0f; }
+};
+
+inline float light_tree_safe_acos(float x) { return std::acos(std::clamp(x, -1.0f, 1.0f)); }
+
+// Rotation of v by theta around the unit axis k (Rodrigues)
+inline glm::vec3 light_tree_rotate(glm::vec3 v, glm::vec3 k, float theta)
+{
+    float cos_theta = std::cos(theta);
+    float sin_theta = std::sin(theta);
+    return v * cos_theta + glm::cross(k, v) * sin_theta + k * (glm::dot(k, v) * (1.0f - cos_theta));
+}
+
+// Smallest cone holding both normal cones (pbrt DirectionCone Union)
+inline void get_light_cone_union(glm::vec3 axis_a, float cos_theta_a, glm::vec3 axis_b, float cos_theta_b,
+                                 glm::vec3 &axis, float &cos_theta)
+{
+    float theta_a = light_tree_safe_acos(cos_theta_a);
+    float theta_b = light_tree_safe_acos(cos_theta_b);
+    float theta_d = light_tree_safe_acos(glm::dot(axis_a, axis_b));
+
+    // One cone inside the other
+    if (std::min(theta_d + theta_b, DAXA_PI) <= theta_a)
+    {
+        axis = axis_a;
+        cos_theta = cos_theta_a;
+        return;
+    }
+    if (std::min(theta_d + theta_a, DAXA_PI) <= theta_b)
+    {
+        axis = axis_b;
+        cos_theta = cos_theta_b;
+        return;
+    }
+
+    float theta_o = (theta_a + theta_d + theta_b) * 0.5f;
+    if (theta_o >= DAXA_PI)
+    {
+        axis = axis_a;
+        cos_theta = -1.0f;
+        return;
+    }
+
+    // Rotate axis_a towards axis_b to the middle of the union
+    float theta_r = theta_o - theta_a;
+    glm::vec3 w_r = glm::cross(axis_a, axis_b);
+    if (glm::dot(w_r, w_r) < 1e-12f)
+    {
+        axis = axis_a;
+        cos_theta = -1.0f;
+        return;
+    }
+    axis = glm::normalize(light_tree_rotate(axis_a, glm::normalize(w_r), theta_r));
+    cos_theta = std::cos(theta_o);
+}
+
+inline LightBounds get_light_bounds_union(LightBounds const &a, LightBounds const &b)
+{
+    if (a.is_empty())
+        return b;
+    if (b.is_empty())
+        return a;
+
+    LightBounds bounds = {};
+    bounds.minimum = glm::min(a.minimum, b.minimum);
+    bounds.maximum = glm::max(a.maximum, b.maximum);
+    bounds.phi = a.phi + b.phi;
+    get_light_cone_union(a.axis, a.cos_theta_o, b.axis, b.cos_theta_o, bounds.axis, bounds.cos_theta_o);
+    bounds.cos_theta_e = std::min(a.cos_theta_e, b.cos_theta_e);
+    return bounds;
+}
+
+// A cube light emits from its 6 faces: normals in every direction (theta_o = pi) & lambertian faces (theta_e = pi / 2).
+// phi is the power of the faces (host_get_cube_light_power).
+inline LightBounds get_cube_light_bounds(glm::vec3 world_center, glm::mat3 const &obj2world, float size, glm::vec3 emissive)
+{
+    LightBounds bounds = {};
+
+    glm::vec3 extent = glm::vec3(0.0f);
+    for (int column = 0; column < 3; ++column)
+        for (int row = 0; row < 3; ++row)
+            extent[row] += std::abs(obj2world[column][row]) * size * 0.5f;
+    bounds.minimum = world_center - extent;
+    bounds.maximum = world_center + extent;
+    bounds.phi = host_get_cube_light_power(obj2world, size, emissive);
+    bounds.axis = {0.0f, 0.0f, 1.0f};
+    bounds.cos_theta_o = -1.0f;
+    bounds.cos_theta_e = 0.0f;
+    return bounds;
+}
+
+//////////////////////////////// IMPORTANCE //////////////////////////////////////
+
+// cos(max(0, theta_a - theta_b))
+inline float light_tree_cos_sub_clamped(float sin_theta_a, float cos_theta_a, float sin_theta_b, float cos_theta_b)
+{
+    if (cos_theta_a > cos_theta_b)
+        return 1.0f;
+    return cos_theta_a * cos_theta_b + sin_theta_a * sin_theta_b;
+}
+
+// sin(max(0, theta_a - theta_b))
+inline float light_tree_sin_sub_clamped(float sin_theta_a, float cos_theta_a, float sin_theta_b, float cos_theta_b)
+{
+    if (cos_theta_a > cos_theta_b)
+        return 0.0f;
+    return sin_theta_a * cos_theta_b - cos_theta_a * sin_theta_b;
+}
+
+// Upper bound of the light a node sends to P (pbrt LightBounds::Importance), light_tree.glsl get_light_tree_importance.
+// n is the receiver normal, light below its tangent plane is ignored; a zero n (transmissive, mirror) sees every side.
+inline float get_light_tree_importance(LIGHT_TREE_NODE const &node, glm::vec3 P, glm::vec3 n)
+{
+    if (node.phi <= 0.0f)
+        return 0.0f;
+
+    glm::vec3 minimum = glm::vec3(node.minimum.x, node.minimum.y, node.minimum.z);
+    glm::vec3 maximum = glm::vec3(node.maximum.x, node.maximum.y, node.maximum.z);
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    glm::vec3 half_extent = maximum - center;
+    float radius2 = glm::dot(half_extent, half_extent);
+    glm::vec3 to_center = center - P;
+    float distance2 = glm::dot(to_center, to_center);
+
+    // Bounds too close to bound any angle, the distance is clamped to the radius
+    if (distance2 <= radius2)
+        return node.phi / std::max(radius2, 1e-12f);
+
+    glm::vec3 wi = to_center / std::sqrt(distance2);
+    glm::vec3 axis = glm::vec3(node.axis.x, node.axis.y, node.axis.z);
+
+    // Angle subtended by the bounds
+    float sin2_theta_b = radius2 / distance2;
+    float sin_theta_b = std::sqrt(sin2_theta_b);
+    float cos_theta_b = std::sqrt(std::max(1.0f - sin2_theta_b, 0.0f));
+
+    // Smallest angle between the emission cone & the direction towards P
+    float cos_theta_w = glm::dot(axis, -wi);
+    float sin_theta_w = std::sqrt(std::max(1.0f - cos_theta_w * cos_theta_w, 0.0f));
+    float cos_theta_o = node.cos_theta_o;
+    float sin_theta_o = std::sqrt(std::max(1.0f - cos_theta_o * cos_theta_o, 0.0f));
+    float cos_theta_x = light_tree_cos_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    float sin_theta_x = light_tree_sin_sub_clamped(sin_theta_w, cos_theta_w, sin_theta_o, cos_theta_o);
+    float cos_theta_p = light_tree_cos_sub_clamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+    if (cos_theta_p <= node.cos_theta_e)
+        return 0.0f;
+
+    float importance = node.phi * cos_theta_p / distance2;
+
+    // Receiver cosine, bounded over the subtended angle
+    if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f)
+    {
+        float cos_theta_i = glm::dot(wi, n);
+        float sin_theta_i = std::sqrt(std::max(1.0f - cos_theta_i * cos_theta_i, 0.0f));
+        float cos_theta_pi = light_tree_cos_sub_clamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+        importance *= std::max(cos_theta_pi, 0.0f);
+    }
+
+    return std::max(importance, 0.0f);
+}
+
+// Receiver normal of the importance for a material: only lambertian surfaces reject light from below
+inline glm::vec3 get_light_tree_receiver_normal(MATERIAL const &mat, glm::vec3 n)
+{
+    return (mat.type & MATERIAL_TYPE_MASK) == MATERIAL_TYPE_LAMBERTIAN ? n : glm::vec3(0.0f);
+}
+
+//////////////////////////////// TREE //////////////////////////////////////
+
+struct LightTree
+{
+public:
+    static constexpr uint32_t BIN_COUNT = 12;
+    static constexpr uint32_t INVALID_NODE = MAX_LIGHT_TREE_NODES;
+    static constexpr uint32_t INVALID_LIGHT = static_cast<uint32_t>(-1);
+
+    void resize(uint32_t light_count)
+    {
+        lights.resize(light_count);
+        leaves.resize(light_count, INVALID_NODE);
+    }
+
+    // Bounds of a light (phi 0 for black lights), seen after the next build
+    void set_light(uint32_t light_index, LightBounds const &bounds)
+    {
+        if (light_index >= lights.size())
+            resize(light_index + 1);
+        lights[light_index] = bounds;
+    }
+
+    // Binned SAOH build (pbrt EvaluateCost), one leaf per light with power
+    void build()
+    {
+        nodes.clear();
+        leaves.assign(lights.size(), INVALID_NODE);
+        dead_leaves.clear();
+        dead_leaf_count = 0;
+
+        std::vector<uint32_t> order = {};
+        order.reserve(lights.size());
+        for (uint32_t i = 0; i < lights.size(); ++i)
+            if (!lights[i].is_empty())
+                order.push_back(i);
+
+        if (!order.empty())
+        {
+            nodes.reserve(order.size() * 2 - 1);
+            nodes.push_back(LIGHT_TREE_NODE{});
+            nodes[0].parent = INVALID_NODE;
+            subdivide(0, order.data(), static_cast<uint32_t>(order.size()));
+        }
+
+        leaf_count = static_cast<uint32_t>(order.size());
+        dirty_first = 0;
+        dirty_last = static_cast<uint32_t>(nodes.size());
+        leaves_dirty = true;
+
+#if LIGHT_TREE_INFO == 1
+        std::cout << "LightTree: " << leaf_count << " lights, " << nodes.size() << " nodes" << std::endl;
+#endif // LIGHT_TREE_INFO
+    }
+
+    // ACCEL_STRUCT_MNGR delete_light_device_buffer: the light is removed & light_to_exchange moves to its index
+    void remove_light(uint32_t light_to_delete, uint32_t light_to_exchange)
+    {
+        if (light_to_delete >= lights.size())
+            return;
+
+        uint32_t dead_leaf = leaves[light_to_delete];
+        dead_leaves.push_back(dead_leaf);
+        if (dead_leaf != INVALID_NODE)
+        {
+            nodes[dead_leaf].child_or_light = INVALID_LIGHT;
+            set_node_bounds(dead_leaf, LightBounds{});
+            refit(dead_leaf);
+            ++dead_leaf_count;
+        }
+        lights[light_to_delete] = LightBounds{};
+        leaves[light_to_delete] = INVALID_NODE;
+
+        if (light_to_exchange != INVALID_LIGHT && light_to_exchange != light_to_delete && light_to_exchange < lights.size())
+            move_light(light_to_exchange, light_to_delete);
+    }
+
+    // ACCEL_STRUCT_MNGR restore_light_device_buffer: undoes the last remove_light, bounds are the ones of the light restored
+    void restore_light(uint32_t light_to_recover, uint32_t light_exchanged, LightBounds const &bounds)
+    {
+        if (dead_leaves.empty())
+        {
+#if WARN == 1
+            std::cerr << "LightTree: restore without a removed light" << std::endl;
+#endif // WARN
+            return;
+        }
+        if (light_to_recover >= lights.size())
+            resize(light_to_recover + 1);
+
+        if (light_exchanged != INVALID_LIGHT && light_exchanged != light_to_recover)
+        {
+            if (light_exchanged >= lights.size())
+                resize(light_exchanged + 1);
+            move_light(light_to_recover, light_exchanged);
+        }
+
+        uint32_t leaf = dead_leaves.back();
+        dead_leaves.pop_back();
+        lights[light_to_recover] = bounds;
+        leaves[light_to_recover] = leaf;
+        if (leaf != INVALID_NODE)
+        {
+            nodes[leaf].child_or_light = light_to_recover;
+            set_node_bounds(leaf, bounds);
+            refit(leaf);
+            --dead_leaf_count;
+        }
+    }
+
+    // Too many dead leaves waste traversal steps
+    bool needs_rebuild() const { return dead_leaf_count * 4 > leaf_count; }
+
+    // Picks a light for a receiver at P: u in [0, 1) is reused at every level
+    bool sample(glm::vec3 P, glm::vec3 n, float u, uint32_t &light_index, float &pmf) const
+    {
+        if (nodes.empty())
+            return false;
+
+        uint32_t node_index = 0;
+        pmf = 1.0f;
+        while (!nodes[node_index].is_leaf)
+        {
+            uint32_t child = nodes[node_index].child_or_light;
+            float importance0 = get_light_tree_importance(nodes[child], P, n);
+            float importance1 = get_light_tree_importance(nodes[child + 1], P, n);
+            float total = importance0 + importance1;
+            if (total <= 0.0f)
+                return false;
+
+            float p0 = importance0 / total;
+            if (u < p0)
+            {
+                u = std::min(u / p0, ONE_MINUS_EPSILON);
+                pmf *= p0;
+                node_index = child;
+            }
+            else
+            {
+                u = std::min((u - p0) / (1.0f - p0), ONE_MINUS_EPSILON);
+                pmf *= importance1 / total;
+                node_index = child + 1;
+            }
+        }
+
+        light_index = nodes[node_index].child_or_light;
+        return light_index != INVALID_LIGHT && pmf > 0.0f;
+    }
+
+    // Probability of sample picking light_index, leaf to root
+    float get_pmf(glm::vec3 P, glm::vec3 n, uint32_t light_index) const
+    {
+        if (light_index >= leaves.size() || leaves[light_index] == INVALID_NODE)
+            return 0.0f;
+
+        uint32_t node_index = leaves[light_index];
+        float pmf = 1.0f;
+        while (nodes[node_index].parent != INVALID_NODE)
+        {
+            uint32_t parent = nodes[node_index].parent;
+            uint32_t child = nodes[parent].child_or_light;
+            float importance0 = get_light_tree_importance(nodes[child], P, n);
+            float importance1 = get_light_tree_importance(nodes[child + 1], P, n);
+            float total = importance0 + importance1;
+            if (total <= 0.0f)
+                return 0.0f;
+            pmf *= (node_index == child ? importance0 : importance1) / total;
+            node_index = parent;
+        }
+        return pmf;
+    }
+
+    // Copies the nodes & leaves changed since the last upload to host mapped buffers, false if nothing changed
+    bool upload(LIGHT_TREE_NODE *gpu_nodes, daxa_u32 *gpu_leaves)
+    {
+        bool uploaded = false;
+        if (dirty_first < dirty_last)
+        {
+            std::copy(nodes.begin() + dirty_first, nodes.begin() + dirty_last, gpu_nodes + dirty_first);
+            uploaded = true;
+        }
+        if (leaves_dirty)
+        {
+            std::copy(leaves.begin(), leaves.end(), gpu_leaves);
+            uploaded = true;
+        }
+        dirty_first = std::numeric_limits<uint32_t>::max();
+        dirty_last = 0;
+        leaves_dirty = false;
+        return uploaded;
+    }
+
+    auto get_light(uint32_t light_index) const -> LightBounds const & { return lights[light_index]; }
+    auto get_light_count() const -> uint32_t { return static_cast<uint32_t>(lights.size()); }
+    auto get_node_count() const -> uint32_t { return static_cast<uint32_t>(nodes.size()); }
+    auto get_nodes() const -> std::vector<LIGHT_TREE_NODE> const & { return nodes; }
+    auto get_depth() const -> uint32_t
+    {
+        uint32_t depth = 0;
+        for (uint32_t leaf : leaves)
+        {
+            uint32_t leaf_depth = 0;
+            for (uint32_t node_index = leaf; node_index != INVALID_NODE; node_index = nodes[node_index].parent)
+                ++leaf_depth;
+            depth = std::max(depth, leaf_depth);
+        }
+        return depth;
+    }
+    auto get_memory_size() const -> size_t { return nodes.size() * sizeof(LIGHT_TREE_NODE) + leaves.size() * sizeof(uint32_t); }
+
+private:
+    static auto get_node_light_bounds(LIGHT_TREE_NODE const &node) -> LightBounds
+    {
+        return LightBounds{
+            .minimum = glm::vec3(node.minimum.x, node.minimum.y, node.minimum.z),
+            .maximum = glm::vec3(node.maximum.x, node.maximum.y, node.maximum.z),
+            .phi = node.phi,
+            .axis = glm::vec3(node.axis.x, node.axis.y, node.axis.z),
+            .cos_theta_o = node.cos_theta_o,
+            .cos_theta_e = node.cos_theta_e,
+        };
+    }
+
+    void set_node_bounds(uint32_t node_index, LightBounds const &bounds)
+    {
+        LIGHT_TREE_NODE &node = nodes[node_index];
+        node.minimum = {bounds.minimum.x, bounds.minimum.y, bounds.minimum.z};
+        node.maximum = {bounds.maximum.x, bounds.maximum.y, bounds.maximum.z};
+        node.phi = bounds.phi;
+        node.axis = {bounds.axis.x, bounds.axis.y, bounds.axis.z};
+        node.cos_theta_o = bounds.cos_theta_o;
+        node.cos_theta_e = bounds.cos_theta_e;
+        mark_dirty(node_index);
+    }
+
+    void mark_dirty(uint32_t node_index)
+    {
+        dirty_first = std::min(dirty_first, node_index);
+        dirty_last = std::max(dirty_last, node_index + 1);
+    }
+
+    // Light moved from one index to another, its leaf follows it
+    void move_light(uint32_t from, uint32_t to)
+    {
+        lights[to] = lights[from];
+        leaves[to] = leaves[from];
+        if (leaves[to] != INVALID_NODE)
+        {
+            nodes[leaves[to]].child_or_light = to;
+            mark_dirty(leaves[to]);
+        }
+        lights[from] = LightBounds{};
+        leaves[from] = INVALID_NODE;
+        leaves_dirty = true;
+    }
+
+    // Bounds of the ancestors of a changed node
+    void refit(uint32_t node_index)
+    {
+        leaves_dirty = true;
+        for (uint32_t parent = nodes[node_index].parent; parent != INVALID_NODE; parent = nodes[parent].parent)
+        {
+            uint32_t child = nodes[parent].child_or_light;
+            set_node_bounds(parent, get_light_bounds_union(get_node_light_bounds(nodes[child]), get_node_light_bounds(nodes[child + 1])));
+        }
+    }
+
+    // Surface area orientation heuristic of a side of a split (pbrt BVHLightSampler::EvaluateCost)
+    static float evaluate_cost(LightBounds const &bounds, glm::vec3 parent_extent, int axis)
+    {
+        if (bounds.is_empty())
+            return 0.0f;
+
+        float theta_o = light_tree_safe_acos(bounds.cos_theta_o);
+        float theta_e = light_tree_safe_acos(bounds.cos_theta_e);
+        float theta_w = std::min(theta_o + theta_e, DAXA_PI);
+        float sin_theta_o = std::sin(theta_o);
+        float M_omega = DAXA_2PI * (1.0f - bounds.cos_theta_o) +
+                        DAXA_PI / 2.0f * (2.0f * theta_w * sin_theta_o - std::cos(theta_o - 2.0f * theta_w) -
+                                          2.0f * theta_o * sin_theta_o + bounds.cos_theta_o);
+
+        // Splits across the thin side of a long node are penalised
+        float max_extent = std::max(parent_extent.x, std::max(parent_extent.y, parent_extent.z));
+        float Kr = parent_extent[axis] > 0.0f ? max_extent / parent_extent[axis] : 1.0f;
+
+        glm::vec3 d = bounds.maximum - bounds.minimum;
+        float area = 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        return bounds.phi * M_omega * Kr * area;
+    }
+
+    void subdivide(uint32_t node_index, uint32_t *first, uint32_t count)
+    {
+        if (count == 1)
+        {
+            nodes[node_index].is_leaf = 1;
+            nodes[node_index].child_or_light = first[0];
+            leaves[first[0]] = node_index;
+            set_node_bounds(node_index, lights[first[0]]);
+            return;
+        }
+
+        LightBounds bounds = {};
+        glm::vec3 centroid_min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 centroid_max = glm::vec3(-std::numeric_limits<float>::max());
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            LightBounds const &light = lights[first[i]];
+            bounds = get_light_bounds_union(bounds, light);
+            glm::vec3 centroid = (light.minimum + light.maximum) * 0.5f;
+            centroid_min = glm::min(centroid_min, centroid);
+            centroid_max = glm::max(centroid_max, centroid);
+        }
+
+        glm::vec3 parent_extent = bounds.maximum - bounds.minimum;
+        glm::vec3 centroid_extent = centroid_max - centroid_min;
+
+        auto get_bin = [&](uint32_t light_index, int axis) -> uint32_t
+        {
+            LightBounds const &light = lights[light_index];
+            float centroid = (light.minimum[axis] + light.maximum[axis]) * 0.5f;
+            uint32_t bin = static_cast<uint32_t>((centroid - centroid_min[axis]) / centroid_extent[axis] * BIN_COUNT);
+            return std::min(bin, BIN_COUNT - 1);
+        };
+
+        float best_cost = std::numeric_limits<float>::max();
+        int best_axis = -1;
+        uint32_t best_split = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (centroid_extent[axis] <= 0.0f)
+                continue;
+
+            LightBounds bins[BIN_COUNT] = {};
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint32_t bin = get_bin(first[i], axis);
+                bins[bin] = get_light_bounds_union(bins[bin], lights[first[i]]);
+            }
+
+            LightBounds right_bounds[BIN_COUNT] = {};
+            for (int bin = BIN_COUNT - 1; bin > 0; --bin)
+                right_bounds[bin] = get_light_bounds_union(bins[bin], bin + 1 < static_cast<int>(BIN_COUNT) ? right_bounds[bin + 1] : LightBounds{});
+
+            LightBounds left = {};
+            for (uint32_t split = 1; split < BIN_COUNT; ++split)
+            {
+                left = get_light_bounds_union(left, bins[split - 1]);
+                float cost = evaluate_cost(left, parent_extent, axis) + evaluate_cost(right_bounds[split], parent_extent, axis);
+                if (cost > 0.0f && cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = split;
+                }
+            }
+        }
+
+        uint32_t middle = count / 2;
+        if (best_axis >= 0)
+        {
+            uint32_t *split = std::partition(first, first + count, [&](uint32_t light_index)
+                                             { return get_bin(light_index, best_axis) < best_split; });
+            middle = static_cast<uint32_t>(split - first);
+        }
+        // Every centroid in the same place or a degenerate split
+        if (middle == 0 || middle == count)
+            middle = count / 2;
+
+        uint32_t child = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(LIGHT_TREE_NODE{});
+        nodes.push_back(LIGHT_TREE_NODE{});
+        nodes[child].parent = node_index;
+        nodes[child + 1].parent = node_index;
+        nodes[node_index].is_leaf = 0;
+        nodes[node_index].child_or_light = child;
+        set_node_bounds(node_index, bounds);
+
+        subdivide(child, first, middle);
+        subdivide(child + 1, first + middle, count - middle);
+    }
+
+    std::vector<LightBounds> lights = {};
+    std::vector<LIGHT_TREE_NODE> nodes = {};
+    std::vector<uint32_t> leaves = {};      // leaf node of every light, INVALID_NODE for lights outside of the tree
+    std::vector<uint32_t> dead_leaves = {}; // leaves of the removed lights, restore_light pops them
+    uint32_t leaf_count = 0;
+    uint32_t dead_leaf_count = 0;
+    uint32_t dirty_first = std::numeric_limits<uint32_t>::max();
+    uint32_t dirty_last = 0;
+    bool leaves_dirty = false;
+};
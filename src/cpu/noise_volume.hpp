@@ -0,0 +1,416 @@
+#pragma once
+#include "defines.h"
+#include "sampler.hpp"
+#include "tile_pool.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NOISE_VOLUME_AVX2_ON 1
+#else
+#define NOISE_VOLUME_AVX2_ON 0
+#endif // __AVX2__
+
+// Baked noise volumes: tileable improved Perlin gradient noise (Perlin 2002) summed over octaves into a cube of voxels
+// that covers one tile, so get_baked_perlin_turbulence (perlin.glsl) is one fetch of a repeating 3D texture instead of
+// the octave loop of get_perlin_turbulence.
+// Octave i has a lattice of period << (i * log2 lacunarity) cells per tile, lattice coordinates wrap at that period
+// (powers of two, capped by the 256 entries of the permutation) so every octave & their sum tile. The 8 wide kernel
+// evaluates 8 points with the operations of the scalar one in the same order, same bits (build with -ffp-contract=off);
+// without AVX2 its lanes are plain loops.
+// Volumes are cached as raw floats of this machine's endianness, the file name is a hash of the settings & the header
+// repeats them.
+
+//////////////////////////////// NOISE //////////////////////////////////////
+
+struct NoiseVolumeSettings
+{
+    uint32_t seed = 0;
+    uint32_t resolution = NOISE_VOLUME_RESOLUTION; // voxels per axis
+    uint32_t period = NOISE_VOLUME_PERIOD;         // lattice cells of the first octave per tile, power of two
+    uint32_t octaves = NOISE_VOLUME_OCTAVES;
+    uint32_t lacunarity = 2; // power of two so every octave tiles
+    float gain = NOISE_VOLUME_GAIN;
+    // abs of the sum like get_perlin_turbulence, false keeps the signed sum (fBm)
+    bool turbulence = true;
+};
+
+inline bool operator==(NoiseVolumeSettings const &a, NoiseVolumeSettings const &b)
+{
+    return a.seed == b.seed && a.resolution == b.resolution && a.period == b.period && a.octaves == b.octaves &&
+           a.lacunarity == b.lacunarity && std::bit_cast<uint32_t>(a.gain) == std::bit_cast<uint32_t>(b.gain) && a.turbulence == b.turbulence;
+}
+
+inline bool is_power_of_two(uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+inline bool is_valid_noise_volume_settings(NoiseVolumeSettings const &settings)
+{
+    return settings.resolution > 0 && settings.octaves > 0 && is_power_of_two(settings.period) && is_power_of_two(settings.lacunarity);
+}
+
+// Shuffled 0..255 twice, so hashes can add a coordinate to an entry without wrapping
+struct NoisePermutation
+{
+    std::array<int32_t, 512> values = {};
+
+    explicit NoisePermutation(uint32_t seed)
+    {
+        for (int32_t i = 0; i < 256; ++i)
+            values[i] = i;
+        for (uint32_t i = 255; i > 0; --i)
+            std::swap(values[i], values[host_sampler_pcg(seed ^ host_sampler_pcg(i)) % (i + 1)]);
+        for (uint32_t i = 0; i < 256; ++i)
+            values[256 + i] = values[i];
+    }
+
+    int32_t hash(int32_t x, int32_t y, int32_t z) const { return values[values[values[x] + y] + z]; }
+};
+
+inline float host_noise_fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+inline float host_noise_lerp(float t, float a, float b)
+{
+    return a + t * (b - a);
+}
+
+// Dot product with one of the 12 cube edge directions (4 repeated), picked by the low hash bits
+inline float host_noise_grad(int32_t hash, float x, float y, float z)
+{
+    int32_t h = hash & 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+}
+
+// Gradient noise with a lattice wrapping every period cells (power of two), 0 on lattice points
+inline float host_noise_gradient(glm::vec3 p, uint32_t period, NoisePermutation const &permutation)
+{
+    int32_t wrap = static_cast<int32_t>(std::min(period, 256u)) - 1;
+    float fx = std::floor(p.x), fy = std::floor(p.y), fz = std::floor(p.z);
+    int32_t x0 = static_cast<int32_t>(fx) & wrap, y0 = static_cast<int32_t>(fy) & wrap, z0 = static_cast<int32_t>(fz) & wrap;
+    int32_t x1 = (x0 + 1) & wrap, y1 = (y0 + 1) & wrap, z1 = (z0 + 1) & wrap;
+    float x = p.x - fx, y = p.y - fy, z = p.z - fz;
+    float u = host_noise_fade(x), v = host_noise_fade(y), w = host_noise_fade(z);
+
+    float n00 = host_noise_lerp(u, host_noise_grad(permutation.hash(x0, y0, z0), x, y, z), host_noise_grad(permutation.hash(x1, y0, z0), x - 1.0f, y, z));
+    float n10 = host_noise_lerp(u, host_noise_grad(permutation.hash(x0, y1, z0), x, y - 1.0f, z), host_noise_grad(permutation.hash(x1, y1, z0), x - 1.0f, y - 1.0f, z));
+    float n01 = host_noise_lerp(u, host_noise_grad(permutation.hash(x0, y0, z1), x, y, z - 1.0f), host_noise_grad(permutation.hash(x1, y0, z1), x - 1.0f, y, z - 1.0f));
+    float n11 = host_noise_lerp(u, host_noise_grad(permutation.hash(x0, y1, z1), x, y - 1.0f, z - 1.0f), host_noise_grad(permutation.hash(x1, y1, z1), x - 1.0f, y - 1.0f, z - 1.0f));
+    return host_noise_lerp(w, host_noise_lerp(v, n00, n10), host_noise_lerp(v, n01, n11));
+}
+
+// Octave loop of get_perlin_turbulence on tiling lattices, p in lattice cells of the first octave
+inline float host_noise_turbulence(glm::vec3 p, NoiseVolumeSettings const &settings, NoisePermutation const &permutation)
+{
+    float sum = 0.0f;
+    float scale = 1.0f;
+    float amplitude = 1.0f;
+    uint32_t period = settings.period;
+    for (uint32_t i = 0; i < settings.octaves; ++i)
+    {
+        sum += amplitude * host_noise_gradient(p * scale, period, permutation);
+        scale *= static_cast<float>(settings.lacunarity);
+        amplitude *= settings.gain;
+        period *= settings.lacunarity;
+    }
+    return settings.turbulence ? std::abs(sum) : sum;
+}
+
+//////////////////////////////// 8 WIDE //////////////////////////////////////
+
+#define NOISE_LANE_COUNT 8
+
+#if NOISE_VOLUME_AVX2_ON == 1
+
+inline __m256 noise_fade_x8(__m256 t)
+{
+    __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+inline __m256 noise_lerp_x8(__m256 t, __m256 a, __m256 b)
+{
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+// host_noise_grad per lane, the negations are sign flips
+inline __m256 noise_grad_x8(__m256i hash, __m256 x, __m256 y, __m256 z)
+{
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    __m256 below_8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 below_4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    __m256 x_for_v = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+    __m256 u = _mm256_blendv_ps(y, x, below_8);
+    __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, x_for_v), y, below_4);
+    __m256 u_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    __m256 v_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, u_sign), _mm256_xor_ps(v, v_sign));
+}
+
+inline __m256i noise_hash_x8(NoisePermutation const &permutation, __m256i x, __m256i y, __m256i z)
+{
+    int const *values = permutation.values.data();
+    __m256i a = _mm256_i32gather_epi32(values, x, 4);
+    __m256i b = _mm256_i32gather_epi32(values, _mm256_add_epi32(a, y), 4);
+    return _mm256_i32gather_epi32(values, _mm256_add_epi32(b, z), 4);
+}
+
+inline __m256 noise_gradient_x8(__m256 px, __m256 py, __m256 pz, uint32_t period, NoisePermutation const &permutation)
+{
+    __m256i wrap = _mm256_set1_epi32(static_cast<int32_t>(std::min(period, 256u)) - 1);
+    __m256i one_i = _mm256_set1_epi32(1);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 fx = _mm256_floor_ps(px), fy = _mm256_floor_ps(py), fz = _mm256_floor_ps(pz);
+    __m256i x0 = _mm256_and_si256(_mm256_cvttps_epi32(fx), wrap);
+    __m256i y0 = _mm256_and_si256(_mm256_cvttps_epi32(fy), wrap);
+    __m256i z0 = _mm256_and_si256(_mm256_cvttps_epi32(fz), wrap);
+    __m256i x1 = _mm256_and_si256(_mm256_add_epi32(x0, one_i), wrap);
+    __m256i y1 = _mm256_and_si256(_mm256_add_epi32(y0, one_i), wrap);
+    __m256i z1 = _mm256_and_si256(_mm256_add_epi32(z0, one_i), wrap);
+    __m256 x = _mm256_sub_ps(px, fx), y = _mm256_sub_ps(py, fy), z = _mm256_sub_ps(pz, fz);
+    __m256 xm = _mm256_sub_ps(x, one), ym = _mm256_sub_ps(y, one), zm = _mm256_sub_ps(z, one);
+    __m256 u = noise_fade_x8(x), v = noise_fade_x8(y), w = noise_fade_x8(z);
+
+    __m256 n00 = noise_lerp_x8(u, noise_grad_x8(noise_hash_x8(permutation, x0, y0, z0), x, y, z), noise_grad_x8(noise_hash_x8(permutation, x1, y0, z0), xm, y, z));
+    __m256 n10 = noise_lerp_x8(u, noise_grad_x8(noise_hash_x8(permutation, x0, y1, z0), x, ym, z), noise_grad_x8(noise_hash_x8(permutation, x1, y1, z0), xm, ym, z));
+    __m256 n01 = noise_lerp_x8(u, noise_grad_x8(noise_hash_x8(permutation, x0, y0, z1), x, y, zm), noise_grad_x8(noise_hash_x8(permutation, x1, y0, z1), xm, y, zm));
+    __m256 n11 = noise_lerp_x8(u, noise_grad_x8(noise_hash_x8(permutation, x0, y1, z1), x, ym, zm), noise_grad_x8(noise_hash_x8(permutation, x1, y1, z1), xm, ym, zm));
+    return noise_lerp_x8(w, noise_lerp_x8(v, n00, n10), noise_lerp_x8(v, n01, n11));
+}
+
+#endif // NOISE_VOLUME_AVX2_ON
+
+// host_noise_turbulence of 8 points
+inline void host_noise_turbulence_x8(float const (&px)[NOISE_LANE_COUNT], float const (&py)[NOISE_LANE_COUNT], float const (&pz)[NOISE_LANE_COUNT],
+                                     NoiseVolumeSettings const &settings, NoisePermutation const &permutation, float (&out)[NOISE_LANE_COUNT])
+{
+#if NOISE_VOLUME_AVX2_ON == 1
+    __m256 x = _mm256_loadu_ps(px), y = _mm256_loadu_ps(py), z = _mm256_loadu_ps(pz);
+    __m256 sum = _mm256_setzero_ps();
+    float scale = 1.0f;
+    float amplitude = 1.0f;
+    uint32_t period = settings.period;
+    for (uint32_t i = 0; i < settings.octaves; ++i)
+    {
+        __m256 s = _mm256_set1_ps(scale);
+        __m256 noise = noise_gradient_x8(_mm256_mul_ps(x, s), _mm256_mul_ps(y, s), _mm256_mul_ps(z, s), period, permutation);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(amplitude), noise));
+        scale *= static_cast<float>(settings.lacunarity);
+        amplitude *= settings.gain;
+        period *= settings.lacunarity;
+    }
+    if (settings.turbulence)
+        sum = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), sum);
+    _mm256_storeu_ps(out, sum);
+#else
+    for (uint32_t lane = 0; lane < NOISE_LANE_COUNT; ++lane)
+        out[lane] = host_noise_turbulence(glm::vec3(px[lane], py[lane], pz[lane]), settings, permutation);
+#endif // NOISE_VOLUME_AVX2_ON
+}
+
+//////////////////////////////// VOLUME //////////////////////////////////////
+
+// One tile of noise, voxel (x, y, z) holds the noise at its center, x fastest then y then z
+struct NoiseVolume
+{
+    NoiseVolumeSettings settings = {};
+    std::vector<float> voxels = {};
+
+    auto get_voxel(uint32_t x, uint32_t y, uint32_t z) const -> float
+    {
+        size_t resolution = settings.resolution;
+        return voxels[(static_cast<size_t>(z) * resolution + y) * resolution + x];
+    }
+
+    // Trilinear fetch of a repeating texture like the GPU, p in lattice cells of the first octave
+    auto sample(glm::vec3 p) const -> float
+    {
+        float resolution = static_cast<float>(settings.resolution);
+        glm::vec3 texel = p * (resolution / static_cast<float>(settings.period)) - 0.5f;
+        glm::vec3 base = glm::floor(texel);
+        glm::vec3 t = texel - base;
+        auto wrap = [&](float coordinate)
+        {
+            int32_t r = static_cast<int32_t>(settings.resolution);
+            return static_cast<uint32_t>(((static_cast<int64_t>(coordinate) % r) + r) % r);
+        };
+        uint32_t x0 = wrap(base.x), y0 = wrap(base.y), z0 = wrap(base.z);
+        uint32_t x1 = wrap(base.x + 1.0f), y1 = wrap(base.y + 1.0f), z1 = wrap(base.z + 1.0f);
+        float c00 = host_noise_lerp(t.x, get_voxel(x0, y0, z0), get_voxel(x1, y0, z0));
+        float c10 = host_noise_lerp(t.x, get_voxel(x0, y1, z0), get_voxel(x1, y1, z0));
+        float c01 = host_noise_lerp(t.x, get_voxel(x0, y0, z1), get_voxel(x1, y0, z1));
+        float c11 = host_noise_lerp(t.x, get_voxel(x0, y1, z1), get_voxel(x1, y1, z1));
+        return host_noise_lerp(t.z, host_noise_lerp(t.y, c00, c10), host_noise_lerp(t.y, c01, c11));
+    }
+};
+
+// Lattice position of the center of voxel index along an axis
+inline float get_noise_voxel_center(uint32_t index, NoiseVolumeSettings const &settings)
+{
+    return (static_cast<float>(index) + 0.5f) * (static_cast<float>(settings.period) / static_cast<float>(settings.resolution));
+}
+
+// Rows of voxels are the jobs of the pool, 8 voxels at a time (wide) or one by one
+inline bool bake_noise_volume(NoiseVolumeSettings const &settings, NoiseVolume &volume, TilePool &pool, bool wide = true)
+{
+    if (!is_valid_noise_volume_settings(settings))
+    {
+#if WARN
+        std::cerr << "bake_noise_volume: period & lacunarity must be powers of two, resolution & octaves not 0" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    NoisePermutation permutation(settings.seed);
+    uint32_t resolution = settings.resolution;
+    volume.settings = settings;
+    volume.voxels.assign(static_cast<size_t>(resolution) * resolution * resolution, 0.0f);
+
+    pool.run(resolution * resolution, [&](uint32_t row, uint32_t)
+             {
+        uint32_t y = row % resolution, z = row / resolution;
+        float *voxels = volume.voxels.data() + static_cast<size_t>(row) * resolution;
+        float py = get_noise_voxel_center(y, settings), pz = get_noise_voxel_center(z, settings);
+        uint32_t x = 0;
+        if (wide)
+        {
+            float lanes_x[NOISE_LANE_COUNT], lanes_y[NOISE_LANE_COUNT], lanes_z[NOISE_LANE_COUNT], out[NOISE_LANE_COUNT];
+            std::fill(std::begin(lanes_y), std::end(lanes_y), py);
+            std::fill(std::begin(lanes_z), std::end(lanes_z), pz);
+            for (; x + NOISE_LANE_COUNT <= resolution; x += NOISE_LANE_COUNT)
+            {
+                for (uint32_t lane = 0; lane < NOISE_LANE_COUNT; ++lane)
+                    lanes_x[lane] = get_noise_voxel_center(x + lane, settings);
+                host_noise_turbulence_x8(lanes_x, lanes_y, lanes_z, settings, permutation, out);
+                std::memcpy(voxels + x, out, sizeof(out));
+            }
+        }
+        for (; x < resolution; ++x)
+            voxels[x] = host_noise_turbulence(glm::vec3(get_noise_voxel_center(x, settings), py, pz), settings, permutation); });
+    return true;
+}
+
+//////////////////////////////// CACHE //////////////////////////////////////
+
+static constexpr uint32_t NOISE_VOLUME_MAGIC = 0x564e5443; // "CTNV"
+static constexpr uint32_t NOISE_VOLUME_VERSION = 1;
+
+// FNV-1a of the settings
+inline uint64_t get_noise_volume_key(NoiseVolumeSettings const &settings)
+{
+    uint32_t const fields[] = {settings.seed, settings.resolution, settings.period, settings.octaves, settings.lacunarity,
+                               std::bit_cast<uint32_t>(settings.gain), settings.turbulence ? 1u : 0u, NOISE_VOLUME_VERSION};
+    uint64_t key = 14695981039346656037ull;
+    for (uint32_t field : fields)
+        for (uint32_t byte = 0; byte < 4; ++byte)
+        {
+            key ^= (field >> (byte * 8)) & 0xFFu;
+            key *= 1099511628211ull;
+        }
+    return key;
+}
+
+inline std::filesystem::path get_noise_volume_path(std::filesystem::path const &cache_dir, NoiseVolumeSettings const &settings)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "noise_%016llx.bin", static_cast<unsigned long long>(get_noise_volume_key(settings)));
+    return cache_dir / name;
+}
+
+inline bool write_noise_volume(std::filesystem::path const &path, NoiseVolume const &volume)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+#if WARN
+        std::cerr << "write_noise_volume: could not open " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    NoiseVolumeSettings const &settings = volume.settings;
+    uint32_t const header[] = {NOISE_VOLUME_MAGIC, NOISE_VOLUME_VERSION, settings.seed, settings.resolution, settings.period,
+                               settings.octaves, settings.lacunarity, std::bit_cast<uint32_t>(settings.gain), settings.turbulence ? 1u : 0u};
+    file.write(reinterpret_cast<char const *>(header), sizeof(header));
+    file.write(reinterpret_cast<char const *>(volume.voxels.data()), volume.voxels.size() * sizeof(float));
+    return file.good();
+}
+
+// Fails on other settings (hash collisions, stale files) or truncated files
+inline bool read_noise_volume(std::filesystem::path const &path, NoiseVolumeSettings const &settings, NoiseVolume &volume)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint32_t header[9] = {};
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!file.good() || header[0] != NOISE_VOLUME_MAGIC || header[1] != NOISE_VOLUME_VERSION)
+        return false;
+
+    NoiseVolumeSettings stored = {
+        .seed = header[2],
+        .resolution = header[3],
+        .period = header[4],
+        .octaves = header[5],
+        .lacunarity = header[6],
+        .gain = std::bit_cast<float>(header[7]),
+        .turbulence = header[8] != 0,
+    };
+    if (!(stored == settings))
+    {
+#if WARN
+        std::cerr << "read_noise_volume: " << path.string() << " holds other settings" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    volume.settings = settings;
+    volume.voxels.resize(static_cast<size_t>(settings.resolution) * settings.resolution * settings.resolution);
+    file.read(reinterpret_cast<char *>(volume.voxels.data()), volume.voxels.size() * sizeof(float));
+    if (!file.good())
+    {
+#if WARN
+        std::cerr << "read_noise_volume: " << path.string() << " is truncated" << std::endl;
+#endif // WARN
+        volume.voxels.clear();
+        return false;
+    }
+    return true;
+}
+
+// Cached volume of the settings, baked & written to the cache when missing, from_cache tells which
+inline bool load_or_bake_noise_volume(std::filesystem::path const &cache_dir, NoiseVolumeSettings const &settings, NoiseVolume &volume,
+                                      TilePool &pool, bool *from_cache = nullptr)
+{
+    std::filesystem::path path = get_noise_volume_path(cache_dir, settings);
+    if (from_cache)
+        *from_cache = false;
+    if (std::filesystem::exists(path) && read_noise_volume(path, settings, volume))
+    {
+        if (from_cache)
+            *from_cache = true;
+        return true;
+    }
+
+    if (!bake_noise_volume(settings, volume, pool))
+        return false;
+
+    // A volume that can't be cached is still good
+    std::error_code error = {};
+    std::filesystem::create_directories(cache_dir, error);
+    if (error || !write_noise_volume(path, volume))
+    {
+#if WARN
+        std::cerr << "load_or_bake_noise_volume: could not cache " << path.string() << std::endl;
+#endif // WARN
+    }
+    return true;
+}
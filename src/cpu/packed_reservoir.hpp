@@ -0,0 +1,261 @@
+#pragma once
+#include "defines.h"
+#include "host_shading.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+// Host port of the packed storage of the per pixel reservoirs & direct illumination (packing.glsl, PACKED_RESERVOIRS_ON):
+// RESERVOIR_PACKED, PATH_RESERVOIR_PACKED & DIRECT_ILLUMINATION_INFO_PACKED of shared.inl. Names & formulas follow the
+// GLSL and give the same bits, but for the half floats: the host rounds to nearest even, packHalf2x16 leaves the
+// rounding to the device. Bounds of the round trip errors are given next to every encoding.
+
+// Mirror of glsl/packing.glsl
+#define HOST_RGB9E5_MANTISSA_BITS 9
+#define HOST_RGB9E5_EXPONENT_BIAS 15
+#define HOST_RGB9E5_MAX 65408.0f
+#define HOST_SNORM16_SCALE 32767.0f
+#define HOST_UNORM16_SCALE 65535.0f
+
+static_assert(MAX_MATERIALS <= 65536U, "DIRECT_ILLUMINATION_INFO_PACKED keeps 16 bits of mat_index");
+static_assert(GEOMETRY_LIGHT_MAX_ENUM <= 65536U, "RESERVOIR_PACKED keeps 16 bits of l_type");
+
+//////////////////////////////// ENCODINGS //////////////////////////////////////
+
+inline float host_packing_get_power_of_two(int32_t exponent)
+{
+    return std::bit_cast<float>(static_cast<uint32_t>(exponent + 127) << 23);
+}
+
+// Every component within half a step of the largest one: at most max_c / 511 (2^-25 below 2^-15)
+inline uint32_t host_pack_rgb9e5(glm::vec3 color)
+{
+    glm::vec3 c = {};
+    for (int i = 0; i < 3; ++i)
+        c[i] = color[i] > 0.0f ? std::min(color[i], HOST_RGB9E5_MAX) : 0.0f;
+    float max_c = std::max(c.x, std::max(c.y, c.z));
+
+    int32_t exponent = std::max(static_cast<int32_t>((std::bit_cast<uint32_t>(max_c) >> 23) & 0xFF) - 127,
+                                -HOST_RGB9E5_EXPONENT_BIAS - 1) +
+                       1 + HOST_RGB9E5_EXPONENT_BIAS;
+    float scale = host_packing_get_power_of_two(HOST_RGB9E5_EXPONENT_BIAS + HOST_RGB9E5_MANTISSA_BITS - exponent);
+    // The largest component rounded up to 2^9
+    if (std::floor(max_c * scale + 0.5f) == 512.0f)
+    {
+        exponent++;
+        scale *= 0.5f;
+    }
+
+    uint32_t bits = static_cast<uint32_t>(exponent) << 27;
+    for (int i = 0; i < 3; ++i)
+        bits |= static_cast<uint32_t>(std::floor(c[i] * scale + 0.5f)) << (9 * i);
+    return bits;
+}
+
+inline glm::vec3 host_unpack_rgb9e5(uint32_t bits)
+{
+    float scale = host_packing_get_power_of_two(static_cast<int32_t>(bits >> 27) - HOST_RGB9E5_EXPONENT_BIAS - HOST_RGB9E5_MANTISSA_BITS);
+    return glm::vec3(static_cast<float>(bits & 0x1FF), static_cast<float>((bits >> 9) & 0x1FF), static_cast<float>((bits >> 18) & 0x1FF)) *
+           scale;
+}
+
+// [-1, 1] to [0, 65534], error at most 1 / 65534
+inline uint32_t host_pack_snorm16(float value)
+{
+    return static_cast<uint32_t>(static_cast<int32_t>(std::floor(std::clamp(value, -1.0f, 1.0f) * HOST_SNORM16_SCALE + 0.5f)) +
+                                 static_cast<int32_t>(HOST_SNORM16_SCALE));
+}
+
+inline float host_unpack_snorm16(uint32_t bits)
+{
+    return static_cast<float>(static_cast<int32_t>(bits) - static_cast<int32_t>(HOST_SNORM16_SCALE)) / HOST_SNORM16_SCALE;
+}
+
+// From the sign bit: -0 folds like a negative value, so a direction decoded on the seam of the fold (x or y = 0 below
+// the equator) packs back to the same bits
+inline glm::vec2 host_packing_sign_not_zero(glm::vec2 v)
+{
+    return glm::vec2(std::signbit(v.x) ? -1.0f : 1.0f, std::signbit(v.y) ? -1.0f : 1.0f);
+}
+
+// Unit directions, a zero vector comes back as +z. Angular error below 1e-4 radians
+inline uint32_t host_pack_octahedral(glm::vec3 direction)
+{
+    float norm = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    glm::vec2 oct = norm > 0.0f ? glm::vec2(direction.x, direction.y) / norm : glm::vec2(0.0f);
+    if (direction.z < 0.0f)
+        oct = (1.0f - glm::abs(glm::vec2(oct.y, oct.x))) * host_packing_sign_not_zero(oct);
+    return host_pack_snorm16(oct.x) | (host_pack_snorm16(oct.y) << 16);
+}
+
+inline glm::vec3 host_unpack_octahedral(uint32_t bits)
+{
+    glm::vec2 oct = glm::vec2(host_unpack_snorm16(bits & 0xFFFF), host_unpack_snorm16(bits >> 16));
+    glm::vec3 direction = glm::vec3(oct.x, oct.y, 1.0f - std::abs(oct.x) - std::abs(oct.y));
+    if (direction.z < 0.0f)
+    {
+        glm::vec2 folded = (1.0f - glm::abs(glm::vec2(oct.y, oct.x))) * host_packing_sign_not_zero(oct);
+        direction.x = folded.x;
+        direction.y = folded.y;
+    }
+    return glm::normalize(direction);
+}
+
+// Low 16 bits, rounded to nearest even. Clamped to HLF_MAX like M in the shaders, relative error at most 2^-11 for
+// normal halves (above 2^-14)
+inline uint32_t host_pack_half(float value)
+{
+    value = std::min(value, HLF_MAX);
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude > 0x7F800000)
+        return sign | 0x7E00; // NaN
+    if (magnitude >= 0x477FF000)
+        return sign | 0x7C00; // rounds above 65504
+    if (magnitude < 0x38800000)
+    {
+        // Subnormal halves count steps of 2^-24, the scale is exact
+        return sign | static_cast<uint32_t>(std::nearbyint(std::abs(value) * 16777216.0f));
+    }
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t rest = magnitude & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return sign | half;
+}
+
+inline float host_unpack_half(uint32_t bits)
+{
+    uint32_t sign = (bits & 0x8000) << 16;
+    uint32_t exponent = (bits >> 10) & 0x1F;
+    uint32_t mantissa = bits & 0x3FF;
+    if (exponent == 0)
+    {
+        float value = static_cast<float>(mantissa) / 16777216.0f;
+        return sign ? -value : value;
+    }
+    if (exponent == 31)
+        return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// Error at most 1 / 131070
+inline uint32_t host_pack_unorm16(float value)
+{
+    return static_cast<uint32_t>(std::floor(std::clamp(value, 0.0f, 1.0f) * HOST_UNORM16_SCALE + 0.5f));
+}
+
+inline float host_unpack_unorm16(uint32_t bits)
+{
+    return static_cast<float>(bits & 0xFFFF) / HOST_UNORM16_SCALE;
+}
+
+//////////////////////////////// STRUCTS //////////////////////////////////////
+
+inline RESERVOIR_PACKED host_pack_reservoir(RESERVOIR const &reservoir)
+{
+    return RESERVOIR_PACKED{
+        .Y = reservoir.Y,
+        .seed = reservoir.seed,
+        .W_y = reservoir.W_y,
+        .W_sum = reservoir.W_sum,
+        .l_type_M = (reservoir.l_type & 0xFFFF) | (host_pack_half(reservoir.M) << 16),
+        .F = host_pack_rgb9e5(to_glm(reservoir.F)),
+    };
+}
+
+inline RESERVOIR host_unpack_reservoir(RESERVOIR_PACKED const &packed)
+{
+    return RESERVOIR{
+        .Y = packed.Y,
+        .l_type = packed.l_type_M & 0xFFFF,
+        .seed = packed.seed,
+        .W_y = packed.W_y,
+        .W_sum = packed.W_sum,
+        .M = host_unpack_half(packed.l_type_M >> 16),
+        .F = to_daxa(host_unpack_rgb9e5(packed.F)),
+    };
+}
+
+inline PATH_RESERVOIR_PACKED host_pack_path_reservoir(PATH_RESERVOIR const &reservoir)
+{
+    return PATH_RESERVOIR_PACKED{
+        .M = host_pack_half(reservoir.M),
+        .weight = reservoir.weight,
+        .path_flags = reservoir.path_flags,
+        .rc_random_seed = reservoir.rc_random_seed,
+        .F = host_pack_rgb9e5(to_glm(reservoir.F)),
+        .light_pdf = reservoir.light_pdf,
+        .cached_jacobian = reservoir.cached_jacobian,
+        .init_random_seed = reservoir.init_random_seed,
+        .rc_vertex_hit = reservoir.rc_vertex_hit,
+        .rc_vertex_wi = host_pack_octahedral(to_glm(reservoir.rc_vertex_wi[0])),
+        .rc_vertex_irradiance = host_pack_rgb9e5(to_glm(reservoir.rc_vertex_irradiance[0])),
+    };
+}
+
+inline PATH_RESERVOIR host_unpack_path_reservoir(PATH_RESERVOIR_PACKED const &packed)
+{
+    PATH_RESERVOIR reservoir = {};
+    reservoir.M = host_unpack_half(packed.M);
+    reservoir.weight = packed.weight;
+    reservoir.path_flags = packed.path_flags;
+    reservoir.rc_random_seed = packed.rc_random_seed;
+    reservoir.F = to_daxa(host_unpack_rgb9e5(packed.F));
+    reservoir.light_pdf = packed.light_pdf;
+    reservoir.cached_jacobian = packed.cached_jacobian;
+    reservoir.init_random_seed = packed.init_random_seed;
+    reservoir.rc_vertex_hit = packed.rc_vertex_hit;
+    reservoir.rc_vertex_wi[0] = to_daxa(host_unpack_octahedral(packed.rc_vertex_wi));
+    reservoir.rc_vertex_irradiance[0] = to_daxa(host_unpack_rgb9e5(packed.rc_vertex_irradiance));
+    return reservoir;
+}
+
+inline DIRECT_ILLUMINATION_INFO_PACKED host_pack_di_info(DIRECT_ILLUMINATION_INFO const &di_info)
+{
+    return DIRECT_ILLUMINATION_INFO_PACKED{
+        .position = di_info.position,
+        .distance = di_info.distance,
+        .normal = host_pack_octahedral(to_glm(di_info.normal)),
+        .ray_origin = di_info.ray_origin,
+        .seed = di_info.seed,
+        .instance_hit = di_info.instance_hit,
+        .mat_index_confidence = (di_info.mat_index & 0xFFFF) | (host_pack_unorm16(di_info.confidence) << 16),
+    };
+}
+
+inline DIRECT_ILLUMINATION_INFO host_unpack_di_info(DIRECT_ILLUMINATION_INFO_PACKED const &packed)
+{
+    return DIRECT_ILLUMINATION_INFO{
+        .position = packed.position,
+        .distance = packed.distance,
+        .normal = to_daxa(host_unpack_octahedral(packed.normal)),
+        .ray_origin = packed.ray_origin,
+        .seed = packed.seed,
+        .instance_hit = packed.instance_hit,
+        .mat_index = packed.mat_index_confidence & 0xFFFF,
+        .confidence = host_unpack_unorm16(packed.mat_index_confidence >> 16),
+    };
+}
+
+//////////////////////////////// TRAFFIC //////////////////////////////////////
+
+// Bytes of one pixel in the per pixel buffers of main.cpp holding these structs: 3 RESERVOIR (previous, intermediate,
+// current), 2 DIRECT_ILLUMINATION_INFO (previous, current) & 2 PATH_RESERVOIR (output, temporal)
+struct ReservoirPixelBytes
+{
+    size_t reservoir = 0;
+    size_t direct_illum = 0;
+    size_t path_reservoir = 0;
+
+    auto get_total() const -> size_t { return reservoir * 3 + direct_illum * 2 + path_reservoir * 2; }
+};
+
+inline ReservoirPixelBytes get_reservoir_pixel_bytes(bool packed)
+{
+    if (packed)
+        return {sizeof(RESERVOIR_PACKED), sizeof(DIRECT_ILLUMINATION_INFO_PACKED), sizeof(PATH_RESERVOIR_PACKED)};
+    return {sizeof(RESERVOIR), sizeof(DIRECT_ILLUMINATION_INFO), sizeof(PATH_RESERVOIR)};
+}
@@ -0,0 +1,435 @@
+#pragma once
+#include "defines.h"
+#include "host_accel.hpp"
+#include "host_shading.hpp"
+#include "light_alias_table.hpp"
+#include "light_tree.hpp"
+#include "sampler.hpp"
+#include "tile_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+
+// Camera matrices as uploaded to camera_view (inv_proj.y.y already flipped)
+struct HostCamera
+{
+    glm::mat4 inv_view = glm::mat4(1.0f);
+    glm::mat4 inv_proj = glm::mat4(1.0f);
+};
+
+struct ReferenceSettings
+{
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t samples_per_pixel = 1024;
+    uint32_t max_depth = MAX_DEPTH;
+    uint32_t tile_size = 16;
+    // The GPU traces through the pixel center, jitter for an antialiased reference
+    bool jitter = false;
+    // SAMPLER_TYPE_LCG keeps the tea(pixel, sample) streams, the others draw every dimension of a path from sampler.hpp
+    uint32_t sampler_type = SAMPLER_TYPE_LCG;
+    // Index of the first sample, a reference & the test images it's compared with must not share samples
+    uint32_t first_sample = 0;
+};
+
+// One unoccluded light sample of next event estimation
+struct HostLightSample
+{
+    glm::vec3 wi = {0.0f, 0.0f, 0.0f};
+    glm::vec3 Le = {0.0f, 0.0f, 0.0f};   // radiance reaching the shading point, point lights include the 1 / d^2 falloff
+    glm::vec3 brdf = {0.0f, 0.0f, 0.0f}; // with the cosine term
+    float solid_angle_pdf = 1.0f;        // 1 for delta lights
+    float mis_weight = 1.0f;             // power heuristic against BSDF sampling, 1 for delta lights
+    uint32_t type = GEOMETRY_LIGHT_POINT;
+    OBJECT_INFO object = {MAX_INSTANCES, MAX_PRIMITIVES};
+    glm::vec3 contribution = {0.0f, 0.0f, 0.0f}; // brdf * Le * mis_weight / solid_angle_pdf
+};
+
+// First hit of a path and its light split the way the shading pass hands it to the denoiser: emission of the hit (the
+// sky for misses), its next event estimation and the rest of the path
+struct HostPrimarySample
+{
+    bool is_hit = false;
+    glm::vec3 position = {0.0f, 0.0f, 0.0f};
+    glm::vec3 normal = {0.0f, 0.0f, 0.0f};
+    float distance = 0.0f;
+    uint32_t material_index = 0;
+    glm::vec3 emission = {0.0f, 0.0f, 0.0f};
+    glm::vec3 direct = {0.0f, 0.0f, 0.0f};
+    glm::vec3 indirect = {0.0f, 0.0f, 0.0f};
+};
+
+struct ReferenceStats
+{
+    double render_ms = 0.0;
+    uint64_t path_count = 0;
+    uint64_t ray_count = 0;
+    uint32_t steal_count = 0;
+};
+
+// Unidirectional path tracer with next event estimation, the CPU counterpart of the ray generation shader.
+// It shades with the same BRDFs, scatter functions and sky as the GPU so converged images can be used
+// as ground truth for the real time estimators (ReSTIR DI/PT, temporal reuse...).
+//  - Point lights are sampled every bounce (delta lights can't be hit).
+//  - One cube light is picked uniformly, a point is sampled uniformly on its surface and combined
+//    with BSDF sampling through the power heuristic (light.glsl direct_mis).
+//  - The sky is only gathered by BSDF sampling (miss shader radiance).
+// Seeds are tea(pixel, sample), or a HostSampler of (pixel, sample) with settings.sampler_type, so the image doesn't
+// depend on the thread count or the tile order.
+struct ReferenceTracer
+{
+public:
+    ReferenceTracer(HostAccel const &accel, ReferenceSettings const &settings) : accel(accel), scene(accel.get_scene()), settings(settings) {}
+
+    // Cube lights are picked with the tree instead of uniformly, nullptr goes back to uniform
+    void set_light_tree(LightTree const *tree) { light_tree = tree; }
+
+    // Cube lights are picked proportionally to their power, the light tree wins when both are set
+    void set_light_alias_table(LightAliasTable const *table) { light_alias_table = table; }
+
+    // Linear RGB, row major, top row first
+    auto render(HostCamera const &camera, TilePool &pool, std::vector<glm::vec3> &image) -> ReferenceStats
+    {
+        image.assign(static_cast<size_t>(settings.width) * settings.height, glm::vec3(0.0f));
+
+        uint32_t tiles_x = (settings.width + settings.tile_size - 1) / settings.tile_size;
+        uint32_t tiles_y = (settings.height + settings.tile_size - 1) / settings.tile_size;
+        uint32_t tile_count = tiles_x * tiles_y;
+        // Contiguous ranges of the pool are square blocks of tiles
+        std::vector<uint32_t> tile_order = get_morton_tile_order(tiles_x, tiles_y);
+
+        std::atomic<uint64_t> ray_count = 0;
+        std::atomic<uint32_t> finished_tiles = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        pool.run(tile_count, [&](uint32_t tile_index, uint32_t)
+                 {
+            uint32_t tile = tile_order[tile_index];
+            uint32_t x0 = (tile % tiles_x) * settings.tile_size;
+            uint32_t y0 = (tile / tiles_x) * settings.tile_size;
+            uint32_t x1 = std::min(x0 + settings.tile_size, settings.width);
+            uint32_t y1 = std::min(y0 + settings.tile_size, settings.height);
+            uint64_t tile_rays = 0;
+
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    glm::vec3 sum = glm::vec3(0.0f);
+                    for (uint32_t s = settings.first_sample; s < settings.first_sample + settings.samples_per_pixel; ++s)
+                        sum += trace_sample(x, y, s, camera, tile_rays);
+                    image[static_cast<size_t>(y) * settings.width + x] = sum / static_cast<float>(settings.samples_per_pixel);
+                }
+            }
+
+            ray_count += tile_rays;
+
+#if INFO == 1
+            uint32_t finished = ++finished_tiles;
+            if (finished % std::max(1U, tile_count / 10) == 0)
+                std::cout << "  " << (finished * 100 / tile_count) << "%" << std::endl;
+#endif // INFO
+        });
+
+        return ReferenceStats{
+            .render_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count(),
+            .path_count = static_cast<uint64_t>(settings.width) * settings.height * settings.samples_per_pixel,
+            .ray_count = ray_count,
+            .steal_count = pool.get_steal_count(),
+        };
+    }
+
+    // Sample s of a pixel with the seeds of settings.sampler_type, primary gets its first hit & split light
+    glm::vec3 trace_sample(uint32_t x, uint32_t y, uint32_t s, HostCamera const &camera, uint64_t &ray_count,
+                           HostPrimarySample *primary = nullptr) const
+    {
+        if (settings.sampler_type == SAMPLER_TYPE_LCG)
+        {
+            uint32_t seed = host_tea(y * settings.width + x, s);
+            HostRay ray = get_ray_from_current_pixel(x, y, camera, seed);
+            return trace_path(ray, seed, ray_count, primary);
+        }
+        HostSampler sampler = host_sampler_init(settings.sampler_type, x, y, s, settings.width);
+        HostRay ray = get_ray_from_current_pixel(x, y, camera, sampler);
+        return trace_path(ray, sampler, ray_count, primary);
+    }
+
+    auto get_settings() const -> ReferenceSettings const & { return settings; }
+
+    // rgen.glsl get_ray_from_current_pixel, Seed is a uint32_t LCG seed or a HostSampler
+    template <typename Seed>
+    HostRay get_ray_from_current_pixel(uint32_t x, uint32_t y, HostCamera const &camera, Seed &seed) const
+    {
+        glm::vec2 jitter = glm::vec2(0.0f);
+        if (settings.jitter)
+        {
+            host_sampler_start(seed, 0, SAMPLER_CAMERA_DIMENSIONS);
+            jitter.x = host_rnd_interval(seed, -0.5f + HLF_MIN, 0.5f - HLF_MIN);
+            jitter.y = host_rnd_interval(seed, -0.5f + HLF_MIN, 0.5f - HLF_MIN);
+        }
+
+        glm::vec2 pixel_center = glm::vec2(x, y) + jitter + glm::vec2(0.5f);
+        glm::vec2 inv_uv = pixel_center / glm::vec2(settings.width, settings.height);
+        glm::vec2 d = inv_uv * 2.0f - 1.0f;
+
+        glm::vec4 origin = camera.inv_view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec4 target = camera.inv_proj * glm::vec4(d.x, d.y, 1.0f, 1.0f);
+        glm::vec4 direction = camera.inv_view * glm::vec4(glm::normalize(glm::vec3(target)), 0.0f);
+
+        return HostRay{.origin = glm::vec3(origin), .direction = glm::vec3(direction)};
+    }
+
+    template <typename Seed>
+    glm::vec3 trace_path(HostRay ray, Seed &seed, uint64_t &ray_count, HostPrimarySample *primary = nullptr) const
+    {
+        glm::vec3 radiance = glm::vec3(0.0f);
+        glm::vec3 throughput = glm::vec3(1.0f);
+        glm::vec3 previous_position = ray.origin;
+        glm::vec3 previous_receiver_normal = glm::vec3(0.0f);
+        float previous_pdf = 0.0f;
+
+        for (uint32_t depth = 0; depth <= settings.max_depth; ++depth)
+        {
+            HostHit hit = {};
+            ++ray_count;
+            if (!accel.intersect(ray, 0.0f, HOST_MAX_DISTANCE, hit))
+            {
+                radiance += throughput * host_calculate_sky_color(scene.time, scene.is_afternoon, ray.direction);
+                break;
+            }
+
+            PRIMITIVE const &primitive = scene.primitives[hit.primitive_index];
+            MATERIAL const &mat = scene.materials[primitive.material_index];
+            if (primary && depth == 0)
+            {
+                primary->is_hit = true;
+                primary->position = hit.position;
+                primary->normal = hit.normal;
+                primary->distance = glm::length(hit.position - ray.origin);
+                primary->material_index = primitive.material_index;
+            }
+
+            // Emission, weighted against the light sampling of the previous bounce
+            glm::vec3 emission = to_glm(mat.emission);
+            if (emission.x > 0.0f || emission.y > 0.0f || emission.z > 0.0f)
+            {
+                float mis_weight = 1.0f;
+                if (depth > 0 && primitive.light_index != static_cast<uint32_t>(-1))
+                {
+                    float G = host_geom_fact_sa(previous_position, hit.position, hit.normal);
+                    float light_pdf = get_cube_light_pdf(primitive.light_index, hit.normal, previous_position, previous_receiver_normal);
+                    mis_weight = host_eval_mis(previous_pdf * G, light_pdf);
+                }
+                radiance += throughput * mis_weight * emission;
+            }
+            if (primary && depth == 0)
+                primary->emission = radiance;
+
+            if (depth == settings.max_depth)
+                break;
+
+            glm::vec3 n = hit.normal;
+            glm::vec3 wo = -glm::normalize(ray.direction);
+            glm::vec3 P = compute_ray_origin(hit.position, n);
+
+            host_sampler_start(seed, host_sampler_get_bounce_dimension(depth, SAMPLER_BOUNCE_LIGHT), SAMPLER_BOUNCE_LIGHT_DIMENSIONS);
+            radiance += throughput * sample_direct_light(P, n, wo, mat, hit.object, seed, ray_count);
+            if (primary && depth == 0)
+                primary->direct = radiance - primary->emission;
+
+            // Material sampling
+            glm::vec3 wi = {};
+            host_sampler_start(seed, host_sampler_get_bounce_dimension(depth, SAMPLER_BOUNCE_BSDF), SAMPLER_BOUNCE_BSDF_DIMENSIONS);
+            if (!host_scatter(mat, ray.direction, n, seed, wi))
+                break;
+            wi = glm::normalize(wi);
+
+            float pdf = host_sample_material_pdf(mat, n, wo, wi);
+            if (pdf <= 0.0f)
+                break;
+
+            throughput *= host_evaluate_material(mat, n, wo, wi) / pdf;
+            if (throughput.x <= 0.0f && throughput.y <= 0.0f && throughput.z <= 0.0f)
+                break;
+
+            previous_position = P;
+            previous_receiver_normal = get_light_tree_receiver_normal(mat, n);
+            previous_pdf = pdf;
+            ray = HostRay{.origin = P, .direction = wi};
+        }
+
+        if (primary)
+        {
+            // Misses keep the sky as emission
+            if (!primary->is_hit)
+                primary->emission = radiance;
+            primary->indirect = primary->is_hit ? radiance - primary->emission - primary->direct : glm::vec3(0.0f);
+        }
+        return radiance;
+    }
+
+    template <typename Seed>
+    glm::vec3 sample_direct_light(glm::vec3 P, glm::vec3 n, glm::vec3 wo, MATERIAL const &mat, OBJECT_INFO self,
+                                  Seed &seed, uint64_t &ray_count) const
+    {
+        glm::vec3 result = glm::vec3(0.0f);
+        for_each_light_sample(P, n, wo, mat, self, seed, ray_count, [&](HostLightSample const &sample)
+                              { result += sample.contribution; });
+        return result;
+    }
+
+    // Next event estimation of sample_direct_light one light sample at a time: every point light & one cube light,
+    // on_sample(HostLightSample) is called for the unoccluded samples the BRDF doesn't cancel.
+    template <typename Seed, typename OnSample>
+    void for_each_light_sample(glm::vec3 P, glm::vec3 n, glm::vec3 wo, MATERIAL const &mat, OBJECT_INFO self,
+                               Seed &seed, uint64_t &ray_count, OnSample &&on_sample) const
+    {
+        for (auto const &light : scene.point_lights)
+        {
+            glm::vec3 Le = to_glm(light.emissive);
+            if (Le.x <= 0.0f && Le.y <= 0.0f && Le.z <= 0.0f)
+                continue;
+
+            glm::vec3 l_pos = to_glm(light.position);
+            glm::vec3 l_nor = glm::normalize(P - l_pos);
+            float distance = glm::length(l_pos - P);
+            glm::vec3 wi = -l_nor;
+
+            glm::vec3 brdf = host_evaluate_material(mat, n, wo, wi);
+            if (brdf.x <= 0.0f && brdf.y <= 0.0f && brdf.z <= 0.0f)
+                continue;
+
+            ++ray_count;
+            if (accel.occluded(HostRay{.origin = P, .direction = wi}, 0.0f, distance))
+                continue;
+
+            float G = host_geom_fact_sa(P, l_pos, l_nor);
+            on_sample(HostLightSample{
+                .wi = wi,
+                .Le = Le * G,
+                .brdf = brdf,
+                .contribution = brdf * Le * G,
+            });
+        }
+
+        uint32_t cube_light_count = static_cast<uint32_t>(scene.cube_lights.size());
+        if (cube_light_count == 0)
+            return;
+
+        uint32_t light_index = 0;
+        float light_pmf = 0.0f;
+        if (!pick_cube_light(P, get_light_tree_receiver_normal(mat, n), seed, light_index, light_pmf))
+            return;
+        LIGHT const &light = scene.cube_lights[light_index];
+
+        // A voxel can't light itself
+        if (light.instance_info.instance_id == self.instance_id && light.instance_info.primitive_id == self.primitive_id)
+            return;
+
+        glm::vec3 Le = to_glm(light.emissive);
+        if (Le.x <= 0.0f && Le.y <= 0.0f && Le.z <= 0.0f)
+            return;
+
+        // Uniform point on a uniform face, sampled in object space and moved to world space
+        glm::mat4 obj2world = daxa_f32mat4x4_to_glm_mat4(scene.instances[light.instance_info.instance_id].transform);
+        glm::mat4 world2obj = glm::inverse(obj2world);
+        glm::vec3 center = glm::vec3(world2obj * glm::vec4(to_glm(light.position), 1.0f));
+
+        uint32_t face = std::min(static_cast<uint32_t>(host_rnd(seed) * CUBE_FACE_COUNT), static_cast<uint32_t>(CUBE_FACE_COUNT - 1));
+        glm::vec3 face_normal = glm::vec3(0.0f);
+        face_normal[face >> 1] = (face & 1) ? 1.0f : -1.0f;
+        glm::vec3 tangent1 = {}, tangent2 = {};
+        host_calculate_orthonormal_basis(face_normal, tangent1, tangent2);
+        float u = host_rnd(seed) - 0.5f;
+        float v = host_rnd(seed) - 0.5f;
+        glm::vec3 object_position = center + face_normal * (light.size * 0.5f) + (tangent1 * u + tangent2 * v) * light.size;
+
+        glm::vec3 l_pos = glm::vec3(obj2world * glm::vec4(object_position, 1.0f));
+        glm::vec3 l_nor = glm::normalize(glm::transpose(glm::mat3(world2obj)) * face_normal);
+
+        glm::vec3 to_light = l_pos - P;
+        float distance = glm::length(to_light);
+        glm::vec3 wi = to_light / distance;
+
+        // Faces turned away from P carry no light
+        if (glm::dot(-wi, l_nor) <= 0.0f)
+            return;
+
+        glm::vec3 brdf = host_evaluate_material(mat, n, wo, wi);
+        if (brdf.x <= 0.0f && brdf.y <= 0.0f && brdf.z <= 0.0f)
+            return;
+
+        ++ray_count;
+        if (accel.occluded(HostRay{.origin = P, .direction = wi}, 0.0f, distance, light.instance_info))
+            return;
+
+        float G = host_geom_fact_sa(P, l_pos, l_nor);
+        float light_pdf = light_pmf / (CUBE_FACE_COUNT * get_cube_light_face_area(light, l_nor));
+        float material_pdf = host_sample_material_pdf(mat, n, wo, wi);
+        float mis_weight = host_eval_mis(light_pdf, material_pdf * G);
+
+        on_sample(HostLightSample{
+            .wi = wi,
+            .Le = Le,
+            .brdf = brdf,
+            .solid_angle_pdf = light_pdf / G,
+            .mis_weight = mis_weight,
+            .type = GEOMETRY_LIGHT_CUBE,
+            .object = light.instance_info,
+            .contribution = brdf * Le * G * mis_weight / light_pdf,
+        });
+    }
+
+    // Area measure density of a point on a cube light picked among every cube light (uniformly, by power or with the tree
+    // for a receiver at P with get_light_tree_receiver_normal n) & a uniform face
+    float get_cube_light_pdf(uint32_t light_index, glm::vec3 const &world_normal, glm::vec3 P, glm::vec3 n) const
+    {
+        LIGHT const &light = scene.cube_lights[light_index];
+        float face_area = get_cube_light_face_area(light, world_normal);
+        if (face_area <= 0.0f)
+            return 0.0f;
+        return get_cube_light_pmf(light_index, P, n) / (CUBE_FACE_COUNT * face_area);
+    }
+
+    float get_cube_light_pmf(uint32_t light_index, glm::vec3 P, glm::vec3 n) const
+    {
+        if (light_tree)
+            return light_tree->get_pmf(P, n, light_index);
+        if (light_alias_table)
+            return light_alias_table->get_pmf(light_index);
+        return 1.0f / static_cast<float>(scene.cube_lights.size());
+    }
+
+private:
+    // The first random number picks the light for every picker so their sequences stay aligned
+    template <typename Seed>
+    bool pick_cube_light(glm::vec3 P, glm::vec3 n, Seed &seed, uint32_t &light_index, float &light_pmf) const
+    {
+        float u = host_rnd(seed);
+        if (light_tree)
+            return light_tree->sample(P, n, u, light_index, light_pmf);
+        if (light_alias_table)
+            return light_alias_table->sample(u, host_rnd(seed), light_index, light_pmf);
+
+        uint32_t cube_light_count = static_cast<uint32_t>(scene.cube_lights.size());
+        light_index = std::min(static_cast<uint32_t>(u * cube_light_count), cube_light_count - 1);
+        light_pmf = 1.0f / static_cast<float>(cube_light_count);
+        return true;
+    }
+
+    // World area of a cube light face, instances may scale their voxels
+    float get_cube_light_face_area(LIGHT const &light, glm::vec3 const &world_normal) const
+    {
+        glm::mat3 obj2world = glm::mat3(daxa_f32mat4x4_to_glm_mat4(scene.instances[light.instance_info.instance_id].transform));
+        glm::vec3 object_normal = glm::transpose(obj2world) * world_normal;
+        // Nanson's formula: dA_world = det(M) |M^-T n| dA_object
+        return light.size * light.size * std::abs(glm::determinant(obj2world)) * glm::length(glm::inverse(glm::transpose(obj2world)) * glm::normalize(object_normal));
+    }
+
+    HostAccel const &accel;
+    HostScene const &scene;
+    ReferenceSettings settings = {};
+    LightTree const *light_tree = nullptr;
+    LightAliasTable const *light_alias_table = nullptr;
+};
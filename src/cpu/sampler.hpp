@@ -0,0 +1,209 @@
+#pragma once
+#include "defines.h"
+#include "host_shading.hpp"
+#include "shaders/sampler_tables.inl"
+
+// Host port of sampler.glsl: same names with host_, same integer math, so a (pixel, frame, dimension) gives the same
+// bits on both sides.
+//  - SAMPLER_TYPE_PCG: pcg4d hash of (x, y, frame, dimension) (Jarzynski & Olano 2020), nothing to carry along.
+//  - SAMPLER_TYPE_SOBOL: Owen scrambled Sobol points (Burley 2020), the frame is the index. Dimensions go by sets of
+//    SAMPLER_SOBOL_DIMENSIONS, every set of a pixel has its own shuffle & scramble seed.
+//  - SAMPLER_TYPE_BLUE_NOISE: the Owen scrambled Sobol sequence of SAMPLER_TYPE_SOBOL with one seed for every pixel,
+//    rotated per pixel by the blue noise mask shifted per dimension (Georgiev & Fajardo 2016): the error is blue noise
+//    at low sample counts & every pixel still converges at the Sobol rate.
+//  - SAMPLER_TYPE_LCG: the tea seeded LCG streams of random.glsl (host_rnd), the previous behaviour.
+// HostSampler walks the dimensions of a path (SAMPLER_CAMERA_DIMENSIONS, then SAMPLER_BOUNCE_DIMENSIONS per bounce)
+// and is a drop-in for the uint32_t seeds of the shading helpers through host_rnd.
+
+#define SAMPLER_PCG_SALT 0x2c1b3c6dU
+#define SAMPLER_BLUE_NOISE_SALT 0x297a2d39U
+
+//////////////////////////////// HASHES //////////////////////////////////////
+
+inline uint32_t host_sampler_pcg(uint32_t v)
+{
+    uint32_t state = v * 747796405U + 2891336453U;
+    uint32_t word = ((state >> ((state >> 28U) + 4U)) ^ state) * 277803737U;
+    return (word >> 22U) ^ word;
+}
+
+inline void host_sampler_pcg4d(uint32_t &x, uint32_t &y, uint32_t &z, uint32_t &w)
+{
+    x = x * 1664525U + 1013904223U;
+    y = y * 1664525U + 1013904223U;
+    z = z * 1664525U + 1013904223U;
+    w = w * 1664525U + 1013904223U;
+
+    x += y * w;
+    y += z * x;
+    z += x * y;
+    w += y * z;
+
+    x ^= x >> 16U;
+    y ^= y >> 16U;
+    z ^= z >> 16U;
+    w ^= w >> 16U;
+
+    x += y * w;
+    y += z * x;
+    z += x * y;
+    w += y * z;
+}
+
+inline uint32_t host_sampler_hash_combine(uint32_t seed, uint32_t v)
+{
+    return host_sampler_pcg(seed ^ host_sampler_pcg(v));
+}
+
+inline uint32_t host_sampler_reverse_bits(uint32_t x)
+{
+    x = ((x >> 1U) & 0x55555555U) | ((x & 0x55555555U) << 1U);
+    x = ((x >> 2U) & 0x33333333U) | ((x & 0x33333333U) << 2U);
+    x = ((x >> 4U) & 0x0f0f0f0fU) | ((x & 0x0f0f0f0fU) << 4U);
+    x = ((x >> 8U) & 0x00ff00ffU) | ((x & 0x00ff00ffU) << 8U);
+    return (x >> 16U) | (x << 16U);
+}
+
+// Owen scrambling of the bits of x from the highest one: a flip of a bit depends on the bits above it only
+inline uint32_t host_sampler_nested_uniform_scramble(uint32_t x, uint32_t seed)
+{
+    x = host_sampler_reverse_bits(x);
+    x ^= x * 0x3d20adeaU;
+    x += seed;
+    x *= (seed >> 16U) | 1U;
+    x ^= x * 0x05526c56U;
+    x ^= x * 0x53a22864U;
+    return host_sampler_reverse_bits(x);
+}
+
+//////////////////////////////// SEQUENCES //////////////////////////////////////
+
+inline uint32_t host_sampler_sobol(uint32_t index, uint32_t dimension)
+{
+    uint32_t result = 0;
+    for (uint32_t bit = dimension * 32U; index != 0; index >>= 1U, ++bit)
+        if (index & 1U)
+            result ^= sampler_sobol_matrices[bit];
+    return result;
+}
+
+// The index is shuffled with the seed of the set, every dimension of it scrambled with its own
+inline uint32_t host_sampler_owen_sobol(uint32_t index, uint32_t dimension, uint32_t seed)
+{
+    uint32_t set_dimension = dimension % SAMPLER_SOBOL_DIMENSIONS;
+    index = host_sampler_nested_uniform_scramble(index, seed);
+    return host_sampler_nested_uniform_scramble(host_sampler_sobol(index, set_dimension), host_sampler_hash_combine(seed, set_dimension));
+}
+
+inline uint32_t host_sampler_get_blue_noise_rank(uint32_t x, uint32_t y)
+{
+    uint32_t cell = (y % SAMPLER_BLUE_NOISE_SIZE) * SAMPLER_BLUE_NOISE_SIZE + (x % SAMPLER_BLUE_NOISE_SIZE);
+    return (sampler_blue_noise_ranks[cell >> 1U] >> ((cell & 1U) * 16U)) & 0xffffU;
+}
+
+// 24 high bits to [0, 1)
+inline float host_sampler_to_float(uint32_t bits)
+{
+    return static_cast<float>(bits >> 8U) * (1.0f / 16777216.0f);
+}
+
+// Bits of a dimension of a pixel at a frame, every type but SAMPLER_TYPE_LCG
+inline uint32_t host_sampler_get_bits(uint32_t type, uint32_t x, uint32_t y, uint32_t frame, uint32_t dimension)
+{
+    uint32_t set = dimension / SAMPLER_SOBOL_DIMENSIONS;
+    switch (type)
+    {
+    case SAMPLER_TYPE_SOBOL:
+    {
+        uint32_t pixel_seed = x, set_seed = y, z = set, w = SAMPLER_PCG_SALT;
+        host_sampler_pcg4d(pixel_seed, set_seed, z, w);
+        return host_sampler_owen_sobol(frame, dimension, pixel_seed);
+    }
+    case SAMPLER_TYPE_BLUE_NOISE:
+    {
+        // Toroidal shift of the mask per dimension so dimensions don't share the rotation
+        uint32_t offset_x = dimension, offset_y = SAMPLER_BLUE_NOISE_SALT, z = 0, w = 0;
+        host_sampler_pcg4d(offset_x, offset_y, z, w);
+        uint32_t rank = host_sampler_get_blue_noise_rank(x + offset_x, y + offset_y);
+        uint32_t bits = host_sampler_owen_sobol(frame, dimension, host_sampler_hash_combine(SAMPLER_BLUE_NOISE_SALT, set));
+        // Cranley-Patterson rotation by the rank, in fixed point so it wraps exactly
+        return bits + (rank << (32U - 12U));
+    }
+    case SAMPLER_TYPE_PCG:
+    default:
+    {
+        uint32_t px = x, py = y, pf = frame, pd = dimension ^ SAMPLER_PCG_SALT;
+        host_sampler_pcg4d(px, py, pf, pd);
+        return px;
+    }
+    }
+}
+
+inline float host_sampler_get_1d(uint32_t type, uint32_t x, uint32_t y, uint32_t frame, uint32_t dimension)
+{
+    return host_sampler_to_float(host_sampler_get_bits(type, x, y, frame, dimension));
+}
+
+//////////////////////////////// PATHS //////////////////////////////////////
+
+struct HostSampler
+{
+    uint32_t type = SAMPLER_TYPE_PCG;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t frame = 0;
+    uint32_t dimension = 0;
+    uint32_t dimension_end = 0;  // end of the dimensions given to the current step of the path
+    uint32_t overflow = 0;       // numbers drawn past dimension_end
+    uint32_t seed = 0;           // SAMPLER_TYPE_LCG stream
+};
+
+// The LCG stream of a pixel is tea(pixel, frame) as in rgen.glsl
+inline HostSampler host_sampler_init(uint32_t type, uint32_t x, uint32_t y, uint32_t frame, uint32_t width)
+{
+    return HostSampler{
+        .type = type,
+        .x = x,
+        .y = y,
+        .frame = frame,
+        .dimension = 0,
+        .dimension_end = SAMPLER_CAMERA_DIMENSIONS,
+        .seed = host_tea(y * width + x, frame),
+    };
+}
+
+// Gives the next count numbers the dimensions from dimension on
+inline void host_sampler_start(HostSampler &sampler, uint32_t dimension, uint32_t count)
+{
+    sampler.dimension = dimension;
+    sampler.dimension_end = dimension + count;
+}
+
+// First dimension of a step of a bounce, the first bounce is depth 0
+inline uint32_t host_sampler_get_bounce_dimension(uint32_t depth, uint32_t offset)
+{
+    return SAMPLER_CAMERA_DIMENSIONS + depth * SAMPLER_BOUNCE_DIMENSIONS + offset;
+}
+
+// LCG seeds have no dimensions
+inline void host_sampler_start(uint32_t &, uint32_t, uint32_t) {}
+
+// Numbers past the dimensions of a step (rejection sampling) come from an independent stream so they never repeat
+// the ones of another step
+inline float host_sampler_next_1d(HostSampler &sampler)
+{
+    if (sampler.type == SAMPLER_TYPE_LCG)
+        return host_rnd(sampler.seed);
+    if (sampler.dimension < sampler.dimension_end)
+        return host_sampler_get_1d(sampler.type, sampler.x, sampler.y, sampler.frame, sampler.dimension++);
+
+    uint32_t px = sampler.x, py = sampler.y, pf = sampler.frame, pd = 0x80000000U | sampler.overflow++;
+    host_sampler_pcg4d(px, py, pf, pd);
+    return host_sampler_to_float(px);
+}
+
+// Overload of the uint32_t LCG seed version, the templated shading helpers take either
+inline float host_rnd(HostSampler &sampler)
+{
+    return host_sampler_next_1d(sampler);
+}
@@ -0,0 +1,600 @@
+#pragma once
+#include "defines.h"
+#include "shader_permutations.hpp"
+#include "tile_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+// SPIR-V cache of the shader permutations: every permutation is keyed by the contents of the files its source reaches
+// through #include (& Slang import), its stage, defines & entry point and the compiler's name, binaries are kept on disk under
+// that key. Misses are compiled by the pool, one glslangValidator / slangc process per permutation, and permutations
+// with the same key (both ray tracing pipelines share most of their shaders) are compiled once.
+//  - Keys hash contents, not paths, so a checkout moved elsewhere keeps its cache.
+//  - Includes are found the way the compilers look for them: next to the including file for "", then in the root
+//    paths. Lines of every #if branch count, a key may change for a file a permutation doesn't use.
+//  - Files that aren't found (daxa's headers without its include dir) only add their name.
+
+//////////////////////////////// SOURCES //////////////////////////////////////
+
+struct ShaderSourceFile
+{
+    std::filesystem::path path = {};
+    uint64_t hash = 0;
+    // Resolved includes in the order of the file, unresolved ones keep their name
+    std::vector<std::filesystem::path> includes = {};
+    std::vector<std::string> missing_includes = {};
+};
+
+// FNV-1a of the bytes of a file
+inline uint64_t get_shader_source_hash(std::string const &text)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Names of the #include "..." / <...> lines & of the Slang imports (module.name; is module/name.slang), quoted ones flagged
+inline void get_shader_source_includes(std::string const &text, ShaderSourceLanguage language, std::vector<std::pair<std::string, bool>> &includes)
+{
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string::npos)
+            continue;
+
+        if (line[i] == '#')
+        {
+            i = line.find_first_not_of(" \t", i + 1);
+            if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+                continue;
+            i = line.find_first_not_of(" \t", i + 7);
+            if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+                continue;
+            char close = line[i] == '"' ? '"' : '>';
+            size_t end = line.find(close, i + 1);
+            if (end != std::string::npos && end > i + 1)
+                includes.push_back({line.substr(i + 1, end - i - 1), close == '"'});
+        }
+        else if (language == ShaderSourceLanguage::SLANG && line.compare(i, 7, "import ") == 0)
+        {
+            size_t begin = line.find_first_not_of(" \t", i + 7);
+            size_t end = line.find(';', begin);
+            if (begin == std::string::npos || end == std::string::npos)
+                continue;
+            std::string name = line.substr(begin, end - begin);
+            name.erase(name.find_last_not_of(" \t") + 1);
+            std::replace(name.begin(), name.end(), '.', '/');
+            includes.push_back({name + ".slang", true});
+        }
+    }
+}
+
+// Files of the sources, read & scanned once for all the permutations
+struct ShaderSourceTree
+{
+    ShaderSourceTree(std::vector<std::filesystem::path> glsl_root_paths, std::vector<std::filesystem::path> slang_root_paths)
+        : glsl_root_paths(std::move(glsl_root_paths)), slang_root_paths(std::move(slang_root_paths)) {}
+
+    auto get_root_paths(ShaderSourceLanguage language) const -> std::vector<std::filesystem::path> const &
+    {
+        return language == ShaderSourceLanguage::SLANG ? slang_root_paths : glsl_root_paths;
+    }
+
+    // Empty when the file is in none of the directories
+    auto find(std::string const &name, ShaderSourceLanguage language, std::filesystem::path const &including_dir = {}) const -> std::filesystem::path
+    {
+        std::error_code error = {};
+        if (!including_dir.empty() && std::filesystem::is_regular_file(including_dir / name, error))
+            return (including_dir / name).lexically_normal();
+        for (auto const &root : get_root_paths(language))
+            if (std::filesystem::is_regular_file(root / name, error))
+                return (root / name).lexically_normal();
+        return {};
+    }
+
+    // Null when the file can't be read
+    auto get_file(std::filesystem::path const &path, ShaderSourceLanguage language) -> ShaderSourceFile const *
+    {
+        auto found = files.find(path.generic_string());
+        if (found != files.end())
+            return found->second.path.empty() ? nullptr : &found->second;
+
+        ShaderSourceFile &file = files[path.generic_string()];
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream.is_open())
+            return nullptr;
+        std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        file.path = path;
+        file.hash = get_shader_source_hash(text);
+        std::vector<std::pair<std::string, bool>> includes = {};
+        get_shader_source_includes(text, language, includes);
+        for (auto const &[name, quoted] : includes)
+        {
+            std::filesystem::path include = find(name, language, quoted ? path.parent_path() : std::filesystem::path{});
+            if (include.empty())
+                file.missing_includes.push_back(name);
+            else
+                file.includes.push_back(include);
+        }
+        return &file;
+    }
+
+    // Every file the source reaches, the source first & the others depth first in include order, each once
+    bool get_dependencies(std::filesystem::path const &source, ShaderSourceLanguage language, std::vector<ShaderSourceFile const *> &dependencies)
+    {
+        dependencies.clear();
+        std::vector<std::filesystem::path> stack = {source};
+        std::vector<std::string> visited = {};
+        while (!stack.empty())
+        {
+            std::filesystem::path path = stack.back();
+            stack.pop_back();
+            if (std::find(visited.begin(), visited.end(), path.generic_string()) != visited.end())
+                continue;
+            visited.push_back(path.generic_string());
+
+            ShaderSourceFile const *file = get_file(path, language);
+            if (!file)
+            {
+#if WARN
+                std::cerr << "ShaderSourceTree: could not read " << path.string() << std::endl;
+#endif // WARN
+                return false;
+            }
+            dependencies.push_back(file);
+            for (auto include = file->includes.rbegin(); include != file->includes.rend(); ++include)
+                stack.push_back(*include);
+        }
+        return true;
+    }
+
+    std::vector<std::filesystem::path> glsl_root_paths = {};
+    std::vector<std::filesystem::path> slang_root_paths = {};
+    std::map<std::string, ShaderSourceFile> files = {};
+};
+
+//////////////////////////////// KEYS //////////////////////////////////////
+
+static constexpr uint32_t SHADER_CACHE_MAGIC = 0x48535443; // "CTSH"
+// Bump with the compiler arguments or the preamble of the sources
+static constexpr uint32_t SHADER_CACHE_VERSION = 1;
+static constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+struct ShaderCacheSettings
+{
+    std::filesystem::path cache_dir = "build/shader_cache";
+    // The root paths of the table are relative to it
+    std::filesystem::path source_root = ".";
+    // Searched before the root paths (daxa's shader include dir)
+    std::vector<std::filesystem::path> include_dirs = {};
+    std::string glsl_compiler = "glslangValidator";
+    std::string slang_compiler = "slangc";
+};
+
+inline ShaderSourceTree get_shader_source_tree(ShaderCacheSettings const &settings)
+{
+    auto get_paths = [&](ShaderSourceLanguage language)
+    {
+        std::vector<std::filesystem::path> paths = settings.include_dirs;
+        for (auto const &root : get_shader_root_paths(language))
+            paths.push_back(settings.source_root / root);
+        return paths;
+    };
+    return ShaderSourceTree(get_paths(ShaderSourceLanguage::GLSL), get_paths(ShaderSourceLanguage::SLANG));
+}
+
+inline std::string const &get_shader_compiler(ShaderCacheSettings const &settings, ShaderSourceLanguage language)
+{
+    return language == ShaderSourceLanguage::SLANG ? settings.slang_compiler : settings.glsl_compiler;
+}
+
+// FNV-1a of the permutation, the compiler's name & the hashes of the files it reaches in order
+inline uint64_t get_shader_key(ShaderPermutation const &shader, std::vector<ShaderSourceFile const *> const &dependencies, std::string const &compiler)
+{
+    uint64_t key = 14695981039346656037ull;
+    auto add = [&](uint64_t value)
+    {
+        key ^= value;
+        key *= 1099511628211ull;
+    };
+    auto add_string = [&](std::string const &text)
+    {
+        add(text.size());
+        add(get_shader_source_hash(text));
+    };
+    add(SHADER_CACHE_VERSION);
+    add(static_cast<uint64_t>(shader.stage));
+    add(static_cast<uint64_t>(shader.language));
+    add_string(shader.entry_point);
+    add(shader.defines.size());
+    for (auto const &define : shader.defines)
+    {
+        add_string(define.name);
+        add_string(define.value);
+    }
+    // The name only, the build & the app find the same compiler at other paths
+    add_string(std::filesystem::path(compiler).stem().string());
+    for (ShaderSourceFile const *file : dependencies)
+    {
+        add(file->hash);
+        add(file->missing_includes.size());
+        for (auto const &name : file->missing_includes)
+            add_string(name);
+    }
+    return key;
+}
+
+inline std::filesystem::path get_shader_binary_path(std::filesystem::path const &cache_dir, ShaderPermutation const &shader, uint64_t key)
+{
+    char name[40];
+    std::snprintf(name, sizeof(name), "_%s_%016llx.spv", get_shader_stage_name(shader.stage), static_cast<unsigned long long>(key));
+    return cache_dir / (std::filesystem::path(shader.source).stem().string() + name);
+}
+
+//////////////////////////////// BINARIES //////////////////////////////////////
+
+inline bool is_spirv(std::vector<uint32_t> const &spirv)
+{
+    // Magic, version, generator, bound & schema
+    return spirv.size() > 5 && spirv[0] == SPIRV_MAGIC;
+}
+
+// Through a temporary file renamed over the binary, a reader never sees half of one
+inline bool write_shader_binary(std::filesystem::path const &path, ShaderPermutation const &shader, uint64_t key, std::vector<uint32_t> const &spirv)
+{
+    std::filesystem::path temporary = path;
+    temporary += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open())
+        {
+#if WARN
+            std::cerr << "write_shader_binary: could not open " << temporary.string() << std::endl;
+#endif // WARN
+            return false;
+        }
+        uint32_t const header[] = {SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, static_cast<uint32_t>(shader.stage), static_cast<uint32_t>(shader.language),
+                                   static_cast<uint32_t>(spirv.size()), static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)};
+        file.write(reinterpret_cast<char const *>(header), sizeof(header));
+        file.write(reinterpret_cast<char const *>(spirv.data()), spirv.size() * sizeof(uint32_t));
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error = {};
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        // Another process cached the same key first
+        std::filesystem::remove(temporary, error);
+        return std::filesystem::exists(path, error);
+    }
+    return true;
+}
+
+// Fails on other permutations (hash collisions, stale files), truncated files & anything that isn't SPIR-V
+inline bool read_shader_binary(std::filesystem::path const &path, ShaderPermutation const &shader, uint64_t key, std::vector<uint32_t> &spirv)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint32_t header[7] = {};
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!file.good() || header[0] != SHADER_CACHE_MAGIC || header[1] != SHADER_CACHE_VERSION)
+        return false;
+
+    uint64_t stored_key = header[5] | (static_cast<uint64_t>(header[6]) << 32);
+    if (header[2] != static_cast<uint32_t>(shader.stage) || header[3] != static_cast<uint32_t>(shader.language) || stored_key != key)
+    {
+#if WARN
+        std::cerr << "read_shader_binary: " << path.string() << " holds another shader" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    spirv.resize(header[4]);
+    file.read(reinterpret_cast<char *>(spirv.data()), spirv.size() * sizeof(uint32_t));
+    if (!file.good() || file.peek() != std::ifstream::traits_type::eof() || !is_spirv(spirv))
+    {
+#if WARN
+        std::cerr << "read_shader_binary: " << path.string() << " is truncated" << std::endl;
+#endif // WARN
+        spirv.clear();
+        return false;
+    }
+    return true;
+}
+
+//////////////////////////////// COMPILER //////////////////////////////////////
+
+struct ShaderCompileJob
+{
+    ShaderPermutation const *shader = nullptr;
+    std::filesystem::path source_path = {};
+    uint64_t key = 0;
+    // Root paths of the language, searched for the includes
+    std::vector<std::filesystem::path> const *include_paths = nullptr;
+    // Scratch files of the job
+    std::filesystem::path work_dir = {};
+};
+
+// Fills spirv or the log of the failure, called from the threads of the pool
+using ShaderCompileFunction = std::function<bool(ShaderCompileJob const &, ShaderCacheSettings const &, std::vector<uint32_t> &, std::string &)>;
+
+inline char const *get_daxa_shader_stage_define(ShaderStage stage)
+{
+    switch (stage)
+    {
+    case ShaderStage::RAY_GEN:
+        return "DAXA_SHADER_STAGE_RAYGEN";
+    case ShaderStage::INTERSECTION:
+        return "DAXA_SHADER_STAGE_INTERSECTION";
+    case ShaderStage::ANY_HIT:
+        return "DAXA_SHADER_STAGE_ANY_HIT";
+    case ShaderStage::CALLABLE:
+        return "DAXA_SHADER_STAGE_CALLABLE";
+    case ShaderStage::CLOSEST_HIT:
+        return "DAXA_SHADER_STAGE_CLOSEST_HIT";
+    case ShaderStage::MISS:
+        return "DAXA_SHADER_STAGE_MISS";
+    default:
+        return "DAXA_SHADER_STAGE_COMPUTE";
+    }
+}
+
+inline std::string get_quoted(std::filesystem::path const &path) { return "\"" + path.generic_string() + "\""; }
+
+// Command line of the compiler writing output, the sources get the defines daxa's pipeline manager puts before them
+// (GLSL through a wrapper including the source, Slang on the command line)
+inline std::string get_shader_compile_command(ShaderCompileJob const &job, ShaderCacheSettings const &settings,
+                                              std::filesystem::path const &input, std::filesystem::path const &output)
+{
+    ShaderPermutation const &shader = *job.shader;
+    std::string command = get_quoted(get_shader_compiler(settings, shader.language));
+    if (shader.language == ShaderSourceLanguage::SLANG)
+    {
+        command += " " + get_quoted(input) + " -target spirv -entry " + shader.entry_point + " -stage compute";
+        command += " -DDAXA_SHADER=1 -DDAXA_SHADERLANG=2 -DDAXA_SHADER_STAGE=" + std::string(get_daxa_shader_stage_define(shader.stage));
+    }
+    else
+    {
+        command += std::string(" -V --target-env vulkan1.3 -S ") + get_shader_stage_name(shader.stage) + " " + get_quoted(input);
+    }
+    for (auto const &define : shader.defines)
+        command += " -D" + define.name + "=" + define.value;
+    for (auto const &path : *job.include_paths)
+        command += " -I" + get_quoted(path);
+    command += " -o " + get_quoted(output);
+    return command;
+}
+
+inline bool read_spirv_file(std::filesystem::path const &path, std::vector<uint32_t> &spirv)
+{
+    std::error_code error = {};
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error || size % sizeof(uint32_t) != 0)
+        return false;
+    std::ifstream file(path, std::ios::binary);
+    spirv.resize(size / sizeof(uint32_t));
+    file.read(reinterpret_cast<char *>(spirv.data()), size);
+    return file.good() && is_spirv(spirv);
+}
+
+// glslangValidator / slangc in a child process, the scratch files are removed afterwards
+inline bool compile_shader_with_cli(ShaderCompileJob const &job, ShaderCacheSettings const &settings, std::vector<uint32_t> &spirv, std::string &log)
+{
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(job.key));
+    std::filesystem::path input = job.source_path;
+    std::filesystem::path wrapper = job.work_dir / (std::string(name) + ".glsl");
+    std::filesystem::path output = job.work_dir / (std::string(name) + ".spv");
+    std::filesystem::path log_path = job.work_dir / (std::string(name) + ".log");
+
+    if (job.shader->language == ShaderSourceLanguage::GLSL)
+    {
+        std::ofstream file(wrapper);
+        file << "#version 460\n"
+             << "#extension GL_GOOGLE_include_directive : require\n"
+             << "#define DAXA_SHADER 1\n"
+             << "#define DAXA_SHADERLANG 1\n"
+             << "#define DAXA_SHADER_STAGE " << get_daxa_shader_stage_define(job.shader->stage) << "\n"
+             << "#include " << get_quoted(std::filesystem::absolute(job.source_path)) << "\n";
+        if (!file.good())
+        {
+            log = "could not write " + wrapper.string();
+            return false;
+        }
+        input = wrapper;
+    }
+
+    std::string command = get_shader_compile_command(job, settings, input, output) + " > " + get_quoted(log_path) + " 2>&1";
+#if defined(_WIN32)
+    // cmd /c strips the first & last quotes of the line
+    command = "\"" + command + "\"";
+#endif // _WIN32
+    bool compiled = std::system(command.c_str()) == 0 && read_spirv_file(output, spirv);
+    if (!compiled)
+    {
+        std::ifstream file(log_path);
+        log = std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (log.empty())
+            log = command + " failed";
+    }
+
+    std::error_code error = {};
+    std::filesystem::remove(wrapper, error);
+    std::filesystem::remove(output, error);
+    std::filesystem::remove(log_path, error);
+    return compiled;
+}
+
+//////////////////////////////// CACHE //////////////////////////////////////
+
+struct ShaderBinary
+{
+    uint64_t key = 0;
+    std::filesystem::path source_path = {};
+    std::vector<uint32_t> spirv = {};
+    bool from_cache = false;
+};
+
+struct ShaderBinarySet
+{
+    // One per key
+    std::vector<ShaderBinary> binaries = {};
+    // Binary of every permutation asked for
+    std::vector<uint32_t> shader_binaries = {};
+
+    auto get(size_t shader) const -> ShaderBinary const & { return binaries[shader_binaries[shader]]; }
+};
+
+struct ShaderCacheReport
+{
+    uint32_t shader_count = 0; // permutations asked for
+    uint32_t unique_count = 0; // binaries they share
+    uint32_t hit_count = 0;    // lookups found without compiling: binaries in the cache, permutations in a shader pack
+    uint32_t compiled_count = 0;
+    uint32_t failed_count = 0;
+    uint32_t thread_count = 0;
+    double key_ms = 0.0;
+    double load_ms = 0.0;
+    double compile_ms = 0.0;
+    // Logs of the failed compiles
+    std::string errors = {};
+};
+
+// Every shader of the pipelines, in their order
+inline std::vector<ShaderPermutation const *> get_pipeline_shaders(std::vector<PipelineDesc> const &descs)
+{
+    std::vector<ShaderPermutation const *> shaders = {};
+    for (auto const &desc : descs)
+        for (auto const &shader : desc.shaders)
+            shaders.push_back(&shader);
+    return shaders;
+}
+
+// Cached binaries of the permutations, misses compiled by the pool & written to the cache, fails when a source is
+// missing or a compile fails (the binaries of the others are still filled)
+inline bool load_or_compile_shaders(std::vector<ShaderPermutation const *> const &shaders, ShaderCacheSettings const &settings, TilePool &pool,
+                                    ShaderBinarySet &set, ShaderCacheReport *report = nullptr,
+                                    ShaderCompileFunction const &compile = compile_shader_with_cli)
+{
+    using Clock = std::chrono::steady_clock;
+    auto get_ms = [](Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    ShaderCacheReport result = {.shader_count = static_cast<uint32_t>(shaders.size()), .thread_count = pool.get_thread_count()};
+    set = {};
+    set.shader_binaries.resize(shaders.size());
+
+    // Keys, one binary per key
+    auto start = Clock::now();
+    ShaderSourceTree tree = get_shader_source_tree(settings);
+    std::vector<ShaderPermutation const *> unique_shaders = {};
+    std::unordered_map<uint64_t, uint32_t> binary_indices = {};
+    std::vector<ShaderSourceFile const *> dependencies = {};
+    bool ok = true;
+    for (size_t i = 0; i < shaders.size(); ++i)
+    {
+        std::filesystem::path source = tree.find(shaders[i]->source, shaders[i]->language);
+        if (source.empty() || !tree.get_dependencies(source, shaders[i]->language, dependencies))
+        {
+            result.errors += shaders[i]->source + ": source not found\n";
+            ok = false;
+            continue;
+        }
+        uint64_t key = get_shader_key(*shaders[i], dependencies, get_shader_compiler(settings, shaders[i]->language));
+        auto [found, inserted] = binary_indices.try_emplace(key, static_cast<uint32_t>(set.binaries.size()));
+        if (inserted)
+        {
+            set.binaries.push_back(ShaderBinary{.key = key, .source_path = source});
+            unique_shaders.push_back(shaders[i]);
+        }
+        set.shader_binaries[i] = found->second;
+    }
+    result.unique_count = static_cast<uint32_t>(set.binaries.size());
+    result.key_ms = get_ms(start);
+
+    start = Clock::now();
+    pool.run(static_cast<uint32_t>(set.binaries.size()), [&](uint32_t i, uint32_t)
+             {
+        ShaderBinary &binary = set.binaries[i];
+        std::filesystem::path path = get_shader_binary_path(settings.cache_dir, *unique_shaders[i], binary.key);
+        std::error_code error = {};
+        binary.from_cache = std::filesystem::exists(path, error) && read_shader_binary(path, *unique_shaders[i], binary.key, binary.spirv); });
+    std::vector<uint32_t> misses = {};
+    for (uint32_t i = 0; i < set.binaries.size(); ++i)
+        if (!set.binaries[i].from_cache)
+            misses.push_back(i);
+    result.hit_count = result.unique_count - static_cast<uint32_t>(misses.size());
+    result.load_ms = get_ms(start);
+
+    if (!misses.empty())
+    {
+        start = Clock::now();
+        std::filesystem::path work_dir = settings.cache_dir / "work";
+        std::error_code error = {};
+        std::filesystem::create_directories(work_dir, error);
+
+        std::vector<std::string> logs(misses.size());
+        pool.run(static_cast<uint32_t>(misses.size()), [&](uint32_t miss, uint32_t)
+                 {
+            ShaderBinary &binary = set.binaries[misses[miss]];
+            ShaderPermutation const &shader = *unique_shaders[misses[miss]];
+            ShaderCompileJob job = {.shader = &shader, .source_path = binary.source_path, .key = binary.key,
+                                    .include_paths = &tree.get_root_paths(shader.language), .work_dir = work_dir};
+            if (!compile(job, settings, binary.spirv, logs[miss]) || !is_spirv(binary.spirv))
+            {
+                binary.spirv.clear();
+                if (logs[miss].empty())
+                    logs[miss] = "no SPIR-V";
+                return;
+            }
+            // A binary that can't be cached is still good
+            if (!write_shader_binary(get_shader_binary_path(settings.cache_dir, shader, binary.key), shader, binary.key, binary.spirv))
+            {
+#if WARN
+                std::cerr << "load_or_compile_shaders: could not cache " << shader.source << std::endl;
+#endif // WARN
+            } });
+
+        for (size_t miss = 0; miss < misses.size(); ++miss)
+        {
+            if (set.binaries[misses[miss]].spirv.empty())
+            {
+                ShaderPermutation const &shader = *unique_shaders[misses[miss]];
+                result.errors += shader.source + " (" + get_shader_stage_name(shader.stage);
+                for (auto const &define : shader.defines)
+                    result.errors += " " + define.name;
+                result.errors += "):\n" + logs[miss] + "\n";
+                ++result.failed_count;
+                ok = false;
+            }
+            else
+                ++result.compiled_count;
+        }
+        std::filesystem::remove(work_dir, error);
+        result.compile_ms = get_ms(start);
+    }
+
+    if (report)
+        *report = result;
+    return ok;
+}
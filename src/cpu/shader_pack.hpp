@@ -0,0 +1,217 @@
+#pragma once
+#include "defines.h"
+#include "shader_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Shader pack: the SPIR-V of every permutation of the pipeline table in one file, written at build time by
+// shader_precompile (tools/shader_precompile.cpp) & loaded by the app without compiling anything (SHADER_PACK_ON).
+//  - Entries are found by permutation (source, stage, language, entry point & defines), permutations with the same
+//    binary share it.
+//  - Every entry keeps the cache key of the sources it was compiled from, next to the sources the app can tell a pack
+//    older than them & falls back to the shader cache.
+
+//////////////////////////////// PACK //////////////////////////////////////
+
+static constexpr uint32_t SHADER_PACK_MAGIC = 0x50535443; // "CTSP"
+static constexpr uint32_t SHADER_PACK_VERSION = 1;
+
+// FNV-1a of what names a permutation, not of its sources
+inline uint64_t get_shader_permutation_id(ShaderPermutation const &shader)
+{
+    uint64_t id = 14695981039346656037ull;
+    auto add = [&](uint64_t value)
+    {
+        id ^= value;
+        id *= 1099511628211ull;
+    };
+    auto add_string = [&](std::string const &text)
+    {
+        add(text.size());
+        add(get_shader_source_hash(text));
+    };
+    add(SHADER_PACK_VERSION);
+    add_string(shader.source);
+    add(static_cast<uint64_t>(shader.stage));
+    add(static_cast<uint64_t>(shader.language));
+    add_string(shader.entry_point);
+    add(shader.defines.size());
+    for (auto const &define : shader.defines)
+    {
+        add_string(define.name);
+        add_string(define.value);
+    }
+    return id;
+}
+
+struct ShaderPackEntry
+{
+    uint64_t permutation_id = 0;
+    uint64_t key = 0;
+    uint32_t binary = 0;
+};
+
+struct ShaderPack
+{
+    // Sorted by permutation id
+    std::vector<ShaderPackEntry> entries = {};
+    std::vector<std::vector<uint32_t>> binaries = {};
+
+    auto find(ShaderPermutation const &shader) const -> ShaderPackEntry const *
+    {
+        uint64_t id = get_shader_permutation_id(shader);
+        auto found = std::lower_bound(entries.begin(), entries.end(), id, [](ShaderPackEntry const &entry, uint64_t value)
+                                      { return entry.permutation_id < value; });
+        return found != entries.end() && found->permutation_id == id ? &*found : nullptr;
+    }
+
+    // Null when the permutation isn't in the pack
+    auto find_spirv(ShaderPermutation const &shader) const -> std::vector<uint32_t> const *
+    {
+        ShaderPackEntry const *entry = find(shader);
+        return entry ? &binaries[entry->binary] : nullptr;
+    }
+
+    auto get_byte_count() const -> size_t
+    {
+        size_t byte_count = 4 * sizeof(uint32_t) + entries.size() * 5 * sizeof(uint32_t);
+        for (auto const &binary : binaries)
+            byte_count += (binary.size() + 1) * sizeof(uint32_t);
+        return byte_count;
+    }
+};
+
+// Pack of the permutations & of their binaries (load_or_compile_shaders), duplicated permutations are kept once
+inline ShaderPack get_shader_pack(std::vector<ShaderPermutation const *> const &shaders, ShaderBinarySet const &set)
+{
+    ShaderPack pack = {};
+    for (auto const &binary : set.binaries)
+        pack.binaries.push_back(binary.spirv);
+    for (size_t i = 0; i < shaders.size(); ++i)
+        pack.entries.push_back({get_shader_permutation_id(*shaders[i]), set.get(i).key, set.shader_binaries[i]});
+
+    std::sort(pack.entries.begin(), pack.entries.end(), [](ShaderPackEntry const &a, ShaderPackEntry const &b)
+              { return a.permutation_id < b.permutation_id; });
+    pack.entries.erase(std::unique(pack.entries.begin(), pack.entries.end(), [](ShaderPackEntry const &a, ShaderPackEntry const &b)
+                                   { return a.permutation_id == b.permutation_id; }),
+                       pack.entries.end());
+    return pack;
+}
+
+// Through a temporary file renamed over the pack
+inline bool write_shader_pack(std::filesystem::path const &path, ShaderPack const &pack)
+{
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open())
+        {
+#if WARN
+            std::cerr << "write_shader_pack: could not open " << temporary.string() << std::endl;
+#endif // WARN
+            return false;
+        }
+        std::vector<uint32_t> words = {SHADER_PACK_MAGIC, SHADER_PACK_VERSION, static_cast<uint32_t>(pack.entries.size()),
+                                       static_cast<uint32_t>(pack.binaries.size())};
+        for (auto const &entry : pack.entries)
+            words.insert(words.end(), {static_cast<uint32_t>(entry.permutation_id), static_cast<uint32_t>(entry.permutation_id >> 32),
+                                       static_cast<uint32_t>(entry.key), static_cast<uint32_t>(entry.key >> 32), entry.binary});
+        for (auto const &binary : pack.binaries)
+            words.push_back(static_cast<uint32_t>(binary.size()));
+        for (auto const &binary : pack.binaries)
+            words.insert(words.end(), binary.begin(), binary.end());
+        file.write(reinterpret_cast<char const *>(words.data()), words.size() * sizeof(uint32_t));
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error = {};
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+#if WARN
+        std::cerr << "write_shader_pack: could not replace " << path.string() << std::endl;
+#endif // WARN
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+// Fails on other versions, truncated files, unsorted entries, entries without binary & binaries that aren't SPIR-V
+inline bool read_shader_pack(std::filesystem::path const &path, ShaderPack &pack)
+{
+    pack = {};
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+#if WARN
+        std::cerr << "read_shader_pack: could not open " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<uint32_t> words(bytes.size() / sizeof(uint32_t));
+    std::memcpy(words.data(), bytes.data(), words.size() * sizeof(uint32_t));
+
+    auto fail = [&](char const *reason)
+    {
+#if WARN
+        std::cerr << "read_shader_pack: " << path.string() << " " << reason << std::endl;
+#endif // WARN
+        pack = {};
+        return false;
+    };
+    if (words.size() < 4 || words[0] != SHADER_PACK_MAGIC || words[1] != SHADER_PACK_VERSION)
+        return fail("is not a shader pack of this version");
+
+    size_t entry_count = words[2], binary_count = words[3];
+    size_t offset = 4;
+    if (bytes.size() % sizeof(uint32_t) != 0 || words.size() < offset + entry_count * 5 + binary_count)
+        return fail("is truncated");
+    for (size_t i = 0; i < entry_count; ++i, offset += 5)
+    {
+        ShaderPackEntry entry = {.permutation_id = words[offset] | (static_cast<uint64_t>(words[offset + 1]) << 32),
+                                 .key = words[offset + 2] | (static_cast<uint64_t>(words[offset + 3]) << 32),
+                                 .binary = words[offset + 4]};
+        if (entry.binary >= binary_count || (!pack.entries.empty() && pack.entries.back().permutation_id >= entry.permutation_id))
+            return fail("has broken entries");
+        pack.entries.push_back(entry);
+    }
+
+    size_t data = offset + binary_count;
+    for (size_t i = 0; i < binary_count; ++i)
+    {
+        size_t word_count = words[offset + i];
+        if (words.size() < data + word_count)
+            return fail("is truncated");
+        pack.binaries.emplace_back(words.begin() + data, words.begin() + data + word_count);
+        if (!is_spirv(pack.binaries.back()))
+            return fail("holds a binary that isn't SPIR-V");
+        data += word_count;
+    }
+    if (data != words.size())
+        return fail("has trailing bytes");
+    return true;
+}
+
+// Permutations whose sources changed since the pack was built (or missing from it), 0 without the sources
+inline uint32_t get_stale_shader_count(ShaderPack const &pack, std::vector<ShaderPermutation const *> const &shaders, ShaderCacheSettings const &settings)
+{
+    ShaderSourceTree tree = get_shader_source_tree(settings);
+    std::vector<ShaderSourceFile const *> dependencies = {};
+    uint32_t stale_count = 0;
+    for (ShaderPermutation const *shader : shaders)
+    {
+        ShaderPackEntry const *entry = pack.find(*shader);
+        std::filesystem::path source = tree.find(shader->source, shader->language);
+        if (source.empty() || !tree.get_dependencies(source, shader->language, dependencies))
+            continue;
+        if (!entry || entry->key != get_shader_key(*shader, dependencies, get_shader_compiler(settings, shader->language)))
+            ++stale_count;
+    }
+    return stale_count;
+}
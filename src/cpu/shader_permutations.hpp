@@ -0,0 +1,203 @@
+#pragma once
+#include "defines.h"
+
+#include <string>
+#include <vector>
+
+// Every shader permutation of the pipelines load_pipelines() creates (the brush of BRUSH_MNGR included), one table for
+// the pipeline manager (hot reload), the SPIR-V cache (shader_cache.hpp) & the shader pack built by shader_precompile.
+//  - Sources are file names looked up in the root paths of their language, like the daxa::ShaderFile of the manager.
+//  - Ray tracing pipelines list their shaders in daxa's stage order (ray gen, intersection, any hit, callable, closest
+//    hit, miss), the indices of the groups count in that order.
+
+//////////////////////////////// PERMUTATIONS //////////////////////////////////////
+
+enum class ShaderStage : uint32_t
+{
+    RAY_GEN = 0,
+    INTERSECTION = 1,
+    ANY_HIT = 2,
+    CALLABLE = 3,
+    CLOSEST_HIT = 4,
+    MISS = 5,
+    COMPUTE = 6,
+};
+
+enum class ShaderSourceLanguage : uint32_t
+{
+    GLSL = 0,
+    SLANG = 1,
+};
+
+inline char const *get_shader_stage_name(ShaderStage stage)
+{
+    switch (stage)
+    {
+    case ShaderStage::RAY_GEN:
+        return "rgen";
+    case ShaderStage::INTERSECTION:
+        return "rint";
+    case ShaderStage::ANY_HIT:
+        return "rahit";
+    case ShaderStage::CALLABLE:
+        return "rcall";
+    case ShaderStage::CLOSEST_HIT:
+        return "rchit";
+    case ShaderStage::MISS:
+        return "rmiss";
+    default:
+        return "comp";
+    }
+}
+
+struct ShaderPermutationDefine
+{
+    std::string name;
+    std::string value = "1";
+};
+
+struct ShaderPermutation
+{
+    std::string source;
+    ShaderStage stage = ShaderStage::COMPUTE;
+    ShaderSourceLanguage language = ShaderSourceLanguage::GLSL;
+    std::vector<ShaderPermutationDefine> defines = {};
+    // Slang entry points, GLSL is always main
+    std::string entry_point = "main";
+};
+
+enum class ShaderGroupType : uint32_t
+{
+    GENERAL = 0,
+    PROCEDURAL_HIT_GROUP = 1,
+};
+
+struct ShaderGroupDesc
+{
+    ShaderGroupType type = ShaderGroupType::GENERAL;
+    uint32_t general_shader_index = ~0U;
+    uint32_t closest_hit_shader_index = ~0U;
+    uint32_t any_hit_shader_index = ~0U;
+    uint32_t intersection_shader_index = ~0U;
+};
+
+//////////////////////////////// PIPELINES //////////////////////////////////////
+
+enum class PipelineId : uint32_t
+{
+    PRIMARY_HIT_RT = 0,
+    SHADING_RT = 1,
+    TAA_COMP = 2,
+    DENOISER_TEMPORAL_COMP = 3,
+    DENOISER_ATROUS_COMP = 4,
+    REARRANGEMENT_COMP = 5,
+    BRUSH_COMP = 6,
+};
+
+struct PipelineDesc
+{
+    PipelineId id = PipelineId::TAA_COMP;
+    std::string name;
+    // One compute shader or the stages of a ray tracing pipeline
+    std::vector<ShaderPermutation> shaders = {};
+    std::vector<ShaderGroupDesc> groups = {};
+    uint32_t push_constant_size = 0;
+
+    bool is_ray_tracing() const { return !groups.empty(); }
+};
+
+// Root paths of the sources, relative to the working directory of the app (daxa's include dir comes on top)
+inline std::vector<std::string> const &get_shader_root_paths(ShaderSourceLanguage language)
+{
+    static std::vector<std::string> const glsl_root_paths = {
+        "src/shaders",
+        "src/shaders/include",
+        "src/shaders/glsl",
+        "src/shaders/glsl/raytracing",
+        "src/shaders/glsl/restir_pt",
+        "src/shaders/glsl/restir_di",
+        "src/shaders/glsl/compute",
+    };
+    static std::vector<std::string> const slang_root_paths = {
+        "src/shaders",
+        "src/shaders/include",
+        "src/shaders/slang",
+        "src/shaders/slang/compute",
+    };
+    return language == ShaderSourceLanguage::SLANG ? slang_root_paths : glsl_root_paths;
+}
+
+// Both ray tracing passes share everything but the ray gen & closest hit defines
+inline PipelineDesc get_ray_tracing_pipeline_desc(PipelineId id, std::string name, char const *ray_gen_pass, bool invocation_reorder)
+{
+    auto glsl = [](std::string source, ShaderStage stage, std::vector<ShaderPermutationDefine> defines = {})
+    {
+        return ShaderPermutation{.source = std::move(source), .stage = stage, .defines = std::move(defines)};
+    };
+    // Shader execution reordering
+    auto reorder = [&](std::vector<ShaderPermutationDefine> defines)
+    {
+        if (invocation_reorder)
+            defines.push_back({"SER"});
+        return defines;
+    };
+
+    PipelineDesc desc = {.id = id, .name = std::move(name), .push_constant_size = sizeof(PushConstant)};
+    desc.shaders = {
+        glsl("rgen.glsl", ShaderStage::RAY_GEN, reorder({{ray_gen_pass}})),          // 0
+        glsl("rint.glsl", ShaderStage::INTERSECTION),                              // 1
+        glsl("rahit.glsl", ShaderStage::ANY_HIT),                                  // 2
+        glsl("rcall_mat.glsl", ShaderStage::CALLABLE, {{"MATERIAL_TEXTURE"}}),     // 3
+        glsl("rcall_mat.glsl", ShaderStage::CALLABLE, {{"PERLIN_TEXTURE"}}),       // 4
+        glsl("rcall_scatter.glsl", ShaderStage::CALLABLE),                         // 5
+        glsl("rcall_scatter.glsl", ShaderStage::CALLABLE, {{"METAL"}}),            // 6
+        glsl("rcall_scatter.glsl", ShaderStage::CALLABLE, {{"DIELECTRIC"}}),       // 7
+        glsl("rcall_scatter.glsl", ShaderStage::CALLABLE, {{"CONSTANT_MEDIUM"}}),  // 8
+        glsl("rchit.glsl", ShaderStage::CLOSEST_HIT, reorder({{"RIS_SELECTION"}})),         // 9
+        glsl("rchit.glsl", ShaderStage::CLOSEST_HIT, reorder({{"INDIRECT_ILLUMINATION"}})), // 10
+        glsl("rmiss.glsl", ShaderStage::MISS),                                     // 11
+        glsl("rmiss.glsl", ShaderStage::MISS, {{"MISS_SHADOW"}}),                  // 12
+    };
+
+    auto general = [](uint32_t index)
+    {
+        return ShaderGroupDesc{.type = ShaderGroupType::GENERAL, .general_shader_index = index};
+    };
+    auto procedural = [](uint32_t closest_hit)
+    {
+        return ShaderGroupDesc{.type = ShaderGroupType::PROCEDURAL_HIT_GROUP, .closest_hit_shader_index = closest_hit,
+                               .any_hit_shader_index = 2, .intersection_shader_index = 1};
+    };
+    desc.groups = {general(0), general(11), general(12), procedural(9), procedural(10),
+                   general(3), general(4), general(5), general(6), general(7), general(8)};
+    return desc;
+}
+
+inline PipelineDesc get_compute_pipeline_desc(PipelineId id, std::string name, ShaderPermutation shader, uint32_t push_constant_size)
+{
+    return PipelineDesc{.id = id, .name = std::move(name), .shaders = {std::move(shader)}, .push_constant_size = push_constant_size};
+}
+
+inline std::vector<PipelineDesc> get_pipeline_descs(bool invocation_reorder)
+{
+    std::vector<PipelineDesc> descs = {};
+    descs.push_back(get_ray_tracing_pipeline_desc(PipelineId::PRIMARY_HIT_RT, "ray trace shader", "RESTIR_PREPASS_AND_FIRST_VISIBILITY_TEST", invocation_reorder));
+    descs.push_back(get_ray_tracing_pipeline_desc(PipelineId::SHADING_RT, "shading ray trace shader", "THIRD_VISIBILITY_TEST_AND_SHADING_PASS", invocation_reorder));
+    descs.push_back(get_compute_pipeline_desc(PipelineId::TAA_COMP, "temporal anti-aliasing shader",
+                                              ShaderPermutation{.source = "taa.glsl"}, sizeof(PushConstant)));
+#if DENOISER_ON == 1
+    descs.push_back(get_compute_pipeline_desc(PipelineId::DENOISER_TEMPORAL_COMP, "denoiser temporal shader",
+                                              ShaderPermutation{.source = "svgf.glsl", .defines = {{"DENOISER_TEMPORAL_PASS"}}}, sizeof(PushConstant)));
+    descs.push_back(get_compute_pipeline_desc(PipelineId::DENOISER_ATROUS_COMP, "denoiser a-trous shader",
+                                              ShaderPermutation{.source = "svgf.glsl", .defines = {{"DENOISER_ATROUS_PASS"}}}, sizeof(PushConstant)));
+#endif // DENOISER_ON
+    descs.push_back(get_compute_pipeline_desc(PipelineId::REARRANGEMENT_COMP, "rearregement shader",
+                                              ShaderPermutation{.source = "rearrangement.slang", .language = ShaderSourceLanguage::SLANG,
+                                                                .entry_point = "entry_rearragement"},
+                                              sizeof(changes_push_constant)));
+    descs.push_back(get_compute_pipeline_desc(PipelineId::BRUSH_COMP, "brush shader",
+                                              ShaderPermutation{.source = "squared_brush.slang", .language = ShaderSourceLanguage::SLANG,
+                                                                .entry_point = "entry_brush"},
+                                              sizeof(changes_push_constant)));
+    return descs;
+}
@@ -0,0 +1,931 @@
+#pragma once
+#include "defines.h"
+#include "image_io.hpp"
+#include "tile_pool.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+// Texture import: RGBA8 images (sRGB color, linear alpha, like ImageTexture loads them) become the layers of one
+// texture array with mip chains, stored as RGBA8, BC1 or BC7 blocks for R8G8B8A8_SRGB, BC1_RGBA_SRGB_BLOCK and
+// BC7_SRGB_BLOCK images of MAX_TEXTURES layers at most.
+//  - Every image is resampled to the layer size in linear space (texture coordinates stay the same), then halved with a
+//    box filter down to 1x1, so distant voxels read a prefiltered level instead of aliasing full resolution texels.
+//  - BC1 drops the alpha (opaque textures, 4 bits per texel), BC7 keeps it with mode 6 only: one RGBA line of 16
+//    colors per 4x4 block (8 bits per texel). Endpoints come from the principal axis of the block and one least squares
+//    refit, errors are measured on the stored sRGB values, which is what the hardware interpolates.
+//  - Blocks of every level & layer are encoded by the pool, arrays are cached on disk under a hash of the settings &
+//    the texels of every image.
+
+//////////////////////////////// IMAGES //////////////////////////////////////
+
+#define TEXTURE_BLOCK_SIZE 4
+
+enum class TextureFormat : uint32_t
+{
+    RGBA8 = 0,
+    BC1 = 1,
+    BC7 = 2,
+};
+
+inline char const *get_texture_format_name(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::BC1:
+        return "BC1";
+    case TextureFormat::BC7:
+        return "BC7";
+    default:
+        return "RGBA8";
+    }
+}
+
+// Bytes of a level, blocks cover the texels past the edge of levels smaller than a block
+inline size_t get_texture_level_bytes(TextureFormat format, uint32_t width, uint32_t height)
+{
+    size_t block_count = static_cast<size_t>((width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE) * ((height + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE);
+    switch (format)
+    {
+    case TextureFormat::BC1:
+        return block_count * 8;
+    case TextureFormat::BC7:
+        return block_count * 16;
+    default:
+        return static_cast<size_t>(width) * height * 4;
+    }
+}
+
+// RGBA8, row major, top row first
+struct TextureImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> texels = {};
+
+    TextureImage() = default;
+    TextureImage(uint32_t image_width, uint32_t image_height)
+        : width(image_width), height(image_height), texels(static_cast<size_t>(image_width) * image_height * 4, 0) {}
+
+    uint8_t *texel(uint32_t x, uint32_t y) { return texels.data() + (static_cast<size_t>(y) * width + x) * 4; }
+    uint8_t const *texel(uint32_t x, uint32_t y) const { return texels.data() + (static_cast<size_t>(y) * width + x) * 4; }
+};
+
+// Linear color & alpha of a TextureImage while it is filtered
+struct LinearImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<glm::vec4> texels = {};
+
+    LinearImage() = default;
+    LinearImage(uint32_t image_width, uint32_t image_height)
+        : width(image_width), height(image_height), texels(static_cast<size_t>(image_width) * image_height, glm::vec4(0.0f)) {}
+};
+
+inline float get_srgb_byte_to_linear(uint8_t value)
+{
+    static std::array<float, 256> const table = []()
+    {
+        std::array<float, 256> values = {};
+        for (uint32_t i = 0; i < 256; ++i)
+            values[i] = srgb_to_linear(static_cast<float>(i) / 255.0f);
+        return values;
+    }();
+    return table[value];
+}
+
+inline uint8_t get_unit_byte(float value)
+{
+    return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+inline LinearImage get_linear_image(TextureImage const &image)
+{
+    LinearImage linear(image.width, image.height);
+    for (size_t i = 0; i < linear.texels.size(); ++i)
+    {
+        uint8_t const *texel = image.texels.data() + i * 4;
+        linear.texels[i] = glm::vec4(get_srgb_byte_to_linear(texel[0]), get_srgb_byte_to_linear(texel[1]), get_srgb_byte_to_linear(texel[2]),
+                                     static_cast<float>(texel[3]) / 255.0f);
+    }
+    return linear;
+}
+
+inline TextureImage get_texture_image(LinearImage const &linear)
+{
+    TextureImage image(linear.width, linear.height);
+    for (size_t i = 0; i < linear.texels.size(); ++i)
+    {
+        glm::vec4 const &texel = linear.texels[i];
+        uint8_t *out = image.texels.data() + i * 4;
+        out[0] = get_unit_byte(linear_to_srgb(std::clamp(texel.x, 0.0f, 1.0f)));
+        out[1] = get_unit_byte(linear_to_srgb(std::clamp(texel.y, 0.0f, 1.0f)));
+        out[2] = get_unit_byte(linear_to_srgb(std::clamp(texel.z, 0.0f, 1.0f)));
+        out[3] = get_unit_byte(texel.w);
+    }
+    return image;
+}
+
+//////////////////////////////// RESAMPLING //////////////////////////////////////
+
+struct ResampleTap
+{
+    uint32_t index = 0;
+    float weight = 0.0f;
+};
+
+// Source texels of every destination texel along an axis, edges clamped: a tent when magnifying, the covered area
+// when minifying (a 2x2 box when halving)
+inline std::vector<std::vector<ResampleTap>> get_resample_taps(uint32_t source_size, uint32_t size)
+{
+    std::vector<std::vector<ResampleTap>> taps(size);
+    float scale = static_cast<float>(source_size) / static_cast<float>(size);
+    for (uint32_t o = 0; o < size; ++o)
+    {
+        std::vector<ResampleTap> &texel_taps = taps[o];
+        if (scale <= 1.0f)
+        {
+            float center = (static_cast<float>(o) + 0.5f) * scale - 0.5f;
+            float base = std::floor(center);
+            float t = center - base;
+            int32_t i = static_cast<int32_t>(base);
+            texel_taps.push_back({static_cast<uint32_t>(std::clamp(i, 0, static_cast<int32_t>(source_size) - 1)), 1.0f - t});
+            if (t > 0.0f)
+                texel_taps.push_back({static_cast<uint32_t>(std::clamp(i + 1, 0, static_cast<int32_t>(source_size) - 1)), t});
+        }
+        else
+        {
+            float begin = static_cast<float>(o) * scale, end = static_cast<float>(o + 1) * scale;
+            uint32_t last = std::min(source_size, static_cast<uint32_t>(std::ceil(end)));
+            for (uint32_t i = static_cast<uint32_t>(begin); i < last; ++i)
+            {
+                float overlap = std::min(end, static_cast<float>(i + 1)) - std::max(begin, static_cast<float>(i));
+                if (overlap > 0.0f)
+                    texel_taps.push_back({i, overlap});
+            }
+        }
+        float sum = 0.0f;
+        for (ResampleTap const &tap : texel_taps)
+            sum += tap.weight;
+        for (ResampleTap &tap : texel_taps)
+            tap.weight /= sum;
+    }
+    return taps;
+}
+
+// Separable, rows then columns, one job per output row
+inline LinearImage resample_linear_image(LinearImage const &image, uint32_t width, uint32_t height, TilePool &pool)
+{
+    if (image.width == width && image.height == height)
+        return image;
+
+    std::vector<std::vector<ResampleTap>> taps_x = get_resample_taps(image.width, width);
+    std::vector<std::vector<ResampleTap>> taps_y = get_resample_taps(image.height, height);
+
+    LinearImage rows(width, image.height);
+    pool.run(image.height, [&](uint32_t y, uint32_t)
+             {
+        glm::vec4 const *source = image.texels.data() + static_cast<size_t>(y) * image.width;
+        glm::vec4 *out = rows.texels.data() + static_cast<size_t>(y) * width;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            glm::vec4 sum = glm::vec4(0.0f);
+            for (ResampleTap const &tap : taps_x[x])
+                sum += source[tap.index] * tap.weight;
+            out[x] = sum;
+        } });
+
+    LinearImage resampled(width, height);
+    pool.run(height, [&](uint32_t y, uint32_t)
+             {
+        glm::vec4 *out = resampled.texels.data() + static_cast<size_t>(y) * width;
+        for (ResampleTap const &tap : taps_y[y])
+        {
+            glm::vec4 const *source = rows.texels.data() + static_cast<size_t>(tap.index) * width;
+            for (uint32_t x = 0; x < width; ++x)
+                out[x] += source[x] * tap.weight;
+        } });
+    return resampled;
+}
+
+inline uint32_t get_mip_count(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+// Levels from the image down to 1x1 (or max_levels), each one halved from the previous linear level
+inline std::vector<TextureImage> build_mip_chain(LinearImage const &image, uint32_t max_levels, TilePool &pool)
+{
+    uint32_t level_count = std::min(max_levels, get_mip_count(image.width, image.height));
+    std::vector<TextureImage> levels;
+    levels.reserve(level_count);
+    LinearImage level = image;
+    for (uint32_t l = 0; l < level_count; ++l)
+    {
+        if (l > 0)
+            level = resample_linear_image(level, std::max(1U, level.width / 2), std::max(1U, level.height / 2), pool);
+        levels.push_back(get_texture_image(level));
+    }
+    return levels;
+}
+
+//////////////////////////////// BLOCKS //////////////////////////////////////
+
+// 16 texels of a block with 4 channels, edges clamped
+struct TextureBlock
+{
+    uint8_t texels[16][4] = {};
+};
+
+inline TextureBlock load_texture_block(TextureImage const &image, uint32_t block_x, uint32_t block_y)
+{
+    TextureBlock block = {};
+    for (uint32_t y = 0; y < TEXTURE_BLOCK_SIZE; ++y)
+        for (uint32_t x = 0; x < TEXTURE_BLOCK_SIZE; ++x)
+        {
+            uint8_t const *texel = image.texel(std::min(block_x * TEXTURE_BLOCK_SIZE + x, image.width - 1),
+                                               std::min(block_y * TEXTURE_BLOCK_SIZE + y, image.height - 1));
+            std::memcpy(block.texels[y * TEXTURE_BLOCK_SIZE + x], texel, 4);
+        }
+    return block;
+}
+
+inline void store_texture_block(TextureBlock const &block, uint32_t block_x, uint32_t block_y, TextureImage &image)
+{
+    for (uint32_t y = 0; y < TEXTURE_BLOCK_SIZE; ++y)
+        for (uint32_t x = 0; x < TEXTURE_BLOCK_SIZE; ++x)
+        {
+            uint32_t image_x = block_x * TEXTURE_BLOCK_SIZE + x, image_y = block_y * TEXTURE_BLOCK_SIZE + y;
+            if (image_x < image.width && image_y < image.height)
+                std::memcpy(image.texel(image_x, image_y), block.texels[y * TEXTURE_BLOCK_SIZE + x], 4);
+        }
+}
+
+// Squared error over the first channel_count channels
+inline uint32_t get_texel_error(uint8_t const *a, int32_t const *b, uint32_t channel_count)
+{
+    uint32_t error = 0;
+    for (uint32_t c = 0; c < channel_count; ++c)
+    {
+        int32_t d = static_cast<int32_t>(a[c]) - b[c];
+        error += static_cast<uint32_t>(d * d);
+    }
+    return error;
+}
+
+// Ends of the segment of the principal axis (power iteration on the covariance) covering the texels. The iteration
+// starts from the covariance column of the widest channel, it has a component along the axis even when channels are
+// anti correlated (the largest deviations of every channel don't).
+inline void get_principal_endpoints(TextureBlock const &block, uint32_t channel_count, float (&e0)[4], float (&e1)[4])
+{
+    float mean[4] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t c = 0; c < channel_count; ++c)
+            mean[c] += static_cast<float>(block.texels[i][c]) / 16.0f;
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t a = 0; a < channel_count; ++a)
+        {
+            float da = static_cast<float>(block.texels[i][a]) - mean[a];
+            for (uint32_t b = 0; b < channel_count; ++b)
+                covariance[a][b] += da * (static_cast<float>(block.texels[i][b]) - mean[b]);
+        }
+
+    uint32_t widest = 0;
+    for (uint32_t c = 1; c < channel_count; ++c)
+        if (covariance[c][c] > covariance[widest][widest])
+            widest = c;
+    float axis[4] = {};
+    for (uint32_t c = 0; c < channel_count; ++c)
+        axis[c] = covariance[c][widest];
+
+    for (uint32_t iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+        for (uint32_t a = 0; a < channel_count; ++a)
+        {
+            for (uint32_t b = 0; b < channel_count; ++b)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length == 0.0f)
+            break;
+        for (uint32_t a = 0; a < channel_count; ++a)
+            axis[a] = next[a] / length;
+    }
+
+    float lowest = 0.0f, highest = 0.0f;
+    float norm = 0.0f;
+    for (uint32_t c = 0; c < channel_count; ++c)
+        norm += axis[c] * axis[c];
+    if (norm > 0.0f)
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < channel_count; ++c)
+                t += (static_cast<float>(block.texels[i][c]) - mean[c]) * axis[c];
+            t /= norm;
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+        }
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        e0[c] = c < channel_count ? std::clamp(mean[c] + lowest * axis[c], 0.0f, 255.0f) : 255.0f;
+        e1[c] = c < channel_count ? std::clamp(mean[c] + highest * axis[c], 0.0f, 255.0f) : 255.0f;
+    }
+}
+
+// Least squares endpoints for texels interpolated at fixed weights, false when every weight is the same
+inline bool fit_endpoints(TextureBlock const &block, float const (&weights)[16], uint32_t channel_count, float (&e0)[4], float (&e1)[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        float b = weights[i], a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (uint32_t c = 0; c < channel_count; ++c)
+        {
+            ax[c] += a * static_cast<float>(block.texels[i][c]);
+            bx[c] += b * static_cast<float>(block.texels[i][c]);
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+        return false;
+    for (uint32_t c = 0; c < channel_count; ++c)
+    {
+        e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+//////////////////////////////// BC1 //////////////////////////////////////
+
+inline uint16_t pack_rgb565(float const (&color)[4])
+{
+    uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+    uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+    uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+inline void unpack_rgb565(uint16_t packed, int32_t (&color)[4])
+{
+    int32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+    color[3] = 255;
+}
+
+// Colors of the indices: 4 opaque ones when c0 > c1, else 3 & transparent black
+inline void get_bc1_palette(uint16_t c0, uint16_t c1, int32_t (&palette)[4][4])
+{
+    unpack_rgb565(c0, palette[0]);
+    unpack_rgb565(c1, palette[1]);
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        if (c0 > c1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+}
+
+// Opaque 4 color block of two endpoints, indices picked from the decoded palette, returns the squared error
+inline uint32_t pack_bc1_block(TextureBlock const &block, float const (&e0)[4], float const (&e1)[4], uint8_t *out, uint8_t (&indices)[16])
+{
+    uint16_t c0 = pack_rgb565(e0), c1 = pack_rgb565(e1);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    int32_t palette[4][4] = {};
+    get_bc1_palette(c0, c1, palette);
+    uint32_t error = 0;
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        // Equal endpoints are the 3 color mode, index 0 only
+        uint32_t best = 0, best_error = get_texel_error(block.texels[i], palette[0], 3);
+        for (uint32_t p = 1; p < 4 && c0 != c1; ++p)
+        {
+            uint32_t texel_error = get_texel_error(block.texels[i], palette[p], 3);
+            if (texel_error < best_error)
+            {
+                best = p;
+                best_error = texel_error;
+            }
+        }
+        indices[i] = static_cast<uint8_t>(best);
+        bits |= best << (2 * i);
+        error += best_error;
+    }
+
+    out[0] = static_cast<uint8_t>(c0);
+    out[1] = static_cast<uint8_t>(c0 >> 8);
+    out[2] = static_cast<uint8_t>(c1);
+    out[3] = static_cast<uint8_t>(c1 >> 8);
+    std::memcpy(out + 4, &bits, 4);
+    return error;
+}
+
+// 8 bytes to out
+inline void encode_bc1_block(TextureBlock const &block, uint8_t *out)
+{
+    float e0[4], e1[4];
+    get_principal_endpoints(block, 3, e0, e1);
+    uint8_t indices[16];
+    uint32_t error = pack_bc1_block(block, e0, e1, out, indices);
+
+    // Refit to the picked indices, endpoint order follows pack_bc1_block (c0 is the larger color)
+    uint16_t c0 = static_cast<uint16_t>(out[0] | (out[1] << 8)), c1 = static_cast<uint16_t>(out[2] | (out[3] << 8));
+    if (error == 0 || c0 == c1)
+        return;
+    static constexpr float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    float weights[16];
+    for (uint32_t i = 0; i < 16; ++i)
+        weights[i] = BC1_WEIGHTS[indices[i]];
+    if (fit_endpoints(block, weights, 3, e0, e1))
+    {
+        uint8_t refit[8];
+        if (pack_bc1_block(block, e0, e1, refit, indices) < error)
+            std::memcpy(out, refit, 8);
+    }
+}
+
+inline void decode_bc1_block(uint8_t const *in, TextureBlock &block)
+{
+    uint16_t c0 = static_cast<uint16_t>(in[0] | (in[1] << 8)), c1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+    int32_t palette[4][4] = {};
+    get_bc1_palette(c0, c1, palette);
+    uint32_t bits = 0;
+    std::memcpy(&bits, in + 4, 4);
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t c = 0; c < 4; ++c)
+            block.texels[i][c] = static_cast<uint8_t>(palette[(bits >> (2 * i)) & 3][c]);
+}
+
+//////////////////////////////// BC7 //////////////////////////////////////
+
+static constexpr int32_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Fields are packed from the lowest bit of byte 0
+inline void write_block_bits(uint8_t *block, uint32_t &offset, uint32_t count, uint32_t value)
+{
+    for (uint32_t i = 0; i < count; ++i, ++offset)
+        if ((value >> i) & 1)
+            block[offset >> 3] |= static_cast<uint8_t>(1u << (offset & 7));
+}
+
+inline uint32_t read_block_bits(uint8_t const *block, uint32_t &offset, uint32_t count)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; ++i, ++offset)
+        value |= static_cast<uint32_t>((block[offset >> 3] >> (offset & 7)) & 1) << i;
+    return value;
+}
+
+// Mode 6 endpoints: 7 bits per channel & a p-bit per endpoint shared by its channels
+struct Bc7Endpoints
+{
+    uint32_t values[2][4] = {}; // 7 bits
+    uint32_t p_bits[2] = {};
+
+    int32_t get(uint32_t endpoint, uint32_t channel) const { return static_cast<int32_t>((values[endpoint][channel] << 1) | p_bits[endpoint]); }
+};
+
+inline Bc7Endpoints quantize_bc7_endpoints(float const (&e0)[4], float const (&e1)[4], uint32_t p0, uint32_t p1)
+{
+    Bc7Endpoints endpoints = {.p_bits = {p0, p1}};
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        endpoints.values[0][c] = static_cast<uint32_t>(std::clamp(std::lround((e0[c] - static_cast<float>(p0)) * 0.5f), 0L, 127L));
+        endpoints.values[1][c] = static_cast<uint32_t>(std::clamp(std::lround((e1[c] - static_cast<float>(p1)) * 0.5f), 0L, 127L));
+    }
+    return endpoints;
+}
+
+inline void get_bc7_palette(Bc7Endpoints const &endpoints, int32_t (&palette)[16][4])
+{
+    for (uint32_t i = 0; i < 16; ++i)
+        for (uint32_t c = 0; c < 4; ++c)
+            palette[i][c] = ((64 - BC7_WEIGHTS_4[i]) * endpoints.get(0, c) + BC7_WEIGHTS_4[i] * endpoints.get(1, c) + 32) >> 6;
+}
+
+inline uint32_t get_bc7_indices(TextureBlock const &block, Bc7Endpoints const &endpoints, uint8_t (&indices)[16])
+{
+    int32_t palette[16][4] = {};
+    get_bc7_palette(endpoints, palette);
+    uint32_t error = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        uint32_t best = 0, best_error = get_texel_error(block.texels[i], palette[0], 4);
+        for (uint32_t p = 1; p < 16; ++p)
+        {
+            uint32_t texel_error = get_texel_error(block.texels[i], palette[p], 4);
+            if (texel_error < best_error)
+            {
+                best = p;
+                best_error = texel_error;
+            }
+        }
+        indices[i] = static_cast<uint8_t>(best);
+        error += best_error;
+    }
+    return error;
+}
+
+// Best p-bits for the endpoints, returns the squared error. Opaque blocks keep both p-bits set, only those endpoints
+// reach an alpha of 255
+inline uint32_t quantize_bc7_block(TextureBlock const &block, float const (&e0)[4], float const (&e1)[4], Bc7Endpoints &endpoints,
+                                   uint8_t (&indices)[16])
+{
+    bool opaque = true;
+    for (uint32_t i = 0; i < 16; ++i)
+        opaque = opaque && block.texels[i][3] == 255;
+
+    uint32_t best_error = std::numeric_limits<uint32_t>::max();
+    for (uint32_t p = opaque ? 3 : 0; p < 4; ++p)
+    {
+        Bc7Endpoints candidate = quantize_bc7_endpoints(e0, e1, p & 1, p >> 1);
+        uint8_t candidate_indices[16];
+        uint32_t error = get_bc7_indices(block, candidate, candidate_indices);
+        if (error < best_error)
+        {
+            best_error = error;
+            endpoints = candidate;
+            std::memcpy(indices, candidate_indices, 16);
+        }
+    }
+    return best_error;
+}
+
+// 16 bytes to out
+inline void encode_bc7_block(TextureBlock const &block, uint8_t *out)
+{
+    float e0[4], e1[4];
+    get_principal_endpoints(block, 4, e0, e1);
+    Bc7Endpoints endpoints = {};
+    uint8_t indices[16];
+    uint32_t error = quantize_bc7_block(block, e0, e1, endpoints, indices);
+
+    if (error > 0)
+    {
+        float weights[16];
+        for (uint32_t i = 0; i < 16; ++i)
+            weights[i] = static_cast<float>(BC7_WEIGHTS_4[indices[i]]) / 64.0f;
+        Bc7Endpoints refit = {};
+        uint8_t refit_indices[16];
+        if (fit_endpoints(block, weights, 4, e0, e1) && quantize_bc7_block(block, e0, e1, refit, refit_indices) < error)
+        {
+            endpoints = refit;
+            std::memcpy(indices, refit_indices, 16);
+        }
+    }
+
+    // The first index drops its top bit, swapping the endpoints clears it
+    if (indices[0] & 8)
+    {
+        std::swap(endpoints.values[0], endpoints.values[1]);
+        std::swap(endpoints.p_bits[0], endpoints.p_bits[1]);
+        for (uint8_t &index : indices)
+            index = static_cast<uint8_t>(15 - index);
+    }
+
+    std::memset(out, 0, 16);
+    uint32_t offset = 0;
+    write_block_bits(out, offset, 7, 1u << 6);
+    for (uint32_t c = 0; c < 4; ++c)
+        for (uint32_t e = 0; e < 2; ++e)
+            write_block_bits(out, offset, 7, endpoints.values[e][c]);
+    write_block_bits(out, offset, 1, endpoints.p_bits[0]);
+    write_block_bits(out, offset, 1, endpoints.p_bits[1]);
+    for (uint32_t i = 0; i < 16; ++i)
+        write_block_bits(out, offset, i == 0 ? 3 : 4, indices[i]);
+}
+
+// Mode 6 blocks only, the ones encode_bc7_block writes
+inline bool decode_bc7_block(uint8_t const *in, TextureBlock &block)
+{
+    if ((in[0] & 0x7F) != (1u << 6))
+        return false;
+
+    uint32_t offset = 7;
+    Bc7Endpoints endpoints = {};
+    for (uint32_t c = 0; c < 4; ++c)
+        for (uint32_t e = 0; e < 2; ++e)
+            endpoints.values[e][c] = read_block_bits(in, offset, 7);
+    endpoints.p_bits[0] = read_block_bits(in, offset, 1);
+    endpoints.p_bits[1] = read_block_bits(in, offset, 1);
+
+    int32_t palette[16][4] = {};
+    get_bc7_palette(endpoints, palette);
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        uint32_t index = read_block_bits(in, offset, i == 0 ? 3 : 4);
+        for (uint32_t c = 0; c < 4; ++c)
+            block.texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+    }
+    return true;
+}
+
+//////////////////////////////// ARRAY //////////////////////////////////////
+
+struct TextureArraySettings
+{
+    TextureFormat format = TextureFormat::BC7;
+    uint32_t layer_size = 256; // width & height of every layer, power of two
+    uint32_t max_mip_count = 0; // 0 for the whole chain
+};
+
+inline bool operator==(TextureArraySettings const &a, TextureArraySettings const &b)
+{
+    return a.format == b.format && a.layer_size == b.layer_size && a.max_mip_count == b.max_mip_count;
+}
+
+inline uint32_t get_texture_array_mip_count(TextureArraySettings const &settings)
+{
+    uint32_t mip_count = get_mip_count(settings.layer_size, settings.layer_size);
+    return settings.max_mip_count > 0 ? std::min(mip_count, settings.max_mip_count) : mip_count;
+}
+
+// Levels hold every layer back to back
+struct TextureArray
+{
+    TextureArraySettings settings = {};
+    uint32_t layer_count = 0;
+    uint32_t mip_count = 0;
+    std::vector<std::vector<uint8_t>> levels = {};
+
+    auto get_level_size(uint32_t level) const -> uint32_t { return std::max(1U, settings.layer_size >> level); }
+
+    auto get_layer_bytes(uint32_t level) const -> size_t
+    {
+        uint32_t size = get_level_size(level);
+        return get_texture_level_bytes(settings.format, size, size);
+    }
+
+    auto get_layer_data(uint32_t level, uint32_t layer) const -> uint8_t const * { return levels[level].data() + get_layer_bytes(level) * layer; }
+
+    auto get_byte_count() const -> size_t
+    {
+        size_t byte_count = 0;
+        for (auto const &level : levels)
+            byte_count += level.size();
+        return byte_count;
+    }
+
+    auto get_texel_count() const -> size_t
+    {
+        size_t texel_count = 0;
+        for (uint32_t level = 0; level < mip_count; ++level)
+            texel_count += static_cast<size_t>(get_level_size(level)) * get_level_size(level) * layer_count;
+        return texel_count;
+    }
+
+    // RGBA8 texels of a level of a layer, what the sampler reads
+    bool decode(uint32_t level, uint32_t layer, TextureImage &image) const
+    {
+        uint32_t size = get_level_size(level);
+        image = TextureImage(size, size);
+        uint8_t const *data = get_layer_data(level, layer);
+        if (settings.format == TextureFormat::RGBA8)
+        {
+            std::memcpy(image.texels.data(), data, image.texels.size());
+            return true;
+        }
+
+        uint32_t block_count = (size + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+        size_t block_bytes = settings.format == TextureFormat::BC1 ? 8 : 16;
+        for (uint32_t block_y = 0; block_y < block_count; ++block_y)
+            for (uint32_t block_x = 0; block_x < block_count; ++block_x)
+            {
+                TextureBlock block = {};
+                uint8_t const *in = data + (static_cast<size_t>(block_y) * block_count + block_x) * block_bytes;
+                if (settings.format == TextureFormat::BC1)
+                    decode_bc1_block(in, block);
+                else if (!decode_bc7_block(in, block))
+                    return false;
+                store_texture_block(block, block_x, block_y, image);
+            }
+        return true;
+    }
+};
+
+inline bool is_valid_texture_array(std::vector<TextureImage> const &images, TextureArraySettings const &settings)
+{
+    if (images.empty() || images.size() > MAX_TEXTURES || !std::has_single_bit(settings.layer_size))
+    {
+#if WARN
+        std::cerr << "build_texture_array: 1 to " << MAX_TEXTURES << " images & a power of two layer size" << std::endl;
+#endif // WARN
+        return false;
+    }
+    for (TextureImage const &image : images)
+        if (image.width == 0 || image.height == 0 || image.texels.size() != static_cast<size_t>(image.width) * image.height * 4)
+        {
+#if WARN
+            std::cerr << "build_texture_array: empty or malformed image" << std::endl;
+#endif // WARN
+            return false;
+        }
+    return true;
+}
+
+// Resamples, builds the mips & encodes every block with the pool
+inline bool build_texture_array(std::vector<TextureImage> const &images, TextureArraySettings const &settings, TextureArray &array, TilePool &pool)
+{
+    if (!is_valid_texture_array(images, settings))
+        return false;
+
+    uint32_t size = settings.layer_size;
+    uint32_t mip_count = get_texture_array_mip_count(settings);
+
+    std::vector<std::vector<TextureImage>> layer_levels(images.size());
+    for (size_t layer = 0; layer < images.size(); ++layer)
+        layer_levels[layer] = build_mip_chain(resample_linear_image(get_linear_image(images[layer]), size, size, pool), mip_count, pool);
+
+    array.settings = settings;
+    array.layer_count = static_cast<uint32_t>(images.size());
+    array.mip_count = mip_count;
+    array.levels.assign(mip_count, {});
+    for (uint32_t level = 0; level < mip_count; ++level)
+    {
+        size_t layer_bytes = array.get_layer_bytes(level);
+        array.levels[level].assign(layer_bytes * array.layer_count, 0);
+        uint32_t block_count = (array.get_level_size(level) + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+
+        // One job per row of blocks of a layer
+        pool.run(array.layer_count * block_count, [&](uint32_t job, uint32_t)
+                 {
+            uint32_t layer = job / block_count, block_y = job % block_count;
+            TextureImage const &image = layer_levels[layer][level];
+            uint8_t *out = array.levels[level].data() + layer_bytes * layer;
+            switch (settings.format)
+            {
+            case TextureFormat::BC1:
+                for (uint32_t block_x = 0; block_x < block_count; ++block_x)
+                    encode_bc1_block(load_texture_block(image, block_x, block_y), out + (static_cast<size_t>(block_y) * block_count + block_x) * 8);
+                break;
+            case TextureFormat::BC7:
+                for (uint32_t block_x = 0; block_x < block_count; ++block_x)
+                    encode_bc7_block(load_texture_block(image, block_x, block_y), out + (static_cast<size_t>(block_y) * block_count + block_x) * 16);
+                break;
+            default:
+                for (uint32_t y = block_y * TEXTURE_BLOCK_SIZE; y < std::min(image.height, (block_y + 1) * TEXTURE_BLOCK_SIZE); ++y)
+                    std::memcpy(out + static_cast<size_t>(y) * image.width * 4, image.texel(0, y), static_cast<size_t>(image.width) * 4);
+                break;
+            } });
+    }
+    return true;
+}
+
+//////////////////////////////// CACHE //////////////////////////////////////
+
+static constexpr uint32_t TEXTURE_ARRAY_MAGIC = 0x58545443; // "CTTX"
+static constexpr uint32_t TEXTURE_ARRAY_VERSION = 2;
+
+// FNV-1a of the settings & of every image, texels 8 bytes at a time
+inline uint64_t get_texture_array_key(std::vector<TextureImage> const &images, TextureArraySettings const &settings)
+{
+    uint64_t key = 14695981039346656037ull;
+    auto add = [&](uint64_t value)
+    {
+        key ^= value;
+        key *= 1099511628211ull;
+    };
+    add(TEXTURE_ARRAY_VERSION);
+    add(static_cast<uint64_t>(settings.format));
+    add(settings.layer_size);
+    add(settings.max_mip_count);
+    for (TextureImage const &image : images)
+    {
+        add((static_cast<uint64_t>(image.width) << 32) | image.height);
+        size_t i = 0;
+        for (; i + 8 <= image.texels.size(); i += 8)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, image.texels.data() + i, 8);
+            add(word);
+        }
+        for (; i < image.texels.size(); ++i)
+            add(image.texels[i]);
+    }
+    return key;
+}
+
+inline std::filesystem::path get_texture_array_path(std::filesystem::path const &cache_dir, uint64_t key)
+{
+    char name[40];
+    std::snprintf(name, sizeof(name), "textures_%016llx.bin", static_cast<unsigned long long>(key));
+    return cache_dir / name;
+}
+
+inline bool write_texture_array(std::filesystem::path const &path, TextureArray const &array, uint64_t key)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+#if WARN
+        std::cerr << "write_texture_array: could not open " << path.string() << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    uint32_t const header[] = {TEXTURE_ARRAY_MAGIC, TEXTURE_ARRAY_VERSION, static_cast<uint32_t>(array.settings.format), array.settings.layer_size,
+                               array.settings.max_mip_count, array.layer_count, array.mip_count, static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)};
+    file.write(reinterpret_cast<char const *>(header), sizeof(header));
+    for (auto const &level : array.levels)
+        file.write(reinterpret_cast<char const *>(level.data()), level.size());
+    return file.good();
+}
+
+// Fails on other settings or images (hash collisions, stale files) or truncated files
+inline bool read_texture_array(std::filesystem::path const &path, TextureArraySettings const &settings, uint64_t key, TextureArray &array)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint32_t header[9] = {};
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!file.good() || header[0] != TEXTURE_ARRAY_MAGIC || header[1] != TEXTURE_ARRAY_VERSION)
+        return false;
+
+    TextureArraySettings stored = {.format = static_cast<TextureFormat>(header[2]), .layer_size = header[3], .max_mip_count = header[4]};
+    uint64_t stored_key = header[7] | (static_cast<uint64_t>(header[8]) << 32);
+    if (!(stored == settings) || stored_key != key || header[5] == 0 || header[5] > MAX_TEXTURES ||
+        header[6] != get_texture_array_mip_count(settings))
+    {
+#if WARN
+        std::cerr << "read_texture_array: " << path.string() << " holds other textures" << std::endl;
+#endif // WARN
+        return false;
+    }
+
+    array.settings = settings;
+    array.layer_count = header[5];
+    array.mip_count = header[6];
+    array.levels.assign(array.mip_count, {});
+    for (uint32_t level = 0; level < array.mip_count; ++level)
+    {
+        array.levels[level].resize(array.get_layer_bytes(level) * array.layer_count);
+        file.read(reinterpret_cast<char *>(array.levels[level].data()), array.levels[level].size());
+    }
+    if (!file.good())
+    {
+#if WARN
+        std::cerr << "read_texture_array: " << path.string() << " is truncated" << std::endl;
+#endif // WARN
+        array.levels.clear();
+        return false;
+    }
+    return true;
+}
+
+// Cached array of the images, built & written to the cache when missing, from_cache tells which
+inline bool load_or_build_texture_array(std::filesystem::path const &cache_dir, std::vector<TextureImage> const &images,
+                                        TextureArraySettings const &settings, TextureArray &array, TilePool &pool, bool *from_cache = nullptr)
+{
+    if (from_cache)
+        *from_cache = false;
+    if (!is_valid_texture_array(images, settings))
+        return false;
+
+    uint64_t key = get_texture_array_key(images, settings);
+    std::filesystem::path path = get_texture_array_path(cache_dir, key);
+    if (std::filesystem::exists(path) && read_texture_array(path, settings, key, array) && array.layer_count == images.size())
+    {
+        if (from_cache)
+            *from_cache = true;
+        return true;
+    }
+
+    if (!build_texture_array(images, settings, array, pool))
+        return false;
+
+    // An array that can't be cached is still good
+    std::error_code error = {};
+    std::filesystem::create_directories(cache_dir, error);
+    if (error || !write_texture_array(path, array, key))
+    {
+#if WARN
+        std::cerr << "load_or_build_texture_array: could not cache " << path.string() << std::endl;
+#endif // WARN
+    }
+    return true;
+}
@@ -0,0 +1,330 @@
+#pragma once
+#include "defines.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Work stealing job system for work split in tiles (image tiles, bands of rows, BLAS builds...).
+// Workers are started once and sleep between jobs. A job is task(tile_index, thread_index) over tile_count tiles; once
+// its dependencies are done its tiles are dealt in contiguous ranges to one deque per thread. A thread pops tiles from
+// the front of its own deque and, once it runs dry, steals the back half of a range from the others, so uneven tiles
+// balance out while neighbouring tiles (see get_morton_tile_order) mostly stay on one thread.
+// The thread waiting on a job runs tiles as thread 0 (wait & run can be called from inside a task, the waiting thread
+// keeps running tiles of any job meanwhile). One outside thread drives the pool at a time.
+struct TilePool;
+
+//////////////////////////////// JOBS //////////////////////////////////////
+
+struct TilePoolJob
+{
+    std::function<void(uint32_t, uint32_t)> task = {};
+    uint32_t tile_count = 0;
+    std::atomic<uint32_t> remaining_tiles = 0;
+    uint32_t pending_dependencies = 0;                  // guarded by the pool
+    std::vector<std::shared_ptr<TilePoolJob>> dependents = {}; // guarded by the pool
+    std::atomic<bool> done = false;
+};
+
+// Handle of a submitted job, empty handles count as done
+struct TileJob
+{
+    std::shared_ptr<TilePoolJob> state = nullptr;
+
+    bool is_done() const { return !state || state->done.load(std::memory_order_acquire); }
+};
+
+//////////////////////////////// MORTON ORDER //////////////////////////////////////
+
+inline uint32_t morton_spread_bits(uint32_t v)
+{
+    v &= 0x0000ffffU;
+    v = (v | (v << 8U)) & 0x00ff00ffU;
+    v = (v | (v << 4U)) & 0x0f0f0f0fU;
+    v = (v | (v << 2U)) & 0x33333333U;
+    v = (v | (v << 1U)) & 0x55555555U;
+    return v;
+}
+
+inline uint32_t morton_compact_bits(uint32_t v)
+{
+    v &= 0x55555555U;
+    v = (v | (v >> 1U)) & 0x33333333U;
+    v = (v | (v >> 2U)) & 0x0f0f0f0fU;
+    v = (v | (v >> 4U)) & 0x00ff00ffU;
+    v = (v | (v >> 8U)) & 0x0000ffffU;
+    return v;
+}
+
+// x & y below 2^16
+inline uint32_t morton_encode(uint32_t x, uint32_t y) { return morton_spread_bits(x) | (morton_spread_bits(y) << 1U); }
+
+inline void morton_decode(uint32_t code, uint32_t &x, uint32_t &y)
+{
+    x = morton_compact_bits(code);
+    y = morton_compact_bits(code >> 1U);
+}
+
+// Row major tile indices of a tiles_x x tiles_y grid in Morton order (grids that aren't powers of two skip the codes
+// outside), consecutive tiles are square blocks of the image instead of rows
+inline std::vector<uint32_t> get_morton_tile_order(uint32_t tiles_x, uint32_t tiles_y)
+{
+    std::vector<uint32_t> order(static_cast<size_t>(tiles_x) * tiles_y);
+    for (uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [tiles_x](uint32_t a, uint32_t b)
+              { return morton_encode(a % tiles_x, a / tiles_x) < morton_encode(b % tiles_x, b / tiles_x); });
+    return order;
+}
+
+//////////////////////////////// POOL //////////////////////////////////////
+
+struct TilePool
+{
+public:
+    TilePool(uint32_t thread_count = 0)
+    {
+        if (thread_count == 0)
+            thread_count = std::max(1U, std::thread::hardware_concurrency());
+        queues = std::vector<TileQueue>(thread_count);
+
+        // The waiting thread works as thread 0
+        workers.reserve(thread_count - 1);
+        for (uint32_t thread_index = 1; thread_index < thread_count; ++thread_index)
+        {
+            workers.emplace_back([this, thread_index](std::stop_token stop_token)
+                                 { worker_loop(stop_token, thread_index); });
+        }
+    }
+
+    ~TilePool()
+    {
+        {
+            auto lock = std::lock_guard{wake_mutex};
+            for (auto &worker : workers)
+                worker.request_stop();
+        }
+        wake_cv.notify_all();
+    }
+
+    TilePool(TilePool const &) = delete;
+    TilePool &operator=(TilePool const &) = delete;
+
+    auto get_thread_count() const -> uint32_t { return static_cast<uint32_t>(queues.size()); }
+
+    // Queue task(tile_index, thread_index) for every tile, it starts once every dependency is done
+    auto submit(uint32_t tile_count, std::function<void(uint32_t, uint32_t)> task, std::vector<TileJob> const &dependencies = {}) -> TileJob
+    {
+        auto job = std::make_shared<TilePoolJob>();
+        job->task = std::move(task);
+        job->tile_count = tile_count;
+        job->remaining_tiles = tile_count;
+
+        {
+            auto lock = std::lock_guard{wake_mutex};
+            for (auto const &dependency : dependencies)
+            {
+                if (dependency.is_done())
+                    continue;
+                dependency.state->dependents.push_back(job);
+                ++job->pending_dependencies;
+            }
+            if (job->pending_dependencies == 0)
+                make_ready(job);
+        }
+        wake_cv.notify_all();
+
+        return TileJob{job};
+    }
+
+    // Runs tiles of any job until this one is done
+    void wait(TileJob const &job)
+    {
+        uint32_t thread_index = get_current_thread_index();
+        while (!job.is_done())
+        {
+            if (run_one(thread_index))
+                continue;
+
+            auto lock = std::unique_lock{wake_mutex};
+            wake_cv.wait(lock, [&]
+                         { return job.is_done() || queued_tile_count.load(std::memory_order_acquire) > 0; });
+        }
+    }
+
+    // Run task(tile_index, thread_index) for every tile, returns once all of them are done
+    void run(uint32_t tile_count, std::function<void(uint32_t, uint32_t)> const &task)
+    {
+        steal_count = 0;
+        wait(submit(tile_count, task));
+    }
+
+    // Ranges taken from another thread's deque since the last run
+    auto get_steal_count() const -> uint32_t { return steal_count; }
+
+private:
+    // Tiles [first, end) of a job
+    struct TileRange
+    {
+        TilePoolJob *job = nullptr;
+        uint32_t first = 0;
+        uint32_t end = 0;
+    };
+
+    struct TileQueue
+    {
+        std::mutex mutex = {};
+        std::deque<TileRange> ranges = {};
+    };
+
+    // Pool & index of the worker running on this thread, threads of no pool are thread 0
+    static auto get_current_worker() -> std::pair<TilePool const *, uint32_t> &
+    {
+        thread_local std::pair<TilePool const *, uint32_t> worker = {nullptr, 0};
+        return worker;
+    }
+
+    auto get_current_thread_index() const -> uint32_t
+    {
+        auto const &[pool, thread_index] = get_current_worker();
+        return pool == this ? thread_index : 0;
+    }
+
+    void worker_loop(std::stop_token stop_token, uint32_t thread_index)
+    {
+        get_current_worker() = {this, thread_index};
+        while (!stop_token.stop_requested())
+        {
+            if (run_one(thread_index))
+                continue;
+
+            auto lock = std::unique_lock{wake_mutex};
+            wake_cv.wait(lock, [&]
+                         { return stop_token.stop_requested() || queued_tile_count.load(std::memory_order_acquire) > 0; });
+        }
+    }
+
+    // Pops or steals one tile and runs it, false when every deque is empty
+    bool run_one(uint32_t thread_index)
+    {
+        TilePoolJob *job = nullptr;
+        uint32_t tile = 0;
+        if (!pop(thread_index, job, tile) && !steal(thread_index, job, tile))
+            return false;
+
+        job->task(tile, thread_index);
+        if (job->remaining_tiles.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            {
+                auto lock = std::lock_guard{wake_mutex};
+                finish(job);
+            }
+            wake_cv.notify_all();
+        }
+        return true;
+    }
+
+    bool pop(uint32_t thread_index, TilePoolJob *&job, uint32_t &tile)
+    {
+        auto &queue = queues[thread_index];
+        auto lock = std::lock_guard{queue.mutex};
+        if (queue.ranges.empty())
+            return false;
+        TileRange &range = queue.ranges.front();
+        job = range.job;
+        tile = range.first++;
+        if (range.first == range.end)
+            queue.ranges.pop_front();
+        queued_tile_count.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    // Takes the back half of the last range of the first deque that has one, the thief keeps the rest in its own
+    bool steal(uint32_t thread_index, TilePoolJob *&job, uint32_t &tile)
+    {
+        uint32_t thread_count = get_thread_count();
+        for (uint32_t i = 1; i < thread_count; ++i)
+        {
+            TileRange stolen = {};
+            {
+                auto &victim = queues[(thread_index + i) % thread_count];
+                auto lock = std::lock_guard{victim.mutex};
+                if (victim.ranges.empty())
+                    continue;
+                TileRange &range = victim.ranges.back();
+                uint32_t middle = range.first + (range.end - range.first) / 2;
+                stolen = TileRange{range.job, middle, range.end};
+                range.end = middle;
+                if (range.first == range.end)
+                    victim.ranges.pop_back();
+            }
+            ++steal_count;
+
+            job = stolen.job;
+            tile = stolen.first++;
+            queued_tile_count.fetch_sub(1, std::memory_order_acq_rel);
+            if (stolen.first < stolen.end)
+            {
+                auto &queue = queues[thread_index];
+                auto lock = std::lock_guard{queue.mutex};
+                queue.ranges.push_front(stolen);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Deals the tiles of a job whose dependencies are done, wake_mutex held
+    void make_ready(std::shared_ptr<TilePoolJob> const &job)
+    {
+        if (job->tile_count == 0)
+        {
+            finish(job.get());
+            return;
+        }
+
+        // Keeps the job alive until its last tile is done, dependents hold the ones that aren't ready
+        running_jobs.push_back(job);
+
+        uint32_t thread_count = get_thread_count();
+        uint32_t range_count = std::min(thread_count, job->tile_count);
+        for (uint32_t r = 0; r < range_count; ++r)
+        {
+            uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(job->tile_count) * r / range_count);
+            uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(job->tile_count) * (r + 1) / range_count);
+            auto &queue = queues[r];
+            auto lock = std::lock_guard{queue.mutex};
+            queue.ranges.push_back(TileRange{job.get(), first, end});
+        }
+        queued_tile_count.fetch_add(job->tile_count, std::memory_order_acq_rel);
+    }
+
+    // Flags a job done & readies the dependents it was the last dependency of, wake_mutex held
+    void finish(TilePoolJob *job)
+    {
+        std::vector<std::shared_ptr<TilePoolJob>> dependents = std::move(job->dependents);
+        job->dependents.clear();
+        job->done.store(true, std::memory_order_release);
+        std::erase_if(running_jobs, [job](auto const &running)
+                      { return running.get() == job; });
+
+        for (auto const &dependent : dependents)
+            if (--dependent->pending_dependencies == 0)
+                make_ready(dependent);
+    }
+
+    std::vector<TileQueue> queues = {};
+    std::atomic<uint64_t> queued_tile_count = 0; // raised with wake_mutex held so sleepers don't miss work
+
+    std::mutex wake_mutex = {};
+    std::condition_variable wake_cv = {};
+    std::vector<std::shared_ptr<TilePoolJob>> running_jobs = {};
+
+    std::atomic<uint32_t> steal_count = 0;
+    std::vector<std::jthread> workers = {};
+};
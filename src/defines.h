@@ -1,10 +1,29 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
+#include <mutex>
 
+// Tools without a window (benchmarks & reference tools) build with HEADLESS_ON=1: only the shader type declarations
+// of daxa.inl & task_graph.inl (through shared.inl) are used, not the daxa API (no Vulkan device, no GLFW)
+#ifndef HEADLESS_ON
+#define HEADLESS_ON 0
+#endif
+
+#if HEADLESS_ON == 0
 #include <daxa/daxa.hpp>
 #include <daxa/utils/task_graph.hpp>
 #include <window.hpp>
+#else
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#endif // HEADLESS_ON
 #include <shared.hpp>
 
 #include <glm/glm.hpp>
@@ -30,6 +49,36 @@
 #define TRACE 0
 #endif
 
+// Parse the map on a background thread and build it region by region
+#define STREAMING_MAP_ON 0
+
+// Frame profiler: named CPU scopes & GPU timestamp pairs around the passes, rolling statistics & Chrome trace export
+// (cpu/frame_profiler.hpp). CMake builds define both from their PROFILER & PROFILER_OVERLAY options
+#ifndef PROFILER_ON
+#define PROFILER_ON 0
+#endif // PROFILER_ON
+// ImGui overlay of the statistics (daxa utils-imgui), without it P prints them
+#ifndef PROFILER_OVERLAY_ON
+#define PROFILER_OVERLAY_ON 1
+#endif // PROFILER_OVERLAY_ON
+#define PROFILER_HISTORY_FRAMES 512      // frames of the rolling statistics
+#define PROFILER_GPU_FRAMES 3            // timestamp query sets, more than the frames in flight
+#define PROFILER_MAX_GPU_SCOPES 16       // timestamp pairs per frame
+#define PROFILER_MAX_TRACE_EVENTS 65536  // newest events kept for the Chrome trace
+
+// Pipelines created from SPIR-V cached on disk under a hash of the sources, defines & compiler, misses compiled in
+// parallel at startup, without hot reload (cpu/shader_cache.hpp). Off: the pipeline manager compiles & reloads them
+#define SHADER_CACHE_ON 0
+#define SHADER_CACHE_DIR "build/shader_cache"
+#define SHADER_CACHE_GLSL_COMPILER "glslangValidator" // on the PATH, or a full path
+#define SHADER_CACHE_SLANG_COMPILER "slangc"
+// Pipelines created from the shader pack of the shaders target (tools/shader_precompile.cpp, cpu/shader_pack.hpp),
+// nothing is compiled at startup. Tried before the shader cache, both off is the development mode with hot reload
+#define SHADER_PACK_ON 0
+#ifndef SHADER_PACK_PATH
+#define SHADER_PACK_PATH "build/shaders.bin" // CMake builds define the output of their shaders target
+#endif // SHADER_PACK_PATH
+
 
 const uint32_t DOUBLE_BUFFERING = 2;
 
@@ -113,6 +162,7 @@ struct GvoxModelData {
     uint32_t primitive_count;
     uint32_t material_count;
     uint32_t light_count;
+    uint32_t voxel_count;
 };
 
 enum AXIS_DIRECTION {
@@ -125,6 +175,8 @@ enum AXIS_DIRECTION {
 };
 
 
+struct GvoxRegionQueue;
+
 struct GvoxModelDataSerialize {
     AXIS_DIRECTION axis_direction;
     uint32_t max_instance_count;
@@ -140,9 +192,15 @@ struct GvoxModelDataSerialize {
     uint32_t current_light_index;
     uint32_t max_light_count;
     LIGHT* const lights;
+    // Greedy merge of same-material, non-emissive voxels into larger boxes (see box_merger.hpp)
+    bool merge_boxes = false;
+    // Streaming: every region is written into its own chunk and pushed here instead of the arrays above
+    GvoxRegionQueue* region_queue = nullptr;
 };
 
 struct GvoxModelDataSerializeInternal {
   GvoxModelData& scene_info;
   GvoxModelDataSerialize& params;
+  // Regions of the same model may be received in parallel
+  std::mutex region_mutex = {};
 };
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+#include "defines.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Greedy merging of adjacent voxels sharing a material into larger boxes.
+// Voxels are added in grid coordinates (already permuted by the axis direction),
+// then merged by extending runs along X, rows along Y and slabs along Z.
+// Emissive voxels must not be added: lights are sampled per voxel (LIGHT.size = VOXEL_EXTENT).
+// No voxel to box table is kept: boxes don't overlap & cover whole voxels, so a box's voxels are found again from its
+// AABB (split_aabb) when a brush splits it, and the voxel under a brush hit from the hit position (get_voxel_index).
+
+struct BoxMergeStats
+{
+    uint64_t voxel_count = 0;
+    uint64_t box_count = 0;
+};
+
+struct BoxMerger
+{
+public:
+    struct MergedBox
+    {
+        daxa_i32vec3 min;
+        daxa_u32vec3 extent;
+        uint32_t material_index;
+    };
+
+    void add_voxel(int32_t x, int32_t y, int32_t z, uint32_t material_index)
+    {
+        voxels.push_back({x, y, z, material_index});
+    }
+
+    bool empty() const { return voxels.empty(); }
+
+    // Merge every added voxel into boxes. Box order is deterministic (z, y, x scan order).
+    auto merge(std::vector<MergedBox> &boxes) -> BoxMergeStats
+    {
+        BoxMergeStats stats = {};
+        if (voxels.empty())
+            return stats;
+
+        daxa_i32vec3 grid_min = {voxels[0].x, voxels[0].y, voxels[0].z};
+        daxa_i32vec3 grid_max = grid_min;
+        for (auto const &v : voxels)
+        {
+            grid_min = {std::min(grid_min.x, v.x), std::min(grid_min.y, v.y), std::min(grid_min.z, v.z)};
+            grid_max = {std::max(grid_max.x, v.x), std::max(grid_max.y, v.y), std::max(grid_max.z, v.z)};
+        }
+
+        uint32_t size_x = grid_max.x - grid_min.x + 1;
+        uint32_t size_y = grid_max.y - grid_min.y + 1;
+        uint32_t size_z = grid_max.z - grid_min.z + 1;
+
+        auto cell = [&](uint32_t x, uint32_t y, uint32_t z) -> size_t
+        {
+            return (static_cast<size_t>(z) * size_y + y) * size_x + x;
+        };
+
+        // 0 means empty or already merged, otherwise material index + 1
+        std::vector<uint32_t> grid(static_cast<size_t>(size_x) * size_y * size_z, 0);
+        for (auto const &v : voxels)
+        {
+            grid[cell(v.x - grid_min.x, v.y - grid_min.y, v.z - grid_min.z)] = v.material_index + 1;
+        }
+        stats.voxel_count = voxels.size();
+
+        size_t first_box = boxes.size();
+
+        for (uint32_t z = 0; z < size_z; ++z)
+        {
+            for (uint32_t y = 0; y < size_y; ++y)
+            {
+                for (uint32_t x = 0; x < size_x; ++x)
+                {
+                    uint32_t value = grid[cell(x, y, z)];
+                    if (value == 0)
+                        continue;
+
+                    // Extend run along X
+                    uint32_t end_x = x + 1;
+                    while (end_x < size_x && grid[cell(end_x, y, z)] == value)
+                        ++end_x;
+
+                    // Extend rows along Y
+                    uint32_t end_y = y + 1;
+                    while (end_y < size_y && is_run(grid, cell(x, end_y, z), end_x - x, value))
+                        ++end_y;
+
+                    // Extend slabs along Z
+                    uint32_t end_z = z + 1;
+                    while (end_z < size_z)
+                    {
+                        bool slab = true;
+                        for (uint32_t j = y; j < end_y && slab; ++j)
+                            slab = is_run(grid, cell(x, j, end_z), end_x - x, value);
+                        if (!slab)
+                            break;
+                        ++end_z;
+                    }
+
+                    for (uint32_t k = z; k < end_z; ++k)
+                        for (uint32_t j = y; j < end_y; ++j)
+                            for (uint32_t i = x; i < end_x; ++i)
+                                grid[cell(i, j, k)] = 0;
+
+                    boxes.push_back(MergedBox{
+                        .min = {grid_min.x + static_cast<int32_t>(x), grid_min.y + static_cast<int32_t>(y), grid_min.z + static_cast<int32_t>(z)},
+                        .extent = {end_x - x, end_y - y, end_z - z},
+                        .material_index = value - 1,
+                    });
+                }
+            }
+        }
+
+        stats.box_count = boxes.size() - first_box;
+        voxels.clear();
+
+        return stats;
+    }
+
+    static auto box_to_aabb(MergedBox const &box) -> AABB
+    {
+        return AABB{
+            .minimum = {box.min.x * VOXEL_EXTENT,
+                        box.min.y * VOXEL_EXTENT,
+                        box.min.z * VOXEL_EXTENT},
+            .maximum = {(box.min.x + static_cast<int32_t>(box.extent.x)) * VOXEL_EXTENT,
+                        (box.min.y + static_cast<int32_t>(box.extent.y)) * VOXEL_EXTENT,
+                        (box.min.z + static_cast<int32_t>(box.extent.z)) * VOXEL_EXTENT},
+        };
+    }
+
+    // Number of voxels covered by an AABB along each axis (1 for regular voxels)
+    static auto aabb_voxel_extent(AABB const &aabb) -> daxa_u32vec3
+    {
+        return {static_cast<uint32_t>((aabb.maximum.x - aabb.minimum.x) / VOXEL_EXTENT + 0.5f),
+                static_cast<uint32_t>((aabb.maximum.y - aabb.minimum.y) / VOXEL_EXTENT + 0.5f),
+                static_cast<uint32_t>((aabb.maximum.z - aabb.minimum.z) / VOXEL_EXTENT + 0.5f)};
+    }
+
+    static bool is_merged_aabb(AABB const &aabb)
+    {
+        daxa_u32vec3 extent = aabb_voxel_extent(aabb);
+        return extent.x > 1 || extent.y > 1 || extent.z > 1;
+    }
+
+    // Split a merged AABB back into its constituent voxel AABBs
+    static auto split_aabb(AABB const &aabb, AABB *voxel_aabbs) -> uint32_t
+    {
+        daxa_u32vec3 extent = aabb_voxel_extent(aabb);
+        uint32_t count = 0;
+        for (uint32_t z = 0; z < extent.z; ++z)
+            for (uint32_t y = 0; y < extent.y; ++y)
+                for (uint32_t x = 0; x < extent.x; ++x)
+                {
+                    daxa_f32vec3 minimum = {aabb.minimum.x + x * VOXEL_EXTENT,
+                                            aabb.minimum.y + y * VOXEL_EXTENT,
+                                            aabb.minimum.z + z * VOXEL_EXTENT};
+                    voxel_aabbs[count++] = AABB{
+                        .minimum = minimum,
+                        .maximum = {minimum.x + VOXEL_EXTENT, minimum.y + VOXEL_EXTENT, minimum.z + VOXEL_EXTENT},
+                    };
+                }
+        return count;
+    }
+
+    // Voxel of a merged AABB under a point of its surface (object space), in split_aabb order. The point is clamped into
+    // the box, so a point on a face picks the voxel behind it.
+    static auto get_voxel_index(AABB const &aabb, daxa_f32vec3 point) -> uint32_t
+    {
+        daxa_u32vec3 extent = aabb_voxel_extent(aabb);
+        auto get_cell = [](float offset, uint32_t count) -> uint32_t
+        {
+            float cell = std::floor(offset / VOXEL_EXTENT);
+            return static_cast<uint32_t>(std::clamp(cell, 0.0f, static_cast<float>(count - 1)));
+        };
+        uint32_t x = get_cell(point.x - aabb.minimum.x, extent.x);
+        uint32_t y = get_cell(point.y - aabb.minimum.y, extent.y);
+        uint32_t z = get_cell(point.z - aabb.minimum.z, extent.z);
+        return (z * extent.y + y) * extent.x + x;
+    }
+
+    // Primitive of a voxel of a split box, relative to the instance: the first voxel keeps the slot of the box & the
+    // others are appended after the primitives of the instance, from first_appended_id (split_aabb_device_buffer)
+    static auto get_split_voxel_id(uint32_t box_id, uint32_t first_appended_id, uint32_t voxel_index) -> uint32_t
+    {
+        return voxel_index == 0 ? box_id : first_appended_id + voxel_index - 1;
+    }
+
+    static auto aabb_voxel_count(AABB const &aabb) -> uint32_t
+    {
+        daxa_u32vec3 extent = aabb_voxel_extent(aabb);
+        return extent.x * extent.y * extent.z;
+    }
+
+private:
+    struct Voxel
+    {
+        int32_t x, y, z;
+        uint32_t material_index;
+    };
+
+    static bool is_run(std::vector<uint32_t> const &grid, size_t first, uint32_t count, uint32_t value)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            if (grid[first + i] != value)
+                return false;
+        return true;
+    }
+
+    std::vector<Voxel> voxels = {};
+};
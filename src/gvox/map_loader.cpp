@@ -1,8 +1,11 @@
 
 
 #include "map_loader.hpp"
+#include "box_merger.hpp"
+#include "map_streamer.hpp"
 
 #include <mutex>
+#include <chrono>
 
 #include <gvox/adapters/input/file.h>
 #include <gvox/adapters/input/byte_buffer.h>
@@ -43,6 +46,25 @@ void serialize_region(GvoxBlitContext *blit_ctx, GvoxAdapterContext *ctx, GvoxRe
 {
 }
 
+// Upper bound of the primitives written by a region (voxels with a material id)
+static uint32_t count_region_voxels(GvoxBlitContext *blit_ctx, GvoxRegion const *region)
+{
+    uint32_t count = 0;
+    for (int z = 0; z < region->range.extent.z; ++z)
+    {
+        for (int y = 0; y < region->range.extent.y; ++y)
+        {
+            for (int x = 0; x < region->range.extent.x; ++x)
+            {
+                GvoxOffset3D sample_position = region->range.offset + GvoxOffset3D{x, y, z};
+                if (gvox_sample_region(blit_ctx, region, &sample_position, GVOX_CHANNEL_ID_MATERIAL_ID).is_present != 0)
+                    ++count;
+            }
+        }
+    }
+    return count;
+}
+
 // This function may be called in a parallel nature by the parse adapter.
 void receive_region(GvoxBlitContext *blit_ctx, GvoxAdapterContext *ctx, GvoxRegion const *region)
 {
@@ -66,15 +88,49 @@ void receive_region(GvoxBlitContext *blit_ctx, GvoxAdapterContext *ctx, GvoxRegi
     //     the channel in question. If, for example, one requested GVOX_CHANNEL_ID_COLOR, the 8bpc color data
     //     would be packed into the first 24 bits of the uint32_t.
 
-    auto &user_state = *static_cast<GvoxModelDataSerializeInternal *>(gvox_adapter_get_user_pointer(ctx));
+    auto &model_state = *static_cast<GvoxModelDataSerializeInternal *>(gvox_adapter_get_user_pointer(ctx));
 
     {
-        static auto printf_mtx = std::mutex{};
-
         // If necessary in our application, we may need to synchronize. For example,
-        // here we need to lock printf because we only want one thread writing to
-        // the console at any time.
-        auto lock = std::lock_guard{printf_mtx};
+        // here we need to lock because the parse adapter may hand us regions of the
+        // same model in parallel. Each model has its own lock so models load concurrently.
+        auto lock = std::lock_guard{model_state.region_mutex};
+
+        // Streaming: the region is written into its own chunk with local indices and queued when finished
+        bool streaming = model_state.params.region_queue != nullptr;
+        GvoxRegionChunk chunk = {};
+        GvoxModelData region_info = {};
+        if (streaming)
+        {
+            uint32_t region_voxel_count = count_region_voxels(blit_ctx, region);
+            chunk.aabbs.resize(region_voxel_count);
+            chunk.primitives.resize(region_voxel_count);
+            chunk.lights.resize(region_voxel_count);
+            // Material ids are 8 bits wide
+            chunk.materials.resize(256);
+        }
+        GvoxModelDataSerialize region_params = GvoxModelDataSerialize{
+            .axis_direction = model_state.params.axis_direction,
+            .max_instance_count = 1,
+            .current_instance_index = 0,
+            .instances = &chunk.instance,
+            .current_primitive_index = 0,
+            .max_primitive_count = static_cast<uint32_t>(chunk.aabbs.size()),
+            .primitives = chunk.primitives.data(),
+            .aabbs = chunk.aabbs.data(),
+            .current_material_index = 0,
+            .max_material_count = static_cast<uint32_t>(chunk.materials.size()),
+            .materials = chunk.materials.data(),
+            .current_light_index = 0,
+            .max_light_count = static_cast<uint32_t>(chunk.lights.size()),
+            .lights = chunk.lights.data(),
+            .merge_boxes = model_state.params.merge_boxes,
+        };
+        auto region_state = GvoxModelDataSerializeInternal{
+            .scene_info = region_info,
+            .params = region_params,
+        };
+        auto &user_state = streaming ? region_state : model_state;
 
         constexpr float vox_emission = 100.0f;
 
@@ -93,6 +149,10 @@ void receive_region(GvoxBlitContext *blit_ctx, GvoxAdapterContext *ctx, GvoxRegi
         uint32_t voxel_count = 0;
         uint32_t light_count = 0;
         uint32_t first_voxel_index = user_state.params.current_primitive_index;
+        uint32_t region_primitive_start = user_state.scene_info.primitive_count;
+
+        // Non-emissive voxels are gathered here and written as merged boxes at the end of the region
+        BoxMerger box_merger = {};
 
         struct palette_entry
         {
@@ -262,41 +322,48 @@ void receive_region(GvoxBlitContext *blit_ctx, GvoxAdapterContext *ctx, GvoxRegi
                                 z_grid = sample_position.z;
                             }
 
-                            user_state.params.aabbs[index] = AABB{
-                                .minimum = {x_grid * VOXEL_EXTENT,
-                                            y_grid * VOXEL_EXTENT,
-                                            z_grid * VOXEL_EXTENT},
-                                .maximum = {(x_grid + 1) * VOXEL_EXTENT,
-                                            (y_grid + 1) * VOXEL_EXTENT,
-                                            (z_grid + 1) * VOXEL_EXTENT},
-                            };
-                            ++user_state.scene_info.primitive_count;
-
-                            if (light_found)
+                            if (user_state.params.merge_boxes && !light_found)
                             {
-                                daxa_f32vec3 center_position = {x_grid * VOXEL_EXTENT + VOXEL_EXTENT * 0.5f,
-                                                                y_grid * VOXEL_EXTENT + VOXEL_EXTENT * 0.5f,
-                                                                z_grid * VOXEL_EXTENT + VOXEL_EXTENT * 0.5f};
-                                LIGHT light = {
-                                    .position = center_position,
-                                    .emissive = {emission_r, emission_g, emission_b},
-                                    .instance_info = OBJECT_INFO(instance_index, index),
-                                    .size = VOXEL_EXTENT,
-                                    .type = GEOMETRY_LIGHT_CUBE};
-
-                                uint32_t light_index = user_state.scene_info.light_count + user_state.params.current_light_index;
-
-                                user_state.params.primitives[index] = PRIMITIVE{mat_index, light_index};
-
-                                if (user_state.params.max_light_count > light_index)
-                                {
-                                    user_state.params.lights[light_index] = light;
-                                    user_state.scene_info.light_count++;
-                                }
+                                box_merger.add_voxel(x_grid, y_grid, z_grid, mat_index);
                             }
                             else
                             {
-                                user_state.params.primitives[index] = PRIMITIVE{mat_index, static_cast<uint32_t>(-1)};
+                                user_state.params.aabbs[index] = AABB{
+                                    .minimum = {x_grid * VOXEL_EXTENT,
+                                                y_grid * VOXEL_EXTENT,
+                                                z_grid * VOXEL_EXTENT},
+                                    .maximum = {(x_grid + 1) * VOXEL_EXTENT,
+                                                (y_grid + 1) * VOXEL_EXTENT,
+                                                (z_grid + 1) * VOXEL_EXTENT},
+                                };
+                                ++user_state.scene_info.primitive_count;
+
+                                if (light_found)
+                                {
+                                    daxa_f32vec3 center_position = {x_grid * VOXEL_EXTENT + VOXEL_EXTENT * 0.5f,
+                                                                    y_grid * VOXEL_EXTENT + VOXEL_EXTENT * 0.5f,
+                                                                    z_grid * VOXEL_EXTENT + VOXEL_EXTENT * 0.5f};
+                                    LIGHT light = {
+                                        .position = center_position,
+                                        .emissive = {emission_r, emission_g, emission_b},
+                                        .instance_info = OBJECT_INFO(instance_index, index),
+                                        .size = VOXEL_EXTENT,
+                                        .type = GEOMETRY_LIGHT_CUBE};
+
+                                    uint32_t light_index = user_state.scene_info.light_count + user_state.params.current_light_index;
+
+                                    user_state.params.primitives[index] = PRIMITIVE{mat_index, light_index};
+
+                                    if (user_state.params.max_light_count > light_index)
+                                    {
+                                        user_state.params.lights[light_index] = light;
+                                        user_state.scene_info.light_count++;
+                                    }
+                                }
+                                else
+                                {
+                                    user_state.params.primitives[index] = PRIMITIVE{mat_index, static_cast<uint32_t>(-1)};
+                                }
                             }
                         }
                         else
@@ -315,16 +382,78 @@ void receive_region(GvoxBlitContext *blit_ctx, GvoxAdapterContext *ctx, GvoxRegi
             // printf("\n");
         }
 
+        user_state.scene_info.voxel_count += voxel_count;
+
+        uint32_t instance_primitive_count = voxel_count;
+
+        if (user_state.params.merge_boxes)
+        {
+            std::vector<BoxMerger::MergedBox> boxes = {};
+            BoxMergeStats stats = box_merger.merge(boxes);
+
+            for (auto const &box : boxes)
+            {
+                if (user_state.params.max_primitive_count > user_state.scene_info.primitive_count + first_voxel_index)
+                {
+                    uint32_t index = user_state.scene_info.primitive_count + first_voxel_index;
+                    user_state.params.aabbs[index] = BoxMerger::box_to_aabb(box);
+                    user_state.params.primitives[index] = PRIMITIVE{box.material_index, static_cast<uint32_t>(-1)};
+                    ++user_state.scene_info.primitive_count;
+                }
+                else
+                {
+#if TRACE == 1
+                    printf("max_primitive_count exceeded\n");
+#endif // TRACE
+                }
+            }
+
+            instance_primitive_count = user_state.scene_info.primitive_count - region_primitive_start;
+
+#if TRACE == 1
+            printf("merged voxels: %llu boxes: %llu\n", static_cast<unsigned long long>(stats.voxel_count), static_cast<unsigned long long>(stats.box_count));
+#endif // TRACE
+        }
+
         if (instance_index != user_state.params.max_instance_count)
         {
             INSTANCE inst = {0};
             inst.transform = glm_mat4_to_daxa_f32mat4x4(glm::mat4(1.0f));
             inst.first_primitive_index = first_voxel_index;
-            inst.primitive_count = voxel_count;
+            inst.primitive_count = instance_primitive_count;
 
             user_state.params.instances[instance_index] = inst;
         }
 
+        if (streaming)
+        {
+            chunk.aabbs.resize(region_info.primitive_count);
+            chunk.primitives.resize(region_info.primitive_count);
+            chunk.lights.resize(region_info.light_count);
+            chunk.materials.resize(region_info.material_count);
+            chunk.voxel_count = region_info.voxel_count;
+
+            if (!chunk.aabbs.empty())
+            {
+                daxa_f32vec3 minimum = chunk.aabbs[0].minimum;
+                daxa_f32vec3 maximum = chunk.aabbs[0].maximum;
+                for (auto const &aabb : chunk.aabbs)
+                {
+                    minimum = {std::min(minimum.x, aabb.minimum.x), std::min(minimum.y, aabb.minimum.y), std::min(minimum.z, aabb.minimum.z)};
+                    maximum = {std::max(maximum.x, aabb.maximum.x), std::max(maximum.y, aabb.maximum.y), std::max(maximum.z, aabb.maximum.z)};
+                }
+                chunk.center = {(minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f};
+
+                model_state.scene_info.instance_count += region_info.instance_count;
+                model_state.scene_info.primitive_count += region_info.primitive_count;
+                model_state.scene_info.material_count += region_info.material_count;
+                model_state.scene_info.light_count += region_info.light_count;
+                model_state.scene_info.voxel_count += region_info.voxel_count;
+
+                model_state.params.region_queue->push(std::move(chunk));
+            }
+        }
+
 #if TRACE == 1
         printf("voxel count: %d\n", voxel_count);
         printf("light count: %d\n", light_count);
@@ -482,6 +611,8 @@ auto MapLoader::load_gvox_data(std::filesystem::path gvox_model_path, GvoxModelD
     GvoxAdapterContext *p_ctx = gvox_create_adapter_context(gvox_ctx, gvox_get_parse_adapter(gvox_ctx, gvox_model_type), i_config_ptr);
     GvoxAdapterContext *s_ctx = gvox_create_adapter_context(gvox_ctx, gvox_get_serialize_adapter(gvox_ctx, "my_adapter"), &s_config);
 
+    auto parse_start = std::chrono::high_resolution_clock::now();
+
     {
         // time_t start = clock();
         gvox_blit_region(
@@ -513,6 +644,18 @@ auto MapLoader::load_gvox_data(std::filesystem::path gvox_model_path, GvoxModelD
         }
     }
 
+#if INFO == 1
+    auto parse_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - parse_start).count();
+    std::cout << "load_gvox_data: " << gvox_model_path.filename().string() << " parsed in " << parse_time << " ms" << std::endl;
+    if (serialize_params.merge_boxes && result.voxel_count > 0)
+    {
+        uint64_t saved_bytes = static_cast<uint64_t>(result.voxel_count - result.primitive_count) * (sizeof(AABB) + sizeof(PRIMITIVE));
+        std::cout << "  box merging: " << result.voxel_count << " voxels -> " << result.primitive_count << " primitives ("
+                  << (100.0 * (result.voxel_count - result.primitive_count) / result.voxel_count) << "% fewer, "
+                  << (saved_bytes >> 10) << " KiB of AABB/PRIMITIVE data saved)" << std::endl;
+    }
+#endif // INFO
+
     gvox_destroy_adapter_context(i_ctx);
     // gvox_destroy_adapter_context(o_ctx);
     gvox_destroy_adapter_context(p_ctx);
@@ -0,0 +1,181 @@
+#pragma once
+#include "defines.h"
+#include "map_loader.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// Output of a single gvox region when streaming.
+// Every index is local to the region (primitives, materials and lights start at 0),
+// they are rebased when the region is handed over to the acceleration structure manager.
+struct GvoxRegionChunk
+{
+    INSTANCE instance = {};
+    std::vector<AABB> aabbs = {};
+    std::vector<PRIMITIVE> primitives = {};
+    std::vector<MATERIAL> materials = {};
+    std::vector<LIGHT> lights = {};
+    // World space center of the region, used to stream the nearest regions first
+    daxa_f32vec3 center = {0.0f, 0.0f, 0.0f};
+    uint32_t voxel_count = 0;
+};
+
+// Regions already parsed waiting to be picked up by the renderer
+struct GvoxRegionQueue
+{
+public:
+    void push(GvoxRegionChunk &&chunk)
+    {
+        auto lock = std::lock_guard{mutex};
+        chunks.push_back(std::move(chunk));
+    }
+
+    // Pop up to max_count regions, nearest to position first
+    auto pop_nearest(daxa_f32vec3 position, uint32_t max_count, std::vector<GvoxRegionChunk> &out) -> uint32_t
+    {
+        auto lock = std::lock_guard{mutex};
+
+        uint32_t count = std::min(max_count, static_cast<uint32_t>(chunks.size()));
+        if (count == 0)
+            return 0;
+
+        auto distance = [&](GvoxRegionChunk const &chunk) -> float
+        {
+            float dx = chunk.center.x - position.x;
+            float dy = chunk.center.y - position.y;
+            float dz = chunk.center.z - position.z;
+            return dx * dx + dy * dy + dz * dz;
+        };
+
+        // Nearest regions go to the back so they can be popped without shifting the rest
+        std::partial_sort(chunks.rbegin(), chunks.rbegin() + count, chunks.rend(),
+                          [&](GvoxRegionChunk const &lhs, GvoxRegionChunk const &rhs)
+                          { return distance(lhs) < distance(rhs); });
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            out.push_back(std::move(chunks.back()));
+            chunks.pop_back();
+        }
+
+        return count;
+    }
+
+    // Pop every region in the order they were parsed
+    auto pop_all(std::vector<GvoxRegionChunk> &out) -> uint32_t
+    {
+        auto lock = std::lock_guard{mutex};
+        uint32_t count = static_cast<uint32_t>(chunks.size());
+        for (auto &chunk : chunks)
+            out.push_back(std::move(chunk));
+        chunks.clear();
+        return count;
+    }
+
+    bool empty()
+    {
+        auto lock = std::lock_guard{mutex};
+        return chunks.empty();
+    }
+
+private:
+    std::mutex mutex = {};
+    std::vector<GvoxRegionChunk> chunks = {};
+};
+
+// Parses a model on a background thread, each region is queued as soon as it is finished
+// so rendering can start before the whole map is loaded.
+struct MapStreamer
+{
+public:
+    MapStreamer() = default;
+    ~MapStreamer() { wait(); }
+
+    bool start(std::filesystem::path gvox_model_path, AXIS_DIRECTION axis_direction, bool merge_boxes = false)
+    {
+        if (worker.joinable())
+        {
+#if WARN
+            std::cerr << "MapStreamer: already streaming" << std::endl;
+#endif // WARN
+            return false;
+        }
+
+        finished = false;
+        start_time = std::chrono::high_resolution_clock::now();
+
+        worker = std::jthread([this, gvox_model_path, axis_direction, merge_boxes]()
+        {
+            // Gvox contexts are not shared between threads
+            MapLoader loader = {};
+            loader.create_gvox_context();
+
+            GvoxModelDataSerialize params = GvoxModelDataSerialize{
+                .axis_direction = axis_direction,
+                .max_instance_count = 0,
+                .current_instance_index = 0,
+                .instances = nullptr,
+                .current_primitive_index = 0,
+                .max_primitive_count = 0,
+                .primitives = nullptr,
+                .aabbs = nullptr,
+                .current_material_index = 0,
+                .max_material_count = 0,
+                .materials = nullptr,
+                .current_light_index = 0,
+                .max_light_count = 0,
+                .lights = nullptr,
+                .merge_boxes = merge_boxes,
+                .region_queue = &queue,
+            };
+
+            model_data = loader.load_gvox_data(gvox_model_path, params);
+
+            loader.destroy_gvox_context();
+
+            parse_time = get_elapsed_ms();
+            finished = true;
+        });
+
+        return true;
+    }
+
+    // NOTE: gvox blits can't be interrupted, this waits for the whole model to be parsed
+    void wait()
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    auto pop_nearest(daxa_f32vec3 position, uint32_t max_count, std::vector<GvoxRegionChunk> &out) -> uint32_t
+    {
+        return queue.pop_nearest(position, max_count, out);
+    }
+
+    // Parsing has finished (regions may still be waiting in the queue)
+    bool is_finished() const { return finished; }
+
+    // Every region has been parsed and handed over
+    bool is_done() { return finished && queue.empty(); }
+
+    // Totals of the whole model, only valid once finished
+    auto get_model_data() const -> GvoxModelData { return model_data; }
+
+    auto get_parse_time_ms() const -> double { return parse_time; }
+
+    auto get_elapsed_ms() const -> double
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+    }
+
+private:
+    GvoxRegionQueue queue = {};
+    std::jthread worker = {};
+    std::atomic<bool> finished = false;
+    GvoxModelData model_data = {};
+    double parse_time = 0.0;
+    std::chrono::high_resolution_clock::time_point start_time = {};
+};
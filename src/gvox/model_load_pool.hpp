@@ -0,0 +1,180 @@
+#pragma once
+#include "defines.h"
+#include "map_loader.hpp"
+#include "map_streamer.hpp"
+
+#include <deque>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+// A model parsed by the load pool, one chunk per gvox region (region local indices, see GvoxRegionChunk)
+struct GvoxModelLoad
+{
+    std::filesystem::path gvox_model_path = {};
+    daxa_f32mat4x4 transform = {};
+    GvoxModelData model_data = {};
+    std::vector<GvoxRegionChunk> chunks = {};
+    double load_time = 0.0;
+    // Registered model (0 if not shared), see ACCEL_STRUCT_MNGR::TASK::BLAS_BUILD_FROM_CPU
+    uint32_t model_index = 0;
+};
+
+struct GvoxModelLoadInfo
+{
+    std::filesystem::path gvox_model_path = {};
+    daxa_f32mat4x4 transform = {};
+    AXIS_DIRECTION axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP;
+    bool merge_boxes = false;
+    uint32_t model_index = 0;
+};
+
+// Bounded pool of loader threads. Models are parsed concurrently into private chunks,
+// the renderer picks them up with pop_finished and queues their build tasks.
+struct ModelLoadPool
+{
+public:
+    ModelLoadPool(uint32_t thread_count = 0)
+    {
+        if (thread_count == 0)
+            thread_count = std::clamp(std::thread::hardware_concurrency() / 2, 1U, MAX_LOADER_THREADS);
+
+        for (uint32_t i = 0; i < thread_count; ++i)
+        {
+            workers.emplace_back([this](std::stop_token stop_token)
+                                 { worker_loop(stop_token); });
+        }
+    }
+
+    ~ModelLoadPool()
+    {
+        {
+            auto lock = std::lock_guard{job_mutex};
+            for (auto &worker : workers)
+                worker.request_stop();
+        }
+        job_cv.notify_all();
+    }
+
+    // Queue a model load, the future is ready once the model is parsed
+    auto load_async(GvoxModelLoadInfo const &info) -> std::shared_future<GvoxModelData>
+    {
+        auto job = std::make_shared<Job>();
+        job->info = info;
+        job->load.gvox_model_path = info.gvox_model_path;
+        job->load.transform = info.transform;
+        job->load.model_index = info.model_index;
+        auto future = job->promise.get_future().share();
+
+        {
+            auto lock = std::lock_guard{job_mutex};
+            pending_jobs.push_back(job);
+            submitted_jobs.push_back(job);
+        }
+        job_cv.notify_one();
+
+        return future;
+    }
+
+    // Pop finished loads in submission order so instance ids stay deterministic
+    auto pop_finished(std::vector<GvoxModelLoad> &out) -> uint32_t
+    {
+        auto lock = std::lock_guard{job_mutex};
+        uint32_t count = 0;
+        while (!submitted_jobs.empty() && submitted_jobs.front()->finished)
+        {
+            out.push_back(std::move(submitted_jobs.front()->load));
+            submitted_jobs.pop_front();
+            ++count;
+        }
+        return count;
+    }
+
+    bool is_idle()
+    {
+        auto lock = std::lock_guard{job_mutex};
+        return submitted_jobs.empty();
+    }
+
+    auto get_thread_count() const -> uint32_t { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    static constexpr uint32_t MAX_LOADER_THREADS = 4;
+
+    struct Job
+    {
+        GvoxModelLoadInfo info = {};
+        GvoxModelLoad load = {};
+        std::promise<GvoxModelData> promise = {};
+        bool finished = false;
+    };
+
+    void worker_loop(std::stop_token stop_token)
+    {
+        // Gvox contexts are not shared between threads
+        MapLoader loader = {};
+        loader.create_gvox_context();
+
+        while (true)
+        {
+            std::shared_ptr<Job> job = nullptr;
+            {
+                auto lock = std::unique_lock{job_mutex};
+                job_cv.wait(lock, [&]
+                            { return stop_token.stop_requested() || !pending_jobs.empty(); });
+                if (stop_token.stop_requested())
+                    break;
+                job = pending_jobs.front();
+                pending_jobs.pop_front();
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            GvoxRegionQueue region_queue = {};
+            GvoxModelDataSerialize params = GvoxModelDataSerialize{
+                .axis_direction = job->info.axis_direction,
+                .max_instance_count = 0,
+                .current_instance_index = 0,
+                .instances = nullptr,
+                .current_primitive_index = 0,
+                .max_primitive_count = 0,
+                .primitives = nullptr,
+                .aabbs = nullptr,
+                .current_material_index = 0,
+                .max_material_count = 0,
+                .materials = nullptr,
+                .current_light_index = 0,
+                .max_light_count = 0,
+                .lights = nullptr,
+                .merge_boxes = job->info.merge_boxes,
+                .region_queue = &region_queue,
+            };
+
+            job->load.model_data = loader.load_gvox_data(job->info.gvox_model_path, params);
+            region_queue.pop_all(job->load.chunks);
+            job->load.load_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+#if INFO == 1
+            std::cout << "ModelLoadPool: " << job->info.gvox_model_path.filename().string() << " loaded in " << job->load.load_time << " ms" << std::endl;
+#endif // INFO
+
+            // The load may be moved out by pop_finished as soon as it is flagged
+            GvoxModelData model_data = job->load.model_data;
+            {
+                auto lock = std::lock_guard{job_mutex};
+                job->finished = true;
+            }
+            job->promise.set_value(model_data);
+        }
+
+        loader.destroy_gvox_context();
+    }
+
+    std::mutex job_mutex = {};
+    std::condition_variable job_cv = {};
+    std::deque<std::shared_ptr<Job>> pending_jobs = {};
+    std::deque<std::shared_ptr<Job>> submitted_jobs = {};
+    std::vector<std::jthread> workers = {};
+};
@@ -8,12 +8,21 @@
 #include "math.inl"
 
 #include <map_loader.hpp>
+#include <map_streamer.hpp>
+#include <model_load_pool.hpp>
 #include <accel_struct_mngr.hpp>
 #include <brushes/brush_mngr.hpp>
 
 #include "rng.h"
 #include "camera.h"
 #include "texture.hpp"
+#include "cpu/frame_profiler.hpp"
+#include "cpu/shader_pack.hpp"
+
+#if PROFILER_ON == 1 && PROFILER_OVERLAY_ON == 1
+#include <daxa/utils/imgui.hpp>
+#include <imgui_impl_glfw.h>
+#endif // PROFILER_OVERLAY_ON
 
 using namespace std::chrono_literals;
 using Clock = std::chrono::high_resolution_clock;
@@ -35,6 +44,7 @@ void cubeland_app()
     const char *DEER_NAME = "deer.vox";
     const char *SWORD_NAME = "chr_sword.vox";
     const float day_duration = 60.0f; // Day duration in seconds
+    const u32 streamed_regions_per_frame = 8; // Map regions handed over to the AS manager per frame when streaming
 
     Clock::time_point start_time = std::chrono::steady_clock::now(), previous_time = start_time;
     Status status = {};
@@ -65,7 +75,15 @@ void cubeland_app()
     std::shared_ptr<daxa::RayTracingPipeline> primary_hit_rt_pipeline = {};
     std::shared_ptr<daxa::RayTracingPipeline> shading_rt_pipeline = {};
     std::shared_ptr<daxa::ComputePipeline> taa_comp_pipeline = {};
+#if DENOISER_ON == 1
+    std::shared_ptr<daxa::ComputePipeline> denoiser_temporal_comp_pipeline = {};
+    std::shared_ptr<daxa::ComputePipeline> denoiser_atrous_comp_pipeline = {};
+#endif // DENOISER_ON
     std::shared_ptr<daxa::ComputePipeline> rearregement_comp_pipeline = {};
+    std::shared_ptr<daxa::ComputePipeline> brush_comp_pipeline = {};
+    // Where the SPIR-V of the pipelines came from, without the pipeline manager
+    ShaderCacheReport shader_cache_report = {};
+    char const *shader_binary_source = "";
 
     // BUFFERS
     daxa::BufferId light_config_buffer = {};
@@ -97,27 +115,48 @@ void cubeland_app()
     RESTIR restir = {};
     size_t restir_buffer_size = sizeof(RESTIR);
 
+    // Per pixel buffers, sized by create_pixel_buffers to the swapchain extent (not to MAX_RESERVOIRS) & rebuilt on resize
+    daxa_u32vec2 pixel_buffer_extent = {0, 0};
+    daxa_u32 pixel_buffer_pixel_count = 0;
+
     daxa::BufferId previous_reservoir_buffer = {};
     daxa::BufferId intermediate_reservoir_buffer = {};
     daxa::BufferId reservoir_buffer = {};
-    size_t max_reservoir_buffer_size = sizeof(RESERVOIR) * MAX_RESERVOIRS;
+    size_t reservoir_buffer_size = 0;
 
     daxa::BufferId velocity_buffer = {};
-    size_t max_velocity_buffer_size = sizeof(VELOCITY) * MAX_RESERVOIRS;
+    size_t velocity_buffer_size = 0;
 
     daxa::BufferId previous_direct_illum_buffer = {};
     daxa::BufferId direct_illum_buffer = {};
-    size_t max_direct_illum_buffer_size = sizeof(DIRECT_ILLUMINATION_INFO) * MAX_RESERVOIRS;
+    size_t direct_illum_buffer_size = 0;
 
     // daxa::BufferId pixel_reconnection_data_buffer = {};
-    // size_t max_pixel_reconnection_data_buffer_size = sizeof(PIXEL_RECONNECTION_DATA) * MAX_RESERVOIRS;
+    // size_t pixel_reconnection_data_buffer_size = 0;
 
     daxa::BufferId output_path_reservoir_buffer = {};
     daxa::BufferId temporal_path_reservoir_buffer = {};
-    size_t max_output_path_reservoir_buffer_size = sizeof(PATH_RESERVOIR) * MAX_RESERVOIRS;
+    size_t path_reservoir_buffer_size = 0;
 
     daxa::BufferId indirect_color_buffer = {};
-    size_t max_indirect_color_buffer_size = sizeof(daxa_f32vec3) * MAX_RESERVOIRS;
+    size_t indirect_color_buffer_size = 0;
+
+#if ADAPTIVE_SAMPLING_ON == 1
+    daxa::BufferId adaptive_pixel_buffer = {};
+    size_t adaptive_pixel_buffer_size = 0;
+    daxa::BufferId adaptive_tile_buffer = {};
+    size_t adaptive_tile_buffer_size = 0;
+#endif // ADAPTIVE_SAMPLING_ON
+
+#if DENOISER_ON == 1
+    daxa::BufferId denoiser_direct_buffer = {};
+    size_t denoiser_direct_buffer_size = 0;
+    // Histories & signals keep two halves of pixel_buffer_pixel_count
+    daxa::BufferId denoiser_history_buffer = {};
+    size_t denoiser_history_buffer_size = 0;
+    daxa::BufferId denoiser_signal_buffer = {};
+    size_t denoiser_signal_buffer_size = 0;
+#endif // DENOISER_ON
 
     // DEBUGGING
     // daxa::BufferId hit_distance_buffer = {};
@@ -132,21 +171,65 @@ void cubeland_app()
     LIGHT *point_lights = nullptr;
     LIGHT *env_lights = nullptr;
 
-    MapLoader map_loader = {};
+    std::unique_ptr<MapStreamer> map_streamer = {};
+    std::unique_ptr<ModelLoadPool> model_load_pool = {};
+    u32 map_regions_streamed = 0;
+    Clock::time_point scene_load_start = {};
+    daxa_b32 first_frame_drawn = false;
     std::unique_ptr<ACCEL_STRUCT_MNGR> as_manager = {};
     std::unique_ptr<BRUSH_MNGR> brush_manager = {};
 
+#if PROFILER_ON == 1
+    // CPU scopes of update() & draw(), timestamp pairs around the passes of draw()
+    FrameProfiler profiler{};
+    daxa::TimelineQueryPool timestamp_query_pool = {};
+    daxa_f64 timestamp_period_ns = 1.0;
+#if PROFILER_OVERLAY_ON == 1
+    daxa::ImGuiRenderer imgui_renderer = {};
+    daxa_b32 show_profiler_overlay = true;
+#endif // PROFILER_OVERLAY_ON
+#endif // PROFILER_ON
+
+    // Models loaded with load_model are registered once per file & load settings, every other placement shares their
+    // BLASes
+    struct MODEL_KEY
+    {
+      std::string gvox_model_path = {};
+      AXIS_DIRECTION axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP;
+      daxa_b32 merge_boxes = false;
+
+      auto operator<=>(MODEL_KEY const &other) const = default;
+    };
+    struct REGISTERED_MODEL
+    {
+      u32 model_index = 0;
+      daxa_b32 delivered = false;
+      // Lights point at the instance of their voxels, every placement of an emissive model is loaded on its own
+      daxa_b32 emissive = false;
+      // Placements requested while the model is still loading
+      std::vector<daxa_f32mat4x4> pending_placements = {};
+    };
+    std::map<MODEL_KEY, REGISTERED_MODEL> model_registry = {};
+    u32 registered_model_count = 0;
+
     // TODO: test
     daxa_b32 deer_loaded = false;
-    daxa_b32 sword_loaded = false;
+    u32 sword_placements = 0;
 
     App() : AppWindow<App>("Cubeland") {}
 
     ~App()
     {
-      map_loader.destroy_gvox_context();
       device.wait_idle();
       device.collect_garbage();
+#if PROFILER_ON == 1 && PROFILER_OVERLAY_ON == 1
+      if (ImGui::GetCurrentContext() != nullptr)
+      {
+        imgui_renderer = {};
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+      }
+#endif // PROFILER_OVERLAY_ON
       if (device.is_valid())
       {
         if (as_manager.get() != nullptr)
@@ -158,16 +241,7 @@ void cubeland_app()
         device.destroy_buffer(env_light_buffer);
         device.destroy_buffer(status_buffer);
         // device.destroy_buffer(status_output_buffer);
-        device.destroy_buffer(previous_reservoir_buffer);
-        device.destroy_buffer(intermediate_reservoir_buffer);
-        device.destroy_buffer(reservoir_buffer);
-        device.destroy_buffer(velocity_buffer);
-        device.destroy_buffer(previous_direct_illum_buffer);
-        device.destroy_buffer(direct_illum_buffer);
-        // device.destroy_buffer(pixel_reconnection_data_buffer);
-        device.destroy_buffer(output_path_reservoir_buffer);
-        device.destroy_buffer(temporal_path_reservoir_buffer);
-        device.destroy_buffer(indirect_color_buffer);
+        destroy_pixel_buffers();
         device.destroy_buffer(restir_buffer);
         device.destroy_buffer(world_buffer);
         // DEBUGGING
@@ -231,14 +305,132 @@ void cubeland_app()
       return i;
     }
 
+    daxa::BufferId create_pixel_buffer(size_t size, const char *name)
+    {
+      return device.create_buffer(daxa::BufferInfo{
+          .size = size,
+          .name = name,
+      });
+    }
+
+    // Sizes every per pixel buffer to width * height (the previous ones must be destroyed)
+    void create_pixel_buffers(daxa_u32 width, daxa_u32 height)
+    {
+      pixel_buffer_extent = {width, height};
+      pixel_buffer_pixel_count = width * height;
+      const size_t pixel_count = pixel_buffer_pixel_count;
+
+      reservoir_buffer_size = sizeof(RESERVOIR_STORAGE) * pixel_count;
+      velocity_buffer_size = sizeof(VELOCITY) * pixel_count;
+      direct_illum_buffer_size = sizeof(DIRECT_ILLUMINATION_INFO_STORAGE) * pixel_count;
+      path_reservoir_buffer_size = sizeof(PATH_RESERVOIR_STORAGE) * pixel_count;
+      indirect_color_buffer_size = sizeof(daxa_f32vec3) * pixel_count;
+
+      previous_reservoir_buffer = create_pixel_buffer(reservoir_buffer_size, "previous_reservoir_buffer");
+      intermediate_reservoir_buffer = create_pixel_buffer(reservoir_buffer_size, "intermediate_reservoir_buffer");
+      reservoir_buffer = create_pixel_buffer(reservoir_buffer_size, "reservoir_buffer");
+      velocity_buffer = create_pixel_buffer(velocity_buffer_size, "velocity_buffer");
+      previous_direct_illum_buffer = create_pixel_buffer(direct_illum_buffer_size, "previous_direct_illum_buffer");
+      direct_illum_buffer = create_pixel_buffer(direct_illum_buffer_size, "direct_illum_buffer");
+      // pixel_reconnection_data_buffer = create_pixel_buffer(pixel_reconnection_data_buffer_size, "pixel_reconnection_data_buffer");
+      output_path_reservoir_buffer = create_pixel_buffer(path_reservoir_buffer_size, "output_path_reservoir_buffer");
+      temporal_path_reservoir_buffer = create_pixel_buffer(path_reservoir_buffer_size, "temporal_path_reservoir_buffer");
+      indirect_color_buffer = create_pixel_buffer(indirect_color_buffer_size, "indirect_color_buffer");
+
+#if ADAPTIVE_SAMPLING_ON == 1
+      // Same tile count as adaptive_get_tile_index
+      const size_t tile_count = static_cast<size_t>((width + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE) *
+                                ((height + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE);
+      adaptive_pixel_buffer_size = sizeof(ADAPTIVE_PIXEL) * pixel_count;
+      adaptive_tile_buffer_size = sizeof(ADAPTIVE_TILE) * tile_count;
+      adaptive_pixel_buffer = create_pixel_buffer(adaptive_pixel_buffer_size, "adaptive_pixel_buffer");
+      adaptive_tile_buffer = create_pixel_buffer(adaptive_tile_buffer_size, "adaptive_tile_buffer");
+#endif // ADAPTIVE_SAMPLING_ON
+
+#if DENOISER_ON == 1
+      denoiser_direct_buffer_size = sizeof(daxa_f32vec3) * pixel_count;
+      denoiser_history_buffer_size = sizeof(DENOISER_HISTORY) * pixel_count * 2;
+      denoiser_signal_buffer_size = sizeof(DENOISER_SIGNAL) * pixel_count * 2;
+      denoiser_direct_buffer = create_pixel_buffer(denoiser_direct_buffer_size, "denoiser_direct_buffer");
+      denoiser_history_buffer = create_pixel_buffer(denoiser_history_buffer_size, "denoiser_history_buffer");
+      denoiser_signal_buffer = create_pixel_buffer(denoiser_signal_buffer_size, "denoiser_signal_buffer");
+#endif // DENOISER_ON
+    }
+
+    void destroy_pixel_buffers()
+    {
+      device.destroy_buffer(previous_reservoir_buffer);
+      device.destroy_buffer(intermediate_reservoir_buffer);
+      device.destroy_buffer(reservoir_buffer);
+      device.destroy_buffer(velocity_buffer);
+      device.destroy_buffer(previous_direct_illum_buffer);
+      device.destroy_buffer(direct_illum_buffer);
+      // device.destroy_buffer(pixel_reconnection_data_buffer);
+      device.destroy_buffer(output_path_reservoir_buffer);
+      device.destroy_buffer(temporal_path_reservoir_buffer);
+      device.destroy_buffer(indirect_color_buffer);
+#if ADAPTIVE_SAMPLING_ON == 1
+      device.destroy_buffer(adaptive_pixel_buffer);
+      device.destroy_buffer(adaptive_tile_buffer);
+#endif // ADAPTIVE_SAMPLING_ON
+#if DENOISER_ON == 1
+      device.destroy_buffer(denoiser_direct_buffer);
+      device.destroy_buffer(denoiser_history_buffer);
+      device.destroy_buffer(denoiser_signal_buffer);
+#endif // DENOISER_ON
+      pixel_buffer_extent = {0, 0};
+      pixel_buffer_pixel_count = 0;
+    }
+
+    size_t get_pixel_buffer_byte_count() const
+    {
+      size_t byte_count = reservoir_buffer_size * 3 + velocity_buffer_size + direct_illum_buffer_size * 2 +
+                          path_reservoir_buffer_size * 2 + indirect_color_buffer_size;
+#if ADAPTIVE_SAMPLING_ON == 1
+      byte_count += adaptive_pixel_buffer_size + adaptive_tile_buffer_size;
+#endif // ADAPTIVE_SAMPLING_ON
+#if DENOISER_ON == 1
+      byte_count += denoiser_direct_buffer_size + denoiser_history_buffer_size + denoiser_signal_buffer_size;
+#endif // DENOISER_ON
+      return byte_count;
+    }
+
+    // Per pixel memory at the current extent next to what the MAX_RESERVOIRS sizing took
+    void report_pixel_buffer_memory() const
+    {
+      const double mib = 1.0 / (1024.0 * 1024.0);
+      const size_t byte_count = get_pixel_buffer_byte_count();
+      const double max_byte_count = static_cast<double>(byte_count) / std::max(pixel_buffer_pixel_count, 1u) * MAX_RESERVOIRS;
+      std::cout << "Pixel buffers " << pixel_buffer_extent.x << "x" << pixel_buffer_extent.y << ": "
+                << "reservoirs " << reservoir_buffer_size * 3 * mib << " MiB, "
+                << "velocity " << velocity_buffer_size * mib << " MiB, "
+                << "direct illumination " << direct_illum_buffer_size * 2 * mib << " MiB, "
+                << "path reservoirs " << path_reservoir_buffer_size * 2 * mib << " MiB, "
+                << "indirect color " << indirect_color_buffer_size * mib << " MiB"
+#if ADAPTIVE_SAMPLING_ON == 1
+                << ", adaptive " << (adaptive_pixel_buffer_size + adaptive_tile_buffer_size) * mib << " MiB"
+#endif // ADAPTIVE_SAMPLING_ON
+#if DENOISER_ON == 1
+                << ", denoiser " << (denoiser_direct_buffer_size + denoiser_history_buffer_size + denoiser_signal_buffer_size) * mib << " MiB"
+#endif // DENOISER_ON
+                << "; total " << byte_count * mib << " MiB (" << max_byte_count * mib << " MiB at "
+                << SCREEN_SIZE_X << "x" << SCREEN_SIZE_Y << ")" << std::endl;
+    }
+
+    // Clears the live region of the per pixel buffers, everything the previous frames left is invalidated
     void load_reservoirs()
     {
 
-      const daxa_u32 reservoir_buffer_size =
-          static_cast<u32>(std::max(std::max(std::max(std::max(sizeof(RESERVOIR), sizeof(DIRECT_ILLUMINATION_INFO)), sizeof(VELOCITY)), sizeof(PIXEL_RECONNECTION_DATA)), sizeof(PATH_RESERVOIR)) * MAX_RESERVOIRS);
+      size_t staging_buffer_size = std::max(std::max(std::max(reservoir_buffer_size, velocity_buffer_size), direct_illum_buffer_size), path_reservoir_buffer_size);
+#if ADAPTIVE_SAMPLING_ON == 1
+      staging_buffer_size = std::max(std::max(staging_buffer_size, adaptive_pixel_buffer_size), adaptive_tile_buffer_size);
+#endif // ADAPTIVE_SAMPLING_ON
+#if DENOISER_ON == 1
+      staging_buffer_size = std::max(staging_buffer_size, denoiser_history_buffer_size / 2);
+#endif // DENOISER_ON
 
       auto reservoir_staging_buffer = device.create_buffer({
-          .size = reservoir_buffer_size,
+          .size = staging_buffer_size,
           .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
           .name = "reservoir staging buffer",
       });
@@ -246,17 +438,7 @@ void cubeland_app()
 
       std::memset(device.get_host_address(reservoir_staging_buffer).value(),
                   0,
-                  reservoir_buffer_size);
-
-      const daxa_u32 reservoir_size = static_cast<u32>(sizeof(RESERVOIR) * MAX_RESERVOIRS);
-
-      const daxa_u32 velocity_buffer_size = static_cast<u32>(sizeof(VELOCITY) * MAX_RESERVOIRS);
-
-      const daxa_u32 direct_illum_buffer_size = static_cast<u32>(sizeof(DIRECT_ILLUMINATION_INFO) * MAX_RESERVOIRS);
-
-      // const daxa_u32 pixel_reconnection_data_buffer_size = static_cast<u32>(sizeof(PIXEL_RECONNECTION_DATA) * MAX_RESERVOIRS);
-
-      const daxa_u32 path_reservoir_buffer_size = static_cast<u32>(sizeof(PATH_RESERVOIR) * MAX_RESERVOIRS);
+                  staging_buffer_size);
 
       /// Record build commands:
       auto exec_cmds = [&]()
@@ -266,19 +448,19 @@ void cubeland_app()
         recorder.copy_buffer_to_buffer({
             .src_buffer = reservoir_staging_buffer,
             .dst_buffer = previous_reservoir_buffer,
-            .size = reservoir_size,
+            .size = reservoir_buffer_size,
         });
 
         recorder.copy_buffer_to_buffer({
             .src_buffer = reservoir_staging_buffer,
             .dst_buffer = intermediate_reservoir_buffer,
-            .size = reservoir_size,
+            .size = reservoir_buffer_size,
         });
 
         recorder.copy_buffer_to_buffer({
             .src_buffer = reservoir_staging_buffer,
             .dst_buffer = reservoir_buffer,
-            .size = reservoir_size,
+            .size = reservoir_buffer_size,
         });
 
         recorder.copy_buffer_to_buffer({
@@ -311,6 +493,34 @@ void cubeland_app()
             .size = path_reservoir_buffer_size,
         });
 
+#if ADAPTIVE_SAMPLING_ON == 1
+        // No samples & no tile errors yet
+        recorder.copy_buffer_to_buffer({
+            .src_buffer = reservoir_staging_buffer,
+            .dst_buffer = adaptive_pixel_buffer,
+            .size = adaptive_pixel_buffer_size,
+        });
+
+        recorder.copy_buffer_to_buffer({
+            .src_buffer = reservoir_staging_buffer,
+            .dst_buffer = adaptive_tile_buffer,
+            .size = adaptive_tile_buffer_size,
+        });
+#endif // ADAPTIVE_SAMPLING_ON
+
+#if DENOISER_ON == 1
+        // No histories yet (distance 0), zeroed a half at a time
+        for (daxa_u32 half_index = 0; half_index < 2; ++half_index)
+        {
+            recorder.copy_buffer_to_buffer({
+                .src_buffer = reservoir_staging_buffer,
+                .dst_buffer = denoiser_history_buffer,
+                .dst_offset = half_index * denoiser_history_buffer_size / 2,
+                .size = denoiser_history_buffer_size / 2,
+            });
+        }
+#endif // DENOISER_ON
+
         return recorder.complete_current_commands();
       }();
       device.submit_commands({.command_lists = std::array{exec_cmds}});
@@ -574,6 +784,16 @@ void cubeland_app()
       world.point_light_address = device.get_device_address(point_light_buffer).value();
       world.cube_light_address = device.get_device_address(as_manager->get_cube_light_buffer()).value();
       world.env_light_address = device.get_device_address(env_light_buffer).value();
+#if BRICK_PRIMITIVES_ON == 1
+      world.brick_address = device.get_device_address(as_manager->get_brick_buffer()).value();
+#endif // BRICK_PRIMITIVES_ON
+#if LIGHT_TREE_ON == 1
+      world.light_tree_address = device.get_device_address(as_manager->get_light_tree_buffer()).value();
+      world.light_tree_leaf_address = device.get_device_address(as_manager->get_light_tree_leaf_buffer()).value();
+#endif // LIGHT_TREE_ON
+#if LIGHT_ALIAS_TABLE_ON == 1
+      world.light_alias_address = device.get_device_address(as_manager->get_light_alias_buffer()).value();
+#endif // LIGHT_ALIAS_TABLE_ON
 
       // copy world to buffer
 
@@ -607,8 +827,245 @@ void cubeland_app()
       device.wait_idle();
     }
 
+    daxa::ShaderCompileInfo get_shader_compile_info(ShaderPermutation const &shader, daxa::ShaderCompileOptions const &glsl_compile_options,
+                                                    daxa::ShaderCompileOptions const &slang_compile_options)
+    {
+      auto compile_options = shader.language == ShaderSourceLanguage::SLANG ? slang_compile_options : glsl_compile_options;
+      for (auto const &define : shader.defines)
+        compile_options.defines.push_back(daxa::ShaderDefine{define.name, define.value});
+      if (shader.language == ShaderSourceLanguage::SLANG)
+        compile_options.entry_point = shader.entry_point;
+
+      return daxa::ShaderCompileInfo{
+          .source = daxa::ShaderFile{shader.source},
+          .compile_options = compile_options,
+      };
+    }
+
+    daxa::RayTracingShaderGroupInfo get_shader_group_info(ShaderGroupDesc const &group)
+    {
+      if (group.type == ShaderGroupType::GENERAL)
+        return daxa::RayTracingShaderGroupInfo{
+            .type = daxa::ShaderGroup::GENERAL,
+            .general_shader_index = group.general_shader_index,
+        };
+
+      return daxa::RayTracingShaderGroupInfo{
+          .type = daxa::ShaderGroup::PROCEDURAL_HIT_GROUP,
+          .closest_hit_shader_index = group.closest_hit_shader_index,
+          .any_hit_shader_index = group.any_hit_shader_index,
+          .intersection_shader_index = group.intersection_shader_index,
+      };
+    }
+
+    void set_pipeline(PipelineId id, std::shared_ptr<daxa::RayTracingPipeline> pipeline)
+    {
+      if (id == PipelineId::PRIMARY_HIT_RT)
+        primary_hit_rt_pipeline = pipeline;
+      else
+        shading_rt_pipeline = pipeline;
+    }
+
+    void set_pipeline(PipelineId id, std::shared_ptr<daxa::ComputePipeline> pipeline)
+    {
+      switch (id)
+      {
+      case PipelineId::TAA_COMP:
+        taa_comp_pipeline = pipeline;
+        break;
+#if DENOISER_ON == 1
+      case PipelineId::DENOISER_TEMPORAL_COMP:
+        denoiser_temporal_comp_pipeline = pipeline;
+        break;
+      case PipelineId::DENOISER_ATROUS_COMP:
+        denoiser_atrous_comp_pipeline = pipeline;
+        break;
+#endif // DENOISER_ON
+      case PipelineId::REARRANGEMENT_COMP:
+        rearregement_comp_pipeline = pipeline;
+        break;
+      case PipelineId::BRUSH_COMP:
+        brush_comp_pipeline = pipeline;
+        break;
+      default:
+        break;
+      }
+    }
+
+    // Compiled & hot reloaded by the pipeline manager
+    void add_managed_pipeline(PipelineDesc const &desc, daxa::ShaderCompileOptions const &glsl_compile_options,
+                              daxa::ShaderCompileOptions const &slang_compile_options)
+    {
+      if (!desc.is_ray_tracing())
+      {
+        set_pipeline(desc.id, pipeline_manager.add_compute_pipeline(
+                                                  daxa::ComputePipelineCompileInfo{
+                                                      .shader_info = get_shader_compile_info(desc.shaders[0], glsl_compile_options, slang_compile_options),
+                                                      .push_constant_size = desc.push_constant_size,
+                                                      .name = desc.name,
+                                                  })
+                                  .value());
+        return;
+      }
+
+      auto ray_trace_pipe_info = daxa::RayTracingPipelineCompileInfo{
+          .max_ray_recursion_depth = status.max_depth,
+          .push_constant_size = desc.push_constant_size,
+          .name = desc.name,
+      };
+      for (auto const &shader : desc.shaders)
+      {
+        auto compile_info = get_shader_compile_info(shader, glsl_compile_options, slang_compile_options);
+        switch (shader.stage)
+        {
+        case ShaderStage::RAY_GEN:
+          ray_trace_pipe_info.ray_gen_infos.push_back(compile_info);
+          break;
+        case ShaderStage::INTERSECTION:
+          ray_trace_pipe_info.intersection_infos.push_back(compile_info);
+          break;
+        case ShaderStage::ANY_HIT:
+          ray_trace_pipe_info.any_hit_infos.push_back(compile_info);
+          break;
+        case ShaderStage::CALLABLE:
+          ray_trace_pipe_info.callable_infos.push_back(compile_info);
+          break;
+        case ShaderStage::CLOSEST_HIT:
+          ray_trace_pipe_info.closest_hit_infos.push_back(compile_info);
+          break;
+        default:
+          ray_trace_pipe_info.miss_hit_infos.push_back(compile_info);
+          break;
+        }
+      }
+      for (auto const &group : desc.groups)
+        ray_trace_pipe_info.shader_groups_infos.push_back(get_shader_group_info(group));
+      set_pipeline(desc.id, pipeline_manager.add_ray_tracing_pipeline(ray_trace_pipe_info).value());
+    }
+
+    // Created from SPIR-V, one binary for every shader of the pipelines in order, no hot reload
+    void create_pipelines(std::vector<PipelineDesc> const &pipeline_descs, std::vector<std::vector<daxa_u32> const *> const &spirv)
+    {
+      size_t shader_index = 0;
+      for (auto const &desc : pipeline_descs)
+      {
+        std::vector<daxa::ShaderInfo> stage_infos[static_cast<size_t>(ShaderStage::COMPUTE) + 1] = {};
+        for (auto const &shader : desc.shaders)
+        {
+          auto const &binary = *spirv[shader_index++];
+          stage_infos[static_cast<size_t>(shader.stage)].push_back(daxa::ShaderInfo{
+              .byte_code = binary.data(),
+              .byte_code_size = static_cast<daxa_u32>(binary.size()),
+          });
+        }
+
+        if (!desc.is_ray_tracing())
+        {
+          set_pipeline(desc.id, std::make_shared<daxa::ComputePipeline>(device.create_compute_pipeline(daxa::ComputePipelineInfo{
+                                    .shader = stage_infos[static_cast<size_t>(ShaderStage::COMPUTE)][0],
+                                    .push_constant_size = desc.push_constant_size,
+                                    .name = desc.name,
+                                })));
+          continue;
+        }
+
+        std::vector<daxa::RayTracingShaderGroupInfo> shader_groups = {};
+        for (auto const &group : desc.groups)
+          shader_groups.push_back(get_shader_group_info(group));
+        set_pipeline(desc.id, std::make_shared<daxa::RayTracingPipeline>(device.create_ray_tracing_pipeline(daxa::RayTracingPipelineInfo{
+                                  .ray_gen_shaders = stage_infos[static_cast<size_t>(ShaderStage::RAY_GEN)],
+                                  .intersection_shaders = stage_infos[static_cast<size_t>(ShaderStage::INTERSECTION)],
+                                  .any_hit_shaders = stage_infos[static_cast<size_t>(ShaderStage::ANY_HIT)],
+                                  .callable_shaders = stage_infos[static_cast<size_t>(ShaderStage::CALLABLE)],
+                                  .closest_hit_shaders = stage_infos[static_cast<size_t>(ShaderStage::CLOSEST_HIT)],
+                                  .miss_hit_shaders = stage_infos[static_cast<size_t>(ShaderStage::MISS)],
+                                  .shader_groups = shader_groups,
+                                  .max_ray_recursion_depth = status.max_depth,
+                                  .push_constant_size = desc.push_constant_size,
+                                  .name = desc.name,
+                              })));
+      }
+    }
+
+    ShaderCacheSettings get_shader_cache_settings()
+    {
+      return ShaderCacheSettings{
+          .cache_dir = SHADER_CACHE_DIR,
+          .include_dirs = {DAXA_SHADER_INCLUDE_DIR},
+          .glsl_compiler = SHADER_CACHE_GLSL_COMPILER,
+          .slang_compiler = SHADER_CACHE_SLANG_COMPILER,
+      };
+    }
+
+#if SHADER_PACK_ON == 1
+    // SPIR-V of the shader pack built with the shaders target, false when it's missing, lacks a permutation or is older
+    // than the sources next to it
+    bool create_packed_pipelines(std::vector<PipelineDesc> const &pipeline_descs)
+    {
+      ShaderPack pack = {};
+      if (!read_shader_pack(SHADER_PACK_PATH, pack))
+        return false;
+
+      auto shaders = get_pipeline_shaders(pipeline_descs);
+      std::vector<std::vector<daxa_u32> const *> spirv = {};
+      for (ShaderPermutation const *shader : shaders)
+      {
+        spirv.push_back(pack.find_spirv(*shader));
+        if (!spirv.back())
+        {
+          std::cerr << "create_packed_pipelines: " << shader->source << " (" << get_shader_stage_name(shader->stage) << ") isn't in "
+                    << SHADER_PACK_PATH << ", rebuild the shaders target" << std::endl;
+          return false;
+        }
+      }
+
+      // Next to the sources (development) a pack older than them would run the old SPIR-V of the edited shaders
+      uint32_t stale_count = get_stale_shader_count(pack, shaders, get_shader_cache_settings());
+      if (stale_count > 0)
+      {
+        std::cerr << "create_packed_pipelines: " << stale_count << " shaders changed since " << SHADER_PACK_PATH
+                  << " was built, rebuild the shaders target" << std::endl;
+        return false;
+      }
+
+      create_pipelines(pipeline_descs, spirv);
+      // The pack may hold binaries of permutations these pipelines don't use
+      auto unique_spirv = spirv;
+      std::sort(unique_spirv.begin(), unique_spirv.end());
+      shader_cache_report = {.shader_count = static_cast<daxa_u32>(shaders.size()),
+                             .unique_count = static_cast<daxa_u32>(std::unique(unique_spirv.begin(), unique_spirv.end()) - unique_spirv.begin()),
+                             .hit_count = static_cast<daxa_u32>(shaders.size())};
+      shader_binary_source = SHADER_PACK_PATH;
+      return true;
+    }
+#endif // SHADER_PACK_ON
+
+#if SHADER_CACHE_ON == 1
+    // SPIR-V of the shader cache, misses compiled in parallel. False when a shader doesn't compile
+    bool create_cached_pipelines(std::vector<PipelineDesc> const &pipeline_descs)
+    {
+      TilePool pool;
+      ShaderBinarySet shader_binaries = {};
+      auto shaders = get_pipeline_shaders(pipeline_descs);
+      if (!load_or_compile_shaders(shaders, get_shader_cache_settings(), pool, shader_binaries, &shader_cache_report))
+      {
+        std::cerr << shader_cache_report.errors;
+        return false;
+      }
+
+      std::vector<std::vector<daxa_u32> const *> spirv = {};
+      for (size_t i = 0; i < shaders.size(); ++i)
+        spirv.push_back(&shader_binaries.get(i).spirv);
+      create_pipelines(pipeline_descs, spirv);
+      shader_binary_source = SHADER_CACHE_DIR;
+      return true;
+    }
+#endif // SHADER_CACHE_ON
+
     void load_pipelines()
     {
+      auto pipelines_start = Clock::now();
+
       daxa::ShaderCompileOptions shader_compile_options = {
           .root_paths = {
               DAXA_SHADER_INCLUDE_DIR,
@@ -662,322 +1119,38 @@ void cubeland_app()
           .enable_debug_info = false,
       };
 
-      auto rgen_restir_prepass_selection_compile_options = rt_shader_compile_options;
-      rgen_restir_prepass_selection_compile_options.defines = std::vector{daxa::ShaderDefine{"RESTIR_PREPASS_AND_FIRST_VISIBILITY_TEST", "1"}};
-      if (invocation_reorder_mode == static_cast<daxa_u32>(daxa::InvocationReorderMode::ALLOW_REORDER))
+      auto const pipeline_descs = get_pipeline_descs(invocation_reorder_mode == static_cast<daxa_u32>(daxa::InvocationReorderMode::ALLOW_REORDER));
+      // Shader pack, then shader cache, then the pipeline manager (development mode, hot reload)
+      bool cached = false;
+#if SHADER_PACK_ON == 1
+      cached = create_packed_pipelines(pipeline_descs);
+#endif // SHADER_PACK_ON
+#if SHADER_CACHE_ON == 1
+      if (!cached)
+        cached = create_cached_pipelines(pipeline_descs);
+#endif // SHADER_CACHE_ON
+      if (!cached && (SHADER_PACK_ON == 1 || SHADER_CACHE_ON == 1))
+        std::cerr << "load_pipelines: no SPIR-V for the pipelines, the pipeline manager compiles the shaders" << std::endl;
+      if (!cached)
+        for (auto const &desc : pipeline_descs)
+          add_managed_pipeline(desc, rt_shader_compile_options, slang_shader_compile_options);
+
+      brush_manager = std::make_unique<BRUSH_MNGR>(device, brush_comp_pipeline, BRUSH_MNGR::BrushBufferInfo{status_buffer, world_buffer, restir_buffer});
+
+#if INFO == 1
+      std::cout << "load_pipelines: " << std::chrono::duration<double, std::milli>(Clock::now() - pipelines_start).count() << " ms";
+      if (cached)
       {
-        rgen_restir_prepass_selection_compile_options.defines.push_back(daxa::ShaderDefine{"SER", "1"});
+        std::cout << ", " << shader_cache_report.shader_count << " shaders (" << shader_cache_report.unique_count << " unique), "
+                  << shader_cache_report.hit_count << " hits in " << shader_binary_source;
+        if (shader_cache_report.compiled_count > 0)
+          std::cout << ", " << shader_cache_report.compiled_count << " compiled on " << shader_cache_report.thread_count << " threads in "
+                    << shader_cache_report.compile_ms << " ms";
       }
-
-      auto rgen_restir_shading_selection_compile_options = rt_shader_compile_options;
-      rgen_restir_shading_selection_compile_options.defines = std::vector{daxa::ShaderDefine{"THIRD_VISIBILITY_TEST_AND_SHADING_PASS", "1"}};
-      if (invocation_reorder_mode == static_cast<daxa_u32>(daxa::InvocationReorderMode::ALLOW_REORDER))
-      {
-        rgen_restir_shading_selection_compile_options.defines.push_back(daxa::ShaderDefine{"SER", "1"});
-      }
-
-      auto shadow_miss_compile_options = rt_shader_compile_options;
-      shadow_miss_compile_options.defines = std::vector{daxa::ShaderDefine{"MISS_SHADOW", "1"}};
-
-      auto tex_call_compile_options = rt_shader_compile_options;
-      tex_call_compile_options.defines = std::vector{daxa::ShaderDefine{"MATERIAL_TEXTURE", "1"}};
-
-      auto perlin_call_compile_options = rt_shader_compile_options;
-      perlin_call_compile_options.defines = std::vector{daxa::ShaderDefine{"PERLIN_TEXTURE", "1"}};
-
-      auto metallic_call_compile_options = rt_shader_compile_options;
-      metallic_call_compile_options.defines = std::vector{daxa::ShaderDefine{"METAL", "1"}};
-
-      auto dielectric_call_compile_options = rt_shader_compile_options;
-      dielectric_call_compile_options.defines = std::vector{daxa::ShaderDefine{"DIELECTRIC", "1"}};
-
-      auto emissive_call_compile_options = rt_shader_compile_options;
-      emissive_call_compile_options.defines = std::vector{daxa::ShaderDefine{"EMISSIVE", "1"}};
-
-      auto constant_medium_call_compile_options = rt_shader_compile_options;
-      constant_medium_call_compile_options.defines = std::vector{daxa::ShaderDefine{"CONSTANT_MEDIUM", "1"}};
-
-      auto ris_selection_compile_options = rt_shader_compile_options;
-      ris_selection_compile_options.defines = std::vector{daxa::ShaderDefine{"RIS_SELECTION", "1"}};
-      if (invocation_reorder_mode == static_cast<daxa_u32>(daxa::InvocationReorderMode::ALLOW_REORDER))
-      {
-        ris_selection_compile_options.defines.push_back(daxa::ShaderDefine{"SER", "1"});
-      }
-
-      auto indirect_illumination_compile_options = rt_shader_compile_options;
-      indirect_illumination_compile_options.defines = std::vector{daxa::ShaderDefine{"INDIRECT_ILLUMINATION", "1"}};
-      if (invocation_reorder_mode == static_cast<daxa_u32>(daxa::InvocationReorderMode::ALLOW_REORDER))
-      {
-        indirect_illumination_compile_options.defines.push_back(daxa::ShaderDefine{"SER", "1"});
-      }
-
-      auto const ray_trace_pipe_info = daxa::RayTracingPipelineCompileInfo{
-          .ray_gen_infos = {daxa::ShaderCompileInfo{
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rgen.glsl"},
-                  .compile_options = rgen_restir_prepass_selection_compile_options,
-              }}},
-          .intersection_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rint.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-          },
-          .any_hit_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rahit.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-          },
-          .callable_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_mat.glsl"},
-                  .compile_options = tex_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_mat.glsl"},
-                  .compile_options = perlin_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = metallic_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = dielectric_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = constant_medium_call_compile_options,
-              },
-          },
-          .closest_hit_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rchit.glsl"},
-                  .compile_options = ris_selection_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rchit.glsl"},
-                  .compile_options = indirect_illumination_compile_options,
-              },
-          },
-          .miss_hit_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rmiss.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rmiss.glsl"},
-                  .compile_options = shadow_miss_compile_options,
-              },
-          },
-          .shader_groups_infos = {
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 0,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 11,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 12,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::PROCEDURAL_HIT_GROUP,
-                  .closest_hit_shader_index = 9,
-                  .any_hit_shader_index = 2,
-                  .intersection_shader_index = 1,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::PROCEDURAL_HIT_GROUP,
-                  .closest_hit_shader_index = 10,
-                  .any_hit_shader_index = 2,
-                  .intersection_shader_index = 1,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 3,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 4,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 5,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 6,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 7,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 8,
-              },
-          },
-          .max_ray_recursion_depth = status.max_depth,
-          .push_constant_size = sizeof(PushConstant),
-          .name = "ray trace shader",
-      };
-      primary_hit_rt_pipeline = pipeline_manager.add_ray_tracing_pipeline(ray_trace_pipe_info).value();
-
-      auto const shading_ray_trace_pipe_info = daxa::RayTracingPipelineCompileInfo{
-          .ray_gen_infos = {daxa::ShaderCompileInfo{
-              .source = daxa::ShaderFile{"rgen.glsl"},
-              .compile_options = rgen_restir_shading_selection_compile_options,
-          }},
-          .intersection_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rint.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-          },
-          .any_hit_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rahit.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-          },
-          .callable_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_mat.glsl"},
-                  .compile_options = tex_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_mat.glsl"},
-                  .compile_options = perlin_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = metallic_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = dielectric_call_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rcall_scatter.glsl"},
-                  .compile_options = constant_medium_call_compile_options,
-              },
-          },
-          .closest_hit_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rchit.glsl"},
-                  .compile_options = ris_selection_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rchit.glsl"},
-                  .compile_options = indirect_illumination_compile_options,
-              },
-          },
-          .miss_hit_infos = {
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rmiss.glsl"},
-                  .compile_options = rt_shader_compile_options,
-              },
-              daxa::ShaderCompileInfo{
-                  .source = daxa::ShaderFile{"rmiss.glsl"},
-                  .compile_options = shadow_miss_compile_options,
-              },
-          },
-          .shader_groups_infos = {
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 0,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 11,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 12,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::PROCEDURAL_HIT_GROUP,
-                  .closest_hit_shader_index = 9,
-                  .any_hit_shader_index = 2,
-                  .intersection_shader_index = 1,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::PROCEDURAL_HIT_GROUP,
-                  .closest_hit_shader_index = 10,
-                  .any_hit_shader_index = 2,
-                  .intersection_shader_index = 1,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 3,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 4,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 5,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 6,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 7,
-              },
-              daxa::RayTracingShaderGroupInfo{
-                  .type = daxa::ShaderGroup::GENERAL,
-                  .general_shader_index = 8,
-              },
-          },
-          .max_ray_recursion_depth = status.max_depth,
-          .push_constant_size = sizeof(PushConstant),
-          .name = "ray trace shader",
-      };
-      shading_rt_pipeline = pipeline_manager.add_ray_tracing_pipeline(shading_ray_trace_pipe_info).value();
-
-      taa_comp_pipeline =
-          pipeline_manager.add_compute_pipeline(
-                              daxa::ComputePipelineCompileInfo{
-                                  .shader_info = daxa::ShaderCompileInfo{
-                                      .source = daxa::ShaderFile{"taa.glsl"},
-                                      .compile_options = rt_shader_compile_options,
-                                  },
-                                  .push_constant_size = sizeof(PushConstant),
-                                  .name = "temporal anti-aliasing shader",
-                              })
-              .value();
-
-      auto rearregement_comp_pipeline_info = slang_shader_compile_options;
-      rearregement_comp_pipeline_info.entry_point = "entry_rearragement";
-
-      rearregement_comp_pipeline =
-          pipeline_manager.add_compute_pipeline(
-                              daxa::ComputePipelineCompileInfo{
-                                  .shader_info = daxa::ShaderCompileInfo{
-                                      .source = daxa::ShaderFile{"rearrangement.slang"},
-                                      .compile_options = rearregement_comp_pipeline_info,
-                                  },
-                                  .push_constant_size = sizeof(changes_push_constant),
-                                  .name = "rearregement shader",
-                              })
-              .value();
-
-      brush_manager = std::make_unique<BRUSH_MNGR>(device, pipeline_manager, slang_shader_compile_options, BRUSH_MNGR::BrushBufferInfo{status_buffer, world_buffer, restir_buffer});
+      else
+        std::cout << " (pipeline manager)";
+      std::cout << std::endl;
+#endif // INFO
     }
 
     void upload_restir()
@@ -996,6 +1169,15 @@ void cubeland_app()
       restir.output_path_reservoir_address = device.get_device_address(output_path_reservoir_buffer).value();
       restir.temporal_path_reservoir_address = device.get_device_address(temporal_path_reservoir_buffer).value();
       restir.indirect_color_address = device.get_device_address(indirect_color_buffer).value();
+#if ADAPTIVE_SAMPLING_ON == 1
+      restir.adaptive_pixel_address = device.get_device_address(adaptive_pixel_buffer).value();
+      restir.adaptive_tile_address = device.get_device_address(adaptive_tile_buffer).value();
+#endif // ADAPTIVE_SAMPLING_ON
+#if DENOISER_ON == 1
+      restir.denoiser_direct_address = device.get_device_address(denoiser_direct_buffer).value();
+      restir.denoiser_history_address = device.get_device_address(denoiser_history_buffer).value();
+      restir.denoiser_signal_address = device.get_device_address(denoiser_signal_buffer).value();
+#endif // DENOISER_ON
 
       // copy restir to buffer
       std::memcpy(restir_buffer_ptr,
@@ -1003,123 +1185,289 @@ void cubeland_app()
                   restir_buffer_size);
     }
 
-    void load_model(const char *model_name, glm::mat4 transform)
+    // Parsed by the load pool, the build is queued by deliver_loaded_models once it is finished.
+    // A model is only parsed once with the same settings, next placements reference the BLASes of the first load
+    // (unless it is emissive).
+    void load_model(const char *model_name, glm::mat4 transform, AXIS_DIRECTION axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
+                    daxa_b32 merge_boxes = MERGED_BOXES_ON == 1)
     {
-      GvoxModelDataSerialize gvox_map_serialize = GvoxModelDataSerialize{
-          .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
-          .max_instance_count = MAX_INSTANCES - as_manager->get_host_instance_count(),
-          .current_instance_index = as_manager->get_host_instance_count(),
-          .instances = as_manager->get_instances(),
-          .current_primitive_index = as_manager->get_host_primitive_count(),
-          .max_primitive_count = MAX_PRIMITIVES - as_manager->get_host_primitive_count(),
-          .primitives = as_manager->get_primitives(),
-          .aabbs = as_manager->get_aabb_host_address(),
-          .current_material_index = current_material_count,
-          .max_material_count = MAX_MATERIALS - current_material_count,
-          .materials = materials.get(),
-          .current_light_index = light_config->cube_light_count,
-          .max_light_count = MAX_CUBE_LIGHTS - light_config->cube_light_count,
-          .lights = as_manager->get_cube_lights(),
+      MODEL_KEY key = {
+          .gvox_model_path = std::string(MODEL_PATH) + "/" + model_name,
+          .axis_direction = axis_direction,
+          .merge_boxes = merge_boxes,
       };
+      auto &model = model_registry[key];
+      daxa_f32mat4x4 placement = glm_mat4_to_daxa_f32mat4x4(transform);
 
-      // load map
-      GvoxModelData gvox_map = map_loader.load_gvox_data(std::string(MODEL_PATH) + "/" + model_name, gvox_map_serialize);
-
-      std::cout << "gvox_map: " << model_name << std::endl;
-      std::cout << "  instances: " << gvox_map.instance_count << std::endl;
-      std::cout << "  primitives: " << gvox_map.primitive_count << std::endl;
-      std::cout << "  materials: " << gvox_map.material_count << std::endl;
+      if (model.model_index != 0)
+      {
+        if (model.emissive)
+        {
+          load_unshared_placement(key, placement);
+        }
+        else if (model.delivered)
+        {
+          as_manager->task_queue_add(TASK{
+              .type = TASK::TYPE::INSTANCE_BLAS_FROM_CPU,
+              .blas_instance_from_cpu = {.model_index = model.model_index,
+                                         .transform = placement},
+          });
+        }
+        else
+        {
+          model.pending_placements.push_back(placement);
+        }
+        return;
+      }
 
-      light_config->cube_light_count += gvox_map.light_count;
+      model.model_index = ++registered_model_count;
 
-      load_materials(gvox_map.material_count, current_material_count, true);
+      model_load_pool->load_async(GvoxModelLoadInfo{
+          .gvox_model_path = key.gvox_model_path,
+          .transform = placement,
+          .axis_direction = key.axis_direction,
+          .merge_boxes = key.merge_boxes != 0,
+          .model_index = model.model_index,
+      });
+    }
 
-      as_manager->task_queue_add(TASK{
-          .type = TASK::TYPE::BUILD_BLAS_FROM_CPU,
-          .blas_build_from_cpu = {.instance_count = gvox_map.instance_count,
-                                  .primitive_count = gvox_map.primitive_count,
-                                  .transform = glm_mat4_to_daxa_f32mat4x4(transform)},
+    void load_unshared_placement(MODEL_KEY const &key, daxa_f32mat4x4 placement)
+    {
+      model_load_pool->load_async(GvoxModelLoadInfo{
+          .gvox_model_path = key.gvox_model_path,
+          .transform = placement,
+          .axis_direction = key.axis_direction,
+          .merge_boxes = key.merge_boxes != 0,
       });
     }
 
-    void load_scene()
+    // Rebase a parsed region into the scene and queue its build
+    bool queue_region_chunk(GvoxRegionChunk &chunk, daxa_f32mat4x4 transform, u32 first_material_index, u32 model_index = 0)
     {
-      GvoxModelDataSerialize gvox_map_serialize = GvoxModelDataSerialize{
-          .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
-          .max_instance_count = MAX_INSTANCES - as_manager->get_host_instance_count(),
-          .current_instance_index = as_manager->get_host_instance_count(),
-          .instances = as_manager->get_instances(),
-          .current_primitive_index = as_manager->get_host_primitive_count(),
-          .max_primitive_count = MAX_PRIMITIVES - as_manager->get_host_primitive_count(),
-          .primitives = as_manager->get_primitives(),
-          .aabbs = as_manager->get_aabb_host_address(),
-          .current_material_index = current_material_count,
-          .max_material_count = MAX_MATERIALS - current_material_count,
-          .materials = materials.get(),
-          .current_light_index = light_config->cube_light_count,
-          .max_light_count = MAX_CUBE_LIGHTS - light_config->cube_light_count,
-          .lights = as_manager->get_cube_lights(),
-      };
+      u32 primitive_count = static_cast<u32>(chunk.aabbs.size());
+      u32 first_light_index = light_config->cube_light_count;
+
+      if (first_material_index + chunk.materials.size() > MAX_MATERIALS ||
+          first_light_index + chunk.lights.size() > MAX_CUBE_LIGHTS)
+      {
+        std::cout << "queue_region_chunk: not enough room for region, " << primitive_count << " primitives dropped" << std::endl;
+        return false;
+      }
+
+      // Rebase region local indices
+      for (auto &primitive : chunk.primitives)
+      {
+        primitive.material_index += first_material_index;
+        if (primitive.light_index != static_cast<u32>(-1))
+          primitive.light_index += first_light_index;
+      }
 
-      // load map
-      GvoxModelData gvox_map = map_loader.load_gvox_data(std::string(MODEL_PATH) + "/" + MAP_NAME, gvox_map_serialize);
+      chunk.instance.primitive_count = primitive_count;
 
-      std::cout << "gvox_map: " << MAP_NAME << std::endl;
-      std::cout << "  instances: " << gvox_map.instance_count << std::endl;
-      std::cout << "  primitives: " << gvox_map.primitive_count << std::endl;
-      std::cout << "  materials: " << gvox_map.material_count << std::endl;
+      u32 instance_index = 0;
+      std::vector<u32> voxel_ids = {};
+      if (!as_manager->task_queue_add_instance(chunk.instance, chunk.aabbs.data(), chunk.primitives.data(), transform, instance_index, model_index, &voxel_ids))
+      {
+        return false;
+      }
 
-      light_config->cube_light_count += gvox_map.light_count;
+      std::memcpy(materials.get() + first_material_index,
+                  chunk.materials.data(),
+                  chunk.materials.size() * sizeof(MATERIAL));
 
-      load_materials(gvox_map.material_count, current_material_count, false);
+      LIGHT *cube_lights = as_manager->get_cube_lights() + first_light_index;
+      for (u32 i = 0; i < chunk.lights.size(); i++)
+      {
+        cube_lights[i] = chunk.lights[i];
+        cube_lights[i].instance_info.instance_id = instance_index;
+#if BRICK_PRIMITIVES_ON == 1
+        // Lights point to their voxel inside of its brick
+        cube_lights[i].instance_info.primitive_id = voxel_ids[cube_lights[i].instance_info.primitive_id];
+#endif // BRICK_PRIMITIVES_ON
+      }
+      light_config->cube_light_count += static_cast<u32>(chunk.lights.size());
 
-      as_manager->task_queue_add(TASK{
-          .type = TASK::TYPE::BUILD_BLAS_FROM_CPU,
-          .blas_build_from_cpu = {.instance_count = gvox_map.instance_count,
-                                  .primitive_count = gvox_map.primitive_count,
-                                  .transform = glm_mat4_to_daxa_f32mat4x4(glm::mat4(1.0f))},
-      });
+      return true;
+    }
 
-      GvoxModelDataSerialize gvox_map_serialize_deer = GvoxModelDataSerialize{
-          .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
-          .max_instance_count = MAX_INSTANCES - as_manager->get_host_instance_count(),
-          .current_instance_index = as_manager->get_host_instance_count(),
-          .instances = as_manager->get_instances(),
-          .current_primitive_index = as_manager->get_host_primitive_count(),
-          .max_primitive_count = MAX_PRIMITIVES - as_manager->get_host_primitive_count(),
-          .primitives = as_manager->get_primitives(),
-          .aabbs = as_manager->get_aabb_host_address(),
-          .current_material_index = current_material_count,
-          .max_material_count = MAX_MATERIALS - current_material_count,
-          .materials = materials.get(),
-          .current_light_index = light_config->cube_light_count,
-          .max_light_count = MAX_CUBE_LIGHTS - light_config->cube_light_count,
-          .lights = as_manager->get_cube_lights(),
-      };
+    // Queue the build of every model the load pool has finished, in submission order
+    void deliver_loaded_models()
+    {
+      // The first region of a streamed map keeps the first instance ahead of the models
+      if (map_streamer && map_regions_streamed == 0)
+        return;
 
-      // load map
-      gvox_map = map_loader.load_gvox_data(std::string(MODEL_PATH) + "/" + DEER_NAME, gvox_map_serialize_deer);
+      std::vector<GvoxModelLoad> loads = {};
+      if (model_load_pool->pop_finished(loads) == 0)
+        return;
+
+      u32 material_count = 0;
+
+      for (auto &load : loads)
+      {
+        // An emissive model is built as a regular instance, the lights of a prototype would point at a hidden instance
+        bool emissive = std::any_of(load.chunks.begin(), load.chunks.end(),
+                                    [](auto const &chunk)
+                                    { return !chunk.lights.empty(); });
+        u32 model_index = emissive ? 0 : load.model_index;
+
+        for (auto &chunk : load.chunks)
+        {
+          if (queue_region_chunk(chunk, load.transform, current_material_count + material_count, model_index))
+            material_count += static_cast<u32>(chunk.materials.size());
+        }
+
+        if (load.model_index != 0)
+        {
+          // Registered models are built as hidden prototypes, the first placement is the load itself
+          auto model = std::find_if(model_registry.begin(), model_registry.end(),
+                                    [&](auto const &entry)
+                                    { return entry.second.model_index == load.model_index; });
+          std::vector<daxa_f32mat4x4> placements = {load.transform};
+          if (model != model_registry.end())
+          {
+            placements.insert(placements.end(), model->second.pending_placements.begin(), model->second.pending_placements.end());
+            model->second.pending_placements.clear();
+            model->second.delivered = true;
+            model->second.emissive = emissive;
+          }
+
+          if (emissive)
+          {
+            // The load itself is the first placement, the others are loaded with their own lights
+            for (size_t i = 1; i < placements.size(); i++)
+              load_unshared_placement(model->first, placements[i]);
+          }
+          else
+          {
+            for (auto const &placement : placements)
+            {
+              as_manager->task_queue_add(TASK{
+                  .type = TASK::TYPE::INSTANCE_BLAS_FROM_CPU,
+                  .blas_instance_from_cpu = {.model_index = load.model_index,
+                                             .transform = placement},
+              });
+            }
+          }
+        }
+
+        if (load.gvox_model_path.filename() == DEER_NAME)
+          deer_loaded = load.model_data.instance_count > 0;
+
+        std::cout << "gvox_map: " << load.gvox_model_path.filename().string() << std::endl;
+        std::cout << "  instances: " << load.model_data.instance_count << std::endl;
+        std::cout << "  primitives: " << load.model_data.primitive_count << std::endl;
+        std::cout << "  materials: " << load.model_data.material_count << std::endl;
+      }
+
+      if (material_count > 0)
+      {
+        load_materials(material_count, current_material_count, false);
+      }
+
+      if (light_config->cube_light_count > 0)
+      {
+        light_config->brdf_count = BRDF_SAMPLING_COUNT;
+      }
+
+#if LIGHT_TREE_ON == 1
+      // The lights of the new models go into the tree
+      as_manager->update_light_tree(light_config->cube_light_count);
+#endif // LIGHT_TREE_ON
+    }
+
+    // Hand the regions parsed by the map streamer over to the acceleration structure manager, nearest to the camera first
+    void stream_map_regions()
+    {
+      if (!map_streamer)
+        return;
+
+      // Regions popped on previous frames were queued at the latest on the previous update_scene call
+      if (map_streamer->is_done())
+      {
+#if INFO == 1
+        GvoxModelData gvox_map = map_streamer->get_model_data();
+        std::cout << "gvox_map: " << MAP_NAME << " streamed" << std::endl;
+        std::cout << "  regions: " << map_regions_streamed << std::endl;
+        std::cout << "  primitives: " << gvox_map.primitive_count << std::endl;
+        std::cout << "  materials: " << gvox_map.material_count << std::endl;
+        std::cout << "  parse time: " << map_streamer->get_parse_time_ms() << " ms" << std::endl;
+        std::cout << "  time to full scene: " << std::chrono::duration<double, std::milli>(Clock::now() - scene_load_start).count() << " ms" << std::endl;
+#endif // INFO
+        map_streamer.reset();
+        return;
+      }
+
+      // The first region goes alone so the map keeps the first instance, the next ones wait for the models loaded with
+      // the scene so the deer keeps the second one
+      if (map_regions_streamed > 0 && !model_load_pool->is_idle())
+        return;
+      u32 max_region_count = map_regions_streamed == 0 ? 1 : streamed_regions_per_frame;
+      glm::vec3 camera_position = camera_get_position(camera);
+
+      std::vector<GvoxRegionChunk> chunks = {};
+      if (map_streamer->pop_nearest(daxa_f32vec3{camera_position.x, camera_position.y, camera_position.z}, max_region_count, chunks) == 0)
+        return;
+
+      u32 material_count = 0;
+
+      for (auto &chunk : chunks)
+      {
+        if (queue_region_chunk(chunk, glm_mat4_to_daxa_f32mat4x4(glm::mat4(1.0f)), current_material_count + material_count))
+        {
+          material_count += static_cast<u32>(chunk.materials.size());
+          ++map_regions_streamed;
+        }
+      }
 
-      std::cout << "gvox_map" << std::endl;
-      std::cout << "  instances: " << gvox_map.instance_count << std::endl;
-      std::cout << "  primitives: " << gvox_map.primitive_count << std::endl;
-      std::cout << "  materials: " << gvox_map.material_count << std::endl;
+      if (material_count > 0)
+      {
+        load_materials(material_count, current_material_count, false);
+      }
 
-      light_config->cube_light_count += gvox_map.light_count;
+      if (light_config->cube_light_count > 0)
+      {
+        light_config->brdf_count = BRDF_SAMPLING_COUNT;
+      }
 
-      load_materials(gvox_map.material_count, current_material_count, true);
+#if LIGHT_TREE_ON == 1
+      as_manager->update_light_tree(light_config->cube_light_count);
+#endif // LIGHT_TREE_ON
+    }
 
-      glm::mat4 transform = glm::mat4(1.0f);
-      transform = glm::translate(transform, glm::vec3(VOXEL_EXTENT * 15, -VOXEL_EXTENT * 35, -VOXEL_EXTENT * 50));
+    void load_scene()
+    {
+      scene_load_start = Clock::now();
+
+#if STREAMING_MAP_ON == 1
+      // Regions are picked up by stream_map_regions on every frame, the deer by deliver_loaded_models after the first one
+      map_streamer = std::make_unique<MapStreamer>();
+      map_streamer->start(std::string(MODEL_PATH) + "/" + MAP_NAME, AXIS_DIRECTION::X_BOTTOM_TOP, MERGED_BOXES_ON == 1);
+#else
+      auto map_load = model_load_pool->load_async(GvoxModelLoadInfo{
+          .gvox_model_path = std::string(MODEL_PATH) + "/" + MAP_NAME,
+          .transform = glm_mat4_to_daxa_f32mat4x4(glm::mat4(1.0f)),
+          .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
+          .merge_boxes = MERGED_BOXES_ON == 1,
+      });
+#endif // STREAMING_MAP_ON
 
-      as_manager->task_queue_add(TASK{
-          .type = TASK::TYPE::BUILD_BLAS_FROM_CPU,
-          .blas_build_from_cpu = {.instance_count = gvox_map.instance_count,
-                                  .primitive_count = gvox_map.primitive_count,
-                                  .transform = glm_mat4_to_daxa_f32mat4x4(transform)},
+      // Map and deer are parsed concurrently
+      glm::mat4 deer_transform = glm::translate(glm::mat4(1.0f), glm::vec3(VOXEL_EXTENT * 15, -VOXEL_EXTENT * 35, -VOXEL_EXTENT * 50));
+      auto deer_load = model_load_pool->load_async(GvoxModelLoadInfo{
+          .gvox_model_path = std::string(MODEL_PATH) + "/" + DEER_NAME,
+          .transform = glm_mat4_to_daxa_f32mat4x4(deer_transform),
+          .axis_direction = AXIS_DIRECTION::X_BOTTOM_TOP,
+          .merge_boxes = MERGED_BOXES_ON == 1,
       });
 
-      deer_loaded = true;
+#if STREAMING_MAP_ON == 0
+      // The scene waits for the slowest one
+      map_load.wait();
+      deer_load.wait();
+
+      deliver_loaded_models();
+#endif // STREAMING_MAP_ON
 
       // Update the scene
       as_manager->update_scene(true);
@@ -1162,8 +1510,30 @@ void cubeland_app()
             }
             return 1;
           },
+#if PROFILER_ON == 1 && PROFILER_OVERLAY_ON == 1
+          // The overlay is rendered over the frame
+          .image_usage = daxa::ImageUsageFlagBits::SHADER_STORAGE | daxa::ImageUsageFlagBits::COLOR_ATTACHMENT,
+#else
           .image_usage = daxa::ImageUsageFlagBits::SHADER_STORAGE,
+#endif // PROFILER_OVERLAY_ON
+      });
+
+#if PROFILER_ON == 1
+      timestamp_query_pool = device.create_timeline_query_pool({
+          .query_count = profiler.get_gpu_query_count(),
+          .name = "timestamp_query_pool",
+      });
+      timestamp_period_ns = device.properties().limits.timestamp_period;
+#if PROFILER_OVERLAY_ON == 1
+      // After the callbacks of the window, ImGui chains them
+      ImGui::CreateContext();
+      ImGui_ImplGlfw_InitForVulkan(glfw_window_ptr, true);
+      imgui_renderer = daxa::ImGuiRenderer({
+          .device = device,
+          .format = swapchain.get_format(),
       });
+#endif // PROFILER_OVERLAY_ON
+#endif // PROFILER_ON
 
       taa_image[0] = device.create_image({
           .format = swapchain.get_format(),
@@ -1224,55 +1594,8 @@ void cubeland_app()
           .name = ("restir_bufffer"),
       });
 
-      previous_reservoir_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_reservoir_buffer_size,
-          .name = ("previous_reservoir_buffer"),
-      });
-
-      intermediate_reservoir_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_reservoir_buffer_size,
-          .name = ("intermediate_reservoir_buffer"),
-      });
-
-      reservoir_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_reservoir_buffer_size,
-          .name = ("reservoir_buffer"),
-      });
-
-      velocity_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_velocity_buffer_size,
-          .name = ("velocity_buffer"),
-      });
-
-      previous_direct_illum_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_direct_illum_buffer_size,
-          .name = ("previous_direct_illum_buffer"),
-      });
-
-      direct_illum_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_direct_illum_buffer_size,
-          .name = ("direct_illum_buffer"),
-      });
-
-      // pixel_reconnection_data_buffer = device.create_buffer(daxa::BufferInfo{
-      //     .size = max_pixel_reconnection_data_buffer_size,
-      //     .name = ("pixel_reconnection_data_buffer"),
-      // });
-
-      output_path_reservoir_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_output_path_reservoir_buffer_size,
-          .name = ("output_path_reservoir_buffer"),
-      });
-
-      temporal_path_reservoir_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_output_path_reservoir_buffer_size,
-          .name = ("temporal_path_reservoir_buffer"),
-      });
-
-      indirect_color_buffer = device.create_buffer(daxa::BufferInfo{
-          .size = max_indirect_color_buffer_size,
-          .name = ("indirect_color_buffer"),
-      });
+      create_pixel_buffers(swapchain.get_surface_extent().x, swapchain.get_surface_extent().y);
+      report_pixel_buffer_memory();
 
       light_config = device.get_host_address_as<LIGHT_CONFIG>(light_config_buffer).value();
 
@@ -1306,11 +1629,13 @@ void cubeland_app()
       status.brush_counter_address = device.get_device_address(as_manager->get_brush_counter_buffer()).value();
       status.instance_bitmask_address = device.get_device_address(as_manager->get_brush_instance_bitmask_buffer()).value();
       status.primitive_bitmask_address = device.get_device_address(as_manager->get_brush_primitive_bitmask_buffer()).value();
+      status.brush_range_owner_address = device.get_device_address(as_manager->get_brush_range_owner_buffer()).value();
+      status.brush_box_hit_address = device.get_device_address(as_manager->get_brush_box_hit_buffer()).value();
 
       materials = std::make_unique<MATERIAL[]>(MAX_MATERIALS);
 
-      // Create a new context for the gvox library
-      map_loader.create_gvox_context();
+      // Every load thread has its own gvox context
+      model_load_pool = std::make_unique<ModelLoadPool>();
 
       load_scene();
 
@@ -1412,17 +1737,51 @@ void cubeland_app()
 
       if (!minimized)
       {
+#if PROFILER_ON == 1
+        profiler.begin_frame();
+#endif // PROFILER_ON
 #if POINT_LIGHT_ON == 1
         update_time_and_sun_light();
 #endif // DYNAMIC_SUN_LIGHT == 1
         update_model_animation();
-        // Update the scene if needed
-        as_manager->update_scene();
-        upload_world();
-        draw();
+        {
+          PROFILE_CPU_SCOPE(profiler, "stream_scene");
+          stream_map_regions();
+          deliver_loaded_models();
+        }
+        {
+          PROFILE_CPU_SCOPE(profiler, "update_scene");
+          // Update the scene if needed
+          as_manager->update_scene();
+#if LIGHT_ALIAS_TABLE_ON == 1
+          // Loaded, deleted & restored lights since the last frame rebuild the table
+          as_manager->update_light_alias_table(light_config->cube_light_count);
+#endif // LIGHT_ALIAS_TABLE_ON
+        }
+        {
+          PROFILE_CPU_SCOPE(profiler, "upload_world");
+          upload_world();
+        }
+        {
+          PROFILE_CPU_SCOPE(profiler, "draw");
+          draw();
+        }
+#if INFO == 1
+        if (!first_frame_drawn)
+        {
+          first_frame_drawn = true;
+          std::cout << "time to first frame: " << std::chrono::duration<double, std::milli>(Clock::now() - scene_load_start).count() << " ms" << std::endl;
+        }
+#endif // INFO
         if(status.is_active & PERFECT_PIXEL_BIT)
           brush_manager->execute_brush(status.resolution, true);
-        download_gpu_info();
+        {
+          PROFILE_CPU_SCOPE(profiler, "download_gpu_info");
+          download_gpu_info();
+        }
+#if PROFILER_ON == 1
+        profiler.end_frame();
+#endif // PROFILER_ON
       }
       else
       {
@@ -1433,9 +1792,84 @@ void cubeland_app()
       return false;
     }
 
+    // Timestamp pair around a pass, each written once the commands before it have completed
+    void profile_gpu_begin(daxa::CommandRecorder &recorder, std::string_view name)
+    {
+#if PROFILER_ON == 1
+      u32 query = profiler.begin_gpu_scope(name);
+      if (query != PROFILER_INVALID_QUERY)
+        recorder.write_timestamp({
+            .query_pool = timestamp_query_pool,
+            .pipeline_stage = daxa::PipelineStageFlagBits::ALL_COMMANDS,
+            .query_index = query,
+        });
+#endif // PROFILER_ON
+    }
+
+    void profile_gpu_end(daxa::CommandRecorder &recorder)
+    {
+#if PROFILER_ON == 1
+      u32 query = profiler.end_gpu_scope();
+      if (query != PROFILER_INVALID_QUERY)
+        recorder.write_timestamp({
+            .query_pool = timestamp_query_pool,
+            .pipeline_stage = daxa::PipelineStageFlagBits::ALL_COMMANDS,
+            .query_index = query,
+        });
+#endif // PROFILER_ON
+    }
+
+#if PROFILER_ON == 1
+    void export_profiler_trace()
+    {
+      std::filesystem::path trace_path = "cube-tracing-trace.json";
+      if (profiler.write_chrome_trace(trace_path))
+        std::cout << "Chrome trace of the last " << profiler.get_event_count() << " scopes written to " << trace_path.string() << std::endl;
+    }
+
+#if PROFILER_OVERLAY_ON == 1
+    void draw_profiler_overlay()
+    {
+      ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+      ImGui::SetNextWindowBgAlpha(0.75f);
+      if (ImGui::Begin("Profiler", &show_profiler_overlay, ImGuiWindowFlags_AlwaysAutoResize))
+      {
+        ImGui::Text("frame %llu, last %u frames, dropped GPU frames %u", static_cast<unsigned long long>(profiler.get_frame()),
+                    PROFILER_HISTORY_FRAMES, profiler.get_dropped_gpu_frames());
+        if (ImGui::BeginTable("profiler_scopes", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+        {
+          for (char const *header : {"scope (ms)", "last", "mean", "p50", "p99", "max"})
+            ImGui::TableSetupColumn(header);
+          ImGui::TableHeadersRow();
+          for (auto const &row : profiler.get_report())
+          {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s %*s%.*s", row.track == ProfileTrack::CPU ? "cpu" : "gpu", static_cast<int>(2 * row.depth), "",
+                        static_cast<int>(row.name.size()), row.name.data());
+            for (daxa_f64 value : {row.stats.last_ms, row.stats.mean_ms, row.stats.p50_ms, row.stats.p99_ms, row.stats.max_ms})
+            {
+              ImGui::TableNextColumn();
+              ImGui::Text("%8.3f", value);
+            }
+          }
+          ImGui::EndTable();
+        }
+        if (ImGui::Button("Export Chrome trace (O)"))
+          export_profiler_trace();
+      }
+      ImGui::End();
+    }
+#endif // PROFILER_OVERLAY_ON
+#endif // PROFILER_ON
+
     void draw()
     {
-      auto swapchain_image = swapchain.acquire_next_image();
+      auto swapchain_image = [&]
+      {
+        PROFILE_CPU_SCOPE(profiler, "acquire");
+        return swapchain.acquire_next_image();
+      }();
       if (swapchain_image.is_empty())
       {
         return;
@@ -1444,6 +1878,17 @@ void cubeland_app()
           .name = ("recorder (clearcolor)"),
       });
 
+#if PROFILER_ON == 1
+      // The set of the frame that last used these queries has retired (acquire waited for it), read it back first
+      auto timestamp_queries = profiler.begin_gpu_frame(status.frame_number, timestamp_period_ns, [this](u32 first, u32 count)
+                                                        { return timestamp_query_pool.get_query_results(first, count); });
+      recorder.reset_timestamps({
+          .query_pool = timestamp_query_pool,
+          .start_index = timestamp_queries.first,
+          .count = timestamp_queries.count,
+      });
+#endif // PROFILER_ON
+
       daxa::u32 width = device.info_image(swapchain_image).value().size.x;
       daxa::u32 height = device.info_image(swapchain_image).value().size.y;
 
@@ -1542,6 +1987,7 @@ void cubeland_app()
           .dst_access = daxa::AccessConsts::TRANSFER_READ,
       });
 
+      profile_gpu_begin(recorder, "uploads");
       recorder.copy_buffer_to_buffer({
           .src_buffer = cam_staging_buffer,
           .dst_buffer = cam_buffer,
@@ -1554,6 +2000,7 @@ void cubeland_app()
               .dst_buffer = status_buffer,
               .size = status_buffer_size,
           });
+      profile_gpu_end(recorder);
 
       recorder.pipeline_barrier({
           .src_access = daxa::AccessConsts::TRANSFER_WRITE,
@@ -1582,11 +2029,13 @@ void cubeland_app()
           .restir_buffer = this->device.get_device_address(restir_buffer).value(),
       });
 
+      profile_gpu_begin(recorder, "primary_rays");
       recorder.trace_rays({
           .width = width,
           .height = height,
           .depth = 1,
       });
+      profile_gpu_end(recorder);
 
       recorder.pipeline_barrier({
           .src_access = daxa::AccessConsts::RAY_TRACING_SHADER_WRITE,
@@ -1608,11 +2057,67 @@ void cubeland_app()
           .restir_buffer = this->device.get_device_address(restir_buffer).value(),
       });
 
+      profile_gpu_begin(recorder, "shading_rays");
       recorder.trace_rays({
           .width = width,
           .height = height,
           .depth = 1,
       });
+      profile_gpu_end(recorder);
+
+#if DENOISER_ON == 1
+      // Temporal pass, then the a-trous iterations (the last one writes the hit pixels of the frame TAA reads)
+      recorder.pipeline_barrier({
+          .src_access = daxa::AccessConsts::RAY_TRACING_SHADER_WRITE,
+          .dst_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+      });
+
+      for (daxa_u32 denoiser_pass = 0; denoiser_pass <= DENOISER_ATROUS_ITERATIONS; ++denoiser_pass)
+      {
+        if (denoiser_pass > 0)
+        {
+          recorder.pipeline_barrier({
+              .src_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+              .dst_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+          });
+        }
+
+        recorder.set_pipeline(denoiser_pass == 0 ? *denoiser_temporal_comp_pipeline : *denoiser_atrous_comp_pipeline);
+
+        recorder.push_constant(PushConstant{
+            .size = {width, height},
+            .tlas = as_manager->get_current_tlas(),
+            .tlas_previous = as_manager->get_previous_tlas(),
+            .swapchain = swapchain_image_view,
+            .previous_swapchain = previous_swapchain_image_view,
+            .taa_frame = taa_image_view,
+            .taa_prev_frame = previous_taa_image_view,
+            .camera_buffer = this->device.get_device_address(cam_buffer).value(),
+            .status_buffer = this->device.get_device_address(status_buffer).value(),
+            .world_buffer = this->device.get_device_address(world_buffer).value(),
+            .restir_buffer = this->device.get_device_address(restir_buffer).value(),
+            .filter_iteration = denoiser_pass == 0 ? 0 : denoiser_pass - 1,
+        });
+
+        profile_gpu_begin(recorder, denoiser_pass == 0 ? "denoiser_temporal" : "denoiser_atrous");
+        recorder.dispatch({
+            .x = (width + 7) / 8,
+            .y = (height + 7) / 8,
+            .z = 1,
+        });
+        profile_gpu_end(recorder);
+      }
+
+      recorder.pipeline_barrier({
+          .src_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+          .dst_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+      });
+
+      recorder.pipeline_barrier({
+          .src_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+          .dst_access = daxa::AccessConsts::TRANSFER_READ,
+      });
+#endif // DENOISER_ON
 
       if (filter_activated)
       {
@@ -1638,11 +2143,13 @@ void cubeland_app()
             .restir_buffer = this->device.get_device_address(restir_buffer).value(),
         });
 
+        profile_gpu_begin(recorder, "taa");
         recorder.dispatch({
             .x = width / 8,
             .y = height / 8,
             .z = 1,
         });
+        profile_gpu_end(recorder);
 
         recorder.pipeline_barrier({
             .src_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
@@ -1657,6 +2164,7 @@ void cubeland_app()
         });
       }
 
+      profile_gpu_begin(recorder, "camera_history_copy");
       recorder.copy_buffer_to_buffer({
           .src_buffer = cam_buffer,
           .dst_buffer = cam_buffer,
@@ -1664,15 +2172,42 @@ void cubeland_app()
           .dst_offset = cam_update_size,
           .size = previous_matrices,
       });
+      profile_gpu_end(recorder);
 
       recorder.pipeline_barrier({
           .src_access = daxa::AccessConsts::TRANSFER_WRITE,
           .dst_access = daxa::AccessConsts::HOST_READ,
       });
 
+      daxa::Access present_src_access = daxa::AccessConsts::RAY_TRACING_SHADER_WRITE;
+      daxa::ImageLayout present_src_layout = daxa::ImageLayout::GENERAL;
+
+#if PROFILER_ON == 1 && PROFILER_OVERLAY_ON == 1
+      ImGui_ImplGlfw_NewFrame();
+      ImGui::NewFrame();
+      if (show_profiler_overlay)
+        draw_profiler_overlay();
+      ImGui::Render();
+
       recorder.pipeline_barrier_image_transition({
-          .src_access = daxa::AccessConsts::RAY_TRACING_SHADER_WRITE,
+          .src_access = daxa::AccessConsts::WRITE,
+          .dst_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_READ_WRITE,
           .src_layout = daxa::ImageLayout::GENERAL,
+          .dst_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+          .image_id = swapchain_image,
+      });
+
+      profile_gpu_begin(recorder, "overlay");
+      imgui_renderer.record_commands(ImGui::GetDrawData(), recorder, swapchain_image, width, height);
+      profile_gpu_end(recorder);
+
+      present_src_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE;
+      present_src_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL;
+#endif // PROFILER_OVERLAY_ON
+
+      recorder.pipeline_barrier_image_transition({
+          .src_access = present_src_access,
+          .src_layout = present_src_layout,
           .dst_layout = daxa::ImageLayout::PRESENT_SRC,
           .image_id = swapchain_image,
       });
@@ -1682,17 +2217,23 @@ void cubeland_app()
       /// Must destroy the command recorder here as we call collect_garbage later in this scope!
       recorder.~CommandRecorder();
 
-      device.submit_commands({
-          .command_lists = std::array{executalbe_commands},
-          .wait_binary_semaphores = std::array{swapchain.current_acquire_semaphore()},
-          .signal_binary_semaphores = std::array{swapchain.current_present_semaphore()},
-          .signal_timeline_semaphores = std::array{std::pair{swapchain.gpu_timeline_semaphore(), swapchain.current_cpu_timeline_value()}},
-      });
+      {
+        PROFILE_CPU_SCOPE(profiler, "submit_present");
+        device.submit_commands({
+            .command_lists = std::array{executalbe_commands},
+            .wait_binary_semaphores = std::array{swapchain.current_acquire_semaphore()},
+            .signal_binary_semaphores = std::array{swapchain.current_present_semaphore()},
+            .signal_timeline_semaphores = std::array{std::pair{swapchain.gpu_timeline_semaphore(), swapchain.current_cpu_timeline_value()}},
+        });
+#if PROFILER_ON == 1
+        profiler.submit_gpu_frame();
+#endif // PROFILER_ON
 
-      device.present_frame({
-          .wait_binary_semaphores = std::array{swapchain.current_present_semaphore()},
-          .swapchain = swapchain,
-      });
+        device.present_frame({
+            .wait_binary_semaphores = std::array{swapchain.current_present_semaphore()},
+            .swapchain = swapchain,
+        });
+      }
 
       device.collect_garbage();
 
@@ -1999,12 +2540,10 @@ void cubeland_app()
       case GLFW_KEY_L:
         if (action == GLFW_PRESS)
         {
-          if (!sword_loaded)
-          {
-            sword_loaded = true;
-            glm::mat4 sword_transform = glm::translate(glm::mat4(1.0f), glm::vec3(VOXEL_EXTENT * 30, -VOXEL_EXTENT * 20, -VOXEL_EXTENT * 50));
-            load_model(SWORD_NAME, sword_transform);
-          }
+          // Every press places another sword sharing the BLASes of the first one
+          glm::mat4 sword_transform = glm::translate(glm::mat4(1.0f), glm::vec3(VOXEL_EXTENT * (30 + 20 * sword_placements), -VOXEL_EXTENT * 20, -VOXEL_EXTENT * 50));
+          load_model(SWORD_NAME, sword_transform);
+          ++sword_placements;
         }
         break;
       case GLFW_KEY_LEFT_CONTROL:
@@ -2013,6 +2552,24 @@ void cubeland_app()
           building_mode = !building_mode;
         }
         break;
+#if PROFILER_ON == 1
+      case GLFW_KEY_P:
+        if (action == GLFW_PRESS)
+        {
+#if PROFILER_OVERLAY_ON == 1
+          show_profiler_overlay = !show_profiler_overlay;
+#else
+          profiler.write_report(std::cout);
+#endif // PROFILER_OVERLAY_ON
+        }
+        break;
+      case GLFW_KEY_O:
+        if (action == GLFW_PRESS)
+        {
+          export_profiler_trace();
+        }
+        break;
+#endif // PROFILER_ON
       default:
         break;
       };
@@ -2046,6 +2603,25 @@ void cubeland_app()
             .name = "taa_image_1",
         });
 
+        // Reservoirs, histories & tiles are indexed by the extent, so none of them survive a resize
+        if (pixel_buffer_extent.x != size_x || pixel_buffer_extent.y != size_y)
+        {
+          device.wait_idle();
+          if (pixel_buffer_pixel_count != size_x * size_y)
+          {
+            destroy_pixel_buffers();
+            create_pixel_buffers(size_x, size_y);
+            upload_restir();
+            report_pixel_buffer_memory();
+          }
+          else
+          {
+            pixel_buffer_extent = {size_x, size_y};
+          }
+          load_reservoirs();
+          status.num_accumulated_frames = 0;
+        }
+
         draw();
         // compute_motion_vectors();
         // update_status();
@@ -12,6 +12,16 @@ constexpr daxa_f32mat4x4 glm_mat4_to_daxa_f32mat4x4(glm::mat4 const &mat)
   };
 }
 
+inline glm::mat4 daxa_f32mat4x4_to_glm_mat4(daxa_f32mat4x4 const &mat)
+{
+  return glm::mat4{
+      {mat.x.x, mat.x.y, mat.x.z, mat.x.w},
+      {mat.y.x, mat.y.y, mat.y.z, mat.y.w},
+      {mat.z.x, mat.z.y, mat.z.z, mat.z.w},
+      {mat.w.x, mat.w.y, mat.w.z, mat.w.w},
+  };
+}
+
 constexpr daxa_f32mat3x4 daxa_f32mat4x4_to_daxa_f32mat3x4(daxa_f32mat4x4 const &mat)
 {
   return daxa_f32mat3x4{
@@ -4,10 +4,12 @@
 #include "defines.h"
 #include "rng.h"
 
+#include <vector>
+
 class Perlin {
   public:
     Perlin() {
-        ranfloat = new float[Perlin::point_count];
+        ranfloat.resize(Perlin::point_count);
         for (int i = 0; i < Perlin::point_count; ++i) {
             // ranfloat[i] = random_float_rand();
             ranfloat[i] = random_float();
@@ -19,13 +21,6 @@ class Perlin {
         perm_z = perlin_generate_perm();
     }
 
-    ~Perlin() {
-        delete[] ranfloat;
-        delete[] perm_x;
-        delete[] perm_y;
-        delete[] perm_z;
-    }
-
     float noise(const glm::vec3& p) const {
         auto i = static_cast<int>(4*p.x) & 255;
         auto j = static_cast<int>(4*p.y) & 255;
@@ -38,36 +33,36 @@ class Perlin {
         return Perlin::point_count;
     }
 
-    int* perm_x_data() const {
-        return perm_x;
+    const int* perm_x_data() const {
+        return perm_x.data();
     }
 
-    int* perm_y_data() const {
-        return perm_y;
+    const int* perm_y_data() const {
+        return perm_y.data();
     }
 
-    int* perm_z_data() const {
-        return perm_z;
+    const int* perm_z_data() const {
+        return perm_z.data();
     }
 
-    float* ranfloat_data() const {
-        return ranfloat;
+    const float* ranfloat_data() const {
+        return ranfloat.data();
     }
 
   private:
     static const int point_count = 256;
-    float* ranfloat;
-    int* perm_x;
-    int* perm_y;
-    int* perm_z;
+    std::vector<float> ranfloat;
+    std::vector<int> perm_x;
+    std::vector<int> perm_y;
+    std::vector<int> perm_z;
 
-    static int* perlin_generate_perm() {
-        auto p = new int[Perlin::point_count];
+    static std::vector<int> perlin_generate_perm() {
+        std::vector<int> p(Perlin::point_count);
 
         for (int i = 0; i < Perlin::point_count; i++)
             p[i] = i;
 
-        permute(p, Perlin::point_count);
+        permute(p.data(), Perlin::point_count);
 
         return p;
     }
@@ -6,14 +6,16 @@
 #include <random>
 #include <cstdlib>
 
+// Scene setup randomness, one generator per thread. Per pixel sequences of the renderers are in cpu/sampler.hpp
+
 inline float random_float_rand() {
     return rand() / (RAND_MAX + 1.0f);
 }
 
 
 inline float random_float() {
-    static std::uniform_real_distribution<float> distribution(0.0, 1.0);
-    static std::mt19937 generator;
+    thread_local std::uniform_real_distribution<float> distribution(0.0, 1.0);
+    thread_local std::mt19937 generator;
     return distribution(generator);
 }
 
@@ -22,12 +24,12 @@ inline float random_float(float min, float max) {
 }
 
 inline unsigned int random_uint(unsigned int min, unsigned int max) {
-    static std::mt19937 generator;
+    thread_local std::mt19937 generator;
     return std::uniform_int_distribution<unsigned int>{min, max}(generator);
 }
 
 inline int random_int(int min, int max) {
-    static std::mt19937 generator;
+    thread_local std::mt19937 generator;
     return std::uniform_int_distribution<int>{min, max}(generator);
 }
 
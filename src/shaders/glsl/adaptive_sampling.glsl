@@ -0,0 +1,135 @@
+#pragma once
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+
+// Per pixel running statistics & per tile error estimates of the accumulation mode (ADAPTIVE_SAMPLING_ON), a pixel
+// whose tile predicted a low enough relMSE at the previous frame doesn't trace (cpu/adaptive_sampling.hpp mirrors it).
+// Tile sums go to slot frame % 3: frame f reads the slot of f - 1, atomically adds to its own & clears the one of f + 1.
+
+daxa_f32 adaptive_get_luminance(daxa_f32vec3 color) {
+  return dot(color, daxa_f32vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Adds a sample to the running statistics, reset starts them over
+void adaptive_add_sample(inout ADAPTIVE_PIXEL pixel, daxa_f32vec3 color,
+                         daxa_b32 reset) {
+  daxa_f32 luminance = adaptive_get_luminance(color);
+  if (reset || pixel.sample_count == 0) {
+    pixel.mean = color;
+    pixel.luminance_moment = luminance * luminance;
+    pixel.sample_count = 1;
+    return;
+  }
+
+  pixel.sample_count++;
+  daxa_f32 weight = 1.0 / daxa_f32(pixel.sample_count);
+  pixel.mean += (color - pixel.mean) * weight;
+  pixel.luminance_moment +=
+      (luminance * luminance - pixel.luminance_moment) * weight;
+}
+
+// Predicted relMSE of the mean, 1 (the clamp) while there are fewer than 2 samples
+daxa_f32 adaptive_get_pixel_error(ADAPTIVE_PIXEL pixel) {
+  if (pixel.sample_count < 2)
+    return 1.0;
+
+  daxa_f32 n = daxa_f32(pixel.sample_count);
+  daxa_f32 mean_luminance = adaptive_get_luminance(pixel.mean);
+  daxa_f32 variance =
+      max(pixel.luminance_moment - mean_luminance * mean_luminance, 0.0) * n /
+      (n - 1.0);
+  return min(variance / n /
+                 (mean_luminance * mean_luminance + ADAPTIVE_LUMINANCE_EPSILON),
+             1.0);
+}
+
+daxa_u32 adaptive_get_error_bits(daxa_f32 error) {
+  return daxa_u32(clamp(error, 0.0, 1.0) * ADAPTIVE_ERROR_SCALE);
+}
+
+daxa_u32 adaptive_get_tile_index(daxa_u32vec2 pixel, daxa_u32 width) {
+  daxa_u32 tiles_x = (width + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE;
+  return (pixel.y / ADAPTIVE_TILE_SIZE) * tiles_x + pixel.x / ADAPTIVE_TILE_SIZE;
+}
+
+// Pixels of the tile of the pixel, border tiles are cut by the image
+daxa_u32 adaptive_get_tile_pixel_count(daxa_u32vec2 pixel, daxa_u32vec2 size) {
+  daxa_u32vec2 origin = pixel - pixel % ADAPTIVE_TILE_SIZE;
+  daxa_u32vec2 extent = min(daxa_u32vec2(ADAPTIVE_TILE_SIZE), size - origin);
+  return extent.x * extent.y;
+}
+
+daxa_f32 adaptive_get_tile_error(daxa_u32 error_sum, daxa_u32 pixel_count) {
+  return daxa_f32(error_sum) /
+         (ADAPTIVE_ERROR_SCALE * daxa_f32(pixel_count));
+}
+
+daxa_b32 adaptive_is_pixel_active(daxa_u32 sample_count, daxa_f32 tile_error,
+                                  daxa_u64 num_accumulated_frames) {
+  return num_accumulated_frames == 0 || sample_count < ADAPTIVE_MIN_SAMPLES ||
+         tile_error > ADAPTIVE_ERROR_THRESHOLD;
+}
+
+ADAPTIVE_PIXEL get_adaptive_pixel_by_index(daxa_u32 screen_pos) {
+  ADAPTIVE_PIXEL_BUFFER adaptive_pixel_buffer =
+      ADAPTIVE_PIXEL_BUFFER(deref(p.restir_buffer).adaptive_pixel_address);
+  return adaptive_pixel_buffer.pixels[screen_pos];
+}
+
+void set_adaptive_pixel_by_index(daxa_u32 screen_pos, ADAPTIVE_PIXEL pixel) {
+  ADAPTIVE_PIXEL_BUFFER adaptive_pixel_buffer =
+      ADAPTIVE_PIXEL_BUFFER(deref(p.restir_buffer).adaptive_pixel_address);
+  adaptive_pixel_buffer.pixels[screen_pos] = pixel;
+}
+
+// Clears the slot of the next frame, once per tile (by its first pixel)
+void clear_adaptive_tile_error(daxa_u32vec2 pixel, daxa_u32vec2 size,
+                               daxa_u32 frame_number) {
+  if (any(notEqual(pixel % ADAPTIVE_TILE_SIZE, daxa_u32vec2(0))))
+    return;
+  ADAPTIVE_TILE_BUFFER adaptive_tile_buffer =
+      ADAPTIVE_TILE_BUFFER(deref(p.restir_buffer).adaptive_tile_address);
+  adaptive_tile_buffer.tiles[adaptive_get_tile_index(pixel, size.x)]
+      .error_sums[(frame_number + 1) % ADAPTIVE_ERROR_SLOTS] = 0;
+}
+
+// Adds the predicted error of the pixel to its tile for the next frame
+void add_adaptive_tile_error(daxa_u32vec2 pixel, daxa_u32vec2 size,
+                             daxa_u32 frame_number,
+                             ADAPTIVE_PIXEL adaptive_pixel) {
+  ADAPTIVE_TILE_BUFFER adaptive_tile_buffer =
+      ADAPTIVE_TILE_BUFFER(deref(p.restir_buffer).adaptive_tile_address);
+  atomicAdd(adaptive_tile_buffer.tiles[adaptive_get_tile_index(pixel, size.x)]
+                .error_sums[frame_number % ADAPTIVE_ERROR_SLOTS],
+            adaptive_get_error_bits(adaptive_get_pixel_error(adaptive_pixel)));
+}
+
+// Whether the pixel traces this frame, from the error its tile had at the previous frame
+daxa_b32 is_adaptive_pixel_active(daxa_u32vec2 pixel, daxa_u32vec2 size,
+                                  daxa_u32 frame_number,
+                                  daxa_u64 num_accumulated_frames,
+                                  ADAPTIVE_PIXEL adaptive_pixel) {
+  ADAPTIVE_TILE_BUFFER adaptive_tile_buffer =
+      ADAPTIVE_TILE_BUFFER(deref(p.restir_buffer).adaptive_tile_address);
+  daxa_u32 error_sum =
+      adaptive_tile_buffer.tiles[adaptive_get_tile_index(pixel, size.x)]
+          .error_sums[(frame_number + ADAPTIVE_ERROR_SLOTS - 1) %
+                      ADAPTIVE_ERROR_SLOTS];
+  daxa_f32 tile_error = adaptive_get_tile_error(
+      error_sum, adaptive_get_tile_pixel_count(pixel, size));
+  return adaptive_is_pixel_active(adaptive_pixel.sample_count, tile_error,
+                                  num_accumulated_frames);
+}
+
+// Accumulates the sample of this frame & adds the new error to the tile, returns the mean
+daxa_f32vec3 adaptive_accumulate(daxa_u32vec2 pixel, daxa_u32vec2 size,
+                                 daxa_u32 frame_number,
+                                 daxa_u64 num_accumulated_frames,
+                                 daxa_f32vec3 color) {
+  daxa_u32 screen_pos = pixel.y * size.x + pixel.x;
+  ADAPTIVE_PIXEL adaptive_pixel = get_adaptive_pixel_by_index(screen_pos);
+  adaptive_add_sample(adaptive_pixel, color, num_accumulated_frames == 0);
+  set_adaptive_pixel_by_index(screen_pos, adaptive_pixel);
+  add_adaptive_tile_error(pixel, size, frame_number, adaptive_pixel);
+  return adaptive_pixel.mean;
+}
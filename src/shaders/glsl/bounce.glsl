@@ -96,6 +96,11 @@ INTERSECT intersect(Ray ray)
 
             instance_hit = OBJECT_INFO(instance_id, primitive_id);
 
+#if BRICK_PRIMITIVES_ON == 1
+            if (!resolve_brick_voxel(ray, instance_hit, t_min, t_max, false))
+                continue;
+#endif // BRICK_PRIMITIVES_ON
+
             daxa_f32vec3 half_extent = daxa_f32vec3(HALF_VOXEL_EXTENT);
 
             if(is_hit_from_ray(ray, instance_hit, half_extent, distance, int_hit, int_nor, model, inv_model, false, true, true)) {
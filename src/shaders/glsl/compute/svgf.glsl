@@ -0,0 +1,280 @@
+#define DAXA_RAY_TRACING 1
+#extension GL_EXT_ray_tracing : enable
+#extension GL_EXT_ray_query : enable
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+
+DAXA_DECL_PUSH_CONSTANT(PushConstant, p)
+
+#include "direct_light_info.glsl"
+#include "motion_vectors.glsl"
+#include "mat.glsl"
+#include "denoiser.glsl"
+
+// Spatiotemporal variance guided filtering (Schied et al. 2017) between the shading pass & TAA, DENOISER_TEMPORAL_PASS
+// once & DENOISER_ATROUS_PASS DENOISER_ATROUS_ITERATIONS times (p.filter_iteration). cpu/denoiser.hpp mirrors it.
+
+daxa_f32vec3 get_denoiser_indirect_by_index(daxa_u32 screen_pos) {
+#if INDIRECT_ILLUMINATION_ON == 1
+  return get_indirect_color_by_index(screen_pos);
+#else
+  return daxa_f32vec3(0.0);
+#endif // INDIRECT_ILLUMINATION_ON
+}
+
+#if DENOISER_TEMPORAL_PASS == 1
+
+// Luminance variance of the 5x5 pixels of the same surface around a pixel, this frame only
+daxa_f32vec2 get_spatial_variance(daxa_i32vec2 index,
+                                  DIRECT_ILLUMINATION_INFO di_info) {
+  daxa_f32vec4 sum = daxa_f32vec4(0.0);
+  daxa_f32 count = 0.0;
+  for (daxa_i32 dy = -2; dy <= 2; ++dy) {
+    for (daxa_i32 dx = -2; dx <= 2; ++dx) {
+      daxa_i32vec2 neighbour_index = index + daxa_i32vec2(dx, dy);
+      if (!is_valid_screen_region(neighbour_index, p.size))
+        continue;
+      daxa_u32 neighbour_pos = neighbour_index.y * p.size.x + neighbour_index.x;
+      DIRECT_ILLUMINATION_INFO neighbour =
+          get_di_from_current_frame(neighbour_pos);
+      if (!denoiser_is_same_surface(di_info.normal, di_info.distance,
+                                    di_info.mat_index, neighbour.normal,
+                                    neighbour.distance, neighbour.mat_index))
+        continue;
+      daxa_f32vec3 albedo = denoiser_get_albedo(
+          get_material_from_material_index(neighbour.mat_index));
+      daxa_f32 direct_luminance = denoiser_get_luminance(
+          denoiser_sanitize(get_denoiser_direct_by_index(neighbour_pos)) /
+          albedo);
+      daxa_f32 indirect_luminance = denoiser_get_luminance(
+          denoiser_sanitize(get_denoiser_indirect_by_index(neighbour_pos)) /
+          albedo);
+      sum += daxa_f32vec4(direct_luminance, direct_luminance * direct_luminance,
+                          indirect_luminance,
+                          indirect_luminance * indirect_luminance);
+      count += 1.0;
+    }
+  }
+  sum /= count;
+  return daxa_f32vec2(max(sum.y - sum.x * sum.x, 0.0),
+                      max(sum.w - sum.z * sum.z, 0.0));
+}
+
+layout(local_size_x = 8, local_size_y = 8) in;
+void main() {
+  const daxa_i32vec2 index = ivec2(gl_GlobalInvocationID.xy);
+  if (index.x >= p.size.x || index.y >= p.size.y) {
+    return;
+  }
+
+  daxa_u32 screen_pos = index.y * p.size.x + index.x;
+  daxa_u32 frame_number = deref(p.status_buffer).frame_number;
+  daxa_u32 history_index =
+      denoiser_get_history_index(screen_pos, p.size, frame_number);
+
+  DIRECT_ILLUMINATION_INFO di_info = get_di_from_current_frame(screen_pos);
+  if (di_info.distance <= 0.0) {
+    DENOISER_HISTORY miss;
+    miss.distance = 0.0;
+    miss.history_length = 0.0;
+    set_denoiser_history_by_index(history_index, miss);
+    return;
+  }
+
+  daxa_f32vec3 albedo =
+      denoiser_get_albedo(get_material_from_material_index(di_info.mat_index));
+  daxa_f32vec3 direct_light =
+      denoiser_sanitize(get_denoiser_direct_by_index(screen_pos)) / albedo;
+  daxa_f32vec3 indirect_light =
+      denoiser_sanitize(get_denoiser_indirect_by_index(screen_pos)) / albedo;
+
+  // Nearest pixel of the previous frame
+  VELOCITY velocity = velocity_buffer_get_velocity(daxa_u32vec2(index), p.size);
+  daxa_i32vec2 previous_index =
+      daxa_i32vec2(floor(daxa_f32vec2(index) + velocity.velocity + 0.5));
+  daxa_b32 valid = false;
+  DENOISER_HISTORY previous_history;
+  if (is_valid_screen_region(previous_index, p.size)) {
+    previous_history = get_denoiser_history_by_index(denoiser_get_history_index(
+        previous_index.y * p.size.x + previous_index.x, p.size,
+        frame_number + 1));
+    valid = denoiser_is_same_surface(
+        di_info.normal, di_info.distance, di_info.mat_index,
+        previous_history.normal, previous_history.distance,
+        previous_history.mat_index);
+  }
+
+  daxa_f32 history_length =
+      valid ? min(previous_history.history_length + 1.0,
+                  daxa_f32(DENOISER_MAX_HISTORY))
+            : 1.0;
+  daxa_f32 color_alpha =
+      valid ? max(DENOISER_COLOR_ALPHA, 1.0 / history_length) : 1.0;
+  daxa_f32 moments_alpha =
+      valid ? max(DENOISER_MOMENTS_ALPHA, 1.0 / history_length) : 1.0;
+
+  daxa_f32 direct_luminance = denoiser_get_luminance(direct_light);
+  daxa_f32 indirect_luminance = denoiser_get_luminance(indirect_light);
+  daxa_f32vec4 moments =
+      daxa_f32vec4(direct_luminance, direct_luminance * direct_luminance,
+                   indirect_luminance, indirect_luminance * indirect_luminance);
+  if (valid) {
+    moments = mix(previous_history.moments, moments, moments_alpha);
+    direct_light = mix(previous_history.direct, direct_light, color_alpha);
+    indirect_light = mix(previous_history.indirect, indirect_light, color_alpha);
+  }
+
+  daxa_f32vec2 variance = daxa_f32vec2(max(moments.y - moments.x * moments.x, 0.0),
+                                       max(moments.w - moments.z * moments.z, 0.0));
+  if (history_length < daxa_f32(DENOISER_MIN_HISTORY))
+    variance = get_spatial_variance(index, di_info) *
+               (daxa_f32(DENOISER_MIN_HISTORY) / history_length);
+
+  set_denoiser_history_by_index(
+      history_index,
+      DENOISER_HISTORY(direct_light, indirect_light, moments, di_info.normal,
+                       di_info.distance, di_info.mat_index, history_length));
+  set_denoiser_signal_by_index(
+      denoiser_get_signal_index(screen_pos, p.size, 0),
+      DENOISER_SIGNAL(direct_light, indirect_light, variance));
+}
+
+#elif DENOISER_ATROUS_PASS == 1
+
+daxa_f32 get_history_distance(daxa_i32vec2 index, daxa_u32 frame_number) {
+  if (!is_valid_screen_region(index, p.size))
+    return 0.0;
+  return get_denoiser_history_by_index(
+             denoiser_get_history_index(index.y * p.size.x + index.x, p.size,
+                                        frame_number))
+      .distance;
+}
+
+layout(local_size_x = 8, local_size_y = 8) in;
+void main() {
+  const daxa_i32vec2 index = ivec2(gl_GlobalInvocationID.xy);
+  if (index.x >= p.size.x || index.y >= p.size.y) {
+    return;
+  }
+
+  daxa_u32 screen_pos = index.y * p.size.x + index.x;
+  daxa_u32 frame_number = deref(p.status_buffer).frame_number;
+  daxa_u32 iteration = p.filter_iteration;
+  daxa_u32 input_half = iteration % 2;
+  daxa_u32 history_index =
+      denoiser_get_history_index(screen_pos, p.size, frame_number);
+
+  DENOISER_HISTORY center = get_denoiser_history_by_index(history_index);
+  if (center.distance <= 0.0)
+    return;
+
+  daxa_f32vec2 distance_gradient = daxa_f32vec2(
+      denoiser_get_distance_slope(
+          center.distance,
+          get_history_distance(index + daxa_i32vec2(-1, 0), frame_number),
+          get_history_distance(index + daxa_i32vec2(1, 0), frame_number)),
+      denoiser_get_distance_slope(
+          center.distance,
+          get_history_distance(index + daxa_i32vec2(0, -1), frame_number),
+          get_history_distance(index + daxa_i32vec2(0, 1), frame_number)));
+
+  // 3x3 gaussian of the variance for the luminance edge stop
+  daxa_f32vec2 blurred_variance = daxa_f32vec2(0.0);
+  daxa_f32 blur_weight = 0.0;
+  for (daxa_i32 dy = -1; dy <= 1; ++dy) {
+    for (daxa_i32 dx = -1; dx <= 1; ++dx) {
+      daxa_i32vec2 neighbour_index = index + daxa_i32vec2(dx, dy);
+      if (get_history_distance(neighbour_index, frame_number) <= 0.0)
+        continue;
+      daxa_f32 weight = (dx == 0 ? 0.5 : 0.25) * (dy == 0 ? 0.5 : 0.25);
+      blurred_variance +=
+          get_denoiser_signal_by_index(
+              denoiser_get_signal_index(neighbour_index.y * p.size.x +
+                                            neighbour_index.x,
+                                        p.size, input_half))
+              .variance *
+          weight;
+      blur_weight += weight;
+    }
+  }
+  daxa_f32vec2 sigma = sqrt(blurred_variance / blur_weight);
+
+  DENOISER_SIGNAL signal = get_denoiser_signal_by_index(
+      denoiser_get_signal_index(screen_pos, p.size, input_half));
+  daxa_f32 direct_luminance = denoiser_get_luminance(signal.direct);
+  daxa_f32 indirect_luminance = denoiser_get_luminance(signal.indirect);
+  daxa_f32vec3 direct_sum = daxa_f32vec3(0.0);
+  daxa_f32vec3 indirect_sum = daxa_f32vec3(0.0);
+  daxa_f32vec2 variance_sum = daxa_f32vec2(0.0);
+  daxa_f32vec2 weight_sum = daxa_f32vec2(0.0);
+  daxa_i32 step_size = 1 << iteration;
+  for (daxa_i32 dy = -2; dy <= 2; ++dy) {
+    for (daxa_i32 dx = -2; dx <= 2; ++dx) {
+      daxa_i32vec2 neighbour_index = index + daxa_i32vec2(dx, dy) * step_size;
+      if (get_history_distance(neighbour_index, frame_number) <= 0.0)
+        continue;
+      daxa_u32 neighbour_pos = neighbour_index.y * p.size.x + neighbour_index.x;
+      DENOISER_HISTORY neighbour = get_denoiser_history_by_index(
+          denoiser_get_history_index(neighbour_pos, p.size, frame_number));
+      DENOISER_SIGNAL tap = get_denoiser_signal_by_index(
+          denoiser_get_signal_index(neighbour_pos, p.size, input_half));
+
+      daxa_f32 weight =
+          denoiser_get_kernel_weight(dx) * denoiser_get_kernel_weight(dy) *
+          denoiser_get_geometry_weight(
+              center.normal, neighbour.normal, center.distance,
+              neighbour.distance, distance_gradient,
+              daxa_f32vec2(dx * step_size, dy * step_size));
+      daxa_f32 direct_weight =
+          weight * denoiser_get_luminance_weight(
+                       direct_luminance, denoiser_get_luminance(tap.direct),
+                       sigma.x);
+      daxa_f32 indirect_weight =
+          weight * denoiser_get_luminance_weight(
+                       indirect_luminance, denoiser_get_luminance(tap.indirect),
+                       sigma.y);
+
+      direct_sum += tap.direct * direct_weight;
+      indirect_sum += tap.indirect * indirect_weight;
+      variance_sum += tap.variance * daxa_f32vec2(direct_weight * direct_weight,
+                                                  indirect_weight * indirect_weight);
+      weight_sum += daxa_f32vec2(direct_weight, indirect_weight);
+    }
+  }
+
+  // The center tap always has a weight
+  daxa_f32vec3 direct_light = direct_sum / weight_sum.x;
+  daxa_f32vec3 indirect_light = indirect_sum / weight_sum.y;
+  daxa_f32vec2 variance = variance_sum / (weight_sum * weight_sum);
+
+  // Feedback: the first pass is the color history of the next frame (other invocations only read its geometry)
+  if (iteration == 0) {
+    set_denoiser_history_light_by_index(history_index, direct_light,
+                                        indirect_light);
+  }
+
+  if (iteration + 1 == DENOISER_ATROUS_ITERATIONS) {
+    MATERIAL mat = get_material_from_material_index(center.mat_index);
+    daxa_f32vec3 color = (direct_light + indirect_light) * denoiser_get_albedo(mat);
+#if DIRECT_EMITTANCE_ON == 1
+    color += mat.emission;
+#endif // DIRECT_EMITTANCE_ON
+#if RESTIR_ON == 1
+    daxa_u32 active_features = deref(p.status_buffer).is_active;
+    if ((active_features & TAA_BIT) != 0U) {
+      imageStore(daxa_image2D(p.taa_frame), index, daxa_f32vec4(color, 1.0));
+    } else {
+      imageStore(daxa_image2D(p.swapchain), index, daxa_f32vec4(color, 1.0));
+    }
+#else
+    imageStore(daxa_image2D(p.swapchain), index, daxa_f32vec4(color, 1.0));
+#endif // RESTIR_ON
+    return;
+  }
+
+  set_denoiser_signal_by_index(
+      denoiser_get_signal_index(screen_pos, p.size, (iteration + 1) % 2),
+      DENOISER_SIGNAL(direct_light, indirect_light, variance));
+}
+
+#endif // DENOISER_TEMPORAL_PASS
@@ -0,0 +1,129 @@
+#pragma once
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+
+// Edge stops & buffers of the SVGF denoiser passes (compute/svgf.glsl, cpu/denoiser.hpp mirrors both). Light is
+// filtered divided by the albedo, histories follow the VELOCITY of the pixel while normal, distance & material agree.
+// Histories & signals keep two halves of size.x * size.y pixels: the history of frame f is half f % 2, a-trous
+// iteration i reads the signal half i % 2 & writes the other one.
+
+daxa_f32 denoiser_get_luminance(daxa_f32vec3 color) {
+  return dot(color, daxa_f32vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Light is filtered divided by this, dark albedos are clamped so it can be multiplied back
+daxa_f32vec3 denoiser_get_albedo(MATERIAL mat) {
+  return max(mat.diffuse, daxa_f32vec3(DENOISER_ALBEDO_EPSILON));
+}
+
+// NaN & infinite samples of the shading pass don't enter the history
+daxa_f32vec3 denoiser_sanitize(daxa_f32vec3 color) {
+  for (daxa_u32 c = 0; c < 3; ++c)
+    if (isnan(color[c]) || isinf(color[c]))
+      color[c] = 0.0;
+  return color;
+}
+
+// Whether two pixels see the same surface, for reprojection & the spatial variance estimate
+daxa_b32 denoiser_is_same_surface(daxa_f32vec3 normal_a, daxa_f32 distance_a,
+                                  daxa_u32 mat_index_a, daxa_f32vec3 normal_b,
+                                  daxa_f32 distance_b, daxa_u32 mat_index_b) {
+  return distance_a > 0.0 && distance_b > 0.0 &&
+         dot(normal_a, normal_b) >= DENOISER_NORMAL_THRESHOLD &&
+         abs(distance_a - distance_b) <= DENOISER_DEPTH_THRESHOLD * distance_a &&
+         mat_index_a == mat_index_b;
+}
+
+// B3 spline of the a-trous kernel, offset in [-2, 2]
+daxa_f32 denoiser_get_kernel_weight(daxa_i32 offset) {
+  return offset == 0 ? 3.0 / 8.0 : (abs(offset) == 1 ? 1.0 / 4.0 : 1.0 / 16.0);
+}
+
+// Smaller one sided difference of the distance along an axis, 0 without a neighbour
+daxa_f32 denoiser_get_distance_slope(daxa_f32 center, daxa_f32 before,
+                                     daxa_f32 after) {
+  daxa_f32 slope = MAX_DISTANCE;
+  if (before > 0.0)
+    slope = min(slope, abs(center - before));
+  if (after > 0.0)
+    slope = min(slope, abs(after - center));
+  return slope == MAX_DISTANCE ? 0.0 : slope;
+}
+
+// Normal & distance edge stop of a tap delta pixels away
+daxa_f32 denoiser_get_geometry_weight(daxa_f32vec3 normal_p,
+                                      daxa_f32vec3 normal_q,
+                                      daxa_f32 distance_p, daxa_f32 distance_q,
+                                      daxa_f32vec2 distance_gradient,
+                                      daxa_f32vec2 delta) {
+  daxa_f32 normal_weight =
+      pow(max(dot(normal_p, normal_q), 0.0), DENOISER_PHI_NORMAL);
+  daxa_f32 expected = DENOISER_PHI_DEPTH * abs(dot(distance_gradient, delta)) +
+                      distance_p * 1e-3;
+  return normal_weight * exp(-abs(distance_p - distance_q) / expected);
+}
+
+daxa_f32 denoiser_get_luminance_weight(daxa_f32 luminance_p,
+                                       daxa_f32 luminance_q, daxa_f32 sigma) {
+  return exp(-abs(luminance_p - luminance_q) /
+             (DENOISER_PHI_COLOR * sigma + 1e-10));
+}
+
+// Light of the reservoirs (F * W) of the shading pass, the indirect light stays in the indirect color buffer
+void set_denoiser_direct_by_index(daxa_u32 screen_pos, daxa_f32vec3 color) {
+  DENOISER_DIRECT_BUFFER denoiser_direct_buffer =
+      DENOISER_DIRECT_BUFFER(deref(p.restir_buffer).denoiser_direct_address);
+  denoiser_direct_buffer.colors[screen_pos] = color;
+}
+
+daxa_f32vec3 get_denoiser_direct_by_index(daxa_u32 screen_pos) {
+  DENOISER_DIRECT_BUFFER denoiser_direct_buffer =
+      DENOISER_DIRECT_BUFFER(deref(p.restir_buffer).denoiser_direct_address);
+  return denoiser_direct_buffer.colors[screen_pos];
+}
+
+daxa_u32 denoiser_get_history_index(daxa_u32 screen_pos, daxa_u32vec2 size,
+                                    daxa_u32 frame_number) {
+  return (frame_number % 2) * size.x * size.y + screen_pos;
+}
+
+DENOISER_HISTORY get_denoiser_history_by_index(daxa_u32 history_index) {
+  DENOISER_HISTORY_BUFFER denoiser_history_buffer =
+      DENOISER_HISTORY_BUFFER(deref(p.restir_buffer).denoiser_history_address);
+  return denoiser_history_buffer.histories[history_index];
+}
+
+void set_denoiser_history_by_index(daxa_u32 history_index,
+                                   DENOISER_HISTORY history) {
+  DENOISER_HISTORY_BUFFER denoiser_history_buffer =
+      DENOISER_HISTORY_BUFFER(deref(p.restir_buffer).denoiser_history_address);
+  denoiser_history_buffer.histories[history_index] = history;
+}
+
+// Colors only, the a-trous feedback runs while other pixels read the geometry
+void set_denoiser_history_light_by_index(daxa_u32 history_index,
+                                         daxa_f32vec3 direct,
+                                         daxa_f32vec3 indirect) {
+  DENOISER_HISTORY_BUFFER denoiser_history_buffer =
+      DENOISER_HISTORY_BUFFER(deref(p.restir_buffer).denoiser_history_address);
+  denoiser_history_buffer.histories[history_index].direct = direct;
+  denoiser_history_buffer.histories[history_index].indirect = indirect;
+}
+
+daxa_u32 denoiser_get_signal_index(daxa_u32 screen_pos, daxa_u32vec2 size,
+                                   daxa_u32 half_index) {
+  return half_index * size.x * size.y + screen_pos;
+}
+
+DENOISER_SIGNAL get_denoiser_signal_by_index(daxa_u32 signal_index) {
+  DENOISER_SIGNAL_BUFFER denoiser_signal_buffer =
+      DENOISER_SIGNAL_BUFFER(deref(p.restir_buffer).denoiser_signal_address);
+  return denoiser_signal_buffer.signals[signal_index];
+}
+
+void set_denoiser_signal_by_index(daxa_u32 signal_index,
+                                  DENOISER_SIGNAL signal) {
+  DENOISER_SIGNAL_BUFFER denoiser_signal_buffer =
+      DENOISER_SIGNAL_BUFFER(deref(p.restir_buffer).denoiser_signal_address);
+  denoiser_signal_buffer.signals[signal_index] = signal;
+}
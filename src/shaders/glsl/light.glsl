@@ -116,6 +116,11 @@ daxa_b32 is_vertex_visible(Ray ray, daxa_f32 distance, OBJECT_INFO instance_targ
 
       instance_hit = OBJECT_INFO(instance_id, primitive_id);
 
+#if BRICK_PRIMITIVES_ON == 1
+      if (!resolve_brick_voxel(ray, instance_hit, t_min, t_max, previous_frame))
+        continue;
+#endif // BRICK_PRIMITIVES_ON
+
       daxa_f32vec3 half_extent = daxa_f32vec3(HALF_VOXEL_EXTENT);
 
       if (is_hit_from_ray(ray, instance_hit, half_extent, hit_distance, int_hit,
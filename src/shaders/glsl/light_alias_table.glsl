@@ -0,0 +1,29 @@
+#pragma once
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+#include "prng.glsl"
+
+// Alias table of the cube lights (LIGHT_ALIAS_TABLE_ON), built on the host (cpu/light_alias_table.hpp mirrors it)
+
+LIGHT_ALIAS get_light_alias(daxa_u32 entry) {
+  LIGHT_ALIAS_BUFFER light_alias_buffer =
+      LIGHT_ALIAS_BUFFER(deref(p.world_buffer).light_alias_address);
+  return light_alias_buffer.entries[entry];
+}
+
+// Picks a cube light proportionally to its power, pmf is its probability. u_entry picks the entry & the coin between
+// it & its alias comes from seed
+daxa_b32 light_alias_sample(daxa_u32 cube_light_count, daxa_f32 u_entry,
+                            inout daxa_u32 seed, out daxa_u32 light_index,
+                            out daxa_f32 pmf) {
+  daxa_u32 entry =
+      min(daxa_u32(u_entry * cube_light_count), cube_light_count - 1);
+  LIGHT_ALIAS alias = get_light_alias(entry);
+  light_index = rnd(seed) < alias.threshold ? entry : alias.alias;
+  pmf = light_index == entry ? alias.pmf : get_light_alias(light_index).pmf;
+  return pmf > 0.0;
+}
+
+daxa_f32 light_alias_pmf(daxa_u32 light_index) {
+  return get_light_alias(light_index).pmf;
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+#include "prng.glsl"
+
+// Light tree of the cube lights (LIGHT_TREE_ON), built & refit on the host (cpu/light_tree.hpp mirrors every function)
+
+LIGHT_TREE_NODE get_light_tree_node(daxa_u32 node_index) {
+  LIGHT_TREE_BUFFER light_tree_buffer =
+      LIGHT_TREE_BUFFER(deref(p.world_buffer).light_tree_address);
+  return light_tree_buffer.nodes[node_index];
+}
+
+daxa_u32 get_light_tree_leaf(daxa_u32 light_index) {
+  LIGHT_TREE_LEAF_BUFFER light_tree_leaf_buffer =
+      LIGHT_TREE_LEAF_BUFFER(deref(p.world_buffer).light_tree_leaf_address);
+  return light_tree_leaf_buffer.leaves[light_index];
+}
+
+// cos(max(0, theta_a - theta_b))
+daxa_f32 light_tree_cos_sub_clamped(daxa_f32 sin_theta_a, daxa_f32 cos_theta_a,
+                                    daxa_f32 sin_theta_b, daxa_f32 cos_theta_b) {
+  if (cos_theta_a > cos_theta_b)
+    return 1.0;
+  return cos_theta_a * cos_theta_b + sin_theta_a * sin_theta_b;
+}
+
+// sin(max(0, theta_a - theta_b))
+daxa_f32 light_tree_sin_sub_clamped(daxa_f32 sin_theta_a, daxa_f32 cos_theta_a,
+                                    daxa_f32 sin_theta_b, daxa_f32 cos_theta_b) {
+  if (cos_theta_a > cos_theta_b)
+    return 0.0;
+  return sin_theta_a * cos_theta_b - cos_theta_a * sin_theta_b;
+}
+
+// Upper bound of the light a node sends to P, a zero receiver normal sees every side
+daxa_f32 get_light_tree_importance(LIGHT_TREE_NODE node, daxa_f32vec3 P,
+                                   daxa_f32vec3 n) {
+  if (node.phi <= 0.0)
+    return 0.0;
+
+  daxa_f32vec3 center = (node.minimum + node.maximum) * 0.5;
+  daxa_f32vec3 half_extent = node.maximum - center;
+  daxa_f32 radius2 = dot(half_extent, half_extent);
+  daxa_f32vec3 to_center = center - P;
+  daxa_f32 distance2 = dot(to_center, to_center);
+
+  // Bounds too close to bound any angle
+  if (distance2 <= radius2)
+    return node.phi / max(radius2, 1e-12);
+
+  daxa_f32vec3 wi = to_center / sqrt(distance2);
+
+  // Angle subtended by the bounds
+  daxa_f32 sin2_theta_b = radius2 / distance2;
+  daxa_f32 sin_theta_b = sqrt(sin2_theta_b);
+  daxa_f32 cos_theta_b = sqrt(max(1.0 - sin2_theta_b, 0.0));
+
+  // Smallest angle between the emission cone & the direction towards P
+  daxa_f32 cos_theta_w = dot(node.axis, -wi);
+  daxa_f32 sin_theta_w = sqrt(max(1.0 - cos_theta_w * cos_theta_w, 0.0));
+  daxa_f32 sin_theta_o =
+      sqrt(max(1.0 - node.cos_theta_o * node.cos_theta_o, 0.0));
+  daxa_f32 cos_theta_x = light_tree_cos_sub_clamped(
+      sin_theta_w, cos_theta_w, sin_theta_o, node.cos_theta_o);
+  daxa_f32 sin_theta_x = light_tree_sin_sub_clamped(
+      sin_theta_w, cos_theta_w, sin_theta_o, node.cos_theta_o);
+  daxa_f32 cos_theta_p = light_tree_cos_sub_clamped(sin_theta_x, cos_theta_x,
+                                                    sin_theta_b, cos_theta_b);
+  if (cos_theta_p <= node.cos_theta_e)
+    return 0.0;
+
+  daxa_f32 importance = node.phi * cos_theta_p / distance2;
+
+  // Receiver cosine, bounded over the subtended angle
+  if (any(notEqual(n, daxa_f32vec3(0.0)))) {
+    daxa_f32 cos_theta_i = dot(wi, n);
+    daxa_f32 sin_theta_i = sqrt(max(1.0 - cos_theta_i * cos_theta_i, 0.0));
+    daxa_f32 cos_theta_pi = light_tree_cos_sub_clamped(
+        sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+    importance *= max(cos_theta_pi, 0.0);
+  }
+
+  return max(importance, 0.0);
+}
+
+// Only lambertian surfaces reject light from below
+daxa_f32vec3 get_light_tree_receiver_normal(MATERIAL mat, daxa_f32vec3 n) {
+  return (mat.type & MATERIAL_TYPE_MASK) == MATERIAL_TYPE_LAMBERTIAN
+             ? n
+             : daxa_f32vec3(0.0);
+}
+
+// Picks a cube light for a receiver at P, u is reused at every level
+daxa_b32 light_tree_sample(daxa_f32vec3 P, daxa_f32vec3 n, daxa_f32 u,
+                           out daxa_u32 light_index, out daxa_f32 pmf) {
+  light_index = MAX_CUBE_LIGHTS;
+  pmf = 1.0;
+
+  LIGHT_TREE_NODE node = get_light_tree_node(0);
+  if (node.phi <= 0.0)
+    return false;
+
+  while (node.is_leaf == 0) {
+    daxa_u32 child = node.child_or_light;
+    LIGHT_TREE_NODE node0 = get_light_tree_node(child);
+    LIGHT_TREE_NODE node1 = get_light_tree_node(child + 1);
+    daxa_f32 importance0 = get_light_tree_importance(node0, P, n);
+    daxa_f32 importance1 = get_light_tree_importance(node1, P, n);
+    daxa_f32 total = importance0 + importance1;
+    if (total <= 0.0)
+      return false;
+
+    daxa_f32 p0 = importance0 / total;
+    if (u < p0) {
+      u = min(u / p0, ONE_MINUS_EPSILON);
+      pmf *= p0;
+      node = node0;
+    } else {
+      u = min((u - p0) / (1.0 - p0), ONE_MINUS_EPSILON);
+      pmf *= importance1 / total;
+      node = node1;
+    }
+  }
+
+  light_index = node.child_or_light;
+  return light_index < MAX_CUBE_LIGHTS && pmf > 0.0;
+}
+
+// Probability of light_tree_sample picking light_index, leaf to root
+daxa_f32 light_tree_pmf(daxa_f32vec3 P, daxa_f32vec3 n, daxa_u32 light_index) {
+  daxa_u32 node_index = get_light_tree_leaf(light_index);
+  if (node_index >= MAX_LIGHT_TREE_NODES)
+    return 0.0;
+
+  daxa_f32 pmf = 1.0;
+  daxa_u32 parent = get_light_tree_node(node_index).parent;
+  while (parent < MAX_LIGHT_TREE_NODES) {
+    LIGHT_TREE_NODE parent_node = get_light_tree_node(parent);
+    daxa_u32 child = parent_node.child_or_light;
+    daxa_f32 importance0 =
+        get_light_tree_importance(get_light_tree_node(child), P, n);
+    daxa_f32 importance1 =
+        get_light_tree_importance(get_light_tree_node(child + 1), P, n);
+    daxa_f32 total = importance0 + importance1;
+    if (total <= 0.0)
+      return 0.0;
+    pmf *= (node_index == child ? importance0 : importance1) / total;
+    node_index = parent;
+    parent = parent_node.parent;
+  }
+  return pmf;
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+
+// Packed storage of the per pixel reservoirs & direct illumination (PACKED_RESERVOIRS_ON), cpu/packed_reservoir.hpp
+// mirrors it bit for bit but for the half floats, whose rounding packHalf2x16 leaves to the device.
+// RGB9E5 follows EXT_texture_shared_exponent with floor(log2) taken from the float bits, octahedral directions keep
+// 16 bits per axis. load_* & store_* convert between a buffer element (*_STORAGE) & the struct the shaders work on.
+
+#define RGB9E5_MANTISSA_BITS 9
+#define RGB9E5_EXPONENT_BIAS 15
+#define RGB9E5_MAX 65408.0 // 511 / 512 * 2^16
+#define SNORM16_SCALE 32767.0
+#define UNORM16_SCALE 65535.0
+
+// 2^exponent, exact for exponents of normal floats
+daxa_f32 packing_get_power_of_two(daxa_i32 exponent) {
+  return uintBitsToFloat(daxa_u32(exponent + 127) << 23);
+}
+
+// Negative & NaN components are 0, components above RGB9E5_MAX are clamped
+daxa_u32 pack_rgb9e5(daxa_f32vec3 color) {
+  daxa_f32vec3 c;
+  for (daxa_u32 i = 0; i < 3; ++i)
+    c[i] = color[i] > 0.0 ? min(color[i], RGB9E5_MAX) : 0.0;
+  daxa_f32 max_c = max(c.x, max(c.y, c.z));
+
+  daxa_i32 exponent =
+      max(daxa_i32((floatBitsToUint(max_c) >> 23) & 0xFF) - 127,
+          -RGB9E5_EXPONENT_BIAS - 1) +
+      1 + RGB9E5_EXPONENT_BIAS;
+  daxa_f32 scale = packing_get_power_of_two(
+      RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS - exponent);
+  // The largest component rounded up to 2^9
+  if (floor(max_c * scale + 0.5) == 512.0) {
+    exponent++;
+    scale *= 0.5;
+  }
+
+  daxa_u32vec3 m = daxa_u32vec3(floor(c * scale + 0.5));
+  return m.x | (m.y << 9) | (m.z << 18) | (daxa_u32(exponent) << 27);
+}
+
+daxa_f32vec3 unpack_rgb9e5(daxa_u32 bits) {
+  daxa_f32 scale = packing_get_power_of_two(
+      daxa_i32(bits >> 27) - RGB9E5_EXPONENT_BIAS - RGB9E5_MANTISSA_BITS);
+  return daxa_f32vec3(bits & 0x1FF, (bits >> 9) & 0x1FF, (bits >> 18) & 0x1FF) *
+         scale;
+}
+
+// [-1, 1] to [0, 65534]
+daxa_u32 pack_snorm16(daxa_f32 value) {
+  return daxa_u32(daxa_i32(floor(clamp(value, -1.0, 1.0) * SNORM16_SCALE + 0.5)) +
+                  daxa_i32(SNORM16_SCALE));
+}
+
+daxa_f32 unpack_snorm16(daxa_u32 bits) {
+  return daxa_f32(daxa_i32(bits) - daxa_i32(SNORM16_SCALE)) / SNORM16_SCALE;
+}
+
+// From the sign bit: -0 folds like a negative value, so a direction decoded on the seam of the fold packs back to
+// the same bits
+daxa_f32vec2 packing_sign_not_zero(daxa_f32vec2 v) {
+  return daxa_f32vec2((floatBitsToUint(v.x) >> 31) == 0 ? 1.0 : -1.0,
+                      (floatBitsToUint(v.y) >> 31) == 0 ? 1.0 : -1.0);
+}
+
+// Unit directions, a zero vector comes back as +z
+daxa_u32 pack_octahedral(daxa_f32vec3 direction) {
+  daxa_f32 norm = abs(direction.x) + abs(direction.y) + abs(direction.z);
+  daxa_f32vec2 oct =
+      norm > 0.0 ? direction.xy / norm : daxa_f32vec2(0.0);
+  if (direction.z < 0.0)
+    oct = (1.0 - abs(oct.yx)) * packing_sign_not_zero(oct);
+  return pack_snorm16(oct.x) | (pack_snorm16(oct.y) << 16);
+}
+
+daxa_f32vec3 unpack_octahedral(daxa_u32 bits) {
+  daxa_f32vec2 oct =
+      daxa_f32vec2(unpack_snorm16(bits & 0xFFFF), unpack_snorm16(bits >> 16));
+  daxa_f32vec3 direction =
+      daxa_f32vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+  if (direction.z < 0.0)
+    direction.xy = (1.0 - abs(oct.yx)) * packing_sign_not_zero(oct);
+  return normalize(direction);
+}
+
+// Low 16 bits, M is clamped to HLF_MAX
+daxa_u32 pack_half(daxa_f32 value) {
+  return packHalf2x16(daxa_f32vec2(min(value, HLF_MAX), 0.0)) & 0xFFFF;
+}
+
+daxa_f32 unpack_half(daxa_u32 bits) {
+  return unpackHalf2x16(bits & 0xFFFF).x;
+}
+
+daxa_u32 pack_unorm16(daxa_f32 value) {
+  return daxa_u32(floor(clamp(value, 0.0, 1.0) * UNORM16_SCALE + 0.5));
+}
+
+daxa_f32 unpack_unorm16(daxa_u32 bits) {
+  return daxa_f32(bits & 0xFFFF) / UNORM16_SCALE;
+}
+
+RESERVOIR_PACKED pack_reservoir(RESERVOIR reservoir) {
+  RESERVOIR_PACKED packed;
+  packed.Y = reservoir.Y;
+  packed.seed = reservoir.seed;
+  packed.W_y = reservoir.W_y;
+  packed.W_sum = reservoir.W_sum;
+  packed.l_type_M = (reservoir.l_type & 0xFFFF) | (pack_half(reservoir.M) << 16);
+  packed.F = pack_rgb9e5(reservoir.F);
+  return packed;
+}
+
+RESERVOIR unpack_reservoir(RESERVOIR_PACKED packed) {
+  RESERVOIR reservoir;
+  reservoir.Y = packed.Y;
+  reservoir.l_type = packed.l_type_M & 0xFFFF;
+  reservoir.seed = packed.seed;
+  reservoir.W_y = packed.W_y;
+  reservoir.W_sum = packed.W_sum;
+  reservoir.M = unpack_half(packed.l_type_M >> 16);
+  reservoir.F = unpack_rgb9e5(packed.F);
+  return reservoir;
+}
+
+PATH_RESERVOIR_PACKED pack_path_reservoir(PATH_RESERVOIR reservoir) {
+  PATH_RESERVOIR_PACKED packed;
+  packed.M = pack_half(reservoir.M);
+  packed.weight = reservoir.weight;
+  packed.path_flags = reservoir.path_flags;
+  packed.rc_random_seed = reservoir.rc_random_seed;
+  packed.F = pack_rgb9e5(reservoir.F);
+  packed.light_pdf = reservoir.light_pdf;
+  packed.cached_jacobian = reservoir.cached_jacobian;
+  packed.init_random_seed = reservoir.init_random_seed;
+  packed.rc_vertex_hit = reservoir.rc_vertex_hit;
+  packed.rc_vertex_wi = pack_octahedral(reservoir.rc_vertex_wi[0]);
+  packed.rc_vertex_irradiance = pack_rgb9e5(reservoir.rc_vertex_irradiance[0]);
+  return packed;
+}
+
+PATH_RESERVOIR unpack_path_reservoir(PATH_RESERVOIR_PACKED packed) {
+  PATH_RESERVOIR reservoir;
+  reservoir.M = unpack_half(packed.M);
+  reservoir.weight = packed.weight;
+  reservoir.path_flags = packed.path_flags;
+  reservoir.rc_random_seed = packed.rc_random_seed;
+  reservoir.F = unpack_rgb9e5(packed.F);
+  reservoir.light_pdf = packed.light_pdf;
+  reservoir.cached_jacobian = packed.cached_jacobian;
+  reservoir.init_random_seed = packed.init_random_seed;
+  reservoir.rc_vertex_hit = packed.rc_vertex_hit;
+  reservoir.rc_vertex_wi[0] = unpack_octahedral(packed.rc_vertex_wi);
+  reservoir.rc_vertex_irradiance[0] = unpack_rgb9e5(packed.rc_vertex_irradiance);
+  return reservoir;
+}
+
+DIRECT_ILLUMINATION_INFO_PACKED pack_di_info(DIRECT_ILLUMINATION_INFO di_info) {
+  DIRECT_ILLUMINATION_INFO_PACKED packed;
+  packed.position = di_info.position;
+  packed.distance = di_info.distance;
+  packed.normal = pack_octahedral(di_info.normal);
+  packed.ray_origin = di_info.ray_origin;
+  packed.seed = di_info.seed;
+  packed.instance_hit = di_info.instance_hit;
+  packed.mat_index_confidence =
+      (di_info.mat_index & 0xFFFF) | (pack_unorm16(di_info.confidence) << 16);
+  return packed;
+}
+
+DIRECT_ILLUMINATION_INFO unpack_di_info(DIRECT_ILLUMINATION_INFO_PACKED packed) {
+  DIRECT_ILLUMINATION_INFO di_info;
+  di_info.position = packed.position;
+  di_info.distance = packed.distance;
+  di_info.normal = unpack_octahedral(packed.normal);
+  di_info.ray_origin = packed.ray_origin;
+  di_info.seed = packed.seed;
+  di_info.instance_hit = packed.instance_hit;
+  di_info.mat_index = packed.mat_index_confidence & 0xFFFF;
+  di_info.confidence = unpack_unorm16(packed.mat_index_confidence >> 16);
+  return di_info;
+}
+
+#if PACKED_RESERVOIRS_ON == 1
+RESERVOIR load_reservoir(RESERVOIR_STORAGE stored) { return unpack_reservoir(stored); }
+RESERVOIR_STORAGE store_reservoir(RESERVOIR reservoir) { return pack_reservoir(reservoir); }
+PATH_RESERVOIR load_path_reservoir(PATH_RESERVOIR_STORAGE stored) { return unpack_path_reservoir(stored); }
+PATH_RESERVOIR_STORAGE store_path_reservoir(PATH_RESERVOIR reservoir) { return pack_path_reservoir(reservoir); }
+DIRECT_ILLUMINATION_INFO load_di_info(DIRECT_ILLUMINATION_INFO_STORAGE stored) { return unpack_di_info(stored); }
+DIRECT_ILLUMINATION_INFO_STORAGE store_di_info(DIRECT_ILLUMINATION_INFO di_info) { return pack_di_info(di_info); }
+#else
+RESERVOIR load_reservoir(RESERVOIR_STORAGE stored) { return stored; }
+RESERVOIR_STORAGE store_reservoir(RESERVOIR reservoir) { return reservoir; }
+PATH_RESERVOIR load_path_reservoir(PATH_RESERVOIR_STORAGE stored) { return stored; }
+PATH_RESERVOIR_STORAGE store_path_reservoir(PATH_RESERVOIR reservoir) { return reservoir; }
+DIRECT_ILLUMINATION_INFO load_di_info(DIRECT_ILLUMINATION_INFO_STORAGE stored) { return stored; }
+DIRECT_ILLUMINATION_INFO_STORAGE store_di_info(DIRECT_ILLUMINATION_INFO di_info) { return di_info; }
+#endif // PACKED_RESERVOIRS_ON
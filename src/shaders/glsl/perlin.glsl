@@ -72,4 +72,13 @@ float get_perlin_turbulence(vec3 P, int octaves, float lacunarity, float gain, d
 }
 
 
+#if BAKED_NOISE_ON == 1
+// get_perlin_turbulence of a tileable volume baked on the host (cpu/noise_volume.hpp) with the octaves, lacunarity &
+// gain in it, one fetch of a repeating sampler with the tile spanning NOISE_VOLUME_PERIOD lattice cells
+float get_baked_perlin_turbulence(vec3 P, daxa_ImageViewId noise_volume, daxa_SamplerId noise_sampler)
+{
+  return texture(daxa_sampler3D(noise_volume, noise_sampler), P / NOISE_VOLUME_PERIOD).r;
+}
+#endif // BAKED_NOISE_ON
+
 #endif // PERLIN_GLSL
\ No newline at end of file
@@ -35,6 +35,18 @@ get_geometry_first_primitive_index_from_instance_id(daxa_u32 instance_id) {
   return instance_buffer.instances[instance_id].first_primitive_index;
 }
 
+daxa_u32 get_primitive_index_from_first_primitive_index(
+    daxa_u32 first_primitive_index, daxa_u32 primitive_id) {
+#if BRICK_PRIMITIVES_ON == 1
+  // Packed around the brick AABB index, the voxel bit stays
+  return ((first_primitive_index + (primitive_id >> BRICK_VOXEL_BITS))
+          << BRICK_VOXEL_BITS) |
+         (primitive_id & (CHUNK_VOXEL_COUNT - 1));
+#else
+  return first_primitive_index + primitive_id;
+#endif // BRICK_PRIMITIVES_ON
+}
+
 daxa_u32 get_current_primitive_index_from_instance_and_primitive_id(
     OBJECT_INFO instance_hit) {
   // Get first primitive index from instance id
@@ -42,7 +54,7 @@ daxa_u32 get_current_primitive_index_from_instance_and_primitive_id(
       get_geometry_first_primitive_index_from_instance_id(
           instance_hit.instance_id);
   // Get actual primitive index from offset and primitive id
-  return (primitive_index != -1) ? primitive_index + instance_hit.primitive_id : primitive_index;
+  return (primitive_index != -1) ? get_primitive_index_from_first_primitive_index(primitive_index, instance_hit.primitive_id) : primitive_index;
 }
 
 daxa_u32 get_previous_primitive_index_from_instance_and_primitive_id(
@@ -52,7 +64,7 @@ daxa_u32 get_previous_primitive_index_from_instance_and_primitive_id(
       get_geometry_previous_first_primitive_index_from_instance_id(
           instance_hit.instance_id);
   // Get actual primitive index from offset and primitive id
-  return (primitive_index != -1) ? primitive_index + instance_hit.primitive_id : primitive_index;
+  return (primitive_index != -1) ? get_primitive_index_from_first_primitive_index(primitive_index, instance_hit.primitive_id) : primitive_index;
 }
 
 INSTANCE get_instance_from_instance_id(daxa_u32 instance_id) {
@@ -67,6 +79,58 @@ INSTANCE get_previous_instance_from_instance_id(daxa_u32 instance_id) {
   return instance_buffer.instances[instance_id];
 }
 
+#if BRICK_PRIMITIVES_ON == 1
+// BRICK BUFFER
+// Hits on brick primitives carry (brick primitive id << BRICK_VOXEL_BITS) | voxel bit as primitive id.
+daxa_u32 pack_brick_voxel(daxa_u32 brick_primitive, daxa_u32 voxel_bit) {
+  return (brick_primitive << BRICK_VOXEL_BITS) | voxel_bit;
+}
+
+daxa_u32 get_brick_slot_from_primitive_index(daxa_u32 primitive_index) {
+  PRIMITIVE_BUFFER primitive_buffer =
+      PRIMITIVE_BUFFER(deref(p.world_buffer).primitive_address);
+  // The primitive of a brick AABB holds the slot of its brick
+  return primitive_buffer.primitives[primitive_index >> BRICK_VOXEL_BITS]
+      .material_index;
+}
+
+daxa_b32 is_brick_voxel_set(daxa_u32 brick_slot, daxa_u32 voxel_bit) {
+  BRICK_BUFFER brick_buffer =
+      BRICK_BUFFER(deref(p.world_buffer).brick_address);
+  return (brick_buffer.bricks[brick_slot].occupancy[voxel_bit >> 5] &
+          (1U << (voxel_bit & 31))) != 0U;
+}
+
+PRIMITIVE get_brick_voxel_from_primitive_index(daxa_u32 primitive_index) {
+  BRICK_BUFFER brick_buffer =
+      BRICK_BUFFER(deref(p.world_buffer).brick_address);
+  return brick_buffer
+      .bricks[get_brick_slot_from_primitive_index(primitive_index)]
+      .voxels[primitive_index & (CHUNK_VOXEL_COUNT - 1)];
+}
+
+// Voxel box of a bit of a brick
+AABB get_voxel_aabb_from_brick(AABB brick_aabb, daxa_u32 voxel_bit) {
+  daxa_f32vec3 cell = daxa_f32vec3(
+      voxel_bit % VOXEL_COUNT_BY_AXIS,
+      (voxel_bit / VOXEL_COUNT_BY_AXIS) % VOXEL_COUNT_BY_AXIS,
+      voxel_bit / (VOXEL_COUNT_BY_AXIS * VOXEL_COUNT_BY_AXIS));
+  daxa_f32vec3 minimum = brick_aabb.minimum + cell * VOXEL_EXTENT;
+  return AABB(minimum, minimum + daxa_f32vec3(VOXEL_EXTENT));
+}
+
+// Brush edits only clear the occupancy bit, the brick AABB & the BLAS stay
+daxa_b32 clear_brick_voxel(daxa_u32 primitive_index) {
+  BRICK_BUFFER brick_buffer =
+      BRICK_BUFFER(deref(p.world_buffer).brick_address);
+  daxa_u32 brick_slot = get_brick_slot_from_primitive_index(primitive_index);
+  daxa_u32 voxel_bit = primitive_index & (CHUNK_VOXEL_COUNT - 1);
+  daxa_u32 result = atomicAnd(
+      brick_buffer.bricks[brick_slot].occupancy[voxel_bit >> 5],
+      ~(1U << (voxel_bit & 31)));
+  return (result & (1U << (voxel_bit & 31))) != 0U;
+}
+#endif // BRICK_PRIMITIVES_ON
 
 // BRUSH COUNTER BUFFER
 
@@ -94,16 +158,34 @@ daxa_u32 increment_brush_counter_primitive_count() {
   return atomicAdd(p.brush_counter.primitive_count, 1);
 }
 
-void delete_primitive_from_instance(OBJECT_INFO instance_hit) {
+void delete_primitive_from_instance(OBJECT_INFO instance_hit,
+                                    daxa_f32vec3 position) {
+#if BRICK_PRIMITIVES_ON == 1
+  // No BLAS rebuild nor rearrangement, the voxel is gone once its bit is cleared
+  clear_brick_voxel(
+      get_current_primitive_index_from_instance_and_primitive_id(instance_hit));
+#else
   PRIMITIVE_BITMASK_BUFFER primitive_bitmask_buffer = PRIMITIVE_BITMASK_BUFFER(
       deref(p.status_buffer).primitive_bitmask_address);
   INSTANCE_BITMASK_BUFFER instance_bitmask_buffer =
       INSTANCE_BITMASK_BUFFER(deref(p.status_buffer).instance_bitmask_address);
+  BRUSH_RANGE_OWNER_BUFFER range_owner_buffer =
+      BRUSH_RANGE_OWNER_BUFFER(deref(p.status_buffer).brush_range_owner_address);
   daxa_u32 primitive_index =
       get_current_primitive_index_from_instance_and_primitive_id(instance_hit);
 
   daxa_u32 instance_index = instance_hit.instance_id;
 
+  // Placements share the range of their prototype, the first one hit claims it & the others wait for the next stroke
+  daxa_u32 range_index =
+      get_geometry_first_primitive_index_from_instance_id(instance_index) / BRUSH_RANGE_ALIGNMENT;
+  daxa_u32 range_owner =
+      atomicCompSwap(range_owner_buffer.range_owners[range_index],
+                     BRUSH_RANGE_UNCLAIMED, instance_index);
+  if (range_owner != BRUSH_RANGE_UNCLAIMED && range_owner != instance_index) {
+    return;
+  }
+
   // atomic or operation to set the bit to 1
   daxa_u32 result_instance =
       atomicOr(instance_bitmask_buffer.instance_bitmask[instance_index >> 5],
@@ -120,6 +202,26 @@ void delete_primitive_from_instance(OBJECT_INFO instance_hit) {
   if ((result_instance & (1U << (instance_index & 31))) == 0U) {
     increment_brush_counter_instance_count();
   }
+
+#if MERGED_BOXES_ON == 1
+  // The host splits a merged box, the position tells it which of its voxels to delete
+  AABB_BUFFER aabb_buffer = AABB_BUFFER(deref(p.world_buffer).aabb_address);
+  AABB aabb = aabb_buffer.aabbs[primitive_index];
+  if (any(greaterThan(aabb.maximum - aabb.minimum,
+                      daxa_f32vec3(VOXEL_EXTENT * 1.5f)))) {
+    BRUSH_COUNTER_BUFFER brush_counter_buffer =
+        BRUSH_COUNTER_BUFFER(deref(p.status_buffer).brush_counter_address);
+    daxa_u32 box_hit_index =
+        atomicAdd(brush_counter_buffer.brush_counter.box_hit_count, 1);
+    if (box_hit_index < MAX_BRUSH_BOX_HITS) {
+      BRUSH_BOX_HIT_BUFFER box_hit_buffer =
+          BRUSH_BOX_HIT_BUFFER(deref(p.status_buffer).brush_box_hit_address);
+      box_hit_buffer.box_hits[box_hit_index] =
+          BRUSH_BOX_HIT(primitive_index, position);
+    }
+  }
+#endif // MERGED_BOXES_ON
+#endif // BRICK_PRIMITIVES_ON
 }
 
 // REMAPPED PRIMITIVE BUFFER
@@ -127,7 +229,14 @@ daxa_u32 get_remapped_primitive_index(daxa_u32 primitive_index) {
   REMAPPED_PRIMITIVE_BUFFER remapped_primitive_buffer =
       REMAPPED_PRIMITIVE_BUFFER(
           deref(p.world_buffer).remapped_primitive_address);
+#if BRICK_PRIMITIVES_ON == 1
+  // Bricks are remapped as a whole, the voxel bit stays
+  return pack_brick_voxel(
+      remapped_primitive_buffer.primitives[primitive_index >> BRICK_VOXEL_BITS],
+      primitive_index & (CHUNK_VOXEL_COUNT - 1));
+#else
   return remapped_primitive_buffer.primitives[primitive_index];
+#endif // BRICK_PRIMITIVES_ON
 }
 
 daxa_u32 get_remapped_primitive_index_by_object_hit(OBJECT_INFO instance_hit) {
@@ -147,20 +256,35 @@ daxa_u32 get_remapped_light_index(daxa_u32 light_index) {
 // AABB BUFFER
 AABB get_aabb_from_primitive_index(daxa_u32 primitive_index) {
   AABB_BUFFER aabb_buffer = AABB_BUFFER(deref(p.world_buffer).aabb_address);
+#if BRICK_PRIMITIVES_ON == 1
+  // Box of the voxel inside of its brick
+  return get_voxel_aabb_from_brick(
+      aabb_buffer.aabbs[primitive_index >> BRICK_VOXEL_BITS],
+      primitive_index & (CHUNK_VOXEL_COUNT - 1));
+#else
   return aabb_buffer.aabbs[primitive_index];
+#endif // BRICK_PRIMITIVES_ON
 }
 
 // PRIMITIVE BUFFER
 daxa_u32 get_material_index_from_primitive_index(daxa_u32 primitive_index) {
+#if BRICK_PRIMITIVES_ON == 1
+  return get_brick_voxel_from_primitive_index(primitive_index).material_index;
+#else
   PRIMITIVE_BUFFER primitive_buffer =
       PRIMITIVE_BUFFER(deref(p.world_buffer).primitive_address);
   return primitive_buffer.primitives[primitive_index].material_index;
+#endif // BRICK_PRIMITIVES_ON
 }
 
 daxa_u32 get_light_index_from_primitive_index(daxa_u32 primitive_index) {
+#if BRICK_PRIMITIVES_ON == 1
+  return get_brick_voxel_from_primitive_index(primitive_index).light_index;
+#else
   PRIMITIVE_BUFFER primitive_buffer =
       PRIMITIVE_BUFFER(deref(p.world_buffer).primitive_address);
   return primitive_buffer.primitives[primitive_index].light_index;
+#endif // BRICK_PRIMITIVES_ON
 }
 
 // MATERIAL BUFFER
@@ -354,6 +478,110 @@ daxa_b32 intersect_box(Box box, Ray ray, out daxa_f32 distance,
   return (sgn.x != 0) || (sgn.y != 0) || (sgn.z != 0);
 }
 
+#if BRICK_PRIMITIVES_ON == 1
+// Brick walk (host port: src/cpu/brick_primitives.hpp intersect_brick): DDA over the voxels of the brick
+// inside (t_min, t_max), the first set voxel whose box is hit in range is the closest one.
+// instance_hit comes with the BLAS primitive id of the brick & leaves with the packed voxel id.
+daxa_b32 is_hit_from_brick(Ray ray, inout OBJECT_INFO instance_hit,
+                           daxa_f32 t_min, daxa_f32 t_max, out daxa_f32 t_hit,
+                           daxa_f32mat4x4 world2obj,
+                           const in daxa_b32 previous_frame) {
+  INSTANCE instance =
+      previous_frame
+          ? get_previous_instance_from_instance_id(instance_hit.instance_id)
+          : get_instance_from_instance_id(instance_hit.instance_id);
+
+  daxa_u32 brick_index = instance.first_primitive_index + instance_hit.primitive_id;
+  AABB_BUFFER aabb_buffer = AABB_BUFFER(deref(p.world_buffer).aabb_address);
+  AABB brick_aabb = aabb_buffer.aabbs[brick_index];
+  daxa_u32 brick_slot =
+      get_brick_slot_from_primitive_index(pack_brick_voxel(brick_index, 0));
+
+  Ray obj_ray = Ray((world2obj * vec4(ray.origin, 1)).xyz,
+                    (world2obj * vec4(ray.direction, 0)).xyz);
+  daxa_f32vec3 obj_inv_direction = safeInverse(obj_ray.direction);
+
+  // Voxel units relative to the brick corner, t is unchanged
+  daxa_f32vec3 origin = (obj_ray.origin - brick_aabb.minimum) / VOXEL_EXTENT;
+  daxa_f32vec3 direction = obj_ray.direction / VOXEL_EXTENT;
+  daxa_f32vec3 inv_direction = safeInverse(direction);
+
+  daxa_f32vec3 t0 = -origin * inv_direction;
+  daxa_f32vec3 t1 = (daxa_f32vec3(VOXEL_COUNT_BY_AXIS) - origin) * inv_direction;
+  daxa_f32vec3 t_near = min(t0, t1);
+  daxa_f32vec3 t_far = max(t0, t1);
+  daxa_f32 t_start = max(max(t_near.x, t_near.y), max(t_near.z, t_min));
+  daxa_f32 t_end = min(min(t_far.x, t_far.y), min(t_far.z, t_max));
+  if (t_start > t_end)
+    return false;
+
+  // Clamped so the rounding of the entry point can't leave the brick
+  daxa_i32vec3 cell = clamp(daxa_i32vec3(floor(origin + direction * t_start)),
+                            daxa_i32vec3(0), daxa_i32vec3(VOXEL_COUNT_BY_AXIS - 1));
+  daxa_i32vec3 cell_step = daxa_i32vec3(0);
+  daxa_f32vec3 t_next = daxa_f32vec3(uintBitsToFloat(0x7F800000U));
+  daxa_f32vec3 t_delta = daxa_f32vec3(uintBitsToFloat(0x7F800000U));
+  for (daxa_i32 axis = 0; axis < 3; ++axis) {
+    if (direction[axis] > 0.0) {
+      cell_step[axis] = 1;
+      t_next[axis] = (daxa_f32(cell[axis] + 1) - origin[axis]) / direction[axis];
+      t_delta[axis] = 1.0 / direction[axis];
+    } else if (direction[axis] < 0.0) {
+      cell_step[axis] = -1;
+      t_next[axis] = (daxa_f32(cell[axis]) - origin[axis]) / direction[axis];
+      t_delta[axis] = -1.0 / direction[axis];
+    }
+  }
+
+  daxa_f32vec3 half_extent = daxa_f32vec3(HALF_VOXEL_EXTENT);
+  // A line crosses at most 3 * 8 - 2 cells of the brick
+  for (daxa_u32 i = 0; i < 3 * VOXEL_COUNT_BY_AXIS; ++i) {
+    daxa_u32 voxel_bit =
+        cell.x + VOXEL_COUNT_BY_AXIS * (cell.y + VOXEL_COUNT_BY_AXIS * cell.z);
+    if (is_brick_voxel_set(brick_slot, voxel_bit)) {
+      AABB voxel_aabb = get_voxel_aabb_from_brick(brick_aabb, voxel_bit);
+      Box box = Box((voxel_aabb.minimum + voxel_aabb.maximum) * 0.5,
+                    half_extent, safeInverse(half_extent), mat3(1.f));
+      daxa_f32 voxel_distance;
+      daxa_f32vec3 nor;
+      if (intersect_box(box, obj_ray, voxel_distance, nor, true, true,
+                        obj_inv_direction) &&
+          voxel_distance > t_min && voxel_distance < t_max) {
+        t_hit = voxel_distance;
+        instance_hit.primitive_id =
+            pack_brick_voxel(instance_hit.primitive_id, voxel_bit);
+        return true;
+      }
+    }
+
+    daxa_i32 axis = (t_next.x < t_next.y) ? (t_next.x < t_next.z ? 0 : 2)
+                                          : (t_next.y < t_next.z ? 1 : 2);
+    if (t_next[axis] > t_end)
+      break;
+    cell[axis] += cell_step[axis];
+    if (cell[axis] < 0 || cell[axis] >= VOXEL_COUNT_BY_AXIS)
+      break;
+    t_next[axis] += t_delta[axis];
+  }
+
+  return false;
+}
+
+// Ray queries & hit objects report the brick, this finds its voxel so the following calls see a voxel
+daxa_b32 resolve_brick_voxel(Ray ray, inout OBJECT_INFO instance_hit,
+                             daxa_f32 t_min, daxa_f32 t_max,
+                             const in daxa_b32 previous_frame) {
+  daxa_f32mat4x4 obj2world =
+      previous_frame ? get_geometry_previous_transform_from_instance_id(
+                           instance_hit.instance_id)
+                     : get_geometry_transform_from_instance_id(
+                           instance_hit.instance_id);
+  daxa_f32 t_hit;
+  return is_hit_from_brick(ray, instance_hit, t_min, t_max, t_hit,
+                           inverse(obj2world), previous_frame);
+}
+#endif // BRICK_PRIMITIVES_ON
+
 daxa_b32 is_hit_from_ray_providing_model(
     Ray ray, OBJECT_INFO instance_hit, daxa_f32vec3 half_extent,
     out daxa_f32 t_hit, daxa_f32mat4x4 obj2world, daxa_f32mat4x4 world2obj,
@@ -361,12 +589,17 @@ daxa_b32 is_hit_from_ray_providing_model(
   INSTANCE instance = get_instance_from_instance_id(instance_hit.instance_id);
 
   daxa_u32 current_primitive_index =
-      instance.first_primitive_index + instance_hit.primitive_id;
+      get_primitive_index_from_first_primitive_index(
+          instance.first_primitive_index, instance_hit.primitive_id);
 
   // Get aabb from primitive
   AABB aabb = get_aabb_from_primitive_index(current_primitive_index);
 
   daxa_f32vec3 aabb_center = (aabb.minimum + aabb.maximum) * 0.5;
+#if MERGED_BOXES_ON == 1
+  // Merged boxes span several voxels
+  half_extent = (aabb.maximum - aabb.minimum) * 0.5;
+#endif // MERGED_BOXES_ON
   daxa_f32vec3 pos;
   daxa_f32vec3 nor;
 
@@ -389,12 +622,17 @@ daxa_b32 is_hit_from_ray_providing_model_get_pos_and_nor(
   INSTANCE instance = get_instance_from_instance_id(instance_hit.instance_id);
 
   daxa_u32 current_primitive_index =
-      instance.first_primitive_index + instance_hit.primitive_id;
+      get_primitive_index_from_first_primitive_index(
+          instance.first_primitive_index, instance_hit.primitive_id);
 
   // Get aabb from primitive
   AABB aabb = get_aabb_from_primitive_index(current_primitive_index);
 
   daxa_f32vec3 aabb_center = (aabb.minimum + aabb.maximum) * 0.5;
+#if MERGED_BOXES_ON == 1
+  // Merged boxes span several voxels
+  half_extent = (aabb.maximum - aabb.minimum) * 0.5;
+#endif // MERGED_BOXES_ON
 
   Ray obj_ray = Ray((world2obj * vec4(ray.origin, 1)).xyz,
                     (world2obj * vec4(ray.direction, 0)).xyz);
@@ -429,7 +667,8 @@ daxa_b32 is_hit_from_ray(Ray ray, OBJECT_INFO instance_hit,
   obj2world = instance.transform;
 
   daxa_u32 current_primitive_index =
-      instance.first_primitive_index + instance_hit.primitive_id;
+      get_primitive_index_from_first_primitive_index(
+          instance.first_primitive_index, instance_hit.primitive_id);
 
   // Get aabb from primitive
   AABB aabb = get_aabb_from_primitive_index(current_primitive_index);
@@ -437,6 +676,10 @@ daxa_b32 is_hit_from_ray(Ray ray, OBJECT_INFO instance_hit,
   world2obj = inverse(obj2world);
 
   daxa_f32vec3 aabb_center = (aabb.minimum + aabb.maximum) * 0.5;
+#if MERGED_BOXES_ON == 1
+  // Merged boxes span several voxels
+  half_extent = (aabb.maximum - aabb.minimum) * 0.5;
+#endif // MERGED_BOXES_ON
 
   Ray obj_ray = Ray((world2obj * vec4(ray.origin, 1)).xyz,
                     (world2obj * vec4(ray.direction, 0)).xyz);
@@ -478,6 +721,10 @@ daxa_b32 is_hit_from_origin(daxa_f32vec3 origin_world_space,
   world2obj = inverse(obj2world);
 
   daxa_f32vec3 aabb_center = (aabb.minimum + aabb.maximum) * 0.5;
+#if MERGED_BOXES_ON == 1
+  // Merged boxes span several voxels
+  half_extent = (aabb.maximum - aabb.minimum) * 0.5;
+#endif // MERGED_BOXES_ON
 
   Ray world_ray =
       Ray(origin_world_space, normalize((obj2world * vec4(aabb_center, 1)).xyz -
@@ -523,11 +770,20 @@ void packed_intersection_info(Ray ray, daxa_f32 t_hit, OBJECT_INFO instance_hit,
   // Get center of aabb
   daxa_f32vec3 center = (aabb.minimum + aabb.maximum) * 0.5;
 
+  // Computing the normal at hit position
+#if MERGED_BOXES_ON == 1
+  // In object space, where the box extent is: scaled by it the dominant axis is the face that was hit, whatever the
+  // scale of the instance
+  daxa_f32mat4x4 world2obj = inverse(model);
+  daxa_f32vec3 obj_pos = (world2obj * vec4(world_pos, 1)).xyz;
+  daxa_f32vec3 obj_nrm = cube_like_normal((obj_pos - center) / max((aabb.maximum - aabb.minimum) * 0.5, daxa_f32vec3(HALF_VOXEL_EXTENT)));
+  world_nrm = normalize((transpose(world2obj) * vec4(obj_nrm, 0)).xyz);
+#else
   // Transform center to world space
   center = (model * vec4(center, 1)).xyz;
 
-  // Computing the normal at hit position
   world_nrm = normalize(world_pos - center);
+#endif // MERGED_BOXES_ON
 
   // Normal should be cube like
   world_nrm = cube_like_normal(world_nrm);
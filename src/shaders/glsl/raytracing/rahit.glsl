@@ -11,7 +11,7 @@ DAXA_DECL_PUSH_CONSTANT(PushConstant, p)
 void main()
 {
 
-  OBJECT_INFO instance_hit = OBJECT_INFO(gl_InstanceCustomIndexEXT, gl_PrimitiveID);
+  OBJECT_INFO instance_hit = OBJECT_INFO(gl_InstanceCustomIndexEXT, HIT_PRIMITIVE_ID);
   // Get first primitive index from instance id
   daxa_u32 actual_primitive_index = get_current_primitive_index_from_instance_and_primitive_id(instance_hit);
 
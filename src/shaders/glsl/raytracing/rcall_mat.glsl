@@ -46,7 +46,11 @@ void main()
 void main()
 {
     vec3 s = PERLIN_FACTOR * VOXEL_EXTENT * abs(hit_call.hit);
+#if BAKED_NOISE_ON == 1
+    float turbulence = get_baked_perlin_turbulence(s, hit_call.texture_id, hit_call.sampler_id);
+#else
     float turbulence = get_perlin_turbulence(s, 4, 2.0, 0.5, hit_call.texture_id, hit_call.sampler_id);
+#endif // BAKED_NOISE_ON
     hit_call.hit_value = vec3(0.5 * (1 + sin(s.z + 10 * turbulence)));
 }
 
@@ -36,7 +36,7 @@ void main()
     daxa_f32vec3 world_nrm;
     daxa_f32 distance = gl_HitTEXT;
     daxa_u32 actual_primitive_index = 0;
-    OBJECT_INFO instance_hit = OBJECT_INFO(gl_InstanceCustomIndexEXT, gl_PrimitiveID);
+    OBJECT_INFO instance_hit = OBJECT_INFO(gl_InstanceCustomIndexEXT, HIT_PRIMITIVE_ID);
     
     packed_intersection_info(ray, distance, instance_hit, model, world_pos, world_nrm, actual_primitive_index);
 
@@ -73,7 +73,7 @@ void main()
     daxa_f32vec3 world_pos;
     daxa_f32vec3 world_nrm;
     daxa_f32 distance = gl_HitTEXT;
-    OBJECT_INFO instance_hit = OBJECT_INFO(gl_InstanceCustomIndexEXT, gl_PrimitiveID);
+    OBJECT_INFO instance_hit = OBJECT_INFO(gl_InstanceCustomIndexEXT, HIT_PRIMITIVE_ID);
     daxa_u32 actual_primitive_index = 0;
     
     packed_intersection_info(ray, distance, instance_hit, model, world_pos, world_nrm, actual_primitive_index);
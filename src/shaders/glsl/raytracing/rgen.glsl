@@ -7,6 +7,12 @@ DAXA_DECL_PUSH_CONSTANT(PushConstant, p)
 #include "prng.glsl"
 #include "indirect_illumination.glsl"
 #include "restir_resampling.glsl"
+#if ADAPTIVE_SAMPLING_ACTIVE == 1
+#include "adaptive_sampling.glsl"
+#endif // ADAPTIVE_SAMPLING_ACTIVE
+#if DENOISER_ON == 1
+#include "denoiser.glsl"
+#endif // DENOISER_ON
 
 // #if SER == 1
 // #extension GL_NV_shader_invocation_reorder : enable
@@ -81,6 +87,21 @@ void main() {
 
   daxa_u32 screen_pos = index.y * rt_size.x + index.x;
 
+#if ADAPTIVE_SAMPLING_ACTIVE == 1
+  // Pixels of converged tiles keep their mean & pass their error on, the third pass skips them too
+  daxa_u64 accumulated_frames = deref(p.status_buffer).num_accumulated_frames;
+  clear_adaptive_tile_error(daxa_u32vec2(index), rt_size, frame_number);
+  ADAPTIVE_PIXEL adaptive_pixel = get_adaptive_pixel_by_index(screen_pos);
+  if (!is_adaptive_pixel_active(daxa_u32vec2(index), rt_size, frame_number,
+                                accumulated_frames, adaptive_pixel)) {
+    add_adaptive_tile_error(daxa_u32vec2(index), rt_size, frame_number,
+                            adaptive_pixel);
+    imageStore(daxa_image2D(p.swapchain), index,
+               daxa_f32vec4(adaptive_pixel.mean, 1.0));
+    return;
+  }
+#endif // ADAPTIVE_SAMPLING_ACTIVE
+
   daxa_b32 is_hit = false;
   daxa_f32mat4x4 obj2world;
   daxa_f32mat4x4 world2obj;
@@ -118,6 +139,11 @@ void main() {
 
     prd.instance_hit = OBJECT_INFO(instance_id, primitive_id);
 
+#if BRICK_PRIMITIVES_ON == 1
+    // The hit object reports the brick
+    resolve_brick_voxel(ray, prd.instance_hit, t_min, t_max, false);
+#endif // BRICK_PRIMITIVES_ON
+
     // TODO: pass this as a parameter
     daxa_f32vec3 half_extent = daxa_f32vec3(HALF_VOXEL_EXTENT);
 
@@ -169,6 +195,11 @@ void main() {
   // #endif // SER
 
   if (is_hit == false) {
+#if ADAPTIVE_SAMPLING_ACTIVE == 1
+    prd.hit_value = adaptive_accumulate(daxa_u32vec2(index), rt_size,
+                                        frame_number, accumulated_frames,
+                                        prd.hit_value);
+#endif // ADAPTIVE_SAMPLING_ACTIVE
     imageStore(daxa_image2D(p.swapchain), index,
                daxa_f32vec4(prd.hit_value, 1.0));
 #if INDIRECT_ILLUMINATION_ON == 1
@@ -292,8 +323,9 @@ void main() {
     // Replace NaN components with zero.
     if (any(isinf(indirect_color)) || any(isnan(indirect_color)))
       indirect_color = vec3(0.0);
+// The adaptive mean accumulates the whole pixel in the third pass
 #if (ACCUMULATOR_ON == 1 && RESTIR_ON == 0 && RESTIR_PT_ON == 0 ||             \
-     FORCE_ACCUMULATOR_ON == 1)
+     FORCE_ACCUMULATOR_ON == 1) && ADAPTIVE_SAMPLING_ACTIVE == 0
     daxa_u64 num_accumulated_frames =
         deref(p.status_buffer).num_accumulated_frames;
     if (num_accumulated_frames > 0) {
@@ -339,6 +371,19 @@ void main() {
   // Get feature flags
   daxa_u32 active_features = deref(p.status_buffer).is_active;
 
+#if ADAPTIVE_SAMPLING_ACTIVE == 1
+  // Same decision as the first pass (its misses may have stopped since, their mean is stored already)
+  daxa_u32 frame_number = deref(p.status_buffer).frame_number;
+  daxa_u64 accumulated_frames = deref(p.status_buffer).num_accumulated_frames;
+  ADAPTIVE_PIXEL adaptive_pixel = get_adaptive_pixel_by_index(screen_pos);
+  if (!is_adaptive_pixel_active(daxa_u32vec2(index), rt_size, frame_number,
+                                accumulated_frames, adaptive_pixel)) {
+    imageStore(daxa_image2D(p.swapchain), index,
+               daxa_f32vec4(adaptive_pixel.mean, 1.0));
+    return;
+  }
+#endif // ADAPTIVE_SAMPLING_ACTIVE
+
   // Get hit info
   DIRECT_ILLUMINATION_INFO di_info = get_di_from_current_frame(screen_pos);
 
@@ -424,6 +469,11 @@ void main() {
 #endif // DIRECT_ILLUMINATION_ON
 #endif // RESTIR_DI_ON
 
+#if DENOISER_ON == 1
+    // The denoiser (compute/svgf.glsl) filters the direct & indirect light apart
+    set_denoiser_direct_by_index(screen_pos, hit_value);
+#endif // DENOISER_ON
+
 #if INDIRECT_ILLUMINATION_ON == 1
     daxa_f32vec3 indirect_color = daxa_f32vec3(0.f);
 #if RESTIR_ON == 1 && RESTIR_PT_ON == 1 && RESTIR_PT_SPATIAL_ON == 1
@@ -445,6 +495,9 @@ void main() {
     daxa_f32vec3 camera_pos = daxa_f32vec3(inv_view[3]);
     indirect_illumination_spatial_reuse(params, index, rt_size, i, camera_pos,
                                         di_info.seed, indirect_color);
+#if DENOISER_ON == 1
+    set_indirect_color_by_index(screen_pos, indirect_color);
+#endif // DENOISER_ON
 #else
     indirect_color = get_indirect_color_by_index(screen_pos);
 #endif // RESTIR_PT_ON && RESTIR_PT_SPATIAL_ON
@@ -468,7 +521,12 @@ void main() {
     clamp(hit_value, 0.0, 0.99999999);
 
     daxa_f32vec4 final_pixel;
-#if (ACCUMULATOR_ON == 1 && RESTIR_ON == 0 || FORCE_ACCUMULATOR_ON == 1)
+#if ADAPTIVE_SAMPLING_ACTIVE == 1
+    final_pixel = vec4(adaptive_accumulate(daxa_u32vec2(index), rt_size,
+                                           frame_number, accumulated_frames,
+                                           hit_value),
+                       1.0f);
+#elif (ACCUMULATOR_ON == 1 && RESTIR_ON == 0 || FORCE_ACCUMULATOR_ON == 1)
     daxa_u64 num_accumulated_frames =
         deref(p.status_buffer).num_accumulated_frames;
     if (num_accumulated_frames > 0) {
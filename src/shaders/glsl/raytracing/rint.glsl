@@ -31,11 +31,20 @@ void main() {
   // TODO: pass this as a parameter
   daxa_f32vec3 half_extent = daxa_f32vec3(HALF_VOXEL_EXTENT);
 
+#if BRICK_PRIMITIVES_ON == 1
+  // Closest set voxel of the brick, reported through the hit attribute
+  t_hit = is_hit_from_brick(ray, instance_hit, gl_RayTminEXT, gl_RayTmaxEXT,
+                            t_hit, world2obj, false)
+              ? t_hit
+              : -1.0;
+  brick_voxel_bit = instance_hit.primitive_id & (CHUNK_VOXEL_COUNT - 1);
+#else
   t_hit =
       is_hit_from_ray_providing_model(ray, instance_hit, half_extent, t_hit,
                                       obj2world, world2obj, true, true)
           ? t_hit
           : -1.0;
+#endif // BRICK_PRIMITIVES_ON
 
   // Report hit point
   if (t_hit > 0)
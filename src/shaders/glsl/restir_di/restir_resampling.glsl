@@ -8,9 +8,17 @@
 
 #include "direct_light_info.glsl"
 #include "light.glsl"
+#if LIGHT_TREE_ON == 1
+#include "light_tree.glsl"
+#elif LIGHT_ALIAS_TABLE_ON == 1
+#include "light_alias_table.glsl"
+#endif // LIGHT_TREE_ON
 #include "motion_vectors.glsl"
 #include "pairwise_mis.glsl"
 #include "reservoir.glsl"
+#if SAMPLER_TYPE != SAMPLER_TYPE_LCG
+#include "sampler.glsl"
+#endif // SAMPLER_TYPE
 
 #if SER == 1
 #extension GL_NV_shader_invocation_reorder : enable
@@ -151,8 +159,34 @@ RESERVOIR RIS(daxa_u32 active_features, LIGHT_CONFIG light_config,
     daxa_f32 pdf = 1.0 / cube_light_count;
 
     for (daxa_u32 l = 0; l < num_of_cube_samples; l++) {
+#if SAMPLER_TYPE != SAMPLER_TYPE_LCG
+      // The candidates of the frames are successive samples of the light pick dimension, stratified together
+      daxa_f32 light_u = sampler_get_1d(
+          gl_LaunchIDEXT.xy,
+          deref(p.status_buffer).frame_number * MAX_RIS_CUBE_SAMPLE_COUNT + l,
+          sampler_get_bounce_dimension(0, SAMPLER_BOUNCE_LIGHT));
+#else
+      daxa_f32 light_u = rnd(seed);
+#endif // SAMPLER_TYPE
+#if LIGHT_TREE_ON == 1
+      // Light picked by its importance for this hit, pdf is its pmf
+      daxa_u32 light_index;
+      if (!light_tree_sample(hit.world_hit,
+                             get_light_tree_receiver_normal(mat, hit.world_nrm),
+                             light_u, light_index, pdf)) {
+        continue;
+      }
+#elif LIGHT_ALIAS_TABLE_ON == 1
+      // Light picked by its power, pdf is its pmf
+      daxa_u32 light_index;
+      if (!light_alias_sample(cube_light_count, light_u, seed, light_index,
+                              pdf)) {
+        continue;
+      }
+#else
       daxa_u32 light_index =
-          min(urnd_interval(seed, 0, cube_light_count), cube_light_count - 1);
+          min(daxa_u32(light_u * cube_light_count), cube_light_count - 1);
+#endif // LIGHT_TREE_ON
 
       LIGHT light = get_cube_light_from_light_index(light_index);
 
@@ -214,7 +248,23 @@ RESERVOIR RIS(daxa_u32 active_features, LIGHT_CONFIG light_config,
             G = 0.0;
           }
 
+          daxa_u32 primitive_index =
+              get_current_primitive_index_from_instance_and_primitive_id(
+                  i.instance_hit);
+
+          light_index = get_light_index_from_primitive_index(primitive_index);
+
+#if LIGHT_TREE_ON == 1
+          daxa_f32 light_pdf =
+              light_tree_pmf(P, get_light_tree_receiver_normal(mat, n),
+                             light_index) /
+              (VOXEL_EXTENT * VOXEL_EXTENT * CUBE_FACE_COUNT);
+#elif LIGHT_ALIAS_TABLE_ON == 1
+          daxa_f32 light_pdf = light_alias_pmf(light_index) /
+                               (VOXEL_EXTENT * VOXEL_EXTENT * CUBE_FACE_COUNT);
+#else
           daxa_f32 light_pdf = sample_lights_pdf(hit, i, cube_light_count);
+#endif // LIGHT_TREE_ON
           daxa_f32 m_i = 1.f / max(num_of_brdf_samples * mat_pdf * G +
                                        nee_samples * light_pdf * G,
                                    1e-6);
@@ -222,12 +272,6 @@ RESERVOIR RIS(daxa_u32 active_features, LIGHT_CONFIG light_config,
           daxa_f32vec3 Le = evaluate_emissive(i, m_wi);
           F = brdf * Le * G;
           w_i = luminance(F) * m_i;
-
-          daxa_u32 primitive_index =
-              get_current_primitive_index_from_instance_and_primitive_id(
-                  i.instance_hit);
-
-          light_index = get_light_index_from_primitive_index(primitive_index);
         }
       }
 
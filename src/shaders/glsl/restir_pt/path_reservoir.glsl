@@ -3,12 +3,13 @@
 #extension GL_EXT_ray_tracing : enable
 #include <daxa/daxa.inl>
 #include "defines.glsl"
+#include "packing.glsl"
 
 PATH_RESERVOIR get_output_path_reservoir_by_index(daxa_u32 reservoir_index) {
   OUTPUT_PATH_RESERVOIR_BUFFER output_path_reservoir_buffer =
       OUTPUT_PATH_RESERVOIR_BUFFER(
           deref(p.restir_buffer).output_path_reservoir_address);
-  return output_path_reservoir_buffer.path_reservoirs[reservoir_index];
+  return load_path_reservoir(output_path_reservoir_buffer.path_reservoirs[reservoir_index]);
 }
 
 void set_output_path_reservoir_by_index(daxa_u32 reservoir_index,
@@ -16,14 +17,14 @@ void set_output_path_reservoir_by_index(daxa_u32 reservoir_index,
   OUTPUT_PATH_RESERVOIR_BUFFER output_path_reservoir_buffer =
       OUTPUT_PATH_RESERVOIR_BUFFER(
           deref(p.restir_buffer).output_path_reservoir_address);
-  output_path_reservoir_buffer.path_reservoirs[reservoir_index] = reservoir;
+  output_path_reservoir_buffer.path_reservoirs[reservoir_index] = store_path_reservoir(reservoir);
 }
 
 PATH_RESERVOIR get_temporal_path_reservoir_by_index(daxa_u32 reservoir_index) {
   TEMPORAL_PATH_RESERVOIR_BUFFER temporal_path_reservoir_buffer =
       TEMPORAL_PATH_RESERVOIR_BUFFER(
           deref(p.restir_buffer).temporal_path_reservoir_address);
-  return temporal_path_reservoir_buffer.path_reservoirs[reservoir_index];
+  return load_path_reservoir(temporal_path_reservoir_buffer.path_reservoirs[reservoir_index]);
 }
 
 void set_temporal_path_reservoir_by_index(daxa_u32 reservoir_index,
@@ -31,7 +32,7 @@ void set_temporal_path_reservoir_by_index(daxa_u32 reservoir_index,
   TEMPORAL_PATH_RESERVOIR_BUFFER temporal_path_reservoir_buffer =
       TEMPORAL_PATH_RESERVOIR_BUFFER(
           deref(p.restir_buffer).temporal_path_reservoir_address);
-  temporal_path_reservoir_buffer.path_reservoirs[reservoir_index] = reservoir;
+  temporal_path_reservoir_buffer.path_reservoirs[reservoir_index] = store_path_reservoir(reservoir);
 }
 
 RECONNECTION_DATA get_reconnection_data_from_current_frame(daxa_u32 pixel_index,
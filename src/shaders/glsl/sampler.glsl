@@ -0,0 +1,114 @@
+#pragma once
+#include <daxa/daxa.inl>
+#include "defines.glsl"
+#include "random.glsl"
+#include "sampler_tables.inl"
+
+// Random numbers as a function of (pixel, frame, dimension), SAMPLER_TYPE picks the sampler (cpu/sampler.hpp mirrors
+// every function, both give the same bits). Tables are generated by sampler_tables.
+
+#define SAMPLER_PCG_SALT 0x2c1b3c6dU
+#define SAMPLER_BLUE_NOISE_SALT 0x297a2d39U
+
+daxa_u32 sampler_pcg(daxa_u32 v) {
+  daxa_u32 state = v * 747796405U + 2891336453U;
+  daxa_u32 word = ((state >> ((state >> 28U) + 4U)) ^ state) * 277803737U;
+  return (word >> 22U) ^ word;
+}
+
+// Jarzynski & Olano 2020
+daxa_u32vec4 sampler_pcg4d(daxa_u32vec4 v) {
+  v = v * 1664525U + 1013904223U;
+
+  v.x += v.y * v.w;
+  v.y += v.z * v.x;
+  v.z += v.x * v.y;
+  v.w += v.y * v.z;
+
+  v ^= v >> 16U;
+
+  v.x += v.y * v.w;
+  v.y += v.z * v.x;
+  v.z += v.x * v.y;
+  v.w += v.y * v.z;
+
+  return v;
+}
+
+daxa_u32 sampler_hash_combine(daxa_u32 seed, daxa_u32 v) {
+  return sampler_pcg(seed ^ sampler_pcg(v));
+}
+
+// Owen scrambling of the bits of x from the highest one (Burley 2020)
+daxa_u32 sampler_nested_uniform_scramble(daxa_u32 x, daxa_u32 seed) {
+  x = bitfieldReverse(x);
+  x ^= x * 0x3d20adeaU;
+  x += seed;
+  x *= (seed >> 16U) | 1U;
+  x ^= x * 0x05526c56U;
+  x ^= x * 0x53a22864U;
+  return bitfieldReverse(x);
+}
+
+daxa_u32 sampler_sobol(daxa_u32 index, daxa_u32 dimension) {
+  daxa_u32 result = 0;
+  for (daxa_u32 bit = dimension * 32U; index != 0; index >>= 1U, ++bit)
+    if ((index & 1U) != 0)
+      result ^= sampler_sobol_matrices[bit];
+  return result;
+}
+
+// The index is shuffled with the seed of the set, every dimension of it scrambled with its own
+daxa_u32 sampler_owen_sobol(daxa_u32 index, daxa_u32 dimension, daxa_u32 seed) {
+  daxa_u32 set_dimension = dimension % SAMPLER_SOBOL_DIMENSIONS;
+  index = sampler_nested_uniform_scramble(index, seed);
+  return sampler_nested_uniform_scramble(
+      sampler_sobol(index, set_dimension),
+      sampler_hash_combine(seed, set_dimension));
+}
+
+daxa_u32 sampler_get_blue_noise_rank(daxa_u32 x, daxa_u32 y) {
+  daxa_u32 cell = (y % SAMPLER_BLUE_NOISE_SIZE) * SAMPLER_BLUE_NOISE_SIZE +
+                  (x % SAMPLER_BLUE_NOISE_SIZE);
+  return (sampler_blue_noise_ranks[cell >> 1U] >> ((cell & 1U) * 16U)) &
+         0xffffU;
+}
+
+// 24 high bits to [0, 1)
+daxa_f32 sampler_to_float(daxa_u32 bits) {
+  return daxa_f32(bits >> 8U) * (1.0 / 16777216.0);
+}
+
+daxa_u32 sampler_get_bits(daxa_u32vec2 pixel, daxa_u32 frame,
+                          daxa_u32 dimension) {
+  daxa_u32 set = dimension / SAMPLER_SOBOL_DIMENSIONS;
+#if SAMPLER_TYPE == SAMPLER_TYPE_SOBOL
+  daxa_u32 pixel_seed =
+      sampler_pcg4d(daxa_u32vec4(pixel, set, SAMPLER_PCG_SALT)).x;
+  return sampler_owen_sobol(frame, dimension, pixel_seed);
+#elif SAMPLER_TYPE == SAMPLER_TYPE_BLUE_NOISE
+  // Toroidal shift of the mask per dimension so dimensions don't share the rotation
+  daxa_u32vec2 offset =
+      sampler_pcg4d(daxa_u32vec4(dimension, SAMPLER_BLUE_NOISE_SALT, 0, 0)).xy;
+  daxa_u32 rank =
+      sampler_get_blue_noise_rank(pixel.x + offset.x, pixel.y + offset.y);
+  daxa_u32 bits = sampler_owen_sobol(
+      frame, dimension, sampler_hash_combine(SAMPLER_BLUE_NOISE_SALT, set));
+  // Cranley-Patterson rotation by the rank, in fixed point so it wraps exactly
+  return bits + (rank << (32U - 12U));
+#else
+  return sampler_pcg4d(
+             daxa_u32vec4(pixel, frame, dimension ^ SAMPLER_PCG_SALT))
+      .x;
+#endif // SAMPLER_TYPE
+}
+
+// A dimension of a pixel at a frame, SAMPLER_TYPE_LCG falls back to the counter based hash
+daxa_f32 sampler_get_1d(daxa_u32vec2 pixel, daxa_u32 frame,
+                        daxa_u32 dimension) {
+  return sampler_to_float(sampler_get_bits(pixel, frame, dimension));
+}
+
+daxa_u32 sampler_get_bounce_dimension(daxa_u32 depth, daxa_u32 offset) {
+  return SAMPLER_CAMERA_DIMENSIONS + depth * SAMPLER_BOUNCE_DIMENSIONS + offset;
+}
@@ -213,7 +213,11 @@ daxa_b32 hit_material(inout Ray ray, daxa_u32 hit_material_index, inout HIT_INFO
         // float turbulence = get_perlin_turbulence(PERLIN_FACTOR * VOXEL_EXTENT * abs(hit.obj_hit), 4, 2.0, 0.5, mat.texture_id, mat.sampler_id);  
         // out_color *= vec3(turbulence);
         vec3 s = PERLIN_FACTOR * VOXEL_EXTENT * abs(hit.obj_hit);
+#if BAKED_NOISE_ON == 1
+        float turbulence = get_baked_perlin_turbulence(s, mat.texture_id, mat.sampler_id);
+#else
         float turbulence = get_perlin_turbulence(s, 4, 2.0, 0.5, mat.texture_id, mat.sampler_id);
+#endif // BAKED_NOISE_ON
         out_color *= 0.5 * (1 + sin(s.z + 10 * turbulence));
     }
 
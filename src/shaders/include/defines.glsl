@@ -6,6 +6,8 @@
 #define DEBUG_NORMALS_ON 0
 #define ACCUMULATOR_ON 1
 #define FORCE_ACCUMULATOR_ON 0
+// ADAPTIVE_SAMPLING_ON (shared.inl) where the frames accumulate
+#define ADAPTIVE_SAMPLING_ACTIVE (ADAPTIVE_SAMPLING_ON == 1 && (ACCUMULATOR_ON == 1 && RESTIR_ON == 0 || FORCE_ACCUMULATOR_ON == 1))
 
 #define RESTIR_ON 1
 #define RESTIR_DI_ON 1
@@ -122,12 +124,23 @@ layout(location = 4) callableDataInEXT HIT_SCATTER_PAY_LOAD call_scatter;
 layout(location = 0) rayPayloadInEXT HIT_PAY_LOAD prd;
 #endif
 
+#if DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_INTERSECTION || DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_CLOSEST_HIT || DAXA_SHADER_STAGE == DAXA_SHADER_STAGE_ANY_HIT
+#if BRICK_PRIMITIVES_ON == 1
+// Voxel of the brick reported by the intersection shader, hit primitive ids are packed with it
+hitAttributeEXT daxa_u32 brick_voxel_bit;
+#define HIT_PRIMITIVE_ID ((daxa_u32(gl_PrimitiveID) << BRICK_VOXEL_BITS) | brick_voxel_bit)
+#else
+#define HIT_PRIMITIVE_ID gl_PrimitiveID
+#endif // BRICK_PRIMITIVES_ON
+#endif
+
 
 layout(buffer_reference, scalar) buffer INSTANCES_BUFFER {INSTANCE instances[]; }; // Positions of an object
 layout(buffer_reference, scalar) buffer REMAPPED_PRIMITIVE_BUFFER {daxa_u32 primitives[]; }; // Primitive data
 layout(buffer_reference, scalar) buffer PRIMITIVE_BUFFER {PRIMITIVE primitives[]; }; // Primitive data
 
 layout(buffer_reference, scalar) buffer AABB_BUFFER {AABB aabbs[]; }; // Positions of a primitive
+layout(buffer_reference, scalar) buffer BRICK_BUFFER {BRICK bricks[]; }; // Occupancy & voxels of brick primitives
 
 layout(buffer_reference, scalar) buffer MATERIAL_BUFFER {MATERIAL materials[]; }; // Materials
 
@@ -136,23 +149,33 @@ layout(buffer_reference, scalar) buffer ENV_LIGHT_BUFFER {LIGHT env_lights[]; };
 layout(buffer_reference, scalar) buffer CUBE_LIGHT_BUFFER {LIGHT cube_lights[]; }; // Cube lights
 layout(buffer_reference, scalar) buffer REMAPPED_CUBE_LIGHT_BUFFER {daxa_u32 lights[]; }; // Primitive data
 layout(buffer_reference, scalar) buffer LIGHT_CONFIG_BUFFER {LIGHT_CONFIG light_config; }; // Lights
+layout(buffer_reference, scalar) buffer LIGHT_TREE_BUFFER {LIGHT_TREE_NODE nodes[]; }; // Light tree of the cube lights
+layout(buffer_reference, scalar) buffer LIGHT_TREE_LEAF_BUFFER {daxa_u32 leaves[]; }; // Leaf node of every cube light
+layout(buffer_reference, scalar) buffer LIGHT_ALIAS_BUFFER {LIGHT_ALIAS entries[]; }; // Alias table of the cube lights
 
-layout(buffer_reference, scalar) buffer PREV_RESERVOIR_BUFFER {RESERVOIR reservoirs[]; }; // Reservoirs from the previous frame
-layout(buffer_reference, scalar) buffer INT_RESERVOIR_BUFFER {RESERVOIR reservoirs[]; }; // Intermediate reservoirs
-layout(buffer_reference, scalar) buffer RESERVOIR_BUFFER {RESERVOIR reservoirs[]; }; // Reservoirs from the current frame
+layout(buffer_reference, scalar) buffer PREV_RESERVOIR_BUFFER {RESERVOIR_STORAGE reservoirs[]; }; // Reservoirs from the previous frame
+layout(buffer_reference, scalar) buffer INT_RESERVOIR_BUFFER {RESERVOIR_STORAGE reservoirs[]; }; // Intermediate reservoirs
+layout(buffer_reference, scalar) buffer RESERVOIR_BUFFER {RESERVOIR_STORAGE reservoirs[]; }; // Reservoirs from the current frame
 layout(buffer_reference, scalar) buffer VELOCITY_BUFFER {VELOCITY velocities[]; }; // Velocities
-layout(buffer_reference, scalar) buffer PREV_DI_BUFFER {DIRECT_ILLUMINATION_INFO di_info[]; }; // Direct illumination info
-layout(buffer_reference, scalar) buffer DI_BUFFER {DIRECT_ILLUMINATION_INFO di_info[]; }; // Direct illumination info
+layout(buffer_reference, scalar) buffer PREV_DI_BUFFER {DIRECT_ILLUMINATION_INFO_STORAGE di_info[]; }; // Direct illumination info
+layout(buffer_reference, scalar) buffer DI_BUFFER {DIRECT_ILLUMINATION_INFO_STORAGE di_info[]; }; // Direct illumination info
 
 
 layout(buffer_reference, scalar) buffer INDIRECT_COLOR_BUFFER {daxa_f32vec3 colors[]; }; // Indirect color
+layout(buffer_reference, scalar) buffer ADAPTIVE_PIXEL_BUFFER {ADAPTIVE_PIXEL pixels[]; }; // Adaptive sampling statistics
+layout(buffer_reference, scalar) buffer ADAPTIVE_TILE_BUFFER {ADAPTIVE_TILE tiles[]; }; // Adaptive sampling tile errors
+layout(buffer_reference, scalar) buffer DENOISER_DIRECT_BUFFER {daxa_f32vec3 colors[]; }; // Direct light of the shading pass
+layout(buffer_reference, scalar) buffer DENOISER_HISTORY_BUFFER {DENOISER_HISTORY histories[]; }; // Denoiser history
+layout(buffer_reference, scalar) buffer DENOISER_SIGNAL_BUFFER {DENOISER_SIGNAL signals[]; }; // Denoiser a-trous signal
 
 
 layout(buffer_reference, scalar) buffer PIXEL_RECONNECTION_DATA_BUFFER {PIXEL_RECONNECTION_DATA reconnections[]; }; // Pixel reconnection data
-layout(buffer_reference, scalar) buffer OUTPUT_PATH_RESERVOIR_BUFFER {PATH_RESERVOIR path_reservoirs[]; }; // Path reservoirs
-layout(buffer_reference, scalar) buffer TEMPORAL_PATH_RESERVOIR_BUFFER {PATH_RESERVOIR path_reservoirs[]; }; // Path reservoirs
+layout(buffer_reference, scalar) buffer OUTPUT_PATH_RESERVOIR_BUFFER {PATH_RESERVOIR_STORAGE path_reservoirs[]; }; // Path reservoirs
+layout(buffer_reference, scalar) buffer TEMPORAL_PATH_RESERVOIR_BUFFER {PATH_RESERVOIR_STORAGE path_reservoirs[]; }; // Path reservoirs
 
 
 layout(buffer_reference, scalar) buffer BRUSH_COUNTER_BUFFER {BRUSH_COUNTER brush_counter; }; // Brush counter
 layout(buffer_reference, scalar) buffer INSTANCE_BITMASK_BUFFER {daxa_u32 instance_bitmask[]; }; // Instance bitmask
-layout(buffer_reference, scalar) buffer PRIMITIVE_BITMASK_BUFFER {daxa_u32 primitive_bitmask[]; }; // Primitive bitmask
\ No newline at end of file
+layout(buffer_reference, scalar) buffer PRIMITIVE_BITMASK_BUFFER {daxa_u32 primitive_bitmask[]; }; // Primitive bitmask
+layout(buffer_reference, scalar) buffer BRUSH_RANGE_OWNER_BUFFER {daxa_u32 range_owners[]; }; // Instance claiming each primitive range in a stroke
+layout(buffer_reference, scalar) buffer BRUSH_BOX_HIT_BUFFER {BRUSH_BOX_HIT box_hits[]; }; // Brush hits on merged boxes
\ No newline at end of file
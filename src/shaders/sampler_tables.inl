@@ -0,0 +1,293 @@
+#pragma once
+// Generated by sampler_tables (src/tools/sampler_tables.cpp), don't edit.
+// Sobol matrices of the first 4 dimensions (Joe & Kuo 2008), 32 columns each, and the ranks of a 64x64
+// void and cluster blue noise mask (sigma 1.5, seed 1), two 16 bit ranks per word.
+
+#if defined(GL_core_profile) // GLSL
+#define SAMPLER_TABLE(NAME, SIZE) const daxa_u32 NAME[SIZE] = daxa_u32[SIZE](
+#define SAMPLER_TABLE_END );
+#else
+#define SAMPLER_TABLE(NAME, SIZE) inline constexpr daxa_u32 NAME[SIZE] = {
+#define SAMPLER_TABLE_END };
+#endif // GL_core_profile
+
+SAMPLER_TABLE(sampler_sobol_matrices, 128)
+    0x80000000U, 0x40000000U, 0x20000000U, 0x10000000U, 0x08000000U, 0x04000000U, 0x02000000U, 0x01000000U,
+    0x00800000U, 0x00400000U, 0x00200000U, 0x00100000U, 0x00080000U, 0x00040000U, 0x00020000U, 0x00010000U,
+    0x00008000U, 0x00004000U, 0x00002000U, 0x00001000U, 0x00000800U, 0x00000400U, 0x00000200U, 0x00000100U,
+    0x00000080U, 0x00000040U, 0x00000020U, 0x00000010U, 0x00000008U, 0x00000004U, 0x00000002U, 0x00000001U,
+    0x80000000U, 0xc0000000U, 0xa0000000U, 0xf0000000U, 0x88000000U, 0xcc000000U, 0xaa000000U, 0xff000000U,
+    0x80800000U, 0xc0c00000U, 0xa0a00000U, 0xf0f00000U, 0x88880000U, 0xcccc0000U, 0xaaaa0000U, 0xffff0000U,
+    0x80008000U, 0xc000c000U, 0xa000a000U, 0xf000f000U, 0x88008800U, 0xcc00cc00U, 0xaa00aa00U, 0xff00ff00U,
+    0x80808080U, 0xc0c0c0c0U, 0xa0a0a0a0U, 0xf0f0f0f0U, 0x88888888U, 0xccccccccU, 0xaaaaaaaaU, 0xffffffffU,
+    0x80000000U, 0xc0000000U, 0x60000000U, 0x90000000U, 0xe8000000U, 0x5c000000U, 0x8e000000U, 0xc5000000U,
+    0x68800000U, 0x9cc00000U, 0xee600000U, 0x55900000U, 0x80680000U, 0xc09c0000U, 0x60ee0000U, 0x90550000U,
+    0xe8808000U, 0x5cc0c000U, 0x8e606000U, 0xc5909000U, 0x6868e800U, 0x9c9c5c00U, 0xeeee8e00U, 0x5555c500U,
+    0x8000e880U, 0xc0005cc0U, 0x60008e60U, 0x9000c590U, 0xe8006868U, 0x5c009c9cU, 0x8e00eeeeU, 0xc5005555U,
+    0x80000000U, 0xc0000000U, 0x20000000U, 0x50000000U, 0xf8000000U, 0x74000000U, 0xa2000000U, 0x93000000U,
+    0xd8800000U, 0x25400000U, 0x59e00000U, 0xe6d00000U, 0x78080000U, 0xb40c0000U, 0x82020000U, 0xc3050000U,
+    0x208f8000U, 0x51474000U, 0xfbea2000U, 0x75d93000U, 0xa0858800U, 0x914e5400U, 0xdbe79e00U, 0x25db6d00U,
+    0x58800080U, 0xe54000c0U, 0x79e00020U, 0xb6d00050U, 0x800800f8U, 0xc00c0074U, 0x200200a2U, 0x50050093U
+SAMPLER_TABLE_END
+
+SAMPLER_TABLE(sampler_blue_noise_ranks, 2048)
+    0x0ac301afU, 0x084a0006U, 0x0f3b05b9U, 0x09e10c8aU, 0x06310e0bU, 0x0efc0900U, 0x0b6105c3U, 0x0a65010dU,
+    0x0e22058dU, 0x0d0c0aaeU, 0x07d9022bU, 0x02d90fcfU, 0x017d0a58U, 0x0d160720U, 0x0654032aU, 0x09cb024aU,
+    0x05be0787U, 0x0886026cU, 0x0d0b0b23U, 0x05d4025eU, 0x0b1409adU, 0x044f068fU, 0x0ae40e2eU, 0x0c630eedU,
+    0x03ac00efU, 0x0a280e8fU, 0x0ee30310U, 0x096f0431U, 0x0a9d0763U, 0x0c8d08afU, 0x005c056eU, 0x0c2d0e4bU,
+    0x0fb108fcU, 0x034f0dc2U, 0x070a0a87U, 0x07e0040cU, 0x0c0c0251U, 0x008e0327U, 0x0759099fU, 0x087a0dbbU,
+    0x00470304U, 0x040a06c2U, 0x0bf709b4U, 0x064b045cU, 0x08150d60U, 0x00fe0f87U, 0x0c7308d8U, 0x042b0e02U,
+    0x0ec10bc3U, 0x0de30391U, 0x004c0712U, 0x0f4407ecU, 0x015a0d77U, 0x00080c45U, 0x037e085dU, 0x06c501a3U,
+    0x0b800d94U, 0x01c00940U, 0x07fa06a1U, 0x00da0bb6U, 0x02f80fe5U, 0x03c40ddbU, 0x07680b92U, 0x06090286U,
+    0x078203daU, 0x095704d2U, 0x0d6300ffU, 0x0b3b01c4U, 0x0f7504bfU, 0x0a8f06feU, 0x03ba0e9cU, 0x066e020cU,
+    0x0c5f0fafU, 0x0f2c08cfU, 0x070600fdU, 0x00460e45U, 0x04ef0b83U, 0x0acb0280U, 0x05070eb6U, 0x06cd00a4U,
+    0x081701aaU, 0x016c0a50U, 0x0c5604b7U, 0x03500a8eU, 0x074a04a8U, 0x0a350eb0U, 0x0d000639U, 0x04fc096dU,
+    0x02990812U, 0x0f9d055cU, 0x0a830c58U, 0x05c2023eU, 0x04df0ce6U, 0x01f10711U, 0x0f0f0994U, 0x0d71087bU,
+    0x0ca400b0U, 0x0ba0021aU, 0x05540f05U, 0x0e6408ecU, 0x08a10039U, 0x01de0d22U, 0x0ca70533U, 0x0b9e093fU,
+    0x0a1803f5U, 0x05e101f8U, 0x02b50c95U, 0x08ce0a31U, 0x0c8e0382U, 0x061e0988U, 0x07d20362U, 0x0f230a60U,
+    0x051c0c3aU, 0x06900d37U, 0x09030f67U, 0x00fb05f9U, 0x09170b82U, 0x052b0306U, 0x02840dfeU, 0x0f6b0b3aU,
+    0x0e1f0051U, 0x03bf0899U, 0x04970081U, 0x09ab0defU, 0x008b0859U, 0x0e690b09U, 0x015c05fcU, 0x0aee04e1U,
+    0x0a120713U, 0x065d0e7dU, 0x028d07f0U, 0x069f0bf1U, 0x05cf0a37U, 0x0b3403d1U, 0x00f20837U, 0x055a0e0cU,
+    0x075500baU, 0x047c0e33U, 0x0d9b082bU, 0x0f610576U, 0x06c801d1U, 0x00610e55U, 0x0d650b85U, 0x087c020dU,
+    0x097902e0U, 0x0b6a0069U, 0x01d40368U, 0x0d120e41U, 0x0f730662U, 0x07cb0197U, 0x01060bbaU, 0x0420074fU,
+    0x0bf30a0fU, 0x0d170610U, 0x0ef9090aU, 0x0393066fU, 0x0ece0bf9U, 0x041107c8U, 0x0d0f0a22U, 0x0f71033aU,
+    0x05b3027aU, 0x005b03b3U, 0x04690ab6U, 0x03510ffdU, 0x01360cb2U, 0x06440dc8U, 0x03320fc9U, 0x0a89071bU,
+    0x0beb0f02U, 0x093a02fbU, 0x01480b31U, 0x07c003eeU, 0x0d270a8cU, 0x07850424U, 0x05bb0ff6U, 0x0ceb043fU,
+    0x0fb3062cU, 0x0e000456U, 0x09f40840U, 0x07a9046eU, 0x0a4b0275U, 0x04490d8aU, 0x09260f11U, 0x0d5105efU,
+    0x0312015dU, 0x01dd0736U, 0x07b00b36U, 0x0a710119U, 0x055901d7U, 0x0c2f02ccU, 0x06db0020U, 0x09200bb8U,
+    0x0c160ebeU, 0x0e0f088bU, 0x092f0c9eU, 0x07b900d6U, 0x0eef0501U, 0x028e0909U, 0x0c7f09f6U, 0x017f049fU,
+    0x0603086fU, 0x00270d64U, 0x06a60fe1U, 0x0e960c2bU, 0x054900f0U, 0x024b08e5U, 0x01660a06U, 0x0b22091bU,
+    0x07a3010cU, 0x02850a98U, 0x0eca06e5U, 0x002b0af7U, 0x055f0c69U, 0x00760885U, 0x03280a8dU, 0x08080e7cU,
+    0x0fec051eU, 0x0e760a67U, 0x0307050eU, 0x0f8f0cc6U, 0x0d4d06dfU, 0x0fb60961U, 0x0e150880U, 0x01050556U,
+    0x0a770438U, 0x0738018cU, 0x025204f2U, 0x09e50d56U, 0x01bc0b1cU, 0x0bea0743U, 0x07e6000dU, 0x0b670e38U,
+    0x042d027eU, 0x07b309f8U, 0x0a6104abU, 0x0965021dU, 0x0af10345U, 0x0c6d0ef8U, 0x0de903ddU, 0x0ecc0700U,
+    0x0dc30363U, 0x0ccf0570U, 0x051100c0U, 0x0fd202f5U, 0x03a30929U, 0x06f70ce4U, 0x0c390599U, 0x0af901ffU,
+    0x092c0cd1U, 0x00c40402U, 0x09d10da6U, 0x08a005a0U, 0x0b1e0406U, 0x062400ebU, 0x01f40480U, 0x07c60aadU,
+    0x0db5065aU, 0x0f82034dU, 0x06b30b8bU, 0x05d70ea4U, 0x0c7a0300U, 0x05740421U, 0x03b00f36U, 0x09630613U,
+    0x0ccc0fa2U, 0x0eaf01cdU, 0x0cdf02b0U, 0x077f05acU, 0x06990df0U, 0x07f5009fU, 0x0aaf05ecU, 0x051f000aU,
+    0x09960c06U, 0x08e80153U, 0x0d660bc4U, 0x06650826U, 0x01b20b93U, 0x02bc0e31U, 0x08cd0facU, 0x008f0483U,
+    0x02260680U, 0x08620c13U, 0x024306cfU, 0x00450c35U, 0x029f0e05U, 0x0b9707a5U, 0x036f0d85U, 0x0c760f56U,
+    0x08da003cU, 0x09f20593U, 0x03bb007fU, 0x012408aaU, 0x080c0f93U, 0x0a7c0e29U, 0x01da0925U, 0x00d70d86U,
+    0x073e0543U, 0x065c0bf6U, 0x0e17091cU, 0x0b55006bU, 0x0ce5047eU, 0x0ba302b7U, 0x031b0f7cU, 0x08410d19U,
+    0x06aa0228U, 0x03ce0f97U, 0x09d90628U, 0x0dd30174U, 0x078e048cU, 0x0ae509bdU, 0x073b00e0U, 0x09e40dc4U,
+    0x07cd0f28U, 0x0ee9054dU, 0x04850b63U, 0x07e80eb9U, 0x04cc0a1dU, 0x01860f08U, 0x06fd0a0aU, 0x02c10939U,
+    0x0ce10ee8U, 0x07ca025cU, 0x0a9f0e65U, 0x04bc0ce3U, 0x062709baU, 0x02a700a2U, 0x07050cbaU, 0x08280b44U,
+    0x039d0a82U, 0x0b0f0087U, 0x03c0053bU, 0x0f940876U, 0x083d0190U, 0x04b409c1U, 0x072e01c1U, 0x0f070975U,
+    0x0a530467U, 0x07e10d90U, 0x0f4501f0U, 0x0aa7038eU, 0x0f1d009eU, 0x03de060cU, 0x052a0cbdU, 0x02700b4aU,
+    0x0d1303c7U, 0x02fe0022U, 0x01160977U, 0x032f0adaU, 0x0c1f065fU, 0x05b208bfU, 0x010a0cc5U, 0x0b26053eU,
+    0x0a4c06c4U, 0x0c0904a1U, 0x02c70600U, 0x0bbe0775U, 0x0db8023bU, 0x088a0b59U, 0x0eb803e1U, 0x02d004c1U,
+    0x0d4b0f10U, 0x0f7207d7U, 0x0c24015bU, 0x09e60678U, 0x0ec0036cU, 0x0dc90633U, 0x0c9a0a6cU, 0x0622015fU,
+    0x007b0ba6U, 0x0b2802fdU, 0x0c5d04d4U, 0x05b80761U, 0x08880cf7U, 0x0e9e0205U, 0x0144093eU, 0x08520e68U,
+    0x0ac405bdU, 0x0dd008e4U, 0x0f6a060fU, 0x0d480750U, 0x0e5f0142U, 0x03b40231U, 0x08000ff1U, 0x03fd0e2aU,
+    0x01db0842U, 0x01130fa6U, 0x0d610949U, 0x0ed800c3U, 0x07410403U, 0x0fd904fbU, 0x0072067aU, 0x08dd0c3dU,
+    0x0482019bU, 0x02eb0999U, 0x0e630a57U, 0x0d3a0262U, 0x0bf8055dU, 0x0891003bU, 0x05630366U, 0x03960e70U,
+    0x0cec089fU, 0x0e5b058fU, 0x003508e2U, 0x096a0ec4U, 0x0b1b0301U, 0x0bd104cfU, 0x032c07b1U, 0x0c26066bU,
+    0x0fc7017cU, 0x041c06c0U, 0x02350c83U, 0x09280519U, 0x0a3c042fU, 0x0b5e0730U, 0x02a50976U, 0x00bf0c4dU,
+    0x0db30b6bU, 0x03ed08c8U, 0x05250eabU, 0x0894068dU, 0x019c0ae8U, 0x01340d4aU, 0x0acd093bU, 0x0e6005e2U,
+    0x0c9f06ddU, 0x0dc705cbU, 0x048e06fbU, 0x00df0803U, 0x07780af2U, 0x0fbb0291U, 0x07d30c30U, 0x09ce00afU,
+    0x07490f5bU, 0x0a0001a4U, 0x029606baU, 0x04630b75U, 0x0ff70115U, 0x000e06f0U, 0x0a720dabU, 0x047b0f12U,
+    0x02c609c7U, 0x014a0b7eU, 0x09e0083eU, 0x00880bb4U, 0x05660f9cU, 0x00050d5eU, 0x06ac04c4U, 0x05ce0a2aU,
+    0x0531034eU, 0x0b1906e1U, 0x0a2c0282U, 0x03560c1cU, 0x09e80f62U, 0x0bf40810U, 0x0d8d034bU, 0x09e70246U,
+    0x0b8100b3U, 0x08c50202U, 0x0bc00011U, 0x094a0fedU, 0x0e8e03faU, 0x04980a2fU, 0x0b16019dU, 0x06730df1U,
+    0x04730233U, 0x0fc40bd3U, 0x0d7903d3U, 0x0e1b082dU, 0x0a0e05f4U, 0x03c50d35U, 0x022f05d0U, 0x007108a6U,
+    0x07aa0d7eU, 0x05400eadU, 0x03420d92U, 0x07e50e44U, 0x020e0c42U, 0x0ed90855U, 0x01b30cadU, 0x0d2b0f6eU,
+    0x0eff023fU, 0x0d0d0030U, 0x019507ebU, 0x00580dd6U, 0x05dc049cU, 0x06c30230U, 0x05390f2fU, 0x0414081aU,
+    0x07980f74U, 0x0f0c03b1U, 0x030a0a1cU, 0x0d8f059bU, 0x05fd01e5U, 0x07020cd3U, 0x05c8095aU, 0x0c7e041eU,
+    0x0da80ab2U, 0x00c80850U, 0x0ac70625U, 0x07280176U, 0x026f0c38U, 0x092e07e7U, 0x0b690f5fU, 0x0c790722U,
+    0x03b7059aU, 0x00b6094cU, 0x06f60ae1U, 0x05e501b1U, 0x0ad8038aU, 0x033b063eU, 0x07d109e3U, 0x08f60410U,
+    0x0bd8074cU, 0x05bc09c8U, 0x04c60fd1U, 0x096e0766U, 0x0b680e3bU, 0x04500d15U, 0x00260a13U, 0x0dbe0b50U,
+    0x0aa00590U, 0x04f60d1aU, 0x0cb00685U, 0x075a0132U, 0x08b70b9dU, 0x0343007eU, 0x0f3c0d88U, 0x08d402a8U,
+    0x0560001cU, 0x0978031aU, 0x04d00cd7U, 0x036d08ffU, 0x05120ef6U, 0x0ac60192U, 0x050000cbU, 0x0e580365U,
+    0x02080a52U, 0x061f0cdcU, 0x04710f89U, 0x0ed60a59U, 0x0d96094dU, 0x0bec00f7U, 0x0eaa054aU, 0x0abe009dU,
+    0x013e0e67U, 0x08890417U, 0x0b7802e9U, 0x062b0cc1U, 0x083102baU, 0x0ec300e4U, 0x0c6e0789U, 0x08d20305U,
+    0x02c0017eU, 0x00dc092dU, 0x07f30e0eU, 0x03940aa6U, 0x04e60debU, 0x0b350f98U, 0x0104080fU, 0x06d50a69U,
+    0x07d60e35U, 0x0b8f0ed1U, 0x0f2d01beU, 0x00480da3U, 0x0bb2098dU, 0x06680e8bU, 0x0bf50dc5U, 0x01100966U,
+    0x0f1e06a7U, 0x0b8a084eU, 0x07a20244U, 0x00540cbcU, 0x073504c5U, 0x08900fcdU, 0x0693021bU, 0x04f90c28U,
+    0x063f0846U, 0x0dec0c90U, 0x09f000a0U, 0x01b703dfU, 0x0ad00f9aU, 0x093603aeU, 0x057701feU, 0x06f50fe6U,
+    0x0e810c94U, 0x0be10725U, 0x043b024fU, 0x09910f32U, 0x06c10256U, 0x017b0a0cU, 0x0bfd0536U, 0x0cde03d8U,
+    0x0ae201e3U, 0x06ea0426U, 0x07e902ceU, 0x0aef05cdU, 0x03cb06d0U, 0x029e086dU, 0x07b7045bU, 0x02de0fd0U,
+    0x04c80b38U, 0x03e60032U, 0x0e51099aU, 0x08c2031eU, 0x02b80c0fU, 0x04350a42U, 0x0a070df9U, 0x02f00d6dU,
+    0x0f500b40U, 0x0a8a0229U, 0x0efa0683U, 0x0da008ebU, 0x0555073cU, 0x06760c82U, 0x0a430d80U, 0x00e903f6U,
+    0x05e609bfU, 0x0fad0384U, 0x0b5a086cU, 0x003e061aU, 0x0e770c07U, 0x0d5303a9U, 0x0f030659U, 0x050d09b0U,
+    0x06020fccU, 0x0c930147U, 0x04640a48U, 0x02380c0bU, 0x00f60f7dU, 0x0c570d78U, 0x01e709fcU, 0x08e105ebU,
+    0x07640d29U, 0x0c4b0df3U, 0x012f0589U, 0x06230ad2U, 0x01940efeU, 0x0b9406afU, 0x039b0042U, 0x01b4090eU,
+    0x098a045eU, 0x037f056bU, 0x016407b5U, 0x0bd6051dU, 0x0a19004eU, 0x0e870272U, 0x08490093U, 0x0e260be6U,
+    0x0b250493U, 0x0a3b005fU, 0x01450571U, 0x08bb0d4cU, 0x07c504b6U, 0x095301a7U, 0x027f0788U, 0x087200d0U,
+    0x09900302U, 0x08580de0U, 0x00ca0f96U, 0x08a90d41U, 0x0aa404a2U, 0x077005b6U, 0x0e100028U, 0x03ef0c0eU,
+    0x0a240175U, 0x089e02b3U, 0x07480fefU, 0x03f10db1U, 0x0d3b0845U, 0x0e9204f8U, 0x05a8079dU, 0x07340fb2U,
+    0x001e0dccU, 0x0eb50c05U, 0x0d240afcU, 0x083b02d3U, 0x0f25040bU, 0x04ca0898U, 0x02fa0ad6U, 0x07c90630U,
+    0x0ef10259U, 0x0ccd075eU, 0x0e720408U, 0x03140701U, 0x0ace0f70U, 0x04700cefU, 0x0a550e59U, 0x0c3b0daaU,
+    0x0b58075bU, 0x04f30044U, 0x09870651U, 0x07420360U, 0x09350e3cU, 0x0f5a02f2U, 0x0a8404e5U, 0x0e73080dU,
+    0x0f290561U, 0x00dd068cU, 0x04d30a4fU, 0x0ba40239U, 0x0aa5007aU, 0x08f00317U, 0x0b0a0cc0U, 0x0c5e011fU,
+    0x08b8032dU, 0x013706ccU, 0x05e4090cU, 0x0a540ff5U, 0x0ca8063dU, 0x06e3018bU, 0x0f540c19U, 0x0d6a0135U,
+    0x0c120948U, 0x08ae019aU, 0x096702a3U, 0x0a2b0c29U, 0x060800b4U, 0x0bd202acU, 0x0588002eU, 0x066d0385U,
+    0x0f0a0201U, 0x0ced03beU, 0x0b620264U, 0x01b80dd4U, 0x012a063cU, 0x0d050b2cU, 0x0684024cU, 0x0089032bU,
+    0x0bd90918U, 0x0b5d045dU, 0x0c860346U, 0x0f3708d0U, 0x074d05c0U, 0x00db0fa0U, 0x04900276U, 0x065509b6U,
+    0x0f860ab1U, 0x0dfc04e4U, 0x02190419U, 0x00c70c4aU, 0x03150e21U, 0x0dff09b2U, 0x091903e2U, 0x0a90056cU,
+    0x05210359U, 0x0d750696U, 0x05ea0f52U, 0x050901c3U, 0x08fe0db0U, 0x0fdc074bU, 0x0b2f0882U, 0x09410eb7U,
+    0x05640d30U, 0x070c09caU, 0x08090eddU, 0x0adb043eU, 0x0c970fc5U, 0x0836042eU, 0x0ecf098cU, 0x0ce70affU,
+    0x01e90719U, 0x081b0d5cU, 0x06520ee7U, 0x09ec0184U, 0x0c250442U, 0x066a097cU, 0x08560e3aU, 0x01eb0ee6U,
+    0x0c7207edU, 0x07760295U, 0x09cd0b8cU, 0x04e006ebU, 0x0b7107c3U, 0x000b05c1U, 0x023407bcU, 0x07160e6dU,
+    0x0fc3007dU, 0x046b0aeaU, 0x0b7c0016U, 0x0efd082fU, 0x0b0b03ebU, 0x04e90149U, 0x06cb02e7U, 0x04a301a2U,
+    0x082a00d5U, 0x01850afbU, 0x00700c4cU, 0x08e90592U, 0x079f0309U, 0x00b105aaU, 0x01ab0d9cU, 0x040e05baU,
+    0x09f70fc2U, 0x05c702daU, 0x0da20010U, 0x0cf507daU, 0x013a02adU, 0x050b0d5fU, 0x03ab0bbcU, 0x057e0cf9U,
+    0x00fc0405U, 0x0cf608f3U, 0x0e830062U, 0x0f210347U, 0x01e10908U, 0x0aa80d81U, 0x0c490fa5U, 0x0b6c043aU,
+    0x08df0d3cU, 0x07bb0210U, 0x03730a1eU, 0x06ee0cfbU, 0x0c53021fU, 0x09830e9fU, 0x0c980e01U, 0x0f4a09e9U,
+    0x02d40bc7U, 0x06160ff9U, 0x0a470395U, 0x0c210e74U, 0x0a170103U, 0x0b740eeaU, 0x075d03c1U, 0x08770c6cU,
+    0x050400cfU, 0x0af60e89U, 0x03790980U, 0x0b1d051aU, 0x08a80ebaU, 0x0aaa0361U, 0x07520196U, 0x0b5b0064U,
+    0x0a410dadU, 0x061c0ed5U, 0x083f0479U, 0x011e0b1fU, 0x04880cdbU, 0x0333072aU, 0x09e20541U, 0x08480100U,
+    0x03c805feU, 0x0ec90ca9U, 0x0df8066cU, 0x0aa30127U, 0x07f6059cU, 0x06190397U, 0x07c700f1U, 0x05f203cdU,
+    0x0dfb0772U, 0x09140474U, 0x07790db4U, 0x06940240U, 0x0ded0476U, 0x06880267U, 0x0f270931U, 0x0a2d02c4U,
+    0x06f20dddU, 0x01bf089cU, 0x0fb70c15U, 0x00bc0762U, 0x06b7047fU, 0x08060f69U, 0x0a010dbfU, 0x068b0fe4U,
+    0x052301d9U, 0x0afd02f7U, 0x0dcf0200U, 0x09a40585U, 0x0bc802c5U, 0x08ee0ef5U, 0x06e701a0U, 0x02ef0dd5U,
+    0x016f0e8dU, 0x053509a8U, 0x0883028aU, 0x09320487U, 0x003d0f4bU, 0x0a360d21U, 0x02490bdfU, 0x0acf0db9U,
+    0x09920001U, 0x0cc801fbU, 0x04d800edU, 0x09380f7aU, 0x08190d09U, 0x0cab0515U, 0x0ad4001aU, 0x014b0557U,
+    0x03440ba9U, 0x04620c8cU, 0x026606b0U, 0x0ddc0930U, 0x0c010a34U, 0x05ca0029U, 0x04dc024eU, 0x093d0322U,
+    0x08710c0dU, 0x0fc00723U, 0x06be0905U, 0x0f6603c3U, 0x061407a4U, 0x0e2f006dU, 0x0ca50b11U, 0x095e04a4U,
+    0x07210af0U, 0x00c50bfeU, 0x0ffb0b15U, 0x03410c66U, 0x028c0b4bU, 0x044e08c3U, 0x05720fb9U, 0x033c08acU,
+    0x054b0c85U, 0x06bf0b29U, 0x0ba10853U, 0x004b0a79U, 0x0b45035bU, 0x0fea0172U, 0x04130884U, 0x081c0d72U,
+    0x0f8b061bU, 0x0e20005dU, 0x05d50ab4U, 0x019f0c99U, 0x02be056dU, 0x0e490986U, 0x0cd40b6dU, 0x0e7f07b8U,
+    0x0df40439U, 0x0c430012U, 0x0d18016bU, 0x00be0b65U, 0x0a260db2U, 0x080a0401U, 0x025705c9U, 0x002f0fbdU,
+    0x0f4d0562U, 0x0da70448U, 0x05f807aeU, 0x0733008dU, 0x06720d62U, 0x07670e25U, 0x0b5100a5U, 0x016d0e52U,
+    0x0eb10727U, 0x0f4103b2U, 0x0dd102aeU, 0x05f1040fU, 0x06de0ed7U, 0x03260a38U, 0x06600be2U, 0x02120e93U,
+    0x04cb0afeU, 0x078408eaU, 0x0f060173U, 0x084c0339U, 0x0d070ea6U, 0x04360726U, 0x017108b9U, 0x00d30629U,
+    0x05b40b87U, 0x038c0a74U, 0x09de0518U, 0x08a3029bU, 0x023204e8U, 0x0d500b7dU, 0x0a450357U, 0x0c1a0704U,
+    0x01ea0832U, 0x0319090bU, 0x023c0a32U, 0x09eb0e5aU, 0x01a60530U, 0x03030abdU, 0x06970985U, 0x0a1f03fbU,
+    0x088c0d3fU, 0x09d40086U, 0x0121062fU, 0x0be5078dU, 0x08bc0222U, 0x056a0e47U, 0x00f907b6U, 0x03aa097eU,
+    0x09da0d31U, 0x0d95029aU, 0x04e30a10U, 0x06e40b7fU, 0x0ad703c6U, 0x0f9500f4U, 0x0ae902ffU, 0x09ae0f14U,
+    0x07a00242U, 0x069a0f2eU, 0x07c10dc6U, 0x06420ea5U, 0x0fe90c5aU, 0x012506d1U, 0x09160f09U, 0x0e1c0180U,
+    0x0d1b0377U, 0x0eee06a3U, 0x0bad04b5U, 0x03d9085bU, 0x0bd70f6cU, 0x0ec604aeU, 0x02150cd5U, 0x04ce0f13U,
+    0x02710604U, 0x04780c10U, 0x08e00cc2U, 0x09af0fa3U, 0x04960d4fU, 0x0d0e007cU, 0x0f5e0298U, 0x07030c62U,
+    0x0f400163U, 0x03f8062dU, 0x00840c75U, 0x0ffa095cU, 0x08fd0193U, 0x0c6f065bU, 0x051607d5U, 0x03760d74U,
+    0x00fa0c92U, 0x026a0952U, 0x00780bd4U, 0x0ab003bdU, 0x094f0165U, 0x08750489U, 0x0bde0546U, 0x06200418U,
+    0x09a30b01U, 0x0c4e0079U, 0x05a4016eU, 0x01080d28U, 0x0799091eU, 0x05c40060U, 0x0b990867U, 0x00f80796U,
+    0x0fda0ae3U, 0x0a960780U, 0x03130e1dU, 0x01560524U, 0x069803a0U, 0x0b520a02U, 0x046508d3U, 0x057b0a70U,
+    0x0bcc0860U, 0x072d00e2U, 0x0e430870U, 0x05f30278U, 0x04990bfaU, 0x022c0ddeU, 0x008309d6U, 0x08f706f3U,
+    0x0e5d054fU, 0x04920b18U, 0x0fa408adU, 0x0d540578U, 0x03200758U, 0x0ad30d06U, 0x0d730056U, 0x0ee407dcU,
+    0x05200260U, 0x07f10e11U, 0x0f9b0a92U, 0x026d0707U, 0x03870c4fU, 0x0a880d8bU, 0x03780160U, 0x08c40d93U,
+    0x03d40caeU, 0x056900d4U, 0x071801ecU, 0x0c6a0a46U, 0x07de0e8aU, 0x01400fb5U, 0x0d7f0605U, 0x02e60031U,
+    0x04440e4cU, 0x0ef30addU, 0x05730318U, 0x07ef0a85U, 0x00410d38U, 0x05a60a49U, 0x0c0a0ee0U, 0x0fd4045aU,
+    0x033807ddU, 0x0cff0656U, 0x071d01c6U, 0x00e809a0U, 0x0b840eebU, 0x0e4a01f5U, 0x02d6070dU, 0x00d90a7bU,
+    0x0bcf08beU, 0x064a03caU, 0x095102d2U, 0x0a6f0427U, 0x06320e6fU, 0x0efb097fU, 0x05480708U, 0x02d50f76U,
+    0x09840681U, 0x08540e78U, 0x0f240b7bU, 0x084d0017U, 0x01f90580U, 0x03360bfbU, 0x0f170771U, 0x09370b3fU,
+    0x07ad0cb5U, 0x0989021eU, 0x0bdc0d14U, 0x0f3a01aeU, 0x071402edU, 0x03a60e7eU, 0x02bd0896U, 0x014d0a81U,
+    0x09c30b9cU, 0x0e0a0043U, 0x030b0a95U, 0x04ad0c91U, 0x061d082eU, 0x09aa0416U, 0x0fbc058eU, 0x0cf004b2U,
+    0x0f63072fU, 0x0b5401b5U, 0x00090ea7U, 0x05580d9dU, 0x00de07ffU, 0x045402b1U, 0x0b2a0c88U, 0x00a609dcU,
+    0x0bce04ebU, 0x0cfe022dU, 0x04300621U, 0x0b080d3dU, 0x09a20369U, 0x04dd0d45U, 0x01d2089aU, 0x05d803f4U,
+    0x0f9900d2U, 0x04a5067bU, 0x06f10000U, 0x09bb042aU, 0x08e3053aU, 0x01610bbbU, 0x0d2e077dU, 0x0da905edU,
+    0x0ebf0250U, 0x03b8076eU, 0x0ec805afU, 0x022a0b3eU, 0x0a5b0dbaU, 0x014f0f42U, 0x0c220866U, 0x094301caU,
+    0x0583032eU, 0x08a50d67U, 0x07a804d6U, 0x01df0babU, 0x0b560fbeU, 0x08970cf3U, 0x02680040U, 0x0d33077cU,
+    0x07320eb2U, 0x0a03039aU, 0x094b0122U, 0x06bd025dU, 0x01020e36U, 0x0adc067dU, 0x0a1b0e09U, 0x07310cfaU,
+    0x03830befU, 0x0ea80a16U, 0x0d9f08c0U, 0x0e370ae7U, 0x0caa00b7U, 0x0ac80437U, 0x00570f20U, 0x0415095bU,
+    0x04ee08caU, 0x0a270c51U, 0x00cd0869U, 0x092206a8U, 0x006c0399U, 0x0cd00786U, 0x0a4e034cU, 0x0ec70606U,
+    0x009a0aa1U, 0x0a0b06d6U, 0x0cb9014cU, 0x03350663U, 0x04cd09b8U, 0x0f5506adU, 0x0e5405d1U, 0x0906046aU,
+    0x0b0e01a9U, 0x05270f64U, 0x07af0e13U, 0x04d10ff4U, 0x08f90bdaU, 0x02a00f78U, 0x0494005eU, 0x02880e99U,
+    0x0d8e0887U, 0x0b90013cU, 0x01620551U, 0x07940316U, 0x0f85060bU, 0x067e0263U, 0x0c7804deU, 0x0f6f0710U,
+    0x06b20123U, 0x0fff01acU, 0x0d39029cU, 0x0f830517U, 0x05d30c59U, 0x04950b5fU, 0x001b0e7bU, 0x040007dfU,
+    0x0c270de4U, 0x0fdf02b9U, 0x0ab503f3U, 0x08db0f0dU, 0x01510d52U, 0x035c0ad5U, 0x0c46097aU, 0x02ea0a97U,
+    0x087905a7U, 0x06c7003aU, 0x03310c04U, 0x00750a3dU, 0x040407e2U, 0x0c4405a1U, 0x06570822U, 0x0118097dU,
+    0x04550abaU, 0x02ca0645U, 0x0fab0820U, 0x09640cc7U, 0x0a7d0198U, 0x0da10814U, 0x020709d5U, 0x0af30358U,
+    0x0e2b0ceeU, 0x04570960U, 0x07ab0bacU, 0x01b90ab7U, 0x0dfd0824U, 0x0995028bU, 0x0d5a0671U, 0x02540b1aU,
+    0x09040745U, 0x0d40049bU, 0x022e076cU, 0x00990595U, 0x079c041bU, 0x02090df6U, 0x013307ccU, 0x0fdd069eU,
+    0x0d7b0bb5U, 0x0ad1035eU, 0x0d9e0206U, 0x0cb6060aU, 0x01dc0ed3U, 0x0daf09d0U, 0x0f38039fU, 0x05140baaU,
+    0x077a0fd5U, 0x0c680e42U, 0x06a40a5cU, 0x0bc50407U, 0x0e180506U, 0x00ac0398U, 0x07bf0bcdU, 0x05db0de5U,
+    0x0386083cU, 0x05e00b06U, 0x0e9b0004U, 0x04750325U, 0x011b0a04U, 0x0fe30747U, 0x08f8017aU, 0x0f8404f1U,
+    0x05a2012dU, 0x00550b95U, 0x0e6a099cU, 0x0b33081eU, 0x0a230ebdU, 0x0b86057aU, 0x03d00ef0U, 0x00cc0ce8U,
+    0x044607a6U, 0x0f3509bcU, 0x04ba08e6U, 0x08a70152U, 0x0b8d035aU, 0x00c206edU, 0x01ee0aacU, 0x03080717U,
+    0x00a30c1dU, 0x01fa0998U, 0x00ce04d9U, 0x02730ea1U, 0x0c6b06f4U, 0x059408c9U, 0x04400fdbU, 0x006709a9U,
+    0x0203053cU, 0x07690edeU, 0x09330d5dU, 0x0bcb06d9U, 0x055b0f1aU, 0x03ff0b05U, 0x033d0c89U, 0x08440bbfU,
+    0x0a4d0ce9U, 0x06640f1cU, 0x0ce20372U, 0x0c3f04aaU, 0x069b02c3U, 0x0d320021U, 0x08a404bdU, 0x055309f1U,
+    0x0e950237U, 0x00bb062aU, 0x0b760737U, 0x06a90e50U, 0x05030a6eU, 0x08680e32U, 0x0cda057fU, 0x0e1208fbU,
+    0x08a205c5U, 0x0f1903e7U, 0x09210cf4U, 0x08050b20U, 0x0f510052U, 0x0a5e02c2U, 0x01cf06a0U, 0x0c1e0e90U,
+    0x0caf0a3aU, 0x031108b4U, 0x050c018dU, 0x00c60cbeU, 0x02f408c1U, 0x085f0db7U, 0x0eda05f0U, 0x06870080U,
+    0x02e5041aU, 0x08b001bbU, 0x00e70b07U, 0x017006f8U, 0x0fc60956U, 0x09b3038fU, 0x026906e2U, 0x0aeb0e3eU,
+    0x08610d42U, 0x02dd0bfcU, 0x03cc0d2aU, 0x029009a7U, 0x01120f49U, 0x026e0c32U, 0x041d0ec2U, 0x0a6b004aU,
+    0x0d8901d0U, 0x06010b72U, 0x02fc076dU, 0x0d970579U, 0x04a709c6U, 0x013f0b53U, 0x089b0cb8U, 0x070f02d8U,
+    0x00aa0faeU, 0x0b9f0649U, 0x0a910f8aU, 0x0e860277U, 0x0c230670U, 0x0a080036U, 0x07830220U, 0x0d6c0a9bU,
+    0x0ea90971U, 0x0dc00754U, 0x0f6d0513U, 0x0e270a40U, 0x0847043dU, 0x01810b2eU, 0x0c400f4cU, 0x0666006aU,
+    0x016803c2U, 0x04fa0a76U, 0x0f920818U, 0x05a50003U, 0x07910d0aU, 0x095503adU, 0x0b4e065eU, 0x0f7e07c4U,
+    0x072b0484U, 0x001d02d1U, 0x0ff20aabU, 0x0c3e0129U, 0x06770349U, 0x079b0de7U, 0x05280ef4U, 0x03e30b70U,
+    0x048107fdU, 0x09970e0dU, 0x07f203f0U, 0x09df05deU, 0x07b40425U, 0x04bb0f34U, 0x0e280b9bU, 0x056702abU,
+    0x0ba50107U, 0x0c54044aU, 0x06150292U, 0x020b08cbU, 0x05b50d6fU, 0x07950cb1U, 0x03520537U, 0x095907feU,
+    0x0ca30fa9U, 0x0ec505ffU, 0x0a3e01e6U, 0x0be006e6U, 0x04ac08faU, 0x0fe20b00U, 0x0d1d0146U, 0x061102bfU,
+    0x09ea0c2aU, 0x081f0ecdU, 0x04120dceU, 0x072908c7U, 0x01b00eb3U, 0x03f2092bU, 0x09b70024U, 0x01550dd9U,
+    0x0aed0d76U, 0x05960221U, 0x0cfd0063U, 0x01310e24U, 0x02450b46U, 0x06d40cc3U, 0x08f50126U, 0x0f3f03f7U,
+    0x063a0834U, 0x00190a9eU, 0x0d1e0813U, 0x0bc603a7U, 0x00f30740U, 0x0e0302b4U, 0x0bb90a30U, 0x04b10e8cU,
+    0x079302a4U, 0x08ed010fU, 0x046f0c7dU, 0x01590df5U, 0x0d7d02cfU, 0x06ff0077U, 0x04f00a20U, 0x09230e4eU,
+    0x03a100a8U, 0x01a80cc4U, 0x09dd0505U, 0x0bc90241U, 0x0aca0522U, 0x05e90ceaU, 0x026b0c3cU, 0x091d0669U,
+    0x06d702e4U, 0x0f4e0c37U, 0x0b120746U, 0x08ba0371U, 0x05450fceU, 0x03750954U, 0x05cc0d55U, 0x09c20c5cU,
+    0x0ddf020fU, 0x0fe8033eU, 0x017909eeU, 0x05020ef2U, 0x0f430a9cU, 0x04660944U, 0x05fb009bU, 0x0b2401d3U,
+    0x0de809dbU, 0x0abb03eaU, 0x030c0679U, 0x0b2707a7U, 0x08290f01U, 0x0c470586U, 0x087d0389U, 0x0afa01cbU,
+    0x05870f16U, 0x06bb08d9U, 0x0d340b4cU, 0x0f68060dU, 0x08330066U, 0x0fca02dcU, 0x0a5d0765U, 0x04f40f3dU,
+    0x01390a0dU, 0x0355088dU, 0x01bd0968U, 0x06c904edU, 0x00730c65U, 0x0a780ea3U, 0x0fb807ceU, 0x070e0065U,
+    0x04f50bcaU, 0x071e092aU, 0x0b42049eU, 0x006f06b5U, 0x03540874U, 0x06ef0c00U, 0x08b60ff3U, 0x06bc0d9aU,
+    0x05ab002aU, 0x0e790be8U, 0x0fd70082U, 0x054e0958U, 0x0a1103dcU, 0x027b0e88U, 0x0b7a0e08U, 0x040d064dU,
+    0x0255078cU, 0x0e9a0be7U, 0x00a7031dU, 0x03e007eeU, 0x0e560a14U, 0x010b04e2U, 0x037d0b43U, 0x0ca00098U,
+    0x0e8205d2U, 0x052e0d36U, 0x0edb0b91U, 0x0a800da5U, 0x080702b2U, 0x01670637U, 0x04b002a6U, 0x03700b03U,
+    0x00f50ee2U, 0x01c90d08U, 0x031c0e84U, 0x0c700910U, 0x05f50e5cU, 0x09ef018eU, 0x02f90ca2U, 0x0c5b042cU,
+    0x08110f79U, 0x04fd0247U, 0x0cd90881U, 0x0c360227U, 0x069c00aeU, 0x09270191U, 0x0025074eU, 0x0d2c0fa1U,
+    0x0dee09d8U, 0x049100e6U, 0x0f1b096cU, 0x0d6e0ae0U, 0x06ae0213U, 0x0d99098eU, 0x048a08b2U, 0x08300e14U,
+    0x04320b64U, 0x07ba0015U, 0x06480283U, 0x087e009cU, 0x0d20043cU, 0x0e300af8U, 0x086e0c1bU, 0x06580dfaU,
+    0x080e0a2eU, 0x0a6405c6U, 0x058a0be4U, 0x024d0dc1U, 0x07cf0447U, 0x052d0d57U, 0x07fb021cU, 0x01410a7fU,
+    0x0374090dU, 0x09fd0da4U, 0x05fa0188U, 0x07600a6dU, 0x0d250f48U, 0x044b0adfU, 0x05650cf1U, 0x0143083aU,
+    0x060e030fU, 0x0ac0084fU, 0x01d80692U, 0x073a04c3U, 0x036e0bbdU, 0x01a50c87U, 0x0bf20618U, 0x01c8071cU,
+    0x091a0f33U, 0x0ff00a94U, 0x09cc0c8fU, 0x0bdd0348U, 0x019e0f88U, 0x03880534U, 0x09b106c6U, 0x02790150U,
+    0x03e50c50U, 0x029d0f58U, 0x00a1086aU, 0x09f30753U, 0x0f800b77U, 0x0b040002U, 0x06670f00U, 0x04af0e6bU,
+    0x063b0bb1U, 0x071a0af4U, 0x03a80edfU, 0x049a0de2U, 0x084b02eeU, 0x0ecb05daU, 0x0a4a0323U, 0x04c20c2eU,
+    0x0cca0b49U, 0x03a40fdeU, 0x0c800e53U, 0x012b08e7U, 0x057d0f30U, 0x0f7f0816U, 0x0e9802afU, 0x034a0a7eU,
+    0x0253068eU, 0x01890597U, 0x07440422U, 0x056f0e48U, 0x09fe06ecU, 0x0f2a08f4U, 0x0d840007U, 0x0ebc059fU,
+    0x004f090fU, 0x0dda06faU, 0x0ca6047dU, 0x01a10f0eU, 0x06460334U, 0x03f90895U, 0x00ec0981U, 0x076f0cbfU,
+    0x0f47020aU, 0x02e200a9U, 0x07f70ba7U, 0x0b6f001fU, 0x01e2099eU, 0x00d10c14U, 0x01fd0962U, 0x06ce0e91U,
+    0x01f2091fU, 0x0034054cU, 0x02b607d0U, 0x0dd805e7U, 0x000c09faU, 0x04410af5U, 0x008509acU, 0x0d69052fU,
+    0x07f40bc2U, 0x0b390e62U, 0x0d230942U, 0x0abc01edU, 0x0e0700c9U, 0x07a1027cU, 0x041f0b48U, 0x078b0a7aU,
+    0x0cd804e7U, 0x09730b37U, 0x067f0169U, 0x05420adeU, 0x0c740970U, 0x025b0e2dU, 0x05840c03U, 0x0a09033fU,
+    0x055e0d70U, 0x0d040950U, 0x09150486U, 0x06380f91U, 0x052c0d7aU, 0x07be0feeU, 0x0d8c0674U, 0x009703d2U,
+    0x079e0f18U, 0x0bed09ffU, 0x095f0d83U, 0x04330b41U, 0x032407acU, 0x06610d4eU, 0x07740c52U, 0x013808dcU,
+    0x0ccb046cU, 0x06ab038bU, 0x04ff00d8U, 0x08b30ef7U, 0x0c7c03d7U, 0x0cf804b9U, 0x01ef064eU, 0x03370c33U,
+    0x01f60fd6U, 0x02e805d9U, 0x088f0f7bU, 0x0e6e0390U, 0x00e50777U, 0x070b04b8U, 0x08380db6U, 0x00370fa7U,
+    0x03fc0863U, 0x06890e66U, 0x0c6401adU, 0x077b028fU, 0x0b17011dU, 0x0a630392U, 0x0bb004c7U, 0x0b210801U,
+    0x0dbc0443U, 0x067c02e3U, 0x01010409U, 0x01e80f8eU, 0x0edc0c41U, 0x017808d5U, 0x03a50e5eU, 0x0a050fc1U,
+    0x00490e06U, 0x0f8c08bdU, 0x07c20c02U, 0x0b9a030eU, 0x08230635U, 0x00e30a9aU, 0x089d0f81U, 0x00b20e19U,
+    0x082109d7U, 0x0a680dacU, 0x0be904f7U, 0x0d020050U, 0x0fb002a1U, 0x09fb0b6eU, 0x04290157U, 0x06ca0ab8U,
+    0x025f0c60U, 0x07d80a25U, 0x05500eecU, 0x03fe0a6aU, 0x087f0e80U, 0x0cd60258U, 0x0f460033U, 0x09c40236U,
+    0x0c1105a9U, 0x0ae60187U, 0x07730e6cU, 0x09b5057cU, 0x04d706a2U, 0x0a75027dU, 0x0b57058cU, 0x063402a2U,
+    0x0ab9076bU, 0x058102cbU, 0x0a510204U, 0x002d0dcdU, 0x02140fd3U, 0x03670e2cU, 0x050f098fU, 0x044c0715U,
+    0x06530be3U, 0x012c03afU, 0x07920e61U, 0x05e809cfU, 0x08430abfU, 0x0607035fU, 0x0bd00ee1U, 0x05ad01e4U,
+    0x0b320e1eU, 0x037a0091U, 0x00ea0b0dU, 0x09460dcbU, 0x05750c48U, 0x0df206d2U, 0x064308f2U, 0x0e85035dU,
+    0x075f00e1U, 0x05100fb4U, 0x0c7b086bU, 0x0d680364U, 0x0b98008cU, 0x0d910751U, 0x07fc005aU, 0x01e00cbbU,
+    0x0c340508U, 0x09be0e9dU, 0x04450ce0U, 0x098206d3U, 0x0a210538U, 0x05bf0739U, 0x02890c61U, 0x0d440aa2U,
+    0x0f2201c7U, 0x0cac08ccU, 0x02110691U, 0x0df70428U, 0x050a01baU, 0x008a0c96U, 0x075708c6U, 0x03300d1cU,
+    0x04ec08efU, 0x05ee0fe7U, 0x085a0ca1U, 0x02ec0682U, 0x0f1f0068U, 0x016a0a15U, 0x0c71045fU, 0x085c0aa9U,
+    0x095d0cf2U, 0x0a4403a2U, 0x023a00abU, 0x0a930ed0U, 0x0ffe088eU, 0x098b03b9U, 0x049d0f04U, 0x0f53094eU,
+    0x03b50857U, 0x00960686U, 0x0f590790U, 0x0c31014eU, 0x0d1003ecU, 0x0b020177U, 0x00740e75U, 0x080b0f5cU,
+    0x0b0c0544U, 0x04b3002cU, 0x0ff80ac2U, 0x09070c77U, 0x0f0b0724U, 0x0dea096bU, 0x04da02a9U, 0x0ea209c0U,
+    0x07b20154U, 0x099b0d2fU, 0x044d0274U, 0x0b2b0f57U, 0x07f804dbU, 0x0b9603bcU, 0x078a0fbfU, 0x04a6012eU,
+    0x02970617U, 0x06da0dd7U, 0x09110bc1U, 0x046d064cU, 0x05b70158U, 0x01cc0d01U, 0x030d0647U, 0x00b80b13U,
+    0x01c509f5U, 0x09020d58U, 0x0ab30380U, 0x089305b0U, 0x0f3102c9U, 0x04600804U, 0x069508deU, 0x09a503e9U,
+    0x06e802f6U, 0x09720e34U, 0x07f902e1U, 0x036a0090U, 0x01200ba8U, 0x06b90423U, 0x0fba0accU, 0x06500053U,
+    0x03e80b8eU, 0x06dc01d6U, 0x0a560e97U, 0x073d01c2U, 0x0d7c0c08U, 0x08b50223U, 0x02c805d6U, 0x0b3c0d49U,
+    0x003f0f60U, 0x04590c2cU, 0x02f30f3eU, 0x07ea0e23U, 0x02db0c17U, 0x081d0ac5U, 0x0e4d0c67U, 0x0d8706d8U,
+    0x0f2b05e3U, 0x053f0b30U, 0x02810e1aU, 0x0ea00cfcU, 0x0b3d06e9U, 0x0d5900adU, 0x0b730248U, 0x013b0cddU,
+    0x0bb70ed2U, 0x0d5b0225U, 0x0b7905f7U, 0x0e3f051bU, 0x0a2905dfU, 0x018a0d46U, 0x08390c20U, 0x0c9d0458U,
+    0x0f4f0a3fU, 0x0bee0913U, 0x058b0014U, 0x09120cb4U, 0x061200eeU, 0x0a990ed4U, 0x0e3d0059U, 0x0381099dU,
+    0x0a33071fU, 0x0182082cU, 0x0aec05aeU, 0x0d1f006eU, 0x06b409a6U, 0x04680e71U, 0x08d7011aU, 0x0451025aU,
+    0x02df0c9bU, 0x0114075cU, 0x07db0bffU, 0x09f9004dU, 0x055201f3U, 0x06360974U, 0x04ea0febU, 0x0a86078fU,
+    0x0873059dU, 0x077e0453U, 0x0f150111U, 0x086409d2U, 0x0f9e0294U, 0x052607d4U, 0x0e46031fU, 0x072c023dU,
+    0x05a3010eU, 0x047202d7U, 0x08510d47U, 0x0f9f038dU, 0x09930477U, 0x0c550321U, 0x04d506f9U, 0x01b60865U,
+    0x04fe0daeU, 0x09b90eb4U, 0x07970cc9U, 0x056803cfU, 0x0f7701fcU, 0x0a1a0018U, 0x0b88059eU, 0x0a620fc8U,
+    0x08d10092U, 0x09ed048dU, 0x06750fe0U, 0x0baf04a9U, 0x0c81039eU, 0x03400e57U, 0x00130a39U, 0x037c0e40U,
+    0x00950d82U, 0x0a5f0fa8U, 0x03c90c8bU, 0x0cb301d5U, 0x000f06fcU, 0x09240bf0U, 0x0a5a068aU, 0x09470d2dU,
+    0x08020e7aU, 0x0ac90dd2U, 0x0e4f0756U, 0x069d0287U, 0x0e160ac1U, 0x0835013dU, 0x0f3903b6U, 0x06410cb7U,
+    0x011c0b89U, 0x06b60353U, 0x0faa0224U, 0x0de10a66U, 0x037b0878U, 0x07090bd5U, 0x03d50e04U, 0x079a0183U,
+    0x0bae0ee5U, 0x02180e39U, 0x094503dbU, 0x085e0dbdU, 0x073f0f8dU, 0x07e4015eU, 0x08d60c18U, 0x021706b8U,
+    0x0bdb0969U, 0x02f1062eU, 0x06b10901U, 0x04be0dcaU, 0x039c0b10U, 0x01f70de6U, 0x00c10f26U, 0x036b0591U,
+    0x0b6004c0U, 0x064001ceU, 0x09c50117U, 0x00940ba2U, 0x07810cd2U, 0x0d3e053dU, 0x00b90b66U, 0x029309d3U,
+    0x08ab0fcbU, 0x0b5c0d26U, 0x08f104a0U, 0x06a50109U, 0x04c90b4fU, 0x093c0d6bU, 0x082702bbU, 0x064f0d11U,
+    0x05470329U, 0x0d0306e0U, 0x01300b47U, 0x058202cdU, 0x0ad900b5U, 0x0d430452U, 0x048b0265U, 0x0c9c0f5dU,
+    0x07e30434U, 0x0eae018fU, 0x0b4d0529U, 0x08b100bdU, 0x05b10eacU, 0x048f09c9U, 0x08250bb3U, 0x0fd80b2dU,
+    0x0cce0038U, 0x0f90097bU, 0x053203d6U, 0x08920ebbU, 0x021603e4U, 0x09340ffcU, 0x05dd0261U, 0x046107bdU,
+    0x05980a73U, 0x0023076aU, 0x05f60d98U, 0x02aa0c84U, 0x01990e94U, 0x01280626U, 0x0a8b0f65U, 0x09a1047aU
+SAMPLER_TABLE_END
+
+#undef SAMPLER_TABLE
+#undef SAMPLER_TABLE_END
@@ -45,6 +45,66 @@
 #define VOXEL_EXTENT 0.03125f
 #define HALF_VOXEL_EXTENT VOXEL_EXTENT * 0.5f
 #define CHUNK_EXTENT VOXEL_EXTENT *VOXEL_COUNT_BY_AXIS
+// Greedy merge of same-material voxels into larger AABBs at load time
+#define MERGED_BOXES_ON 0
+// One AABB per 8^3 brick with an occupancy mask, the intersection shader walks the voxels (see BRICK)
+#define BRICK_PRIMITIVES_ON 0
+#define BRICK_VOXEL_BITS 9 // log2(CHUNK_VOXEL_COUNT)
+#define BRICK_OCCUPANCY_WORD_COUNT 16 // CHUNK_VOXEL_COUNT / 32
+#define MAX_BRICKS 65536U
+// Cube lights picked with a light tree (power & orientation bounds, cpu/light_tree.hpp) instead of uniformly
+#define LIGHT_TREE_ON 0
+#define MAX_LIGHT_TREE_NODES (2U * MAX_CUBE_LIGHTS)
+// Cube lights picked proportionally to their power with an alias table (cpu/light_alias_table.hpp), LIGHT_TREE_ON wins
+#define LIGHT_ALIAS_TABLE_ON 0
+// Random numbers of the shaders (sampler.glsl, cpu/sampler.hpp), every type but LCG is a function of (pixel, frame, dimension)
+#define SAMPLER_TYPE_LCG 0        // tea seeded LCG streams (random.glsl)
+#define SAMPLER_TYPE_PCG 1        // counter based pcg4d hash
+#define SAMPLER_TYPE_SOBOL 2      // Owen scrambled Sobol, scrambled per pixel
+#define SAMPLER_TYPE_BLUE_NOISE 3 // Owen scrambled Sobol shared by the pixels, rotated by a blue noise mask
+#define SAMPLER_TYPE SAMPLER_TYPE_LCG
+#define SAMPLER_SOBOL_DIMENSIONS 4 // dimensions of the Sobol tables, higher ones are padded with scrambled copies
+#define SAMPLER_BLUE_NOISE_SIZE 64 // side of the blue noise mask (sampler_tables.inl)
+// Dimensions of a path: the camera takes the first ones, then every bounce the same number
+#define SAMPLER_CAMERA_DIMENSIONS 4   // pixel jitter (2D) & lens
+#define SAMPLER_BOUNCE_DIMENSIONS 8
+#define SAMPLER_BOUNCE_BSDF 0         // direction (2D) & lobe
+#define SAMPLER_BOUNCE_BSDF_DIMENSIONS 3
+#define SAMPLER_BOUNCE_LIGHT 3        // light pick (& alias coin), face & point (2D)
+#define SAMPLER_BOUNCE_LIGHT_DIMENSIONS 5
+// Pixels stop sampling once the predicted relMSE of their tile is low enough (adaptive_sampling.glsl,
+// cpu/adaptive_sampling.hpp), accumulation mode only (ACCUMULATOR_ON without ReSTIR or FORCE_ACCUMULATOR_ON)
+#define ADAPTIVE_SAMPLING_ON 0
+#define ADAPTIVE_TILE_SIZE 8               // side of the tiles the error is estimated over
+#define ADAPTIVE_MIN_SAMPLES 16            // samples of every pixel before its tile may stop
+#define ADAPTIVE_ERROR_THRESHOLD 5e-4f     // predicted relMSE of a tile below which it stops
+#define ADAPTIVE_LUMINANCE_EPSILON 0.01f   // same role as the relMSE epsilon of image_metrics.hpp
+#define ADAPTIVE_ERROR_SCALE 1048576.0f    // fixed point of the per pixel errors summed by a tile (clamped to 1)
+#define ADAPTIVE_ERROR_SLOTS 3             // tile sums read, written & cleared in the same frame
+// Edge aware a-trous denoiser (SVGF) of the direct & indirect light of hit pixels, between the shading pass & TAA
+// (compute/svgf.glsl, cpu/denoiser.hpp)
+#define DENOISER_ON 0
+#define DENOISER_ATROUS_ITERATIONS 4       // 5x5 passes with steps 1, 2, 4, 8
+#define DENOISER_COLOR_ALPHA 0.2f          // least weight of the new frame in the color history
+#define DENOISER_MOMENTS_ALPHA 0.2f        // least weight of the new frame in the luminance moments
+#define DENOISER_MAX_HISTORY 32            // frames a history counts up to
+#define DENOISER_MIN_HISTORY 4             // shorter histories estimate their variance spatially
+#define DENOISER_PHI_COLOR 4.0f            // luminance edge stop, in standard deviations
+#define DENOISER_PHI_NORMAL 128.0f         // exponent of the normal edge stop
+#define DENOISER_PHI_DEPTH 1.0f            // distance edge stop, in steps of the local distance gradient
+#define DENOISER_NORMAL_THRESHOLD 0.9f     // least cosine between a pixel & its history
+#define DENOISER_DEPTH_THRESHOLD 0.1f      // largest relative distance between a pixel & its history
+#define DENOISER_ALBEDO_EPSILON 0.01f      // light is filtered divided by the albedo
+// Perlin turbulence is one fetch of a baked tileable noise volume instead of the octave loop (perlin.glsl,
+// cpu/noise_volume.hpp)
+#define BAKED_NOISE_ON 0
+#define NOISE_VOLUME_RESOLUTION 128        // voxels per axis of a tile
+#define NOISE_VOLUME_PERIOD 16             // lattice cells of the first octave per tile, power of two
+#define NOISE_VOLUME_OCTAVES 4
+#define NOISE_VOLUME_GAIN 0.5f
+// Per pixel reservoirs & direct illumination are stored packed: radiance in shared exponent RGB9E5, directions in
+// 16-bit octahedral, M as a half float (packing.glsl, cpu/packed_reservoir.hpp)
+#define PACKED_RESERVOIRS_ON 0
 
 #define DAXA_PI 3.1415926535897932384626433832795f
 #define DAXA_2PI 6.283185307179586476925286766559f
@@ -55,6 +115,7 @@
 
 #define HLF_MAX 6.5504e+4F       // max value for half float
 #define HLF_MIN 1.175494351e-38F // min value for float
+#define ONE_MINUS_EPSILON 0.99999994F // largest float below 1
 
 #define SAMPLES_PER_PIXEL 1
 #define SAMPLE_OFFSET 1e-3f // Multi sample offset
@@ -68,7 +129,9 @@
 #define SCREEN_SIZE_X 3840
 #define SCREEN_SIZE_Y 2160
 
-#define MAX_RESERVOIRS SCREEN_SIZE_X *SCREEN_SIZE_Y
+#define MAX_RESERVOIRS SCREEN_SIZE_X *SCREEN_SIZE_Y // reference only, per pixel buffers follow the swapchain extent
+#define MAX_DENOISER_PIXELS (MAX_RESERVOIRS * 2) // denoiser histories & signals keep two halves
+#define MAX_ADAPTIVE_TILES ((SCREEN_SIZE_X + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE) * ((SCREEN_SIZE_Y + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE)
 
 #define PERFECT_PIXEL_BIT 1U << 31
 #define REMAP_BIT 1U << 30
@@ -86,6 +149,14 @@
 
 #define BRUSH_TYPE_SQUARE 0
 
+// Primitive ranges start on multiples of it (ACCEL_STRUCT_MNGR::PRIMITIVE_ALIGNMENT), a range is claimed by the first
+// instance the brush hits in it: placements sharing the range of their prototype don't mix their hits in a stroke
+#define BRUSH_RANGE_ALIGNMENT 32U
+#define BRUSH_RANGE_UNCLAIMED 0xFFFFFFFFU
+
+// Brush hits on merged boxes (MERGED_BOXES_ON) kept per stroke, the ones after it are left to the next strokes
+#define MAX_BRUSH_BOX_HITS 65536U
+
 struct AABB
 {
   daxa_f32vec3 minimum;
@@ -228,7 +299,16 @@ struct BRUSH_COUNTER
 {
   daxa_u32 instance_count;
   daxa_u32 primitive_count;
+  daxa_u32 box_hit_count;
+};
+
+// Hit of the brush on a merged box: the host splits the box & deletes the voxel under the hit in the same stroke
+struct BRUSH_BOX_HIT
+{
+  daxa_u32 primitive_index;
+  daxa_f32vec3 position; // world space
 };
+DAXA_DECL_BUFFER_PTR(BRUSH_BOX_HIT)
 
 struct BRUSH_TEST_PRIMITIVE 
 {
@@ -259,6 +339,8 @@ struct Status
   daxa_u64 brush_counter_address;
   daxa_u64 instance_bitmask_address;
   daxa_u64 primitive_bitmask_address;
+  daxa_u64 brush_range_owner_address;
+  daxa_u64 brush_box_hit_address;
 };
 DAXA_DECL_BUFFER_PTR(Status)
 
@@ -283,6 +365,10 @@ struct WORLD
   daxa_u64 point_light_address;
   daxa_u64 cube_light_address;
   daxa_u64 env_light_address;
+  daxa_u64 brick_address;
+  daxa_u64 light_tree_address;
+  daxa_u64 light_tree_leaf_address;
+  daxa_u64 light_alias_address;
 };
 DAXA_DECL_BUFFER_PTR(WORLD)
 
@@ -292,6 +378,15 @@ struct PRIMITIVE
   daxa_u32 light_index;
 };
 
+// Brick primitive (BRICK_PRIMITIVES_ON): the PRIMITIVE of the brick AABB holds the brick slot in material_index.
+// Voxel bit x + 8y + 64z, one bit per voxel in occupancy & one PRIMITIVE per voxel, so edits only flip bits.
+// Hits report primitive_id = (brick primitive id << BRICK_VOXEL_BITS) | voxel bit.
+struct BRICK
+{
+  daxa_u32 occupancy[BRICK_OCCUPANCY_WORD_COUNT];
+  PRIMITIVE voxels[CHUNK_VOXEL_COUNT];
+};
+
 #define MATERIAL_TYPE_LAMBERTIAN 0
 #define MATERIAL_TYPE_METAL 1
 #define MATERIAL_TYPE_DIELECTRIC 2
@@ -350,6 +445,30 @@ struct LIGHT
   daxa_u32 type; // 0: point, 1: quad, 2: sphere
 };
 
+// Node of the light tree (LIGHT_TREE_ON), both children of an inner node are next to each other.
+// Bounds of the lights below: world box, power & the cone of their emission (Conty Estevez & Kulla 2018)
+struct LIGHT_TREE_NODE
+{
+  daxa_f32vec3 minimum;
+  daxa_f32 phi; // 0 when every light below was deleted
+  daxa_f32vec3 maximum;
+  daxa_u32 child_or_light; // first child or cube light index of a leaf
+  daxa_f32vec3 axis;
+  daxa_f32 cos_theta_o; // normals within theta_o of the axis
+  daxa_f32 cos_theta_e; // emission within theta_e of the normals
+  daxa_u32 parent; // MAX_LIGHT_TREE_NODES for the root
+  daxa_u32 is_leaf;
+  daxa_u32 pad;
+};
+
+// Entry of the alias table of the cube lights (LIGHT_ALIAS_TABLE_ON)
+struct LIGHT_ALIAS
+{
+  daxa_f32 threshold; // light of the entry kept below it, alias above
+  daxa_u32 alias;
+  daxa_f32 pmf; // probability of picking the light of the entry
+};
+
 struct RESTIR
 {
   daxa_u64 previous_reservoir_address;
@@ -362,9 +481,49 @@ struct RESTIR
   daxa_u64 output_path_reservoir_address;
   daxa_u64 temporal_path_reservoir_address;
   daxa_u64 indirect_color_address;
+  daxa_u64 adaptive_pixel_address;
+  daxa_u64 adaptive_tile_address;
+  daxa_u64 denoiser_direct_address;
+  daxa_u64 denoiser_history_address;
+  daxa_u64 denoiser_signal_address;
 };
 DAXA_DECL_BUFFER_PTR(RESTIR)
 
+// Running statistics of a pixel (ADAPTIVE_SAMPLING_ON), the accumulated color is the mean
+struct ADAPTIVE_PIXEL
+{
+  daxa_f32vec3 mean;
+  daxa_f32 luminance_moment; // running mean of the squared luminance
+  daxa_u32 sample_count;
+};
+
+// Fixed point sums of the predicted relMSE of the pixels of a tile, slot frame % ADAPTIVE_ERROR_SLOTS is written
+struct ADAPTIVE_TILE
+{
+  daxa_u32 error_sums[ADAPTIVE_ERROR_SLOTS];
+};
+
+// Temporally accumulated light of a pixel (DENOISER_ON), divided by the albedo. Half frame_number % 2 is the current
+// frame, the first a-trous pass writes its output back as the color history
+struct DENOISER_HISTORY
+{
+  daxa_f32vec3 direct;
+  daxa_f32vec3 indirect;
+  daxa_f32vec4 moments; // first & second luminance moments of direct (xy) & indirect (zw)
+  daxa_f32vec3 normal;
+  daxa_f32 distance;    // 0 for misses
+  daxa_u32 mat_index;
+  daxa_f32 history_length;
+};
+
+// Light & its variance between a-trous passes, iteration i reads half i % 2 & writes the other
+struct DENOISER_SIGNAL
+{
+  daxa_f32vec3 direct;
+  daxa_f32vec3 indirect;
+  daxa_f32vec2 variance; // luminance variance of direct & indirect
+};
+
 struct RESERVOIR
 {
   daxa_u32 Y;      // index of most important light
@@ -439,6 +598,57 @@ struct DIRECT_ILLUMINATION_INFO
   daxa_f32 confidence;
 };
 
+// Storage of RESERVOIR (PACKED_RESERVOIRS_ON), 24 bytes instead of 36
+struct RESERVOIR_PACKED
+{
+  daxa_u32 Y;
+  daxa_u32 seed;
+  daxa_f32 W_y;
+  daxa_f32 W_sum;
+  daxa_u32 l_type_M; // l_type in the low 16 bits, M as a half float in the high ones
+  daxa_u32 F;        // RGB9E5
+};
+
+// Storage of PATH_RESERVOIR (PACKED_RESERVOIRS_ON), 68 bytes instead of 92. Weights, pdfs & the jacobian keep f32, their
+// range doesn't fit a half
+struct PATH_RESERVOIR_PACKED
+{
+  daxa_u32 M;                    // half float in the low 16 bits
+  daxa_f32 weight;
+  daxa_u32 path_flags;
+  daxa_u32 rc_random_seed;
+  daxa_u32 F;                    // RGB9E5
+  daxa_f32 light_pdf;
+  daxa_f32vec3 cached_jacobian;
+  daxa_u32 init_random_seed;
+  OBJECT_HIT rc_vertex_hit;
+  daxa_u32 rc_vertex_wi;         // octahedral, 16 bits per axis
+  daxa_u32 rc_vertex_irradiance; // RGB9E5
+};
+
+// Storage of DIRECT_ILLUMINATION_INFO (PACKED_RESERVOIRS_ON), 48 bytes instead of 60. distance & instance_hit keep their
+// names & types, the brush reads them straight from the buffer
+struct DIRECT_ILLUMINATION_INFO_PACKED
+{
+  daxa_f32vec3 position;
+  daxa_f32 distance;
+  daxa_u32 normal; // octahedral, 16 bits per axis
+  daxa_f32vec3 ray_origin;
+  daxa_u32 seed;
+  OBJECT_INFO instance_hit;
+  daxa_u32 mat_index_confidence; // mat_index in the low 16 bits, confidence as unorm16 in the high ones
+};
+
+#if PACKED_RESERVOIRS_ON == 1
+#define RESERVOIR_STORAGE RESERVOIR_PACKED
+#define PATH_RESERVOIR_STORAGE PATH_RESERVOIR_PACKED
+#define DIRECT_ILLUMINATION_INFO_STORAGE DIRECT_ILLUMINATION_INFO_PACKED
+#else
+#define RESERVOIR_STORAGE RESERVOIR
+#define PATH_RESERVOIR_STORAGE PATH_RESERVOIR
+#define DIRECT_ILLUMINATION_INFO_STORAGE DIRECT_ILLUMINATION_INFO
+#endif // PACKED_RESERVOIRS_ON
+
 struct PushConstant
 {
   daxa_u32vec2 size;
@@ -452,6 +662,7 @@ struct PushConstant
   daxa_BufferPtr(Status) status_buffer;
   daxa_BufferPtr(WORLD) world_buffer;
   daxa_RWBufferPtr(RESTIR) restir_buffer;
+  daxa_u32 filter_iteration; // a-trous iteration of the denoiser passes
 };
 
 DAXA_DECL_TASK_HEAD_BEGIN(PrimitiveChangesTaskHead)
@@ -111,19 +111,19 @@ class NoiseTexture : public Texture<ImageTexture> {
         return noise.get_size() * sizeof(float);
     }
 
-    int* get_perm_x_data() const {
+    const int* get_perm_x_data() const {
         return noise.perm_x_data();
     }
 
-    int* get_perm_y_data() const {
+    const int* get_perm_y_data() const {
         return noise.perm_y_data();
     }
 
-    int* get_perm_z_data() const {
+    const int* get_perm_z_data() const {
         return noise.perm_z_data();
     }
 
-    float* get_ranfloat_data() const {
+    const float* get_ranfloat_data() const {
         return noise.ranfloat_data();
     }
 
@@ -0,0 +1,312 @@
+// Image comparison harness.
+// Compares test frames (PFM, PPM) against a reference, usually a converged image of reference_render,
+// with MSE, relMSE, PSNR, SSIM & FLIP (image_metrics.hpp).
+// A directory given as test is a sequence converging to the reference: its frames are compared in file name
+// order and the convergence curve is reported with the cost of every frame (render_ms & samples_per_pixel of the
+// JSON next to the frame, as written by reference_render, or the frame number), the cost at which each --target
+// relMSE is reached and the convergence rate.
+// --max-rel-mse, --max-flip & --min-ssim turn it into a quality gate: the exit code is 2 when the last frame of any
+// test fails one of them.
+//
+// usage: image_compare <reference> <test or sequence dir>... [--target relMSE]... [--max-rel-mse X] [--max-flip X]
+//                      [--min-ssim X] [--ppd X] [--threads N] [--flip-map out.ppm] [--json out.json]
+
+#include "defines.h"
+#include "image_io.hpp"
+#include "image_metrics.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+struct FrameResult
+{
+    std::filesystem::path path = {};
+    double render_ms = 0.0;
+    double samples_per_pixel = 0.0;
+    double compare_ms = 0.0;
+    ImageMetrics metrics = {};
+};
+
+struct TestResult
+{
+    std::filesystem::path path = {};
+    std::vector<FrameResult> frames = {};
+    std::vector<double> times_to_error = {};   // ms (frame number without timings) per target
+    std::vector<double> samples_to_error = {}; // spp per target
+    double convergence_rate = 0.0;
+    bool passed = true;
+};
+
+// Number after "key": in the JSON written next to a frame, 0 if missing
+static double read_json_number(std::string const &json, std::string const &key)
+{
+    size_t position = json.find("\"" + key + "\"");
+    if (position == std::string::npos)
+        return 0.0;
+    position = json.find(':', position);
+    return position == std::string::npos ? 0.0 : std::strtod(json.c_str() + position + 1, nullptr);
+}
+
+static bool is_image(std::filesystem::path const &path)
+{
+    return path.extension() == ".pfm" || path.extension() == ".ppm";
+}
+
+static bool compare_frame(std::vector<glm::vec3> const &reference, uint32_t width, uint32_t height, FrameResult &frame,
+                          TilePool &pool, ImageMetricSettings const &settings, std::vector<float> *flip_map)
+{
+    uint32_t test_width = 0, test_height = 0;
+    std::vector<glm::vec3> test = {};
+    if (!read_image(frame.path, test_width, test_height, test))
+        return false;
+    if (test_width != width || test_height != height)
+    {
+        std::cerr << frame.path.string() << ": " << test_width << "x" << test_height << " does not match the reference "
+                  << width << "x" << height << std::endl;
+        return false;
+    }
+
+    std::ifstream json_file(std::filesystem::path(frame.path).replace_extension(".json"));
+    if (json_file.is_open())
+    {
+        std::stringstream json = {};
+        json << json_file.rdbuf();
+        frame.render_ms = read_json_number(json.str(), "render_ms");
+        frame.samples_per_pixel = read_json_number(json.str(), "samples_per_pixel");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    frame.metrics = compare_images(reference, test, width, height, pool, settings, flip_map);
+    frame.compare_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+static void write_metrics_json(std::ostream &out, ImageMetrics const &metrics)
+{
+    // JSON has no infinity, identical images get a null PSNR
+    out << "\"mse\": " << metrics.mse << ", "
+        << "\"rel_mse\": " << metrics.rel_mse << ", "
+        << "\"psnr\": ";
+    if (std::isfinite(metrics.psnr))
+        out << metrics.psnr;
+    else
+        out << "null";
+    out << ", \"ssim\": " << metrics.ssim << ", "
+        << "\"flip\": " << metrics.flip;
+}
+
+static void write_json(std::ostream &out, std::filesystem::path const &reference_path, std::vector<TestResult> const &results,
+                       std::vector<double> const &targets)
+{
+    out << "{\n";
+    out << "  \"benchmark\": \"image_compare\",\n";
+    out << "  \"reference\": \"" << reference_path.generic_string() << "\",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto const &result = results[i];
+        out << "    {"
+            << "\"test\": \"" << result.path.generic_string() << "\", "
+            << "\"passed\": " << (result.passed ? "true" : "false") << ", "
+            << "\"convergence_rate\": " << result.convergence_rate << ", "
+            << "\"targets\": [";
+        for (size_t j = 0; j < targets.size(); ++j)
+        {
+            out << "{\"rel_mse\": " << targets[j] << ", \"cost\": " << result.times_to_error[j]
+                << ", \"samples_per_pixel\": " << result.samples_to_error[j] << "}" << (j + 1 < targets.size() ? ", " : "");
+        }
+        out << "], \"frames\": [";
+        for (size_t j = 0; j < result.frames.size(); ++j)
+        {
+            auto const &frame = result.frames[j];
+            out << "{"
+                << "\"frame\": \"" << frame.path.filename().generic_string() << "\", "
+                << "\"render_ms\": " << frame.render_ms << ", "
+                << "\"samples_per_pixel\": " << frame.samples_per_pixel << ", "
+                << "\"compare_ms\": " << frame.compare_ms << ", ";
+            write_metrics_json(out, frame.metrics);
+            out << "}" << (j + 1 < result.frames.size() ? ", " : "");
+        }
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void write_table(std::ostream &out, std::vector<TestResult> const &results, std::vector<double> const &targets)
+{
+    out << std::endl;
+    for (auto const &result : results)
+    {
+        out << result.path.string() << (result.passed ? "" : " (FAILED)") << std::endl;
+        for (auto const &frame : result.frames)
+        {
+            out << "  " << frame.path.filename().string() << ": relMSE " << frame.metrics.rel_mse << ", MSE " << frame.metrics.mse
+                << ", PSNR " << frame.metrics.psnr << " dB, SSIM " << frame.metrics.ssim << ", FLIP " << frame.metrics.flip;
+            if (frame.render_ms > 0.0)
+                out << " (" << frame.render_ms << " ms, " << frame.samples_per_pixel << " spp)";
+            out << ", compared in " << frame.compare_ms << " ms" << std::endl;
+        }
+        if (result.frames.size() > 1)
+        {
+            out << "  convergence rate " << result.convergence_rate << " (log relMSE / log cost)" << std::endl;
+            for (size_t i = 0; i < targets.size(); ++i)
+            {
+                out << "  relMSE " << targets[i] << ": ";
+                if (result.times_to_error[i] < 0.0)
+                    out << "not reached" << std::endl;
+                else
+                    out << result.times_to_error[i] << " (" << result.samples_to_error[i] << " spp)" << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path reference_path = {};
+    std::vector<std::filesystem::path> test_paths = {};
+    std::filesystem::path json_path = {};
+    std::filesystem::path flip_map_path = {};
+    std::vector<double> targets = {};
+    ImageMetricSettings settings = {};
+    double max_rel_mse = std::numeric_limits<double>::infinity();
+    double max_flip = std::numeric_limits<double>::infinity();
+    double min_ssim = -std::numeric_limits<double>::infinity();
+    uint32_t thread_count = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--target" && i + 1 < argc)
+            targets.push_back(std::strtod(argv[++i], nullptr));
+        else if (arg == "--max-rel-mse" && i + 1 < argc)
+            max_rel_mse = std::strtod(argv[++i], nullptr);
+        else if (arg == "--max-flip" && i + 1 < argc)
+            max_flip = std::strtod(argv[++i], nullptr);
+        else if (arg == "--min-ssim" && i + 1 < argc)
+            min_ssim = std::strtod(argv[++i], nullptr);
+        else if (arg == "--ppd" && i + 1 < argc)
+            settings.pixels_per_degree = std::max(1.0f, static_cast<float>(std::strtod(argv[++i], nullptr)));
+        else if (arg == "--threads" && i + 1 < argc)
+            thread_count = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--flip-map" && i + 1 < argc)
+            flip_map_path = argv[++i];
+        else if (arg == "--json" && i + 1 < argc)
+            json_path = argv[++i];
+        else if (arg.rfind("--", 0) != 0)
+        {
+            if (reference_path.empty())
+                reference_path = arg;
+            else
+                test_paths.push_back(arg);
+        }
+        else
+        {
+            reference_path.clear();
+            break;
+        }
+    }
+
+    if (reference_path.empty() || test_paths.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " <reference> <test or sequence dir>... [--target relMSE]... [--max-rel-mse X] [--max-flip X]"
+                  << " [--min-ssim X] [--ppd X] [--threads N] [--flip-map out.ppm] [--json out.json]" << std::endl;
+        return 1;
+    }
+
+    if (targets.empty())
+        targets = {1e-1, 1e-2, 1e-3};
+
+    uint32_t width = 0, height = 0;
+    std::vector<glm::vec3> reference = {};
+    if (!read_image(reference_path, width, height, reference))
+        return 1;
+
+    TilePool pool(thread_count);
+
+    int result_code = 0;
+    std::vector<TestResult> results = {};
+    std::vector<float> flip_map = {};
+    for (auto const &test_path : test_paths)
+    {
+        TestResult result = {.path = test_path};
+        std::vector<std::filesystem::path> frame_paths = {};
+        if (std::filesystem::is_directory(test_path))
+        {
+            for (auto const &entry : std::filesystem::directory_iterator(test_path))
+            {
+                if (entry.is_regular_file() && is_image(entry.path()))
+                    frame_paths.push_back(entry.path());
+            }
+            // Frames named in the order they were rendered
+            std::sort(frame_paths.begin(), frame_paths.end());
+        }
+        else
+            frame_paths.push_back(test_path);
+
+        for (auto const &frame_path : frame_paths)
+        {
+            FrameResult frame = {.path = frame_path};
+            if (!compare_frame(reference, width, height, frame, pool, settings, flip_map_path.empty() ? nullptr : &flip_map))
+            {
+                result_code = 1;
+                continue;
+            }
+            result.frames.push_back(frame);
+        }
+        if (result.frames.empty())
+            continue;
+
+        // Cost of the frames: render time when every frame has one, the frame number otherwise
+        bool timed = std::all_of(result.frames.begin(), result.frames.end(), [](FrameResult const &frame)
+                                 { return frame.render_ms > 0.0; });
+        std::vector<ConvergencePoint> curve = {}, sample_curve = {};
+        for (size_t i = 0; i < result.frames.size(); ++i)
+        {
+            auto const &frame = result.frames[i];
+            curve.push_back({.cost = timed ? frame.render_ms : static_cast<double>(i + 1), .metrics = frame.metrics});
+            sample_curve.push_back({.cost = frame.samples_per_pixel, .metrics = frame.metrics});
+        }
+        for (double target : targets)
+        {
+            result.times_to_error.push_back(get_time_to_error(curve, target));
+            result.samples_to_error.push_back(get_time_to_error(sample_curve, target));
+        }
+        result.convergence_rate = get_convergence_rate(curve);
+
+        ImageMetrics const &last = result.frames.back().metrics;
+        result.passed = last.rel_mse <= max_rel_mse && last.flip <= max_flip && last.ssim >= min_ssim;
+        if (!result.passed && result_code == 0)
+            result_code = 2;
+
+        results.push_back(result);
+    }
+
+    // FLIP map of the last frame compared, grayscale
+    if (!flip_map_path.empty() && !flip_map.empty())
+    {
+        std::vector<glm::vec3> pixels(flip_map.size());
+        for (size_t i = 0; i < flip_map.size(); ++i)
+            pixels[i] = glm::vec3(srgb_to_linear(flip_map[i]));
+        if (!write_ppm(flip_map_path, width, height, pixels))
+            result_code = 1;
+    }
+
+    if (!json_path.empty())
+    {
+        std::ofstream json(json_path);
+        if (!json.is_open())
+        {
+            std::cerr << "Could not open " << json_path.string() << std::endl;
+            return 1;
+        }
+        write_json(json, reference_path, results, targets);
+    }
+
+    write_table(std::cout, results, targets);
+
+    return result_code;
+}
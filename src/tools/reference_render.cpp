@@ -0,0 +1,175 @@
+// Headless CPU reference renderer.
+// Loads every bundled model into the host scene arrays, traces it with the CPU path tracer
+// and writes converged references (PFM, linear) plus sRGB previews (PPM) and the settings used.
+// The references are the ground truth for image comparisons of sampling & reuse changes.
+//
+// usage: reference_render [models dir] [--scene name.vox]... [--spp N] [--size W H] [--max-depth N]
+//                         [--threads N] [--jitter] [--out dir]
+
+#include "defines.h"
+#include "camera.h"
+#include "host_scene.hpp"
+#include "host_accel.hpp"
+#include "reference_tracer.hpp"
+#include "image_io.hpp"
+
+#include <cstdlib>
+#include <string>
+
+// Camera looking at the scene bounds from the front & slightly above, with the projection of the renderer
+static HostCamera frame_scene(HostScene const &scene, uint32_t width, uint32_t height)
+{
+    camera cam = {};
+    reset_camera(cam);
+    cam.width = width;
+    cam.height = height;
+
+    glm::vec3 center = (scene.bounds_min + scene.bounds_max) * 0.5f;
+    float radius = glm::length(scene.bounds_max - scene.bounds_min) * 0.5f;
+
+    // proj[1][1] = 1 / tan(fov / 2), whatever unit the fov ends up in
+    float focal = std::abs(get_projection_matrix(cam)[1][1]);
+    float distance = radius * std::max(focal, 1.0f) * 1.1f;
+
+    cam.position = center + glm::normalize(glm::vec3(0.0f, 0.35f, 1.0f)) * distance;
+    cam.forward = glm::normalize(center - cam.position);
+
+    HostCamera host_camera = {
+        .inv_view = get_inverse_view_matrix(cam),
+        .inv_proj = get_inverse_projection_matrix(cam),
+    };
+    // Same flip as the camera_view upload
+    host_camera.inv_proj[1][1] *= -1.0f;
+    return host_camera;
+}
+
+static void write_settings(std::filesystem::path const &path, std::string const &scene_name, HostScene const &scene,
+                           ReferenceSettings const &settings, ReferenceStats const &stats, uint32_t thread_count)
+{
+    std::ofstream json(path);
+    if (!json.is_open())
+        return;
+    json << "{\n";
+    json << "  \"scene\": \"" << scene_name << "\",\n";
+    json << "  \"width\": " << settings.width << ",\n";
+    json << "  \"height\": " << settings.height << ",\n";
+    json << "  \"samples_per_pixel\": " << settings.samples_per_pixel << ",\n";
+    json << "  \"max_depth\": " << settings.max_depth << ",\n";
+    json << "  \"jitter\": " << (settings.jitter ? "true" : "false") << ",\n";
+    json << "  \"merged_boxes_on\": " << MERGED_BOXES_ON << ",\n";
+    json << "  \"primitives\": " << scene.get_primitive_count() << ",\n";
+    json << "  \"cube_lights\": " << scene.cube_lights.size() << ",\n";
+    json << "  \"threads\": " << thread_count << ",\n";
+    json << "  \"render_ms\": " << stats.render_ms << ",\n";
+    json << "  \"rays\": " << stats.ray_count << "\n";
+    json << "}\n";
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path models_path = "assets/models";
+    std::filesystem::path out_path = "references";
+    std::vector<std::string> scene_names = {};
+    ReferenceSettings settings = {};
+    uint32_t thread_count = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--scene" && i + 1 < argc)
+            scene_names.push_back(argv[++i]);
+        else if (arg == "--spp" && i + 1 < argc)
+            settings.samples_per_pixel = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--size" && i + 2 < argc)
+        {
+            settings.width = std::max(1, std::atoi(argv[++i]));
+            settings.height = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--max-depth" && i + 1 < argc)
+            settings.max_depth = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            thread_count = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--jitter")
+            settings.jitter = true;
+        else if (arg == "--out" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (arg.rfind("--", 0) != 0)
+            models_path = arg;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [models dir] [--scene name.vox]... [--spp N] [--size W H] [--max-depth N]"
+                      << " [--threads N] [--jitter] [--out dir]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::filesystem::path> files = {};
+    if (scene_names.empty())
+    {
+        std::error_code error = {};
+        for (auto const &entry : std::filesystem::directory_iterator(models_path, error))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".vox")
+                files.push_back(entry.path());
+        }
+        // Stable order so runs can be compared
+        std::sort(files.begin(), files.end());
+    }
+    else
+    {
+        for (auto const &name : scene_names)
+            files.push_back(models_path / name);
+    }
+
+    if (files.empty())
+    {
+        std::cerr << "No models found in " << models_path.string() << std::endl;
+        return 1;
+    }
+
+    std::error_code error = {};
+    std::filesystem::create_directories(out_path, error);
+
+    TilePool pool(thread_count);
+
+    MapLoader loader = {};
+    loader.create_gvox_context();
+
+    int result = 0;
+    for (auto const &file : files)
+    {
+        std::string scene_name = file.stem().string();
+
+        HostScene scene = {};
+        if (!scene.load_model(loader, file, glm::mat4(1.0f)))
+        {
+            result = 1;
+            continue;
+        }
+        scene.add_default_lights();
+
+        HostAccel accel = {};
+        accel.build(scene, pool);
+
+        std::cout << scene_name << ": " << scene.get_primitive_count() << " primitives, " << scene.cube_lights.size()
+                  << " cube lights, " << settings.samples_per_pixel << " spp at " << settings.width << "x" << settings.height << std::endl;
+
+        ReferenceTracer tracer(accel, settings);
+        std::vector<glm::vec3> image = {};
+        ReferenceStats stats = tracer.render(frame_scene(scene, settings.width, settings.height), pool, image);
+
+        std::cout << "  " << stats.render_ms << " ms, " << (stats.ray_count / (stats.render_ms * 1e3)) << " Mrays/s, "
+                  << pool.get_thread_count() << " threads, " << stats.steal_count << " tiles stolen" << std::endl;
+
+        if (!write_pfm(out_path / (scene_name + ".pfm"), settings.width, settings.height, image) ||
+            !write_ppm(out_path / (scene_name + ".ppm"), settings.width, settings.height, image))
+        {
+            result = 1;
+        }
+        write_settings(out_path / (scene_name + ".json"), scene_name, scene, settings, stats, pool.get_thread_count());
+    }
+
+    loader.destroy_gvox_context();
+
+    return result;
+}
@@ -0,0 +1,395 @@
+// Sampler table generator.
+// Writes shaders/sampler_tables.inl, the tables both sampler.glsl & cpu/sampler.hpp read so the shaders and the CPU
+// reference draw the same bits:
+//  - the generator matrices of the first SAMPLER_SOBOL_DIMENSIONS Sobol dimensions (Joe & Kuo 2008 direction numbers),
+//  - the ranks of a SAMPLER_BLUE_NOISE_SIZE^2 tileable blue noise mask made with void and cluster (Ulichney 1993).
+// The mask is checked before it's written: its radially averaged power spectrum must stay far below the one of white
+// noise at low frequencies. --check compares the tables with the file instead of writing it (exit code 2 when it's stale).
+//
+// usage: sampler_tables [--out shaders/sampler_tables.inl] [--check] [--sigma X] [--seed N] [--preview out.ppm]
+
+#include "defines.h"
+#include "host_shading.hpp"
+#include "image_io.hpp"
+
+#include <chrono>
+#include <complex>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+//////////////////////////////// SOBOL //////////////////////////////////////
+
+struct SobolDirection
+{
+    uint32_t s = 0;              // degree of the primitive polynomial
+    uint32_t a = 0;              // its inner coefficients
+    uint32_t m[3] = {0, 0, 0};   // initial direction numbers
+};
+
+// Dimensions 2 to 4 of new-joe-kuo-6.21201, the first one is van der Corput
+static constexpr SobolDirection SOBOL_DIRECTIONS[SAMPLER_SOBOL_DIMENSIONS - 1] = {
+    {.s = 1, .a = 0, .m = {1, 0, 0}},
+    {.s = 2, .a = 1, .m = {1, 3, 0}},
+    {.s = 3, .a = 1, .m = {1, 3, 1}},
+};
+
+// 32 columns per dimension, column i is the point of index 1 << i
+static std::vector<uint32_t> get_sobol_matrices()
+{
+    std::vector<uint32_t> matrices(SAMPLER_SOBOL_DIMENSIONS * 32, 0);
+    for (uint32_t i = 0; i < 32; ++i)
+        matrices[i] = 1U << (31 - i);
+
+    for (uint32_t dimension = 1; dimension < SAMPLER_SOBOL_DIMENSIONS; ++dimension)
+    {
+        SobolDirection const &direction = SOBOL_DIRECTIONS[dimension - 1];
+        uint32_t *v = matrices.data() + dimension * 32;
+        for (uint32_t i = 0; i < 32; ++i)
+        {
+            if (i < direction.s)
+            {
+                v[i] = direction.m[i] << (31 - i);
+                continue;
+            }
+            v[i] = v[i - direction.s] ^ (v[i - direction.s] >> direction.s);
+            for (uint32_t k = 1; k < direction.s; ++k)
+                if ((direction.a >> (direction.s - 1 - k)) & 1)
+                    v[i] ^= v[i - k];
+        }
+    }
+    return matrices;
+}
+
+//////////////////////////////// BLUE NOISE //////////////////////////////////////
+
+// Void and cluster on a torus: the energy of a cell is the gaussian weighted count of the set cells around it, the
+// tightest cluster is the set cell of highest energy & the largest void the empty cell of lowest energy
+struct VoidAndCluster
+{
+    uint32_t size = 0;
+    std::vector<float> kernel = {};     // gaussian of the toroidal offset, size^2
+    std::vector<uint8_t> pattern = {};  // 1 for the set cells
+    std::vector<double> energy = {};
+
+    VoidAndCluster(uint32_t mask_size, float sigma) : size(mask_size), kernel(mask_size * mask_size), pattern(mask_size * mask_size, 0), energy(mask_size * mask_size, 0.0)
+    {
+        for (uint32_t y = 0; y < size; ++y)
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                float dx = static_cast<float>(std::min(x, size - x));
+                float dy = static_cast<float>(std::min(y, size - y));
+                kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+            }
+    }
+
+    void splat(uint32_t cell, double sign)
+    {
+        uint32_t cx = cell % size, cy = cell / size;
+        for (uint32_t y = 0; y < size; ++y)
+        {
+            uint32_t ky = ((y + size - cy) % size) * size;
+            for (uint32_t x = 0; x < size; ++x)
+                energy[y * size + x] += sign * kernel[ky + (x + size - cx) % size];
+        }
+    }
+
+    void set(uint32_t cell, uint8_t value)
+    {
+        if (pattern[cell] == value)
+            return;
+        pattern[cell] = value;
+        splat(cell, value ? 1.0 : -1.0);
+    }
+
+    // Highest energy cell with the value, first one on ties
+    uint32_t find_tightest_cluster(uint8_t value) const
+    {
+        uint32_t best = 0;
+        double best_energy = -std::numeric_limits<double>::max();
+        for (uint32_t cell = 0; cell < pattern.size(); ++cell)
+            if (pattern[cell] == value && energy[cell] > best_energy)
+            {
+                best = cell;
+                best_energy = energy[cell];
+            }
+        return best;
+    }
+
+    uint32_t find_largest_void(uint8_t value) const
+    {
+        uint32_t best = 0;
+        double best_energy = std::numeric_limits<double>::max();
+        for (uint32_t cell = 0; cell < pattern.size(); ++cell)
+            if (pattern[cell] == value && energy[cell] < best_energy)
+            {
+                best = cell;
+                best_energy = energy[cell];
+            }
+        return best;
+    }
+
+    void reset(std::vector<uint8_t> const &initial)
+    {
+        std::fill(pattern.begin(), pattern.end(), 0);
+        std::fill(energy.begin(), energy.end(), 0.0);
+        for (uint32_t cell = 0; cell < initial.size(); ++cell)
+            set(cell, initial[cell]);
+    }
+};
+
+// Rank of every cell, 0 to size^2 - 1: thresholding the mask at any level gives a blue noise pattern
+static std::vector<uint32_t> get_blue_noise_ranks(uint32_t size, float sigma, uint32_t seed)
+{
+    uint32_t cell_count = size * size;
+    VoidAndCluster vac(size, sigma);
+
+    // Initial binary pattern: a tenth of the cells at random, then the tightest cluster moves to the largest void until
+    // it lands where it was taken from
+    uint32_t rng = host_tea(seed, 0x5a3);
+    uint32_t initial_count = cell_count / 10;
+    uint32_t set_count = 0;
+    while (set_count < initial_count)
+    {
+        uint32_t cell = std::min(static_cast<uint32_t>(host_rnd(rng) * cell_count), cell_count - 1);
+        if (vac.pattern[cell])
+            continue;
+        vac.set(cell, 1);
+        ++set_count;
+    }
+    while (true)
+    {
+        uint32_t cluster = vac.find_tightest_cluster(1);
+        vac.set(cluster, 0);
+        uint32_t largest_void = vac.find_largest_void(0);
+        vac.set(largest_void, 1);
+        if (largest_void == cluster)
+            break;
+    }
+    std::vector<uint8_t> initial = vac.pattern;
+
+    std::vector<uint32_t> ranks(cell_count, 0);
+
+    // Phase 1: the set cells are ranked down by removing the tightest cluster
+    for (uint32_t rank = initial_count; rank-- > 0;)
+    {
+        uint32_t cluster = vac.find_tightest_cluster(1);
+        vac.set(cluster, 0);
+        ranks[cluster] = rank;
+    }
+
+    // Phase 2: up to half by filling the largest void
+    vac.reset(initial);
+    uint32_t rank = initial_count;
+    for (; rank < cell_count / 2; ++rank)
+    {
+        uint32_t largest_void = vac.find_largest_void(0);
+        vac.set(largest_void, 1);
+        ranks[largest_void] = rank;
+    }
+
+    // Phase 3: the empty cells are now the minority, the tightest cluster of them is filled first
+    std::vector<uint8_t> inverted = vac.pattern;
+    for (uint8_t &cell : inverted)
+        cell = cell ? 0 : 1;
+    vac.reset(inverted);
+    for (; rank < cell_count; ++rank)
+    {
+        uint32_t cluster = vac.find_tightest_cluster(1);
+        vac.set(cluster, 0);
+        ranks[cluster] = rank;
+    }
+
+    return ranks;
+}
+
+// Radially averaged power spectrum of the mask values, bin r holds the frequencies of radius [r, r + 1)
+static std::vector<double> get_radial_spectrum(std::vector<uint32_t> const &ranks, uint32_t size)
+{
+    uint32_t cell_count = size * size;
+    std::vector<double> values(cell_count);
+    double mean = 0.0;
+    for (uint32_t cell = 0; cell < cell_count; ++cell)
+        mean += values[cell] = (ranks[cell] + 0.5) / cell_count;
+    mean /= cell_count;
+    for (double &value : values)
+        value -= mean;
+
+    // Separable DFT, rows then columns
+    std::vector<std::complex<double>> rows(cell_count), spectrum(cell_count);
+    std::vector<std::complex<double>> twiddles(size);
+    for (uint32_t k = 0; k < size; ++k)
+        twiddles[k] = std::polar(1.0, -2.0 * std::numbers::pi * k / size);
+    for (uint32_t y = 0; y < size; ++y)
+        for (uint32_t u = 0; u < size; ++u)
+        {
+            std::complex<double> sum = 0.0;
+            for (uint32_t x = 0; x < size; ++x)
+                sum += values[y * size + x] * twiddles[(u * x) % size];
+            rows[y * size + u] = sum;
+        }
+    for (uint32_t u = 0; u < size; ++u)
+        for (uint32_t v = 0; v < size; ++v)
+        {
+            std::complex<double> sum = 0.0;
+            for (uint32_t y = 0; y < size; ++y)
+                sum += rows[y * size + u] * twiddles[(v * y) % size];
+            spectrum[v * size + u] = sum;
+        }
+
+    uint32_t bin_count = size / 2;
+    std::vector<double> power(bin_count, 0.0);
+    std::vector<uint32_t> counts(bin_count, 0);
+    for (uint32_t v = 0; v < size; ++v)
+        for (uint32_t u = 0; u < size; ++u)
+        {
+            double fu = std::min(u, size - u), fv = std::min(v, size - v);
+            uint32_t bin = static_cast<uint32_t>(std::sqrt(fu * fu + fv * fv));
+            if (bin >= bin_count || (u == 0 && v == 0))
+                continue;
+            power[bin] += std::norm(spectrum[v * size + u]) / cell_count;
+            ++counts[bin];
+        }
+    for (uint32_t bin = 0; bin < bin_count; ++bin)
+        power[bin] = counts[bin] > 0 ? power[bin] / counts[bin] : 0.0;
+    return power;
+}
+
+//////////////////////////////// OUTPUT //////////////////////////////////////
+
+static void write_table(std::ostream &out, char const *name, std::vector<uint32_t> const &words)
+{
+    out << "SAMPLER_TABLE(" << name << ", " << words.size() << ")\n";
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        out << (i % 8 == 0 ? "    " : " ") << "0x" << std::hex << std::setw(8) << std::setfill('0') << words[i] << std::dec << "U"
+            << (i + 1 < words.size() ? "," : "") << (i % 8 == 7 || i + 1 == words.size() ? "\n" : "");
+    }
+    out << "SAMPLER_TABLE_END\n";
+}
+
+static std::string get_tables_source(std::vector<uint32_t> const &sobol_matrices, std::vector<uint32_t> const &ranks, float sigma, uint32_t seed)
+{
+    // Two 16 bit ranks per word, the even cell in the low half
+    std::vector<uint32_t> packed_ranks(ranks.size() / 2);
+    for (size_t i = 0; i < packed_ranks.size(); ++i)
+        packed_ranks[i] = ranks[2 * i] | (ranks[2 * i + 1] << 16);
+
+    std::ostringstream out;
+    out << "#pragma once\n";
+    out << "// Generated by sampler_tables (src/tools/sampler_tables.cpp), don't edit.\n";
+    out << "// Sobol matrices of the first " << SAMPLER_SOBOL_DIMENSIONS << " dimensions (Joe & Kuo 2008), 32 columns each, and the ranks of a "
+        << SAMPLER_BLUE_NOISE_SIZE << "x" << SAMPLER_BLUE_NOISE_SIZE << "\n";
+    out << "// void and cluster blue noise mask (sigma " << sigma << ", seed " << seed << "), two 16 bit ranks per word.\n";
+    out << "\n";
+    out << "#if defined(GL_core_profile) // GLSL\n";
+    out << "#define SAMPLER_TABLE(NAME, SIZE) const daxa_u32 NAME[SIZE] = daxa_u32[SIZE](\n";
+    out << "#define SAMPLER_TABLE_END );\n";
+    out << "#else\n";
+    out << "#define SAMPLER_TABLE(NAME, SIZE) inline constexpr daxa_u32 NAME[SIZE] = {\n";
+    out << "#define SAMPLER_TABLE_END };\n";
+    out << "#endif // GL_core_profile\n";
+    out << "\n";
+    write_table(out, "sampler_sobol_matrices", sobol_matrices);
+    out << "\n";
+    write_table(out, "sampler_blue_noise_ranks", packed_ranks);
+    out << "\n";
+    out << "#undef SAMPLER_TABLE\n";
+    out << "#undef SAMPLER_TABLE_END\n";
+    return out.str();
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path out_path = "src/shaders/sampler_tables.inl";
+    std::filesystem::path preview_path = {};
+    bool check = false;
+    float sigma = 1.5f;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (arg == "--check")
+            check = true;
+        else if (arg == "--sigma" && i + 1 < argc)
+            sigma = std::max(0.5f, static_cast<float>(std::atof(argv[++i])));
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--preview" && i + 1 < argc)
+            preview_path = argv[++i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--out shaders/sampler_tables.inl] [--check] [--sigma X] [--seed N] [--preview out.ppm]" << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> sobol_matrices = get_sobol_matrices();
+    std::vector<uint32_t> ranks = get_blue_noise_ranks(SAMPLER_BLUE_NOISE_SIZE, sigma, seed);
+    double generate_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // Every rank once
+    std::vector<uint8_t> seen(ranks.size(), 0);
+    for (uint32_t rank : ranks)
+    {
+        if (rank >= ranks.size() || seen[rank])
+        {
+            std::cerr << "The ranks of the mask aren't a permutation" << std::endl;
+            return 1;
+        }
+        seen[rank] = 1;
+    }
+
+    // White noise has a flat spectrum of 1/12 (variance of a uniform value), blue noise next to nothing at low frequencies
+    std::vector<double> spectrum = get_radial_spectrum(ranks, SAMPLER_BLUE_NOISE_SIZE);
+    double low_power = 0.0, high_power = 0.0;
+    uint32_t low_bins = static_cast<uint32_t>(spectrum.size() / 4);
+    for (uint32_t bin = 1; bin < spectrum.size(); ++bin)
+        (bin <= low_bins ? low_power : high_power) += spectrum[bin];
+    low_power /= low_bins;
+    high_power /= spectrum.size() - 1 - low_bins;
+    double white_power = 1.0 / 12.0;
+    std::cout << "blue noise " << SAMPLER_BLUE_NOISE_SIZE << "x" << SAMPLER_BLUE_NOISE_SIZE << " in " << generate_ms << " ms: low frequency power "
+              << low_power / white_power << ", high frequency power " << high_power / white_power << " (times white noise)" << std::endl;
+    if (!(low_power < 0.1 * white_power))
+    {
+        std::cerr << "The mask isn't blue noise" << std::endl;
+        return 1;
+    }
+
+    if (!preview_path.empty())
+    {
+        std::vector<glm::vec3> preview(ranks.size());
+        for (size_t cell = 0; cell < ranks.size(); ++cell)
+            preview[cell] = glm::vec3((ranks[cell] + 0.5f) / ranks.size());
+        if (!write_ppm(preview_path, SAMPLER_BLUE_NOISE_SIZE, SAMPLER_BLUE_NOISE_SIZE, preview))
+            std::cerr << "Could not write " << preview_path.string() << std::endl;
+    }
+
+    std::string source = get_tables_source(sobol_matrices, ranks, sigma, seed);
+
+    if (check)
+    {
+        std::ifstream in(out_path, std::ios::binary);
+        std::string current((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bool up_to_date = in.is_open() && current == source;
+        std::cout << out_path.string() << (up_to_date ? " is up to date" : " is stale") << std::endl;
+        return up_to_date ? 0 : 2;
+    }
+
+    std::ofstream out(out_path, std::ios::binary);
+    if (!out.is_open())
+    {
+        std::cerr << "Could not open " << out_path.string() << std::endl;
+        return 1;
+    }
+    out << source;
+    std::cout << "wrote " << out_path.string() << std::endl;
+    return 0;
+}
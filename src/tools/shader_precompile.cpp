@@ -0,0 +1,147 @@
+// Shader precompiler.
+// Compiles every permutation of the pipeline table (cpu/shader_permutations.hpp: load_pipelines() & the brush, with &
+// without SER) to SPIR-V with glslangValidator & slangc, no GPU needed, and writes the shader pack the app loads with
+// SHADER_PACK_ON (cpu/shader_pack.hpp). Permutations are compiled in parallel through the shader cache, a rebuild only
+// compiles the ones whose sources changed. --depfile writes the files every permutation reaches for the build system,
+// so the pack is rebuilt when any include changes. A failing compile prints the compiler's log & exits with 1, no pack
+// is written. --check compares the pack with the sources instead (exit code 2 when it's stale).
+//
+// usage: shader_precompile [--out build/shaders.bin] [--depfile out.d] [--root dir] [--include dir]... [--glslang path]
+//                          [--slangc path] [--cache dir] [--threads N] [--check]
+
+#include "defines.h"
+#include "shader_pack.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+
+// Make syntax, spaces & # escaped
+static std::string get_depfile_path(std::filesystem::path const &path)
+{
+    std::string escaped = {};
+    for (char c : std::filesystem::absolute(path).lexically_normal().generic_string())
+    {
+        if (c == ' ' || c == '#')
+            escaped += '\\';
+        else if (c == '$')
+            escaped += '$';
+        escaped += c;
+    }
+    return escaped;
+}
+
+static bool write_depfile(std::filesystem::path const &path, std::filesystem::path const &target, std::set<std::string> const &dependencies)
+{
+    std::ofstream out(path);
+    out << get_depfile_path(target) << ":";
+    for (auto const &dependency : dependencies)
+        out << " \\\n  " << get_depfile_path(dependency);
+    out << "\n";
+    return out.good();
+}
+
+int main(int argc, char const *argv[])
+{
+    std::filesystem::path out_path = "build/shaders.bin";
+    std::filesystem::path depfile_path = {};
+    ShaderCacheSettings settings = {};
+#ifdef DAXA_SHADER_INCLUDE_DIR
+    settings.include_dirs.push_back(DAXA_SHADER_INCLUDE_DIR);
+#endif // DAXA_SHADER_INCLUDE_DIR
+    uint32_t thread_count = 0;
+    bool check = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (arg == "--depfile" && i + 1 < argc)
+            depfile_path = argv[++i];
+        else if (arg == "--root" && i + 1 < argc)
+            settings.source_root = argv[++i];
+        else if (arg == "--include" && i + 1 < argc)
+            settings.include_dirs.push_back(argv[++i]);
+        else if (arg == "--glslang" && i + 1 < argc)
+            settings.glsl_compiler = argv[++i];
+        else if (arg == "--slangc" && i + 1 < argc)
+            settings.slang_compiler = argv[++i];
+        else if (arg == "--cache" && i + 1 < argc)
+            settings.cache_dir = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            thread_count = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--check")
+            check = true;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--out build/shaders.bin] [--depfile out.d] [--root dir] [--include dir]... [--glslang path]"
+                      << " [--slangc path] [--cache dir] [--threads N] [--check]" << std::endl;
+            return 1;
+        }
+    }
+
+    // The app picks the SER permutations when the device reorders invocations
+    std::vector<PipelineDesc> descs = get_pipeline_descs(false);
+    for (auto &desc : get_pipeline_descs(true))
+        descs.push_back(std::move(desc));
+    std::vector<ShaderPermutation const *> shaders = get_pipeline_shaders(descs);
+
+    if (check)
+    {
+        ShaderPack pack = {};
+        bool up_to_date = read_shader_pack(out_path, pack);
+        for (ShaderPermutation const *shader : shaders)
+            up_to_date = up_to_date && pack.find(*shader);
+        up_to_date = up_to_date && get_stale_shader_count(pack, shaders, settings) == 0;
+        std::cout << out_path.string() << (up_to_date ? " is up to date" : " is stale") << std::endl;
+        return up_to_date ? 0 : 2;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    TilePool pool(thread_count);
+    ShaderBinarySet set = {};
+    ShaderCacheReport report = {};
+    if (!load_or_compile_shaders(shaders, settings, pool, set, &report))
+    {
+        std::cerr << report.errors;
+        std::cerr << report.failed_count << " of " << report.unique_count << " shaders failed" << std::endl;
+        return 1;
+    }
+
+    ShaderPack pack = get_shader_pack(shaders, set);
+    std::error_code error = {};
+    if (out_path.has_parent_path())
+        std::filesystem::create_directories(out_path.parent_path(), error);
+    if (!write_shader_pack(out_path, pack))
+    {
+        std::cerr << "Could not write " << out_path.string() << std::endl;
+        return 1;
+    }
+
+    if (!depfile_path.empty())
+    {
+        ShaderSourceTree tree = get_shader_source_tree(settings);
+        std::vector<ShaderSourceFile const *> dependencies = {};
+        std::set<std::string> paths = {};
+        for (ShaderPermutation const *shader : shaders)
+        {
+            tree.get_dependencies(tree.find(shader->source, shader->language), shader->language, dependencies);
+            for (ShaderSourceFile const *file : dependencies)
+                paths.insert(file->path.string());
+        }
+        if (!write_depfile(depfile_path, out_path, paths))
+        {
+            std::cerr << "Could not write " << depfile_path.string() << std::endl;
+            return 1;
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "shader_precompile: " << pack.entries.size() << " permutations, " << report.unique_count << " binaries (" << report.compiled_count
+              << " compiled, " << report.hit_count << " from the cache) on " << report.thread_count << " threads in " << ms << " ms, "
+              << out_path.string() << " " << pack.get_byte_count() / 1024 << " KiB" << std::endl;
+    return 0;
+}